@@ -1,10 +1,12 @@
 #include <math.h>
+#include <algorithm>
 
 #include "voipmonitor.h"
 #include "billing.h"
 
 
 #define UNSET_STRING string("unset")
+#define BILLING_REVALUATION_BLOCK_ROWS 10000
 
 
 extern int opt_id_sensor;
@@ -83,6 +85,7 @@ void cBillingAssignment::loadCond(SqlDb *sqlDb) {
 		while((row = rows.fetchRow())) {
 			list_ip.add(mysql_ip_2_vmIP(&row, "ip"), atoi(row["mask"].c_str()));
 		}
+		list_ip.prepareLpm();
 	}
 	if(sqlDb->existsTable(typeAssignment == _billing_ta_operator ?
 			       "billing_operator_assignment_numbers" :
@@ -100,6 +103,7 @@ void cBillingAssignment::loadCond(SqlDb *sqlDb) {
 		while((row = rows.fetchRow())) {
 			list_number.add(row["number"].c_str(), !atoi(row["fixed"].c_str()));
 		}
+		list_number.prepareLpm();
 	}
 	if(_createSqlObject) {
 		delete sqlDb;
@@ -271,6 +275,8 @@ void cBillingExclude::load(SqlDb *sqlDb) {
 				list_ip_dst.add(mysql_ip_2_vmIP(&row, "ip"), atoi(row["mask"].c_str()));
 			}
 		}
+		list_ip_src.prepareLpm();
+		list_ip_dst.prepareLpm();
 	}
 	if(sqlDb->existsTable(agregation ? "billing_agregation_exclude_numbers" : "billing_exclude_numbers")) {
 		sqlDb->query(string(
@@ -287,6 +293,8 @@ void cBillingExclude::load(SqlDb *sqlDb) {
 				list_number_dst.add(row["number"].c_str(), !atoi(row["fixed"].c_str()));
 			}
 		}
+		list_number_src.prepareLpm();
+		list_number_dst.prepareLpm();
 	}
 	if(sqlDb->existsTable(agregation ? "billing_agregation_exclude_domains" : "billing_exclude_domains")) {
 		sqlDb->query(string(
@@ -537,6 +545,7 @@ bool cPeakDefinition::peakCheck(tm &time, cStateHolidays *holidays, tm *toTime,
 
 cBillingRuleNumber::cBillingRuleNumber() {
 	regexp = NULL;
+	index = 0;
 }
 
 cBillingRuleNumber::~cBillingRuleNumber() {
@@ -605,6 +614,10 @@ string cBillingRuleNumber::numberTypeString(eNumberType numbType) {
 }
 
 
+cBillingRule::cBillingRule() {
+	numbers_trie_ok = false;
+}
+
 cBillingRule::~cBillingRule() {
 	freeNumbers();
 }
@@ -647,6 +660,7 @@ void cBillingRule::loadNumbers(SqlDb *sqlDb) {
 			numbers.push_back(number);
 		}
 	}
+	compileNumbers();
 	if(_createSqlObject) {
 		delete sqlDb;
 	}
@@ -657,6 +671,198 @@ void cBillingRule::freeNumbers() {
 		delete *iter;
 	}
 	numbers.clear();
+	numbers_all.clear();
+	numbers_regex.clear();
+	numbers_groups.clear();
+	numbers_trie.clear();
+	numbers_trie_ok = false;
+}
+
+void cBillingRule::compileNumbers() {
+	numbers_all.clear();
+	numbers_regex.clear();
+	numbers_groups.clear();
+	numbers_trie.clear();
+	numbers_trie_ok = true;
+	map<string, u_int32_t> groups[2];
+	for(list<cBillingRuleNumber*>::iterator iter = numbers.begin(); iter != numbers.end(); iter++) {
+		cBillingRuleNumber *number = *iter;
+		number->index = numbers_all.size();
+		numbers_all.push_back(number);
+		if(number->number_regex.length()) {
+			// create now - billing may run in more threads
+			number->regexp_create();
+			numbers_regex.push_back(number);
+		}
+		for(unsigned i = 0; i < 2; i++) {
+			string *pattern = i == 0 ? &number->number_fixed : &number->number_prefix;
+			if(!pattern->length()) {
+				continue;
+			}
+			u_int32_t group;
+			map<string, u_int32_t>::iterator iter_group = groups[i].find(*pattern);
+			if(iter_group != groups[i].end()) {
+				group = iter_group->second;
+			} else {
+				numbers_groups.push_back(vector<u_int32_t>());
+				group = numbers_groups.size();
+				groups[i][*pattern] = group;
+				if(!numbers_trie.add(pattern->c_str(), i == 1, group)) {
+					numbers_trie_ok = false;
+				}
+			}
+			numbers_groups[group - 1].push_back(number->index);
+		}
+	}
+	if(numbers_trie_ok) {
+		numbers_trie.build();
+	} else {
+		numbers_trie.clear();
+	}
+}
+
+void cBillingRule::getNumbersCandidates(unsigned pass, const char *number, const char *number_normalized,
+					vector<cBillingRuleNumber*> *candidates) {
+	if(pass == 1) {
+		*candidates = numbers_regex;
+		return;
+	}
+	if(!numbers_trie_ok) {
+		*candidates = numbers_all;
+		return;
+	}
+	candidates->clear();
+	vector<u_int32_t> indexes;
+	vector<u_int32_t> groups;
+	for(unsigned i = 0; i < 2; i++) {
+		const char *_number = i == 0 ? number : number_normalized;
+		if(!_number) {
+			continue;
+		}
+		u_int32_t group_exact = 0;
+		numbers_trie.lookupAll(_number, pass == 2 ? &groups : NULL, pass == 0 ? &group_exact : NULL);
+		if(pass == 0) {
+			groups.clear();
+			if(group_exact) {
+				groups.push_back(group_exact);
+			}
+		}
+		for(unsigned j = 0; j < groups.size(); j++) {
+			indexes.insert(indexes.end(), numbers_groups[groups[j] - 1].begin(), numbers_groups[groups[j] - 1].end());
+		}
+	}
+	// the same order as in list numbers
+	std::sort(indexes.begin(), indexes.end());
+	indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+	for(unsigned i = 0; i < indexes.size(); i++) {
+		candidates->push_back(numbers_all[indexes[i]]);
+	}
+}
+
+bool cBillingRule::numbersCandidatesTest(unsigned lookups) {
+	// numbers selected by billing with candidates from trie (getNumbersCandidates) vs full scan of all numbers
+	// (numbers_trie_ok = false) - fixed, prefix and regexp patterns with original / normalized / both formats
+	const char *formats[] = { "", "original", "normalized", "both" };
+	const char *types[] = { "", "local", "international", "both" };
+	const char *countries[] = { "420", "421", "44", "1", "49", "4420" };
+	srand(1);
+	bool rslt = true;
+	for(unsigned variant = 0; variant < 2; variant++) {
+		cBillingRule rule;
+		SqlDb_row rule_row;
+		rule_row.add(string("test"), "name");
+		rule_row.add(string("0.5"), "default_price");
+		rule_row.add(string("1"), "default_t1");
+		rule_row.add(string("1"), "default_t2");
+		rule_row.add(string(variant ? "original" : "both"), "default_use_for_number_format");
+		rule_row.add(string("both"), "default_use_for_number_type");
+		rule.load(&rule_row);
+		for(unsigned i = 0; i < 400; i++) {
+			SqlDb_row row;
+			string country = countries[rand() % (sizeof(countries) / sizeof(countries[0]))];
+			string pattern = (rand() % 3 == 0 ? "00" : "") + country;
+			unsigned digits = i % 4 == 0 ? 9 : rand() % 4;
+			for(unsigned j = 0; j < digits; j++) {
+				pattern += '0' + rand() % 10;
+			}
+			if(i % 50 == 7) {
+				pattern = "+" + pattern;
+			}
+			row.add("n" + intToString(i), "name");
+			switch(i % 9) {
+			case 0:
+			case 4:
+				row.add(pattern, "fixed_number");
+				break;
+			case 8:
+				row.add("^" + string(i % 2 ? "00" : "") + country + "[0-9]{" + intToString(rand() % 4 + 1) + "}", "regex_number");
+				break;
+			default:
+				row.add(pattern, "prefix_number");
+			}
+			if(variant && i == 200) {
+				// character not supported by the trie - all numbers are checked
+				row.add(pattern + "x", "prefix_number");
+			}
+			row.add(intToString(1 + i) + ".25", "price");
+			row.add(string(formats[rand() % 4]), "use_for_number_format");
+			row.add(string(types[rand() % 4]), "use_for_number_type");
+			cBillingRuleNumber *number = new FILE_LINE(0) cBillingRuleNumber;
+			number->load(&row);
+			rule.numbers.push_back(number);
+		}
+		rule.compileNumbers();
+		unsigned differ = 0;
+		unsigned found = 0;
+		for(unsigned i = 0; i < lookups; i++) {
+			// the same number in both formats, with / without international prefix, existing patterns with random tails
+			string country = countries[rand() % (sizeof(countries) / sizeof(countries[0]))];
+			string number_normalized = country;
+			unsigned digits = rand() % 10;
+			for(unsigned j = 0; j < digits; j++) {
+				number_normalized += '0' + rand() % 10;
+			}
+			if(i % 5 == 0) {
+				list<cBillingRuleNumber*>::iterator iter = rule.numbers.begin();
+				advance(iter, rand() % rule.numbers.size());
+				string pattern = (*iter)->number_fixed.length() ? (*iter)->number_fixed : (*iter)->number_prefix;
+				if(pattern.length()) {
+					number_normalized = pattern + (i % 2 ? "" : intToString(rand() % 1000));
+				}
+			}
+			string number = i % 3 == 0 ? number_normalized : 
+					i % 3 == 1 ? "00" + number_normalized :
+						     "+" + number_normalized;
+			bool isLocalNumber = rand() % 2;
+			double price[2];
+			vector<string> debug[2];
+			bool numbers_trie_ok = rule.numbers_trie_ok;
+			for(unsigned full_scan = 0; full_scan < 2; full_scan++) {
+				rule.numbers_trie_ok = full_scan ? false : numbers_trie_ok;
+				price[full_scan] = rule.billing(1600000000 + i, 60, number.c_str(), number_normalized.c_str(),
+								isLocalNumber, NULL, NULL, &debug[full_scan]);
+			}
+			rule.numbers_trie_ok = numbers_trie_ok;
+			if(price[0] != price[1] || debug[0] != debug[1]) {
+				if(differ < 10) {
+					cout << "differ number " << number << " normalized " << number_normalized << endl
+					     << " trie:      " << price[0] << " " << (debug[0].size() ? debug[0][0] : "") << endl
+					     << " full scan: " << price[1] << " " << (debug[1].size() ? debug[1][0] : "") << endl;
+				}
+				++differ;
+			}
+			if(price[1] != 0.5) {
+				++found;
+			}
+		}
+		cout << "billing numbers " << (variant ? "(trie disabled by pattern)" : "(trie)") 
+		     << " trie ok: " << rule.numbers_trie_ok
+		     << " lookups: " << lookups << " matched number: " << found << " differ: " << differ << endl;
+		if(differ || (variant == 0 && !rule.numbers_trie_ok) || (variant == 1 && rule.numbers_trie_ok)) {
+			rslt = false;
+		}
+	}
+	return(rslt);
 }
 
 double cBillingRule::billing(time_t time, unsigned duration, const char *number, const char *number_normalized,
@@ -688,8 +894,10 @@ double cBillingRule::billing(time_t time, unsigned duration, const char *number,
 	if(numbers.size()) {
 		unsigned useRegexMatchLength = 0;
 		unsigned useNumberPrefixLength = 0;
+		vector<cBillingRuleNumber*> candidates;
 		for(unsigned pass = 0; pass < 3 && !findNumber; pass++) {
-			for(list<cBillingRuleNumber*>::iterator iter = numbers.begin(); iter != numbers.end(); iter++) {
+			getNumbersCandidates(pass, number, number_normalized, &candidates);
+			for(vector<cBillingRuleNumber*>::iterator iter = candidates.begin(); iter != candidates.end(); iter++) {
 				cBillingRuleNumber::eNumberFormat number_format = (*iter)->use_for_number_format == cBillingRuleNumber::_number_format_na ?
 										   number_format_default : (*iter)->use_for_number_format;
 				cBillingRuleNumber::eNumberType number_type = (*iter)->use_for_number_type == cBillingRuleNumber::_number_type_na ?
@@ -1147,6 +1355,31 @@ bool cBilling::billing(time_t time, unsigned duration,
 		       unsigned force_operator_id, unsigned force_customer_id,
 		       bool use_exclude_rules,
 		       vector<string> *operator_debug, vector<string> *customer_debug) {
+	lock();
+	bool rslt = _billing(time, duration,
+			     ip_src, ip_dst,
+			     number_src, number_dst,
+			     domain_src, domain_dst,
+			     operator_price, customer_price,
+			     operator_currency_id, customer_currency_id,
+			     operator_id, customer_id,
+			     force_operator_id, force_customer_id,
+			     use_exclude_rules,
+			     operator_debug, customer_debug);
+	unlock();
+	return(rslt);
+}
+
+bool cBilling::_billing(time_t time, unsigned duration,
+			vmIP ip_src, vmIP ip_dst,
+			const char *number_src, const char *number_dst,
+			const char *domain_src, const char *domain_dst,
+			double *operator_price, double *customer_price,
+			unsigned *operator_currency_id, unsigned *customer_currency_id,
+			unsigned *operator_id, unsigned *customer_id,
+			unsigned force_operator_id, unsigned force_customer_id,
+			bool use_exclude_rules,
+			vector<string> *operator_debug, vector<string> *customer_debug) {
 	bool rslt = false;
 	*operator_price = 0;
 	*customer_price = 0;
@@ -1154,7 +1387,6 @@ bool cBilling::billing(time_t time, unsigned duration,
 	*customer_currency_id = 0;
 	*operator_id = 0;
 	*customer_id = 0;
-	lock();
 	string number_src_normalized = checkInternational->numberNormalized(number_src, countryPrefixes);
 	string number_dst_normalized = checkInternational->numberNormalized(number_dst, countryPrefixes);
 	if(!use_exclude_rules ||
@@ -1297,7 +1529,6 @@ bool cBilling::billing(time_t time, unsigned duration,
 			*customer_currency_id = rules->rules[*customer_id]->currency_id;
 		}
 	}
-	unlock();
 	return(rslt);
 }
 
@@ -1622,150 +1853,223 @@ string cBilling::test(const char *id, const char *time, const char *duration,
 
 void cBilling::revaluationBilling(list<u_int64_t> *ids,
 				  unsigned force_operator_id, unsigned force_customer_id,
-				  bool use_exclude_rules) {
+				  bool use_exclude_rules,
+				  unsigned threads) {
 	SqlDb *sqlDb = createSqlObject();
 	string queryStr = "select * from cdr where id in(" + implode(ids, ",") + ")";
 	sqlDb->query(queryStr);
 	SqlDb_rows rows;
 	sqlDb->fetchRows(&rows);
-	revaluationBilling(&rows, sqlDb, force_operator_id, force_customer_id, use_exclude_rules);
+	revaluationBilling(&rows, sqlDb, force_operator_id, force_customer_id, use_exclude_rules, threads);
 	delete sqlDb;
 }
 
 void cBilling::revaluationBilling(SqlDb_rows *rows, SqlDb *sqlDb,
 				  unsigned force_operator_id, unsigned force_customer_id,
-				  bool use_exclude_rules) {
-	SqlDb_row row;
+				  bool use_exclude_rules,
+				  unsigned threads) {
 	string timezone = getGuiTimezone();
-	while((row = rows->fetchRow())) {
-		cout << "revaluation cdr.id: " << row["ID"] << endl;
-		double connect_duration = atof(row["connect_duration"].c_str());
-		if(!connect_duration) {
-			continue;
+	if(threads <= 1) {
+		SqlDb_row row;
+		while((row = rows->fetchRow())) {
+			cout << "revaluation cdr.id: " << row["ID"] << endl;
+			revaluationBillingRow(&row, sqlDb, timezone.c_str(),
+					      force_operator_id, force_customer_id,
+					      use_exclude_rules);
 		}
-		u_int32_t calldate_s = mktime(row["calldate"].c_str(), timezone.c_str());
-		vmIP ip_src;
-		vmIP ip_dst;
-		ip_src.setIP(&row, "sipcallerip");
-		ip_dst.setIP(&row, "sipcalledip");
-		string number_src = row["caller"];
-		string number_dst = row["called"];
-		string domain_src = row["caller_domain"];
-		string domain_dst = row["called_domain"];
-		bool extPrecisionOperator = row.getIndexField("price_operator_mult1000000") >= 0;
-		bool extPrecisionCustomer = row.getIndexField("price_customer_mult1000000") >= 0;
-		double operator_price_old = 0;
-		double customer_price_old = 0;
-		bool operator_price_old_set = false;
-		bool customer_price_old_set = false;
-		unsigned operator_currency_id_old = 0;
-		unsigned customer_currency_id_old = 0;
-		string priceOperatorField = extPrecisionOperator ? "price_operator_mult1000000" : "price_operator_mult100";
-		string priceCustomerField = extPrecisionCustomer ? "price_customer_mult1000000" : "price_customer_mult100";
-		double priceOperatorMult = extPrecisionOperator ? 1e6 : 1e2;
-		double priceCustomerMult = extPrecisionCustomer ? 1e6 : 1e2;
-		if(!row.isNull(priceOperatorField)) {
-			operator_price_old_set = true;
-			operator_price_old = atoll(row[priceOperatorField].c_str()) / priceOperatorMult;
-		}
-		operator_currency_id_old = atol(row["price_operator_currency_id"].c_str());
-		if(!row.isNull(priceCustomerField)) {
-			customer_price_old_set = true;
-			customer_price_old = atoll(row[priceCustomerField].c_str()) / priceCustomerMult;
-		}
-		customer_currency_id_old = atol(row["price_customer_currency_id"].c_str());
-		double operator_price = 0;
-		double customer_price = 0;
-		bool operator_price_set = false;
-		bool customer_price_set = false;
-		unsigned operator_currency_id = 0;
-		unsigned customer_currency_id = 0;
-		unsigned operator_id = 0;
-		unsigned customer_id = 0;
-		if(billing(calldate_s, connect_duration,
-			   ip_src, ip_dst,
-			   number_src.c_str(), number_dst.c_str(),
-			   domain_src.c_str(), domain_dst.c_str(),
-			   &operator_price, &customer_price,
-			   &operator_currency_id, &customer_currency_id,
-			   &operator_id, &customer_id,
-			   force_operator_id, force_customer_id,
-			   use_exclude_rules)) {
-			if(operator_id) {
-				operator_price_set = true;
-			}
-			if(customer_id) {
-				customer_price_set = true;
-			}
+		return;
+	}
+	// rules are not reloaded during revaluation - threads use billing without the global lock
+	for(map<unsigned, cBillingRule*>::iterator iter = rules->rules.begin(); iter != rules->rules.end(); iter++) {
+		if(iter->second->holiday_id) {
+			holidays->holidays[iter->second->holiday_id];
+		}
+	}
+	sRevaluationThreadData threadData;
+	threadData.billing = this;
+	threadData.rows = rows;
+	threadData.rows_sync = 0;
+	threadData.rows_count = 0;
+	threadData.timezone = timezone;
+	threadData.force_operator_id = force_operator_id;
+	threadData.force_customer_id = force_customer_id;
+	threadData.use_exclude_rules = use_exclude_rules;
+	vector<pthread_t> threadHandles(threads);
+	for(unsigned i = 0; i < threads; i++) {
+		vm_pthread_create("billing revaluation",
+				  &threadHandles[i], NULL, revaluationBillingThread, &threadData, __FILE__, __LINE__);
+	}
+	for(unsigned i = 0; i < threads; i++) {
+		pthread_join(threadHandles[i], NULL);
+	}
+	// ids are not listed per row - output of threads would interleave
+	cout << "revaluation cdr rows: " << threadData.rows_count << " (threads: " << threads << ")" << endl;
+}
+
+void *cBilling::revaluationBillingThread(void *arg) {
+	sRevaluationThreadData *threadData = (sRevaluationThreadData*)arg;
+	SqlDb *sqlDb = createSqlObject();
+	SqlDb_row row;
+	while(true) {
+		while(__sync_lock_test_and_set(&threadData->rows_sync, 1));
+		row = threadData->rows->fetchRow();
+		if(row) {
+			++threadData->rows_count;
+		}
+		__sync_lock_release(&threadData->rows_sync);
+		if(!row) {
+			break;
+		}
+		threadData->billing->revaluationBillingRow(&row, sqlDb, threadData->timezone.c_str(),
+							   threadData->force_operator_id, threadData->force_customer_id,
+							   threadData->use_exclude_rules,
+							   false);
+	}
+	delete sqlDb;
+	termTimeCacheForThread();
+	return(NULL);
+}
+
+void cBilling::revaluationBillingRow(SqlDb_row *row, SqlDb *sqlDb, const char *timezone,
+				     unsigned force_operator_id, unsigned force_customer_id,
+				     bool use_exclude_rules,
+				     bool useLock) {
+	double connect_duration = atof((*row)["connect_duration"].c_str());
+	if(!connect_duration) {
+		return;
+	}
+	u_int32_t calldate_s = mktime((*row)["calldate"].c_str(), timezone);
+	vmIP ip_src;
+	vmIP ip_dst;
+	ip_src.setIP(row, "sipcallerip");
+	ip_dst.setIP(row, "sipcalledip");
+	string number_src = (*row)["caller"];
+	string number_dst = (*row)["called"];
+	string domain_src = (*row)["caller_domain"];
+	string domain_dst = (*row)["called_domain"];
+	bool extPrecisionOperator = row->getIndexField("price_operator_mult1000000") >= 0;
+	bool extPrecisionCustomer = row->getIndexField("price_customer_mult1000000") >= 0;
+	double operator_price_old = 0;
+	double customer_price_old = 0;
+	bool operator_price_old_set = false;
+	bool customer_price_old_set = false;
+	unsigned operator_currency_id_old = 0;
+	unsigned customer_currency_id_old = 0;
+	string priceOperatorField = extPrecisionOperator ? "price_operator_mult1000000" : "price_operator_mult100";
+	string priceCustomerField = extPrecisionCustomer ? "price_customer_mult1000000" : "price_customer_mult100";
+	double priceOperatorMult = extPrecisionOperator ? 1e6 : 1e2;
+	double priceCustomerMult = extPrecisionCustomer ? 1e6 : 1e2;
+	if(!row->isNull(priceOperatorField)) {
+		operator_price_old_set = true;
+		operator_price_old = atoll((*row)[priceOperatorField].c_str()) / priceOperatorMult;
+	}
+	operator_currency_id_old = atol((*row)["price_operator_currency_id"].c_str());
+	if(!row->isNull(priceCustomerField)) {
+		customer_price_old_set = true;
+		customer_price_old = atoll((*row)[priceCustomerField].c_str()) / priceCustomerMult;
+	}
+	customer_currency_id_old = atol((*row)["price_customer_currency_id"].c_str());
+	double operator_price = 0;
+	double customer_price = 0;
+	bool operator_price_set = false;
+	bool customer_price_set = false;
+	unsigned operator_currency_id = 0;
+	unsigned customer_currency_id = 0;
+	unsigned operator_id = 0;
+	unsigned customer_id = 0;
+	if(useLock ?
+	    billing(calldate_s, connect_duration,
+		    ip_src, ip_dst,
+		    number_src.c_str(), number_dst.c_str(),
+		    domain_src.c_str(), domain_dst.c_str(),
+		    &operator_price, &customer_price,
+		    &operator_currency_id, &customer_currency_id,
+		    &operator_id, &customer_id,
+		    force_operator_id, force_customer_id,
+		    use_exclude_rules) :
+	    _billing(calldate_s, connect_duration,
+		     ip_src, ip_dst,
+		     number_src.c_str(), number_dst.c_str(),
+		     domain_src.c_str(), domain_dst.c_str(),
+		     &operator_price, &customer_price,
+		     &operator_currency_id, &customer_currency_id,
+		     &operator_id, &customer_id,
+		     force_operator_id, force_customer_id,
+		     use_exclude_rules,
+		     NULL, NULL)) {
+		if(operator_id) {
+			operator_price_set = true;
+		}
+		if(customer_id) {
+			customer_price_set = true;
 		}
+	}
+	if(operator_price_set != operator_price_old_set ||
+	   fabs(operator_price - operator_price_old) > 5e-7 ||
+	   operator_currency_id != operator_currency_id_old ||
+	   customer_price_set != customer_price_old_set ||
+	   fabs(customer_price - customer_price_old) > 5e-7 ||
+	   customer_currency_id != customer_currency_id_old) {
+		bool set = false;
+		SqlDb_row row_update;
 		if(operator_price_set != operator_price_old_set ||
-		   fabs(operator_price - operator_price_old) > 5e-7 ||
-		   operator_currency_id != operator_currency_id_old ||
-		   customer_price_set != customer_price_old_set ||
-		   fabs(customer_price - customer_price_old) > 5e-7 ||
-		   customer_currency_id != customer_currency_id_old) {
-			bool set = false;
-			SqlDb_row row_update;
-			if(operator_price_set != operator_price_old_set ||
-			   fabs(operator_price - operator_price_old_set) > 1e-7 ||
-			   operator_currency_id != operator_currency_id_old) {
-				if(operator_price_set) {
-					row_update.add(round(operator_price * priceOperatorMult), priceOperatorField);
-					row_update.add(operator_currency_id, "price_operator_currency_id", true);
-					set = true;
-				} else {
-					row_update.add(0, priceOperatorField, true);
-					row_update.add(0, "price_operator_currency_id", true);
-					set = true;
-				}
+		   fabs(operator_price - operator_price_old_set) > 1e-7 ||
+		   operator_currency_id != operator_currency_id_old) {
+			if(operator_price_set) {
+				row_update.add(round(operator_price * priceOperatorMult), priceOperatorField);
+				row_update.add(operator_currency_id, "price_operator_currency_id", true);
+				set = true;
+			} else {
+				row_update.add(0, priceOperatorField, true);
+				row_update.add(0, "price_operator_currency_id", true);
+				set = true;
 			}
-			if(customer_price_set != customer_price_old_set ||
-			   fabs(customer_price - customer_price_old_set) > 1e-7 ||
-			   customer_currency_id != customer_currency_id_old) {
-				if(customer_price_set) {
-					row_update.add(round(customer_price * priceCustomerMult), priceCustomerField);
-					row_update.add(customer_currency_id, "price_customer_currency_id", true);
-					set = true;
-				} else {
-					row_update.add(0, priceCustomerField, true);
-					row_update.add(0, "price_customer_currency_id", true);
-					set = true;
-				}
+		}
+		if(customer_price_set != customer_price_old_set ||
+		   fabs(customer_price - customer_price_old_set) > 1e-7 ||
+		   customer_currency_id != customer_currency_id_old) {
+			if(customer_price_set) {
+				row_update.add(round(customer_price * priceCustomerMult), priceCustomerField);
+				row_update.add(customer_currency_id, "price_customer_currency_id", true);
+				set = true;
+			} else {
+				row_update.add(0, priceCustomerField, true);
+				row_update.add(0, "price_customer_currency_id", true);
+				set = true;
 			}
-			if(set) {
-				SqlDb_row row_cond;
-				row_cond.add(row["id"], "id");
-				sqlDb->update("cdr", row_update, row_cond);
-				if(fabs(operator_price - operator_price_old) > 5e-7 ||
-				   fabs(customer_price - customer_price_old) > 5e-7) {
-					list<string> aggregation_inserts;
-					saveAggregation(calldate_s,
-							ip_src, ip_dst,
-							number_src.c_str(), number_dst.c_str(),
-							domain_src.c_str(), domain_dst.c_str(),
-							operator_price - operator_price_old,
-							customer_price - customer_price_old,
-							operator_currency_id,
-							customer_currency_id,
-							&aggregation_inserts);
-					if(aggregation_inserts.size()) {
-						bool disableLogErrorOld = sqlDb->getDisableLogError();
-						unsigned int maxQueryPassOld = sqlDb->getMaxQueryPass();
-						sqlDb->setDisableLogError(true);
-						sqlDb->setMaxQueryPass(1);
-						for(list<string>::iterator iter = aggregation_inserts.begin(); iter != aggregation_inserts.end(); iter++) {
-							sqlDb->query(*iter);
-						}
-						sqlDb->setMaxQueryPass(maxQueryPassOld);
-						sqlDb->setDisableLogError(disableLogErrorOld);
+		}
+		if(set) {
+			SqlDb_row row_cond;
+			row_cond.add((*row)["id"], "id");
+			sqlDb->update("cdr", row_update, row_cond);
+			if(fabs(operator_price - operator_price_old) > 5e-7 ||
+			   fabs(customer_price - customer_price_old) > 5e-7) {
+				list<string> aggregation_inserts;
+				saveAggregation(calldate_s,
+						ip_src, ip_dst,
+						number_src.c_str(), number_dst.c_str(),
+						domain_src.c_str(), domain_dst.c_str(),
+						operator_price - operator_price_old,
+						customer_price - customer_price_old,
+						operator_currency_id,
+						customer_currency_id,
+						&aggregation_inserts);
+				if(aggregation_inserts.size()) {
+					bool disableLogErrorOld = sqlDb->getDisableLogError();
+					unsigned int maxQueryPassOld = sqlDb->getMaxQueryPass();
+					sqlDb->setDisableLogError(true);
+					sqlDb->setMaxQueryPass(1);
+					for(list<string>::iterator iter = aggregation_inserts.begin(); iter != aggregation_inserts.end(); iter++) {
+						sqlDb->query(*iter);
 					}
+					sqlDb->setMaxQueryPass(maxQueryPassOld);
+					sqlDb->setDisableLogError(disableLogErrorOld);
 				}
 			}
 		}
 	}
 }
 
-
 extern int opt_enable_billing;
 
 cBilling *billing;
@@ -1799,6 +2103,19 @@ void refreshBilling() {
 void revaluationBilling(const char *params) {
 	JsonItem jsonData;
 	jsonData.parse(params);
+	unsigned force_operator_id = atol(jsonData.getValue("operator").c_str());
+	unsigned force_customer_id = atol(jsonData.getValue("customer").c_str());
+	bool use_exclude_rules = atoi(jsonData.getValue("use_exclude_rules").c_str()) > 0;
+	unsigned threads = atoi(jsonData.getValue("threads").c_str());
+	string calldate_from = jsonData.getValue("calldate_from");
+	string calldate_to = jsonData.getValue("calldate_to");
+	if(!calldate_from.empty() && !calldate_to.empty()) {
+		revaluationBilling(calldate_from.c_str(), calldate_to.c_str(),
+				   force_operator_id, force_customer_id,
+				   use_exclude_rules,
+				   threads);
+		return;
+	}
 	JsonItem *json_ids = jsonData.getItem("ids");
 	if(!json_ids || !json_ids->getLocalCount()) {
 		return;
@@ -1816,25 +2133,19 @@ void revaluationBilling(const char *params) {
 	if(!ids.size()) {
 		return;
 	}
-	unsigned force_operator_id = atol(jsonData.getValue("operator").c_str());
-	unsigned force_customer_id = atol(jsonData.getValue("customer").c_str());
-	bool use_exclude_rules = atoi(jsonData.getValue("use_exclude_rules").c_str()) > 0;
 	revaluationBilling(&ids,
 			   force_operator_id, force_customer_id,
-			   use_exclude_rules);
+			   use_exclude_rules,
+			   threads);
 }
 
-void revaluationBilling(list<u_int64_t> *ids,
-			unsigned force_operator_id, unsigned force_customer_id,
-			bool use_exclude_rules) {
+static void revaluationBillingSensors(SqlDb_rows *rows, SqlDb *sqlDb, map<int, cBilling*> *sensor_billing,
+				      unsigned force_operator_id, unsigned force_customer_id,
+				      bool use_exclude_rules,
+				      unsigned threads) {
 	map<int, SqlDb_rows*> sensor_rows;
-	SqlDb *sqlDb = createSqlObject();
-	string queryStr = "select * from cdr where id in(" + implode(ids, ",") + ")";
-	sqlDb->query(queryStr);
-	SqlDb_rows rows;
-	sqlDb->fetchRows(&rows);
 	SqlDb_row row;
-	while((row = rows.fetchRow())) {
+	while((row = rows->fetchRow())) {
 		int id_sensor = row.isNull("id_sensor") ? -1 : atoi(row["id_sensor"].c_str());
 		map<int, SqlDb_rows*>::iterator iter = sensor_rows.find(id_sensor);
 		if(iter == sensor_rows.end()) {
@@ -1843,13 +2154,85 @@ void revaluationBilling(list<u_int64_t> *ids,
 		sensor_rows[id_sensor]->push(&row);
 	}
 	for(map<int, SqlDb_rows*>::iterator iter = sensor_rows.begin(); iter != sensor_rows.end(); iter++) {
-		opt_enable_billing = true;
-		opt_id_sensor = iter->first;
-		cBilling *billing = new FILE_LINE(0) cBilling();
-		billing->load(sqlDb);
-		billing->revaluationBilling(iter->second, sqlDb, force_operator_id, force_customer_id, use_exclude_rules);
-		delete billing;
+		cBilling *billing;
+		map<int, cBilling*>::iterator iter_billing = sensor_billing->find(iter->first);
+		if(iter_billing != sensor_billing->end()) {
+			billing = iter_billing->second;
+		} else {
+			opt_enable_billing = true;
+			opt_id_sensor = iter->first;
+			billing = new FILE_LINE(0) cBilling();
+			billing->load(sqlDb);
+			(*sensor_billing)[iter->first] = billing;
+		}
+		billing->revaluationBilling(iter->second, sqlDb, force_operator_id, force_customer_id, use_exclude_rules, threads);
+		delete iter->second;
+	}
+}
+
+static void revaluationBillingSensorsFree(map<int, cBilling*> *sensor_billing) {
+	for(map<int, cBilling*>::iterator iter = sensor_billing->begin(); iter != sensor_billing->end(); iter++) {
+		delete iter->second;
+	}
+	sensor_billing->clear();
+}
+
+void revaluationBilling(list<u_int64_t> *ids,
+			unsigned force_operator_id, unsigned force_customer_id,
+			bool use_exclude_rules,
+			unsigned threads) {
+	map<int, cBilling*> sensor_billing;
+	SqlDb *sqlDb = createSqlObject();
+	string queryStr = "select * from cdr where id in(" + implode(ids, ",") + ")";
+	sqlDb->query(queryStr);
+	SqlDb_rows rows;
+	sqlDb->fetchRows(&rows);
+	revaluationBillingSensors(&rows, sqlDb, &sensor_billing,
+				  force_operator_id, force_customer_id,
+				  use_exclude_rules,
+				  threads);
+	revaluationBillingSensorsFree(&sensor_billing);
+	delete sqlDb;
+}
+
+void revaluationBilling(const char *calldate_from, const char *calldate_to,
+			unsigned force_operator_id, unsigned force_customer_id,
+			bool use_exclude_rules,
+			unsigned threads) {
+	// cdr are read in blocks by id - whole interval is not kept in memory, billing is loaded once per sensor
+	map<int, cBilling*> sensor_billing;
+	SqlDb *sqlDb = createSqlObject();
+	u_int64_t last_id = 0;
+	while(true) {
+		string queryStr = "select * from cdr where calldate >= " + sqlEscapeStringBorder(calldate_from) +
+				  " and calldate < " + sqlEscapeStringBorder(calldate_to) +
+				  " and id > " + intToString(last_id) +
+				  " order by id limit " + intToString(BILLING_REVALUATION_BLOCK_ROWS);
+		if(!sqlDb->query(queryStr)) {
+			break;
+		}
+		SqlDb_rows rows;
+		sqlDb->fetchRows(&rows);
+		unsigned countRows = rows.countRow();
+		if(!countRows) {
+			break;
+		}
+		SqlDb_row row;
+		while((row = rows.fetchRow())) {
+			u_int64_t id = atoll(row["id"].c_str());
+			if(id > last_id) {
+				last_id = id;
+			}
+		}
+		revaluationBillingSensors(&rows, sqlDb, &sensor_billing,
+					  force_operator_id, force_customer_id,
+					  use_exclude_rules,
+					  threads);
+		if(countRows < BILLING_REVALUATION_BLOCK_ROWS) {
+			break;
+		}
 	}
+	revaluationBillingSensorsFree(&sensor_billing);
 	delete sqlDb;
 }
 
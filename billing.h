@@ -192,11 +192,20 @@ private:
 	eNumberFormat use_for_number_format;
 	eNumberType use_for_number_type;
 	cRegExp *regexp;
+	unsigned index;
 friend class cBillingRule;
 };
 
+/*
+ * Numbers of the rule are compiled (compileNumbers) into digit trie - fixed numbers as exact entries, prefixes
+ * as prefix entries, entries with the same pattern share group (list of indexes of numbers in load order).
+ * Billing then checks only numbers whose pattern matches (getNumbersCandidates) in the original order,
+ * so the result is the same as with the full scan. Regexps are checked sequentially.
+ * If some pattern contains character not supported by the trie, all numbers are checked (as before).
+ */
 class cBillingRule {
 public:
+	cBillingRule();
 	~cBillingRule();
 	void load(SqlDb_row *row);
 	void loadNumbers(SqlDb *sqlDb = NULL);
@@ -204,6 +213,11 @@ public:
 	double billing(time_t time, unsigned duration, const char *number, const char *number_normalized,
 		       bool isLocalNumber, cStateHolidays *holidays, const char *timezone,
 		       vector<string> *debug = NULL);
+	static bool numbersCandidatesTest(unsigned lookups);
+private:
+	void compileNumbers();
+	void getNumbersCandidates(unsigned pass, const char *number, const char *number_normalized,
+				  vector<cBillingRuleNumber*> *candidates);
 private:
 	unsigned id;
 	string name;
@@ -220,6 +234,11 @@ private:
 	unsigned currency_id;
 	string timezone_name;
 	list<cBillingRuleNumber*> numbers;
+	vector<cBillingRuleNumber*> numbers_all;
+	vector<cBillingRuleNumber*> numbers_regex;
+	vector<vector<u_int32_t> > numbers_groups;
+	cLpmNumber numbers_trie;
+	bool numbers_trie_ok;
 friend class cBillingRules;
 friend class cBilling;
 };
@@ -304,6 +323,16 @@ public:
 		bool week;
 		unsigned limit;
 	};
+	struct sRevaluationThreadData {
+		cBilling *billing;
+		SqlDb_rows *rows;
+		volatile int rows_sync;
+		unsigned rows_count;
+		string timezone;
+		unsigned force_operator_id;
+		unsigned force_customer_id;
+		bool use_exclude_rules;
+	};
 public:
 	cBilling();
 	~cBilling();
@@ -343,10 +372,28 @@ public:
 		    bool json_rslt);
 	void revaluationBilling(list<u_int64_t> *ids,
 				unsigned force_operator_id = 0, unsigned force_customer_id = 0,
-				bool use_exclude_rules = true);
+				bool use_exclude_rules = true,
+				unsigned threads = 1);
 	void revaluationBilling(SqlDb_rows *rows, SqlDb *sqlDb,
 				unsigned force_operator_id = 0, unsigned force_customer_id = 0,
-				bool use_exclude_rules = true);
+				bool use_exclude_rules = true,
+				unsigned threads = 1);
+private:
+	bool _billing(time_t time, unsigned duration,
+		      vmIP ip_src, vmIP ip_dst,
+		      const char *number_src, const char *number_dst,
+		      const char *domain_src, const char *domain_dst,
+		      double *operator_price, double *customer_price,
+		      unsigned *operator_currency_id, unsigned *customer_currency_id,
+		      unsigned *operator_id, unsigned *customer_id,
+		      unsigned force_operator_id, unsigned force_customer_id,
+		      bool use_exclude_rules,
+		      vector<string> *operator_debug, vector<string> *customer_debug);
+	void revaluationBillingRow(SqlDb_row *row, SqlDb *sqlDb, const char *timezone,
+				   unsigned force_operator_id, unsigned force_customer_id,
+				   bool use_exclude_rules,
+				   bool useLock = true);
+	static void *revaluationBillingThread(void *arg);
 private:
 	void lock() {
 		while(__sync_lock_test_and_set(&_sync, 1));
@@ -377,7 +424,12 @@ void refreshBilling();
 void revaluationBilling(const char *params);
 void revaluationBilling(list<u_int64_t> *ids,
 			unsigned force_operator_id = 0, unsigned force_customer_id = 0,
-			bool use_exclude_rules = true);
+			bool use_exclude_rules = true,
+			unsigned threads = 1);
+void revaluationBilling(const char *calldate_from, const char *calldate_to,
+			unsigned force_operator_id = 0, unsigned force_customer_id = 0,
+			bool use_exclude_rules = true,
+			unsigned threads = 1);
 
 
 #endif //BILLING_H
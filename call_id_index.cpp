@@ -0,0 +1,179 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+#include "call_id_index.h"
+#include "heap_safe.h"
+
+
+cCallIdIndex::cCallIdIndex() {
+	for(unsigned i = 0; i < CALL_ID_INDEX_SHARDS; i++) {
+		sShard *shard = &shards[i];
+		shard->capacity = CALL_ID_INDEX_SHARD_INIT_CAPACITY;
+		shard->slots = new FILE_LINE(0) sSlot[shard->capacity];
+		memset(shard->slots, 0, sizeof(sSlot) * shard->capacity);
+		shard->count = 0;
+		shard->tombstones = 0;
+		shard->_sync = 0;
+	}
+}
+
+cCallIdIndex::~cCallIdIndex() {
+	for(unsigned i = 0; i < CALL_ID_INDEX_SHARDS; i++) {
+		sShard *shard = &shards[i];
+		for(unsigned j = 0; j < shard->capacity; j++) {
+			if(shard->slots[j].key) {
+				delete [] shard->slots[j].key;
+			}
+		}
+		delete [] shard->slots;
+	}
+}
+
+void cCallIdIndex::add(const char *key, unsigned key_length, u_int64_t hash, Call *call) {
+	sShard *shard = &shards[shardIndex(hash)];
+	if((shard->count + shard->tombstones + 1) * 10 > shard->capacity * 7) {
+		rehash(shard, (shard->count + 1) * 2 > shard->capacity ? shard->capacity * 2 : shard->capacity);
+	}
+	unsigned mask = shard->capacity - 1;
+	unsigned pos = hash & mask;
+	int tombstone_pos = -1;
+	while(shard->slots[pos].hash) {
+		sSlot *slot = &shard->slots[pos];
+		if(!slot->call) {
+			if(tombstone_pos < 0) {
+				tombstone_pos = pos;
+			}
+		} else if(slot->hash == hash &&
+			  slot->key_length == key_length && !memcmp(slot->key, key, key_length)) {
+			slot->call = call;
+			return;
+		}
+		pos = (pos + 1) & mask;
+	}
+	if(tombstone_pos >= 0) {
+		pos = tombstone_pos;
+		--shard->tombstones;
+	}
+	sSlot *slot = &shard->slots[pos];
+	slot->hash = hash;
+	slot->call = call;
+	slot->key = new FILE_LINE(0) char[key_length + 1];
+	memcpy(slot->key, key, key_length);
+	slot->key[key_length] = 0;
+	slot->key_length = key_length;
+	++shard->count;
+}
+
+bool cCallIdIndex::remove(const char *key, unsigned key_length, u_int64_t hash, Call *call) {
+	sShard *shard = &shards[shardIndex(hash)];
+	unsigned mask = shard->capacity - 1;
+	unsigned pos = hash & mask;
+	while(shard->slots[pos].hash) {
+		sSlot *slot = &shard->slots[pos];
+		if(slot->hash == hash && slot->call &&
+		   slot->key_length == key_length && !memcmp(slot->key, key, key_length)) {
+			if(call && slot->call != call) {
+				return(false);
+			}
+			delete [] slot->key;
+			slot->key = NULL;
+			slot->key_length = 0;
+			slot->call = NULL;
+			--shard->count;
+			if(!shard->slots[(pos + 1) & mask].hash) {
+				// end of cluster - tombstone is not needed
+				slot->hash = 0;
+			} else {
+				++shard->tombstones;
+			}
+			return(true);
+		}
+		pos = (pos + 1) & mask;
+	}
+	return(false);
+}
+
+void cCallIdIndex::rehash(sShard *shard, unsigned capacity) {
+	sSlot *slots_old = shard->slots;
+	unsigned capacity_old = shard->capacity;
+	shard->slots = new FILE_LINE(0) sSlot[capacity];
+	memset(shard->slots, 0, sizeof(sSlot) * capacity);
+	shard->capacity = capacity;
+	shard->tombstones = 0;
+	unsigned mask = capacity - 1;
+	for(unsigned i = 0; i < capacity_old; i++) {
+		if(slots_old[i].call) {
+			unsigned pos = slots_old[i].hash & mask;
+			while(shard->slots[pos].hash) {
+				pos = (pos + 1) & mask;
+			}
+			shard->slots[pos] = slots_old[i];
+		}
+	}
+	delete [] slots_old;
+	++shard->stat.rehashes;
+}
+
+size_t cCallIdIndex::size() {
+	size_t size = 0;
+	for(unsigned i = 0; i < CALL_ID_INDEX_SHARDS; i++) {
+		size += shards[i].count;
+	}
+	return(size);
+}
+
+string cCallIdIndex::getStats() {
+	ostringstream outStr;
+	outStr << "call-id index (" << CALL_ID_INDEX_SHARDS << " shards)" << endl;
+	outStr << setw(5) << "shard"
+	       << setw(10) << "count"
+	       << setw(10) << "capacity"
+	       << setw(8) << "tomb"
+	       << setw(14) << "lookups"
+	       << setw(8) << "hit%"
+	       << setw(10) << "avgprobe"
+	       << setw(10) << "maxprobe"
+	       << setw(12) << "contended"
+	       << setw(8) << "rehash"
+	       << endl;
+	size_t sum_count = 0;
+	u_int64_t sum_lookups = 0;
+	u_int64_t sum_contended = 0;
+	for(unsigned i = 0; i < CALL_ID_INDEX_SHARDS; i++) {
+		sShard *shard = &shards[i];
+		__SYNC_LOCK(shard->_sync);
+		unsigned count = shard->count;
+		unsigned capacity = shard->capacity;
+		unsigned tombstones = shard->tombstones;
+		sShardStat stat = shard->stat;
+		__SYNC_UNLOCK(shard->_sync);
+		outStr << fixed
+		       << setw(5) << i
+		       << setw(10) << count
+		       << setw(10) << capacity
+		       << setw(8) << tombstones
+		       << setw(14) << stat.lookups
+		       << setw(8) << setprecision(1) << (stat.lookups ? (double)stat.hits / stat.lookups * 100 : 0)
+		       << setw(10) << setprecision(2) << (stat.lookups ? (double)stat.probes / stat.lookups : 0)
+		       << setw(10) << stat.max_probes
+		       << setw(12) << stat.lock_contended
+		       << setw(8) << stat.rehashes
+		       << endl;
+		sum_count += count;
+		sum_lookups += stat.lookups;
+		sum_contended += stat.lock_contended;
+	}
+	outStr << "sum count: " << sum_count
+	       << ", lookups: " << sum_lookups
+	       << ", contended: " << sum_contended << endl;
+	return(outStr.str());
+}
+
+void cCallIdIndex::clearStats() {
+	for(unsigned i = 0; i < CALL_ID_INDEX_SHARDS; i++) {
+		__SYNC_LOCK(shards[i]._sync);
+		shards[i].stat.clear();
+		__SYNC_UNLOCK(shards[i]._sync);
+	}
+}
@@ -0,0 +1,158 @@
+#ifndef CALL_ID_INDEX_H
+#define CALL_ID_INDEX_H
+
+
+#include <string>
+#include <string.h>
+#include <sys/types.h>
+
+#include "sync.h"
+
+
+#define CALL_ID_INDEX_SHARDS_BITS 6
+#define CALL_ID_INDEX_SHARDS (1 << CALL_ID_INDEX_SHARDS_BITS)
+#define CALL_ID_INDEX_SHARD_INIT_CAPACITY 1024
+
+
+using namespace std;
+
+
+class Call;
+
+
+/*
+ * Call-id -> Call* index.
+ * Sharded open addressing table (linear probing, tombstones) - shard is selected by high bits
+ * of 64-bit hash, slot by low bits. Each shard has own spinlock, lookup does no heap allocation.
+ * Keys are copied into the index, so an alias (opt_call_id_alternative) can point to the same Call.
+ */
+class cCallIdIndex {
+public:
+	struct sSlot {
+		u_int64_t hash;
+		Call *call;
+		char *key;
+		unsigned key_length;
+	};
+	struct sShardStat {
+		sShardStat() {
+			clear();
+		}
+		void clear() {
+			lookups = 0;
+			hits = 0;
+			probes = 0;
+			max_probes = 0;
+			lock_contended = 0;
+			rehashes = 0;
+		}
+		u_int64_t lookups;
+		u_int64_t hits;
+		u_int64_t probes;
+		unsigned max_probes;
+		u_int64_t lock_contended;
+		unsigned rehashes;
+	};
+	struct sShard {
+		sSlot *slots;
+		unsigned capacity;
+		unsigned count;
+		unsigned tombstones;
+		volatile int _sync;
+		sShardStat stat;
+		char _pad[64];
+	};
+public:
+	cCallIdIndex();
+	~cCallIdIndex();
+	static inline u_int64_t hash(const char *key, unsigned key_length) {
+		u_int64_t h = 0x9E3779B97F4A7C15ull ^ (key_length * 0xC2B2AE3D27D4EB4Full);
+		const u_char *p = (const u_char*)key;
+		while(key_length >= 8) {
+			u_int64_t w;
+			memcpy(&w, p, 8);
+			h = (h ^ (w * 0x87C37B91114253D5ull)) * 0x4CF5AD432745937Full;
+			h ^= h >> 31;
+			p += 8;
+			key_length -= 8;
+		}
+		if(key_length) {
+			u_int64_t w = 0;
+			memcpy(&w, p, key_length);
+			h = (h ^ (w * 0x87C37B91114253D5ull)) * 0x4CF5AD432745937Full;
+		}
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		return(h ? h : 1);
+	}
+	static inline unsigned shardIndex(u_int64_t hash) {
+		return(hash >> (64 - CALL_ID_INDEX_SHARDS_BITS));
+	}
+	inline void lock(u_int64_t hash) {
+		sShard *shard = &shards[shardIndex(hash)];
+		if(__sync_lock_test_and_set(&shard->_sync, 1)) {
+			++shard->stat.lock_contended;
+			__SYNC_LOCK(shard->_sync);
+		}
+	}
+	inline void unlock(u_int64_t hash) {
+		__SYNC_UNLOCK(shards[shardIndex(hash)]._sync);
+	}
+	inline Call *find(const char *key, unsigned key_length, u_int64_t hash) {
+		sShard *shard = &shards[shardIndex(hash)];
+		++shard->stat.lookups;
+		unsigned mask = shard->capacity - 1;
+		unsigned pos = hash & mask;
+		unsigned probes = 1;
+		while(shard->slots[pos].hash) {
+			sSlot *slot = &shard->slots[pos];
+			if(slot->hash == hash && slot->call &&
+			   slot->key_length == key_length && !memcmp(slot->key, key, key_length)) {
+				addProbes(shard, probes);
+				++shard->stat.hits;
+				return(slot->call);
+			}
+			pos = (pos + 1) & mask;
+			++probes;
+		}
+		addProbes(shard, probes);
+		return(NULL);
+	}
+	// caller holds shard lock for find / add / remove
+	void add(const char *key, unsigned key_length, u_int64_t hash, Call *call);
+	bool remove(const char *key, unsigned key_length, u_int64_t hash, Call *call);
+	Call *find_lock(const char *key, unsigned key_length, u_int64_t hash) {
+		lock(hash);
+		Call *call = find(key, key_length, hash);
+		unlock(hash);
+		return(call);
+	}
+	void add_lock(const char *key, unsigned key_length, u_int64_t hash, Call *call) {
+		lock(hash);
+		add(key, key_length, hash, call);
+		unlock(hash);
+	}
+	bool remove_lock(const char *key, unsigned key_length, u_int64_t hash, Call *call) {
+		lock(hash);
+		bool rslt = remove(key, key_length, hash, call);
+		unlock(hash);
+		return(rslt);
+	}
+	size_t size();
+	string getStats();
+	void clearStats();
+private:
+	inline void addProbes(sShard *shard, unsigned probes) {
+		shard->stat.probes += probes;
+		if(probes > shard->stat.max_probes) {
+			shard->stat.max_probes = probes;
+		}
+	}
+	void rehash(sShard *shard, unsigned capacity);
+private:
+	sShard shards[CALL_ID_INDEX_SHARDS];
+};
+
+
+#endif //CALL_ID_INDEX_H
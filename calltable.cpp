@@ -62,6 +62,8 @@
 #include "sniff_proc_class.h"
 #include "charts.h"
 #include "server.h"
+#include "rtp_hash_cache.h"
+#include "codec_decoders.h"
 
 
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
@@ -182,6 +184,7 @@ extern char mac[32];
 unsigned int last_register_clean = 0;
 
 extern int opt_onewaytimeout;
+extern bool opt_cleanup_timer_wheel;
 extern int opt_saveaudio_reversestereo;
 extern int opt_saveaudio_stereo;
 extern int opt_saveaudio_reversestereo;
@@ -191,6 +194,7 @@ extern bool opt_saveaudio_filter_ext;
 extern bool opt_saveaudio_wav_mix;
 extern bool opt_saveaudio_from_first_invite;
 extern bool opt_saveaudio_afterconnect;
+extern int opt_saveaudio_inmemory_max_duration;
 extern bool opt_saveaudio_from_rtp;
 extern int opt_skinny;
 extern int opt_enable_fraud;
@@ -296,6 +300,7 @@ Call_abstract::Call_abstract(int call_type, u_int64_t time_us) {
 	user_data = NULL;
 	user_data_type = 0;
 	chunkBuffersCount = 0;
+	cleanup_timer.owner = this;
 }
 
 bool 
@@ -468,6 +473,8 @@ Call::Call(int call_type, char *call_id, unsigned long call_id_len, vector<strin
 		this->call_id = string(call_id);
 		this->call_id_len = this->call_id.length();
 	}
+	this->call_id_hash = cCallIdIndex::hash(this->call_id.c_str(), this->call_id.length());
+	this->in_calls_list = false;
 	if(opt_call_id_alternative[0]) {
 		this->call_id_alternative = new FILE_LINE(0) map<string, bool>;
 		if(call_id_alternative) {
@@ -769,6 +776,8 @@ Call::removeFindTables(struct timeval *ts, bool set_end_call, bool destroy) {
 	} else {
 		this->hashRemove(ts, true);
 	}
+	// lock-free rtp lookups started before removal from hash must finish before call can be destroyed
+	cRtpHashCache::sync();
 	this->skinnyTablesRemove();
 }
 
@@ -1164,6 +1173,7 @@ Call::refresh_data_ip_port(vmIP addr, vmPort port, struct timeval *ts,
 					}
 					#endif
 				}
+				cRtpHashCache::bump(addr, port);
 				calltable->unlock_calls_hash();
 			}
 			if(rtp_crypto_config_list && rtp_crypto_config_list->size()) {
@@ -1461,6 +1471,8 @@ Call::_read_rtp(packet_s *packetS, int iscaller, bool find_by_dest, bool stream_
 
 	if(first_rtp_time_us == 0) {
 		first_rtp_time_us = getTimeUS(packetS->header_pt);
+		// rtptimeout from the first rtp can be before sipwithoutrtptimeout
+		cleanup_timer_shift(TIME_US_TO_S(first_rtp_time_us) + rtptimeout + 1);
 	}
 	
 	unsigned int curSSRC;
@@ -2100,13 +2112,13 @@ void Call::stoprecording() {
 	}
 }
 		
-int convertALAW2WAV(const char *fname1, char *fname3, int maxsamplerate) {
+int convertALAW2WAV(const char *fname1, FILE *f_out, int maxsamplerate) {
 	unsigned char *bitstream_buf1;
 	int16_t buf_out1;
 	unsigned char *p1;
 	unsigned char *f1;
 	long file_size1;
-
+ 
 	//TODO: move it to main program to not init it overtimes or make alaw_init not reinitialize
 	alaw_init();
  
@@ -2118,19 +2130,6 @@ int convertALAW2WAV(const char *fname1, char *fname3, int maxsamplerate) {
 		syslog(LOG_ERR,"File [%s] cannot be opened for read", fname1);
 		return -1;
 	}
-
-	FILE *f_out = fopen(fname3, "a"); // THIS HAS TO BE APPEND!
-	if(f_out) {
-		spooldir_file_chmod_own(f_out);
-	} else {
-		fclose(f_in1);
-		syslog(LOG_ERR,"File [%s] cannot be opened for write", fname3);
-		return -1;
-	}
-	char f_out_buffer[32768];
-	setvbuf(f_out, f_out_buffer, _IOFBF, 32768);
- 
-	// wav_write_header(f_out);
  
 	fseek(f_in1, 0, SEEK_END);
 	file_size1 = ftell(f_in1);
@@ -2140,7 +2139,6 @@ int convertALAW2WAV(const char *fname1, char *fname3, int maxsamplerate) {
 	if(!bitstream_buf1) {
 		syslog(LOG_ERR,"Cannot malloc bitsream_buf1[%ld]", file_size1);
 		fclose(f_in1);
-		fclose(f_out);
 		return 1;
 	}
 	fread(bitstream_buf1, file_size1, 1, f_in1);
@@ -2154,17 +2152,36 @@ int convertALAW2WAV(const char *fname1, char *fname3, int maxsamplerate) {
 		}
 	}
  
-	// wav_update_header(f_out);
- 
 	delete [] bitstream_buf1;
  
-	fclose(f_out);
 	fclose(f_in1);
 
 	return 0;
 }
+
+int convertALAW2WAV(const char *fname1, char *fname3, int maxsamplerate) {
+	FILE *f_out = fopen(fname3, "a"); // THIS HAS TO BE APPEND!
+	if(f_out) {
+		spooldir_file_chmod_own(f_out);
+	} else {
+		syslog(LOG_ERR,"File [%s] cannot be opened for write", fname3);
+		return -1;
+	}
+	char f_out_buffer[32768];
+	setvbuf(f_out, f_out_buffer, _IOFBF, 32768);
  
-int convertULAW2WAV(const char *fname1, char *fname3, int maxsamplerate) {
+	// wav_write_header(f_out);
+ 
+	int rslt = convertALAW2WAV(fname1, f_out, maxsamplerate);
+ 
+	// wav_update_header(f_out);
+ 
+	fclose(f_out);
+
+	return rslt;
+}
+ 
+int convertULAW2WAV(const char *fname1, FILE *f_out, int maxsamplerate) {
 	unsigned char *bitstream_buf1;
 	int16_t buf_out1;
 	unsigned char *p1;
@@ -2182,19 +2199,6 @@ int convertULAW2WAV(const char *fname1, char *fname3, int maxsamplerate) {
 		syslog(LOG_ERR,"File [%s] cannot be opened for read", fname1);
 		return -1;
 	}
-		
-	FILE *f_out = fopen(fname3, "a"); // THIS HAS TO BE APPEND!
-	if(f_out) {
-		spooldir_file_chmod_own(f_out);
-	} else {
-		fclose(f_in1);
-		syslog(LOG_ERR,"File [%s] cannot be opened for write", fname3);
-		return -1;
-	}
-	char f_out_buffer[32768];
-	setvbuf(f_out, f_out_buffer, _IOFBF, 32768);
- 
-	// wav_write_header(f_out);
  
 	fseek(f_in1, 0, SEEK_END);
 	file_size1 = ftell(f_in1);
@@ -2202,15 +2206,13 @@ int convertULAW2WAV(const char *fname1, char *fname3, int maxsamplerate) {
  
 	bitstream_buf1 = new FILE_LINE(1003) unsigned char[file_size1];
 	if(!bitstream_buf1) {
-		fclose(f_in1);
-		fclose(f_out);
 		syslog(LOG_ERR,"Cannot malloc bitsream_buf1[%ld]", file_size1);
+		fclose(f_in1);
 		return 1;
 	}
 	fread(bitstream_buf1, file_size1, 1, f_in1);
 	p1 = bitstream_buf1;
 	f1 = bitstream_buf1 + file_size1;
- 
 	while(p1 < f1) {
 		buf_out1 = ULAW(*p1);
 		p1 += inFrameSize;
@@ -2219,17 +2221,88 @@ int convertULAW2WAV(const char *fname1, char *fname3, int maxsamplerate) {
 		}
 	}
  
-	// wav_update_header(f_out);
- 
-	if(bitstream_buf1)
-		delete [] bitstream_buf1;
+	delete [] bitstream_buf1;
  
-	fclose(f_out);
 	fclose(f_in1);
- 
+
 	return 0;
 }
 
+int convertULAW2WAV(const char *fname1, char *fname3, int maxsamplerate) {
+	FILE *f_out = fopen(fname3, "a"); // THIS HAS TO BE APPEND!
+	if(f_out) {
+		spooldir_file_chmod_own(f_out);
+	} else {
+		syslog(LOG_ERR,"File [%s] cannot be opened for write", fname3);
+		return -1;
+	}
+	char f_out_buffer[32768];
+	setvbuf(f_out, f_out_buffer, _IOFBF, 32768);
+ 
+	// wav_write_header(f_out);
+ 
+	int rslt = convertULAW2WAV(fname1, f_out, maxsamplerate);
+ 
+	// wav_update_header(f_out);
+ 
+	fclose(f_out);
+
+	return rslt;
+}
+
+
+static bool convertG711RawToBuffer(int codec, const char *rawFileName, int maxsamplerate,
+				   u_char **buffer, u_int32_t *length) {
+	FILE *f_in = fopen(rawFileName, "r");
+	if(!f_in) {
+		syslog(LOG_ERR,"File [%s] cannot be opened for read", rawFileName);
+		return(false);
+	}
+	fseek(f_in, 0, SEEK_END);
+	long file_size = ftell(f_in);
+	fseek(f_in, 0, SEEK_SET);
+	if(file_size <= 0) {
+		fclose(f_in);
+		return(true);
+	}
+	u_char *bitstream_buf = new FILE_LINE(0) u_char[file_size];
+	file_size = fread(bitstream_buf, 1, file_size, f_in);
+	fclose(f_in);
+	int repeat = maxsamplerate / 8000;
+	if(codec == PAYLOAD_PCMA) {
+		alaw_init();
+	} else {
+		ulaw_init();
+	}
+	// output length is known - samples are decoded directly to the buffer taken over by cWavMix
+	*length = file_size * repeat * sizeof(int16_t);
+	if(*length) {
+		*buffer = new FILE_LINE(0) u_char[*length];
+		int16_t *pcm = (int16_t*)*buffer;
+		for(long i = 0; i < file_size; i++) {
+			int16_t sample = codec == PAYLOAD_PCMA ? ALAW(bitstream_buf[i]) : ULAW(bitstream_buf[i]);
+			for(int j = 0; j < repeat; j++) {
+				*(pcm++) = sample;
+			}
+		}
+	}
+	delete [] bitstream_buf;
+	return(true);
+}
+
+static bool convertRawToBuffer(int codec, const char *rawFileName, int maxsamplerate,
+			       u_char **buffer, u_int32_t *length, int *samplerate) {
+	*buffer = NULL;
+	*length = 0;
+	switch(codec) {
+	case PAYLOAD_PCMA:
+	case PAYLOAD_PCMU:
+		*samplerate = max(8000, maxsamplerate);
+		return(convertG711RawToBuffer(codec, rawFileName, maxsamplerate, buffer, length));
+	}
+	return(codecDecoders.convertRawToBuffer(codec, rawFileName, buffer, length, samplerate) == 0);
+}
+
 float
 Call::mos_lqo(char *deg, int samplerate) {
 	char buf[4092];
@@ -2305,6 +2378,7 @@ public:
 		cWav(u_int64_t start, unsigned bytes_per_sample, unsigned samplerate);
 		~cWav();
 		bool load(const char *wavFileName, unsigned samplerate_dst);
+		bool set(u_char *buffer, u_int32_t length, unsigned samplerate_dst);
 		u_int64_t getEnd(bool withoutEndSilence) {
 			return(start + 
 			       get_length_samples(withoutEndSilence) * 1000000ull / samplerate);
@@ -2357,7 +2431,10 @@ public:
 	void setStartTime(u_int64_t start_time);
 	bool addWav(const char *wavFileName, u_int64_t start,
 		    unsigned bytes_per_sample = 0, unsigned samplerate = 0);
+	bool addBuffer(u_char *buffer, u_int32_t length, u_int64_t start,
+		       unsigned bytes_per_sample = 0, unsigned samplerate = 0);
 	void mixTo(const char *wavOutFileName, bool withoutEndSilence, bool withoutEndSilenceInRslt);
+	u_char *mixToBuffer(u_int32_t *length, bool withoutEndSilence, bool withoutEndSilenceInRslt);
 private:
 	void mix(bool withoutEndSilence, bool withoutEndSilenceInRslt);
 	void mix(cWav *wav, bool withoutEndSilence);
@@ -2399,47 +2476,48 @@ bool cWavMix::cWav::load(const char *wavFileName, unsigned samplerate_dst) {
 	if(!file) {
 		return(false);
 	}
+	u_char *buffer = new FILE_LINE(0) u_char[fileSize];
+	u_int32_t buffer_pos = 0;
+	u_int32_t readLength;
+	while((readLength = fread(buffer + buffer_pos, 1, min(fileSize - buffer_pos, (u_int32_t)1024 * 16), file)) > 0) {
+		buffer_pos += readLength;
+		if(buffer_pos >= fileSize) {
+			break;
+		}
+	}
+	fclose(file);
+	if(sverb.wavmix) {
+		cout << "load wav " << wavFileName << endl;
+	}
+	return(set(buffer, buffer_pos, samplerate_dst));
+}
+
+bool cWavMix::cWav::set(u_char *buffer, u_int32_t length, unsigned samplerate_dst) {
+	// takes over buffer
 	u_int32_t wav_buffer_pos = 0;
 	unsigned samplerate_orig = samplerate;
 	if(samplerate_dst > samplerate) {
-		u_int32_t wav_buffer_length = (u_int64_t)fileSize * samplerate_dst / samplerate;
+		u_int32_t wav_buffer_length = (u_int64_t)length * samplerate_dst / samplerate;
 		wav_buffer = new FILE_LINE(0) u_char[wav_buffer_length + 100];
-		unsigned read_buffer_length = 16 * 1024;
-		u_char *read_buffer = new FILE_LINE(0) u_char[read_buffer_length];
-		u_int32_t read_pos = 0;
-		u_int32_t readLength;
-		while((readLength = fread(read_buffer, 1, read_buffer_length, file)) > 0) {
-			for(u_int32_t i = 0; i < readLength; i++) {
-				wav_buffer[wav_buffer_pos++] = read_buffer[i];
-				if(!((i + 1) % bytes_per_sample)) {
-					while((u_int64_t)(read_pos + i) * samplerate_dst / samplerate > wav_buffer_pos) {
-						for(int j = bytes_per_sample - 1; j >= 0; j--) {
-							wav_buffer[wav_buffer_pos++] = read_buffer[i - j];
-						}
+		for(u_int32_t i = 0; i < length; i++) {
+			wav_buffer[wav_buffer_pos++] = buffer[i];
+			if(!((i + 1) % bytes_per_sample)) {
+				while((u_int64_t)i * samplerate_dst / samplerate > wav_buffer_pos) {
+					for(int j = bytes_per_sample - 1; j >= 0; j--) {
+						wav_buffer[wav_buffer_pos++] = buffer[i - j];
 					}
 				}
-				if(wav_buffer_pos >= wav_buffer_length) {
-					break;
-				}
 			}
-			read_pos += readLength;
 			if(wav_buffer_pos >= wav_buffer_length) {
 				break;
 			}
 		}
-		delete [] read_buffer;
+		delete [] buffer;
 		samplerate = samplerate_dst;
 	} else {
-		wav_buffer = new FILE_LINE(0) u_char[fileSize];
-		u_int32_t readLength;
-		while((readLength = fread(wav_buffer + wav_buffer_pos, 1, min(fileSize - wav_buffer_pos, (u_int32_t)1024 * 16), file)) > 0) {
-			wav_buffer_pos += readLength;
-			if(wav_buffer_pos >= fileSize) {
-				break;
-			}
-		}
+		wav_buffer = buffer;
+		wav_buffer_pos = length;
 	}
-	fclose(file);
 	if(wav_buffer_pos > 0) {
 		length_samples = wav_buffer_pos / bytes_per_sample;
 	} else {
@@ -2477,8 +2555,7 @@ bool cWavMix::cWav::load(const char *wavFileName, unsigned samplerate_dst) {
 		}
 	}
 	if(sverb.wavmix) {
-		cout << "load wav"
-		     << " " << wavFileName
+		cout << "set wav"
 		     << " start " << start
 		     << " samplerate " << samplerate_orig
 		     << " samplerate_dst " << samplerate_dst
@@ -2533,6 +2610,24 @@ bool cWavMix::addWav(const char *wavFileName, u_int64_t start,
 	}
 }
 
+bool cWavMix::addBuffer(u_char *buffer, u_int32_t length, u_int64_t start,
+			unsigned bytes_per_sample, unsigned samplerate) {
+	if(!length) {
+		delete [] buffer;
+		return(false);
+	}
+	cWav *wav = new FILE_LINE(0) cWav(start,
+					  bytes_per_sample ? bytes_per_sample : this->bytes_per_sample, 
+					  samplerate ? samplerate : this->samplerate);
+	if(wav->set(buffer, length, this->samplerate)) {
+		wavs.push_back(wav);
+		return(true);
+	} else {
+		delete wav;
+		return(false);
+	}
+}
+
 void cWavMix::mixTo(const char *wavOutFileName, bool withoutEndSilence, bool withoutEndSilenceInRslt) {
 	mix(withoutEndSilence, withoutEndSilenceInRslt);
 	if(mix_buffer_length_samples) {
@@ -2548,6 +2643,15 @@ void cWavMix::mixTo(const char *wavOutFileName, bool withoutEndSilence, bool wit
 	}
 }
 
+u_char *cWavMix::mixToBuffer(u_int32_t *length, bool withoutEndSilence, bool withoutEndSilenceInRslt) {
+	mix(withoutEndSilence, withoutEndSilenceInRslt);
+	u_char *buffer = mix_buffer;
+	*length = mix_buffer_length_samples * bytes_per_sample;
+	mix_buffer = NULL;
+	mix_buffer_length_samples = 0;
+	return(buffer);
+}
+
 void cWavMix::mix(bool withoutEndSilence, bool withoutEndSilenceInRslt) {
 	mix_buffer_length_samples = getAllSamples(withoutEndSilenceInRslt);
 	if(!mix_buffer_length_samples) {
@@ -2892,6 +2996,13 @@ Call::convertRawToWav() {
 	}
 
 	int maxsamplerate = 0;
+	
+	/* with wav mix the legs of shorter calls are decoded and mixed in memory - per-leg wav files are not written and read back
+	 * (.raw files of the jitterbuffer are still written during the call - streams are selected only after the call ends) */
+	bool mixInMemory = useWavMix && !opt_mos_lqo &&
+			   opt_saveaudio_inmemory_max_duration > 0 && connect_duration_s() <= (unsigned)opt_saveaudio_inmemory_max_duration;
+	u_char *legBuffer[2] = { NULL, NULL };
+	u_int32_t legBufferLength[2] = { 0, 0 };
 
 	/* get max sample rate */
 	int samplerate = 8000;
@@ -2932,6 +3043,9 @@ Call::convertRawToWav() {
 		pl = fopen(rawInfo, "r");
 		if(!pl) {
 			syslog(LOG_ERR, "Cannot open %s\n", rawInfo);
+			if(legBuffer[0]) {
+				delete [] legBuffer[0];
+			}
 			return 1;
 		}
 		// get max sample rate 
@@ -3023,7 +3137,24 @@ Call::convertRawToWav() {
 			if(wavMix) {
 				unlink(wav);
 			}
-			switch(rawf->codec) {
+			bool decodedInMemory = false;
+			if(mixInMemory &&
+			   (rawf->codec == PAYLOAD_PCMA || rawf->codec == PAYLOAD_PCMU || codecDecoders.isSupported(rawf->codec))) {
+				u_char *buffer;
+				u_int32_t bufferLength;
+				if(convertRawToBuffer(rawf->codec, rawf->filename.c_str(), maxsamplerate, &buffer, &bufferLength, &samplerate)) {
+					decodedInMemory = true;
+					if(buffer) {
+						wavMix->addBuffer(buffer, bufferLength, getTimeUS(rawf->tv), 0, samplerate);
+					}
+				}
+			}
+			bool decodedInProcess = decodedInMemory;
+			if(!decodedInProcess && codecDecoders.isSupported(rawf->codec)) {
+				if(verbosity > 1) syslog(LOG_ERR, "Converting %s to WAV in-process ssrc[%x] wav[%s] index[%u]\n", codec2text(rawf->codec), rtp_stream_by_index(rawf->ssrc_index)->ssrc, wav, rawf->ssrc_index);
+				decodedInProcess = codecDecoders.convertRawToWav(rawf->codec, rawf->filename.c_str(), wav, &samplerate) == 0;
+			}
+			if(!decodedInProcess) switch(rawf->codec) {
 			case PAYLOAD_PCMA:
 				if(verbosity > 1) syslog(LOG_ERR, "Converting PCMA to WAV ssrc[%x] wav[%s] index[%u]\n", rtp_stream_by_index(rawf->ssrc_index)->ssrc, wav, rawf->ssrc_index);
 				convertALAW2WAV(rawf->filename.c_str(), wav, maxsamplerate);
@@ -3387,14 +3518,19 @@ Call::convertRawToWav() {
 			}
 			if(!sverb.noaudiounlink) unlink(rawf->filename.c_str());
 			
-			if(wavMix && file_exists(wav)) {
+			if(wavMix && !decodedInMemory && file_exists(wav)) {
 				wavMix->addWav(wav, getTimeUS(rawf->tv), 0, samplerate);
 			}
 		}
 		if(!sverb.noaudiounlink) unlink(rawInfo);
 		
 		if(wavMix) {
-			wavMix->mixTo(wav, true, false);
+			if(mixInMemory) {
+				legBuffer[i] = wavMix->mixToBuffer(&legBufferLength[i], true, false);
+				if(!sverb.noaudiounlink) unlink(wav);
+			} else {
+				wavMix->mixTo(wav, true, false);
+			}
 			delete wavMix;
 			wavMix = NULL;
 		}
@@ -3408,7 +3544,46 @@ Call::convertRawToWav() {
 
 	}
 
-	if(adir == 1 && bdir == 1) {
+	if(mixInMemory) {
+		FILE *legFile[2] = { NULL, NULL };
+		for(int i = 0; i < 2; i++) {
+			if(legBuffer[i] && legBufferLength[i]) {
+				legFile[i] = fmemopen(legBuffer[i], legBufferLength[i], "r");
+			}
+		}
+		FILE *in1 = NULL;
+		FILE *in2 = NULL;
+		int swap = 0;
+		if(legFile[0] && legFile[1]) {
+			// merge caller and called 
+			in1 = legFile[opt_saveaudio_reversestereo ? 1 : 0];
+			in2 = legFile[opt_saveaudio_reversestereo ? 0 : 1];
+		} else if(legFile[0]) {
+			// there is only caller sound
+			in1 = legFile[0];
+		} else if(legFile[1]) {
+			// there is only called sound
+			in1 = legFile[1];
+			swap = 1;
+		}
+		if(in1) {
+			if(!(flags & FLAG_FORMATAUDIO_OGG)) {
+				wav_mix(in1, in2, out, maxsamplerate, swap, opt_saveaudio_stereo);
+			} else {
+				ogg_mix(in1, in2, out, opt_saveaudio_stereo, maxsamplerate, opt_saveaudio_oggquality, swap);
+			}
+		} else {
+			syslog(LOG_ERR, "PCAP file %s cannot be decoded to WAV - no audio data\n", get_pathfilename(tsf_sip).c_str());
+		}
+		for(int i = 0; i < 2; i++) {
+			if(legFile[i]) {
+				fclose(legFile[i]);
+			}
+			if(legBuffer[i]) {
+				delete [] legBuffer[i];
+			}
+		}
+	} else if(adir == 1 && bdir == 1) {
 		// merge caller and called 
 		if(!(flags & FLAG_FORMATAUDIO_OGG)) {
 			if(!opt_saveaudio_reversestereo) {
@@ -3451,6 +3626,151 @@ Call::convertRawToWav() {
 	return 0;
 }
 
+/* synthetic g711 streams (caller: pcma with second overlapping stream, called: pcmu starting later) are decoded
+ * and mixed by both paths of convertRawToWav - per-leg wav files (cWavMix::addWav / mixTo, wav_mix / ogg_mix by file name)
+ * and memory (convertRawToBuffer, cWavMix::addBuffer / mixToBuffer, wav_mix / ogg_mix by FILE*) - output must be identical;
+ * ogg encoder gets the same stream serial (random()) in both paths */
+bool Call::convertRawToWavMixInMemoryTest() {
+	bool ok = true;
+	string dir = "/tmp/voipmonitor_mix_test_" + intToString(getpid());
+	mkdir(dir.c_str(), 0700);
+	struct sRaw {
+		int leg;
+		int codec;
+		u_int64_t start_us;
+		unsigned samples;
+	} raws[] = {
+		{ 0, PAYLOAD_PCMA, 1600000000000000ull, 8000 * 3 },
+		{ 0, PAYLOAD_PCMA, 1600000000000000ull + 2500000, 8000 * 2 },
+		{ 1, PAYLOAD_PCMU, 1600000000000000ull + 200000, 8000 * 4 }
+	};
+	unsigned raws_count = sizeof(raws) / sizeof(raws[0]);
+	u_int32_t rnd = 1;
+	for(unsigned i = 0; i < raws_count; i++) {
+		FILE *raw = fopen((dir + "/" + intToString(i) + ".raw").c_str(), "w");
+		if(!raw) {
+			cout << "mix in memory test: cannot create " << dir << endl;
+			return(false);
+		}
+		for(unsigned j = 0; j < raws[i].samples; j++) {
+			// tone with noise, silence (0xD5 / 0xFF) at the end of stream
+			rnd = rnd * 1103515245 + 12345;
+			u_char sample = j >= raws[i].samples - 800 ? 
+					 (raws[i].codec == PAYLOAD_PCMA ? 0xD5 : 0xFF) :
+					 (u_char)((j % 20 < 10 ? 0x20 : 0xA0) + (j % 10) + ((rnd >> 16) & 3));
+			fputc(sample, raw);
+		}
+		fclose(raw);
+	}
+	int samplerates[] = { 8000, 16000 };
+	for(unsigned samplerate_i = 0; samplerate_i < sizeof(samplerates) / sizeof(samplerates[0]); samplerate_i++) {
+		int maxsamplerate = samplerates[samplerate_i];
+		string legWav[2];
+		u_char *legBuffer[2] = { NULL, NULL };
+		u_int32_t legBufferLength[2] = { 0, 0 };
+		for(int leg = 0; leg < 2; leg++) {
+			legWav[leg] = dir + "/leg" + intToString(leg) + ".wav";
+			string wav = dir + "/tmp.wav";
+			for(int inMemory = 0; inMemory < 2; inMemory++) {
+				cWavMix *wavMix = new FILE_LINE(0) cWavMix(2, maxsamplerate);
+				wavMix->setStartTime(raws[0].start_us);
+				for(unsigned i = 0; i < raws_count; i++) {
+					if(raws[i].leg != leg) {
+						continue;
+					}
+					string rawFileName = dir + "/" + intToString(i) + ".raw";
+					int samplerate = max(8000, maxsamplerate);
+					if(inMemory) {
+						u_char *buffer;
+						u_int32_t bufferLength;
+						if(convertRawToBuffer(raws[i].codec, rawFileName.c_str(), maxsamplerate, &buffer, &bufferLength, &samplerate) && buffer) {
+							wavMix->addBuffer(buffer, bufferLength, raws[i].start_us, 0, samplerate);
+						}
+					} else {
+						unlink(wav.c_str());
+						if(raws[i].codec == PAYLOAD_PCMA) {
+							convertALAW2WAV(rawFileName.c_str(), (char*)wav.c_str(), maxsamplerate);
+						} else {
+							convertULAW2WAV(rawFileName.c_str(), (char*)wav.c_str(), maxsamplerate);
+						}
+						wavMix->addWav(wav.c_str(), raws[i].start_us, 0, samplerate);
+					}
+				}
+				if(inMemory) {
+					legBuffer[leg] = wavMix->mixToBuffer(&legBufferLength[leg], true, false);
+				} else {
+					wavMix->mixTo(legWav[leg].c_str(), true, false);
+				}
+				delete wavMix;
+			}
+			unlink(wav.c_str());
+		}
+		for(int ogg = 0; ogg < 2; ogg++) {
+			for(int onlyCalled = 0; onlyCalled < 2; onlyCalled++) {
+				string out[2];
+				for(int inMemory = 0; inMemory < 2; inMemory++) {
+					out[inMemory] = dir + "/out" + intToString(inMemory) + (ogg ? ".ogg" : ".wav");
+					unlink(out[inMemory].c_str());
+					srandom(1);
+					if(inMemory) {
+						FILE *legFile[2] = { NULL, NULL };
+						for(int leg = 0; leg < 2; leg++) {
+							legFile[leg] = fmemopen(legBuffer[leg], legBufferLength[leg], "r");
+						}
+						FILE *in1 = onlyCalled ? legFile[1] : legFile[0];
+						FILE *in2 = onlyCalled ? NULL : legFile[1];
+						if(!ogg) {
+							wav_mix(in1, in2, (char*)out[inMemory].c_str(), maxsamplerate, onlyCalled, 1);
+						} else {
+							ogg_mix(in1, in2, (char*)out[inMemory].c_str(), 1, maxsamplerate, 0.4, onlyCalled);
+						}
+						for(int leg = 0; leg < 2; leg++) {
+							fclose(legFile[leg]);
+						}
+					} else {
+						char *in1 = (char*)legWav[onlyCalled ? 1 : 0].c_str();
+						char *in2 = onlyCalled ? NULL : (char*)legWav[1].c_str();
+						if(!ogg) {
+							wav_mix(in1, in2, (char*)out[inMemory].c_str(), maxsamplerate, onlyCalled, 1);
+						} else {
+							ogg_mix(in1, in2, (char*)out[inMemory].c_str(), 1, maxsamplerate, 0.4, onlyCalled);
+						}
+					}
+				}
+				long long size[2] = { GetFileSize(out[0]), GetFileSize(out[1]) };
+				bool identical = size[0] > 0 && size[0] == size[1];
+				if(identical) {
+					FILE *file[2] = { fopen(out[0].c_str(), "r"), fopen(out[1].c_str(), "r") };
+					int c0, c1;
+					do {
+						c0 = fgetc(file[0]);
+						c1 = fgetc(file[1]);
+					} while(c0 == c1 && c0 != EOF);
+					identical = c0 == c1;
+					fclose(file[0]);
+					fclose(file[1]);
+				}
+				cout << (ogg ? "ogg" : "wav") << " " << maxsamplerate << "Hz " << (onlyCalled ? "called only" : "both legs")
+				     << ": files " << size[0] << " B, memory " << size[1] << " B - " << (identical ? "identical" : "DIFFER") << endl;
+				if(!identical) {
+					ok = false;
+				}
+				unlink(out[0].c_str());
+				unlink(out[1].c_str());
+			}
+		}
+		for(int leg = 0; leg < 2; leg++) {
+			unlink(legWav[leg].c_str());
+			delete [] legBuffer[leg];
+		}
+	}
+	for(unsigned i = 0; i < raws_count; i++) {
+		unlink((dir + "/" + intToString(i) + ".raw").c_str());
+	}
+	rmdir(dir.c_str());
+	return(ok);
+}
+
 bool Call::selectRtpStreams() {
 	for(int i = 0; i < rtp_size(); i++) { RTP *rtp_i = rtp_stream_by_index(i);
 		rtp_i->skip = false;
@@ -3762,21 +4082,68 @@ bool Call::existsBothDirectionsInSelectedRtpStream() {
 }
 
 void Call::removeCallIdMap() {
-	if(opt_call_id_alternative[0]) {
-		map<string, Call*>::iterator callMAPIT;
-		callMAPIT = ((Calltable*)calltable)->calls_listMAP.find(call_id);
-		if(callMAPIT != ((Calltable*)calltable)->calls_listMAP.end()) {
-			((Calltable*)calltable)->calls_listMAP.erase(callMAPIT);
+	cCallIdIndex *index = &((Calltable*)calltable)->calls_callid_index;
+	index->remove_lock(call_id.c_str(), call_id.length(), call_id_hash, this);
+	if(call_id_alternative) {
+		for(map<string, bool>::iterator iter = call_id_alternative->begin(); iter != call_id_alternative->end(); iter++) {
+			index->remove_lock(iter->first.c_str(), iter->first.length(), cCallIdIndex::hash(iter->first.c_str(), iter->first.length()), this);
 		}
-		if(call_id_alternative) {
-			for(map<string, bool>::iterator iter = call_id_alternative->begin(); iter != call_id_alternative->end(); iter++) {
-				callMAPIT = ((Calltable*)calltable)->calls_listMAP.find(iter->first);
-				if(callMAPIT != ((Calltable*)calltable)->calls_listMAP.end()) {
-					((Calltable*)calltable)->calls_listMAP.erase(callMAPIT);
-				}
+	}
+}
+
+void Call::cleanup_timer_shift(u_int32_t time_s) {
+	// pair with __sync_synchronize in cleanup_* - either cleanup sees the new deadline or we see processing state
+	__sync_synchronize();
+	if(cleanup_timer.state == sTimerWheelNode::_tws_none ||
+	   (cleanup_timer.state == sTimerWheelNode::_tws_linked && cleanup_timer.expire <= time_s)) {
+		return;
+	}
+	cTimerWheel *timer = typeIs(REGISTER) ?
+			      &((Calltable*)calltable)->registers_cleanup_timer :
+			      &((Calltable*)calltable)->calls_cleanup_timer;
+	timer->lock();
+	timer->shift(&cleanup_timer, time_s);
+	timer->unlock();
+}
+
+/* the earliest time when cleanup_calls / cleanup_registers can close the call
+ * - packet activity only moves it later, so the timer fires at this bound and the call is rescheduled if still alive
+*/
+u_int32_t Call::getCleanupAt() {
+	if(force_close) {
+		return(0);
+	}
+	u_int32_t first_packet_time_s = get_first_packet_time_s();
+	u_int32_t cleanup_at = first_packet_time_s + absolute_timeout + 1;
+	#define CLEANUP_AT_MIN(time_s) { u_int32_t _time_s = time_s; if(_time_s < cleanup_at) cleanup_at = _time_s; }
+	if(destroy_call_at) {
+		CLEANUP_AT_MIN(destroy_call_at);
+	}
+	if(typeIs(REGISTER)) {
+		if(!seenRES18X && !seenRES2XX) {
+			CLEANUP_AT_MIN(first_packet_time_s + 301);
+		}
+	} else {
+		if(destroy_call_at_bye) {
+			CLEANUP_AT_MIN(destroy_call_at_bye);
+		}
+		if(destroy_call_at_bye_confirmed) {
+			CLEANUP_AT_MIN(destroy_call_at_bye_confirmed);
+		}
+		if(first_rtp_time_us) {
+			CLEANUP_AT_MIN(get_last_packet_time_s() + rtptimeout + 1);
+		} else {
+			CLEANUP_AT_MIN(first_packet_time_s + sipwithoutrtptimeout + 1);
+			if(!seenRES18X && !seenRES2XX) {
+				CLEANUP_AT_MIN(first_packet_time_s + 301);
 			}
 		}
 	}
+	if(oneway == 1) {
+		CLEANUP_AT_MIN(get_last_packet_time_s() + opt_onewaytimeout + 1);
+	}
+	#undef CLEANUP_AT_MIN
+	return(cleanup_at);
 }
 
 void Call::removeMergeCalls() {
@@ -8588,10 +8955,18 @@ void Ss7::pushToQueue(string *ss7_id) {
 	if(ss7_id) {
 		calltable->lock_ss7_listMAP();
 		calltable->ss7_listMAP.erase(*ss7_id);
+		calltable->cleanup_timer_remove(&calltable->ss7_cleanup_timer, this);
 		calltable->unlock_ss7_listMAP();
 	}
 }
 
+u_int32_t Ss7::getCleanupAt() {
+	if(last_message_type == rlc) {
+		return(0);
+	}
+	return(TIME_US_TO_S(last_time_us) + absolute_timeout + 1);
+}
+
 int Ss7::saveToDb(bool enableBatchIfPossible) {
 	if(!sqlDbSaveSs7) {
 		sqlDbSaveSs7 = createSqlObject();
@@ -8945,6 +9320,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 				       opt_sdp_multiplication);
 				call->syslog_sdp_multiplication = true;
 			}
+			cRtpHashCache::bump(addr, port);
 			if (useLock) unlock_calls_hash();
 			return;
 		}
@@ -8957,6 +9333,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 		++call->rtp_ip_port_counter;
 		call->rtp_ip_port_list.push_back(vmIPport(addr, port));
 	}
+	cRtpHashCache::bump(addr, port);
 	if (useLock) unlock_calls_hash();
 	
 	#else
@@ -9040,6 +9417,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 				       opt_sdp_multiplication);
 				call->syslog_sdp_multiplication = true;
 			}
+			cRtpHashCache::bump(addr, port);
 			if (useLock) unlock_calls_hash();
 			return;
 		}
@@ -9069,6 +9447,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 		++call->rtp_ip_port_counter;
 		call->rtp_ip_port_list.push_back(vmIPport(addr, port));
 	}
+	cRtpHashCache::bump(addr, port);
 	if (useLock) unlock_calls_hash();
 	
 	#endif
@@ -9139,6 +9518,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 				       opt_sdp_multiplication);
 				call->syslog_sdp_multiplication = true;
 			}
+			cRtpHashCache::bump(addr, port);
 			if (useLock) unlock_calls_hash();
 			return;
 		}
@@ -9153,6 +9533,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 		*n_call_ptr = n_call;
 		++call->rtp_ip_port_counter;
 	}
+	cRtpHashCache::bump(addr, port);
 	if (useLock) unlock_calls_hash();
 	
 	
@@ -9208,6 +9589,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 				       opt_sdp_multiplication);
 				call->syslog_sdp_multiplication = true;
 			}
+			cRtpHashCache::bump(addr, port);
 			if (useLock) unlock_calls_hash();
 			return;
 		}
@@ -9219,6 +9601,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 		n_call_rtp->push_back(call_new);
 		++call->rtp_ip_port_counter;
 	}
+	cRtpHashCache::bump(addr, port);
 	if (useLock) unlock_calls_hash();
 	
 #else 
@@ -9276,6 +9659,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 							       opt_sdp_multiplication);
 							call->syslog_sdp_multiplication = true;
 						}
+						cRtpHashCache::bump(addr, port);
 						if (useLock) unlock_calls_hash();
 						return;
 					}
@@ -9357,6 +9741,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 									lastTimeSyslog = actTime;
 								}
 							}
+							cRtpHashCache::bump(addr, port);
 							if (useLock) unlock_calls_hash();
 							return;
 						}
@@ -9375,6 +9760,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 					}
 				}
 			#endif
+			cRtpHashCache::bump(addr, port);
 			if (useLock) unlock_calls_hash();
 			return;
 		}
@@ -9411,6 +9797,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 		calls_hash[h] = node;
 	#endif
 	++call->rtp_ip_port_counter;
+	cRtpHashCache::bump(addr, port);
 	if (useLock) unlock_calls_hash();
 	
 #endif
@@ -9494,6 +9881,7 @@ Calltable::_hashRemove(Call *call, vmIP addr, vmPort port, bool rtcp, bool use_l
 			}
 		}
 	}
+	cRtpHashCache::bump(addr, port);
 	if (use_lock) unlock_calls_hash();
 	return(removeCounter);
 	
@@ -9543,6 +9931,7 @@ Calltable::_hashRemove(Call *call, vmIP addr, vmPort port, bool rtcp, bool use_l
 			n_prev = n_call;
 		}
 	}
+	cRtpHashCache::bump(addr, port);
 	if (use_lock) unlock_calls_hash();
 	return(removeCounter);
 	
@@ -9579,6 +9968,7 @@ Calltable::_hashRemove(Call *call, vmIP addr, vmPort port, bool rtcp, bool use_l
 			n_prev = n_call;
 		}
 	}
+	cRtpHashCache::bump(addr, port);
 	if (use_lock) unlock_calls_hash();
 	return(removeCounter);
 	
@@ -9606,6 +9996,7 @@ Calltable::_hashRemove(Call *call, vmIP addr, vmPort port, bool rtcp, bool use_l
 			calls_ip_port.erase(iter);
 		}
 	}
+	cRtpHashCache::bump(addr, port);
 	if (use_lock) unlock_calls_hash();
 	return(removeCounter);
 		
@@ -9672,6 +10063,7 @@ Calltable::_hashRemove(Call *call, vmIP addr, vmPort port, bool rtcp, bool use_l
 		}
 		prev = node;
 	}
+	cRtpHashCache::bump(addr, port);
 	if (use_lock) unlock_calls_hash();
 	return(removeCounter);
 	
@@ -9791,6 +10183,7 @@ Calltable::_hashRemove(Call *call, bool use_lock) {
 			}
 		}
 	}
+	cRtpHashCache::bumpAll();
 	if (use_lock) unlock_calls_hash();
 	return(removeCounter);
 
@@ -9798,6 +10191,41 @@ Calltable::_hashRemove(Call *call, bool use_lock) {
 	
 }
 
+bool
+Calltable::hashfind_by_ip_port_to_cache(sRtpHashCacheItem *item) {
+	node_call_rtp *n_call = NULL;
+	if((n_call = hashfind_by_ip_port(item->daddr, item->dport, false))) {
+		item->find_by_dest = true;
+	} else {
+		n_call = hashfind_by_ip_port(item->saddr, item->sport, false);
+	}
+	vmIP other_addr = item->find_by_dest ? item->saddr : item->daddr;
+	vmPort other_port = item->find_by_dest ? item->sport : item->dport;
+	if(n_call) {
+		#if (NEW_RTP_FIND__NODES && NEW_RTP_FIND__NODES__LIST) || HASH_RTP_FIND__LIST || NEW_RTP_FIND__MAP_LIST
+		for(list<call_rtp*>::iterator iter = n_call->begin(); iter != n_call->end(); iter++) {
+			call_rtp *call_rtp = *iter;
+		#else
+		for(; n_call; n_call = n_call->next) {
+			call_rtp *call_rtp = n_call;
+		#endif
+			if(item->calls_count == RTP_HASH_CACHE_MAX_CALLS) {
+				return(false);
+			}
+			sRtpHashCacheCall *cache_call = &item->calls[item->calls_count++];
+			cache_call->call = call_rtp->call;
+			cache_call->iscaller = call_rtp->iscaller;
+			cache_call->is_rtcp = call_rtp->is_rtcp;
+			cache_call->sdp_flags = call_rtp->sdp_flags;
+			cache_call->other_side_in_hash = check_call_in_hashfind_by_ip_port(call_rtp->call, other_addr, other_port, false);
+			s_sdp_flags *sdp_flags_other_side = get_sdp_flags_in_hashfind_by_ip_port(call_rtp->call, other_addr, other_port, false);
+			cache_call->other_side_rtcp_mux = sdp_flags_other_side && sdp_flags_other_side->rtcp_mux;
+		}
+	}
+	item->used = true;
+	return(true);
+}
+
 void 
 Calltable::applyHashModifyQueue(struct timeval *ts, bool setBegin, bool use_lock_calls_hash) {
 	_applyHashModifyQueue(ts, setBegin, use_lock_calls_hash);
@@ -10344,27 +10772,20 @@ Calltable::getCallTableJson(char *params, bool *zip) {
 	unsigned int now = time(NULL);
 	calltable->lock_calls_listMAP();
 	list<Call*>::iterator callIT1;
-	map<string, Call*>::iterator callMAPIT1;
 	map<sStreamIds2, Call*>::iterator callMAPIT2;
 	for(int passTypeCall = 0; passTypeCall < 2; passTypeCall++) {
 		int typeCall = passTypeCall == 0 ? INVITE : MGCP;
 		if(typeCall == INVITE) {
-			if(opt_call_id_alternative[0]) {
-				callIT1 = calltable->calls_list.begin();
-			} else {
-				callMAPIT1 = calltable->calls_listMAP.begin();
-			}
+			callIT1 = calltable->calls_list.begin();
 		} else {
 			callMAPIT2 = calltable->calls_by_stream_callid_listMAP.begin();
 		}
 		while(typeCall == INVITE ? 
-		       (opt_call_id_alternative[0] ?
-			 callIT1 != calltable->calls_list.end() :
-			 callMAPIT1 != calltable->calls_listMAP.end()) : 
+		       callIT1 != calltable->calls_list.end() : 
 		       callMAPIT2 != calltable->calls_by_stream_callid_listMAP.end()) {
 			Call *call;
 			if(typeCall == INVITE) {
-				call = opt_call_id_alternative[0] ? *callIT1 : callMAPIT1->second;
+				call = *callIT1;
 			} else {
 				call = (*callMAPIT2).second;
 			}
@@ -10432,11 +10853,7 @@ Calltable::getCallTableJson(char *params, bool *zip) {
 				}
 			}
 			if(typeCall == INVITE) {
-				if(opt_call_id_alternative[0]) {
-					++callIT1;
-				} else {
-					++callMAPIT1;
-				}
+				++callIT1;
 			} else {
 				++callMAPIT2;
 			}
@@ -10544,18 +10961,28 @@ Calltable::add(int call_type, char *call_id, unsigned long call_id_len, vector<s
 	string call_idS = call_id_len ? string(call_id, call_id_len) : string(call_id);
 	if(call_type == REGISTER) {
 		lock_registers_listMAP();
-		registers_listMAP[call_idS] = newcall;
+		map<string, Call*>::iterator registerMAPIT = registers_listMAP.find(call_idS);
+		if(registerMAPIT != registers_listMAP.end()) {
+			cleanup_timer_remove(&registers_cleanup_timer, registerMAPIT->second);
+			registerMAPIT->second = newcall;
+		} else {
+			registers_listMAP[call_idS] = newcall;
+		}
+		cleanup_timer_add(&registers_cleanup_timer, newcall, newcall->getCleanupAt());
 		registers_counter++;
 		unlock_registers_listMAP();
 	} else {
 		lock_calls_listMAP();
-		calls_listMAP[call_idS] = newcall;
-		if(opt_call_id_alternative[0]) {
-			calls_list.push_back(newcall);
-			if(call_id_alternative) {
-				for(unsigned i = 0; i < call_id_alternative->size(); i++) {
-					calls_listMAP[(*call_id_alternative)[i]] = newcall;
-				}
+		calls_list.push_back(newcall);
+		newcall->calls_list_iter = --calls_list.end();
+		newcall->in_calls_list = true;
+		cleanup_timer_add(&calls_cleanup_timer, newcall, newcall->getCleanupAt());
+		calls_callid_index.add_lock(newcall->call_id.c_str(), newcall->call_id.length(), newcall->call_id_hash, newcall);
+		if(opt_call_id_alternative[0] && call_id_alternative) {
+			for(unsigned i = 0; i < call_id_alternative->size(); i++) {
+				calls_callid_index.add_lock((*call_id_alternative)[i].c_str(), (*call_id_alternative)[i].length(),
+							    cCallIdIndex::hash((*call_id_alternative)[i].c_str(), (*call_id_alternative)[i].length()),
+							    newcall);
 			}
 		}
 		newcall->calls_counter_inc();
@@ -10572,7 +10999,14 @@ Calltable::add_ss7(packet_s_stack *packetS, Ss7::sParseData *data) {
 	newss7->processData(packetS, data);
 	string ss7_id = data->ss7_id();
 	lock_ss7_listMAP();
-	ss7_listMAP[ss7_id] = newss7;
+	map<string, Ss7*>::iterator ss7MAPIT = ss7_listMAP.find(ss7_id);
+	if(ss7MAPIT != ss7_listMAP.end()) {
+		cleanup_timer_remove(&ss7_cleanup_timer, ss7MAPIT->second);
+		ss7MAPIT->second = newss7;
+	} else {
+		ss7_listMAP[ss7_id] = newss7;
+	}
+	cleanup_timer_add(&ss7_cleanup_timer, newss7, newss7->getCleanupAt());
 	unlock_ss7_listMAP();
 	return(newss7);
 }
@@ -10603,7 +11037,14 @@ Calltable::add_mgcp(sMgcpRequest *request, time_t time, vmIP saddr, vmPort sport
 	set_global_flags(newcall->flags);
 	
 	lock_calls_listMAP();
-	calls_by_stream_callid_listMAP[sStreamIds2(saddr, sport, daddr, dport, request->parameters.call_id.c_str(), true)] = newcall;
+	map<sStreamIds2, Call*>::iterator callMAPIT = calls_by_stream_callid_listMAP.find(sStreamIds2(saddr, sport, daddr, dport, request->parameters.call_id.c_str(), true));
+	if(callMAPIT != calls_by_stream_callid_listMAP.end()) {
+		cleanup_timer_remove(&calls_cleanup_timer, callMAPIT->second);
+		callMAPIT->second = newcall;
+	} else {
+		calls_by_stream_callid_listMAP[sStreamIds2(saddr, sport, daddr, dport, request->parameters.call_id.c_str(), true)] = newcall;
+	}
+	cleanup_timer_add(&calls_cleanup_timer, newcall, newcall->getCleanupAt());
 	calls_by_stream_id2_listMAP[sStreamId2(saddr, sport, daddr, dport, request->transaction_id, true)] = newcall;
 	calls_by_stream_listMAP[sStreamId(saddr, sport, daddr, dport, true)] = newcall;
 	newcall->calls_counter_inc();
@@ -10644,118 +11085,122 @@ Calltable::cleanup_calls( struct timeval *currtime, bool forceClose, const char
 	}
 	Call* call;
 	lock_calls_listMAP();
-	Call **closeCalls = new FILE_LINE(1012) Call*[calls_list_count() + calls_by_stream_callid_listMAP.size()];
+	Call **closeCalls;
 	unsigned int closeCalls_count = 0;
 	int rejectedCalls_count = 0;
 	
-	list<Call*>::iterator callIT1;
-	map<string, Call*>::iterator callMAPIT1;
-	map<sStreamIds2, Call*>::iterator callMAPIT2;
-	for(int passTypeCall = 0; passTypeCall < 2; passTypeCall++) {
-		int typeCall = passTypeCall == 0 ? INVITE : MGCP;
-		if(typeCall == INVITE) {
-			if(opt_call_id_alternative[0]) {
-				callIT1 = calls_list.begin();
-			} else {
-				callMAPIT1 = calls_listMAP.begin();
-			}
-		} else {
-			callMAPIT2 = calls_by_stream_callid_listMAP.begin();
-		}
-		while(typeCall == INVITE ? 
-		       (opt_call_id_alternative[0] ?
-			 callIT1 != calltable->calls_list.end() :
-			 callMAPIT1 != calltable->calls_listMAP.end()) : 
-		       callMAPIT2 != calltable->calls_by_stream_callid_listMAP.end()) {
-			if(typeCall == INVITE) {
-				call = opt_call_id_alternative[0] ? *callIT1 : callMAPIT1->second;
-			} else {
-				call = (*callMAPIT2).second;
-			}
-			if(verbosity > 2) {
-				call->dump();
-			}
-			if(verbosity && verbosityE > 1) {
-				syslog(LOG_NOTICE, "Calltable::cleanup - try callid %s", call->call_id.c_str());
-			}
-			// rtptimeout seconds of inactivity will save this call and remove from call table
-			bool closeCall = false;
-			if(!currtime || call->force_close) {
-				closeCall = true;
-				if(!is_read_from_file()) {
-					call->force_terminate = true;
-				}
-			} else if(call->typeIs(SKINNY_NEW) ||
-				  call->typeIs(MGCP) ||
-				  call->in_preprocess_queue_before_process_packet <= 0 ||
-				  (!is_read_from_file() &&
-				   (call->in_preprocess_queue_before_process_packet_at[0] && call->in_preprocess_queue_before_process_packet_at[0] < currtime->tv_sec - 300 &&
-				    call->in_preprocess_queue_before_process_packet_at[1] && call->in_preprocess_queue_before_process_packet_at[1] < (getTimeMS_rdtsc() / 1000) - 300))) {
-				if(call->destroy_call_at != 0 && call->destroy_call_at <= currtime->tv_sec) {
-					closeCall = true;
-				} else if((call->destroy_call_at_bye != 0 && call->destroy_call_at_bye <= currtime->tv_sec) ||
-					  (call->destroy_call_at_bye_confirmed != 0 && call->destroy_call_at_bye_confirmed <= currtime->tv_sec)) {
-					closeCall = true;
-					call->bye_timeout_exceeded = true;
-				} else if(call->first_rtp_time_us &&
-					  currtime->tv_sec - call->get_last_packet_time_s() > rtptimeout) {
-					closeCall = true;
-					call->rtp_timeout_exceeded = true;
-				} else if(!call->first_rtp_time_us &&
-					  currtime->tv_sec - call->get_first_packet_time_s() > sipwithoutrtptimeout) {
-					closeCall = true;
-					call->sipwithoutrtp_timeout_exceeded = true;
-				} else if(currtime->tv_sec - call->get_first_packet_time_s() > absolute_timeout) {
-					closeCall = true;
-					call->absolute_timeout_exceeded = true;
-				} else if(currtime->tv_sec - call->get_first_packet_time_s() > 300 &&
-					  !call->seenRES18X && !call->seenRES2XX && !call->first_rtp_time_us) {
-					closeCall = true;
-					call->zombie_timeout_exceeded = true;
-				}
-				if(!closeCall &&
-				   (call->oneway == 1 && (currtime->tv_sec - call->get_last_packet_time_s() > opt_onewaytimeout))) {
-					closeCall = true;
-					call->oneway_timeout_exceeded = true;
-				}
-			}
-			if(closeCall) {
-				++call->attemptsClose;
-				call->removeFindTables(currtime, true);
-				if((currtime || !forceClose) &&
-				   ((opt_hash_modify_queue_length_ms && call->hash_queue_counter > 0) ||
-				    call->rtppacketsinqueue != 0)) {
-					closeCall = false;
-					++rejectedCalls_count;
-				}
-			}
-			if(closeCall) {
+	if(currtime && !forceClose && opt_cleanup_timer_wheel) {
+		// only calls whose timer expired - the rest of the table is not touched
+		vector<sTimerWheelNode*> expired;
+		calls_cleanup_timer.lock();
+		calls_cleanup_timer.advance(currtime->tv_sec, &expired);
+		calls_cleanup_timer.unlock();
+		__sync_synchronize();
+		closeCalls = new FILE_LINE(0) Call*[expired.size() + 1];
+		for(unsigned i = 0; i < expired.size(); i++) {
+			call = (Call*)expired[i]->owner;
+			u_int64_t call_id_hash_lock = 0;
+			if(call->in_calls_list && !opt_call_id_alternative[0]) {
+				call_id_hash_lock = call->call_id_hash;
+				calls_callid_index.lock(call_id_hash_lock);
+			}
+			if(cleanup_calls_check_close(call, currtime, forceClose, &rejectedCalls_count)) {
+				cleanup_timer_remove(&calls_cleanup_timer, call);
 				if(call->listening_worker_run) {
 					*call->listening_worker_run = 0;
 				}
 				closeCalls[closeCalls_count++] = call;
-				if(typeCall == INVITE) {
-					if(opt_call_id_alternative[0]) {
-						calls_list.erase(callIT1++);
-						call->removeCallIdMap();
+				if(call->in_calls_list) {
+					calls_list.erase(call->calls_list_iter);
+					call->in_calls_list = false;
+					if(call_id_hash_lock) {
+						calls_callid_index.remove(call->call_id.c_str(), call->call_id.length(), call->call_id_hash, call);
+						calls_callid_index.unlock(call_id_hash_lock);
+						call_id_hash_lock = 0;
 					} else {
-						calls_listMAP.erase(callMAPIT1++);
+						call->removeCallIdMap();
 					}
 					call->removeMergeCalls();
 				} else {
-					calls_by_stream_callid_listMAP.erase(callMAPIT2++);
+					map<sStreamIds2, Call*>::iterator callMAPIT2 = calls_by_stream_callid_listMAP.find(sStreamIds2(call->saddr, call->sport, call->daddr, call->dport, call->mgcp_callid.c_str(), true));
+					if(callMAPIT2 == calls_by_stream_callid_listMAP.end() || callMAPIT2->second != call) {
+						// call-id can be changed to undup variant (CRCX with existing call-id)
+						for(callMAPIT2 = calls_by_stream_callid_listMAP.begin(); callMAPIT2 != calls_by_stream_callid_listMAP.end(); callMAPIT2++) {
+							if(callMAPIT2->second == call) {
+								break;
+							}
+						}
+					}
+					if(callMAPIT2 != calls_by_stream_callid_listMAP.end()) {
+						calls_by_stream_callid_listMAP.erase(callMAPIT2);
+					}
 					mgcpCleanupTransactions(call);
 					mgcpCleanupStream(call);
 				}
 			} else {
+				cleanup_timer_relink(&calls_cleanup_timer, call, call->getCleanupAt(), currtime->tv_sec);
+			}
+			if(call_id_hash_lock) {
+				calls_callid_index.unlock(call_id_hash_lock);
+			}
+		}
+	} else {
+		closeCalls = new FILE_LINE(1012) Call*[calls_list_count() + calls_by_stream_callid_listMAP.size()];
+		list<Call*>::iterator callIT1;
+		map<sStreamIds2, Call*>::iterator callMAPIT2;
+		for(int passTypeCall = 0; passTypeCall < 2; passTypeCall++) {
+			int typeCall = passTypeCall == 0 ? INVITE : MGCP;
+			if(typeCall == INVITE) {
+				callIT1 = calls_list.begin();
+			} else {
+				callMAPIT2 = calls_by_stream_callid_listMAP.begin();
+			}
+			while(typeCall == INVITE ? 
+			       callIT1 != calltable->calls_list.end() : 
+			       callMAPIT2 != calltable->calls_by_stream_callid_listMAP.end()) {
+				// find_by_call_id without opt_call_id_alternative holds only shard lock of the call
+				// - the shard lock keeps check of in_preprocess_queue_before_process_packet and removing from index atomic
+				u_int64_t call_id_hash_lock = 0;
 				if(typeCall == INVITE) {
-					if(opt_call_id_alternative[0]) {
-						++callIT1;
+					call = *callIT1;
+					if(!opt_call_id_alternative[0]) {
+						call_id_hash_lock = call->call_id_hash;
+						calls_callid_index.lock(call_id_hash_lock);
+					}
+				} else {
+					call = (*callMAPIT2).second;
+				}
+				if(cleanup_calls_check_close(call, currtime, forceClose, &rejectedCalls_count)) {
+					cleanup_timer_remove(&calls_cleanup_timer, call);
+					if(call->listening_worker_run) {
+						*call->listening_worker_run = 0;
+					}
+					closeCalls[closeCalls_count++] = call;
+					if(typeCall == INVITE) {
+						calls_list.erase(callIT1++);
+						call->in_calls_list = false;
+						if(call_id_hash_lock) {
+							calls_callid_index.remove(call->call_id.c_str(), call->call_id.length(), call->call_id_hash, call);
+							calls_callid_index.unlock(call_id_hash_lock);
+							call_id_hash_lock = 0;
+						} else {
+							call->removeCallIdMap();
+						}
+						call->removeMergeCalls();
 					} else {
-						++callMAPIT1;
+						calls_by_stream_callid_listMAP.erase(callMAPIT2++);
+						mgcpCleanupTransactions(call);
+						mgcpCleanupStream(call);
 					}
 				} else {
-					++callMAPIT2;
+					if(typeCall == INVITE) {
+						++callIT1;
+					} else {
+						++callMAPIT2;
+					}
+				}
+				if(call_id_hash_lock) {
+					calls_callid_index.unlock(call_id_hash_lock);
 				}
 			}
 		}
@@ -10819,6 +11264,68 @@ Calltable::cleanup_calls( struct timeval *currtime, bool forceClose, const char
 	return rejectedCalls_count;
 }
 
+bool
+Calltable::cleanup_calls_check_close(Call *call, struct timeval *currtime, bool forceClose, int *rejectedCalls_count) {
+	if(verbosity > 2) {
+		call->dump();
+	}
+	if(verbosity && verbosityE > 1) {
+		syslog(LOG_NOTICE, "Calltable::cleanup - try callid %s", call->call_id.c_str());
+	}
+	// rtptimeout seconds of inactivity will save this call and remove from call table
+	bool closeCall = false;
+	if(!currtime || call->force_close) {
+		closeCall = true;
+		if(!is_read_from_file()) {
+			call->force_terminate = true;
+		}
+	} else if(call->typeIs(SKINNY_NEW) ||
+		  call->typeIs(MGCP) ||
+		  call->in_preprocess_queue_before_process_packet <= 0 ||
+		  (!is_read_from_file() &&
+		   (call->in_preprocess_queue_before_process_packet_at[0] && call->in_preprocess_queue_before_process_packet_at[0] < currtime->tv_sec - 300 &&
+		    call->in_preprocess_queue_before_process_packet_at[1] && call->in_preprocess_queue_before_process_packet_at[1] < (getTimeMS_rdtsc() / 1000) - 300))) {
+		if(call->destroy_call_at != 0 && call->destroy_call_at <= currtime->tv_sec) {
+			closeCall = true;
+		} else if((call->destroy_call_at_bye != 0 && call->destroy_call_at_bye <= currtime->tv_sec) ||
+			  (call->destroy_call_at_bye_confirmed != 0 && call->destroy_call_at_bye_confirmed <= currtime->tv_sec)) {
+			closeCall = true;
+			call->bye_timeout_exceeded = true;
+		} else if(call->first_rtp_time_us &&
+			  currtime->tv_sec - call->get_last_packet_time_s() > rtptimeout) {
+			closeCall = true;
+			call->rtp_timeout_exceeded = true;
+		} else if(!call->first_rtp_time_us &&
+			  currtime->tv_sec - call->get_first_packet_time_s() > sipwithoutrtptimeout) {
+			closeCall = true;
+			call->sipwithoutrtp_timeout_exceeded = true;
+		} else if(currtime->tv_sec - call->get_first_packet_time_s() > absolute_timeout) {
+			closeCall = true;
+			call->absolute_timeout_exceeded = true;
+		} else if(currtime->tv_sec - call->get_first_packet_time_s() > 300 &&
+			  !call->seenRES18X && !call->seenRES2XX && !call->first_rtp_time_us) {
+			closeCall = true;
+			call->zombie_timeout_exceeded = true;
+		}
+		if(!closeCall &&
+		   (call->oneway == 1 && (currtime->tv_sec - call->get_last_packet_time_s() > opt_onewaytimeout))) {
+			closeCall = true;
+			call->oneway_timeout_exceeded = true;
+		}
+	}
+	if(closeCall) {
+		++call->attemptsClose;
+		call->removeFindTables(currtime, true);
+		if((currtime || !forceClose) &&
+		   ((opt_hash_modify_queue_length_ms && call->hash_queue_counter > 0) ||
+		    call->rtppacketsinqueue != 0)) {
+			closeCall = false;
+			++*rejectedCalls_count;
+		}
+	}
+	return(closeCall);
+}
+
 int
 Calltable::cleanup_registers(struct timeval *currtime) {
 
@@ -10827,90 +11334,35 @@ Calltable::cleanup_registers(struct timeval *currtime) {
 	}
 	Call* reg;
 	lock_registers_listMAP();
-	for (map<string, Call*>::iterator registerMAPIT = registers_listMAP.begin(); registerMAPIT != registers_listMAP.end();) {
-		reg = (*registerMAPIT).second;
-		if(verbosity > 2) {
-			reg->dump();
-		}
-		if(verbosity && verbosityE > 1) {
-			syslog(LOG_NOTICE, "Calltable::cleanup - try callid %s", reg->call_id.c_str());
-		}
-		// rtptimeout seconds of inactivity will save this call and remove from call table
-		bool closeReg = false;
-		if(!currtime || reg->force_close) {
-			closeReg = true;
-			if(!is_read_from_file()) {
-				reg->force_terminate = true;
-			}
-		} else {
-			if(reg->destroy_call_at != 0 && reg->destroy_call_at <= currtime->tv_sec) {
-				closeReg = true;
-			} else if(currtime->tv_sec - reg->get_first_packet_time_s() > absolute_timeout) {
-				closeReg = true;
-				reg->absolute_timeout_exceeded = true;
-			} else if(currtime->tv_sec - reg->get_first_packet_time_s() > 300 &&
-				  !reg->seenRES18X && !reg->seenRES2XX) {
-				closeReg = true;
-				reg->zombie_timeout_exceeded = true;
-			}
-			if(!closeReg &&
-			   (reg->oneway == 1 && (currtime->tv_sec - reg->get_last_packet_time_s() > opt_onewaytimeout))) {
-				closeReg = true;
-				reg->oneway_timeout_exceeded = true;
-			}
-		}
-		if(closeReg) {
-			if(verbosity && verbosityE > 1) {
-				syslog(LOG_NOTICE, "Calltable::cleanup - callid %s", reg->call_id.c_str());
-			}
-			// Close RTP dump file ASAP to save file handles
-			if(!currtime && is_terminating()) {
-				reg->getPcap()->close();
-				reg->getPcapSip()->close();
-			}
-
-			if(!currtime) {
-				/* we are saving calls because of terminating SIGTERM and we dont know 
-				 * if the call ends successfully or not. So we dont want to confuse monitoring
-				 * applications which reports unterminated calls so mark this call as sighup */
-				reg->sighup = true;
-				if(verbosity > 2)
-					syslog(LOG_NOTICE, "Set call->sighup\n");
-			}
-			/* move call to queue for mysql processing */
-			if(reg->push_register_to_registers_queue) {
-				syslog(LOG_WARNING,"try to duplicity push call %s to registers_queue", reg->call_id.c_str());
+	if(currtime && opt_cleanup_timer_wheel) {
+		vector<sTimerWheelNode*> expired;
+		registers_cleanup_timer.lock();
+		registers_cleanup_timer.advance(currtime->tv_sec, &expired);
+		registers_cleanup_timer.unlock();
+		__sync_synchronize();
+		for(unsigned i = 0; i < expired.size(); i++) {
+			reg = (Call*)expired[i]->owner;
+			if(cleanup_registers_check_close(reg, currtime)) {
+				cleanup_timer_remove(&registers_cleanup_timer, reg);
+				map<string, Call*>::iterator registerMAPIT = registers_listMAP.find(reg->call_id);
+				if(registerMAPIT != registers_listMAP.end() && registerMAPIT->second == reg) {
+					registers_listMAP.erase(registerMAPIT);
+				}
+				cleanup_registers_close(reg, currtime);
 			} else {
-				reg->push_register_to_registers_queue = 1;
-				if(opt_sip_register == 1) {
-					extern Registers registers;
-					if(reg->msgcount <= 1 || 
-					   reg->lastSIPresponseNum == 401 || reg->lastSIPresponseNum == 403 || reg->lastSIPresponseNum == 404) {
-						reg->regstate = 2;
-					}
-					if(reg->regstate != 2 ||
-					   !opt_register_timeout_disable_save_failed) {
-						registers.add(reg);
-					}
-					reg->getPcap()->close();
-					reg->getPcapSip()->close();
-					lock_registers_deletequeue();
-					registers_deletequeue.push_back(reg);
-					unlock_registers_deletequeue();
-				} else {
-					lock_registers_queue();
-					registers_queue.push_back(reg);
-					unlock_registers_queue();
-				}
+				cleanup_timer_relink(&registers_cleanup_timer, reg, reg->getCleanupAt(), currtime->tv_sec);
 			}
-			registers_listMAP.erase(registerMAPIT++);
-			if(opt_enable_fraud && currtime) {
-				fraudEndCall(reg, *currtime);
+		}
+	} else {
+		for (map<string, Call*>::iterator registerMAPIT = registers_listMAP.begin(); registerMAPIT != registers_listMAP.end();) {
+			reg = (*registerMAPIT).second;
+			if(cleanup_registers_check_close(reg, currtime)) {
+				cleanup_timer_remove(&registers_cleanup_timer, reg);
+				registers_listMAP.erase(registerMAPIT++);
+				cleanup_registers_close(reg, currtime);
+			} else {
+				++registerMAPIT;
 			}
-			extern u_int64_t counter_registers_clean;
-			++counter_registers_clean;
-		} else {
-			++registerMAPIT;
 		}
 	}
 	unlock_registers_listMAP();
@@ -10924,19 +11376,135 @@ Calltable::cleanup_registers(struct timeval *currtime) {
 	return 0;
 }
 
+bool
+Calltable::cleanup_registers_check_close(Call *reg, struct timeval *currtime) {
+	if(verbosity > 2) {
+		reg->dump();
+	}
+	if(verbosity && verbosityE > 1) {
+		syslog(LOG_NOTICE, "Calltable::cleanup - try callid %s", reg->call_id.c_str());
+	}
+	// rtptimeout seconds of inactivity will save this call and remove from call table
+	bool closeReg = false;
+	if(!currtime || reg->force_close) {
+		closeReg = true;
+		if(!is_read_from_file()) {
+			reg->force_terminate = true;
+		}
+	} else {
+		if(reg->destroy_call_at != 0 && reg->destroy_call_at <= currtime->tv_sec) {
+			closeReg = true;
+		} else if(currtime->tv_sec - reg->get_first_packet_time_s() > absolute_timeout) {
+			closeReg = true;
+			reg->absolute_timeout_exceeded = true;
+		} else if(currtime->tv_sec - reg->get_first_packet_time_s() > 300 &&
+			  !reg->seenRES18X && !reg->seenRES2XX) {
+			closeReg = true;
+			reg->zombie_timeout_exceeded = true;
+		}
+		if(!closeReg &&
+		   (reg->oneway == 1 && (currtime->tv_sec - reg->get_last_packet_time_s() > opt_onewaytimeout))) {
+			closeReg = true;
+			reg->oneway_timeout_exceeded = true;
+		}
+	}
+	return(closeReg);
+}
+
+void
+Calltable::cleanup_registers_close(Call *reg, struct timeval *currtime) {
+	if(verbosity && verbosityE > 1) {
+		syslog(LOG_NOTICE, "Calltable::cleanup - callid %s", reg->call_id.c_str());
+	}
+	// Close RTP dump file ASAP to save file handles
+	if(!currtime && is_terminating()) {
+		reg->getPcap()->close();
+		reg->getPcapSip()->close();
+	}
+
+	if(!currtime) {
+		/* we are saving calls because of terminating SIGTERM and we dont know 
+		 * if the call ends successfully or not. So we dont want to confuse monitoring
+		 * applications which reports unterminated calls so mark this call as sighup */
+		reg->sighup = true;
+		if(verbosity > 2)
+			syslog(LOG_NOTICE, "Set call->sighup\n");
+	}
+	/* move call to queue for mysql processing */
+	if(reg->push_register_to_registers_queue) {
+		syslog(LOG_WARNING,"try to duplicity push call %s to registers_queue", reg->call_id.c_str());
+	} else {
+		reg->push_register_to_registers_queue = 1;
+		if(opt_sip_register == 1) {
+			extern Registers registers;
+			if(reg->msgcount <= 1 || 
+			   reg->lastSIPresponseNum == 401 || reg->lastSIPresponseNum == 403 || reg->lastSIPresponseNum == 404) {
+				reg->regstate = 2;
+			}
+			if(reg->regstate != 2 ||
+			   !opt_register_timeout_disable_save_failed) {
+				registers.add(reg);
+			}
+			reg->getPcap()->close();
+			reg->getPcapSip()->close();
+			lock_registers_deletequeue();
+			registers_deletequeue.push_back(reg);
+			unlock_registers_deletequeue();
+		} else {
+			lock_registers_queue();
+			registers_queue.push_back(reg);
+			unlock_registers_queue();
+		}
+	}
+	if(opt_enable_fraud && currtime) {
+		fraudEndCall(reg, *currtime);
+	}
+	extern u_int64_t counter_registers_clean;
+	++counter_registers_clean;
+}
+
 int Calltable::cleanup_ss7( struct timeval *currtime ) {
 	lock_process_ss7_listmap();
 	lock_ss7_listMAP();
-	map<string, Ss7*>::iterator iter;
-	for(iter = ss7_listMAP.begin(); iter != ss7_listMAP.end(); ) {
-		if(iter->second->last_message_type == Ss7::rlc || 
-		   !currtime ||
-		   (currtime->tv_sec - TIME_US_TO_S(iter->second->last_time_us)) > absolute_timeout) {
-			iter->second->pushToQueue();
-			ss7_listMAP.erase(iter++);
-			continue;
+	if(currtime && opt_cleanup_timer_wheel) {
+		vector<sTimerWheelNode*> expired;
+		ss7_cleanup_timer.lock();
+		ss7_cleanup_timer.advance(currtime->tv_sec, &expired);
+		ss7_cleanup_timer.unlock();
+		for(unsigned i = 0; i < expired.size(); i++) {
+			Ss7 *ss7 = (Ss7*)expired[i]->owner;
+			if(ss7->last_message_type == Ss7::rlc ||
+			   (currtime->tv_sec - TIME_US_TO_S(ss7->last_time_us)) > absolute_timeout) {
+				cleanup_timer_remove(&ss7_cleanup_timer, ss7);
+				map<string, Ss7*>::iterator iter = ss7_listMAP.find(ss7->ss7_id());
+				if(iter == ss7_listMAP.end() || iter->second != ss7) {
+					for(iter = ss7_listMAP.begin(); iter != ss7_listMAP.end(); iter++) {
+						if(iter->second == ss7) {
+							break;
+						}
+					}
+				}
+				if(iter != ss7_listMAP.end()) {
+					ss7_listMAP.erase(iter);
+				}
+				ss7->pushToQueue();
+			} else {
+				cleanup_timer_relink(&ss7_cleanup_timer, ss7, ss7->getCleanupAt(), currtime->tv_sec);
+			}
+		}
+	} else {
+		map<string, Ss7*>::iterator iter;
+		for(iter = ss7_listMAP.begin(); iter != ss7_listMAP.end(); ) {
+			if(iter->second->last_message_type == Ss7::rlc || 
+			   !currtime ||
+			   (currtime->tv_sec - TIME_US_TO_S(iter->second->last_time_us)) > absolute_timeout) {
+				cleanup_timer_remove(&ss7_cleanup_timer, iter->second);
+				iter->second->pushToQueue();
+				ss7_listMAP.erase(iter++);
+				continue;
+			}
+			iter++;
 		}
-		iter++;
 	}
 	unlock_ss7_listMAP();
 	unlock_process_ss7_listmap();
@@ -10959,6 +11527,28 @@ int Calltable::cleanup_ss7( struct timeval *currtime ) {
 	return(0);
 }
 
+string Calltable::cleanup_timer_stats() {
+	cTimerWheel *timers[] = { &calls_cleanup_timer, &registers_cleanup_timer, &ss7_cleanup_timer };
+	const char *names[] = { "calls", "registers", "ss7" };
+	ostringstream outStr;
+	outStr << "cleanup timer wheel" << (opt_cleanup_timer_wheel ? "" : " (disabled)") << endl;
+	for(unsigned i = 0; i < sizeof(timers) / sizeof(timers[0]); i++) {
+		timers[i]->lock();
+		outStr << names[i] << " - " << timers[i]->getStatString() << endl;
+		timers[i]->unlock();
+	}
+	return(outStr.str());
+}
+
+void Calltable::cleanup_timer_stats_clear() {
+	cTimerWheel *timers[] = { &calls_cleanup_timer, &registers_cleanup_timer, &ss7_cleanup_timer };
+	for(unsigned i = 0; i < sizeof(timers) / sizeof(timers[0]); i++) {
+		timers[i]->lock();
+		timers[i]->clearStat();
+		timers[i]->unlock();
+	}
+}
+
 void Calltable::addSystemCommand(const char *command) {
 	if(asyncSystemCommand) {
 		asyncSystemCommand->addSystemCommand(command);
@@ -10975,6 +11565,7 @@ void Call::saveregister(struct timeval *currtime) {
 		return;
 	} else {
 		((Calltable*)calltable)->registers_listMAP.erase(registerMAPIT);
+		((Calltable*)calltable)->cleanup_timer_remove(&((Calltable*)calltable)->registers_cleanup_timer, this);
 	}
 	((Calltable*)calltable)->unlock_registers_listMAP();
 	extern u_int64_t counter_registers_clean;
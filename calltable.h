@@ -43,6 +43,8 @@
 #include "voipmonitor.h"
 #include "tools_fifo_buffer.h"
 #include "record_array.h"
+#include "call_id_index.h"
+#include "timer_wheel.h"
 
 #define MAX_IP_PER_CALL 40	//!< total maxumum of SDP sessions for one call-id
 #define MAX_SSRC_PER_CALL_FIX 40	//!< total maxumum of SDP sessions for one call-id
@@ -490,6 +492,7 @@ public:
 	volatile unsigned long int flags;
 	void *user_data;
 	int user_data_type;
+	sTimerWheelNode cleanup_timer;
 protected:
 	list<u_int64_t> tarPosSip;
 	list<u_int64_t> tarPosRtp;
@@ -701,6 +704,9 @@ public:
 	volatile int rtplock_sync;
 	unsigned long call_id_len;	//!< length of call-id 	
 	string call_id;	//!< call-id from SIP session
+	u_int64_t call_id_hash;
+	list<Call*>::iterator calls_list_iter;
+	bool in_calls_list;
 	map<string, bool> *call_id_alternative;
 	volatile int _call_id_alternative_lock;
 	char callername[256];		//!< callerid name from SIP header
@@ -1110,6 +1116,11 @@ public:
 	 *
 	*/
 	int convertRawToWav();
+	/**
+	 * @brief compare wav/ogg output of legs decoded and mixed in memory with output of per-leg wav files on disk
+	 *
+	*/
+	static bool convertRawToWavMixInMemoryTest();
 	
 	void selectRtpAB();
  
@@ -1335,6 +1346,25 @@ public:
 		       (!this->has_second_merged_leg || (this->has_second_merged_leg && merged)));
 	}
 	
+	void set_destroy_call_at(time_t time_s) {
+		this->destroy_call_at = time_s;
+		cleanup_timer_shift(time_s);
+	}
+	void set_destroy_call_at_bye(time_t time_s) {
+		this->destroy_call_at_bye = time_s;
+		cleanup_timer_shift(time_s);
+	}
+	void set_destroy_call_at_bye_confirmed(time_t time_s) {
+		this->destroy_call_at_bye_confirmed = time_s;
+		cleanup_timer_shift(time_s);
+	}
+	void set_force_close() {
+		this->force_close = true;
+		cleanup_timer_shift(0);
+	}
+	void cleanup_timer_shift(u_int32_t time_s);
+	u_int32_t getCleanupAt();
+	
 	void shift_destroy_call_at(u_int32_t time_s, int lastSIPresponseNum = 0) {
 		extern int opt_quick_save_cdr;
 		if(this->destroy_call_at > 0) {
@@ -1879,6 +1909,7 @@ public:
 	string ss7_id() {
 		return(iam_data.ss7_id());
 	}
+	u_int32_t getCleanupAt();
 	string filename() {
 		return(intToString(iam_time_us) + "-" + iam_data.filename());
 	}
@@ -1956,6 +1987,9 @@ struct sChartsCallData {
 };
 
 
+struct sRtpHashCacheItem;
+
+
 /**
   * This class implements operations on Call list
 */
@@ -2006,7 +2040,7 @@ public:
 	queue<string> files_queue; //!< this queue is used for asynchronous storing CDR by the worker thread
 	queue<string> files_sqlqueue; //!< this queue is used for asynchronous storing CDR by the worker thread
 	list<Call*> calls_list;
-	map<string, Call*> calls_listMAP;
+	cCallIdIndex calls_callid_index;
 	map<sStreamIds2, Call*> calls_by_stream_callid_listMAP;
 	map<sStreamId2, Call*> calls_by_stream_id2_listMAP;
 	map<sStreamId, Call*> calls_by_stream_listMAP;
@@ -2015,6 +2049,9 @@ public:
 	map<d_item<vmIP>, Call*> skinny_ipTuples;
 	map<unsigned int, Call*> skinny_partyID;
 	map<string, Ss7*> ss7_listMAP;
+	cTimerWheel calls_cleanup_timer;
+	cTimerWheel registers_cleanup_timer;
+	cTimerWheel ss7_cleanup_timer;
 
 	/**
 	 * @brief constructor
@@ -2093,8 +2130,7 @@ public:
 		       pcap_t *handle, int dlt, int sensorId);
 	
 	size_t calls_list_count() {
-		extern char opt_call_id_alternative[256];
-		return(opt_call_id_alternative[0] ? calls_list.size() : calls_listMAP.size());
+		return(calls_list.size());
 	}
 
 	/**
@@ -2108,37 +2144,50 @@ public:
 	Call *find_by_call_id(char *call_id, unsigned long call_id_len, vector<string> *call_id_alternative, time_t time) {
 		extern char opt_call_id_alternative[256];
 		Call *rslt_call = NULL;
-		string call_idS = call_id_len ? string(call_id, call_id_len) : string(call_id);
+		if(!call_id_len) {
+			call_id_len = strlen(call_id);
+		}
+		u_int64_t call_id_hash = cCallIdIndex::hash(call_id, call_id_len);
+		if(!opt_call_id_alternative[0]) {
+			calls_callid_index.lock(call_id_hash);
+			rslt_call = calls_callid_index.find(call_id, call_id_len, call_id_hash);
+			if(rslt_call && time) {
+				__sync_add_and_fetch(&rslt_call->in_preprocess_queue_before_process_packet, 1);
+				rslt_call->in_preprocess_queue_before_process_packet_at[0] = time;
+				rslt_call->in_preprocess_queue_before_process_packet_at[1] = getTimeMS_rdtsc() / 1000;
+			}
+			calls_callid_index.unlock(call_id_hash);
+			return(rslt_call);
+		}
 		lock_calls_listMAP();
-		map<string, Call*>::iterator callMAPIT = calls_listMAP.find(call_idS);
-		if(opt_call_id_alternative[0]) {
-			if(callMAPIT == calls_listMAP.end() && call_id_alternative) {
-				for(unsigned i = 0; i < call_id_alternative->size(); i++) {
-					callMAPIT = calls_listMAP.find((*call_id_alternative)[i]);
-					if(callMAPIT != calls_listMAP.end()) {
-						break;
-					}
+		rslt_call = calls_callid_index.find_lock(call_id, call_id_len, call_id_hash);
+		if(!rslt_call && call_id_alternative) {
+			for(unsigned i = 0; i < call_id_alternative->size(); i++) {
+				rslt_call = calls_callid_index.find_lock((*call_id_alternative)[i].c_str(), (*call_id_alternative)[i].length(),
+									 cCallIdIndex::hash((*call_id_alternative)[i].c_str(), (*call_id_alternative)[i].length()));
+				if(rslt_call) {
+					break;
 				}
 			}
 		}
-		if(callMAPIT != calls_listMAP.end()) {
-			rslt_call = callMAPIT->second;
-			if(opt_call_id_alternative[0]) {
-				rslt_call->call_id_alternative_lock();
-				if(call_idS != rslt_call->call_id) {
-					calls_listMAP[call_idS] = rslt_call;
-					(*rslt_call->call_id_alternative)[call_idS] = true;
-				}
-				if(call_id_alternative) {
-					for(unsigned i = 0; i < call_id_alternative->size(); i++) {
-						if((*call_id_alternative)[i] != rslt_call->call_id) {
-							calls_listMAP[(*call_id_alternative)[i]] = rslt_call;
-							(*rslt_call->call_id_alternative)[(*call_id_alternative)[i]] = true;
-						}
+		if(rslt_call) {
+			rslt_call->call_id_alternative_lock();
+			if(call_id_len != rslt_call->call_id.length() || memcmp(call_id, rslt_call->call_id.c_str(), call_id_len)) {
+				string call_idS = string(call_id, call_id_len);
+				calls_callid_index.add_lock(call_id, call_id_len, call_id_hash, rslt_call);
+				(*rslt_call->call_id_alternative)[call_idS] = true;
+			}
+			if(call_id_alternative) {
+				for(unsigned i = 0; i < call_id_alternative->size(); i++) {
+					if((*call_id_alternative)[i] != rslt_call->call_id) {
+						calls_callid_index.add_lock((*call_id_alternative)[i].c_str(), (*call_id_alternative)[i].length(),
+									    cCallIdIndex::hash((*call_id_alternative)[i].c_str(), (*call_id_alternative)[i].length()),
+									    rslt_call);
+						(*rslt_call->call_id_alternative)[(*call_id_alternative)[i]] = true;
 					}
 				}
-				rslt_call->call_id_alternative_unlock();
 			}
+			rslt_call->call_id_alternative_unlock();
 			if(time) {
 				__sync_add_and_fetch(&rslt_call->in_preprocess_queue_before_process_packet, 1);
 				rslt_call->in_preprocess_queue_before_process_packet_at[0] = time;
@@ -2210,20 +2259,10 @@ public:
 	Call *find_by_reference(long long callreference, bool lock) {
 		Call *rslt_call = NULL;
 		if(lock) lock_calls_listMAP();
-		extern char opt_call_id_alternative[256];
-		if(opt_call_id_alternative[0]) {
-			for(list<Call*>::iterator iter = calls_list.begin(); iter != calls_list.end(); iter++) {
-				if((long long)*iter == callreference) {
-					rslt_call = *iter;
-					break;
-				}
-			}
-		} else {
-			for(map<string, Call*>::iterator iter = calls_listMAP.begin(); iter != calls_listMAP.end(); iter++) {
-				if((long long)(iter->second) == callreference) {
-					rslt_call = iter->second;
-					break;
-				}
+		for(list<Call*>::iterator iter = calls_list.begin(); iter != calls_list.end(); iter++) {
+			if((long long)*iter == callreference) {
+				rslt_call = *iter;
+				break;
 			}
 		}
 		if(lock) unlock_calls_listMAP();
@@ -2281,6 +2320,26 @@ public:
 	int cleanup_calls( struct timeval *currtime, bool forceClose = false, const char *file = NULL, int line = 0);
 	int cleanup_registers( struct timeval *currtime);
 	int cleanup_ss7( struct timeval *currtime );
+	bool cleanup_calls_check_close(Call *call, struct timeval *currtime, bool forceClose, int *rejectedCalls_count);
+	bool cleanup_registers_check_close(Call *reg, struct timeval *currtime);
+	void cleanup_registers_close(Call *reg, struct timeval *currtime);
+	void cleanup_timer_add(cTimerWheel *timer, Call_abstract *call, u_int32_t time_s) {
+		timer->lock();
+		timer->add(&call->cleanup_timer, time_s);
+		timer->unlock();
+	}
+	void cleanup_timer_remove(cTimerWheel *timer, Call_abstract *call) {
+		timer->lock();
+		timer->remove(&call->cleanup_timer);
+		timer->unlock();
+	}
+	void cleanup_timer_relink(cTimerWheel *timer, Call_abstract *call, u_int32_t time_s, u_int32_t currtime_s) {
+		timer->lock();
+		timer->relink(&call->cleanup_timer, max(time_s, currtime_s + 1));
+		timer->unlock();
+	}
+	string cleanup_timer_stats();
+	void cleanup_timer_stats_clear();
 
 	/**
 	 * @brief add call to hash table
@@ -2374,6 +2433,7 @@ public:
 		#endif
 		return rslt;
 	}
+	bool hashfind_by_ip_port_to_cache(sRtpHashCacheItem *item);
 	inline bool check_call_in_hashfind_by_ip_port(Call *call, vmIP addr, vmPort port, bool lock = true) {
 		bool rslt = false;
 		if(lock) {
@@ -7,6 +7,7 @@ extern int opt_nocdr;
 extern int opt_id_sensor;
 extern MySqlStore *sqlStore;
 extern int opt_charts_cache_max_threads;
+extern int opt_charts_cache_perc_compression;
 
 
 static sChartTypeDef ChartTypeDef[] = { 
@@ -79,7 +80,8 @@ static sChartTypeDef getChartTypeDef(eChartType chartType);
 static bool cmpValCondEqLeft(const char *val1, const char *val2);
 
 
-cChartDataItem::cChartDataItem() {
+cChartDataItem::cChartDataItem()
+ : values(opt_charts_cache_perc_compression) {
 	this->max = 0;
 	this->min = -1;
 	this->sum = 0;
@@ -118,7 +120,7 @@ void cChartDataItem::add(sChartsCallData *call,
 		}
 		if(!value_null && (value || series->def.enableZero)) {
 			if(series->def.percType != _chartPercType_NA) {
-				this->values.push_back(value);
+				this->values.add((float)value);
 			}
 			if(value > this->max) {
 				this->max = value;
@@ -241,7 +243,6 @@ string cChartDataItem::json(cChartSeries *series) {
 	switch(series->def.subType) {
 	case _chartSubType_value:
 		if(this->count > 0) {
-			std::sort(this->values.begin(), this->values.end());
 			JsonExport exp;
 			exp.add("_", "vcomb");
 			exp.add("m", floatToString(this->max, precision_base, true), JsonExport::_number);
@@ -251,17 +252,15 @@ string cChartDataItem::json(cChartSeries *series) {
 			if(this->values.size()) {
 				for(unsigned i = 0; i < 2; i++) {
 					int perc = i == 0 ? 95 : 99;
-					size_t percIndex = ::min((size_t)round((double)this->values.size() * perc / 100), this->values.size() - 1);
+					u_int64_t percIndex = ::min((u_int64_t)round((double)this->values.size() * perc / 100), this->values.size() - 1);
 					if(series->def.percType == _chartPercType_Desc) {
 						percIndex = this->values.size() - 1 - percIndex;
 					}
-					exp.add(i == 0 ? "p5" : "p9", floatToString(this->values[percIndex], precision_base, true), JsonExport::_number);
+					exp.add(i == 0 ? "p5" : "p9", floatToString(this->values.valueAtRank(percIndex), precision_base, true), JsonExport::_number);
 				}
 				map<double, unsigned> valuesCount;
 				map<double, unsigned> valuesCountReduk;
-				for(unsigned i = 0; i < this->values.size(); i++) {
-					++valuesCount[this->values[i]];
-				}
+				this->values.getCentroids(&valuesCount);
 				map<double, unsigned> *valuesCountRslt;
 				if(valuesCount.size() > chartsCache->maxValuesPartsForPercentile && 
 				   (valuesCount.size() / chartsCache->maxValuesPartsForPercentile) > 1) {
@@ -752,6 +751,8 @@ void cChartIntervalSeriesData::add(sChartsCallData *call, unsigned call_interval
 
 void cChartIntervalSeriesData::store(cChartInterval *interval, SqlDb *sqlDb) {
 	string chart_data;
+	// json compresses quantile sketch - charts threads can add to it at the same time
+	lock_data();
 	if(this->dataItem) {
 		chart_data = this->dataItem->json(this->series);
 	}
@@ -761,6 +762,7 @@ void cChartIntervalSeriesData::store(cChartInterval *interval, SqlDb *sqlDb) {
 	if(this->dataMultiseriesItem) {
 		chart_data = this->dataMultiseriesItem->json(this->series, this);
 	}
+	unlock_data();
 	if(chart_data.empty() ||
 	   chart_data == last_chart_data) {
 		return;
@@ -813,10 +815,10 @@ void cChartInterval::setInterval(u_int32_t timeFrom, u_int32_t timeTo) {
 
 void cChartInterval::add(sChartsCallData *call, unsigned call_interval, bool firstInterval, bool lastInterval, bool beginInInterval,
 			 u_int32_t calldate_from, u_int32_t calldate_to,
-			 map<cChartFilter*, bool> *filters_map) {
+			 vector<bool> *filters_rslt) {
 	bool update = false;
 	for(map<string, cChartIntervalSeriesData*>::iterator iter = this->seriesData.begin(); iter != this->seriesData.end(); iter++) {
-		if(iter->second->series->checkFilters(filters_map)) {
+		if(iter->second->series->checkFilters(filters_rslt)) {
 			iter->second->add(call, call_interval, firstInterval, lastInterval, beginInInterval, 
 					  calldate_from, calldate_to);
 			++counter_add;
@@ -856,28 +858,68 @@ void cChartInterval::clear() {
 }
 
 
-cChartFilter::cChartFilter(const char *filter, const char *filter_only_sip_ip, const char *filter_without_sip_ip) {
+cChartFilterPredicate::cChartFilterPredicate(const char *predicate, unsigned index) {
+	this->predicate = predicate;
+	this->index = index;
+	this->predicate_s = new FILE_LINE(0) cEvalFormula::sSplitOperands*[opt_charts_cache_max_threads];
+	for(int i = 0; i < opt_charts_cache_max_threads; i++) {
+		this->predicate_s[i] = NULL;
+	}
+	used_counter = 0;
+	eval_counter = 0;
+	eval_time_ns = 0;
+}
+
+cChartFilterPredicate::~cChartFilterPredicate() {
+	for(int i = 0; i < opt_charts_cache_max_threads; i++) {
+		if(predicate_s[i]) {
+			delete predicate_s[i];
+		}
+	}
+	delete [] predicate_s;
+}
+
+bool cChartFilterPredicate::eval(sChartsCallData *call, void *callData, int threadIndex) {
+	cEvalFormula f(cEvalFormula::_est_sql, sverb.charts_cache_filters_eval);
+	f.setSqlData(cEvalFormula::_estd_call, call, callData);
+	bool rslt;
+	if(!predicate_s[threadIndex]) {
+		predicate_s[threadIndex] = new FILE_LINE(0) cEvalFormula::sSplitOperands(0);
+		if(sverb.charts_cache_filters_eval) {
+			cout << " * PREDICATE: " << predicate << endl;
+		}
+		rslt = f.e(predicate.c_str(), 0, 0, 0, predicate_s[threadIndex]).getBool();
+		while(f.e_opt(predicate_s[threadIndex]));
+	} else {
+		rslt = f.e(predicate_s[threadIndex]).getBool();
+	}
+	return(rslt);
+}
+
+
+cChartFilter::cChartFilter(const char *filter, const char *filter_only_sip_ip, const char *filter_without_sip_ip, unsigned index) {
 	this->filter = filter;
 	this->filter_only_sip_ip = filter_only_sip_ip;
 	this->filter_without_sip_ip = filter_without_sip_ip;
-	this->filter_s = new FILE_LINE(0) cEvalFormula::sSplitOperands*[opt_charts_cache_max_threads];
 	this->filter_only_sip_ip_s = new FILE_LINE(0) cEvalFormula::sSplitOperands*[opt_charts_cache_max_threads];
 	this->filter_without_sip_ip_s = new FILE_LINE(0) cEvalFormula::sSplitOperands*[opt_charts_cache_max_threads];
 	for(int i = 0; i < opt_charts_cache_max_threads; i++) {
-		this->filter_s[i] = NULL;
 		this->filter_only_sip_ip_s[i] = NULL;
 		this->filter_without_sip_ip_s[i] = NULL;
 	}
 	ip_filter_contain_sipcallerip = strcasestr(filter_only_sip_ip, "sipcallerip") != NULL;
 	ip_filter_contain_sipcalledip = strcasestr(filter_only_sip_ip, "sipcalledip") != NULL;
+	this->index = index;
 	used_counter = 0;
+	check_counter = 0;
+	match_counter = 0;
+	eval_predicates_counter = 0;
+	shared_predicates_counter = 0;
+	eval_time_ns = 0;
 }
 
 cChartFilter::~cChartFilter() {
 	for(int i = 0; i < opt_charts_cache_max_threads; i++) {
-		if(filter_s[i]) {
-			delete filter_s[i];
-		}
 		if(filter_only_sip_ip_s[i]) {
 			delete filter_only_sip_ip_s[i];
 		}
@@ -885,7 +927,6 @@ cChartFilter::~cChartFilter() {
 			delete filter_without_sip_ip_s[i];
 		}
 	}
-	delete [] filter_s;
 	delete [] filter_only_sip_ip_s;
 	delete [] filter_without_sip_ip_s;
 }
@@ -901,7 +942,8 @@ u_int64_t __cc2;
 u_int64_t __ss2;
 #endif
 
-bool cChartFilter::check(sChartsCallData *call, void *callData, bool ip_comb_v6, void *ip_comb, cFiltersCache *filtersCache, int threadIndex) {
+bool cChartFilter::check(sChartsCallData *call, void *callData, bool ip_comb_v6, void *ip_comb, cFiltersCache *filtersCache, int threadIndex,
+			 vector<int8_t> *predicates_rslt) {
  
 #if TEST_CHECK_FILTER == 1
  
@@ -1063,18 +1105,47 @@ bool cChartFilter::check(sChartsCallData *call, void *callData, bool ip_comb_v6,
 		}
 	}
 	
-	cEvalFormula f(cEvalFormula::_est_sql, sverb.charts_cache_filters_eval);
-	f.setSqlData(cEvalFormula::_estd_call, call, callData);
-	bool rslt;
-	if(!filter_s[threadIndex]) {
-		filter_s[threadIndex] = new FILE_LINE(0) cEvalFormula::sSplitOperands(0);
-		if(sverb.charts_cache_filters_eval) {
-			cout << " * FILTER: " << filter << endl;
+	__SYNC_INC(check_counter);
+	if(sverb.charts_cache_filters_eval) {
+		cout << " * FILTER: " << filter << endl;
+	}
+	// filter is conjunction of predicates shared with other filters - predicate already evaluated for this call
+	// by other filter is taken from predicates_rslt (-1 = not evaluated yet), false predicate ends the check
+	bool rslt = true;
+	for(unsigned i = 0; i < predicates.size(); i++) {
+		if(predicates[i]->index < predicates_rslt->size() &&
+		   (*predicates_rslt)[predicates[i]->index] == 0) {
+			rslt = false;
+			break;
+		}
+	}
+	if(rslt) {
+		for(unsigned i = 0; i < predicates.size(); i++) {
+			cChartFilterPredicate *predicate = predicates[i];
+			int8_t predicate_rslt = predicate->index < predicates_rslt->size() ?
+						 (*predicates_rslt)[predicate->index] : -1;
+			if(predicate_rslt < 0) {
+				u_int64_t eval_start_ns = getTimeNS();
+				predicate_rslt = predicate->eval(call, callData, threadIndex);
+				u_int64_t eval_ns = getTimeNS() - eval_start_ns;
+				if(predicate->index < predicates_rslt->size()) {
+					(*predicates_rslt)[predicate->index] = predicate_rslt;
+				}
+				__SYNC_INC(predicate->eval_counter);
+				__SYNC_ADD(predicate->eval_time_ns, eval_ns);
+				__SYNC_INC(eval_predicates_counter);
+				__SYNC_ADD(eval_time_ns, eval_ns);
+			} else {
+				__SYNC_INC(shared_predicates_counter);
+			}
+			if(!predicate_rslt) {
+				rslt = false;
+				break;
+			}
 		}
-		rslt = f.e(filter.c_str(), 0, 0, 0, filter_s[threadIndex]).getBool();
-		while(f.e_opt(filter_s[threadIndex]));
-	} else {
-		rslt = f.e(filter_s[threadIndex]).getBool();
+	}
+	if(rslt) {
+		__SYNC_INC(match_counter);
 	}
 	if(sverb.charts_cache_filters_eval || sverb.charts_cache_filters_eval_rslt || sverb.charts_cache_filters_eval_rslt_true) {
 		if(sverb.charts_cache_filters_eval_rslt_true || rslt) {
@@ -1184,14 +1255,15 @@ void cChartSeries::clear() {
 	}
 }
 
-bool cChartSeries::checkFilters(map<cChartFilter*, bool> *filters_map) {
+bool cChartSeries::checkFilters(vector<bool> *filters_rslt) {
 	if(!filters.size()) {
 		return(true);
 	}
 	bool rslt = true;
 	for(unsigned i = 0; i < filters.size(); i++) {
 		cChartFilter *filter = filters[i];
-		if(!(*filters_map)[filter]) {
+		if(filter->index >= filters_rslt->size() ||
+		   !(*filters_rslt)[filter->index]) {
 			rslt = false;
 			break;
 		}
@@ -1216,6 +1288,7 @@ cCharts::cCharts() {
 	last_reload_at = 0;
 	last_reload_at_real = 0;
 	sync_intervals = 0;
+	sync_filters = 0;
 }
 
 cCharts::~cCharts() {
@@ -1328,10 +1401,13 @@ void cCharts::clear() {
 		delete iter->second;
 	}
 	series.clear();
+	lock_filters();
 	for(map<string, cChartFilter*>::iterator iter = filters.begin(); iter != filters.end(); iter++) {
-		delete iter->second;
+		deleteFilter(iter->second);
 	}
 	filters.clear();
+	filters_index.clear();
+	unlock_filters();
 }
 
 cChartFilter* cCharts::getFilter(const char *filter, bool enableAdd,
@@ -1347,14 +1423,186 @@ cChartFilter* cCharts::getFilter(const char *filter, bool enableAdd,
 }
 
 cChartFilter* cCharts::addFilter(const char *filter, const char *filter_only_sip_ip, const char *filter_without_sip_ip) {
-	cChartFilter *chFilter = new FILE_LINE(0) cChartFilter(filter, filter_only_sip_ip, filter_without_sip_ip);
+	lock_filters();
+	unsigned index = 0;
+	while(index < filters_index.size() && filters_index[index]) {
+		++index;
+	}
+	cChartFilter *chFilter = new FILE_LINE(0) cChartFilter(filter, filter_only_sip_ip, filter_without_sip_ip, index);
+	vector<string> filter_predicates;
+	splitFilterPredicates(filter, &filter_predicates);
+	for(unsigned i = 0; i < filter_predicates.size(); i++) {
+		chFilter->predicates.push_back(getPredicate(filter_predicates[i].c_str()));
+	}
+	if(index < filters_index.size()) {
+		filters_index[index] = chFilter;
+	} else {
+		filters_index.push_back(chFilter);
+	}
 	filters[filter] = chFilter;
+	unlock_filters();
 	return(chFilter);
 }
 
+void cCharts::deleteFilter(cChartFilter *filter) {
+	for(unsigned i = 0; i < filter->predicates.size(); i++) {
+		releasePredicate(filter->predicates[i]);
+	}
+	if(filter->index < filters_index.size()) {
+		filters_index[filter->index] = NULL;
+	}
+	delete filter;
+}
+
+cChartFilterPredicate *cCharts::getPredicate(const char *predicate) {
+	map<string, cChartFilterPredicate*>::iterator iter = predicates.find(predicate);
+	if(iter != predicates.end()) {
+		++iter->second->used_counter;
+		return(iter->second);
+	}
+	unsigned index = 0;
+	while(index < predicates_index.size() && predicates_index[index]) {
+		++index;
+	}
+	cChartFilterPredicate *chPredicate = new FILE_LINE(0) cChartFilterPredicate(predicate, index);
+	chPredicate->used_counter = 1;
+	if(index < predicates_index.size()) {
+		predicates_index[index] = chPredicate;
+	} else {
+		predicates_index.push_back(chPredicate);
+	}
+	predicates[predicate] = chPredicate;
+	return(chPredicate);
+}
+
+void cCharts::releasePredicate(cChartFilterPredicate *predicate) {
+	if(--predicate->used_counter > 0) {
+		return;
+	}
+	predicates.erase(predicate->predicate);
+	if(predicate->index < predicates_index.size()) {
+		predicates_index[predicate->index] = NULL;
+	}
+	delete predicate;
+}
+
+static bool chartFilterIsSpace(char ch) {
+	return(ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n');
+}
+
+static bool chartFilterIsWord(string &str, unsigned pos, const char *word) {
+	unsigned length = strlen(word);
+	return(pos + length <= str.length() &&
+	       !strncasecmp(str.c_str() + pos, word, length) &&
+	       (pos == 0 || str[pos - 1] == ' ' || str[pos - 1] == ')') &&
+	       (pos + length == str.length() || str[pos + length] == ' ' || str[pos + length] == '('));
+}
+
+static string chartFilterNormalize(string str) {
+	string rslt;
+	char quote = 0;
+	for(unsigned i = 0; i < str.length(); i++) {
+		char ch = str[i];
+		if(quote) {
+			rslt += ch;
+			if(ch == '\\' && i + 1 < str.length()) {
+				rslt += str[++i];
+			} else if(ch == quote) {
+				quote = 0;
+			}
+		} else if(chartFilterIsSpace(ch)) {
+			if(rslt.length() && rslt[rslt.length() - 1] != ' ') {
+				rslt += ' ';
+			}
+		} else {
+			if(ch == '\'' || ch == '"' || ch == '`') {
+				quote = ch;
+			}
+			rslt += ch;
+		}
+	}
+	if(rslt.length() && rslt[rslt.length() - 1] == ' ') {
+		rslt.resize(rslt.length() - 1);
+	}
+	return(rslt);
+}
+
+void cCharts::splitFilterPredicates(const char *filter, vector<string> *predicates) {
+	// split filter to predicates joined by top level 'and' so that the same condition used in more filters
+	// (ip, number, sensor...) is evaluated only once per call - 'and' has lower priority than all operators
+	// in cEvalFormula except 'or' and ',' so filter is split only if none of them is at top level
+	string str = chartFilterNormalize(filter);
+	while(str.length() > 1 && str[0] == '(' && str[str.length() - 1] == ')') {
+		int level = 0;
+		char quote = 0;
+		unsigned i;
+		for(i = 0; i < str.length(); i++) {
+			char ch = str[i];
+			if(quote) {
+				if(ch == '\\') {
+					++i;
+				} else if(ch == quote) {
+					quote = 0;
+				}
+			} else if(ch == '\'' || ch == '"' || ch == '`') {
+				quote = ch;
+			} else if(ch == '(') {
+				++level;
+			} else if(ch == ')' && --level == 0) {
+				break;
+			}
+		}
+		if(i != str.length() - 1) {
+			break;
+		}
+		str = chartFilterNormalize(str.substr(1, str.length() - 2));
+	}
+	if(str.empty()) {
+		return;
+	}
+	vector<unsigned> and_pos;
+	bool split = true;
+	int level = 0;
+	char quote = 0;
+	for(unsigned i = 0; i < str.length() && split; i++) {
+		char ch = str[i];
+		if(quote) {
+			if(ch == '\\') {
+				++i;
+			} else if(ch == quote) {
+				quote = 0;
+			}
+		} else if(ch == '\'' || ch == '"' || ch == '`') {
+			quote = ch;
+		} else if(ch == '(') {
+			++level;
+		} else if(ch == ')') {
+			--level;
+		} else if(level == 0) {
+			if(ch == ',' ||
+			   chartFilterIsWord(str, i, "or") ||
+			   chartFilterIsWord(str, i, "between")) {
+				split = false;
+			} else if(chartFilterIsWord(str, i, "and")) {
+				and_pos.push_back(i);
+			}
+		}
+	}
+	if(!split || !and_pos.size() || level != 0 || quote) {
+		predicates->push_back(str);
+		return;
+	}
+	unsigned begin = 0;
+	for(unsigned i = 0; i <= and_pos.size(); i++) {
+		unsigned end = i < and_pos.size() ? and_pos[i] : str.length();
+		splitFilterPredicates(str.substr(begin, end - begin).c_str(), predicates);
+		begin = end + 3;
+	}
+}
+
 void cCharts::add(sChartsCallData *call, void *callData, cFiltersCache *filtersCache, int threadIndex) {
-	map<cChartFilter*, bool> filters_map;
-	this->checkFilters(call, callData, &filters_map, filtersCache, threadIndex);
+	vector<bool> filters_rslt;
+	this->checkFilters(call, callData, &filters_rslt, filtersCache, threadIndex);
 	u_int64_t calltime_us;
 	u_int64_t callend_us;
 	if(call->type == sChartsCallData::_call) {
@@ -1389,18 +1637,23 @@ void cCharts::add(sChartsCallData *call, void *callData, cFiltersCache *filtersC
 		unlock_intervals();
 		interval->add(call, interval_counter, interval_counter == 0, interval_counter == intervals_begin.size() - 1, interval_counter == 0,
 			      calltime_s, callend_s,
-			      &filters_map);
+			      &filters_rslt);
 		++interval_counter;
 	}
 }
 
-void cCharts::checkFilters(sChartsCallData *call, void *callData, map<cChartFilter*, bool> *filters_map, cFiltersCache *filtersCache, int threadIndex) {
+void cCharts::checkFilters(sChartsCallData *call, void *callData, vector<bool> *filters_rslt, cFiltersCache *filtersCache, int threadIndex) {
+	filters_rslt->assign(filters_index.size(), false);
+	vector<int8_t> predicates_rslt(predicates_index.size(), -1);
 	#if VM_IPV6
 	if(useIPv6) {
 		sFilterCache_call_ipv6_comb ipv6_comb;
 		ipv6_comb.set(call);
 		for(map<string, cChartFilter*>::iterator iter = filters.begin(); iter != filters.end(); iter++) {
-			(*filters_map)[iter->second] = iter->second->check(call, callData, true, &ipv6_comb, filtersCache, threadIndex);
+			if(iter->second->check(call, callData, true, &ipv6_comb, filtersCache, threadIndex, &predicates_rslt) &&
+			   iter->second->index < filters_rslt->size()) {
+				(*filters_rslt)[iter->second->index] = true;
+			}
 		}
 	} else 
 	#endif
@@ -1408,7 +1661,10 @@ void cCharts::checkFilters(sChartsCallData *call, void *callData, map<cChartFilt
 		sFilterCache_call_ipv4_comb ipv4_comb;
 		ipv4_comb.set(call);
 		for(map<string, cChartFilter*>::iterator iter = filters.begin(); iter != filters.end(); iter++) {
-			(*filters_map)[iter->second] = iter->second->check(call, callData, false, &ipv4_comb, filtersCache, threadIndex);
+			if(iter->second->check(call, callData, false, &ipv4_comb, filtersCache, threadIndex, &predicates_rslt) &&
+			   iter->second->index < filters_rslt->size()) {
+				(*filters_rslt)[iter->second->index] = true;
+			}
 		}
 	}
 }
@@ -1475,14 +1731,16 @@ void cCharts::cleanup(bool forceAll) {
 		}
 	}
 	unlock_intervals();
+	lock_filters();
 	for(map<string, cChartFilter*>::iterator iter = filters.begin(); iter != filters.end(); ) {
 		if(!iter->second->used_counter) {
-			delete iter->second;
+			deleteFilter(iter->second);
 			filters.erase(iter++);
 		} else {
 			iter++;
 		}
 	}
+	unlock_filters();
 	last_cleanup_at = first_interval;
 	last_cleanup_at_real = real_time;
 }
@@ -1496,6 +1754,38 @@ bool cCharts::seriesIsUsed(const char *config_id) {
 	return(false);
 }
 
+string cCharts::filtersStat() {
+	ostringstream outStr;
+	lock_filters();
+	list<pair<u_int64_t, cChartFilter*> > filters_by_time;
+	unsigned predicates_sum = 0;
+	for(map<string, cChartFilter*>::iterator iter = filters.begin(); iter != filters.end(); iter++) {
+		filters_by_time.push_back(make_pair(iter->second->eval_time_ns, iter->second));
+		predicates_sum += iter->second->predicates.size();
+	}
+	filters_by_time.sort();
+	filters_by_time.reverse();
+	outStr << "filters: " << filters.size()
+	       << ", predicates: " << predicates_sum
+	       << ", distinct predicates: " << predicates.size() << endl;
+	outStr << "eval_ms\tavg_us\tchecks\tmatched\tevaluated\tshared\tpredicates\tseries\tfilter" << endl;
+	for(list<pair<u_int64_t, cChartFilter*> >::iterator iter = filters_by_time.begin(); iter != filters_by_time.end(); iter++) {
+		cChartFilter *filter = iter->second;
+		outStr << fixed
+		       << setprecision(3) << filter->eval_time_ns / 1e6 << "\t"
+		       << setprecision(3) << (filter->check_counter ? filter->eval_time_ns / 1e3 / filter->check_counter : 0.) << "\t"
+		       << filter->check_counter << "\t"
+		       << filter->match_counter << "\t"
+		       << filter->eval_predicates_counter << "\t"
+		       << filter->shared_predicates_counter << "\t"
+		       << filter->predicates.size() << "\t"
+		       << filter->used_counter << "\t"
+		       << filter->filter << endl;
+	}
+	unlock_filters();
+	return(outStr.str());
+}
+
 
 void sFilterCache_call_ipv4_comb::set(sChartsCallData *call) {
 	u.a[1] = 0;
@@ -1836,3 +2126,10 @@ void chartsCacheInitIntervals() {
 		chartsCache->initIntervals();
 	}
 }
+
+string chartsCacheFiltersStat() {
+	if(chartsCache) {
+		return(chartsCache->filtersStat());
+	}
+	return("charts cache is not enabled\n");
+}
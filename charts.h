@@ -10,6 +10,7 @@
 #include "sql_db.h"
 #include "calltable.h"
 #include "tools_global.h"
+#include "quantile_sketch.h"
 
 
 using namespace std;
@@ -114,7 +115,7 @@ private:
 	volatile double max;
 	volatile double min;
 	volatile double sum;
-	vector<float> values;
+	cQuantileSketch values;
 	volatile unsigned int count;
 	map<unsigned int, unsigned int> count_intervals;
 	volatile unsigned int countAll;
@@ -189,7 +190,7 @@ public:
 	void setInterval(u_int32_t timeFrom, u_int32_t timeTo);
 	void add(sChartsCallData *call, unsigned call_interval, bool firstInterval, bool lastInterval, bool beginInInterval,
 		 u_int32_t calldate_from, u_int32_t calldate_to,
-		 map<class cChartFilter*, bool> *filters_map);
+		 vector<bool> *filters_rslt);
 	void store(u_int32_t act_time, u_int32_t real_time, SqlDb *sqlDb);
 	void init();
 	void clear();
@@ -208,21 +209,44 @@ friend class cCharts;
 };
 
 
+class cChartFilterPredicate {
+public:
+	cChartFilterPredicate(const char *predicate, unsigned index);
+	~cChartFilterPredicate();
+	bool eval(sChartsCallData *call, void *callData, int threadIndex);
+private:
+	string predicate;
+	unsigned index;
+	cEvalFormula::sSplitOperands **predicate_s;
+	volatile int used_counter;
+	volatile u_int64_t eval_counter;
+	volatile u_int64_t eval_time_ns;
+friend class cChartFilter;
+friend class cCharts;
+};
+
 class cChartFilter {
 public:
-	cChartFilter(const char *filter, const char *filter_only_sip_ip, const char *filter_without_sip_ip);
+	cChartFilter(const char *filter, const char *filter_only_sip_ip, const char *filter_without_sip_ip, unsigned index);
 	~cChartFilter();
-	bool check(sChartsCallData *call, void *callData, bool ip_comb_v6, void *ip_comb, class cFiltersCache *filtersCache, int threadIndex);
+	bool check(sChartsCallData *call, void *callData, bool ip_comb_v6, void *ip_comb, class cFiltersCache *filtersCache, int threadIndex,
+		   vector<int8_t> *predicates_rslt);
 private:
 	string filter;
 	string filter_only_sip_ip;
 	string filter_without_sip_ip;
-	cEvalFormula::sSplitOperands **filter_s;
 	cEvalFormula::sSplitOperands **filter_only_sip_ip_s;
 	cEvalFormula::sSplitOperands **filter_without_sip_ip_s;
 	bool ip_filter_contain_sipcallerip;
 	bool ip_filter_contain_sipcalledip;
+	unsigned index;
+	vector<cChartFilterPredicate*> predicates;
 	volatile int used_counter;
+	volatile u_int64_t check_counter;
+	volatile u_int64_t match_counter;
+	volatile u_int64_t eval_predicates_counter;
+	volatile u_int64_t shared_predicates_counter;
+	volatile u_int64_t eval_time_ns;
 friend class cChartSeries;
 friend class cCharts;
 };
@@ -276,7 +300,7 @@ public:
 	bool isArea() { 
 		return(def.subType == _chartSubType_area); 
 	}
-	bool checkFilters(map<class cChartFilter*, bool> *filters_map);
+	bool checkFilters(vector<bool> *filters_rslt);
 private:
 	unsigned int id;
 	string config_id;
@@ -307,17 +331,28 @@ public:
 	cChartFilter* getFilter(const char *filter, bool enableAdd, 
 				const char *filter_only_sip_ip, const char *filter_without_sip_ip);
 	cChartFilter* addFilter(const char *filter, const char *filter_only_sip_ip, const char *filter_without_sip_ip);
+	void deleteFilter(cChartFilter *filter);
 	void add(sChartsCallData *call, void *callData, class cFiltersCache *filtersCache, int threadIndex);
-	void checkFilters(sChartsCallData *call, void *callData, map<cChartFilter*, bool> *filters, class cFiltersCache *filtersCache, int threadIndex);
+	void checkFilters(sChartsCallData *call, void *callData, vector<bool> *filters_rslt, class cFiltersCache *filtersCache, int threadIndex);
 	void store(bool forceAll = false);
 	void cleanup(bool forceAll = false);
 	bool seriesIsUsed(const char *config_id);
+	string filtersStat();
 	void lock_intervals() { __SYNC_LOCK(sync_intervals); }
 	void unlock_intervals() { __SYNC_UNLOCK(sync_intervals); }
+	void lock_filters() { __SYNC_LOCK(sync_filters); }
+	void unlock_filters() { __SYNC_UNLOCK(sync_filters); }
+private:
+	cChartFilterPredicate *getPredicate(const char *predicate);
+	void releasePredicate(cChartFilterPredicate *predicate);
+	static void splitFilterPredicates(const char *filter, vector<string> *predicates);
 private:
 	map<string, cChartSeries*> series;
 	map<u_int32_t, cChartInterval*> intervals;
 	map<string, cChartFilter*> filters;
+	vector<cChartFilter*> filters_index;
+	map<string, cChartFilterPredicate*> predicates;
+	vector<cChartFilterPredicate*> predicates_index;
 	volatile u_int32_t first_interval;
 	unsigned maxValuesPartsForPercentile;
 	unsigned maxLengthSipResponseText;
@@ -333,6 +368,7 @@ private:
 	u_int32_t last_reload_at;
 	u_int32_t last_reload_at_real;
 	volatile int sync_intervals;
+	volatile int sync_filters;
 friend class cChartDataItem;
 friend class cChartInterval;
 friend class Call;
@@ -422,6 +458,7 @@ void chartsCacheStore(bool forceAll = false);
 void chartsCacheCleanup(bool forceAll = false);
 void chartsCacheReload();
 void chartsCacheInitIntervals();
+string chartsCacheFiltersStat();
 
 
 #endif //CHARTS_H
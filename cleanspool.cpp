@@ -14,6 +14,9 @@
 #include <sstream>
 #include <vector>
 #include <fts.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "sql_db.h"
 #include "tools.h"
@@ -36,6 +39,7 @@ extern bool opt_cleanspool_use_files;
 #define ENCODE_FIELD_SEPARATOR ";"
 #define ENCODE_DATA_SEPARATOR "|"
 #define CACHE_NAME ".cleanspool_cache"
+#define INDEX_NAME ".cleanspool_index"
 
 
 string CleanSpool::sSpoolDataDirIndex::encode_hour() {
@@ -316,6 +320,585 @@ void CleanSpool::cSpoolData::eraseDir(string dir) {
 	}
 }
 
+#define SPOOL_INDEX_MAGIC "VMSPIDX"
+#define SPOOL_INDEX_VERSION 1
+#define SPOOL_INDEX_MAX_PENDING 1000000
+
+CleanSpool::cSpoolIndex::cSpoolIndex() {
+	fd = -1;
+	fd_append = -1;
+	fd_rebuild = -1;
+	map_data = NULL;
+	map_size = 0;
+	records = NULL;
+	count = 0;
+	sorted_count = 0;
+	first_active = 0;
+	count_deleted = 0;
+	memset(sum_size, 0, sizeof(sum_size));
+	scanning = false;
+	_sync = 0;
+}
+
+CleanSpool::cSpoolIndex::~cSpoolIndex() {
+	close();
+	if(fd_rebuild >= 0) {
+		::close(fd_rebuild);
+		unlink((fileName + ".rebuild").c_str());
+	}
+}
+
+bool CleanSpool::cSpoolIndex::open() {
+	lock();
+	bool rslt = _open();
+	unlock();
+	return(rslt);
+}
+
+void CleanSpool::cSpoolIndex::close() {
+	lock();
+	_close();
+	unlock();
+}
+
+/* records of new files (addFile)
+ * while the spool directories are scanned (rebuild / update after restart) or before the index is opened, a record is written
+ * only if the scan has already passed its hour, otherwise it is kept in pending - pending records of hour are dropped when
+ * the scan flushes the hour (the scan counts the file itself) and the rest is written in endRebuild / endUpdate */
+void CleanSpool::cSpoolIndex::append(sRecord *records, unsigned count) {
+	lock();
+	if(scanning || !map_data) {
+		for(unsigned i = 0; i < count; i++) {
+			if(scanning && scanned_date_hours.find(getDateHourKey(&records[i])) != scanned_date_hours.end()) {
+				_write(fd_rebuild >= 0 ? fd_rebuild : fd_append, &records[i], 1);
+			} else if(pending.size() < SPOOL_INDEX_MAX_PENDING) {
+				pending.push_back(records[i]);
+			} else {
+				syslog(LOG_ERR, "cleanspool index: too many records waiting for open of %s", fileName.c_str());
+			}
+		}
+	} else {
+		_write(fd_append, records, count);
+	}
+	unlock();
+}
+
+/* records from scan of spool directories (flushSpoolDataToIndex) */
+void CleanSpool::cSpoolIndex::appendScanned(sRecord *records, unsigned count) {
+	lock();
+	_write(fd_rebuild >= 0 ? fd_rebuild : fd_append, records, count);
+	if(scanning) {
+		for(unsigned i = 0; i < count; i++) {
+			scanned_date_hours.insert(getDateHourKey(&records[i]));
+		}
+		unsigned j = 0;
+		for(unsigned i = 0; i < pending.size(); i++) {
+			if(scanned_date_hours.find(getDateHourKey(&pending[i])) == scanned_date_hours.end()) {
+				pending[j++] = pending[i];
+			}
+		}
+		pending.resize(j);
+	}
+	unlock();
+}
+
+bool CleanSpool::cSpoolIndex::compact() {
+	lock();
+	if(!map_data) {
+		unlock();
+		return(false);
+	}
+	// records appended after mapping are read from file, unsorted tail of mapping is merged with them
+	struct stat st;
+	u_int64_t count_file = count;
+	if(!fstat(fd, &st) && (u_int64_t)st.st_size > sizeof(sHeader)) {
+		count_file = (st.st_size - sizeof(sHeader)) / sizeof(sRecord);
+	}
+	if(count_file == sorted_count && !count_deleted) {
+		unlock();
+		return(true);
+	}
+	vector<sRecord> tail;
+	tail.reserve(count_file - sorted_count);
+	for(u_int64_t i = sorted_count; i < count; i++) {
+		if(!(records[i].flags & _rf_deleted)) {
+			tail.push_back(records[i]);
+		}
+	}
+	if(count_file > count) {
+		tail.resize(tail.size() + (count_file - count));
+		size_t length = (count_file - count) * sizeof(sRecord);
+		if(pread(fd, &tail[tail.size() - (count_file - count)], length, sizeof(sHeader) + count * sizeof(sRecord)) != (ssize_t)length) {
+			syslog(LOG_ERR, "cleanspool index: error read %s", fileName.c_str());
+			unlock();
+			return(false);
+		}
+	}
+	std::sort(tail.begin(), tail.end());
+	vector<sRecord> rslt;
+	rslt.reserve(sorted_count - count_deleted + tail.size());
+	u_int64_t i = 0;
+	size_t j = 0;
+	while(i < sorted_count || j < tail.size()) {
+		sRecord *record;
+		if(i < sorted_count && (records[i].flags & _rf_deleted)) {
+			++i;
+			continue;
+		}
+		if(i < sorted_count && (j >= tail.size() || !(tail[j] < records[i]))) {
+			record = &records[i++];
+		} else {
+			record = &tail[j++];
+		}
+		if(rslt.size() && rslt.back().eqKey(*record)) {
+			rslt.back().size += record->size;
+		} else {
+			rslt.push_back(*record);
+		}
+	}
+	string tmpFileName = fileName + ".tmp";
+	bool ok = write(tmpFileName.c_str(), rslt.size() ? &rslt[0] : NULL, rslt.size()) &&
+		  !rename(tmpFileName.c_str(), fileName.c_str());
+	if(!ok) {
+		syslog(LOG_ERR, "cleanspool index: error write %s", tmpFileName.c_str());
+		unlink(tmpFileName.c_str());
+	}
+	_close();
+	ok = _open() && ok;
+	unlock();
+	return(ok);
+}
+
+bool CleanSpool::cSpoolIndex::beginRebuild() {
+	string rebuildFileName = fileName + ".rebuild";
+	lock();
+	if(fd_rebuild >= 0) {
+		::close(fd_rebuild);
+	}
+	fd_rebuild = -1;
+	sRecord *empty = NULL;
+	if(write(rebuildFileName.c_str(), empty, 0)) {
+		fd_rebuild = ::open(rebuildFileName.c_str(), O_WRONLY | O_APPEND);
+	}
+	if(fd_rebuild >= 0) {
+		scanning = true;
+		scanned_date_hours.clear();
+	}
+	unlock();
+	if(fd_rebuild < 0) {
+		syslog(LOG_ERR, "cleanspool index: error create %s", rebuildFileName.c_str());
+		return(false);
+	}
+	return(true);
+}
+
+bool CleanSpool::cSpoolIndex::endRebuild() {
+	string rebuildFileName = fileName + ".rebuild";
+	lock();
+	if(fd_rebuild < 0) {
+		unlock();
+		return(false);
+	}
+	_flushPending();
+	::close(fd_rebuild);
+	fd_rebuild = -1;
+	_close();
+	bool ok = !rename(rebuildFileName.c_str(), fileName.c_str());
+	if(!ok) {
+		syslog(LOG_ERR, "cleanspool index: error rename %s", rebuildFileName.c_str());
+		unlink(rebuildFileName.c_str());
+	}
+	ok = _open() && ok;
+	unlock();
+	return(ok && compact());
+}
+
+/* after restart - records of the last hours can be incomplete, they are removed and the hours are scanned again */
+bool CleanSpool::cSpoolIndex::beginUpdate(int lastHours, map<uint64_t, bool> *dateHours) {
+	lock();
+	if(!_open()) {
+		unlock();
+		return(false);
+	}
+	_removeLastDateHours(lastHours);
+	_getDateHours(dateHours);
+	scanning = true;
+	scanned_date_hours.clear();
+	unlock();
+	return(true);
+}
+
+void CleanSpool::cSpoolIndex::endUpdate() {
+	lock();
+	_flushPending();
+	unlock();
+}
+
+long long CleanSpool::cSpoolIndex::getSumSize() {
+	long long size = 0;
+	lock();
+	for(int i = 0; i < _st_count; i++) {
+		size += sum_size[i];
+	}
+	unlock();
+	return(size);
+}
+
+long long CleanSpool::cSpoolIndex::getSplitSumSize(long long *sip, long long *rtp, long long *graph, long long *audio) {
+	lock();
+	if(sip) {
+		*sip = sum_size[_st_sip];
+	}
+	if(rtp) {
+		*rtp = sum_size[_st_rtp];
+	}
+	if(graph) {
+		*graph = sum_size[_st_graph];
+	}
+	if(audio) {
+		*audio = sum_size[_st_audio];
+	}
+	long long size = sum_size[_st_sip] + sum_size[_st_rtp] + sum_size[_st_graph] + sum_size[_st_audio];
+	unlock();
+	return(size);
+}
+
+void CleanSpool::cSpoolIndex::getSumSizeByDate(map<string, long long> *sizeByDate) {
+	sizeByDate->clear();
+	u_int32_t lastDate = 0;
+	long long *lastDateSize = NULL;
+	lock();
+	for(u_int64_t i = first_active; i < count; i++) {
+		if(!(records[i].flags & _rf_deleted)) {
+			if(!lastDateSize || records[i].date != lastDate) {
+				lastDate = records[i].date;
+				lastDateSize = &(*sizeByDate)[getDateStr(lastDate)];
+			}
+			*lastDateSize += records[i].size;
+		}
+	}
+	unlock();
+}
+
+void CleanSpool::cSpoolIndex::getDateHours(map<uint64_t, bool> *dateHours) {
+	lock();
+	_getDateHours(dateHours);
+	unlock();
+}
+
+/* returns copy of the oldest record - mapping can be replaced by compact */
+bool CleanSpool::cSpoolIndex::getMin(bool sip, bool rtp, bool graph, bool audio, sRecord *record) {
+	bool rslt = false;
+	lock();
+	for(u_int64_t i = first_active; i < sorted_count && !rslt; i++) {
+		if(!(records[i].flags & _rf_deleted)) {
+			switch(getSizeType(records[i].type)) {
+			case _st_rtp:
+				rslt = rtp;
+				break;
+			case _st_graph:
+				rslt = graph;
+				break;
+			case _st_audio:
+				rslt = audio;
+				break;
+			default:
+				rslt = sip;
+				break;
+			}
+			if(rslt) {
+				*record = records[i];
+			}
+		}
+	}
+	unlock();
+	return(rslt);
+}
+
+void CleanSpool::cSpoolIndex::erase(sRecord *record) {
+	lock();
+	sRecord *iter = std::lower_bound(records + first_active, records + sorted_count, *record);
+	for(; iter < records + sorted_count && iter->eqKey(*record); iter++) {
+		if(!(iter->flags & _rf_deleted)) {
+			_erase(iter);
+			break;
+		}
+	}
+	unlock();
+}
+
+void CleanSpool::cSpoolIndex::removeLastDateHours(int hours) {
+	lock();
+	_removeLastDateHours(hours);
+	unlock();
+}
+
+void CleanSpool::cSpoolIndex::_getDateHours(map<uint64_t, bool> *dateHours) {
+	dateHours->clear();
+	for(u_int64_t i = first_active; i < count; i++) {
+		if(!(records[i].flags & _rf_deleted) && records[i].hour >= 0) {
+			(*dateHours)[records[i].date * 100ull + records[i].hour] = true;
+		}
+	}
+}
+
+void CleanSpool::cSpoolIndex::_erase(sRecord *record) {
+	if(record->flags & _rf_deleted) {
+		return;
+	}
+	record->flags |= _rf_deleted;
+	sum_size[getSizeType(record->type)] -= record->size;
+	++count_deleted;
+	while(first_active < sorted_count && (records[first_active].flags & _rf_deleted)) {
+		++first_active;
+	}
+}
+
+void CleanSpool::cSpoolIndex::_removeLastDateHours(int hours) {
+	for(u_int64_t i = sorted_count; i < count; i++) {
+		if(getNumberOfHourToNow(getDateStr(records[i].date).c_str(), max((int)records[i].hour, 0)) <= hours) {
+			_erase(&records[i]);
+		}
+	}
+	for(u_int64_t i = sorted_count; i > first_active; i--) {
+		if(getNumberOfHourToNow(getDateStr(records[i - 1].date).c_str(), max((int)records[i - 1].hour, 0)) > hours) {
+			break;
+		}
+		_erase(&records[i - 1]);
+	}
+}
+
+CleanSpool::cSpoolIndex::eSizeType CleanSpool::cSpoolIndex::getSizeType(u_int8_t type) {
+	switch(type) {
+	case tsf_rtp:
+		return(_st_rtp);
+	case tsf_graph:
+		return(_st_graph);
+	case tsf_audio:
+		return(_st_audio);
+	default:
+		return(_st_sip);
+	}
+}
+
+string CleanSpool::cSpoolIndex::getDateStr(u_int32_t date) {
+	char date_str[20];
+	snprintf(date_str, sizeof(date_str), "%04u-%02u-%02u", date / 10000, date / 100 % 100, date % 100);
+	return(date_str);
+}
+
+bool CleanSpool::cSpoolIndex::_open() {
+	if(map_data) {
+		return(true);
+	}
+	fd = ::open(fileName.c_str(), O_RDWR);
+	if(fd < 0) {
+		return(false);
+	}
+	struct stat st;
+	sHeader header;
+	if(fstat(fd, &st) ||
+	   (u_int64_t)st.st_size < sizeof(sHeader) ||
+	   pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+	   memcmp(header.magic, SPOOL_INDEX_MAGIC, sizeof(header.magic)) ||
+	   header.version != SPOOL_INDEX_VERSION ||
+	   header.record_size != sizeof(sRecord)) {
+		syslog(LOG_NOTICE, "cleanspool index: bad format of %s", fileName.c_str());
+		::close(fd);
+		fd = -1;
+		return(false);
+	}
+	count = (st.st_size - sizeof(sHeader)) / sizeof(sRecord);
+	if((st.st_size - sizeof(sHeader)) % sizeof(sRecord)) {
+		// incomplete record after crash
+		if(ftruncate(fd, sizeof(sHeader) + count * sizeof(sRecord))) {
+			syslog(LOG_ERR, "cleanspool index: error truncate %s", fileName.c_str());
+		}
+	}
+	sorted_count = min(header.sorted_count, count);
+	map_size = sizeof(sHeader) + count * sizeof(sRecord);
+	void *_map_data = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(_map_data == MAP_FAILED) {
+		syslog(LOG_ERR, "cleanspool index: error mmap %s", fileName.c_str());
+		::close(fd);
+		fd = -1;
+		return(false);
+	}
+	map_data = (u_char*)_map_data;
+	records = (sRecord*)(map_data + sizeof(sHeader));
+	first_active = 0;
+	count_deleted = 0;
+	memset(sum_size, 0, sizeof(sum_size));
+	for(u_int64_t i = 0; i < count; i++) {
+		if(records[i].flags & _rf_deleted) {
+			++count_deleted;
+			if(first_active == i && i < sorted_count) {
+				++first_active;
+			}
+		} else {
+			sum_size[getSizeType(records[i].type)] += records[i].size;
+		}
+	}
+	fd_append = ::open(fileName.c_str(), O_WRONLY | O_APPEND);
+	return(true);
+}
+
+void CleanSpool::cSpoolIndex::_close() {
+	if(map_data) {
+		munmap(map_data, map_size);
+		map_data = NULL;
+		map_size = 0;
+		records = NULL;
+	}
+	if(fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+	if(fd_append >= 0) {
+		::close(fd_append);
+		fd_append = -1;
+	}
+	count = 0;
+	sorted_count = 0;
+	first_active = 0;
+	count_deleted = 0;
+	memset(sum_size, 0, sizeof(sum_size));
+}
+
+void CleanSpool::cSpoolIndex::_write(int fd, sRecord *records, unsigned count) {
+	if(fd < 0 || !count) {
+		return;
+	}
+	size_t length = count * sizeof(sRecord);
+	if(::write(fd, records, length) != (ssize_t)length) {
+		syslog(LOG_ERR, "cleanspool index: error write to %s", (fileName + (fd == fd_rebuild ? ".rebuild" : "")).c_str());
+	}
+}
+
+void CleanSpool::cSpoolIndex::_flushPending() {
+	if(pending.size()) {
+		_write(fd_rebuild >= 0 ? fd_rebuild : fd_append, &pending[0], pending.size());
+		pending.clear();
+	}
+	scanning = false;
+	scanned_date_hours.clear();
+}
+
+bool CleanSpool::cSpoolIndex::write(const char *fileName, sRecord *records, u_int64_t count) {
+	int _fd = ::open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(_fd < 0) {
+		return(false);
+	}
+	sHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SPOOL_INDEX_MAGIC, sizeof(header.magic));
+	header.version = SPOOL_INDEX_VERSION;
+	header.record_size = sizeof(sRecord);
+	header.sorted_count = count;
+	bool ok = ::write(_fd, &header, sizeof(header)) == sizeof(header);
+	if(ok && count) {
+		size_t length = count * sizeof(sRecord);
+		ok = ::write(_fd, records, length) == (ssize_t)length;
+	}
+	::close(_fd);
+	return(ok);
+}
+
+
+/* append / rebuild / update after restart / compact / erase on temporary index file
+ * - records of new files appended while the spool is scanned are written once: dropped if the scan counts the hour later,
+ *   kept if the scan has already passed the hour or does not visit it
+ * - records appended before the index is opened are not lost */
+bool CleanSpool::cSpoolIndex::test() {
+	bool ok = true;
+	string testFileName = "/tmp/voipmonitor_spool_index_test_" + intToString(getpid());
+	#define SPOOL_INDEX_TEST_CHECK(cond, text) \
+		if(!(cond)) { cout << "spool index test: " << text << endl; ok = false; }
+	struct sTestRecord {
+		static sRecord create(u_int32_t date, int hour, u_int8_t type, int64_t size) {
+			sRecord record;
+			record.date = date;
+			record.hour = hour;
+			record.minute = 0;
+			record.type = type;
+			record.spool = 0;
+			record.sensor = 0;
+			record.size = size;
+			return(record);
+		}
+	};
+	time_t now = time(NULL);
+	struct tm now_tm = time_r(&now);
+	u_int32_t now_date = (now_tm.tm_year + 1900) * 10000 + (now_tm.tm_mon + 1) * 100 + now_tm.tm_mday;
+	int now_hour = now_tm.tm_hour;
+	sRecord old_sip_1 = sTestRecord::create(20200101, 1, tsf_sip, 0);
+	sRecord old_rtp_2 = sTestRecord::create(20200101, 2, tsf_rtp, 0);
+	sRecord old_sip_3 = sTestRecord::create(20200101, 3, tsf_sip, 0);
+	sRecord old_graph_4 = sTestRecord::create(20200101, 4, tsf_graph, 0);
+	sRecord now_sip = sTestRecord::create(now_date, now_hour, tsf_sip, 0);
+	sRecord record;
+	unlink(testFileName.c_str());
+	{
+		cSpoolIndex index;
+		index.setFileName(testFileName);
+		// before open - kept
+		record = old_sip_1; record.size = 10; index.append(&record, 1);
+		record = old_graph_4; record.size = 4; index.append(&record, 1);
+		SPOOL_INDEX_TEST_CHECK(!index.open(), "open of not existing index");
+		SPOOL_INDEX_TEST_CHECK(index.beginRebuild(), "beginRebuild");
+		// hour 1 scanned - pending record of hour 1 is counted by scan
+		record = old_sip_1; record.size = 100; index.appendScanned(&record, 1);
+		// hour 1 already scanned - written
+		record = old_sip_1; record.size = 1; index.append(&record, 1);
+		// hour 2 not scanned yet - counted by scan
+		record = old_rtp_2; record.size = 20; index.append(&record, 1);
+		record = old_rtp_2; record.size = 200; index.appendScanned(&record, 1);
+		// hour 3 is not visited by scan - kept
+		record = old_sip_3; record.size = 3; index.append(&record, 1);
+		SPOOL_INDEX_TEST_CHECK(index.endRebuild(), "endRebuild");
+		long long sip, rtp, graph, audio;
+		long long sum = index.getSplitSumSize(&sip, &rtp, &graph, &audio);
+		SPOOL_INDEX_TEST_CHECK(sum == 308 && sip == 104 && rtp == 200 && graph == 4 && audio == 0,
+				       "after rebuild sum " << sum << " sip " << sip << " rtp " << rtp << " graph " << graph << " (expected 308 104 200 4)");
+		SPOOL_INDEX_TEST_CHECK(index.getMin(true, true, true, true, &record) && record.eqKey(old_sip_1) && record.size == 101,
+				       "after rebuild min record size " << record.size << " (expected 101)");
+		// appended to open index - read by compact
+		record = now_sip; record.size = 1000; index.append(&record, 1);
+		SPOOL_INDEX_TEST_CHECK(index.compact(), "compact");
+		SPOOL_INDEX_TEST_CHECK(index.getSumSize() == 1308, "after compact sum " << index.getSumSize() << " (expected 1308)");
+		index.close();
+	}
+	{
+		// restart - records of last hours are scanned again
+		cSpoolIndex index;
+		index.setFileName(testFileName);
+		record = now_sip; record.size = 5; index.append(&record, 1);
+		map<uint64_t, bool> dateHours;
+		SPOOL_INDEX_TEST_CHECK(index.beginUpdate(12, &dateHours), "beginUpdate");
+		SPOOL_INDEX_TEST_CHECK(dateHours.size() == 4 && dateHours.find(now_date * 100ull + now_hour) == dateHours.end(),
+				       "date hours after restart " << dateHours.size() << " (expected 4 without current hour)");
+		SPOOL_INDEX_TEST_CHECK(index.getSumSize() == 308, "after remove of last hours sum " << index.getSumSize() << " (expected 308)");
+		record = now_sip; record.size = 6; index.append(&record, 1);
+		record = now_sip; record.size = 2000; index.appendScanned(&record, 1);
+		record = now_sip; record.size = 7; index.append(&record, 1);
+		index.endUpdate();
+		record = now_sip; record.size = 8; index.append(&record, 1);
+		SPOOL_INDEX_TEST_CHECK(index.compact(), "compact after restart");
+		SPOOL_INDEX_TEST_CHECK(index.getSumSize() == 2323, "after restart sum " << index.getSumSize() << " (expected 2323)");
+		// clean
+		SPOOL_INDEX_TEST_CHECK(index.getMin(false, true, false, false, &record) && record.eqKey(old_rtp_2), "min rtp record");
+		index.erase(&record);
+		SPOOL_INDEX_TEST_CHECK(index.getSumSize() == 2123, "after erase sum " << index.getSumSize() << " (expected 2123)");
+		SPOOL_INDEX_TEST_CHECK(!index.getMin(false, true, false, false, &record), "min rtp record after erase");
+		SPOOL_INDEX_TEST_CHECK(index.getMin(true, true, true, true, &record) && record.eqKey(old_sip_1), "min record after erase");
+		index.close();
+		SPOOL_INDEX_TEST_CHECK(index.open() && index.getSumSize() == 2123, "after reopen sum " << index.getSumSize() << " (expected 2123)");
+		index.close();
+	}
+	#undef SPOOL_INDEX_TEST_CHECK
+	unlink(testFileName.c_str());
+	return(ok);
+}
 
 CleanSpool::CleanSpool(int spoolIndex) {
 	this->spoolIndex = spoolIndex;
@@ -332,6 +915,7 @@ CleanSpool::CleanSpool(int spoolIndex) {
 	lastRunLoadSpoolDataDir = 0;
 	counterLoadSpoolDataDir = 0;
 	force_reindex_spool_flag = false;
+	spoolDataIndex.setFileName(getSpoolDir_string(tsf_main) + '/' + INDEX_NAME);
 }
 
 CleanSpool::~CleanSpool() {
@@ -342,7 +926,18 @@ CleanSpool::~CleanSpool() {
 }
 
 void CleanSpool::addFile(const char *ymdh, eTypeSpoolFile typeSpoolFile, const char *file, long long int size) {
-	if(!opt_newdir || !opt_cleanspool_use_files) {
+	if(!opt_newdir) {
+		return;
+	}
+	if(useSpoolDataIndex()) {
+		cSpoolIndex::sRecord record;
+		if(spoolPathToIndexRecord(file, typeSpoolFile, &record)) {
+			record.size = size;
+			spoolDataIndex.append(&record, 1);
+		}
+		return;
+	}
+	if(!opt_cleanspool_use_files) {
 		return;
 	}
 	string column = string(getSpoolTypeFilesIndex(typeSpoolFile, true)) + "size";
@@ -490,7 +1085,11 @@ string CleanSpool::getMaxSpoolDate() {
 }
 
 void CleanSpool::getSumSizeByDate(map<string, long long> *sizeByDate) {
-	spoolData.getSumSizeByDate(sizeByDate);
+	if(useSpoolDataIndex()) {
+		spoolDataIndex.getSumSizeByDate(sizeByDate);
+	} else {
+		spoolData.getSumSizeByDate(sizeByDate);
+	}
 }
 
 string CleanSpool::printSumSizeByDate() {
@@ -766,6 +1365,10 @@ unsigned CleanSpool::date_to_int(const char *date) {
 }
 
 void CleanSpool::reloadSpoolDataDir(bool enableCacheLoad, bool enableCacheSave) {
+	if(useSpoolDataIndex()) {
+		updateSpoolDataIndex(true);
+		return;
+	}
 	int no_cache_last_hours = 12 + (lastRunLoadSpoolDataDir ? (time(NULL) - lastRunLoadSpoolDataDir) / (60 * 60) : 0);
 	spoolData.lock();
 	spoolData.clearAll();
@@ -785,19 +1388,24 @@ void CleanSpool::updateSpoolDataDir() {
 	if(force_reindex_spool_flag) {
 		reloadSpoolDataDir(false, true);
 		return;
-	} else if(!lastRunLoadSpoolDataDir || spoolData.isEmpty()) {
+	} else if(!useSpoolDataIndex() && (!lastRunLoadSpoolDataDir || spoolData.isEmpty())) {
 		reloadSpoolDataDir(true, true);
 		return;
 	} else {
 		time_t now;
 		time(&now);
 		struct tm dateTime = time_r(&now);
-		if(dateTime.tm_hour >= 2 && dateTime.tm_hour < 4 &&
+		if(!useSpoolDataIndex() &&
+		   dateTime.tm_hour >= 2 && dateTime.tm_hour < 4 &&
 		   counterLoadSpoolDataDir && !(counterLoadSpoolDataDir % 10)) {
 			reloadSpoolDataDir(false, true);
 			return;
 		}
 	}
+	if(useSpoolDataIndex()) {
+		updateSpoolDataIndex(false);
+		return;
+	}
 	int no_cache_last_hours = 12 + (lastRunLoadSpoolDataDir ? (time(NULL) - lastRunLoadSpoolDataDir) / (60 * 60) : 0);
 	spoolData.lock();
 	spoolData.removeLastDateHours(no_cache_last_hours);
@@ -977,6 +1585,9 @@ void CleanSpool::loadSpoolDataDir(cSpoolData *spoolData, sSpoolDataDirIndex inde
 					   params.enable_cache_save) {
 						spoolData->saveHourCacheFile(indexHour);
 					}
+					if(params.flush_to_index) {
+						flushSpoolDataToIndex(spoolData, &params);
+					}
 				}
 			    #else
 				if(spoolData->existsDateHourInCheckMap(index.date.c_str(), hour)) {
@@ -1020,6 +1631,181 @@ void CleanSpool::loadSpoolDataDir(cSpoolData *spoolData, sSpoolDataDirIndex inde
 		}
 		closedir(dp);
 	}
+	if(params.flush_to_index) {
+		flushSpoolDataToIndex(spoolData, &params);
+	}
+}
+
+bool CleanSpool::useSpoolDataIndex() {
+	extern bool opt_cleanspool_index;
+	return(opt_cleanspool_index && !opt_cleanspool_use_files);
+}
+
+void CleanSpool::updateSpoolDataIndex(bool rebuild) {
+	if(!rebuild && !spoolDataIndex.isOpen() && lastRunLoadSpoolDataDir && !spoolDataIndex.open()) {
+		rebuild = true;
+	}
+	cSpoolData spoolDataLoad;
+	sLoadParams params;
+	params.flush_to_index = &spoolDataIndex;
+	sSpoolDataDirIndex index;
+	if(rebuild) {
+		syslog(LOG_NOTICE, "cleanspool[%i]: rebuild spool index", spoolIndex);
+		if(!spoolDataIndex.beginRebuild()) {
+			return;
+		}
+		params.flush_to_index_rebuild = true;
+		loadSpoolDataDir(&spoolDataLoad, index, "", params);
+		if(is_terminating()) {
+			return;
+		}
+		spoolDataIndex.endRebuild();
+	} else {
+		if(!lastRunLoadSpoolDataDir) {
+			// after restart the records of the last hours can be incomplete - reload them from spool directories
+			int no_cache_last_hours = 12;
+			map<uint64_t, bool> dateHours;
+			if(!spoolDataIndex.beginUpdate(no_cache_last_hours, &dateHours)) {
+				updateSpoolDataIndex(true);
+				return;
+			}
+			spoolDataLoad.setDateHoursCheckMap(&dateHours);
+			loadSpoolDataDir(&spoolDataLoad, index, "", params);
+			if(is_terminating()) {
+				return;
+			}
+			spoolDataIndex.endUpdate();
+		}
+		spoolDataIndex.compact();
+	}
+	lastRunLoadSpoolDataDir = time(NULL);
+	++counterLoadSpoolDataDir;
+}
+
+void CleanSpool::flushSpoolDataToIndex(cSpoolData *spoolData, sLoadParams *params) {
+	map<sSpoolDataDirIndex, sSpoolDataDirItem> *data = spoolData->getData();
+	if(!data->size()) {
+		return;
+	}
+	vector<cSpoolIndex::sRecord> records;
+	for(map<sSpoolDataDirIndex, sSpoolDataDirItem>::iterator iter = data->begin(); iter != data->end(); iter++) {
+		if(iter->second.is_dir) {
+			continue;
+		}
+		cSpoolIndex::sRecord record;
+		// files outside of hour dirs are not in date/hour check map - they are taken only from full rebuild
+		if(spoolPathToIndexRecord(iter->second.path.c_str(), tsf_na, &record) &&
+		   (params->flush_to_index_rebuild || record.hour >= 0)) {
+			record.size = iter->second.size;
+			records.push_back(record);
+		}
+	}
+	if(records.size()) {
+		params->flush_to_index->appendScanned(&records[0], records.size());
+	}
+	spoolData->clearAll();
+}
+
+bool CleanSpool::spoolPathToIndexRecord(const char *path, eTypeSpoolFile typeSpoolFile, cSpoolIndex::sRecord *record) {
+	list<string> spool_dirs;
+	this->getSpoolDirs(&spool_dirs);
+	int spool = -1;
+	size_t spoolLength = 0;
+	int i = 0;
+	for(list<string>::iterator iter_sd = spool_dirs.begin(); iter_sd != spool_dirs.end(); iter_sd++, i++) {
+		if(iter_sd->length() > spoolLength &&
+		   !strncmp(path, iter_sd->c_str(), iter_sd->length()) &&
+		   (path[iter_sd->length()] == '/' || !path[iter_sd->length()])) {
+			spool = i;
+			spoolLength = iter_sd->length();
+		}
+	}
+	if(spool < 0 && typeSpoolFile != tsf_na) {
+		// path relative to spool dir
+		string spoolDir = getSpoolDir_string(typeSpoolFile);
+		i = 0;
+		for(list<string>::iterator iter_sd = spool_dirs.begin(); iter_sd != spool_dirs.end(); iter_sd++, i++) {
+			if(*iter_sd == spoolDir) {
+				spool = i;
+				break;
+			}
+		}
+	}
+	if(spool < 0) {
+		return(false);
+	}
+	vector<string> dirs = split(path + spoolLength, "/");
+	unsigned pos = 0;
+	while(pos < dirs.size() && !check_date_dir(dirs[pos].c_str())) {
+		++pos;
+	}
+	if(pos >= dirs.size() || pos > 1) {
+		return(false);
+	}
+	if(pos == 1) {
+		if(dirs[0].find_first_not_of("0123456789") != string::npos) {
+			return(false);
+		}
+		record->sensor = atoi(dirs[0].c_str());
+	}
+	record->spool = spool;
+	record->date = date_to_int(dirs[pos++].c_str());
+	if(pos < dirs.size() && check_hour_dir(dirs[pos].c_str())) {
+		record->hour = atoi(dirs[pos++].c_str());
+		if(pos < dirs.size() && check_minute_dir(dirs[pos].c_str())) {
+			record->minute = atoi(dirs[pos++].c_str());
+		}
+	}
+	if(pos < dirs.size() && check_type_dir(dirs[pos].c_str())) {
+		record->type = getSpoolTypeFile(dirs[pos].c_str());
+	}
+	return(true);
+}
+
+string CleanSpool::spoolIndexRecordToPath(cSpoolIndex::sRecord *record, sSpoolDataDirIndex *dirIndex) {
+	static const char *type_dirs[] = { NULL, "SIP", "REG", "SKINNY", "MGCP", "SS7", "RTP", "GRAPH", "AUDIO", "ALL" };
+	list<string> spool_dirs;
+	this->getSpoolDirs(&spool_dirs);
+	list<string>::iterator iter_sd = spool_dirs.begin();
+	for(int i = 0; i < record->spool && iter_sd != spool_dirs.end(); i++) {
+		iter_sd++;
+	}
+	if(iter_sd == spool_dirs.end()) {
+		return("");
+	}
+	char hm[3];
+	string path = *iter_sd;
+	if(record->sensor >= 0) {
+		path += '/' + intToString(record->sensor);
+	}
+	path += '/' + cSpoolIndex::getDateStr(record->date);
+	if(record->hour >= 0) {
+		snprintf(hm, sizeof(hm), "%02i", record->hour);
+		path += '/' + string(hm);
+	}
+	if(record->minute >= 0) {
+		snprintf(hm, sizeof(hm), "%02i", record->minute);
+		path += '/' + string(hm);
+	}
+	if(record->type > tsf_na && record->type <= tsf_all) {
+		path += '/' + string(type_dirs[record->type]);
+	}
+	if(dirIndex) {
+		dirIndex->spool = *iter_sd;
+		dirIndex->sensor = record->sensor >= 0 ? intToString(record->sensor) : "";
+		dirIndex->date = cSpoolIndex::getDateStr(record->date);
+		dirIndex->hour = record->hour;
+		dirIndex->minute = record->minute;
+		dirIndex->type = record->type > tsf_na && record->type <= tsf_all ? type_dirs[record->type] : "";
+		dirIndex->_type = (eTypeSpoolFile)record->type;
+	}
+	return(path);
+}
+
+long long CleanSpool::getSpoolDataSumSize() {
+	return(useSpoolDataIndex() ?
+		spoolDataIndex.getSumSize() :
+		spoolData.getSumSize());
 }
 
 void CleanSpool::loadOpt() {
@@ -1177,6 +1963,8 @@ void CleanSpool::cleanThreadProcess() {
 			if(opt_cleanspool_use_files) {
 				syslog(LOG_NOTICE, "cleanspool[%i]: low spool disk space - executing reindex_all", spoolIndex);
 				reindex_all("call from clean_spooldir - low spool disk space");
+			} else if(useSpoolDataIndex()) {
+				updateSpoolDataIndex(false);
 			} else {
 				syslog(LOG_NOTICE, "cleanspool[%i]: low spool disk space - executing reloadSpoolDataDir", spoolIndex);
 				reloadSpoolDataDir(false, true);
@@ -1208,7 +1996,7 @@ void CleanSpool::cleanThreadProcess() {
 				}
 				delete sqlDb;
 			} else {
-				usedSizeGB = (double)spoolData.getSumSize() / (1024 * 1024 * 1024);
+				usedSizeGB = (double)getSpoolDataSumSize() / (1024 * 1024 * 1024);
 			}
 			maxpoolsize = (usedSizeGB + freeSpaceGB - min(totalSpaceGB * opt_other.autocleanspoolminpercent / 100, (double)opt_other.autocleanmingb)) * 1024;
 			if(maxpoolsize > 1000 &&
@@ -1713,7 +2501,9 @@ void CleanSpool::erase_dir(string dir, sSpoolDataDirIndex index, string callFrom
 		return;
 	}
 	syslog(LOG_NOTICE, "cleanspool[%i]: call erase_dir(%s) from %s", spoolIndex, dir.c_str(), callFrom.c_str());
-	spoolData.deleteHourCacheFile(index);
+	if(!useSpoolDataIndex()) {
+		spoolData.deleteHourCacheFile(index);
+	}
 	DIR* dp = opendir(dir.c_str());
 	if(dp) {
 		dirent* de;
@@ -2043,6 +2833,7 @@ void CleanSpool::clean_maxpoolsize(bool sip, bool rtp, bool graph, bool audio) {
 			}
 		}
 	} else {
+		bool useIndex = useSpoolDataIndex();
 		this->spoolData.lock();
 		while(!is_terminating() && !DISABLE_CLEANSPOOL) {
 			long long allsize_total;
@@ -2050,7 +2841,9 @@ void CleanSpool::clean_maxpoolsize(bool sip, bool rtp, bool graph, bool audio) {
 			long long rtpsize_total;
 			long long graphsize_total;
 			long long audiosize_total;
-			allsize_total = this->spoolData.getSplitSumSize(&sipsize_total, &rtpsize_total, &graphsize_total, &audiosize_total);
+			allsize_total = useIndex ?
+					 this->spoolDataIndex.getSplitSumSize(&sipsize_total, &rtpsize_total, &graphsize_total, &audiosize_total) :
+					 this->spoolData.getSplitSumSize(&sipsize_total, &rtpsize_total, &graphsize_total, &audiosize_total);
 			double total = (all ? 
 					 allsize_total : 
 					 ((sip ? sipsize_total : 0) + 
@@ -2076,6 +2869,16 @@ void CleanSpool::clean_maxpoolsize(bool sip, bool rtp, bool graph, bool audio) {
 			   total <= reduk_maxpoolsize) {
 				break;
 			}
+			if(useIndex) {
+				cSpoolIndex::sRecord record;
+				if(!this->spoolDataIndex.getMin(sip, rtp, graph, audio, &record)) {
+					break;
+				}
+				sSpoolDataDirIndex dirIndex;
+				erase_dir(spoolIndexRecordToPath(&record, &dirIndex), dirIndex, "clean_maxpoolsize");
+				this->spoolDataIndex.erase(&record);
+				continue;
+			}
 			map<sSpoolDataDirIndex, sSpoolDataDirItem>::iterator iter = this->spoolData.getBegin();
 			if(iter != this->spoolData.end() &&
 			   iter->second.is_dir &&
@@ -2212,8 +3015,20 @@ void CleanSpool::clean_maxpooldays(bool sip, bool rtp, bool graph, bool audio) {
 			}
 		}
 	} else {
+		bool useIndex = useSpoolDataIndex();
 		this->spoolData.lock();
 		while(!is_terminating() && !DISABLE_CLEANSPOOL) {
+			if(useIndex) {
+				cSpoolIndex::sRecord record;
+				if(!this->spoolDataIndex.getMin(sip, rtp, graph, audio, &record) ||
+				   getNumberOfDayToNow(cSpoolIndex::getDateStr(record.date).c_str()) <= (int)maxpooldays) {
+					break;
+				}
+				sSpoolDataDirIndex dirIndex;
+				erase_dir(spoolIndexRecordToPath(&record, &dirIndex), dirIndex, "clean_maxpooldays");
+				this->spoolDataIndex.erase(&record);
+				continue;
+			}
 			map<sSpoolDataDirIndex, sSpoolDataDirItem>::iterator iter = this->spoolData.getBegin();
 			if(iter != this->spoolData.end() &&
 			   iter->second.is_dir &&
@@ -2379,7 +3194,7 @@ void CleanSpool::test_load(string type) {
 		}
 		unsigned long end = getTimeMS();
 		cout << (end - start) / 1000. << "s" << endl;
-		cout << spoolData.getSumSize() << endl;
+		cout << getSpoolDataSumSize() << endl;
 		cout << printSumSizeByDate();
 		//
 		cout << "reloadSpoolDataDir with load cache" <<  endl;
@@ -2390,7 +3205,7 @@ void CleanSpool::test_load(string type) {
 		}
 		end = getTimeMS();
 		cout << (end - start) / 1000. << "s" << endl;
-		cout << spoolData.getSumSize() << endl;
+		cout << getSpoolDataSumSize() << endl;
 		cout << printSumSizeByDate();
 		//
 		cout << "updateSpoolDataDir" <<  endl;
@@ -2401,7 +3216,7 @@ void CleanSpool::test_load(string type) {
 		}
 		end = getTimeMS();
 		cout << (end - start) / 1000. << "s" << endl;
-		cout << spoolData.getSumSize() << endl;
+		cout << getSpoolDataSumSize() << endl;
 		cout << printSumSizeByDate();
 	} else if(type == "cache" || type == "no-cache" || type == "refresh-cache") {
 		unsigned long start = getTimeMS();
@@ -2411,7 +3226,7 @@ void CleanSpool::test_load(string type) {
 		}
 		unsigned long end = getTimeMS();
 		cout << (end - start) / 1000. << "s" << endl;
-		cout << spoolData.getSumSize() << endl;
+		cout << getSpoolDataSumSize() << endl;
 		cout << printSumSizeByDate();
 	}
 }
@@ -2624,7 +3439,7 @@ void CleanSpool::force_reindex_spool() {
 }
 
 string CleanSpool::print_spool() {
-	return(intToString(spoolData.getSumSize()) + "\r\n" + printSumSizeByDate());
+	return(intToString(getSpoolDataSumSize()) + "\r\n" + printSumSizeByDate());
 }
 
 unsigned int CleanSpool::get_reduk_maxpoolsize(unsigned int maxpoolsize) {
@@ -2,6 +2,8 @@
 #define CLEANSPOOL_H
 
 
+#include <set>
+
 #include "voipmonitor.h"
 #include "sql_db.h"
 
@@ -162,7 +164,13 @@ public:
 		bool loadHourCacheFile(sSpoolDataDirIndex index, string pathHour);
 		bool existsHourCacheFile(sSpoolDataDirIndex index, string pathHour);
 		bool deleteHourCacheFile(sSpoolDataDirIndex index);
+		map<sSpoolDataDirIndex, sSpoolDataDirItem> *getData() {
+			return(&data);
+		}
 		void fillDateHoursCheckMap();
+		void setDateHoursCheckMap(map<uint64_t, bool> *dateHours) {
+			date_hours_map = *dateHours;
+		}
 		void clearDateHoursCheckMap();
 		bool existsDateHourInCheckMap(const char *date, int hour);
 		void saveDeletedHourCacheFiles();
@@ -179,15 +187,133 @@ public:
 		list<sSpoolDataDirIndex> list_delete_hour_cache_files;
 		volatile int _sync;
 	};
+	class cSpoolIndex {
+	public:
+		struct sHeader {
+			char magic[8];
+			u_int32_t version;
+			u_int32_t record_size;
+			u_int64_t sorted_count;
+		};
+		struct sRecord {
+			sRecord() {
+				memset(this, 0, sizeof(*this));
+				hour = -1;
+				minute = -1;
+				sensor = -1;
+			}
+			bool eqKey(const sRecord& other) const {
+				return(this->date == other.date &&
+				       this->hour == other.hour &&
+				       this->minute == other.minute &&
+				       this->spool == other.spool &&
+				       this->sensor == other.sensor &&
+				       this->type == other.type);
+			}
+			bool operator < (const sRecord& other) const {
+				return(this->date < other.date ? 1 : this->date > other.date ? 0 :
+				       this->hour < other.hour ? 1 : this->hour > other.hour ? 0 :
+				       this->minute < other.minute ? 1 : this->minute > other.minute ? 0 :
+				       this->spool < other.spool ? 1 : this->spool > other.spool ? 0 :
+				       this->sensor < other.sensor ? 1 : this->sensor > other.sensor ? 0 :
+				       this->type < other.type);
+			}
+			u_int32_t date;		// YYYYMMDD
+			int8_t hour;		// -1 if not set
+			int8_t minute;		// -1 if not set
+			u_int8_t type;		// eTypeSpoolFile of type dir (tsf_all for ALL), tsf_na if not set
+			u_int8_t spool;		// index in getSpoolDirs
+			int32_t sensor;		// -1 if not set
+			u_int32_t flags;
+			int64_t size;
+		};
+		enum eRecordFlags {
+			_rf_deleted = 1
+		};
+		enum eSizeType {
+			_st_sip,
+			_st_rtp,
+			_st_graph,
+			_st_audio,
+			_st_count
+		};
+	public:
+		cSpoolIndex();
+		~cSpoolIndex();
+		void setFileName(string fileName) {
+			this->fileName = fileName;
+		}
+		bool open();
+		void close();
+		bool isOpen() {
+			return(map_data != NULL);
+		}
+		void append(sRecord *records, unsigned count);
+		void appendScanned(sRecord *records, unsigned count);
+		bool compact();
+		bool beginRebuild();
+		bool endRebuild();
+		bool beginUpdate(int lastHours, map<uint64_t, bool> *dateHours);
+		void endUpdate();
+		long long getSumSize();
+		long long getSplitSumSize(long long *sip, long long *rtp, long long *graph, long long *audio);
+		void getSumSizeByDate(map<string, long long> *sizeByDate);
+		void getDateHours(map<uint64_t, bool> *dateHours);
+		bool getMin(bool sip, bool rtp, bool graph, bool audio, sRecord *record);
+		void erase(sRecord *record);
+		void removeLastDateHours(int hours);
+		static eSizeType getSizeType(u_int8_t type);
+		static string getDateStr(u_int32_t date);
+		static bool test();
+	private:
+		bool _open();
+		void _close();
+		void _getDateHours(map<uint64_t, bool> *dateHours);
+		void _erase(sRecord *record);
+		void _removeLastDateHours(int hours);
+		void _write(int fd, sRecord *records, unsigned count);
+		void _flushPending();
+		bool write(const char *fileName, sRecord *records, u_int64_t count);
+		static u_int64_t getDateHourKey(sRecord *record) {
+			return(record->date * 100ull + (record->hour >= 0 ? record->hour : 99));
+		}
+		void lock() {
+			__SYNC_LOCK(_sync);
+		}
+		void unlock() {
+			__SYNC_UNLOCK(_sync);
+		}
+	private:
+		string fileName;
+		int fd;
+		int fd_append;
+		int fd_rebuild;
+		u_char *map_data;
+		size_t map_size;
+		sRecord *records;
+		u_int64_t count;
+		u_int64_t sorted_count;
+		u_int64_t first_active;
+		u_int64_t count_deleted;
+		long long sum_size[_st_count];
+		bool scanning;
+		set<u_int64_t> scanned_date_hours;
+		vector<sRecord> pending;
+		volatile int _sync;
+	};
 	struct sLoadParams {
 		sLoadParams() {
 			enable_cache_load = false;
 			enable_cache_save = false;
 			no_cache_last_hours = 0;
+			flush_to_index = NULL;
+			flush_to_index_rebuild = false;
 		}
 		bool enable_cache_load;
 		bool enable_cache_save;
 		int no_cache_last_hours;
+		cSpoolIndex *flush_to_index;
+		bool flush_to_index_rebuild;
 	};
 public:
 	CleanSpool(int spoolIndex);
@@ -226,6 +352,12 @@ private:
 	void reloadSpoolDataDir(bool enableCacheLoad, bool enableCacheSave);
 	void updateSpoolDataDir();
 	void loadSpoolDataDir(cSpoolData *spoolData, sSpoolDataDirIndex index, string path, sLoadParams params);
+	bool useSpoolDataIndex();
+	void updateSpoolDataIndex(bool rebuild);
+	void flushSpoolDataToIndex(cSpoolData *spoolData, sLoadParams *params);
+	bool spoolPathToIndexRecord(const char *path, eTypeSpoolFile typeSpoolFile, cSpoolIndex::sRecord *record);
+	string spoolIndexRecordToPath(cSpoolIndex::sRecord *record, sSpoolDataDirIndex *dirIndex = NULL);
+	long long getSpoolDataSumSize();
 	void loadOpt();
 	void runCleanThread();
 	void termCleanThread();
@@ -326,6 +458,7 @@ private:
 	bool suspended;
 	volatile int clean_spooldir_run_processing;
 	cSpoolData spoolData;
+	cSpoolIndex spoolDataIndex;
 	time_t lastRunLoadSpoolDataDir;
 	unsigned counterLoadSpoolDataDir;
 	bool force_reindex_spool_flag;
@@ -12,6 +12,7 @@
 #include <errno.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 
 
 extern bool CR_TERMINATE();
@@ -844,6 +845,7 @@ void cSocket::sleep(int s) {
 cSocketBlock::cSocketBlock(const char *name, bool autoClose)
  : cSocket(name, autoClose) {
 	block_header_string = NULL;
+	readBufferComplete = false;
 }
 
 cSocketBlock::~cSocketBlock() {
@@ -942,38 +944,7 @@ u_char *cSocketBlock::readBlock(size_t *dataLen, eTypeEncode typeEncode, string
 				}
 				if(blockHeaderOK) {
 					if(readBuffer.length >= readBuffer.lengthBlockHeader(true)) {
-						if(typeEncode == _te_xor && !xor_key.empty()) {
-							xorData(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.lengthBlockHeader(), xor_key.c_str(), xor_key.length(), 0);
-						} else if(typeEncode == _te_rsa && rsa.isSetPrivKey()) {
-							u_char *rsa_data = readBuffer.buffer + sizeof(sBlockHeader);
-							size_t rsa_data_len = readBuffer.lengthBlockHeader();
-							if(rsa.private_decrypt(&rsa_data, &rsa_data_len, false)) {
-								size_t new_buffer_length = rsa_data_len + sizeof(sBlockHeader);
-								u_char *new_buffer = new FILE_LINE(0) u_char[new_buffer_length];
-								memcpy(new_buffer, readBuffer.buffer, sizeof(sBlockHeader));
-								((sBlockHeader*)new_buffer)->length = rsa_data_len;
-								memcpy(new_buffer + sizeof(sBlockHeader), rsa_data, rsa_data_len);
-								readBuffer.set(new_buffer, new_buffer_length);
-								delete [] rsa_data;
-							} else {
-								rsltRead = false;
-							}
-						} else if(typeEncode == _te_aes) {
-							u_char *aes_data;
-							size_t aes_data_len;
-							if(aes.decrypt(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.lengthBlockHeader(), &aes_data, &aes_data_len, true)) {
-								size_t new_buffer_length = aes_data_len + sizeof(sBlockHeader);
-								u_char *new_buffer = new FILE_LINE(0) u_char[new_buffer_length];
-								memcpy(new_buffer, readBuffer.buffer, sizeof(sBlockHeader));
-								((sBlockHeader*)new_buffer)->length = aes_data_len;
-								memcpy(new_buffer + sizeof(sBlockHeader), aes_data, aes_data_len);
-								readBuffer.set(new_buffer, new_buffer_length);
-								delete [] aes_data;
-							} else  {
-								rsltRead = false;
-							}
-						}
-						if(rsltRead && !checkSumReadBuffer()) {
+						if(!decodeReadBuffer(typeEncode, xor_key)) {
 							rsltRead = false;
 						}
 						break;
@@ -991,6 +962,8 @@ u_char *cSocketBlock::readBlock(size_t *dataLen, eTypeEncode typeEncode, string
 				      min(maxReadLength, sizeof(sBlockHeader) - readBuffer.length);
 		}
 	} while(rsltRead);
+	// readBlockNonBlocking will start with new block
+	readBufferComplete = true;
 	if(rsltRead) {
 		*dataLen = readBuffer.lengthBlockHeader();
 		return(readBuffer.buffer + sizeof(sBlockHeader));
@@ -1000,6 +973,62 @@ u_char *cSocketBlock::readBlock(size_t *dataLen, eTypeEncode typeEncode, string
 	}
 }
 
+int cSocketBlock::readBlockNonBlocking(u_char **data, size_t *dataLen, eTypeEncode typeEncode, string xor_key, size_t bufferIncLength) {
+	*data = NULL;
+	*dataLen = 0;
+	if(isError() || !okHandle()) {
+		setError(_se_bad_connection, "read");
+		return(-1);
+	}
+	if(readBufferComplete) {
+		readBuffer.clear();
+		readBufferComplete = false;
+	}
+	while(true) {
+		bool blockHeaderOK = readBuffer.length >= sizeof(sBlockHeader);
+		// only the rest of current block is read - next block stays in socket buffer
+		size_t readLength = blockHeaderOK ?
+				     min((size_t)SERVER_REACTOR_READ_CHUNK, readBuffer.lengthBlockHeader(true) - readBuffer.length) :
+				     sizeof(sBlockHeader) - readBuffer.length;
+		readBuffer.needFreeSize(readLength, bufferIncLength);
+		ssize_t recvLen = recv(handle, readBuffer.buffer + readBuffer.length, readLength, MSG_DONTWAIT);
+		if(recvLen < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			if(errno == EAGAIN || errno == EWOULDBLOCK) {
+				return(0);
+			}
+			setError(_se_loss_connection, "failed read()");
+			return(-1);
+		}
+		if(recvLen == 0) {
+			// closed by client
+			setTerminate();
+			return(-1);
+		}
+		readBuffer.incLength(recvLen);
+		lastTimeOkRead = getTimeUS();
+		if(!blockHeaderOK && readBuffer.length >= sizeof(sBlockHeader)) {
+			if(!readBuffer.okBlockHeader(block_header_string)) {
+				setError("bad block header");
+				return(-1);
+			}
+		}
+		if(readBuffer.length >= sizeof(sBlockHeader) &&
+		   readBuffer.length >= readBuffer.lengthBlockHeader(true)) {
+			readBufferComplete = true;
+			if(!decodeReadBuffer(typeEncode, xor_key)) {
+				setError("bad block data");
+				return(-1);
+			}
+			*data = readBuffer.buffer + sizeof(sBlockHeader);
+			*dataLen = readBuffer.lengthBlockHeader();
+			return(1);
+		}
+	}
+}
+
 bool cSocketBlock::readBlock(string *str, eTypeEncode typeEncode, string xor_key, bool quietEwouldblock, u_int16_t timeout) {
 	u_char *data;
 	size_t dataLen;
@@ -1128,6 +1157,41 @@ void cSocketBlock::readDecodeAesAndResendTo(cSocketBlock *dest, u_char *remainde
 	}
 }
 
+bool cSocketBlock::decodeReadBuffer(eTypeEncode typeEncode, string xor_key) {
+	if(typeEncode == _te_xor && !xor_key.empty()) {
+		xorData(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.lengthBlockHeader(), xor_key.c_str(), xor_key.length(), 0);
+	} else if(typeEncode == _te_rsa && rsa.isSetPrivKey()) {
+		u_char *rsa_data = readBuffer.buffer + sizeof(sBlockHeader);
+		size_t rsa_data_len = readBuffer.lengthBlockHeader();
+		if(rsa.private_decrypt(&rsa_data, &rsa_data_len, false)) {
+			size_t new_buffer_length = rsa_data_len + sizeof(sBlockHeader);
+			u_char *new_buffer = new FILE_LINE(0) u_char[new_buffer_length];
+			memcpy(new_buffer, readBuffer.buffer, sizeof(sBlockHeader));
+			((sBlockHeader*)new_buffer)->length = rsa_data_len;
+			memcpy(new_buffer + sizeof(sBlockHeader), rsa_data, rsa_data_len);
+			readBuffer.set(new_buffer, new_buffer_length);
+			delete [] rsa_data;
+		} else {
+			return(false);
+		}
+	} else if(typeEncode == _te_aes) {
+		u_char *aes_data;
+		size_t aes_data_len;
+		if(aes.decrypt(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.lengthBlockHeader(), &aes_data, &aes_data_len, true)) {
+			size_t new_buffer_length = aes_data_len + sizeof(sBlockHeader);
+			u_char *new_buffer = new FILE_LINE(0) u_char[new_buffer_length];
+			memcpy(new_buffer, readBuffer.buffer, sizeof(sBlockHeader));
+			((sBlockHeader*)new_buffer)->length = aes_data_len;
+			memcpy(new_buffer + sizeof(sBlockHeader), aes_data, aes_data_len);
+			readBuffer.set(new_buffer, new_buffer_length);
+			delete [] aes_data;
+		} else  {
+			return(false);
+		}
+	}
+	return(checkSumReadBuffer());
+}
+
 bool cSocketBlock::checkSumReadBuffer() {
 	return(readBuffer.sumBlockHeader() ==
 	       dataSum(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.length - sizeof(sBlockHeader)));
@@ -1234,7 +1298,10 @@ cServerConnection::cServerConnection(cSocket *socket) {
 	this->socket = new FILE_LINE(0) cSocketBlock(NULL);
 	*(cSocket*)this->socket = *socket;
 	delete socket;
+	thread = 0;
 	begin_time_ms = getTimeMS();
+	reactor_type_encode = cSocket::_te_na;
+	reactor_buffer_inc_length = 0;
 }
 
 cServerConnection::~cServerConnection() {
@@ -1270,6 +1337,27 @@ void cServerConnection::connection_process() {
 void cServerConnection::evData(u_char *data, size_t dataLen) {
 }
 
+int cServerConnection::reactor_read() {
+	for(unsigned i = 0; i < SERVER_REACTOR_MAX_BLOCKS_PER_EVENT; i++) {
+		if(isTerminateSocket()) {
+			return(cServerReactor::_rr_close);
+		}
+		if(!reactor_can_read()) {
+			return(cServerReactor::_rr_wait);
+		}
+		u_char *data;
+		size_t dataLen;
+		int rsltRead = socket->readBlockNonBlocking(&data, &dataLen, reactor_type_encode, "", reactor_buffer_inc_length);
+		if(rsltRead < 0) {
+			return(cServerReactor::_rr_close);
+		} else if(rsltRead == 0) {
+			return(cServerReactor::_rr_continue);
+		}
+		evData(data, dataLen);
+	}
+	return(isTerminateSocket() ? cServerReactor::_rr_close : cServerReactor::_rr_continue);
+}
+
 void cServerConnection::setTerminateSocket() {
 	if(socket) {
 		socket->setTerminate();
@@ -1277,6 +1365,205 @@ void cServerConnection::setTerminateSocket() {
 }
 
 
+cServerReactor::cServerReactor(const char *name, unsigned countWorkers) {
+	this->name = name ? name : "";
+	this->countWorkers = countWorkers > 0 ? countWorkers : 1;
+	workers = NULL;
+	epoll_fd = -1;
+	next_id = 0;
+	last_housekeeping_ms = 0;
+	terminating = false;
+	_sync_lock = 0;
+}
+
+cServerReactor::~cServerReactor() {
+	stop();
+}
+
+bool cServerReactor::start() {
+	epoll_fd = epoll_create(1024);
+	if(epoll_fd < 0) {
+		syslog(LOG_ERR, "server reactor %s: epoll_create failed - %s", name.c_str(), strerror(errno));
+		return(false);
+	}
+	workers = new FILE_LINE(0) sWorker[countWorkers];
+	for(unsigned i = 0; i < countWorkers; i++) {
+		workers[i].reactor = this;
+		workers[i].index = i;
+		workers[i].thread = 0;
+		vm_pthread_create(("server reactor " + intToString(i) + " " + name).c_str(),
+				  &workers[i].thread, NULL, workerThreadFunction, &workers[i], __FILE__, __LINE__);
+	}
+	return(true);
+}
+
+void cServerReactor::stop() {
+	terminating = true;
+	if(workers) {
+		for(unsigned i = 0; i < countWorkers; i++) {
+			if(workers[i].thread) {
+				pthread_join(workers[i].thread, NULL);
+			}
+		}
+		delete [] workers;
+		workers = NULL;
+	}
+	lock();
+	list<cServerConnection*> connectionsForDelete;
+	for(map<u_int64_t, sConnection>::iterator iter = connections.begin(); iter != connections.end(); iter++) {
+		connectionsForDelete.push_back(iter->second.connection);
+	}
+	connections.clear();
+	unlock();
+	for(list<cServerConnection*>::iterator iter = connectionsForDelete.begin(); iter != connectionsForDelete.end(); iter++) {
+		delete *iter;
+	}
+	if(epoll_fd >= 0) {
+		::close(epoll_fd);
+		epoll_fd = -1;
+	}
+}
+
+bool cServerReactor::add(cServerConnection *connection) {
+	lock();
+	if(terminating || epoll_fd < 0) {
+		unlock();
+		return(false);
+	}
+	u_int64_t id = ++next_id;
+	sConnection conn;
+	conn.connection = connection;
+	conn.state = _cs_armed;
+	conn.last_data_ms = getTimeMS_rdtsc();
+	connections[id] = conn;
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLONESHOT;
+	event.data.u64 = id;
+	if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection->getHandle(), &event) < 0) {
+		syslog(LOG_ERR, "server reactor %s: epoll_ctl failed - %s", name.c_str(), strerror(errno));
+		connections.erase(id);
+		unlock();
+		return(false);
+	}
+	unlock();
+	return(true);
+}
+
+unsigned cServerReactor::getCountConnections() {
+	lock();
+	unsigned count = connections.size();
+	unlock();
+	return(count);
+}
+
+void *cServerReactor::workerThreadFunction(void *arg) {
+	((sWorker*)arg)->reactor->workerProcess(((sWorker*)arg)->index);
+	return(NULL);
+}
+
+void cServerReactor::workerProcess(unsigned index) {
+	while(!terminating && !CR_TERMINATE()) {
+		// one event per epoll_wait - events are distributed among workers
+		epoll_event event;
+		int rsltWait = epoll_wait(epoll_fd, &event, 1, 100);
+		if(rsltWait > 0) {
+			processEvent(event.data.u64);
+		} else if(rsltWait < 0 && errno != EINTR) {
+			syslog(LOG_ERR, "server reactor %s: epoll_wait failed - %s", name.c_str(), strerror(errno));
+			USLEEP(100000);
+		}
+		if(index == 0) {
+			u_int64_t time_ms = getTimeMS_rdtsc();
+			if(time_ms > last_housekeeping_ms + 100) {
+				housekeeping();
+				last_housekeeping_ms = time_ms;
+			}
+		}
+	}
+}
+
+void cServerReactor::processEvent(u_int64_t id) {
+	lock();
+	map<u_int64_t, sConnection>::iterator iter = connections.find(id);
+	if(iter == connections.end() || iter->second.state != _cs_armed) {
+		unlock();
+		return;
+	}
+	iter->second.state = _cs_processing;
+	cServerConnection *connection = iter->second.connection;
+	unlock();
+	int rsltRead = connection->reactor_read();
+	lock();
+	iter = connections.find(id);
+	iter->second.last_data_ms = getTimeMS_rdtsc();
+	if(rsltRead == _rr_continue && !terminating) {
+		iter->second.state = _cs_armed;
+		if(rearm(id, connection->getHandle())) {
+			connection = NULL;
+		}
+	} else if(rsltRead == _rr_wait && !terminating) {
+		iter->second.state = _cs_paused;
+		connection = NULL;
+	}
+	if(connection) {
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection->getHandle(), NULL);
+		connections.erase(iter);
+	}
+	unlock();
+	if(connection) {
+		delete connection;
+	}
+}
+
+void cServerReactor::housekeeping() {
+	list<cServerConnection*> connectionsForDelete;
+	u_int64_t time_ms = getTimeMS_rdtsc();
+	lock();
+	for(map<u_int64_t, sConnection>::iterator iter = connections.begin(); iter != connections.end(); ) {
+		sConnection *conn = &iter->second;
+		bool close = false;
+		if(conn->state == _cs_processing) {
+			++iter;
+			continue;
+		}
+		if(conn->connection->isTerminateSocket()) {
+			close = true;
+		} else if(conn->state == _cs_armed) {
+			int timeout = conn->connection->getTimeoutReadBlock();
+			if(timeout && time_ms > conn->last_data_ms + timeout * 1000ull) {
+				close = true;
+			}
+		} else if(conn->state == _cs_paused && conn->connection->reactor_can_read()) {
+			conn->state = _cs_armed;
+			conn->last_data_ms = time_ms;
+			if(!rearm(iter->first, conn->connection->getHandle())) {
+				close = true;
+			}
+		}
+		if(close) {
+			epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->connection->getHandle(), NULL);
+			connectionsForDelete.push_back(conn->connection);
+			connections.erase(iter++);
+		} else {
+			++iter;
+		}
+	}
+	unlock();
+	for(list<cServerConnection*>::iterator iter = connectionsForDelete.begin(); iter != connectionsForDelete.end(); iter++) {
+		delete *iter;
+	}
+}
+
+bool cServerReactor::rearm(u_int64_t id, int handle) {
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLONESHOT;
+	event.data.u64 = id;
+	return(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, handle, &event) == 0);
+}
+
+
 cReceiver::cReceiver() {
 	receive_socket = NULL;
 	receive_thread = 0;
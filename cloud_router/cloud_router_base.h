@@ -7,6 +7,7 @@
 #include <unistd.h>
 #include <sys/socket.h>
 #include <map>
+#include <list>
 #include <string>
 #include <arpa/inet.h>
 #include <openssl/rsa.h>
@@ -29,6 +30,8 @@ using namespace std;
 
 #define SYNC_LOCK_USLEEP 100
 #define MAX_LISTEN_SOCKETS 2
+#define SERVER_REACTOR_MAX_BLOCKS_PER_EVENT 16
+#define SERVER_REACTOR_READ_CHUNK (1024 * 1024)
 
 
 struct sCloudRouterVerbose {
@@ -319,6 +322,9 @@ public:
 	u_int64_t getLastTimeOkWrite() {
 		return(lastTimeOkWrite);
 	}
+	int getTimeoutReadBlock() {
+		return(timeouts.readblock);
+	}
 protected:
 	void clearError();
 	void sleep(int s);
@@ -460,6 +466,7 @@ public:
 	bool readBlockTimeout(string *str, u_int16_t timeout, eTypeEncode typeCode = _te_na, string xor_key = "", bool quietEwouldblock = false) {
 		return(readBlock(str, typeCode, xor_key, quietEwouldblock, timeout));
 	}
+	int readBlockNonBlocking(u_char **data, size_t *dataLen, eTypeEncode typeCode = _te_na, string xor_key = "", size_t bufferIncLength = 0);
 	string readLine(u_char **remainder = NULL, size_t *remainder_length = NULL);
 	void readDecodeAesAndResendTo(cSocketBlock *dest, u_char *remainder = NULL, size_t remainder_length = 0, u_int16_t timeout = 0);
 	void generate_rsa_keys(unsigned keylen = 2048) {
@@ -472,10 +479,12 @@ public:
 		return(rsa.setPubKey(key));
 	}
 protected:
+	bool decodeReadBuffer(eTypeEncode typeEncode, string xor_key);
 	bool checkSumReadBuffer();
 	u_int32_t dataSum(u_char *data, size_t dataLen);
 protected:
 	sReadBuffer readBuffer;
+	bool readBufferComplete;
 	cRsa rsa;
 private:
 	char *block_header_string;
@@ -512,7 +521,20 @@ public:
 	static void *connection_process(void *arg);
 	virtual void connection_process();
 	virtual void evData(u_char *data, size_t dataLen);
+	virtual int reactor_read();
+	virtual bool reactor_can_read() {
+		return(true);
+	}
 	void setTerminateSocket();
+	bool isTerminateSocket() {
+		return(!socket || socket->isTerminate() || socket->isError());
+	}
+	int getTimeoutReadBlock() {
+		return(socket ? socket->getTimeoutReadBlock() : 0);
+	}
+	int getHandle() {
+		return(socket ? socket->getHandle() : -1);
+	}
 	pthread_t getThread() {
 		return(thread);
 	}
@@ -520,6 +542,75 @@ protected:
 	cSocketBlock *socket;
 	pthread_t thread;
 	u_int64_t begin_time_ms;
+	cSocket::eTypeEncode reactor_type_encode;
+	size_t reactor_buffer_inc_length;
+};
+
+
+/*
+ * Event driven processing of long-lived connections - epoll with small pool of worker threads
+ * instead of thread per connection. The connection is handed over by add() after handshake
+ * (done in its own thread as before), so the protocol on the wire is unchanged.
+ * Sockets are registered with EPOLLONESHOT - only one worker processes a connection at a time and
+ * the socket is re-armed after reactor_read. Workers read available data without blocking and parse
+ * blocks incrementally (cSocketBlock::readBlockNonBlocking). If reactor_can_read returns false
+ * (back-pressure), the socket is not re-armed and the first worker checks it again periodically -
+ * the data stay in the socket buffer and tcp flow control throttles the client.
+ */
+class cServerReactor {
+public:
+	enum eReadRslt {
+		_rr_continue,
+		_rr_wait,
+		_rr_close
+	};
+private:
+	enum eConnectionState {
+		_cs_armed,
+		_cs_processing,
+		_cs_paused
+	};
+	struct sConnection {
+		cServerConnection *connection;
+		eConnectionState state;
+		u_int64_t last_data_ms;
+	};
+	struct sWorker {
+		cServerReactor *reactor;
+		unsigned index;
+		pthread_t thread;
+	};
+public:
+	cServerReactor(const char *name, unsigned countWorkers);
+	~cServerReactor();
+	bool start();
+	void stop();
+	bool add(cServerConnection *connection);
+	unsigned getCountConnections();
+private:
+	static void *workerThreadFunction(void *arg);
+	void workerProcess(unsigned index);
+	void processEvent(u_int64_t id);
+	void housekeeping();
+	bool rearm(u_int64_t id, int handle);
+	void lock() {
+		while(__sync_lock_test_and_set(&_sync_lock, 1)) {
+			USLEEP(SYNC_LOCK_USLEEP);
+		}
+	}
+	void unlock() {
+		__sync_lock_release(&_sync_lock);
+	}
+private:
+	string name;
+	unsigned countWorkers;
+	sWorker *workers;
+	int epoll_fd;
+	map<u_int64_t, sConnection> connections;
+	u_int64_t next_id;
+	u_int64_t last_housekeeping_ms;
+	volatile bool terminating;
+	volatile int _sync_lock;
 };
 
 
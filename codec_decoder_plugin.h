@@ -0,0 +1,46 @@
+#ifndef CODEC_DECODER_PLUGIN_H
+#define CODEC_DECODER_PLUGIN_H
+
+
+/*
+ * Interface of audio decoder plugins (shared libraries in directory audio_decoder_plugins).
+ * Plugin exports function VM_CODEC_DECODER_PLUGIN_SYMBOL returning static description of the plugin.
+ * Sniffer calls create for every converted rtp stream (decoders are pooled - reset is called
+ * before reuse) and decode for every frame in the raw file. Frame is payload of one rtp packet
+ * as it is saved by jitterbuffer. Decode returns count of samples written to pcm (signed 16 bit,
+ * samplerate of the codec) or -1 on error. Functions may be called from more threads,
+ * but every decoder context is used only by one thread at a time.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VM_CODEC_DECODER_PLUGIN_API_VERSION 1
+#define VM_CODEC_DECODER_PLUGIN_SYMBOL "voipmonitor_codec_decoder_plugin"
+
+struct vm_codec_decoder_plugin_codec {
+	int payload;		// PAYLOAD_* from codecs.h
+	int samplerate;
+	int lost_frame_samples;	// samples of silence inserted for lost (empty) frame, 0 = samplerate / 50
+};
+
+struct vm_codec_decoder_plugin {
+	int api_version;
+	const char *name;
+	const struct vm_codec_decoder_plugin_codec *codecs;
+	unsigned codecs_count;
+	void *(*create)(int payload);
+	int (*decode)(void *ctx, const unsigned char *data, unsigned length, short *pcm, unsigned pcm_max);
+	void (*reset)(void *ctx);
+	void (*destroy)(void *ctx);
+};
+
+typedef const struct vm_codec_decoder_plugin *(*vm_codec_decoder_plugin_fn)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //CODEC_DECODER_PLUGIN_H
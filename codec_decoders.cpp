@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+#include <dirent.h>
+#include <dlfcn.h>
+
+#ifdef HAVE_LIBGSM
+#include <gsm.h>
+#endif //HAVE_LIBGSM
+
+#include "codec_decoders.h"
+#include "codec_g722.h"
+#include "codecs.h"
+#include "tools.h"
+
+
+cCodecDecoders codecDecoders;
+
+
+class cCodecDecoder_g722 : public cCodecDecoder {
+public:
+	cCodecDecoder_g722(int payload)
+	 : cCodecDecoder(payload, 16000, 0) {
+		reset();
+	}
+	int decode(const u_char *data, unsigned length, int16_t *pcm, unsigned pcm_max) {
+		if(length * 2 > pcm_max) {
+			length = pcm_max / 2;
+		}
+		return(g722_decode(&state, pcm, data, length));
+	}
+	void reset() {
+		g722_decode_init(&state);
+	}
+	static cCodecDecoder *create(int payload) {
+		return(new FILE_LINE(44001) cCodecDecoder_g722(payload));
+	}
+private:
+	g722_decode_state state;
+};
+
+#ifdef HAVE_LIBGSM
+class cCodecDecoder_gsm : public cCodecDecoder {
+public:
+	cCodecDecoder_gsm(int payload)
+	 : cCodecDecoder(payload, 8000, GSM_SAMPLES) {
+		handle = gsm_create();
+	}
+	~cCodecDecoder_gsm() {
+		if(handle) {
+			gsm_destroy(handle);
+		}
+	}
+	int decode(const u_char *data, unsigned length, int16_t *pcm, unsigned pcm_max) {
+		if(!handle) {
+			return(-1);
+		}
+		// payload may contain more frames
+		unsigned samples = 0;
+		for(unsigned pos = 0; pos + GSM_FRAME_LEN <= length && samples + GSM_SAMPLES <= pcm_max; pos += GSM_FRAME_LEN) {
+			if(gsm_decode(handle, (gsm_byte*)(data + pos), (gsm_signal*)(pcm + samples)) < 0) {
+				memset(pcm + samples, 0, GSM_SAMPLES * sizeof(int16_t));
+			}
+			samples += GSM_SAMPLES;
+		}
+		return(samples);
+	}
+	void reset() {
+		if(handle) {
+			gsm_destroy(handle);
+		}
+		handle = gsm_create();
+	}
+	static cCodecDecoder *create(int payload) {
+		return(new FILE_LINE(44002) cCodecDecoder_gsm(payload));
+	}
+private:
+	gsm handle;
+};
+#endif //HAVE_LIBGSM
+
+class cCodecDecoder_plugin : public cCodecDecoder {
+public:
+	cCodecDecoder_plugin(int payload, const vm_codec_decoder_plugin *plugin, int samplerate, unsigned lost_frame_samples)
+	 : cCodecDecoder(payload, samplerate, lost_frame_samples) {
+		this->plugin = plugin;
+		ctx = plugin->create(payload);
+	}
+	~cCodecDecoder_plugin() {
+		if(ctx) {
+			plugin->destroy(ctx);
+		}
+	}
+	int decode(const u_char *data, unsigned length, int16_t *pcm, unsigned pcm_max) {
+		if(!ctx) {
+			return(-1);
+		}
+		return(plugin->decode(ctx, data, length, pcm, pcm_max));
+	}
+	void reset() {
+		if(ctx) {
+			plugin->reset(ctx);
+		}
+	}
+private:
+	const vm_codec_decoder_plugin *plugin;
+	void *ctx;
+};
+
+
+cCodecDecoders::cCodecDecoders() {
+	enabled = false;
+	_sync = 0;
+}
+
+cCodecDecoders::~cCodecDecoders() {
+	term();
+}
+
+void cCodecDecoders::init(const char *pluginsDir) {
+	registerDecoder(PAYLOAD_G722, "g722", cCodecDecoder_g722::create, 16000);
+	#ifdef HAVE_LIBGSM
+	registerDecoder(PAYLOAD_GSM, "gsm", cCodecDecoder_gsm::create, 8000, GSM_SAMPLES);
+	#endif //HAVE_LIBGSM
+	if(pluginsDir && *pluginsDir) {
+		DIR *dp = opendir(pluginsDir);
+		if(dp) {
+			dirent *de;
+			while((de = readdir(dp)) != NULL) {
+				size_t nameLength = strlen(de->d_name);
+				if(nameLength > 3 && !strcmp(de->d_name + nameLength - 3, ".so")) {
+					loadPlugin((string(pluginsDir) + "/" + de->d_name).c_str());
+				}
+			}
+			closedir(dp);
+		} else {
+			syslog(LOG_ERR, "audio decoders: failed to open plugins directory %s", pluginsDir);
+		}
+	}
+	enabled = true;
+}
+
+void cCodecDecoders::term() {
+	enabled = false;
+	lock();
+	for(map<int, list<cCodecDecoder*> >::iterator iter = pool.begin(); iter != pool.end(); iter++) {
+		for(list<cCodecDecoder*>::iterator iter_decoder = iter->second.begin(); iter_decoder != iter->second.end(); iter_decoder++) {
+			delete *iter_decoder;
+		}
+	}
+	pool.clear();
+	types.clear();
+	unlock();
+	for(unsigned i = 0; i < pluginHandles.size(); i++) {
+		dlclose(pluginHandles[i]);
+	}
+	pluginHandles.clear();
+}
+
+cCodecDecoder *cCodecDecoders::getDecoder(int payload) {
+	cCodecDecoder *decoder = NULL;
+	lock();
+	map<int, list<cCodecDecoder*> >::iterator iter_pool = pool.find(payload);
+	if(iter_pool != pool.end() && iter_pool->second.size()) {
+		decoder = iter_pool->second.front();
+		iter_pool->second.pop_front();
+	}
+	sDecoderType type;
+	if(!decoder) {
+		map<int, sDecoderType>::iterator iter_type = types.find(payload);
+		if(iter_type != types.end()) {
+			type = iter_type->second;
+		}
+	}
+	unlock();
+	if(!decoder) {
+		if(type.create) {
+			decoder = type.create(payload);
+		} else if(type.plugin) {
+			decoder = new FILE_LINE(44003) cCodecDecoder_plugin(payload, type.plugin, type.samplerate, type.lost_frame_samples);
+		}
+	}
+	return(decoder);
+}
+
+void cCodecDecoders::releaseDecoder(cCodecDecoder *decoder) {
+	decoder->reset();
+	lock();
+	pool[decoder->getPayload()].push_back(decoder);
+	unlock();
+}
+
+int cCodecDecoders::convertRawToWav(int payload, const char *rawFileName, const char *wavFileName, int *samplerate) {
+	FILE *wavFile = fopen(wavFileName, "a"); // append - as convertALAW2WAV
+	if(wavFile) {
+		spooldir_file_chmod_own(wavFile);
+	} else {
+		syslog(LOG_ERR, "File [%s] cannot be opened for write", wavFileName);
+		return(-1);
+	}
+	char wavFileBuffer[32768];
+	setvbuf(wavFile, wavFileBuffer, _IOFBF, sizeof(wavFileBuffer));
+	int rslt = convertRawToWav(payload, rawFileName, wavFile, samplerate);
+	fclose(wavFile);
+	return(rslt);
+}
+
+int cCodecDecoders::convertRawToWav(int payload, const char *rawFileName, FILE *wavFile, int *samplerate) {
+	return(_convertRawToWav(payload, rawFileName, wavFile, NULL, NULL, samplerate));
+}
+
+int cCodecDecoders::convertRawToBuffer(int payload, const char *rawFileName, u_char **buffer, u_int32_t *length, int *samplerate) {
+	*buffer = NULL;
+	*length = 0;
+	int rslt = _convertRawToWav(payload, rawFileName, NULL, buffer, length, samplerate);
+	if(rslt != 0 && *buffer) {
+		delete [] *buffer;
+		*buffer = NULL;
+		*length = 0;
+	}
+	return(rslt);
+}
+
+int cCodecDecoders::_convertRawToWav(int payload, const char *rawFileName, FILE *wavFile, u_char **buffer, u_int32_t *length, int *samplerate) {
+	cCodecDecoder *decoder = getDecoder(payload);
+	if(!decoder) {
+		return(-1);
+	}
+	FILE *rawFile = fopen(rawFileName, "r");
+	if(!rawFile) {
+		syslog(LOG_ERR, "File [%s] cannot be opened for read", rawFileName);
+		releaseDecoder(decoder);
+		return(-1);
+	}
+	bool framed = isFramedRaw(payload);
+	u_char frame[8192];
+	int16_t pcm_frame[CODEC_DECODER_MAX_FRAME_SAMPLES * 4];
+	unsigned pcm_max = sizeof(pcm_frame) / sizeof(int16_t);
+	u_int32_t bufferCapacity = 0;
+	if(buffer) {
+		// samples are decoded directly to the tail of buffer taken over by caller, capacity is estimated from raw size and doubled
+		bufferCapacity = max((u_int32_t)GetFileSize(rawFileName) * 8, (u_int32_t)pcm_max * 2 * 16);
+		*buffer = new FILE_LINE(44004) u_char[bufferCapacity];
+	}
+	while(true) {
+		int16_t *pcm = pcm_frame;
+		if(buffer) {
+			if(*length + pcm_max * 2 > bufferCapacity) {
+				u_char *bufferNew = new FILE_LINE(44005) u_char[bufferCapacity * 2];
+				memcpy(bufferNew, *buffer, *length);
+				delete [] *buffer;
+				*buffer = bufferNew;
+				bufferCapacity *= 2;
+			}
+			pcm = (int16_t*)(*buffer + *length);
+		}
+		unsigned frameLength;
+		int samples;
+		if(framed) {
+			// frames are prefixed by length (CODEC_LEN), zero length is lost frame
+			int16_t frameLengthPrefix;
+			if(fread(&frameLengthPrefix, sizeof(frameLengthPrefix), 1, rawFile) != 1) {
+				break;
+			}
+			if(frameLengthPrefix < 0 || frameLengthPrefix > (int)sizeof(frame)) {
+				syslog(LOG_ERR, "audio decoder %s: bad frame length %i in file %s", codec2text(payload), frameLengthPrefix, rawFileName);
+				break;
+			}
+			if(frameLengthPrefix == 0) {
+				samples = decoder->getLostFrameSamples();
+				memset(pcm, 0, samples * sizeof(int16_t));
+				if(buffer) {
+					*length += samples * sizeof(int16_t);
+				} else {
+					fwrite(pcm, sizeof(int16_t), samples, wavFile);
+				}
+				continue;
+			}
+			if(fread(frame, 1, frameLengthPrefix, rawFile) != (size_t)frameLengthPrefix) {
+				break;
+			}
+			frameLength = frameLengthPrefix;
+		} else {
+			frameLength = fread(frame, 1, CODEC_DECODER_RAW_CHUNK, rawFile);
+			if(!frameLength) {
+				break;
+			}
+		}
+		samples = decoder->decode(frame, frameLength, pcm, pcm_max);
+		if(samples < 0) {
+			samples = decoder->getLostFrameSamples();
+			memset(pcm, 0, samples * sizeof(int16_t));
+		}
+		if(samples > 0) {
+			if(buffer) {
+				*length += samples * sizeof(int16_t);
+			} else {
+				fwrite(pcm, sizeof(int16_t), samples, wavFile);
+			}
+		}
+	}
+	fclose(rawFile);
+	if(samplerate) {
+		*samplerate = decoder->getSampleRate();
+	}
+	releaseDecoder(decoder);
+	return(0);
+}
+
+bool cCodecDecoders::compareWithReference(int payload, const char *rawFileName, const char *referenceFileName) {
+	// bit-exact comparison of in-process decoder output with reference pcm (s16le, optionally with RIFF header)
+	u_char *buffer;
+	u_int32_t length;
+	int samplerate;
+	if(convertRawToBuffer(payload, rawFileName, &buffer, &length, &samplerate) != 0) {
+		cout << "decoding of " << rawFileName << " failed" << endl;
+		return(false);
+	}
+	long long referenceLength = GetFileSize(referenceFileName);
+	FILE *referenceFile = referenceLength > 0 ? fopen(referenceFileName, "r") : NULL;
+	if(!referenceFile) {
+		cout << "reference file " << referenceFileName << " is not available" << endl;
+		if(buffer) {
+			delete [] buffer;
+		}
+		return(false);
+	}
+	u_char *reference = new FILE_LINE(44006) u_char[referenceLength];
+	referenceLength = fread(reference, 1, referenceLength, referenceFile);
+	fclose(referenceFile);
+	u_int32_t referenceOffset = 0;
+	if(referenceLength > 12 && !memcmp(reference, "RIFF", 4) && !memcmp(reference + 8, "WAVE", 4)) {
+		referenceOffset = 12;
+		while(referenceOffset + 8 <= referenceLength) {
+			u_int32_t chunkLength = reference[referenceOffset + 4] | (reference[referenceOffset + 5] << 8) |
+						(reference[referenceOffset + 6] << 16) | (reference[referenceOffset + 7] << 24);
+			if(!memcmp(reference + referenceOffset, "data", 4)) {
+				referenceOffset += 8;
+				break;
+			}
+			referenceOffset += 8 + chunkLength;
+		}
+	}
+	u_int32_t samples = length / 2;
+	u_int32_t referenceSamples = (referenceLength - referenceOffset) / 2;
+	int16_t *pcm = (int16_t*)buffer;
+	int16_t *referencePcm = (int16_t*)(reference + referenceOffset);
+	u_int32_t differ = 0;
+	int maxDiff = 0;
+	int64_t firstDiffer = -1;
+	for(u_int32_t i = 0; i < min(samples, referenceSamples); i++) {
+		if(pcm[i] != referencePcm[i]) {
+			if(firstDiffer < 0) {
+				firstDiffer = i;
+			}
+			++differ;
+			maxDiff = max(maxDiff, abs(pcm[i] - referencePcm[i]));
+		}
+	}
+	cout << codec2text(payload) << " samplerate " << samplerate
+	     << " samples " << samples << " reference samples " << referenceSamples
+	     << " differ " << differ << " max diff " << maxDiff;
+	if(firstDiffer >= 0) {
+		cout << " first differ at sample " << firstDiffer;
+	}
+	cout << endl;
+	if(buffer) {
+		delete [] buffer;
+	}
+	delete [] reference;
+	return(samples == referenceSamples && !differ);
+}
+
+bool cCodecDecoders::isFramedRaw(int payload) {
+	// must correspond to the list of codecs with CODEC_LEN in jitterbuffer/abstract_jb.c
+	switch(payload) {
+	case PAYLOAD_G72218:
+	case PAYLOAD_G722112:
+	case PAYLOAD_G722116:
+	case PAYLOAD_G722124:
+	case PAYLOAD_G722132:
+	case PAYLOAD_G722148:
+	case PAYLOAD_OPUS8:
+	case PAYLOAD_OPUS12:
+	case PAYLOAD_OPUS16:
+	case PAYLOAD_OPUS24:
+	case PAYLOAD_OPUS48:
+	case PAYLOAD_ISAC16:
+	case PAYLOAD_ISAC32:
+	case PAYLOAD_SILK:
+	case PAYLOAD_SILK8:
+	case PAYLOAD_SILK12:
+	case PAYLOAD_SILK16:
+	case PAYLOAD_SILK24:
+	case PAYLOAD_SPEEX:
+	case PAYLOAD_G723:
+	case PAYLOAD_G729:
+	case PAYLOAD_GSM:
+	case PAYLOAD_AMR:
+	case PAYLOAD_AMRWB:
+		return(CODEC_LEN != 0);
+	}
+	return(false);
+}
+
+void cCodecDecoders::registerDecoder(int payload, const char *name, tCreateDecoder create, int samplerate, unsigned lost_frame_samples) {
+	sDecoderType type;
+	type.name = name;
+	type.create = create;
+	type.samplerate = samplerate;
+	type.lost_frame_samples = lost_frame_samples;
+	lock();
+	types[payload] = type;
+	unlock();
+}
+
+void cCodecDecoders::registerPlugin(const vm_codec_decoder_plugin *plugin) {
+	lock();
+	for(unsigned i = 0; i < plugin->codecs_count; i++) {
+		sDecoderType type;
+		type.name = plugin->name;
+		type.plugin = plugin;
+		type.samplerate = plugin->codecs[i].samplerate;
+		type.lost_frame_samples = plugin->codecs[i].lost_frame_samples;
+		types[plugin->codecs[i].payload] = type;
+	}
+	unlock();
+}
+
+bool cCodecDecoders::loadPlugin(const char *fileName) {
+	void *handle = dlopen(fileName, RTLD_NOW | RTLD_LOCAL);
+	if(!handle) {
+		syslog(LOG_ERR, "audio decoders: failed to load plugin %s - %s", fileName, dlerror());
+		return(false);
+	}
+	vm_codec_decoder_plugin_fn pluginFunction = (vm_codec_decoder_plugin_fn)dlsym(handle, VM_CODEC_DECODER_PLUGIN_SYMBOL);
+	const vm_codec_decoder_plugin *plugin = pluginFunction ? pluginFunction() : NULL;
+	if(!plugin) {
+		syslog(LOG_ERR, "audio decoders: %s is not audio decoder plugin", fileName);
+		dlclose(handle);
+		return(false);
+	}
+	if(plugin->api_version != VM_CODEC_DECODER_PLUGIN_API_VERSION ||
+	   !plugin->create || !plugin->decode || !plugin->reset || !plugin->destroy) {
+		syslog(LOG_ERR, "audio decoders: plugin %s has incompatible interface (version %i)", fileName, plugin->api_version);
+		dlclose(handle);
+		return(false);
+	}
+	registerPlugin(plugin);
+	pluginHandles.push_back(handle);
+	syslog(LOG_NOTICE, "audio decoders: plugin %s (%s) loaded - %u codecs", fileName, plugin->name, plugin->codecs_count);
+	return(true);
+}
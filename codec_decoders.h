@@ -0,0 +1,115 @@
+#ifndef CODEC_DECODERS_H
+#define CODEC_DECODERS_H
+
+
+#include "config.h"
+
+#include <string>
+#include <map>
+#include <list>
+#include <vector>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "codec_decoder_plugin.h"
+
+
+using namespace std;
+
+
+#define CODEC_DECODER_MAX_FRAME_SAMPLES (48000 / 1000 * 120)
+#define CODEC_DECODER_RAW_CHUNK 4096
+
+
+/*
+ * Decoder of one rtp stream - state is kept between frames, reset prepares decoder for next stream.
+ */
+class cCodecDecoder {
+public:
+	cCodecDecoder(int payload, int samplerate, unsigned lost_frame_samples) {
+		this->payload = payload;
+		this->samplerate = samplerate;
+		this->lost_frame_samples = lost_frame_samples ? lost_frame_samples : samplerate / 50;
+	}
+	virtual ~cCodecDecoder() {}
+	virtual int decode(const u_char *data, unsigned length, int16_t *pcm, unsigned pcm_max) = 0;
+	virtual void reset() = 0;
+	int getPayload() {
+		return(payload);
+	}
+	int getSampleRate() {
+		return(samplerate);
+	}
+	unsigned getLostFrameSamples() {
+		return(lost_frame_samples);
+	}
+protected:
+	int payload;
+	int samplerate;
+	unsigned lost_frame_samples;
+};
+
+/*
+ * In-process audio decoders used by Call::convertRawToWav (audio queue threads) instead of forking vmcodecs.
+ * Decoders are registered by payload (PAYLOAD_* from codecs.h) - built-in G.722, GSM (if sniffer is built
+ * with libgsm) and codecs provided by plugins loaded from directory audio_decoder_plugins (see codec_decoder_plugin.h).
+ * Decoder instances are pooled per payload, so the state is not allocated for every converted stream.
+ */
+class cCodecDecoders {
+public:
+	typedef cCodecDecoder *(*tCreateDecoder)(int payload);
+	struct sDecoderType {
+		sDecoderType() {
+			create = NULL;
+			plugin = NULL;
+			samplerate = 0;
+			lost_frame_samples = 0;
+		}
+		string name;
+		tCreateDecoder create;
+		const vm_codec_decoder_plugin *plugin;
+		int samplerate;
+		unsigned lost_frame_samples;
+	};
+public:
+	cCodecDecoders();
+	~cCodecDecoders();
+	void init(const char *pluginsDir);
+	void term();
+	bool isEnabled() {
+		return(enabled);
+	}
+	bool isSupported(int payload) {
+		return(enabled && types.find(payload) != types.end());
+	}
+	cCodecDecoder *getDecoder(int payload);
+	void releaseDecoder(cCodecDecoder *decoder);
+	int convertRawToWav(int payload, const char *rawFileName, const char *wavFileName, int *samplerate);
+	int convertRawToWav(int payload, const char *rawFileName, FILE *wavFile, int *samplerate);
+	int convertRawToBuffer(int payload, const char *rawFileName, u_char **buffer, u_int32_t *length, int *samplerate);
+	bool compareWithReference(int payload, const char *rawFileName, const char *referenceFileName);
+	static bool isFramedRaw(int payload);
+private:
+	int _convertRawToWav(int payload, const char *rawFileName, FILE *wavFile, u_char **buffer, u_int32_t *length, int *samplerate);
+	void registerDecoder(int payload, const char *name, tCreateDecoder create, int samplerate, unsigned lost_frame_samples = 0);
+	void registerPlugin(const vm_codec_decoder_plugin *plugin);
+	bool loadPlugin(const char *fileName);
+	void lock() {
+		while(__sync_lock_test_and_set(&_sync, 1));
+	}
+	void unlock() {
+		__sync_lock_release(&_sync);
+	}
+private:
+	bool enabled;
+	map<int, sDecoderType> types;
+	map<int, list<cCodecDecoder*> > pool;
+	vector<void*> pluginHandles;
+	volatile int _sync;
+};
+
+
+extern cCodecDecoders codecDecoders;
+
+
+#endif //CODEC_DECODERS_H
@@ -0,0 +1,225 @@
+#include <string.h>
+
+#include "codec_g722.h"
+
+
+static inline int g722_saturate(int amp) {
+	if(amp > 32767) {
+		return(32767);
+	}
+	if(amp < -32768) {
+		return(-32768);
+	}
+	return(amp);
+}
+
+static void g722_block4(g722_band *band, int d) {
+	int wd1, wd2, wd3;
+	int i;
+
+	// RECONS
+	band->d[0] = d;
+	band->r[0] = g722_saturate(band->s + d);
+	// PARREC
+	band->p[0] = g722_saturate(band->sz + d);
+
+	// UPPOL2
+	for(i = 0; i < 3; i++) {
+		band->sg[i] = band->p[i] >> 15;
+	}
+	wd1 = g722_saturate(band->a[1] << 2);
+	wd2 = band->sg[0] == band->sg[1] ? -wd1 : wd1;
+	if(wd2 > 32767) {
+		wd2 = 32767;
+	}
+	wd3 = (wd2 >> 7) + (band->sg[0] == band->sg[2] ? 128 : -128);
+	wd3 += (band->a[2] * 32512) >> 15;
+	if(wd3 > 12288) {
+		wd3 = 12288;
+	} else if(wd3 < -12288) {
+		wd3 = -12288;
+	}
+	band->ap[2] = wd3;
+
+	// UPPOL1
+	band->sg[0] = band->p[0] >> 15;
+	band->sg[1] = band->p[1] >> 15;
+	wd1 = band->sg[0] == band->sg[1] ? 192 : -192;
+	wd2 = (band->a[1] * 32640) >> 15;
+	band->ap[1] = g722_saturate(wd1 + wd2);
+	wd3 = g722_saturate(15360 - band->ap[2]);
+	if(band->ap[1] > wd3) {
+		band->ap[1] = wd3;
+	} else if(band->ap[1] < -wd3) {
+		band->ap[1] = -wd3;
+	}
+
+	// UPZERO
+	wd1 = d == 0 ? 0 : 128;
+	band->sg[0] = d >> 15;
+	for(i = 1; i < 7; i++) {
+		band->sg[i] = band->d[i] >> 15;
+		wd2 = band->sg[i] == band->sg[0] ? wd1 : -wd1;
+		wd3 = (band->b[i] * 32640) >> 15;
+		band->bp[i] = g722_saturate(wd2 + wd3);
+	}
+
+	// DELAYA
+	for(i = 6; i > 0; i--) {
+		band->d[i] = band->d[i - 1];
+		band->b[i] = band->bp[i];
+	}
+	for(i = 2; i > 0; i--) {
+		band->r[i] = band->r[i - 1];
+		band->p[i] = band->p[i - 1];
+		band->a[i] = band->ap[i];
+	}
+
+	// FILTEP
+	wd1 = g722_saturate(band->r[1] + band->r[1]);
+	wd1 = (band->a[1] * wd1) >> 15;
+	wd2 = g722_saturate(band->r[2] + band->r[2]);
+	wd2 = (band->a[2] * wd2) >> 15;
+	band->sp = g722_saturate(wd1 + wd2);
+
+	// FILTEZ
+	band->sz = 0;
+	for(i = 6; i > 0; i--) {
+		wd1 = g722_saturate(band->d[i] + band->d[i]);
+		band->sz += (band->b[i] * wd1) >> 15;
+	}
+	band->sz = g722_saturate(band->sz);
+
+	// PREDIC
+	band->s = g722_saturate(band->sp + band->sz);
+}
+
+void g722_decode_init(g722_decode_state *s) {
+	memset(s, 0, sizeof(g722_decode_state));
+	s->band[0].det = 32;
+	s->band[1].det = 8;
+}
+
+int g722_decode(g722_decode_state *s, int16_t *amp, const u_char *g722_data, int len) {
+	static const int wl[8] = { -60, -30, 58, 172, 334, 538, 1198, 3042 };
+	static const int rl42[16] = { 0, 7, 6, 5, 4, 3, 2, 1, 7, 6, 5, 4, 3, 2, 1, 0 };
+	static const int ilb[32] = {
+		2048, 2093, 2139, 2186, 2233, 2282, 2332, 2383,
+		2435, 2489, 2543, 2599, 2656, 2714, 2774, 2834,
+		2896, 2960, 3025, 3091, 3158, 3228, 3298, 3371,
+		3444, 3520, 3597, 3676, 3756, 3838, 3922, 4008
+	};
+	static const int wh[3] = { 0, -214, 798 };
+	static const int rh2[4] = { 2, 1, 2, 1 };
+	static const int qm2[4] = { -7408, -1616, 7408, 1616 };
+	static const int qm4[16] = {
+		     0, -20456, -12896, -8968,
+		 -6288,  -4240,  -2584, -1200,
+		 20456,  12896,   8968,  6288,
+		  4240,   2584,   1200,     0
+	};
+	static const int qm6[64] = {
+		  -136,   -136,   -136,   -136,
+		-24808, -21904, -19008, -16704,
+		-14984, -13512, -12280, -11192,
+		-10232,  -9360,  -8576,  -7856,
+		 -7192,  -6576,  -6000,  -5456,
+		 -4944,  -4464,  -4008,  -3576,
+		 -3168,  -2776,  -2400,  -2032,
+		 -1688,  -1360,  -1040,   -728,
+		 24808,  21904,  19008,  16704,
+		 14984,  13512,  12280,  11192,
+		 10232,   9360,   8576,   7856,
+		  7192,   6576,   6000,   5456,
+		  4944,   4464,   4008,   3576,
+		  3168,   2776,   2400,   2032,
+		  1688,   1360,   1040,    728,
+		   432,    136,   -432,   -136
+	};
+	static const int qmf_coeffs[12] = {
+		3, -11, 12, 32, -210, 951, 3876, -805, 362, -156, 53, -11
+	};
+
+	int rlow, dlowt;
+	int ihigh, dhigh, rhigh;
+	int xout1, xout2;
+	int wd1, wd2, wd3;
+	int outlen = 0;
+	int i, j;
+
+	for(j = 0; j < len; j++) {
+		int code = g722_data[j];
+		wd1 = code & 0x3F;
+		ihigh = (code >> 6) & 0x03;
+		wd2 = qm6[wd1];
+		wd1 >>= 2;
+
+		// LOW BAND - INVQBL, RECONS, LIMIT
+		wd2 = (s->band[0].det * wd2) >> 15;
+		rlow = s->band[0].s + wd2;
+		if(rlow > 16383) {
+			rlow = 16383;
+		} else if(rlow < -16384) {
+			rlow = -16384;
+		}
+		// INVQAL
+		wd2 = qm4[wd1];
+		dlowt = (s->band[0].det * wd2) >> 15;
+		// LOGSCL
+		wd2 = rl42[wd1];
+		wd1 = (s->band[0].nb * 127) >> 7;
+		wd1 += wl[wd2];
+		if(wd1 < 0) {
+			wd1 = 0;
+		} else if(wd1 > 18432) {
+			wd1 = 18432;
+		}
+		s->band[0].nb = wd1;
+		// SCALEL
+		wd1 = (s->band[0].nb >> 6) & 31;
+		wd2 = 8 - (s->band[0].nb >> 11);
+		wd3 = wd2 < 0 ? ilb[wd1] << -wd2 : ilb[wd1] >> wd2;
+		s->band[0].det = wd3 << 2;
+		g722_block4(&s->band[0], dlowt);
+
+		// HIGH BAND - INVQAH, RECONS, LIMIT
+		wd2 = qm2[ihigh];
+		dhigh = (s->band[1].det * wd2) >> 15;
+		rhigh = dhigh + s->band[1].s;
+		if(rhigh > 16383) {
+			rhigh = 16383;
+		} else if(rhigh < -16384) {
+			rhigh = -16384;
+		}
+		// LOGSCH
+		wd2 = rh2[ihigh];
+		wd1 = (s->band[1].nb * 127) >> 7;
+		wd1 += wh[wd2];
+		if(wd1 < 0) {
+			wd1 = 0;
+		} else if(wd1 > 22528) {
+			wd1 = 22528;
+		}
+		s->band[1].nb = wd1;
+		// SCALEH
+		wd1 = (s->band[1].nb >> 6) & 31;
+		wd2 = 10 - (s->band[1].nb >> 11);
+		wd3 = wd2 < 0 ? ilb[wd1] << -wd2 : ilb[wd1] >> wd2;
+		s->band[1].det = wd3 << 2;
+		g722_block4(&s->band[1], dhigh);
+
+		// receive QMF
+		memmove(s->x, s->x + 2, 22 * sizeof(int));
+		s->x[22] = rlow + rhigh;
+		s->x[23] = rlow - rhigh;
+		xout1 = 0;
+		xout2 = 0;
+		for(i = 0; i < 12; i++) {
+			xout2 += s->x[2 * i] * qmf_coeffs[i];
+			xout1 += s->x[2 * i + 1] * qmf_coeffs[11 - i];
+		}
+		amp[outlen++] = g722_saturate(xout1 >> 11);
+		amp[outlen++] = g722_saturate(xout2 >> 11);
+	}
+	return(outlen);
+}
@@ -0,0 +1,37 @@
+#ifndef CODEC_G722_H
+#define CODEC_G722_H
+
+
+#include <sys/types.h>
+
+
+/*
+ * G.722 decoder (64 kbit/s - 6 bit low band + 2 bit high band per byte, 16 kHz output).
+ * Implementation of ITU-T G.722 blocks (INVQAL, LOGSCL, SCALEL, block 4 predictor, receive QMF).
+ */
+struct g722_band {
+	int s;
+	int sp;
+	int sz;
+	int r[3];
+	int a[3];
+	int ap[3];
+	int p[3];
+	int d[7];
+	int b[7];
+	int bp[7];
+	int sg[7];
+	int nb;
+	int det;
+};
+
+struct g722_decode_state {
+	int x[24];
+	g722_band band[2];
+};
+
+void g722_decode_init(g722_decode_state *s);
+int g722_decode(g722_decode_state *s, int16_t *amp, const u_char *g722_data, int len);
+
+
+#endif //CODEC_G722_H
@@ -488,6 +488,7 @@ string CheckInternational::numberNormalized(const char *number, CountryPrefixes
 
 
 CountryPrefixes::CountryPrefixes() {
+	lpm_ok = false;
 }
 
 CountryPrefixes::~CountryPrefixes() {
@@ -568,12 +569,33 @@ bool CountryPrefixes::load(SqlDb *sqlDb) {
 	if(_createSqlObject) {
 		delete sqlDb;
 	}
+	buildLpm();
 	return(true);
 }
 
 void CountryPrefixes::clear() {
 	data.clear();
 	customer_data_simple.clear();
+	lpm_data.clear();
+	lpm_customer_data_simple.clear();
+	lpm_ok = false;
+}
+
+void CountryPrefixes::buildLpm() {
+	// value is index of the last record with the same prefix (+1) - as in _getCountry_lower_bound
+	lpm_ok = true;
+	for(int pass = 0; pass < 2 && lpm_ok; pass++) {
+		vector<CountryPrefix_rec> *data = pass == 0 ? &this->customer_data_simple : &this->data;
+		cLpmNumber *lpm = pass == 0 ? &lpm_customer_data_simple : &lpm_data;
+		for(unsigned i = 0; i < data->size() && lpm_ok; i++) {
+			lpm_ok = lpm->add((*data)[i].number.c_str(), true, i + 1);
+		}
+		lpm->build();
+	}
+	if(!lpm_ok) {
+		lpm_data.clear();
+		lpm_customer_data_simple.clear();
+	}
 }
 
 string CountryPrefixes::getCountry(const char *number, vector<string> *countries, string *country_prefix,
@@ -674,6 +696,26 @@ string CountryPrefixes::getCountry(const char *number, vector<string> *countries
 }
 
 string CountryPrefixes::_getCountry(const char *number, vector<string> *countries, string *country_prefix) {
+	if(!lpm_ok) {
+		return(_getCountry_lower_bound(number, countries, country_prefix));
+	}
+	if(countries) {
+		countries->clear();
+	}
+	if(country_prefix) {
+		*country_prefix = "";
+	}
+	for(int pass = 0; pass < 2; pass++) {
+		vector<CountryPrefix_rec> *data = pass == 0 ? &this->customer_data_simple : &this->data;
+		u_int32_t index = (pass == 0 ? &lpm_customer_data_simple : &lpm_data)->lookup(number);
+		if(index) {
+			return(getCountryRslt(data, data->begin() + index - 1, countries, country_prefix));
+		}
+	}
+	return("");
+}
+
+string CountryPrefixes::_getCountry_lower_bound(const char *number, vector<string> *countries, string *country_prefix) {
 	if(countries) {
 		countries->clear();
 	}
@@ -717,31 +759,37 @@ string CountryPrefixes::_getCountry(const char *number, vector<string> *countrie
 			}
 			if(okFind &&
 			   !strncmp(findRecIt->number.c_str(), number, findRecIt->number.length())) {
-				string rslt = findRecIt->country_code;
-				string rsltNumber = findRecIt->number;
-				if(country_prefix) {
-					*country_prefix = findRecIt->number;
-				}
-				if(countries) {
-					countries->push_back(rslt);
-					while(findRecIt != data->begin()) {
-						--findRecIt;
-						if(rsltNumber == findRecIt->number) {
-							countries->push_back(findRecIt->country_code);
-						} else {
-							break;
-						}
-					}
-				}
-				return(rslt);
+				return(getCountryRslt(data, findRecIt, countries, country_prefix));
 			}
 		}
 	}
 	return("");
 }
 
+string CountryPrefixes::getCountryRslt(vector<CountryPrefix_rec> *data, vector<CountryPrefix_rec>::iterator findRecIt,
+				       vector<string> *countries, string *country_prefix) {
+	string rslt = findRecIt->country_code;
+	string rsltNumber = findRecIt->number;
+	if(country_prefix) {
+		*country_prefix = findRecIt->number;
+	}
+	if(countries) {
+		countries->push_back(rslt);
+		while(findRecIt != data->begin()) {
+			--findRecIt;
+			if(rsltNumber == findRecIt->number) {
+				countries->push_back(findRecIt->country_code);
+			} else {
+				break;
+			}
+		}
+	}
+	return(rslt);
+}
+
 
 GeoIP_country::GeoIP_country() {
+	lpm_ok = false;
 }
 
 bool GeoIP_country::load(SqlDb *sqlDb) {
@@ -801,9 +849,24 @@ bool GeoIP_country::load(SqlDb *sqlDb) {
 	if(_createSqlObject) {
 		delete sqlDb;
 	}
+	buildLpm();
 	return(true);
 }
 
+void GeoIP_country::buildLpm() {
+	// value is index of the record (+1)
+	for(unsigned pass = 0; pass < 3; pass++) {
+		vector<GeoIP_country_rec> *data = pass == 0 ? &this->data : pass == 1 ? &this->data_v6 : &this->customer_data;
+		cLpmIP *lpm = pass < 2 ? &lpm_data : &lpm_customer_data;
+		for(unsigned i = 0; i < data->size(); i++) {
+			lpm->addRange((*data)[i].ip_from, (*data)[i].ip_to, i + 1);
+		}
+	}
+	lpm_data.build();
+	lpm_customer_data.build();
+	lpm_ok = true;
+}
+
 
 CountryDetect::CountryDetect() {
 	countryCodes = new FILE_LINE(0) CountryCodes;
@@ -815,7 +878,6 @@ CountryDetect::CountryDetect() {
 	geoIP_country_reload = NULL;
 	checkInternational_reload = NULL;
 	reload_do = false;
-	_sync = 0;
 	_sync_reload = 0;
 }
 
@@ -835,77 +897,70 @@ void CountryDetect::load(SqlDb *sqlDb) {
 
 string CountryDetect::getCountryByPhoneNumber(const char *phoneNumber) {
 	string rslt;
-	lock();
-	if(countryPrefixes->loadOK) {
-		rslt = countryPrefixes->getCountry(phoneNumber, NULL, NULL, checkInternational);
+	CountryPrefixes *_countryPrefixes = countryPrefixes;
+	if(_countryPrefixes->loadOK) {
+		rslt = _countryPrefixes->getCountry(phoneNumber, NULL, NULL, checkInternational);
 	}
-	unlock();
 	return(rslt);
 }
 
 unsigned CountryDetect::getCountryIdByPhoneNumber(const char *phoneNumber) {
 	unsigned rslt = 0;
-	lock();
-	if(countryPrefixes->loadOK) {
-		string rslt_str = countryPrefixes->getCountry(phoneNumber, NULL, NULL, checkInternational);
+	CountryPrefixes *_countryPrefixes = countryPrefixes;
+	if(_countryPrefixes->loadOK) {
+		string rslt_str = _countryPrefixes->getCountry(phoneNumber, NULL, NULL, checkInternational);
 		if(!rslt_str.empty()) {
 			rslt = countryCodes->getIdCountry(rslt_str.c_str());
 		}
 	}
-	unlock();
 	return(rslt);
 }
 
 bool CountryDetect::isLocalByPhoneNumber(const char *phoneNumber) {
 	bool rslt = false;
-	lock();
-	if(countryPrefixes->loadOK) {
-		rslt = countryPrefixes->isLocal(phoneNumber, checkInternational);
+	CountryPrefixes *_countryPrefixes = countryPrefixes;
+	if(_countryPrefixes->loadOK) {
+		rslt = _countryPrefixes->isLocal(phoneNumber, checkInternational);
 	}
-	unlock();
 	return(rslt);
 }
 
 string CountryDetect::getCountryByIP(vmIP ip) {
 	string rslt;
-	lock();
-	if(geoIP_country->loadOK) {
-		rslt = geoIP_country->getCountry(ip);
+	GeoIP_country *_geoIP_country = geoIP_country;
+	if(_geoIP_country->loadOK) {
+		rslt = _geoIP_country->getCountry(ip);
 	}
-	unlock();
 	return(rslt);
 }
 
 unsigned CountryDetect::getCountryIdByIP(vmIP ip) {
 	unsigned rslt = 0;
-	lock();
-	if(geoIP_country->loadOK) {
-		string rslt_str = geoIP_country->getCountry(ip);
+	GeoIP_country *_geoIP_country = geoIP_country;
+	if(_geoIP_country->loadOK) {
+		string rslt_str = _geoIP_country->getCountry(ip);
 		if(!rslt_str.empty()) {
 			rslt = countryCodes->getIdCountry(rslt_str.c_str());
 		}
 	}
-	unlock();
 	return(rslt);
 }
 
 bool CountryDetect::isLocalByIP(vmIP ip) {
 	bool rslt = false;
-	lock();
-	if(geoIP_country->loadOK) {
-		rslt = geoIP_country->isLocal(ip, checkInternational);
+	GeoIP_country *_geoIP_country = geoIP_country;
+	if(_geoIP_country->loadOK) {
+		rslt = _geoIP_country->isLocal(ip, checkInternational);
 	}
-	unlock();
 	return(rslt);
 }
 
 string CountryDetect::getContinentByCountry(const char *country) {
 	string rslt;
-	lock();
-	if(countryCodes->loadOK) {
-		rslt = countryCodes->getContinent(country);
+	CountryCodes *_countryCodes = countryCodes;
+	if(_countryCodes->loadOK) {
+		rslt = _countryCodes->getContinent(country);
 	}
-	unlock();
 	return(rslt);
 }
 
@@ -943,16 +998,20 @@ void CountryDetect::applyReload() {
 	if(reload_do) {
 		lock_reload();
 		if(reload_do) {
-			lock();
-			delete countryCodes;
-			delete countryPrefixes;
-			delete geoIP_country;
-			delete checkInternational;
+			// lookups are without lock - old objects are deleted after grace period
+			CountryCodes *countryCodes_old = countryCodes;
+			CountryPrefixes *countryPrefixes_old = countryPrefixes;
+			GeoIP_country *geoIP_country_old = geoIP_country;
+			CheckInternational *checkInternational_old = checkInternational;
+			__sync_synchronize();
 			countryCodes = countryCodes_reload;
 			countryPrefixes = countryPrefixes_reload;
 			geoIP_country = geoIP_country_reload;
 			checkInternational = checkInternational_reload;
-			unlock();
+			lpm_retire(countryCodes_old);
+			lpm_retire(countryPrefixes_old);
+			lpm_retire(geoIP_country_old);
+			lpm_retire(checkInternational_old);
 			countryCodes_reload = NULL;
 			countryPrefixes_reload = NULL;
 			geoIP_country_reload = NULL;
@@ -9,6 +9,7 @@
 #include <math.h>
 
 #include "sql_db.h"
+#include "lpm.h"
 
 
 using namespace std;
@@ -172,6 +173,7 @@ public:
 	string getCountry(const char *number, vector<string> *countries, string *country_prefix,
 			  CheckInternational *checkInternational, string *rsltNumberNormalized = NULL);
 	string _getCountry(const char *number, vector<string> *countries, string *country_prefix);
+	string _getCountry_lower_bound(const char *number, vector<string> *countries, string *country_prefix);
 	bool isLocal(const char *number,
 		     CheckInternational *checkInternational) {
 		vector<string> countries;
@@ -214,9 +216,16 @@ public:
 		}
 		return("");
 	}
+private:
+	void buildLpm();
+	string getCountryRslt(vector<CountryPrefix_rec> *data, vector<CountryPrefix_rec>::iterator findRecIt,
+			      vector<string> *countries, string *country_prefix);
 private:
 	vector<CountryPrefix_rec> data;
 	vector<CountryPrefix_rec> customer_data_simple;
+	cLpmNumber lpm_data;
+	cLpmNumber lpm_customer_data_simple;
+	bool lpm_ok;
 };
 
 
@@ -250,6 +259,20 @@ public:
 	GeoIP_country();
 	bool load(SqlDb *sqlDb = NULL);
 	string getCountry(vmIP ip) {
+		if(lpm_ok) {
+			u_int32_t index = lpm_customer_data.lookup(ip);
+			if(index) {
+				return(customer_data[index - 1].country_code);
+			}
+			index = lpm_data.lookup(ip);
+			if(index) {
+				return((VM_IPV6_B && ip.is_v6() ? data_v6 : data)[index - 1].country_code);
+			}
+			return("");
+		}
+		return(getCountry_lower_bound(ip));
+	}
+	string getCountry_lower_bound(vmIP ip) {
 		for(unsigned pass = 0; pass < 2; pass++) {
 			vector<GeoIP_country_rec> *data = pass == 0 ? 
 							   &this->customer_data : 
@@ -285,10 +308,15 @@ public:
 		     CheckInternational *checkInternational) {
 		return(isLocal(str_2_vmIP(ip), checkInternational));
 	}
+private:
+	void buildLpm();
 private:
 	vector<GeoIP_country_rec> data;
 	vector<GeoIP_country_rec> data_v6;
 	vector<GeoIP_country_rec> customer_data;
+	cLpmIP lpm_data;
+	cLpmIP lpm_customer_data;
+	bool lpm_ok;
 };
 
 
@@ -306,12 +334,6 @@ public:
 	string getContinentByCountry(const char *country);
 	void prepareReload();
 	void applyReload();
-	void lock() {
-		while(__sync_lock_test_and_set(&_sync, 1));
-	}
-	void unlock() {
-		__sync_lock_release(&_sync);
-	}
 	void lock_reload() {
 		while(__sync_lock_test_and_set(&_sync_reload, 1));
 	}
@@ -319,16 +341,15 @@ public:
 		__sync_lock_release(&_sync_reload);
 	}
 private:
-	CountryCodes *countryCodes;
-	CountryPrefixes *countryPrefixes;
-	GeoIP_country *geoIP_country;
-	CheckInternational *checkInternational;
+	CountryCodes * volatile countryCodes;
+	CountryPrefixes * volatile countryPrefixes;
+	GeoIP_country * volatile geoIP_country;
+	CheckInternational * volatile checkInternational;
 	CountryCodes *countryCodes_reload;
 	CountryPrefixes *countryPrefixes_reload;
 	GeoIP_country *geoIP_country_reload;
 	CheckInternational *checkInternational_reload;
 	volatile bool reload_do;
-	volatile int _sync;
 	volatile int _sync_reload;
 };
 
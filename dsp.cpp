@@ -64,6 +64,12 @@
 #include <string.h>
 #include "jitterbuffer/asterisk/frame.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "dsp.h"
 #include "voipmonitor_define.h"
 
@@ -145,6 +151,112 @@ static inline void goertzel_sample(goertzel_state_t *s, short sample)
 	}
 }
 
+/*
+ * Goertzel filter bank - all filters of the detector (8 DTMF row/column filters, 6 MF tones,
+ * progress tones) are fed by the same samples, so they are evaluated in SIMD lanes over
+ * the whole block of samples. Every lane does exactly the integer operations of goertzel_sample
+ * (including per-lane chunky rescaling), so the results are bit-identical with scalar code.
+ */
+#if defined(__AVX2__)
+#define GOERTZEL_BANK_LANES 8
+#elif defined(__ARM_NEON)
+#define GOERTZEL_BANK_LANES 4
+#else
+#define GOERTZEL_BANK_LANES 0
+#endif
+
+static int goertzel_bank_simd = GOERTZEL_BANK_LANES > 0;
+
+#if GOERTZEL_BANK_LANES
+static void goertzel_bank_update_lanes(goertzel_state_t *s[], int n, int16_t *amp, int count)
+{
+	int32_t v2[GOERTZEL_BANK_LANES] = { 0 };
+	int32_t v3[GOERTZEL_BANK_LANES] = { 0 };
+	int32_t chunky[GOERTZEL_BANK_LANES] = { 0 };
+	int32_t fac[GOERTZEL_BANK_LANES] = { 0 };
+	int i;
+
+	for (i = 0; i < n; i++) {
+		v2[i] = s[i]->v2;
+		v3[i] = s[i]->v3;
+		chunky[i] = s[i]->chunky;
+		fac[i] = s[i]->fac;
+	}
+#if defined(__AVX2__)
+	__m256i _v2 = _mm256_loadu_si256((__m256i*)v2);
+	__m256i _v3 = _mm256_loadu_si256((__m256i*)v3);
+	__m256i _chunky = _mm256_loadu_si256((__m256i*)chunky);
+	__m256i _fac = _mm256_loadu_si256((__m256i*)fac);
+	__m256i _limit = _mm256_set1_epi32(32768);
+	for (i = 0; i < count; i++) {
+		__m256i _v1 = _v2;
+		_v2 = _v3;
+		_v3 = _mm256_srai_epi32(_mm256_mullo_epi32(_fac, _v2), 15);
+		_v3 = _mm256_add_epi32(_mm256_sub_epi32(_v3, _v1),
+				       _mm256_srav_epi32(_mm256_set1_epi32(amp[i]), _chunky));
+		__m256i _over = _mm256_cmpgt_epi32(_mm256_abs_epi32(_v3), _limit);
+		_chunky = _mm256_sub_epi32(_chunky, _over);
+		_v3 = _mm256_blendv_epi8(_v3, _mm256_srai_epi32(_v3, 1), _over);
+		_v2 = _mm256_blendv_epi8(_v2, _mm256_srai_epi32(_v2, 1), _over);
+	}
+	_mm256_storeu_si256((__m256i*)v2, _v2);
+	_mm256_storeu_si256((__m256i*)v3, _v3);
+	_mm256_storeu_si256((__m256i*)chunky, _chunky);
+#elif defined(__ARM_NEON)
+	int32x4_t _v2 = vld1q_s32(v2);
+	int32x4_t _v3 = vld1q_s32(v3);
+	int32x4_t _chunky = vld1q_s32(chunky);
+	int32x4_t _fac = vld1q_s32(fac);
+	int32x4_t _limit = vdupq_n_s32(32768);
+	for (i = 0; i < count; i++) {
+		int32x4_t _v1 = _v2;
+		_v2 = _v3;
+		_v3 = vshrq_n_s32(vmulq_s32(_fac, _v2), 15);
+		_v3 = vaddq_s32(vsubq_s32(_v3, _v1),
+				vshlq_s32(vdupq_n_s32(amp[i]), vnegq_s32(_chunky)));
+		uint32x4_t _over = vcgtq_s32(vabsq_s32(_v3), _limit);
+		_chunky = vsubq_s32(_chunky, vreinterpretq_s32_u32(_over));
+		_v3 = vbslq_s32(_over, vshrq_n_s32(_v3, 1), _v3);
+		_v2 = vbslq_s32(_over, vshrq_n_s32(_v2, 1), _v2);
+	}
+	vst1q_s32(v2, _v2);
+	vst1q_s32(v3, _v3);
+	vst1q_s32(chunky, _chunky);
+#endif
+	for (i = 0; i < n; i++) {
+		s[i]->v2 = v2[i];
+		s[i]->v3 = v3[i];
+		s[i]->chunky = chunky[i];
+	}
+}
+#endif
+
+static void goertzel_bank_update(goertzel_state_t *s[], int n, int16_t *amp, int count)
+{
+	int i;
+	int j;
+
+#if GOERTZEL_BANK_LANES
+	if (goertzel_bank_simd) {
+		for (i = 0; i < n; i += GOERTZEL_BANK_LANES) {
+			goertzel_bank_update_lanes(s + i, n - i < GOERTZEL_BANK_LANES ? n - i : GOERTZEL_BANK_LANES, amp, count);
+		}
+		return;
+	}
+#endif
+	for (j = 0; j < count; j++) {
+		for (i = 0; i < n; i++) {
+			goertzel_sample(s[i], amp[j]);
+		}
+	}
+}
+
+int dsp_set_goertzel_simd(int simd)
+{
+	goertzel_bank_simd = simd && GOERTZEL_BANK_LANES > 0;
+	return goertzel_bank_simd;
+}
+
 /*
 static inline void goertzel_update(goertzel_state_t *s, short *samps, int count)
 {
@@ -461,6 +573,17 @@ static int dtmf_detect(struct dsp */*dsp*/, digit_detect_state_t *s, int16_t amp
 		}
 		/* The following unrolled loop takes only 35% (rough estimate) of the
 		   time of a rolled loop on the machine on which it was developed */
+		if (goertzel_bank_simd) {
+			goertzel_state_t *bank[8] = {
+				s->td.dtmf.row_out, s->td.dtmf.row_out + 1, s->td.dtmf.row_out + 2, s->td.dtmf.row_out + 3,
+				s->td.dtmf.col_out, s->td.dtmf.col_out + 1, s->td.dtmf.col_out + 2, s->td.dtmf.col_out + 3
+			};
+			for (j = sample; j < limit; j++) {
+				samp = amp[j];
+				s->td.dtmf.energy += (int32_t) samp * (int32_t) samp;
+			}
+			goertzel_bank_update(bank, 8, amp + sample, limit - sample);
+		} else
 		for (j = sample; j < limit; j++) {
 			samp = amp[j];
 			s->td.dtmf.energy += (int32_t) samp * (int32_t) samp;
@@ -662,6 +785,13 @@ static int mf_detect(struct dsp */*dsp*/, digit_detect_state_t *s, int16_t amp[]
 		}
 		/* The following unrolled loop takes only 35% (rough estimate) of the
 		   time of a rolled loop on the machine on which it was developed */
+		if (goertzel_bank_simd) {
+			goertzel_state_t *bank[6] = {
+				s->td.mf.tone_out, s->td.mf.tone_out + 1, s->td.mf.tone_out + 2,
+				s->td.mf.tone_out + 3, s->td.mf.tone_out + 4, s->td.mf.tone_out + 5
+			};
+			goertzel_bank_update(bank, 6, amp + sample, limit - sample);
+		} else
 		for (j = sample; j < limit; j++) {
 			/* With GCC 2.95, the following unrolled code seems to take about 35%
 			   (rough estimate) as long as a neat little 0-3 loop */
@@ -824,6 +954,17 @@ static int __dsp_call_progress(struct dsp *dsp, short *s, int len)
 		if (pass > dsp->gsamp_size - dsp->gsamps) {
 			pass = dsp->gsamp_size - dsp->gsamps;
 		}
+		if (goertzel_bank_simd) {
+			goertzel_state_t *bank[10];
+			for (y = 0; y < dsp->freqcount; y++) {
+				bank[y] = &dsp->freqs[y];
+			}
+			for (x = 0; x < pass; x++) {
+				samp = s[x];
+				dsp->genergy += (int32_t) samp * (int32_t) samp;
+			}
+			goertzel_bank_update(bank, dsp->freqcount, s, pass);
+		} else
 		for (x = 0; x < pass; x++) {
 			samp = s[x];
 			dsp->genergy += (int32_t) samp * (int32_t) samp;
@@ -473,4 +473,10 @@ int dsp_reload(void);
  */
 int dsp_init(void);
 
+/*!
+ * \brief Enable/disable SIMD (AVX2/NEON) evaluation of goertzel filter banks
+ * \return nonzero if SIMD is used (it is available only if sniffer is built for AVX2/NEON)
+ */
+int dsp_set_goertzel_simd(int simd);
+
 #endif /* _DSP_H */
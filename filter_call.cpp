@@ -272,10 +272,12 @@ void cUserRestriction::apply() {
 	if(!src_ip.empty()) {
 		cond_ip = new FILE_LINE(0) ListIP;
 		cond_ip->add(src_ip.c_str());
+		cond_ip->prepareLpm();
 	}
 	if(!src_number.empty()) {
 		cond_number = new FILE_LINE(0) ListPhoneNumber;
 		cond_number->add(src_number.c_str());
+		cond_number->prepareLpm();
 	}
 	if(!src_domain.empty()) {
 		cond_domain = new FILE_LINE(0) ListCheckString;
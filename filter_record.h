@@ -81,6 +81,7 @@ public:
 	}
 	void addWhite(const char *ip) {
 		ipData.addWhite(ip);
+		ipData.prepareLpm();
 	}
 	bool check(void *rec, bool *findInBlackList = NULL) {
 		if(!ipData.checkIP(getField_ip(rec), findInBlackList)) {
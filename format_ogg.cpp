@@ -269,24 +269,10 @@ static void ogg_close(struct vorbis_desc *s, FILE *f)
 	//ogg_sync_destroy(&s->oy);
 }
 
-int ogg_mix(char *in1, char *in2, char *out, int stereo, int samplerate, double quality, int swap) {
-	FILE *f_in[2] = { NULL, NULL };
+int ogg_mix(FILE *in1, FILE *in2, char *out, int stereo, int samplerate, double quality, int swap) {
+	FILE *f_in[2] = { in1, in2 };
 	FILE *f_out = NULL;
 
-	/* combine two wavs */
-	f_in[0] = fopen(in1, "r");
-	if(!f_in[0]) {
-		syslog(LOG_ERR,"File [%s] cannot be opened for read.\n", in1);
-		return 1;
-	}
-	if(in2 != NULL) {
-		f_in[1] = fopen(in2, "r");
-		if(!f_in[1]) {
-			fclose(f_in[0]);
-			syslog(LOG_ERR,"File [%s] cannot be opened for read.\n", in2);
-			return 1;
-		}
-	}
 	for(int passOpen = 0; passOpen < 2; passOpen++) {
 		if(passOpen == 1) {
 			char *pointToLastDirSeparator = strrchr(out, '/');
@@ -305,10 +291,6 @@ int ogg_mix(char *in1, char *in2, char *out, int stereo, int samplerate, double
 		}
 	}
 	if(!f_out) {
-		if(f_in[0] != NULL)
-			fclose(f_in[0]);
-		if(f_in[1] != NULL)
-			fclose(f_in[1]);
 		syslog(LOG_ERR,"File [%s] cannot be opened for write.\n", out);
 		return 1;
 	}
@@ -402,9 +384,6 @@ int ogg_mix(char *in1, char *in2, char *out, int stereo, int samplerate, double
 	fclose(f_out);
 
 	for(unsigned i = 0; i < 2; i++) {
-		if(f_in[i]) {
-			fclose(f_in[i]);
-		}
 		if(buff[i]) {
 			delete [] buff[i];
 		}
@@ -412,3 +391,29 @@ int ogg_mix(char *in1, char *in2, char *out, int stereo, int samplerate, double
 	
 	return 0;
 }
+
+int ogg_mix(char *in1, char *in2, char *out, int stereo, int samplerate, double quality, int swap) {
+	FILE *f_in[2] = { NULL, NULL };
+
+	/* combine two wavs */
+	f_in[0] = fopen(in1, "r");
+	if(!f_in[0]) {
+		syslog(LOG_ERR,"File [%s] cannot be opened for read.\n", in1);
+		return 1;
+	}
+	if(in2 != NULL) {
+		f_in[1] = fopen(in2, "r");
+		if(!f_in[1]) {
+			fclose(f_in[0]);
+			syslog(LOG_ERR,"File [%s] cannot be opened for read.\n", in2);
+			return 1;
+		}
+	}
+	int rslt = ogg_mix(f_in[0], f_in[1], out, stereo, samplerate, quality, swap);
+	for(unsigned i = 0; i < 2; i++) {
+		if(f_in[i]) {
+			fclose(f_in[i]);
+		}
+	}
+	return(rslt);
+}
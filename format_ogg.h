@@ -27,6 +27,7 @@ struct vorbis_desc {    /* format specific parameters */
 };
 
 int ogg_mix(char *in1, char *in2, char *out, int stereo, int samplerate, double quality, int swap);
+int ogg_mix(FILE *in1, FILE *in2, char *out, int stereo, int samplerate, double quality, int swap);
 int ogg_header(FILE *f, struct vorbis_desc *tmp, int stereo, int samplerate, float quality);
 void write_stream_live(struct vorbis_desc *s, std::queue <char> spybuffer);
 int ogg_write_live(struct vorbis_desc *s, std::queue <char> *spybuffer, short *data);
@@ -109,24 +109,10 @@ int wav_update_header(FILE *f)
 	return 0;
 }
 
-int wav_mix(char *in1, char *in2, char *out, int samplerate, int swap, int stereo) {
-	FILE *f_in[2] = { NULL, NULL };
+int wav_mix(FILE *in1, FILE *in2, char *out, int samplerate, int swap, int stereo) {
+	FILE *f_in[2] = { in1, in2 };
 	FILE *f_out = NULL;
 
-	/* combine two wavs */
-	f_in[0] = fopen(in1, "r");
-	if(!f_in[0]) {
-		syslog(LOG_ERR,"File [%s] cannot be opened for read.\n", in1);
-		return 1;
-	}
-	if(in2 != NULL) {
-		f_in[1] = fopen(in2, "r");
-		if(!f_in[1]) {
-			fclose(f_in[0]);
-			syslog(LOG_ERR,"File [%s] cannot be opened for read.\n", in2);
-			return 1;
-		}
-	}
 	for(int passOpen = 0; passOpen < 2; passOpen++) {
 		if(passOpen == 1) {
 			char *pointToLastDirSeparator = strrchr(out, '/');
@@ -145,10 +131,6 @@ int wav_mix(char *in1, char *in2, char *out, int samplerate, int swap, int stere
 		}
 	}
 	if(!f_out) {
-		if(f_in[0] != NULL)
-			fclose(f_in[0]);
-		if(f_in[1] != NULL)
-			fclose(f_in[1]);
 		syslog(LOG_ERR,"File [%s] cannot be opened for write.\n", out);
 		return 1;
 	}
@@ -235,9 +217,6 @@ int wav_mix(char *in1, char *in2, char *out, int samplerate, int swap, int stere
 	fclose(f_out);
 	
 	for(unsigned i = 0; i < 2; i++) {
-		if(f_in[i]) {
-			fclose(f_in[i]);
-		}
 		if(buff[i]) {
 			delete [] buff[i];
 		}
@@ -246,4 +225,30 @@ int wav_mix(char *in1, char *in2, char *out, int samplerate, int swap, int stere
 	return 0;
 }
 
+int wav_mix(char *in1, char *in2, char *out, int samplerate, int swap, int stereo) {
+	FILE *f_in[2] = { NULL, NULL };
+
+	/* combine two wavs */
+	f_in[0] = fopen(in1, "r");
+	if(!f_in[0]) {
+		syslog(LOG_ERR,"File [%s] cannot be opened for read.\n", in1);
+		return 1;
+	}
+	if(in2 != NULL) {
+		f_in[1] = fopen(in2, "r");
+		if(!f_in[1]) {
+			fclose(f_in[0]);
+			syslog(LOG_ERR,"File [%s] cannot be opened for read.\n", in2);
+			return 1;
+		}
+	}
+	int rslt = wav_mix(f_in[0], f_in[1], out, samplerate, swap, stereo);
+	for(unsigned i = 0; i < 2; i++) {
+		if(f_in[i]) {
+			fclose(f_in[i]);
+		}
+	}
+	return(rslt);
+}
+
 
@@ -439,12 +439,14 @@ bool FraudAlert::loadAlert(bool *useUserRestriction, bool *useUserRestriction_cu
 		ipFilter.addWhite(dbRow["fraud_whitelist_ip_g"].c_str());
 		ipFilter.addBlack(dbRow["fraud_blacklist_ip"].c_str());
 		ipFilter.addBlack(dbRow["fraud_blacklist_ip_g"].c_str());
+		ipFilter.prepareLpm();
 	}
 	if(defFilterIp2()) {
 		ipFilter2.addWhite(dbRow["fraud_whitelist_ip_2"].c_str());
 		ipFilter2.addWhite(dbRow["fraud_whitelist_ip_2_g"].c_str());
 		ipFilter2.addBlack(dbRow["fraud_blacklist_ip_2"].c_str());
 		ipFilter2.addBlack(dbRow["fraud_blacklist_ip_2_g"].c_str());
+		ipFilter2.prepareLpm();
 	}
 	if(defFilterIpCondition12()) {
 		ipFilterCondition12 = dbRow["fraud_ip_condition_12"] == "and" ? _cond12_and :
@@ -459,12 +461,14 @@ bool FraudAlert::loadAlert(bool *useUserRestriction, bool *useUserRestriction_cu
 		phoneNumberFilter.addWhite(dbRow["fraud_whitelist_number_g"].c_str());
 		phoneNumberFilter.addBlack(dbRow["fraud_blacklist_number"].c_str());
 		phoneNumberFilter.addBlack(dbRow["fraud_blacklist_number_g"].c_str());
+		phoneNumberFilter.prepareLpm();
 	}
 	if(defFilterNumber2()) {
 		phoneNumberFilter2.addWhite(dbRow["fraud_whitelist_number_2"].c_str());
 		phoneNumberFilter2.addWhite(dbRow["fraud_whitelist_number_2_g"].c_str());
 		phoneNumberFilter2.addBlack(dbRow["fraud_blacklist_number_2"].c_str());
 		phoneNumberFilter2.addBlack(dbRow["fraud_blacklist_number_2_g"].c_str());
+		phoneNumberFilter2.prepareLpm();
 	}
 	if(defFilterNumberCondition12()) {
 		phoneNumberFilterCondition12 = dbRow["fraud_number_condition_12"] == "and" ? _cond12_and :
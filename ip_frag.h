@@ -1,10 +1,16 @@
 #ifndef IP_FRAG_H
 #define IP_FRAG_H
 
+#include <string>
 #include <net/ethernet.h>
 
 #include "header_packet.h"
 
+
+#define IPFRAG_MAX_FRAGMENTS_DEFAULT 4096
+#define IPFRAG_MAX_MEM_MB_DEFAULT 64
+
+
 struct ip_frag_s {
 	sHeaderPacket *header_packet;
 	void *header_packet_pqout;
@@ -13,22 +19,99 @@ struct ip_frag_s {
 	u_int32_t offset;
 	u_int32_t len;
 	u_int16_t iphdr_len;
+	ip_frag_s *next;		// next fragment in queue (sorted by offset) or next free node in slab
 };
 
-typedef map<unsigned int, ip_frag_s*> ip_frag_queue_t;
-typedef map<unsigned int, ip_frag_s*>::iterator ip_frag_queue_it_t;
-
-struct ip_frag_queue : ip_frag_queue_t {
-	ip_frag_queue() {
-		has_last = false;
-	}
+struct ip_frag_queue {
+	vmIP saddr;
+	vmIP daddr;
+	u_int32_t id;
+	u_int8_t protocol;
 	bool has_last;
+	u_int32_t hash;
+	u_int32_t table_index;
+	unsigned count;
+	u_int32_t size;
+	time_t ts;
+	ip_frag_s *first;
+	ip_frag_queue *expire_prev;
+	ip_frag_queue *expire_next;	// next in expire list (ordered by creation) or next free queue in slab
 };
 
+/*
+ * Fragment queues of one thread (pcapProcessData / PcapQueue_outputThread).
+ * Nodes and queues are taken from slabs preallocated at first use (udpfrag_max_fragments),
+ * queues are looked up in open-addressed table (linear probing, backward shift deletion)
+ * by (src, dst, id, protocol) and linked in expire list ordered by creation - ipfrag_prune
+ * only pops expired queues from the head. If slab is exhausted or size of held fragments exceeds
+ * udpfrag_max_mem, the oldest queues are evicted.
+ */
 struct ipfrag_data_s {
-	map<vmIP, map<unsigned int, ip_frag_queue*> > ip_frag_stream;
-	map<vmIP, map<unsigned int, ip_frag_queue*> >::iterator ip_frag_streamIT;
-	map<unsigned int, ip_frag_queue*>::iterator ip_frag_streamITinner;
+	ipfrag_data_s();
+	~ipfrag_data_s();
+	void init();
+	void term();
+	inline ip_frag_queue *find(vmIP &saddr, vmIP &daddr, u_int32_t id, u_int8_t protocol, u_int32_t hash) {
+		for(u_int32_t i = hash & table_mask; table[i]; i = (i + 1) & table_mask) {
+			ip_frag_queue *queue = table[i];
+			if(queue->hash == hash && queue->id == id && queue->protocol == protocol &&
+			   queue->saddr == saddr && queue->daddr == daddr) {
+				return(queue);
+			}
+		}
+		return(NULL);
+	}
+	ip_frag_queue *add_queue(vmIP &saddr, vmIP &daddr, u_int32_t id, u_int8_t protocol, u_int32_t hash, time_t ts);
+	void remove_queue(ip_frag_queue *queue);
+	inline ip_frag_s *alloc_node() {
+		ip_frag_s *node = nodes_free;
+		if(node) {
+			nodes_free = node->next;
+			node->next = NULL;
+		}
+		return(node);
+	}
+	inline void free_node(ip_frag_s *node) {
+		node->next = nodes_free;
+		nodes_free = node;
+	}
+	static inline u_int32_t hash(vmIP &saddr, vmIP &daddr, u_int32_t id, u_int8_t protocol) {
+		u_int32_t h = hash_ip(saddr) * 0x9E3779B1 ^ hash_ip(daddr) * 0x85EBCA77 ^ id * 0xC2B2AE3D ^ protocol;
+		h ^= h >> 15;
+		h *= 0x2C1B3C6D;
+		h ^= h >> 13;
+		return(h);
+	}
+	static inline u_int32_t hash_ip(vmIP &ip) {
+		#if VM_IPV6
+		if(ip.is_v6()) {
+			u_int32_t *ip_v6 = ip.ip.v6.__in6_u.__u6_addr32;
+			return(ip_v6[0] ^ ip_v6[1] ^ ip_v6[2] ^ ip_v6[3]);
+		}
+		#endif
+		return(ip.ip.v4.n);
+	}
+	ip_frag_s *nodes;
+	ip_frag_s *nodes_free;
+	unsigned nodes_count;
+	ip_frag_queue *queues;
+	ip_frag_queue *queues_free;
+	ip_frag_queue **table;
+	u_int32_t table_mask;
+	ip_frag_queue *expire_first;
+	ip_frag_queue *expire_last;
+	u_int64_t size;
+	u_int64_t max_size;
+};
+
+struct sIpFragStat {
+	volatile u_int64_t reassembled;
+	volatile u_int64_t timeout;
+	volatile u_int64_t evicted;
+	u_int64_t last_reassembled;
+	u_int64_t last_timeout;
+	u_int64_t last_evicted;
+	std::string getStatString();
 };
 
 void ipfrag_prune(unsigned int tv_sec, bool all, ipfrag_data_s *ipfrag_data,
@@ -37,4 +120,6 @@ int handle_defrag(iphdr2 *header_ip, sHeaderPacket **header_packet, ipfrag_data_
 		  int pushToStack_queue_index);
 int handle_defrag(iphdr2 *header_ip, void *header_packet_pqout, ipfrag_data_s *ipfrag_data);
 
+extern sIpFragStat ipfrag_stat;
+
 #endif
@@ -1662,6 +1662,7 @@ void CustIpCustomerCache::_load(map<vmIP, u_int32_t> *custCacheMap, list<custome
 			cust.list_ip = list_ip;
 			cust.id = customer_id;
 			custCache->push_back(cust);
+			custCache->back().list_ip.prepareLpm();
 			vector<IP> *vect_ip = list_ip.get_list_ip();
 			for(vector<IP>::iterator iter = vect_ip->begin(); iter != vect_ip->end(); iter++) {
 				(*custCacheMap)[iter->ip] = customer_id;
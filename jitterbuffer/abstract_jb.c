@@ -45,6 +45,7 @@
 #include "asterisk/abstract_jb.h"
 #include "fixedjitterbuf.h"
 #include "jitterbuf.h"
+#include "jb_pool.h"
 #include "../codecs.h"
 #include "../common.h"
 
@@ -313,6 +314,7 @@ int ast_jb_put(struct ast_channel *chan, struct ast_frame *f, struct timeval *my
 			ast_test_flag(f, AST_FRFLAG_HAS_TIMING_INFO), f->len, f->ts, f->src);
 		return -1;
 	}
+	jb_pool_count_packet();
 	frr = ast_frdup(f);
 
 	if (!frr) {
@@ -199,6 +199,8 @@ extern struct ast_frame ast_null_frame;
 #define AST_MALLOCD_DATA	(1 << 1)
 /*! Need the source be free'd? (haha!) */
 #define AST_MALLOCD_SRC		(1 << 2)
+/*! Header (incl. data) is from jb_pool */
+#define AST_MALLOCD_POOL	(1 << 3)
 
 /* MODEM subclasses */
 /*! T.38 Fax-over-IP */
@@ -37,6 +37,7 @@
 #include "asterisk/utils.h"
 #include "asterisk/channel.h"
 #include "fixedjitterbuf.h"
+#include "jb_pool.h"
 
 #undef FIXED_JB_DEBUG
 
@@ -61,8 +62,16 @@ struct fixed_jb
 	long next_delivery;
 	int force_resynch;
 	struct ast_channel *chan;
+	/* frames are taken from store allocated with jb (capacity by jbsize), jb_pool is used if store is full */
+	struct fixed_jb_frame *store;
+	struct fixed_jb_frame *store_free;
+	int store_size;
 };
 
+/* shortest expected frame - sets capacity of the frame store */
+#define FIXED_JB_STORE_FRAME_MS 10
+#define FIXED_JB_STORE_SIZE_MAX 200
+
 
 static struct fixed_jb_frame *alloc_jb_frame(struct fixed_jb *jb);
 static void release_jb_frame(struct fixed_jb *jb, struct fixed_jb_frame *frame);
@@ -71,12 +80,25 @@ static int resynch_jb(struct fixed_jb *jb, void *data, long ms, long ts, long no
 
 static inline struct fixed_jb_frame *alloc_jb_frame(struct fixed_jb *jb)
 {
-	return ast_calloc(1, sizeof(struct fixed_jb_frame));
+	struct fixed_jb_frame *frame;
+
+	if ((frame = jb->store_free)) {
+		jb->store_free = frame->next;
+	} else if (!(frame = jb_pool_alloc(JB_POOL_FIXED_JB_FRAME, sizeof(struct fixed_jb_frame)))) {
+		return NULL;
+	}
+	memset(frame, 0, sizeof(struct fixed_jb_frame));
+	return frame;
 }
 
 static inline void release_jb_frame(struct fixed_jb *jb, struct fixed_jb_frame *frame)
 {
-	ast_free(frame);
+	if (frame >= jb->store && frame < jb->store + jb->store_size) {
+		frame->next = jb->store_free;
+		jb->store_free = frame;
+	} else {
+		jb_pool_free(JB_POOL_FIXED_JB_FRAME, frame);
+	}
 }
 
 static void get_jb_head(struct fixed_jb *jb, struct fixed_jb_frame *frame)
@@ -107,11 +129,24 @@ static void get_jb_head(struct fixed_jb *jb, struct fixed_jb_frame *frame)
 struct fixed_jb *fixed_jb_new(struct fixed_jb_conf *conf, struct ast_channel *chan)
 {
 	struct fixed_jb *jb;
+	int store_size;
+	int i;
 	
-	if (!(jb = ast_calloc(1, sizeof(*jb))))
+	store_size = (conf->jbsize < 1 ? FIXED_JB_SIZE_DEFAULT : conf->jbsize) / FIXED_JB_STORE_FRAME_MS + 2;
+	if (store_size > FIXED_JB_STORE_SIZE_MAX)
+		store_size = FIXED_JB_STORE_SIZE_MAX;
+
+	if (!(jb = ast_calloc(1, sizeof(*jb) + store_size * sizeof(struct fixed_jb_frame))))
 		return NULL;
 
 	jb->chan = chan;
+
+	jb->store = (struct fixed_jb_frame *)(jb + 1);
+	jb->store_size = store_size;
+	for (i = store_size - 1; i >= 0; i--) {
+		jb->store[i].next = jb->store_free;
+		jb->store_free = &jb->store[i];
+	}
 	
 	/* First copy our config */
 	memcpy(&jb->conf, conf, sizeof(struct fixed_jb_conf));
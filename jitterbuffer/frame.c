@@ -45,6 +45,7 @@
 #include "asterisk/dsp.h"
 #include "asterisk/file.h"
 #include "asterisk/time.h"
+#include "jb_pool.h"
 
 #if !defined(LOW_MEMORY)
 static void frame_cache_cleanup(void *data);
@@ -307,7 +308,10 @@ static void __frame_free(struct ast_frame *fr, int cache)
 			ast_free((void *) fr->src);
 	}
 	if (fr->mallocd & AST_MALLOCD_HDR) {
-		ast_free(fr);
+		if (fr->mallocd & AST_MALLOCD_POOL)
+			jb_pool_free(JB_POOL_AST_FRAME, fr);
+		else
+			ast_free(fr);
 	}
 }
 
@@ -329,6 +333,7 @@ struct ast_frame *ast_frdup(const struct ast_frame *f)
 	struct ast_frame *out = NULL;
 	int len, srclen = 0;
 	void *buf = NULL;
+	int pooled = 0;
 
 	/* Start with standard stuff */
 	len = sizeof(*out) + AST_FRIENDLY_OFFSET + f->datalen;
@@ -342,6 +347,12 @@ struct ast_frame *ast_frdup(const struct ast_frame *f)
 	if (srclen > 0)
 		len += srclen + 1;
 
+	if (!buf && (buf = jb_pool_alloc(JB_POOL_AST_FRAME, len))) {
+		memset(buf, 0, len);
+		out = buf;
+		out->mallocd_hdr_len = len;
+		pooled = 1;
+	}
 	if (!buf) {
 		if (!(buf = ast_calloc(1, len)))
 			return NULL;
@@ -359,7 +370,7 @@ struct ast_frame *ast_frdup(const struct ast_frame *f)
 	out->skip = f->skip;
 	/* Set us as having malloc'd header only, so it will eventually
 	   get freed. */
-	out->mallocd = AST_MALLOCD_HDR;
+	out->mallocd = AST_MALLOCD_HDR | (pooled ? AST_MALLOCD_POOL : 0);
 	out->offset = AST_FRIENDLY_OFFSET;
 	if (out->datalen > 0) {
 		out->data = buf + sizeof(*out) + AST_FRIENDLY_OFFSET;
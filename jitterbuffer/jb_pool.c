@@ -0,0 +1,203 @@
+/*
+ * jb_pool: per-thread pools of jitterbuffer objects
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Free lists of jitterbuffer frames owned by threads.
+ *
+ * Objects may be released by other thread than the one which allocated them
+ * (stream is destroyed after the call is closed) - they are simply returned
+ * to the pool of releasing thread. Pool of a thread is released when the thread
+ * terminates.
+ */
+
+#include "asterisk.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "asterisk/frame.h"
+#include "asterisk/utils.h"
+#include "fixedjitterbuf.h"
+#include "jitterbuf.h"
+#include "jb_pool.h"
+
+
+struct jb_pool_object {
+	struct jb_pool_object *next;
+};
+
+struct jb_pool_thread {
+	struct jb_pool_object *free_list[JB_POOL_TYPES];
+	unsigned free_count[JB_POOL_TYPES];
+	struct jb_pool_stat stat;
+	struct jb_pool_thread *next;
+	struct jb_pool_thread *prev;
+};
+
+static __thread struct jb_pool_thread *jb_pool_this_thread;
+static struct jb_pool_thread *jb_pool_threads;
+static struct jb_pool_stat jb_pool_terminated_threads_stat;
+static volatile int jb_pool_sync;
+static pthread_key_t jb_pool_key;
+static pthread_once_t jb_pool_key_once = PTHREAD_ONCE_INIT;
+
+
+static inline void jb_pool_lock(void)
+{
+	while(__sync_lock_test_and_set(&jb_pool_sync, 1));
+}
+
+static inline void jb_pool_unlock(void)
+{
+	__sync_lock_release(&jb_pool_sync);
+}
+
+static void jb_pool_thread_destroy(void *data)
+{
+	struct jb_pool_thread *pool = data;
+	int type;
+
+	jb_pool_lock();
+	if (pool->prev) {
+		pool->prev->next = pool->next;
+	} else {
+		jb_pool_threads = pool->next;
+	}
+	if (pool->next) {
+		pool->next->prev = pool->prev;
+	}
+	jb_pool_terminated_threads_stat.packets += pool->stat.packets;
+	for (type = 0; type < JB_POOL_TYPES; type++) {
+		jb_pool_terminated_threads_stat.alloc[type] += pool->stat.alloc[type];
+		jb_pool_terminated_threads_stat.malloc[type] += pool->stat.malloc[type];
+		jb_pool_terminated_threads_stat.free[type] += pool->stat.free[type] + pool->free_count[type];
+	}
+	jb_pool_unlock();
+	for (type = 0; type < JB_POOL_TYPES; type++) {
+		struct jb_pool_object *object = pool->free_list[type];
+		while (object) {
+			struct jb_pool_object *next = object->next;
+			ast_free(object);
+			object = next;
+		}
+	}
+	if (pool == jb_pool_this_thread) {
+		jb_pool_this_thread = NULL;
+	}
+	ast_free(pool);
+}
+
+static void jb_pool_key_create(void)
+{
+	pthread_key_create(&jb_pool_key, jb_pool_thread_destroy);
+}
+
+static struct jb_pool_thread *jb_pool_get_thread(void)
+{
+	struct jb_pool_thread *pool = jb_pool_this_thread;
+
+	if (pool) {
+		return pool;
+	}
+	pthread_once(&jb_pool_key_once, jb_pool_key_create);
+	if (!(pool = ast_calloc(1, sizeof(*pool)))) {
+		return NULL;
+	}
+	jb_pool_lock();
+	pool->next = jb_pool_threads;
+	if (jb_pool_threads) {
+		jb_pool_threads->prev = pool;
+	}
+	jb_pool_threads = pool;
+	jb_pool_unlock();
+	pthread_setspecific(jb_pool_key, pool);
+	jb_pool_this_thread = pool;
+	return pool;
+}
+
+size_t jb_pool_object_size(enum jb_pool_type type)
+{
+	switch (type) {
+	case JB_POOL_AST_FRAME:
+		return sizeof(struct ast_frame) + AST_FRIENDLY_OFFSET + JB_POOL_AST_FRAME_DATA_MAX;
+	case JB_POOL_FIXED_JB_FRAME:
+		return sizeof(struct fixed_jb_frame);
+	case JB_POOL_JB_FRAME:
+		return sizeof(jb_frame);
+	default:
+		return 0;
+	}
+}
+
+/*! \brief Returns object of pool type or NULL if size exceeds size of pool objects or malloc failed */
+void *jb_pool_alloc(enum jb_pool_type type, size_t size)
+{
+	struct jb_pool_thread *pool;
+	struct jb_pool_object *object;
+
+	if (size > jb_pool_object_size(type) ||
+	    !(pool = jb_pool_get_thread())) {
+		return NULL;
+	}
+	if ((object = pool->free_list[type])) {
+		pool->free_list[type] = object->next;
+		pool->free_count[type]--;
+		pool->stat.alloc[type]++;
+		return object;
+	}
+	pool->stat.malloc[type]++;
+	return ast_malloc(jb_pool_object_size(type));
+}
+
+void jb_pool_free(enum jb_pool_type type, void *p)
+{
+	struct jb_pool_thread *pool = jb_pool_get_thread();
+	struct jb_pool_object *object = p;
+
+	if (!pool || pool->free_count[type] >= JB_POOL_FREE_MAX) {
+		if (pool) {
+			pool->stat.free[type]++;
+		}
+		ast_free(p);
+		return;
+	}
+	object->next = pool->free_list[type];
+	pool->free_list[type] = object;
+	pool->free_count[type]++;
+}
+
+void jb_pool_count_packet(void)
+{
+	struct jb_pool_thread *pool = jb_pool_get_thread();
+
+	if (pool) {
+		pool->stat.packets++;
+	}
+}
+
+/*! \brief Sum of counters of all threads - counters of running threads are read without lock (approximate values) */
+void jb_pool_get_stat(struct jb_pool_stat *stat)
+{
+	struct jb_pool_thread *pool;
+	int type;
+
+	jb_pool_lock();
+	*stat = jb_pool_terminated_threads_stat;
+	for (pool = jb_pool_threads; pool; pool = pool->next) {
+		stat->packets += pool->stat.packets;
+		for (type = 0; type < JB_POOL_TYPES; type++) {
+			stat->alloc[type] += pool->stat.alloc[type];
+			stat->malloc[type] += pool->stat.malloc[type];
+			stat->free[type] += pool->stat.free[type];
+			stat->pooled[type] += pool->free_count[type];
+		}
+	}
+	jb_pool_unlock();
+}
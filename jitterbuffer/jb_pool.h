@@ -0,0 +1,50 @@
+/*
+ * jb_pool: per-thread pools of jitterbuffer objects
+ *
+ * Every rtp packet passes through up to three simulated jitterbuffers
+ * (fixed 1, fixed 2, adaptive) and each of them stores a copy of the frame
+ * and a queue node. Objects are taken from/returned to a free list owned by
+ * the calling (rtp) thread, so malloc/free is called only while the pools
+ * are warming up or for oversized frames.
+ */
+
+#ifndef _JB_POOL_H_
+#define _JB_POOL_H_
+
+#include <sys/types.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+enum jb_pool_type {
+	JB_POOL_AST_FRAME,		/*!< ast_frame copy incl. data (ast_frdup) */
+	JB_POOL_FIXED_JB_FRAME,		/*!< fixed_jb_frame (if jb store is full) */
+	JB_POOL_JB_FRAME,		/*!< jb_frame of adaptive jitterbuffer */
+	JB_POOL_TYPES
+};
+
+/*! Max size of data (incl. src) of ast_frame served from pool */
+#define JB_POOL_AST_FRAME_DATA_MAX	512
+/*! Max count of free objects kept in one thread per type */
+#define JB_POOL_FREE_MAX		4096
+
+struct jb_pool_stat {
+	u_int64_t packets;			/*!< frames put to jitterbuffers (ast_jb_put) */
+	u_int64_t alloc[JB_POOL_TYPES];		/*!< allocations served from pool */
+	u_int64_t malloc[JB_POOL_TYPES];	/*!< allocations passed to malloc */
+	u_int64_t free[JB_POOL_TYPES];		/*!< objects released to malloc (pool is full) */
+	u_int64_t pooled[JB_POOL_TYPES];	/*!< free objects held by pools */
+};
+
+void *jb_pool_alloc(enum jb_pool_type type, size_t size);
+void jb_pool_free(enum jb_pool_type type, void *p);
+size_t jb_pool_object_size(enum jb_pool_type type);
+void jb_pool_count_packet(void);
+void jb_pool_get_stat(struct jb_pool_stat *stat);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _JB_POOL_H_ */
@@ -35,6 +35,7 @@
 #include <sys/types.h>
 
 #include "jitterbuf.h"
+#include "jb_pool.h"
 #include "asterisk/utils.h"
 
 /*! define these here, just for ancient compiler systems */
@@ -78,13 +79,13 @@ void jb_reset(jitterbuf *jb)
 	frame = jb->free;
 	while (frame != NULL) {
 		jb_frame *next = frame->next;
-		ast_free(frame);
+		jb_pool_free(JB_POOL_JB_FRAME, frame);
 		frame = next;
 	}
 	frame = jb->frames;
 	while (frame != NULL) {
 		jb_frame *next = frame->next;
-		ast_free(frame);
+		jb_pool_free(JB_POOL_JB_FRAME, frame);
 		frame = next;
 	}
 	jb->free = NULL;
@@ -122,7 +123,7 @@ void jb_destroy(jitterbuf *jb)
 	frame = jb->free;
 	while (frame != NULL) {
 		jb_frame *next = frame->next;
-		ast_free(frame);
+		jb_pool_free(JB_POOL_JB_FRAME, frame);
 		frame = next;
 	}
 
@@ -356,7 +357,7 @@ static int queue_put(jitterbuf *jb, void *data, const enum jb_frame_type type, l
 
 	if ((frame = jb->free)) {
 		jb->free = frame->next;
-	} else if (!(frame = ast_malloc(sizeof(*frame)))) {
+	} else if (!(frame = jb_pool_alloc(JB_POOL_JB_FRAME, sizeof(*frame)))) {
 		jb_err("cannot allocate frame\n");
 		return 0;
 	}
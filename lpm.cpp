@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <list>
+
+#include "lpm.h"
+#include "tools_global.h"
+
+
+void cLpmTrie::add(sLpmKey key, unsigned length, u_int32_t value) {
+	if(length > 128) {
+		length = 128;
+	}
+	sPrefix prefix;
+	prefix.key.hi = length >= 64 ? key.hi : length ? key.hi & (~0ull << (64 - length)) : 0;
+	prefix.key.lo = length >= 128 ? key.lo : length > 64 ? key.lo & (~0ull << (128 - length)) : 0;
+	prefix.length = length;
+	prefix.value = value;
+	prefixes.push_back(prefix);
+}
+
+void cLpmTrie::build() {
+	nodes.clear();
+	leaves.clear();
+	if(!prefixes.size()) {
+		return;
+	}
+	std::sort(prefixes.begin(), prefixes.end());
+	u_int32_t value = 0;
+	for(unsigned i = 0; i < prefixes.size(); i++) {
+		if(!prefixes[i].length) {
+			value = prefixes[i].value;
+		}
+	}
+	nodes.resize(1);
+	buildNode(0, 0, prefixes.size(), 0, value);
+	vector<sPrefix>().swap(prefixes);
+}
+
+void cLpmTrie::clear() {
+	vector<sNode>().swap(nodes);
+	vector<u_int32_t>().swap(leaves);
+	vector<sPrefix>().swap(prefixes);
+}
+
+void cLpmTrie::buildNode(unsigned nodeIndex, unsigned prefixFrom, unsigned prefixTo, unsigned depth, u_int32_t value) {
+	const unsigned slots = 1 << LPM_TRIE_STRIDE;
+	unsigned offset = depth * LPM_TRIE_STRIDE;
+	u_int32_t slotValue[slots];
+	u_int8_t slotLength[slots];
+	unsigned childFrom[slots];
+	unsigned childTo[slots];
+	for(unsigned i = 0; i < slots; i++) {
+		slotValue[i] = value;
+		slotLength[i] = 0;
+	}
+	// prefixes are sorted by key - prefixes going to the same child are contiguous
+	u_int64_t vector = 0;
+	for(unsigned i = prefixFrom; i < prefixTo; i++) {
+		sPrefix *prefix = &prefixes[i];
+		if(prefix->length <= offset) {
+			continue;
+		}
+		unsigned slot = getSlot(prefix->key, offset);
+		if(prefix->length <= offset + LPM_TRIE_STRIDE) {
+			unsigned hostBits = offset + LPM_TRIE_STRIDE - prefix->length;
+			unsigned slotFrom = slot >> hostBits << hostBits;
+			for(unsigned j = slotFrom; j < slotFrom + (1 << hostBits); j++) {
+				if(prefix->length >= slotLength[j]) {
+					slotValue[j] = prefix->value;
+					slotLength[j] = prefix->length;
+				}
+			}
+		} else {
+			if(!(vector & (1ull << slot))) {
+				vector |= 1ull << slot;
+				childFrom[slot] = i;
+			}
+			childTo[slot] = i + 1;
+		}
+	}
+	u_int64_t leafvec = 0;
+	u_int32_t base0 = leaves.size();
+	bool existsLeaf = false;
+	for(unsigned i = 0; i < slots; i++) {
+		if(vector & (1ull << i)) {
+			continue;
+		}
+		if(!existsLeaf || slotValue[i] != leaves[leaves.size() - 1]) {
+			leafvec |= 1ull << i;
+			leaves.push_back(slotValue[i]);
+			existsLeaf = true;
+		}
+	}
+	u_int32_t base1 = nodes.size();
+	nodes.resize(nodes.size() + __builtin_popcountll(vector));
+	nodes[nodeIndex].vector = vector;
+	nodes[nodeIndex].leafvec = leafvec;
+	nodes[nodeIndex].base0 = base0;
+	nodes[nodeIndex].base1 = base1;
+	unsigned childIndex = base1;
+	for(unsigned i = 0; i < slots; i++) {
+		if(vector & (1ull << i)) {
+			buildNode(childIndex++, childFrom[i], childTo[i], depth + 1, slotValue[i]);
+		}
+	}
+}
+
+
+static inline bool lpm_key_le(sLpmKey &key1, sLpmKey &key2) {
+	return(key1.hi < key2.hi || (key1.hi == key2.hi && key1.lo <= key2.lo));
+}
+
+static inline unsigned lpm_key_tz(sLpmKey &key) {
+	return(key.lo ? __builtin_ctzll(key.lo) :
+	       key.hi ? 64 + __builtin_ctzll(key.hi) : 128);
+}
+
+static inline sLpmKey lpm_key_or_low(sLpmKey &key, unsigned bits) {
+	sLpmKey rslt = key;
+	if(bits >= 64) {
+		rslt.lo = ~0ull;
+		if(bits >= 128) {
+			rslt.hi = ~0ull;
+		} else if(bits > 64) {
+			rslt.hi |= (1ull << (bits - 64)) - 1;
+		}
+	} else if(bits) {
+		rslt.lo |= (1ull << bits) - 1;
+	}
+	return(rslt);
+}
+
+static inline bool lpm_key_add_pow2(sLpmKey *key, unsigned bits) {
+	if(bits < 64) {
+		u_int64_t lo = key->lo;
+		key->lo += 1ull << bits;
+		if(key->lo < lo) {
+			return(++key->hi == 0);
+		}
+		return(false);
+	} else if(bits < 128) {
+		u_int64_t hi = key->hi;
+		key->hi += 1ull << (bits - 64);
+		return(key->hi < hi);
+	}
+	return(true);
+}
+
+void cLpmIP::add(vmIP ip, unsigned mask_length, u_int32_t value) {
+	if(!mask_length || mask_length > ip.bits()) {
+		mask_length = ip.bits();
+	}
+	(ip.is_v6() ? trie_v6 : trie_v4).add(getKey(ip), mask_length, value);
+}
+
+void cLpmIP::addRange(vmIP ip_from, vmIP ip_to, u_int32_t value) {
+	// split range to nets (the largest aligned blocks) - keys are right aligned here
+	if(ip_from.is_v6() != ip_to.is_v6()) {
+		return;
+	}
+	bool v6 = ip_from.is_v6();
+	unsigned bits = ip_from.bits();
+	sLpmKey from = getKey(ip_from);
+	sLpmKey to = getKey(ip_to);
+	if(!v6) {
+		from = sLpmKey(0, from.hi >> 32);
+		to = sLpmKey(0, to.hi >> 32);
+	}
+	if(!lpm_key_le(from, to)) {
+		return;
+	}
+	while(true) {
+		unsigned hostBits = min(lpm_key_tz(from), bits);
+		sLpmKey last = lpm_key_or_low(from, hostBits);
+		while(hostBits && !lpm_key_le(last, to)) {
+			--hostBits;
+			last = lpm_key_or_low(from, hostBits);
+		}
+		if(v6) {
+			trie_v6.add(from, bits - hostBits, value);
+		} else {
+			trie_v4.add(sLpmKey(from.lo << 32, 0), bits - hostBits, value);
+		}
+		if(last.hi == to.hi && last.lo == to.lo) {
+			break;
+		}
+		if(lpm_key_add_pow2(&from, hostBits)) {
+			break;
+		}
+	}
+}
+
+void cLpmIP::build() {
+	trie_v4.build();
+	trie_v6.build();
+}
+
+void cLpmIP::clear() {
+	trie_v4.clear();
+	trie_v6.clear();
+}
+
+
+bool cLpmNumber::add(const char *number, bool prefix, u_int32_t value) {
+	for(unsigned i = 0; number[i]; i++) {
+		if(getSymbol(number[i]) < 0) {
+			return(false);
+		}
+	}
+	if(!build_nodes.size()) {
+		build_nodes.push_back(sBuildNode());
+	}
+	unsigned nodeIndex = 0;
+	for(unsigned i = 0; number[i]; i++) {
+		int symbol = getSymbol(number[i]);
+		if(!build_nodes[nodeIndex].child[symbol]) {
+			build_nodes[nodeIndex].child[symbol] = build_nodes.size();
+			build_nodes.push_back(sBuildNode());
+		}
+		nodeIndex = build_nodes[nodeIndex].child[symbol];
+	}
+	if(prefix) {
+		build_nodes[nodeIndex].value_prefix = value;
+	} else {
+		build_nodes[nodeIndex].value_exact = value;
+	}
+	return(true);
+}
+
+void cLpmNumber::build() {
+	nodes.clear();
+	if(!build_nodes.size()) {
+		return;
+	}
+	// breadth-first order - children of every node are contiguous
+	vector<u_int32_t> order;
+	order.push_back(0);
+	nodes.resize(1);
+	for(unsigned i = 0; i < order.size(); i++) {
+		sBuildNode *build_node = &build_nodes[order[i]];
+		nodes[i].children = 0;
+		nodes[i].base = order.size();
+		nodes[i].value_prefix = build_node->value_prefix;
+		nodes[i].value_exact = build_node->value_exact;
+		for(unsigned j = 0; j < LPM_NUMBER_SYMBOLS; j++) {
+			if(build_node->child[j]) {
+				nodes[i].children |= 1 << j;
+				order.push_back(build_node->child[j]);
+			}
+		}
+		nodes.resize(order.size());
+	}
+	vector<sBuildNode>().swap(build_nodes);
+}
+
+void cLpmNumber::lookupAll(const char *number, vector<u_int32_t> *values_prefix, u_int32_t *value_exact) {
+	if(values_prefix) {
+		values_prefix->clear();
+	}
+	if(value_exact) {
+		*value_exact = 0;
+	}
+	if(!nodes.size()) {
+		return;
+	}
+	sNode *node = &nodes[0];
+	for(unsigned i = 0; ; i++) {
+		if(node->value_prefix && values_prefix) {
+			values_prefix->push_back(node->value_prefix);
+		}
+		if(!number[i]) {
+			if(value_exact) {
+				*value_exact = node->value_exact;
+			}
+			break;
+		}
+		int symbol = getSymbol(number[i]);
+		if(symbol < 0 || !(node->children & (1 << symbol))) {
+			break;
+		}
+		node = &nodes[node->base + __builtin_popcount(node->children & ((1 << symbol) - 1))];
+	}
+}
+
+void cLpmNumber::clear() {
+	vector<sNode>().swap(nodes);
+	vector<sBuildNode>().swap(build_nodes);
+}
+
+
+struct sLpmRetired {
+	void *obj;
+	void (*destroy)(void *obj);
+	u_int32_t at;
+};
+
+static list<sLpmRetired> lpm_retired;
+static volatile int lpm_retired_sync = 0;
+
+void lpm_retire_obj(void *obj, void (*destroy)(void *obj)) {
+	sLpmRetired retired;
+	retired.obj = obj;
+	retired.destroy = destroy;
+	retired.at = getTimeS();
+	while(__sync_lock_test_and_set(&lpm_retired_sync, 1));
+	lpm_retired.push_back(retired);
+	__sync_lock_release(&lpm_retired_sync);
+	lpm_retired_cleanup();
+}
+
+void lpm_retired_cleanup(bool force) {
+	u_int32_t now = getTimeS();
+	list<sLpmRetired> expired;
+	while(__sync_lock_test_and_set(&lpm_retired_sync, 1));
+	while(lpm_retired.size() && (force || lpm_retired.front().at + LPM_RETIRE_GRACE_S <= now)) {
+		expired.push_back(lpm_retired.front());
+		lpm_retired.pop_front();
+	}
+	__sync_lock_release(&lpm_retired_sync);
+	for(list<sLpmRetired>::iterator iter = expired.begin(); iter != expired.end(); iter++) {
+		iter->destroy(iter->obj);
+	}
+}
@@ -0,0 +1,242 @@
+#ifndef LPM_H
+#define LPM_H
+
+
+#include <vector>
+#include <string>
+#include <sys/types.h>
+
+#include "ip.h"
+
+
+using namespace std;
+
+
+#define LPM_TRIE_STRIDE 6
+#define LPM_NUMBER_SYMBOLS 13
+#define LPM_RETIRE_GRACE_S 60
+
+
+struct sLpmKey {
+	sLpmKey(u_int64_t hi = 0, u_int64_t lo = 0) {
+		this->hi = hi;
+		this->lo = lo;
+	}
+	u_int64_t hi;
+	u_int64_t lo;
+};
+
+
+/*
+ * Longest prefix match over keys up to 128 bits (poptrie).
+ * Prefixes are collected by add and compiled by build into the array of nodes with 64 slots (6 bits of the key).
+ * Node has bitmap of slots with child node and bitmap of starts of leaf runs (leaf pushing - consecutive
+ * leaves with the same value are stored once), index of the child / leaf is base + popcount of bitmap up to slot.
+ * Lookup is read only - built trie may be used by more threads without locking.
+ * Value 0 means not found.
+ */
+class cLpmTrie {
+public:
+	struct sNode {
+		u_int64_t vector;
+		u_int64_t leafvec;
+		u_int32_t base0;
+		u_int32_t base1;
+	};
+	struct sPrefix {
+		sLpmKey key;
+		u_int8_t length;
+		u_int32_t value;
+		bool operator < (const sPrefix &other) const {
+			return(key.hi != other.key.hi ? key.hi < other.key.hi :
+			       key.lo != other.key.lo ? key.lo < other.key.lo :
+			       length < other.length);
+		}
+	};
+public:
+	void add(sLpmKey key, unsigned length, u_int32_t value);
+	void build();
+	void clear();
+	inline u_int32_t lookup(sLpmKey &key) {
+		if(!nodes.size()) {
+			return(0);
+		}
+		sNode *node = &nodes[0];
+		for(unsigned offset = 0; ; offset += LPM_TRIE_STRIDE) {
+			unsigned slot = getSlot(key, offset);
+			u_int64_t mask = (2ull << slot) - 1;
+			if(node->vector & (1ull << slot)) {
+				node = &nodes[node->base1 + __builtin_popcountll(node->vector & mask) - 1];
+			} else {
+				return(leaves[node->base0 + __builtin_popcountll(node->leafvec & mask) - 1]);
+			}
+		}
+	}
+	bool isEmpty() {
+		return(!nodes.size() && !prefixes.size());
+	}
+	size_t getMemorySize() {
+		return(nodes.size() * sizeof(sNode) + leaves.size() * sizeof(u_int32_t));
+	}
+	static inline unsigned getSlot(sLpmKey &key, unsigned offset) {
+		if(offset + LPM_TRIE_STRIDE <= 64) {
+			return((key.hi >> (64 - LPM_TRIE_STRIDE - offset)) & ((1 << LPM_TRIE_STRIDE) - 1));
+		} else if(offset >= 64) {
+			offset -= 64;
+			return((offset + LPM_TRIE_STRIDE <= 64 ?
+				 key.lo >> (64 - LPM_TRIE_STRIDE - offset) :
+				 key.lo << (offset - (64 - LPM_TRIE_STRIDE))) & ((1 << LPM_TRIE_STRIDE) - 1));
+		} else {
+			return(((key.hi << (offset - (64 - LPM_TRIE_STRIDE))) |
+				(key.lo >> (128 - LPM_TRIE_STRIDE - offset))) & ((1 << LPM_TRIE_STRIDE) - 1));
+		}
+	}
+private:
+	void buildNode(unsigned nodeIndex, unsigned prefixFrom, unsigned prefixTo, unsigned depth, u_int32_t value);
+private:
+	vector<sNode> nodes;
+	vector<u_int32_t> leaves;
+	vector<sPrefix> prefixes;
+};
+
+
+/*
+ * Longest prefix match of ipv4 and ipv6 addresses (nets or ranges) - separate cLpmTrie for each family.
+ */
+class cLpmIP {
+public:
+	void add(vmIP ip, unsigned mask_length, u_int32_t value);
+	void addRange(vmIP ip_from, vmIP ip_to, u_int32_t value);
+	void build();
+	void clear();
+	inline u_int32_t lookup(vmIP ip) {
+		sLpmKey key = getKey(ip);
+		return(ip.is_v6() ? trie_v6.lookup(key) : trie_v4.lookup(key));
+	}
+	bool isEmpty() {
+		return(trie_v4.isEmpty() && trie_v6.isEmpty());
+	}
+	size_t getMemorySize() {
+		return(trie_v4.getMemorySize() + trie_v6.getMemorySize());
+	}
+	static inline sLpmKey getKey(vmIP ip) {
+		#if VM_IPV6
+		if(ip.is_v6()) {
+			in6_addr ip6 = ip.getIPv6();
+			return(sLpmKey(((u_int64_t)ip6.__in6_u.__u6_addr32[0] << 32) | ip6.__in6_u.__u6_addr32[1],
+				       ((u_int64_t)ip6.__in6_u.__u6_addr32[2] << 32) | ip6.__in6_u.__u6_addr32[3]));
+		}
+		#endif
+		return(sLpmKey((u_int64_t)ip.getIPv4() << 32, 0));
+	}
+private:
+	cLpmTrie trie_v4;
+	cLpmTrie trie_v6;
+};
+
+
+/*
+ * Longest prefix match of phone numbers - trie with node per digit, children of node are stored
+ * contiguously and indexed by popcount of children bitmap. Supported are digits and '+', '*', '#'
+ * (add returns false for number with other characters - caller has to use other lookup).
+ * Number can be added as prefix (matches all numbers beginning with it) or as exact number.
+ * Lookup returns value of the longest matching prefix, lookupAll returns values of all matching prefixes (shortest first).
+ */
+class cLpmNumber {
+public:
+	struct sNode {
+		u_int16_t children;
+		u_int32_t base;
+		u_int32_t value_prefix;
+		u_int32_t value_exact;
+	};
+	struct sBuildNode {
+		sBuildNode() {
+			for(unsigned i = 0; i < LPM_NUMBER_SYMBOLS; i++) {
+				child[i] = 0;
+			}
+			value_prefix = 0;
+			value_exact = 0;
+		}
+		u_int32_t child[LPM_NUMBER_SYMBOLS];
+		u_int32_t value_prefix;
+		u_int32_t value_exact;
+	};
+public:
+	bool add(const char *number, bool prefix, u_int32_t value);
+	void build();
+	void clear();
+	inline u_int32_t lookup(const char *number, u_int32_t *value_exact = NULL, unsigned *prefix_length = NULL) {
+		u_int32_t value = 0;
+		if(value_exact) {
+			*value_exact = 0;
+		}
+		if(prefix_length) {
+			*prefix_length = 0;
+		}
+		if(!nodes.size()) {
+			return(0);
+		}
+		sNode *node = &nodes[0];
+		for(unsigned i = 0; ; i++) {
+			if(node->value_prefix) {
+				value = node->value_prefix;
+				if(prefix_length) {
+					*prefix_length = i;
+				}
+			}
+			if(!number[i]) {
+				if(value_exact) {
+					*value_exact = node->value_exact;
+				}
+				break;
+			}
+			int symbol = getSymbol(number[i]);
+			if(symbol < 0 || !(node->children & (1 << symbol))) {
+				break;
+			}
+			node = &nodes[node->base + __builtin_popcount(node->children & ((1 << symbol) - 1))];
+		}
+		return(value);
+	}
+	void lookupAll(const char *number, vector<u_int32_t> *values_prefix, u_int32_t *value_exact = NULL);
+	bool isEmpty() {
+		return(!nodes.size() && !build_nodes.size());
+	}
+	size_t getMemorySize() {
+		return(nodes.size() * sizeof(sNode));
+	}
+	static inline int getSymbol(char ch) {
+		return(ch >= '0' && ch <= '9' ? ch - '0' :
+		       ch == '+' ? 10 :
+		       ch == '*' ? 11 :
+		       ch == '#' ? 12 : -1);
+	}
+private:
+	vector<sNode> nodes;
+	vector<sBuildNode> build_nodes;
+};
+
+
+/*
+ * Deferred delete of structures replaced by reload while lookups run without lock (rcu-like publication -
+ * new structure is built by reload thread, pointer is swapped and the old one is deleted after grace period).
+ */
+void lpm_retire_obj(void *obj, void (*destroy)(void *obj));
+/* deletes retired structures after grace period - called periodically (and on every retire), force at terminate */
+void lpm_retired_cleanup(bool force = false);
+
+template<class T>
+void lpm_retire_destroy(void *obj) {
+	delete (T*)obj;
+}
+
+template<class T>
+void lpm_retire(T *obj) {
+	if(obj) {
+		lpm_retire_obj(obj, lpm_retire_destroy<T>);
+	}
+}
+
+
+#endif //LPM_H
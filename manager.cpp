@@ -48,6 +48,9 @@
 #include "server.h"
 #include "filter_mysql.h"
 #include "charts.h"
+#include "rtp_hash_cache.h"
+#include "jitterbuffer/jb_pool.h"
+#include "thread_placement.h"
 
 #ifndef FREEBSD
 #include <malloc.h>
@@ -1858,6 +1861,7 @@ bool ManagerClientThread_screen_popup::parseUserPassword() {
 		}
 		src_ip.addWhite(row["src_ip_whitelist"].c_str());
 		src_ip.addBlack(row["src_ip_blacklist"].c_str());
+		src_ip.prepareLpm();
 		app_launch = row["app_launch"];
 		app_launch_args_or_url = row["app_launch_args_or_url"];
 		status_line = row["status_line"];
@@ -2533,19 +2537,10 @@ int Mgmt_d_lc_bye(Mgmt_params *params) {
 	Call *call;
 	vector<Call*> vectCall;
 	calltable->lock_calls_listMAP();
-	if(opt_call_id_alternative[0]) {
-		for(list<Call*>::iterator callIT = calltable->calls_list.begin(); callIT != calltable->calls_list.end(); ++callIT) {
-			call = *callIT;
-			if(call->typeIsNot(REGISTER) && call->seenbye) {
-				vectCall.push_back(call);
-			}
-		}
-	} else {
-		for(map<string, Call*>::iterator callMAPIT = calltable->calls_listMAP.begin(); callMAPIT != calltable->calls_listMAP.end(); ++callMAPIT) {
-			call = callMAPIT->second;
-			if(call->typeIsNot(REGISTER) && call->seenbye) {
-				vectCall.push_back(call);
-			}
+	for(list<Call*>::iterator callIT = calltable->calls_list.begin(); callIT != calltable->calls_list.end(); ++callIT) {
+		call = *callIT;
+		if(call->typeIsNot(REGISTER) && call->seenbye) {
+			vectCall.push_back(call);
 		}
 	}
 	if(vectCall.size()) {
@@ -2583,14 +2578,8 @@ int Mgmt_d_lc_all(Mgmt_params *params) {
 	Call *call;
 	vector<Call*> vectCall;
 	calltable->lock_calls_listMAP();
-	if(opt_call_id_alternative[0]) {
-		for(list<Call*>::iterator callIT = calltable->calls_list.begin(); callIT != calltable->calls_list.end(); ++callIT) {
-			vectCall.push_back(*callIT);
-		}
-	} else {
-		for(map<string, Call*>::iterator callMAPIT = calltable->calls_listMAP.begin(); callMAPIT != calltable->calls_listMAP.end(); ++callMAPIT) {
-			vectCall.push_back(callMAPIT->second);
-		}
+	for(list<Call*>::iterator callIT = calltable->calls_list.begin(); callIT != calltable->calls_list.end(); ++callIT) {
+		vectCall.push_back(*callIT);
 	}
 	if(vectCall.size()) {
 		std::sort(vectCall.begin(), vectCall.end(), cmpCallBy_first_packet_time);
@@ -2624,17 +2613,9 @@ int Mgmt_d_pointer_to_call(Mgmt_params *params) {
 	sscanf(params->buf, "d_pointer_to_call %s", fbasename);
 	ostringstream outStr;
 	calltable->lock_calls_listMAP();
-	if(opt_call_id_alternative[0]) {
-		for(list<Call*>::iterator callIT = calltable->calls_list.begin(); callIT != calltable->calls_list.end(); ++callIT) {
-			if(!strcmp((*callIT)->fbasename, fbasename)) {
-				outStr << "find in calltable->calls_list " << hex << (*callIT) << endl;
-			}
-		}
-	} else {
-		for(map<string, Call*>::iterator callMAPIT = calltable->calls_listMAP.begin(); callMAPIT != calltable->calls_listMAP.end(); ++callMAPIT) {
-			if(!strcmp((callMAPIT->second)->fbasename, fbasename)) {
-				outStr << "find in calltable->calls_list " << hex << (callMAPIT->second) << endl;
-			}
+	for(list<Call*>::iterator callIT = calltable->calls_list.begin(); callIT != calltable->calls_list.end(); ++callIT) {
+		if(!strcmp((*callIT)->fbasename, fbasename)) {
+			outStr << "find in calltable->calls_list " << hex << (*callIT) << endl;
 		}
 	}
 	calltable->unlock_calls_listMAP();
@@ -2657,21 +2638,11 @@ int Mgmt_d_close_call(Mgmt_params *params) {
 	sscanf(params->buf, "d_close_call %s", fbasename);
 	string rslt = fbasename + string(" missing");
 	calltable->lock_calls_listMAP();
-	if(opt_call_id_alternative[0]) {
-		for(list<Call*>::iterator callIT = calltable->calls_list.begin(); callIT != calltable->calls_list.end(); ++callIT) {
-			if(!strcmp((*callIT)->fbasename, fbasename)) {
-				(*callIT)->force_close = true;
-				rslt = fbasename + string(" close");
-				break;
-			}
-		}
-	} else {
-		for(map<string, Call*>::iterator callMAPIT = calltable->calls_listMAP.begin(); callMAPIT != calltable->calls_listMAP.end(); ++callMAPIT) {
-			if(!strcmp((callMAPIT->second)->fbasename, fbasename)) {
-				(callMAPIT->second)->force_close = true;
-				rslt = fbasename + string(" close");
-				break;
-			}
+	for(list<Call*>::iterator callIT = calltable->calls_list.begin(); callIT != calltable->calls_list.end(); ++callIT) {
+		if(!strcmp((*callIT)->fbasename, fbasename)) {
+			(*callIT)->set_force_close();
+			rslt = fbasename + string(" close");
+			break;
 		}
 	}
 	calltable->unlock_calls_listMAP();
@@ -4158,6 +4129,10 @@ int Mgmt_sniffer_stat(Mgmt_params *params) {
 	outStrStat << "\"count_live_sniffers\": \"" << countLiveSniffers << "\",";
 	outStrStat << "\"upgrade_by_git\": \"" << opt_upgrade_by_git << "\",";
 	outStrStat << "\"use_new_config\": \"" << useNewCONFIG << "\",";
+	cRtpHashCache::sStat rtpHashCacheStat = cRtpHashCache::getStat();
+	outStrStat << "\"rtp_hash_cache_hits\": \"" << rtpHashCacheStat.hits << "\",";
+	outStrStat << "\"rtp_hash_cache_misses\": \"" << rtpHashCacheStat.misses << "\",";
+	outStrStat << "\"rtp_hash_cache_overflows\": \"" << rtpHashCacheStat.overflows << "\",";
 	outStrStat << "\"terminating_error\": \"" << terminating_error << "\"";
 	outStrStat << "}";
 	outStrStat << endl;
@@ -4172,6 +4147,9 @@ int Mgmt_sniffer_threads(Mgmt_params *params) {
 	}
 	extern cThreadMonitor threadMonitor;
 	string threads = threadMonitor.output();
+	if(threadPlacement.isEnabled()) {
+		threads += threadPlacement.output();
+	}
 	return(params->sendString(&threads));
 }
 
@@ -4416,12 +4394,32 @@ int Mgmt_sqlexport(Mgmt_params *params) {
 	return(params->sendString(&rslt));
 }
 
+static string getJbPoolStat() {
+	jb_pool_stat stat;
+	jb_pool_get_stat(&stat);
+	const char *typeNames[JB_POOL_TYPES] = { "ast_frame", "fixed_jb_frame", "jb_frame" };
+	ostringstream outStr;
+	outStr << fixed << setprecision(3)
+	       << "jitterbuffer pools - frames put to jitterbuffers : " << addThousandSeparators(stat.packets) << endl;
+	for(unsigned type = 0; type < JB_POOL_TYPES; type++) {
+		outStr << left << setw(35) << (string("jb pool ") + typeNames[type]) << " : "
+		       << "pool " << addThousandSeparators(stat.alloc[type])
+		       << ", malloc " << addThousandSeparators(stat.malloc[type])
+		       << ", free " << addThousandSeparators(stat.free[type])
+		       << ", pooled " << addThousandSeparators(stat.pooled[type])
+		       << ", malloc per frame " << (stat.packets ? (double)stat.malloc[type] / stat.packets : 0.)
+		       << endl;
+	}
+	return(outStr.str());
+}
+
 int Mgmt_memory_stat(Mgmt_params *params) {
 	if (params->task == params->mgmt_task_DoInit) {
 		params->registerCommand("memory_stat", "return a memory statistics");
 		return(0);
 	}
 	string rsltMemoryStat = getMemoryStat();
+	rsltMemoryStat += getJbPoolStat();
 	return(params->sendString(&rsltMemoryStat));
 }
 
@@ -4573,11 +4571,16 @@ int Mgmt_hashtable_stats(Mgmt_params *params) {
 		params->registerCommand("hashtable_stats", "hashtable_stats");
 		return(0);
 	}
-	#if NEW_RTP_FIND__NODES
-	return(0);
-	#else
-	return(params->sendString(calltable->getHashStats()));
-	#endif
+	string rslt = calltable->getHashStats();
+	rslt += calltable->calls_callid_index.getStats();
+	rslt += calltable->cleanup_timer_stats();
+	rslt += "rtp hash cache: " + cRtpHashCache::getStatString() + "\n";
+	if(strstr(params->buf, "clear")) {
+		calltable->calls_callid_index.clearStats();
+		calltable->cleanup_timer_stats_clear();
+		cRtpHashCache::clearStat();
+	}
+	return(params->sendString(rslt));
 }
 
 int Mgmt_usleep_stats(Mgmt_params *params) {
@@ -4593,6 +4596,9 @@ int Mgmt_usleep_stats(Mgmt_params *params) {
 	}
 	string usleepStats = usleep_stats(useconds_lt);
 	usleep_stats_clear();
+	usleepStats += "\nqring wait / wakeup (mode " + string(opt_qring_wait_mode == _swm_spin_futex ? "spin_futex" : "usleep") + ")\n";
+	usleepStats += sync_wait_stats();
+	sync_wait_stats_clear();
 	return(params->sendString(usleepStats));
 }
 
@@ -4601,6 +4607,7 @@ int Mgmt_charts_cache(Mgmt_params *params) {
 		commandAndHelp ch[] = {
 			{"charts_cache_store_all", "charts_cache_store_all"},
 			{"charts_cache_cleanup_all", "charts_cache_cleanup_all"},
+			{"charts_cache_filters_stat", "evaluation cost of charts cache filters"},
 			{NULL, NULL}
 		};
 		params->registerCommand(ch);
@@ -4610,6 +4617,8 @@ int Mgmt_charts_cache(Mgmt_params *params) {
 		chartsCacheStore(true);
 	} else if(strstr(params->buf, "cleanup_all") != NULL) {
 		chartsCacheCleanup(true);
+	} else if(strstr(params->buf, "filters_stat") != NULL) {
+		return(params->sendString(chartsCacheFiltersStat()));
 	}
 	return(0);
 }
@@ -1320,6 +1320,10 @@ void cSipMsgRelations::loadParams(sParams *params) {
 			recordParams.domain_dst.addComb(dbRow["domain_dst"].c_str());
 			recordParams.domain_dst.addComb(dbRow["domain_dst_group"].c_str());
 			params->recordsParams.push_back(recordParams);
+			params->recordsParams.back().ip_src.prepareLpm();
+			params->recordsParams.back().ip_dst.prepareLpm();
+			params->recordsParams.back().number_src.prepareLpm();
+			params->recordsParams.back().number_dst.prepareLpm();
 		}
 	}
 	delete sqlDb;
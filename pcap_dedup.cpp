@@ -0,0 +1,125 @@
+#include <syslog.h>
+
+#include "pcap_dedup.h"
+#include "pcap_queue.h"
+#include "sniff_inline.h"
+#include "tools.h"
+
+
+cDedupSeenSet::cDedupSeenSet(unsigned bits, unsigned window_ms) {
+	u_int64_t count = (1ull << bits) * DEDUP_SEEN_SET_WAYS;
+	items = new FILE_LINE(0) sItem[count];
+	memset(items, 0, count * sizeof(sItem));
+	mask = (1ull << bits) - 1;
+	this->window_ms = window_ms;
+}
+
+cDedupSeenSet::~cDedupSeenSet() {
+	delete [] items;
+}
+
+
+cDedupWorkers::cDedupWorkers(unsigned countWorkers, const char *interfaceName) 
+ : generationWait("dedup workers generation"),
+   doneWait("dedup workers done") {
+	this->countWorkers = countWorkers;
+	this->interfaceName = interfaceName ? interfaceName : "";
+	block = NULL;
+	ppf = 0;
+	pcapLinklayerHeaderType = 0;
+	generation = 0;
+	terminating = false;
+	workers = new FILE_LINE(0) sWorker[countWorkers];
+	for(unsigned i = 0; i < countWorkers; i++) {
+		workers[i].workers = this;
+		workers[i].index = i;
+		workers[i].thread = 0;
+		workers[i].tid = 0;
+		// pcapProcessData owns seen set (deduplicate_threads)
+		workers[i].ppd = new FILE_LINE(0) pcapProcessData;
+		workers[i].done_generation = 0;
+		workers[i].running = false;
+	}
+	for(unsigned i = 1; i < countWorkers; i++) {
+		workers[i].running = true;
+		if(vm_pthread_create((("pb - dedup worker " + intToString(i) + " ") + this->interfaceName).c_str(),
+				     &workers[i].thread, NULL, workerThreadFunction, &workers[i], __FILE__, __LINE__) != 0) {
+			workers[i].thread = 0;
+			workers[i].running = false;
+		}
+	}
+}
+
+cDedupWorkers::~cDedupWorkers() {
+	terminating = true;
+	generationWait.wake();
+	for(unsigned i = 1; i < countWorkers; i++) {
+		if(workers[i].thread) {
+			pthread_join(workers[i].thread, NULL);
+		}
+	}
+	for(unsigned i = 0; i < countWorkers; i++) {
+		delete workers[i].ppd;
+	}
+	delete [] workers;
+}
+
+void cDedupWorkers::processBlock(pcap_block_store *block, int ppf, int pcapLinklayerHeaderType) {
+	this->block = block;
+	this->ppf = ppf;
+	this->pcapLinklayerHeaderType = pcapLinklayerHeaderType;
+	int _generation = __sync_add_and_fetch(&generation, 1);
+	generationWait.wake();
+	processPartition(&workers[0]);
+	for(unsigned i = 1; i < countWorkers; i++) {
+		unsigned int waitCounter = 0;
+		int _done_generation;
+		while((_done_generation = workers[i].done_generation) != _generation) {
+			// worker leaves its loop only between partitions - after it stops, it does not touch the block
+			if(!workers[i].running) {
+				break;
+			}
+			SYNC_WAIT(doneWait, workers[i].done_generation, _done_generation, 10, waitCounter);
+		}
+	}
+	this->block = NULL;
+}
+
+void cDedupWorkers::processPartition(sWorker *worker) {
+	for(unsigned i = 0; i < block->count; i++) {
+		if(block->is_ignore(i)) {
+			continue;
+		}
+		uint16_t *md5 = ((pcap_pkthdr_plus2*)block->get_header(i))->md5;
+		if((md5[0] ? md5[0] % countWorkers : 0) != worker->index) {
+			continue;
+		}
+		::pcapProcess(NULL, 0, block, i, ppf,
+			      worker->ppd, pcapLinklayerHeaderType, NULL, interfaceName.c_str());
+	}
+}
+
+void *cDedupWorkers::workerThreadFunction(void *arg) {
+	sWorker *worker = (sWorker*)arg;
+	cDedupWorkers *workers = worker->workers;
+	worker->tid = get_unix_tid();
+	int last_generation = 0;
+	unsigned int waitCounter = 0;
+	while(!workers->terminating && !is_terminating()) {
+		int _generation = workers->generation;
+		if(_generation == last_generation) {
+			SYNC_WAIT(workers->generationWait, workers->generation, last_generation, 10, waitCounter);
+			continue;
+		}
+		waitCounter = 0;
+		workers->processPartition(worker);
+		last_generation = _generation;
+		__sync_synchronize();
+		worker->done_generation = _generation;
+		workers->doneWait.wake();
+	}
+	__sync_synchronize();
+	worker->running = false;
+	workers->doneWait.wake();
+	return(NULL);
+}
@@ -0,0 +1,169 @@
+#ifndef PCAP_DEDUP_H
+#define PCAP_DEDUP_H
+
+
+#include <string>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#include "md5.h"
+#include "sync_wait.h"
+
+
+using namespace std;
+
+
+#define DEDUP_WINDOW_MS 100
+#define DEDUP_SEEN_SET_BITS 16
+#define DEDUP_SEEN_SET_WAYS 4
+
+
+/*
+ * 64bit hash of deduplicated data - used instead of md5 if deduplicate_threads is set.
+ * SSE4.2 (selected at compile time by -march): two crc32c lanes, second over words with swapped halves
+ * so that the lanes are independent; otherwise scalar multiply-xorshift.
+ */
+static inline u_int64_t dedup_hash64(const void *data, u_int32_t length) {
+	const u_char *p = (const u_char*)data;
+	u_int32_t length_rest = length;
+	u_int64_t word;
+	#if defined(__SSE4_2__)
+	u_int64_t h1 = 0x9E3779B9;
+	u_int64_t h2 = 0x85EBCA6B;
+	for(; length_rest >= 8; p += 8, length_rest -= 8) {
+		memcpy(&word, p, 8);
+		h1 = _mm_crc32_u64(h1, word);
+		h2 = _mm_crc32_u64(h2, (word >> 32) | (word << 32));
+	}
+	for(; length_rest; p++, length_rest--) {
+		h1 = _mm_crc32_u8(h1, *p);
+		h2 = _mm_crc32_u8(h2, *p ^ 0x5A);
+	}
+	u_int64_t h = ((h1 << 32) | (u_int32_t)h2) ^ (length * 0x9E3779B97F4A7C15ull);
+	#else
+	u_int64_t h = 0x9E3779B97F4A7C15ull ^ length;
+	for(; length_rest >= 8; p += 8, length_rest -= 8) {
+		memcpy(&word, p, 8);
+		h ^= word * 0xC2B2AE3D27D4EB4Full;
+		h = ((h << 31) | (h >> 33)) * 0x9E3779B97F4A7C15ull;
+	}
+	if(length_rest) {
+		word = 0;
+		memcpy(&word, p, length_rest);
+		h ^= word * 0xC2B2AE3D27D4EB4Full;
+		h = ((h << 31) | (h >> 33)) * 0x9E3779B97F4A7C15ull;
+	}
+	#endif
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDull;
+	h ^= h >> 33;
+	return(h);
+}
+
+// hash is stored in md5 field of packet header, md5[0] == 0 means "not calculated"
+static inline void dedup_hash64_to_md5(const void *data, u_int32_t length, uint16_t *md5) {
+	u_int64_t hash = dedup_hash64(data, length);
+	if(!(hash & 0xFFFF)) {
+		hash |= 1;
+	}
+	memset(md5, 0, MD5_DIGEST_LENGTH);
+	memcpy(md5, &hash, sizeof(hash));
+}
+
+static inline u_int64_t dedup_md5_to_hash64(uint16_t *md5) {
+	u_int64_t hash;
+	memcpy(&hash, md5, sizeof(hash));
+	return(hash);
+}
+
+
+/*
+ * Set of recently seen packet hashes with time limit (packet time). Set-associative table,
+ * the oldest item of bucket is replaced. Every set is owned by one dedup worker - no locks.
+ */
+class cDedupSeenSet {
+public:
+	struct sItem {
+		u_int64_t hash;
+		u_int64_t time_ms;
+	};
+public:
+	cDedupSeenSet(unsigned bits = DEDUP_SEEN_SET_BITS, unsigned window_ms = DEDUP_WINDOW_MS);
+	~cDedupSeenSet();
+	inline bool check(u_int64_t hash, u_int64_t time_ms) {
+		// low 16 bits of hash select dedup worker
+		sItem *bucket = items + ((hash >> 16) & mask) * DEDUP_SEEN_SET_WAYS;
+		unsigned oldest = 0;
+		for(unsigned i = 0; i < DEDUP_SEEN_SET_WAYS; i++) {
+			if(bucket[i].hash == hash &&
+			   bucket[i].time_ms + window_ms >= time_ms &&
+			   bucket[i].time_ms <= time_ms + window_ms) {
+				return(true);
+			}
+			if(bucket[i].time_ms < bucket[oldest].time_ms) {
+				oldest = i;
+			}
+		}
+		bucket[oldest].hash = hash;
+		bucket[oldest].time_ms = time_ms;
+		return(false);
+	}
+private:
+	sItem *items;
+	u_int64_t mask;
+	unsigned window_ms;
+};
+
+
+struct pcap_block_store;
+struct pcapProcessData;
+
+/*
+ * Deduplication of pcap_block_store by several threads (deduplicate_threads = N).
+ * Packets are partitioned by hash calculated in md1/md2 threads (identical packets always fall to the same
+ * worker) and each worker runs pcapProcess with its own pcapProcessData (and so its own seen set) over its packets of block.
+ * Duplicates are only marked as ignored in place, so the block keeps its order and is pushed
+ * to the next thread after all workers finish. Partition 0 is processed by the calling (dedup) thread.
+ */
+class cDedupWorkers {
+public:
+	struct sWorker {
+		cDedupWorkers *workers;
+		unsigned index;
+		pthread_t thread;
+		int tid;
+		pcapProcessData *ppd;
+		volatile int done_generation;
+		volatile bool running;
+	};
+public:
+	cDedupWorkers(unsigned countWorkers, const char *interfaceName);
+	~cDedupWorkers();
+	void processBlock(pcap_block_store *block, int ppf, int pcapLinklayerHeaderType);
+	unsigned getCountWorkers() {
+		return(countWorkers);
+	}
+private:
+	void processPartition(sWorker *worker);
+	static void *workerThreadFunction(void *arg);
+private:
+	unsigned countWorkers;
+	sWorker *workers;
+	string interfaceName;
+	pcap_block_store *block;
+	int ppf;
+	int pcapLinklayerHeaderType;
+	volatile int generation;
+	volatile bool terminating;
+	cSyncWait generationWait;
+	cSyncWait doneWait;
+};
+
+
+#endif //PCAP_DEDUP_H
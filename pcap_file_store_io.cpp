@@ -0,0 +1,296 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <syslog.h>
+#include <sstream>
+#include <iomanip>
+
+#include "pcap_file_store_io.h"
+#include "tools.h"
+
+
+u_int64_t sFileStoreIOLatency::getPercentile(double perc) {
+	u_int32_t _count = count;
+	if(!_count) {
+		return(0);
+	}
+	u_int64_t limit = _count * perc / 100;
+	u_int64_t sum = 0;
+	for(unsigned i = 0; i < FILE_STORE_IO_LATENCY_BUCKETS; i++) {
+		sum += buckets[i];
+		if(sum > limit) {
+			return(1ull << i);
+		}
+	}
+	return(max_us);
+}
+
+string sFileStoreIOLatency::getStatString(const char *label) {
+	if(!count) {
+		return("");
+	}
+	ostringstream outStr;
+	outStr << label << ":" << count
+	       << " " << getPercentile(50) / 1000. << "/" << getPercentile(99) / 1000. << "/" << max_us / 1000. << "ms";
+	reset_request = true;
+	return(outStr.str());
+}
+
+
+cPcapFileStoreIO::cPcapFileStoreIO() 
+ : queueWait("file store io queue"),
+   writeDoneWait("file store io write done"),
+   readDoneWait("file store io read done") {
+	queueCount = 0;
+	_sync_queue = 0;
+	thread = 0;
+	terminating = false;
+	inflight = 0;
+	#ifdef HAVE_LIBURING
+	uring_ok = false;
+	#endif //HAVE_LIBURING
+}
+
+cPcapFileStoreIO::~cPcapFileStoreIO() {
+	stop();
+}
+
+bool cPcapFileStoreIO::start() {
+	#ifdef HAVE_LIBURING
+	int rsltInit = io_uring_queue_init(FILE_STORE_IO_QUEUE_DEPTH, &uring, 0);
+	if(rsltInit == 0) {
+		uring_ok = true;
+	} else {
+		syslog(LOG_NOTICE, "packetbuffer: io_uring is not available (%s) - file store uses pwrite", strerror(-rsltInit));
+	}
+	#endif //HAVE_LIBURING
+	return(vm_pthread_create("packetbuffer file store io",
+				 &thread, NULL, ioThreadFunction, this, __FILE__, __LINE__) == 0);
+}
+
+void cPcapFileStoreIO::stop() {
+	terminating = true;
+	queueWait.wake();
+	if(thread) {
+		pthread_join(thread, NULL);
+		thread = 0;
+	}
+	#ifdef HAVE_LIBURING
+	if(uring_ok) {
+		io_uring_queue_exit(&uring);
+		uring_ok = false;
+	}
+	#endif //HAVE_LIBURING
+}
+
+void cPcapFileStoreIO::write(int fd, u_char *buffer, size_t length, u_int64_t offset, volatile int *pending, volatile bool *error) {
+	sFileStoreIORequest *request = new FILE_LINE(0) sFileStoreIORequest;
+	request->type = sFileStoreIORequest::_write;
+	request->fd = fd;
+	request->buffer = buffer;
+	request->length = length;
+	request->offset = offset;
+	request->result = 0;
+	request->done = 0;
+	request->pending = pending;
+	request->error = error;
+	add(request);
+}
+
+ssize_t cPcapFileStoreIO::read(int fd, u_char *buffer, size_t length, u_int64_t offset) {
+	sFileStoreIORequest request;
+	request.type = sFileStoreIORequest::_read;
+	request.fd = fd;
+	request.buffer = buffer;
+	request.length = length;
+	request.offset = offset;
+	request.result = 0;
+	request.done = 0;
+	request.pending = NULL;
+	request.error = NULL;
+	add(&request);
+	unsigned int waitCounter = 0;
+	while(!request.done) {
+		SYNC_WAIT(readDoneWait, request.done, 0, 10, waitCounter);
+	}
+	return(request.result);
+}
+
+void cPcapFileStoreIO::waitPendingWrites(volatile int *pending) {
+	unsigned int waitCounter = 0;
+	int _pending;
+	while((_pending = *pending) > 0) {
+		SYNC_WAIT(writeDoneWait, *pending, _pending, 10, waitCounter);
+	}
+}
+
+string cPcapFileStoreIO::getStatString() {
+	string write_str = latency_write.getStatString("W");
+	string read_str = latency_read.getStatString("R");
+	if(write_str.empty() && read_str.empty()) {
+		return("");
+	}
+	return("fileio[" + write_str + (!write_str.empty() && !read_str.empty() ? " " : "") + read_str + "] ");
+}
+
+u_char *cPcapFileStoreIO::allocBuffer(size_t size) {
+	void *buffer = NULL;
+	if(posix_memalign(&buffer, FILE_STORE_IO_ALIGN, size)) {
+		return(NULL);
+	}
+	return((u_char*)buffer);
+}
+
+void cPcapFileStoreIO::freeBuffer(u_char *buffer) {
+	free(buffer);
+}
+
+void cPcapFileStoreIO::add(sFileStoreIORequest *request) {
+	request->done_length = 0;
+	request->submit_time_us = getTimeUS();
+	lock();
+	queue.push_back(request);
+	++queueCount;
+	unlock();
+	queueWait.wake();
+}
+
+void cPcapFileStoreIO::complete(sFileStoreIORequest *request, ssize_t result) {
+	u_int64_t latency_us = getTimeUS() - request->submit_time_us;
+	if(request->type == sFileStoreIORequest::_write) {
+		latency_write.add(latency_us);
+		if(result != (ssize_t)request->length) {
+			syslog(LOG_ERR, "packetbuffer: write to file store failed - %s",
+			       result < 0 ? strerror(-result) : "short write");
+			if(request->error) {
+				*request->error = true;
+			}
+		}
+		freeBuffer(request->buffer);
+		if(request->pending) {
+			__sync_sub_and_fetch(request->pending, 1);
+			writeDoneWait.wake();
+		}
+		delete request;
+	} else {
+		latency_read.add(latency_us);
+		request->result = result;
+		__sync_synchronize();
+		request->done = 1;
+		readDoneWait.wake();
+	}
+}
+
+#ifdef HAVE_LIBURING
+void cPcapFileStoreIO::uringPrep(sFileStoreIORequest *request) {
+	io_uring_sqe *sqe = io_uring_get_sqe(&uring);
+	if(request->type == sFileStoreIORequest::_write) {
+		io_uring_prep_write(sqe, request->fd, request->buffer + request->done_length, 
+				    request->length - request->done_length, request->offset + request->done_length);
+	} else {
+		io_uring_prep_read(sqe, request->fd, request->buffer + request->done_length, 
+				   request->length - request->done_length, request->offset + request->done_length);
+	}
+	io_uring_sqe_set_data(sqe, request);
+}
+#endif //HAVE_LIBURING
+
+void *cPcapFileStoreIO::ioThreadFunction(void *arg) {
+	((cPcapFileStoreIO*)arg)->ioThread();
+	return(NULL);
+}
+
+void cPcapFileStoreIO::ioThread() {
+	unsigned int waitCounter = 0;
+	while(!terminating || queueCount || inflight) {
+		bool activity = false;
+		sFileStoreIORequest *requests[FILE_STORE_IO_QUEUE_DEPTH];
+		unsigned countRequests = 0;
+		if(queueCount) {
+			lock();
+			while(queue.size() && inflight + countRequests < FILE_STORE_IO_QUEUE_DEPTH) {
+				requests[countRequests++] = queue.front();
+				queue.pop_front();
+				--queueCount;
+			}
+			unlock();
+		}
+		#ifdef HAVE_LIBURING
+		if(uring_ok) {
+			for(unsigned i = 0; i < countRequests; i++) {
+				uringPrep(requests[i]);
+				++inflight;
+			}
+			if(countRequests) {
+				io_uring_submit(&uring);
+				activity = true;
+			}
+			io_uring_cqe *cqe;
+			unsigned countResubmit = 0;
+			while(inflight && io_uring_peek_cqe(&uring, &cqe) == 0) {
+				sFileStoreIORequest *request = (sFileStoreIORequest*)io_uring_cqe_get_data(cqe);
+				int result = cqe->res;
+				io_uring_cqe_seen(&uring, cqe);
+				activity = true;
+				if(result == -EINTR || result == -EAGAIN ||
+				   (result > 0 && request->done_length + result < request->length)) {
+					// partial transfer - submit the rest (as the pwrite/pread loop does)
+					if(result > 0) {
+						request->done_length += result;
+					}
+					uringPrep(request);
+					++countResubmit;
+					continue;
+				}
+				--inflight;
+				complete(request, result < 0 ? result : (ssize_t)(request->done_length + result));
+			}
+			if(countResubmit) {
+				io_uring_submit(&uring);
+			}
+			if(!activity) {
+				if(inflight) {
+					__kernel_timespec timeout;
+					timeout.tv_sec = 0;
+					timeout.tv_nsec = 1000000;
+					if(io_uring_wait_cqe_timeout(&uring, &cqe, &timeout) == 0) {
+						continue;
+					}
+				} else {
+					SYNC_WAIT(queueWait, queueCount, 0, 10, waitCounter);
+				}
+			} else {
+				waitCounter = 0;
+			}
+			continue;
+		}
+		#endif //HAVE_LIBURING
+		for(unsigned i = 0; i < countRequests; i++) {
+			sFileStoreIORequest *request = requests[i];
+			size_t done = 0;
+			ssize_t result = 0;
+			while(done < request->length) {
+				result = request->type == sFileStoreIORequest::_write ?
+					  pwrite(request->fd, request->buffer + done, request->length - done, request->offset + done) :
+					  pread(request->fd, request->buffer + done, request->length - done, request->offset + done);
+				if(result < 0) {
+					if(errno == EINTR) {
+						continue;
+					}
+					result = -errno;
+					break;
+				}
+				if(result == 0) {
+					break;
+				}
+				done += result;
+			}
+			complete(request, result < 0 ? result : (ssize_t)done);
+			activity = true;
+		}
+		if(!activity) {
+			SYNC_WAIT(queueWait, queueCount, 0, 10, waitCounter);
+		} else {
+			waitCounter = 0;
+		}
+	}
+}
@@ -0,0 +1,147 @@
+#ifndef PCAP_FILE_STORE_IO_H
+#define PCAP_FILE_STORE_IO_H
+
+
+#include "config.h"
+
+#include <string>
+#include <deque>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "sync_wait.h"
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif //HAVE_LIBURING
+
+
+using namespace std;
+
+
+#define FILE_STORE_IO_ALIGN 4096
+#define FILE_STORE_IO_QUEUE_DEPTH 64
+#define FILE_STORE_IO_READ_CHUNK (1024 * 1024)
+#define FILE_STORE_IO_LATENCY_BUCKETS 24
+
+
+/*
+ * Latency histogram - bucket i counts operations with latency < 2^i us.
+ * Updated only by io thread, getStatString (pcapStat) only requests reset.
+ */
+struct sFileStoreIOLatency {
+	sFileStoreIOLatency() {
+		clear();
+		reset_request = false;
+	}
+	void add(u_int64_t latency_us) {
+		if(reset_request) {
+			clear();
+			reset_request = false;
+		}
+		unsigned bucket = 0;
+		while(bucket < FILE_STORE_IO_LATENCY_BUCKETS - 1 && (1ull << bucket) <= latency_us) {
+			++bucket;
+		}
+		++buckets[bucket];
+		++count;
+		if(latency_us > max_us) {
+			max_us = latency_us;
+		}
+	}
+	void clear() {
+		for(unsigned i = 0; i < FILE_STORE_IO_LATENCY_BUCKETS; i++) {
+			buckets[i] = 0;
+		}
+		count = 0;
+		max_us = 0;
+	}
+	u_int64_t getPercentile(double perc);
+	string getStatString(const char *label);
+	volatile u_int32_t buckets[FILE_STORE_IO_LATENCY_BUCKETS];
+	volatile u_int32_t count;
+	volatile u_int64_t max_us;
+	volatile bool reset_request;
+};
+
+struct sFileStoreIORequest {
+	enum eType {
+		_write,
+		_read
+	};
+	eType type;
+	int fd;
+	u_char *buffer;
+	size_t length;
+	u_int64_t offset;
+	size_t done_length;
+	u_int64_t submit_time_us;
+	ssize_t result;
+	volatile int done;
+	volatile int *pending;
+	volatile bool *error;
+};
+
+/*
+ * Asynchronous io for packetbuffer file store (packetbuffer_file_direct_io).
+ * Requests are submitted by one dedicated thread - by io_uring if sniffer is built with liburing
+ * and kernel supports it, otherwise by pwrite/pread. Writes are asynchronous (buffer is released
+ * by io thread after completion and *pending is decremented), reads wait for completion.
+ * Buffers, lengths and offsets must be aligned to FILE_STORE_IO_ALIGN (O_DIRECT).
+ */
+class cPcapFileStoreIO {
+public:
+	cPcapFileStoreIO();
+	~cPcapFileStoreIO();
+	bool start();
+	void stop();
+	void write(int fd, u_char *buffer, size_t length, u_int64_t offset, volatile int *pending, volatile bool *error);
+	ssize_t read(int fd, u_char *buffer, size_t length, u_int64_t offset);
+	void waitPendingWrites(volatile int *pending);
+	string getStatString();
+	bool isUring() {
+		#ifdef HAVE_LIBURING
+		return(uring_ok);
+		#else
+		return(false);
+		#endif //HAVE_LIBURING
+	}
+	static u_char *allocBuffer(size_t size);
+	static void freeBuffer(u_char *buffer);
+	static size_t alignSize(size_t size) {
+		return((size + FILE_STORE_IO_ALIGN - 1) / FILE_STORE_IO_ALIGN * FILE_STORE_IO_ALIGN);
+	}
+private:
+	void add(sFileStoreIORequest *request);
+	void complete(sFileStoreIORequest *request, ssize_t result);
+	#ifdef HAVE_LIBURING
+	void uringPrep(sFileStoreIORequest *request);
+	#endif //HAVE_LIBURING
+	static void *ioThreadFunction(void *arg);
+	void ioThread();
+	void lock() {
+		while(__sync_lock_test_and_set(&_sync_queue, 1));
+	}
+	void unlock() {
+		__sync_lock_release(&_sync_queue);
+	}
+private:
+	deque<sFileStoreIORequest*> queue;
+	volatile int queueCount;
+	volatile int _sync_queue;
+	pthread_t thread;
+	volatile bool terminating;
+	unsigned inflight;
+	#ifdef HAVE_LIBURING
+	io_uring uring;
+	bool uring_ok;
+	#endif //HAVE_LIBURING
+	sFileStoreIOLatency latency_write;
+	sFileStoreIOLatency latency_read;
+	cSyncWait queueWait;
+	cSyncWait writeDoneWait;
+	cSyncWait readDoneWait;
+};
+
+
+#endif //PCAP_FILE_STORE_IO_H
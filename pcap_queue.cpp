@@ -39,6 +39,9 @@
 #include "ssl_dssl.h"
 #include "tcmalloc_hugetables.h"
 #include "heap_chunk.h"
+#include "pcap_dedup.h"
+#include "zstd_dict.h"
+#include "thread_placement.h"
 
 #ifndef FREEBSD
 #include <malloc.h>
@@ -93,6 +96,7 @@ extern int opt_ipaccount;
 extern int opt_pcapdump;
 extern int opt_dup_check;
 extern int opt_dup_check_ipheader;
+extern int opt_dup_check_threads;
 extern int opt_mirrorip;
 extern char opt_mirrorip_src[20];
 extern char opt_mirrorip_dst[20];
@@ -190,6 +194,7 @@ pcap_block_store::compress_method opt_pcap_queue_compress_method
 							= pcap_block_store::snappy;
 int opt_pcap_queue_compress_ratio = 100;
 string opt_pcap_queue_disk_folder;
+bool opt_pcap_queue_file_store_direct_io		= false;
 ip_port opt_pcap_queue_send_to_ip_port;
 ip_port opt_pcap_queue_receive_from_ip_port;
 int opt_pcap_queue_receive_from_port;
@@ -206,6 +211,9 @@ int opt_pcap_queue_dequeu_method			= 2;
 int opt_pcap_queue_use_blocks				= 0;
 int opt_pcap_queue_use_blocks_auto_enable		= 0;
 int opt_pcap_queue_use_blocks_read_check		= 1;
+string opt_pcap_queue_afpacket_interfaces;
+int opt_pcap_queue_afpacket_block_size			= 1024; // kB
+int opt_pcap_queue_afpacket_zerocopy			= 1;
 int opt_pcap_dispatch					= 0;
 int opt_pcap_queue_suppress_t1_thread			= 0;
 int opt_pcap_queue_block_timeout			= 0;
@@ -422,6 +430,11 @@ void pcap_block_store::inc_h(pcap_pkthdr_plus2 *header) {
 	++this->count;
 }
 
+void pcap_block_store::add_h_external(uint32_t offset, pcap_pkthdr_plus2 *header) {
+	this->size = offset;
+	this->inc_h(header);
+}
+
 bool pcap_block_store::get_add_hp_pointers(pcap_pkthdr_plus2 **header, u_char **packet, unsigned min_size_for_packet) {
 	if(!this->block) {
 		while(true) {
@@ -474,10 +487,7 @@ void pcap_block_store::destroy() {
 		delete [] this->offsets;
 		this->offsets = NULL;
 	}
-	if(this->block) {
-		delete [] this->block;
-		this->block = NULL;
-	}
+	this->deleteBlock();
 	if(this->is_voip) {
 		delete [] this->is_voip;
 		this->is_voip = NULL;
@@ -518,15 +528,17 @@ bool pcap_block_store::isEmptyRestoreBuffer() {
 }
 
 void pcap_block_store::freeBlock() {
-	if(this->block) {
-		delete [] this->block;
-		this->block = NULL;
-	}
+	this->deleteBlock();
 }
 
-u_char* pcap_block_store::getSaveBuffer(uint32_t block_counter) {
+u_char* pcap_block_store::getSaveBuffer(uint32_t block_counter, u_char *saveBuffer) {
 	size_t sizeSaveBuffer = this->getSizeSaveBuffer();
-	u_char *saveBuffer = new FILE_LINE(15010) u_char[sizeSaveBuffer];
+	// saveBuffer from caller is not from heap (aligned buffer of file store) - heapsafe check only own buffer
+	u_char *saveBufferBegin = NULL;
+	if(!saveBuffer) {
+		saveBuffer = new FILE_LINE(15010) u_char[sizeSaveBuffer];
+		saveBufferBegin = saveBuffer;
+	}
 	pcap_block_store_header header;
 	header.hm = this->hm;
 	header.size = this->size;
@@ -537,15 +549,15 @@ u_char* pcap_block_store::getSaveBuffer(uint32_t block_counter) {
 	header.counter = block_counter;
 	strcpy(header.ifname, this->ifname);
 	header.time_s = getTimeS();
-	memcpy_heapsafe(saveBuffer, saveBuffer,
+	memcpy_heapsafe(saveBuffer, saveBufferBegin,
 			&header, NULL,
 			sizeof(header),
 			__FILE__, __LINE__);
-	memcpy_heapsafe(saveBuffer + sizeof(header), saveBuffer,
+	memcpy_heapsafe(saveBuffer + sizeof(header), saveBufferBegin,
 			this->offsets, this->offsets,
 			sizeof(uint32_t) * this->count,
 			__FILE__, __LINE__);
-	memcpy_heapsafe(saveBuffer + sizeof(pcap_block_store_header) + this->count * sizeof(uint32_t), saveBuffer,
+	memcpy_heapsafe(saveBuffer + sizeof(pcap_block_store_header) + this->count * sizeof(uint32_t), saveBufferBegin,
 			this->block, this->block,
 			this->getUseSize(),
 			__FILE__, __LINE__);
@@ -569,9 +581,7 @@ void pcap_block_store::restoreFromSaveBuffer(u_char *saveBuffer) {
 	if(this->offsets) {
 		delete [] this->offsets;
 	}
-	if(this->block) {
-		delete [] this->block;
-	}
+	this->deleteBlock();
 	this->offsets_size = this->count;
 	this->offsets = new FILE_LINE(15011) uint32_t[this->offsets_size];
 	memcpy_heapsafe(this->offsets, this->offsets,
@@ -727,6 +737,10 @@ bool pcap_block_store::compress() {
 		}
 	}
 	switch(opt_pcap_queue_compress_method) {
+	case zstd:
+		#ifdef HAVE_LIBZSTD
+		return(this->compress_zstd());
+		#endif //HAVE_LIBZSTD
 	case lz4:
 		#ifdef HAVE_LIBLZ4
 		return(this->compress_lz4());
@@ -748,7 +762,7 @@ bool pcap_block_store::compress_snappy() {
 	snappy_status snappyRslt = snappy_compress((char*)this->block, this->size, (char*)snappyBuff, &snappyBuffSize);
 	switch(snappyRslt) {
 		case SNAPPY_OK:
-			delete [] this->block;
+			this->deleteBlock();
 			#if HEAPSAFE
 				this->block = (u_char*)realloc_object(snappyBuff, snappyBuffSize, __FILE__, __LINE__, 16015);
 			#else
@@ -781,7 +795,7 @@ bool pcap_block_store::compress_lz4() {
 	}
 	int lz4_size = LZ4_compress((char*)this->block, (char*)lz4Buff, this->size);
 	if(lz4_size > 0) {
-		delete [] this->block;
+		this->deleteBlock();
 		this->block = new FILE_LINE(15016) u_char[lz4_size];
 		memcpy_heapsafe(this->block, lz4Buff, lz4_size,
 				__FILE__, __LINE__);
@@ -797,11 +811,44 @@ bool pcap_block_store::compress_lz4() {
 	return(false);
 }
 
+bool pcap_block_store::compress_zstd() {
+	#ifdef HAVE_LIBZSTD
+	static __thread ZSTD_CCtx *zstdCCtx;
+	if(!zstdCCtx) {
+		zstdCCtx = ZSTD_createCCtx();
+	}
+	size_t zstdBuffSize = ZSTD_compressBound(this->size);
+	u_char *zstdBuff = new FILE_LINE(0) u_char[zstdBuffSize];
+	// dictionary id is stored in zstd frame header
+	size_t zstd_size = zstdDict.getCDict() ?
+			    ZSTD_compress_usingCDict(zstdCCtx, zstdBuff, zstdBuffSize, this->block, this->size, zstdDict.getCDict()) :
+			    ZSTD_compressCCtx(zstdCCtx, zstdBuff, zstdBuffSize, this->block, this->size, zstdDict.getLevel());
+	if(!ZSTD_isError(zstd_size)) {
+		this->deleteBlock();
+		this->block = new FILE_LINE(0) u_char[zstd_size];
+		memcpy_heapsafe(this->block, zstdBuff, zstd_size,
+				__FILE__, __LINE__);
+		delete [] zstdBuff;
+		this->size_compress = zstd_size;
+		sumPacketsSizeCompress[0] += this->size_compress;
+		return(true);
+	} else {
+		syslog(LOG_ERR, "packetbuffer: zstd_compress: %s", ZSTD_getErrorName(zstd_size));
+	}
+	delete [] zstdBuff;
+	#endif //HAVE_LIBZSTD
+	return(false);
+}
+
 bool pcap_block_store::uncompress(compress_method method) {
 	if(!this->size_compress) {
 		return(true);
 	}
 	switch(method == compress_method_default ? opt_pcap_queue_compress_method : method) {
+	case zstd:
+		#ifdef HAVE_LIBZSTD
+		return(this->uncompress_zstd());
+		#endif //HAVE_LIBZSTD
 	case lz4:
 		#ifdef HAVE_LIBLZ4
 		return(this->uncompress_lz4());
@@ -862,6 +909,38 @@ bool pcap_block_store::uncompress_lz4() {
 	return(false);
 }
 
+bool pcap_block_store::uncompress_zstd() {
+	#ifdef HAVE_LIBZSTD
+	if(!this->size_compress) {
+		return(true);
+	}
+	string error;
+	if(!zstdDict.checkFrameDictId(this->block, this->size_compress, &error)) {
+		syslog(LOG_ERR, "packetbuffer: zstd_uncompress: %s", error.c_str());
+		return(false);
+	}
+	static __thread ZSTD_DCtx *zstdDCtx;
+	if(!zstdDCtx) {
+		zstdDCtx = ZSTD_createDCtx();
+	}
+	u_char *zstdBuff = new FILE_LINE(0) u_char[this->size];
+	size_t zstd_size = zstdDict.getDDict() ?
+			    ZSTD_decompress_usingDDict(zstdDCtx, zstdBuff, this->size, this->block, this->size_compress, zstdDict.getDDict()) :
+			    ZSTD_decompressDCtx(zstdDCtx, zstdBuff, this->size, this->block, this->size_compress);
+	if(!ZSTD_isError(zstd_size) && zstd_size == this->size) {
+		delete [] this->block;
+		this->block = zstdBuff;
+		this->size_compress = 0;
+		return(true);
+	} else {
+		syslog(LOG_ERR, "packetbuffer: zstd_uncompress: %s", 
+		       ZSTD_isError(zstd_size) ? ZSTD_getErrorName(zstd_size) : "bad size");
+	}
+	delete [] zstdBuff;
+	#endif //HAVE_LIBZSTD
+	return(false);
+}
+
 
 pcap_block_store_queue::pcap_block_store_queue() {
 	extern volatile int terminating;
@@ -869,6 +948,7 @@ pcap_block_store_queue::pcap_block_store_queue() {
 				100000,
 				100, 100,
 				&terminating, true);
+	this->queueBlock->setSyncWait("pcap block store queue");
 	this->sizeOfBlocks = 0;
 	this->sizeOfBlocks_sync = 0;
 }
@@ -882,9 +962,14 @@ pcap_block_store_queue::~pcap_block_store_queue() {
 }
 
 
-pcap_file_store::pcap_file_store(u_int id, const char *folder) {
+pcap_file_store::pcap_file_store(u_int id, const char *folder, cPcapFileStoreIO *io, int segment) {
 	this->id = id;
 	this->folder = folder;
+	this->io = io;
+	this->segment = segment;
+	this->fileHandleDirect = -1;
+	this->pendingWrites = 0;
+	this->writeError = false;
 	this->fileHandlePush = NULL;
 	this->fileHandlePop = NULL;
 	this->fileBufferPush = NULL;
@@ -903,6 +988,9 @@ pcap_file_store::~pcap_file_store() {
 }
 
 bool pcap_file_store::push(pcap_block_store *blockStore) {
+	if(this->io) {
+		return(this->push_direct(blockStore));
+	}
 	if(!this->fileHandlePush && !this->open(typeHandlePush)) {
 		return(false);
 	}
@@ -940,6 +1028,9 @@ bool pcap_file_store::pop(pcap_block_store *blockStore) {
 		syslog(LOG_ERR, "packetbuffer: invalid file store id");
 		return(false);
 	}
+	if(this->io) {
+		return(this->pop_direct(blockStore));
+	}
 	if(!this->fileHandlePop && !this->open(typeHandlePop)) {
 		return(false);
 	}
@@ -977,6 +1068,108 @@ bool pcap_file_store::pop(pcap_block_store *blockStore) {
 	return(rsltRestoreChunk > 0);
 }
 
+bool pcap_file_store::push_direct(pcap_block_store *blockStore) {
+	if(this->fileHandleDirect < 0 && !this->open_direct()) {
+		return(false);
+	}
+	if(this->writeError) {
+		// failed segment is not used for next blocks - next push creates new file store
+		this->full = true;
+		return(false);
+	}
+	size_t sizeSaveBuffer = blockStore->getSizeSaveBuffer();
+	size_t sizeWrite = cPcapFileStoreIO::alignSize(sizeSaveBuffer);
+	u_char *writeBuffer = cPcapFileStoreIO::allocBuffer(sizeWrite);
+	if(!writeBuffer) {
+		syslog(LOG_ERR, "packetbuffer: alloc buffer for write to %s failed", this->getFilePathName().c_str());
+		return(false);
+	}
+	blockStore->getSaveBuffer(0, writeBuffer);
+	memset(writeBuffer + sizeSaveBuffer, 0, sizeWrite - sizeSaveBuffer);
+	// blocks are written at aligned positions - padding is ignored by restore
+	size_t filePosition = this->fileSize;
+	__sync_add_and_fetch(&this->pendingWrites, 1);
+	this->io->write(this->fileHandleDirect, writeBuffer, sizeWrite, filePosition, &this->pendingWrites, &this->writeError);
+	this->fileSize += sizeWrite;
+	blockStore->freeBlock();
+	blockStore->idFileStore = this->id;
+	blockStore->filePosition = filePosition;
+	++this->countPush;
+	return(true);
+}
+
+bool pcap_file_store::pop_direct(pcap_block_store *blockStore) {
+	if(this->fileHandleDirect < 0) {
+		syslog(LOG_ERR, "packetbuffer: file store %s is not open", this->getFilePathName().c_str());
+		return(false);
+	}
+	this->wait_pending_writes();
+	if(this->writeError) {
+		// content of segment after failed write is not reliable - block is dropped
+		syslog(LOG_ERR, "packetbuffer: drop block from %s - write to file store failed", this->getFilePathName().c_str());
+		++this->countPop;
+		return(false);
+	}
+	blockStore->destroyRestoreBuffer();
+	u_char *readBuff = cPcapFileStoreIO::allocBuffer(FILE_STORE_IO_READ_CHUNK);
+	u_int64_t readPosition = blockStore->filePosition;
+	int rsltRestoreChunk = 0;
+	if(readBuff) {
+		ssize_t readed;
+		while((readed = this->io->read(this->fileHandleDirect, readBuff, FILE_STORE_IO_READ_CHUNK, readPosition)) > 0) {
+			rsltRestoreChunk = blockStore->addRestoreChunk(readBuff, readed, NULL, true);
+			if(rsltRestoreChunk != 0) {
+				break;
+			}
+			readPosition += readed;
+		}
+		if(readed < 0) {
+			syslog(LOG_ERR, "packetbuffer: read from %s failed - %s", 
+			       this->getFilePathName().c_str(), strerror(-readed));
+		}
+		cPcapFileStoreIO::freeBuffer(readBuff);
+	}
+	if(rsltRestoreChunk < 0) {
+		syslog(LOG_ERR, "packetbuffer: restore block from %s failed - %s", 
+		       this->getFilePathName().c_str(),
+		       blockStore->addRestoreChunk_getErrorString(rsltRestoreChunk).c_str());
+	}
+	++this->countPop;
+	blockStore->destroyRestoreBuffer();
+	return(rsltRestoreChunk > 0);
+}
+
+bool pcap_file_store::open_direct() {
+	string filePathName = this->getFilePathName();
+	bool exists = access(filePathName.c_str(), F_OK) == 0;
+	this->fileHandleDirect = ::open(filePathName.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0600);
+	if(this->fileHandleDirect < 0 && errno == EINVAL) {
+		// filesystem without O_DIRECT support (tmpfs) - still asynchronous by io thread
+		syslog(LOG_NOTICE, "packetbuffer: O_DIRECT is not supported for %s", filePathName.c_str());
+		this->fileHandleDirect = ::open(filePathName.c_str(), O_RDWR | O_CREAT, 0600);
+	}
+	if(this->fileHandleDirect < 0) {
+		syslog(LOG_ERR, "packetbuffer: open %s for direct io failed - %s", filePathName.c_str(), strerror(errno));
+		return(false);
+	}
+	if(!exists) {
+		// new segment of ring - allocate whole segment at once
+		if(fallocate(this->fileHandleDirect, 0, 0, cPcapFileStoreIO::alignSize(opt_pcap_queue_file_store_max_size)) < 0 &&
+		   errno != EOPNOTSUPP) {
+			syslog(LOG_NOTICE, "packetbuffer: preallocation of %s failed - %s", filePathName.c_str(), strerror(errno));
+		}
+	}
+	if(VERBOSE || DEBUG_VERBOSE) {
+		syslog(LOG_NOTICE, "packetbuffer: open file store segment %s for direct io (%s)", 
+		       filePathName.c_str(), exists ? "reused" : "created");
+	}
+	return(true);
+}
+
+void pcap_file_store::wait_pending_writes() {
+	this->io->waitPendingWrites(&this->pendingWrites);
+}
+
 bool pcap_file_store::open(eTypeHandle typeHandle) {
 	if((!(typeHandle & typeHandlePush) || this->fileHandlePush) &&
 	   (!(typeHandle & typeHandlePop) || this->fileHandlePop)) {
@@ -1031,6 +1224,16 @@ bool pcap_file_store::open(eTypeHandle typeHandle) {
 }
 
 bool pcap_file_store::close(eTypeHandle typeHandle) {
+	if(this->io) {
+		// segment stays open for pop - all handles are closed only at destroy
+		if(this->fileHandleDirect >= 0 &&
+		   typeHandle & typeHandleAll) {
+			this->wait_pending_writes();
+			::close(this->fileHandleDirect);
+			this->fileHandleDirect = -1;
+		}
+		return(true);
+	}
 	if(typeHandle & typeHandlePush &&
 	   this->fileHandlePush != NULL) {
 		this->lock_sync_flush_file();
@@ -1054,6 +1257,10 @@ bool pcap_file_store::close(eTypeHandle typeHandle) {
 
 bool pcap_file_store::destroy() {
 	this->close(typeHandleAll);
+	if(this->segment >= 0) {
+		// segment file is kept and reused by next file store
+		return(true);
+	}
 	string filePathName = this->getFilePathName();
 	remove(filePathName.c_str());
 	return(true);
@@ -1061,6 +1268,10 @@ bool pcap_file_store::destroy() {
 
 string pcap_file_store::getFilePathName() {
 	char filePathName[this->folder.length() + 100];
+	if(this->segment >= 0) {
+		sprintf(filePathName, "%s/pcap_store_segment_%04i", this->folder.c_str(), this->segment);
+		return(filePathName);
+	}
 	sprintf(filePathName, TEST_DEBUG_PARAMS ? "%s/pcap_store_mx_%010u" : "%s/pcap_store_%010u", this->folder.c_str(), this->id);
 	return(filePathName);
 }
@@ -1074,6 +1285,8 @@ pcap_store_queue::pcap_store_queue(const char *fileStoreFolder) {
 	this->cleanupFileStoreCounter = 0;
 	this->lastTimeLogErrDiskIsFull = 0;
 	this->lastTimeLogErrMemoryIsFull = 0;
+	this->fileStoreIO = NULL;
+	this->countSegments = 0;
 	if(fileStoreFolder && fileStoreFolder[0] && access(fileStoreFolder, F_OK ) == -1) {
 		mkdir_r(fileStoreFolder, 0700);
 	}
@@ -1092,6 +1305,13 @@ pcap_store_queue::~pcap_store_queue() {
 		delete blockStore;
 		this->queueStore.pop_front();
 	}
+	if(this->fileStoreIO) {
+		delete this->fileStoreIO;
+	}
+	for(int i = 0; i < this->countSegments; i++) {
+		pcap_file_store segmentFile(0, this->fileStoreFolder.c_str(), NULL, i);
+		remove(segmentFile.getFilePathName().c_str());
+	}
 }
 
 bool pcap_store_queue::push(pcap_block_store *blockStore, bool deleteBlockStoreIfFail) {
@@ -1145,7 +1365,16 @@ bool pcap_store_queue::push(pcap_block_store *blockStore, bool deleteBlockStoreI
 			if(!this->lastFileStoreId) {
 				++this->lastFileStoreId;
 			}
-			fileStore = new FILE_LINE(15023) pcap_file_store(this->lastFileStoreId, this->fileStoreFolder.c_str());
+			if(opt_pcap_queue_file_store_direct_io && !this->fileStoreIO) {
+				this->fileStoreIO = new FILE_LINE(0) cPcapFileStoreIO;
+				if(!this->fileStoreIO->start()) {
+					delete this->fileStoreIO;
+					this->fileStoreIO = NULL;
+				}
+			}
+			fileStore = this->fileStoreIO ?
+				     new FILE_LINE(15023) pcap_file_store(this->lastFileStoreId, this->fileStoreFolder.c_str(), this->fileStoreIO, this->getFreeSegment()) :
+				     new FILE_LINE(15023) pcap_file_store(this->lastFileStoreId, this->fileStoreFolder.c_str());
 			this->fileStore.push_back(fileStore);
 		} else {
 			fileStore = this->fileStore[this->fileStore.size() - 1];
@@ -1252,6 +1481,9 @@ void pcap_store_queue::cleanupFileStore() {
 	while(this->fileStore.size()) {
 		pcap_file_store *fileStore = this->fileStore.front();
 		if(fileStore->isForDestroy()) {
+			if(fileStore->segment >= 0) {
+				this->freeSegments.push_back(fileStore->segment);
+			}
 			delete fileStore;
 			this->fileStore.pop_front();
 		} else {
@@ -1261,6 +1493,15 @@ void pcap_store_queue::cleanupFileStore() {
 	this->unlock_fileStore();
 }
 
+int pcap_store_queue::getFreeSegment() {
+	if(this->freeSegments.size()) {
+		int segment = this->freeSegments.front();
+		this->freeSegments.pop_front();
+		return(segment);
+	}
+	return(this->countSegments++);
+}
+
 uint64_t pcap_store_queue::getFileStoreUseSize(bool lock) {
 	if(lock) {
 		this->lock_fileStore();
@@ -2009,11 +2250,16 @@ void PcapQueue::pcapStat(int statPeriod, bool statCalls) {
 			lapTime.push_back(getTimeMS_rdtsc());
 			lapTimeDescr.push_back("drop");
 		}
+		extern int opt_udpfrag;
+		if(opt_udpfrag) {
+			outStr << ipfrag_stat.getStatString();
+		}
 		double diskBufferMb = this->pcapStat_get_disk_buffer_mb();
 		if(diskBufferMb >= 0) {
 			double diskBufferPerc = this->pcapStat_get_disk_buffer_perc();
 			outStr << "fileq[" << setprecision(1) << diskBufferMb << "MB "
 			       << setprecision(1) << diskBufferPerc << "%] ";
+			outStr << this->pcapStat_get_disk_io();
 		}
 		double compress = this->pcapStat_get_compress();
 		if(compress >= 0) {
@@ -3006,6 +3252,9 @@ PcapQueue_readFromInterface_base::PcapQueue_readFromInterface_base(const char *i
 	this->filterDataUse = false;
 	this->pcapDumpHandle = NULL;
 	this->pcapLinklayerHeaderType = 0;
+	this->afpacketFanoutIndex = -1;
+	this->afpacketFanoutThreads = 0;
+	this->afpacketRing = NULL;
 	// CONFIG
 	extern int opt_promisc;
 	extern int opt_ringbuffer;
@@ -3034,6 +3283,7 @@ PcapQueue_readFromInterface_base::PcapQueue_readFromInterface_base(const char *i
 		if(if_filter_net.size()) {
 			filter_ip->add(&if_filter_net);
 		}
+		filter_ip->prepareLpm();
 	} else {
 		filter_ip = NULL;
 	}
@@ -3045,6 +3295,11 @@ PcapQueue_readFromInterface_base::~PcapQueue_readFromInterface_base() {
 		pcap_close(this->pcapHandle);
 		syslog(LOG_NOTICE, "packetbuffer terminating: pcap_close pcapHandle (%s)", interfaceName.c_str());
 	}
+	if(this->afpacketRing) {
+		// ring blocks still referenced from packetbuffer (zero copy) defer unmap of the ring to their release
+		cAfPacketRing::destroy(this->afpacketRing);
+		syslog(LOG_NOTICE, "packetbuffer terminating: close afpacket ring (%s)", interfaceName.c_str());
+	}
 	if(this->pcapDumpHandle) {
 		pcap_dump_close(this->pcapDumpHandle);
 		syslog(LOG_NOTICE, "packetbuffer terminating: pcap_close pcapDumpHandle (%s)", interfaceName.c_str());
@@ -3100,6 +3355,11 @@ bool PcapQueue_readFromInterface_base::startCapture(string *error) {
 		__sync_lock_release(&_sync_start_capture);
 		return(true);
 	}
+	if(this->afpacketFanoutIndex >= 0) {
+		bool rslt = this->startCapture_afpacket(error);
+		__sync_lock_release(&_sync_start_capture);
+		return(rslt);
+	}
 	if(VERBOSE) {
 		syslog(LOG_NOTICE, "packetbuffer - %s: capturing", this->getInterfaceName().c_str());
 	}
@@ -3221,6 +3481,67 @@ failed:
 	return(false);
 }
 
+bool PcapQueue_readFromInterface_base::startCapture_afpacket(string *error) {
+	char errorstr[4096];
+	if(VERBOSE) {
+		syslog(LOG_NOTICE, "packetbuffer - %s: capturing via afpacket (ring %i/%u)", this->getInterfaceName().c_str(),
+		       this->afpacketFanoutIndex + 1, this->afpacketFanoutThreads);
+	}
+	if(pcap_lookupnet(this->interfaceName.c_str(), &this->interfaceNet, &this->interfaceMask, errorstr) == -1) {
+		this->interfaceMask = PCAP_NETMASK_UNKNOWN;
+	}
+	this->afpacketRing = new FILE_LINE(0) cAfPacketRing(this->interfaceName.c_str(),
+							    this->afpacketFanoutThreads > 1 ? 
+							     cAfPacketRing::getFanoutGroupId(this->interfaceName.c_str()) : -1);
+	// ringbuffer is split between rings of one interface
+	if(!this->afpacketRing->open(this->pcap_snaplen, this->pcap_promisc,
+				     (u_int64_t)this->pcap_buffer_size / max(this->afpacketFanoutThreads, 1u),
+				     opt_pcap_queue_afpacket_block_size * 1024, 
+				     // headroom for pcap_pkthdr_plus2 and restored vlan tag in front of each packet
+				     opt_pcap_queue_afpacket_zerocopy ? sizeof(pcap_pkthdr_plus2) + 4 : 0,
+				     error)) {
+		delete this->afpacketRing;
+		this->afpacketRing = NULL;
+		cLogSensor::log(cLogSensor::error, error->c_str());
+		if(opt_fork) {
+			daemonizeOutput(*error);
+		}
+		return(false);
+	}
+	all_ringbuffers_size += (u_int64_t)this->afpacketRing->getBlockSize() * this->afpacketRing->getBlocksCount();
+	// dead handle keeps pcap_compile, pcap_dump and register_pcap_handle working
+	this->pcapLinklayerHeaderType = this->afpacketRing->getDlt();
+	this->pcapHandle = pcap_open_dead(this->pcapLinklayerHeaderType, this->pcap_snaplen);
+	this->pcapHandleIndex = register_pcap_handle(this->pcapHandle);
+	global_pcap_handle = this->pcapHandle;
+	global_pcap_handle_index = this->pcapHandleIndex;
+	global_pcap_dlink = this->pcapLinklayerHeaderType;
+	if(*user_filter != '\0') {
+		struct bpf_program fp;
+		if(pcap_compile(this->pcapHandle, &fp, user_filter, 1, this->interfaceMask) == -1) {
+			char user_filter_err[2048];
+			snprintf(user_filter_err, sizeof(user_filter_err), "%.2000s%s", user_filter, strlen(user_filter) > 2000 ? "..." : "");
+			snprintf(errorstr, sizeof(errorstr), "packetbuffer - %s: can not parse filter %s: %s", this->getInterfaceName().c_str(), user_filter_err, pcap_geterr(this->pcapHandle));
+			syslog(LOG_ERR, "%s", errorstr);
+			*error = errorstr;
+			return(false);
+		}
+		bool rsltSetFilter = this->afpacketRing->setFilter(fp.bf_insns, fp.bf_len, error);
+		pcap_freecode(&fp);
+		if(!rsltSetFilter) {
+			return(false);
+		}
+	}
+	if(opt_pcapdump) {
+		char pname[2048];
+		snprintf(pname, sizeof(pname), "%s/dump-%s-%i-%u.pcap", 
+			 getPcapdumpDir(),
+			 this->interfaceName.c_str(), this->afpacketFanoutIndex, (unsigned int)time(NULL));
+		this->pcapDumpHandle = pcap_dump_open(this->pcapHandle, pname);
+	}
+	return(true);
+}
+
 inline int PcapQueue_readFromInterface_base::pcap_next_ex_iface(pcap_t *pcapHandle, pcap_pkthdr** header, u_char** packet,
 								bool checkProtocol, sCheckProtocolData *checkProtocolData) {
 	if(!pcapHandle) {
@@ -3432,29 +3753,37 @@ inline int PcapQueue_readFromInterface_base::pcap_next_ex_iface(pcap_t *pcapHand
 			syslog(LOG_NOTICE, "find oneshot libpcap buffer : %s", libpcap_buffer ? "success" : "failed");
 		}
 	}
+	if(!this->check_protocol(*header, *packet, checkProtocol, checkProtocolData)) {
+		return(-11);
+	}
+	return(1);
+}
+
+inline bool PcapQueue_readFromInterface_base::check_protocol(pcap_pkthdr *header, u_char *packet,
+							     bool checkProtocol, sCheckProtocolData *checkProtocolData) {
 	if(checkProtocol || filter_ip) {
 		sCheckProtocolData _checkProtocolData;
 		if(!checkProtocolData) {
 			checkProtocolData = &_checkProtocolData;
 		}
-		if(!parseEtherHeader(pcapLinklayerHeaderType, *packet,
+		if(!parseEtherHeader(pcapLinklayerHeaderType, packet,
 				     checkProtocolData->header_sll, checkProtocolData->header_eth, NULL,
 				     checkProtocolData->header_ip_offset, checkProtocolData->protocol, checkProtocolData->vlan) ||
 		   !(checkProtocolData->protocol == ETHERTYPE_IP ||
 		     (VM_IPV6_B && checkProtocolData->protocol == ETHERTYPE_IPV6)) ||
-		   !(((iphdr2*)(*packet + checkProtocolData->header_ip_offset))->version == 4 ||
-		     (VM_IPV6_B && ((iphdr2*)(*packet + checkProtocolData->header_ip_offset))->version == 6)) ||
-		   ((iphdr2*)(*packet + checkProtocolData->header_ip_offset))->get_tot_len() + checkProtocolData->header_ip_offset > (*header)->len) {
-			return(-11);
+		   !(((iphdr2*)(packet + checkProtocolData->header_ip_offset))->version == 4 ||
+		     (VM_IPV6_B && ((iphdr2*)(packet + checkProtocolData->header_ip_offset))->version == 6)) ||
+		   ((iphdr2*)(packet + checkProtocolData->header_ip_offset))->get_tot_len() + checkProtocolData->header_ip_offset > header->len) {
+			return(false);
 		}
 		if(filter_ip) {
-			iphdr2 *iphdr = (iphdr2*)(*packet + checkProtocolData->header_ip_offset);
+			iphdr2 *iphdr = (iphdr2*)(packet + checkProtocolData->header_ip_offset);
 			if(!filter_ip->checkIP(iphdr->get_saddr()) && !filter_ip->checkIP(iphdr->get_daddr())) {
-				return(-11);
+				return(false);
 			}
 		}
 	}
-	return(1);
+	return(true);
 }
 
 void PcapQueue_readFromInterface_base::restoreOneshotBuffer() {
@@ -3502,7 +3831,27 @@ inline int PcapQueue_readFromInterface_base::pcapProcess(sHeaderPacket **header_
 
 string PcapQueue_readFromInterface_base::pcapStatString_interface(int /*statPeriod*/) {
 	ostringstream outStr;
-	if(this->pcapHandle) {
+	if(this->afpacketRing) {
+		cAfPacketRing::sStat stat = this->afpacketRing->getStat();
+		if(stat.drops > this->afpacket_last_stat.drops) {
+			++this->countPacketDrop;
+			pcap_drop_flag = 1;
+			u_int64_t rx = stat.packets - this->afpacket_last_stat.packets;
+			u_int64_t drops = stat.drops - this->afpacket_last_stat.drops;
+			outStr << fixed
+			       << "DROPPED PACKETS - " << this->getInterfaceName() << " (afpacket ring " 
+			       << (this->afpacketFanoutIndex + 1) << "/" << this->afpacketFanoutThreads << "): "
+			       << "kernel ring dropped some packets!"
+			       << " rx:" << rx
+			       << " ringdrop:" << drops << " " 
+			       << setprecision(1) << (rx ? (double)drops / rx * 100 : 0) << "%"
+			       << " freeze:" << (stat.freeze_q - this->afpacket_last_stat.freeze_q)
+			       << endl
+			       << "     increase ringbuffer or number of afpacket threads for interface" 
+			       << endl;
+		}
+		this->afpacket_last_stat = stat;
+	} else if(this->pcapHandle) {
 		pcap_stat ps;
 		int pcapstatres = pcap_stats(this->pcapHandle, &ps);
 		if(pcapstatres == 0) {
@@ -3526,11 +3875,11 @@ string PcapQueue_readFromInterface_base::pcapStatString_interface(int /*statPeri
 					       << " rx:" << (ps.ps_recv - this->last_ps.ps_recv);
 					if(pcapdrop) {
 						outStr << " pcapdrop:" << (ps.ps_drop - this->last_ps.ps_drop) << " " 
-						       << setprecision(1) << ((double)(ps.ps_drop - this->last_ps.ps_drop) / (ps.ps_recv - this->last_ps.ps_recv) * 100) << "%%";
+						       << setprecision(1) << ((double)(ps.ps_drop - this->last_ps.ps_drop) / (ps.ps_recv - this->last_ps.ps_recv) * 100) << "%";
 					}
 					if(ifdrop) {
 						outStr << " ifdrop:" << (ps.ps_ifdrop - this->last_ps.ps_ifdrop) << " " 
-						       << setprecision(1) << ((double)(ps.ps_ifdrop - this->last_ps.ps_ifdrop) / (ps.ps_recv - this->last_ps.ps_recv) * 100) << "%%";
+						       << setprecision(1) << ((double)(ps.ps_ifdrop - this->last_ps.ps_ifdrop) / (ps.ps_recv - this->last_ps.ps_recv) * 100) << "%";
 					}
 					outStr << endl
 					       << "     increase --ring-buffer (kernel >= 2.6.31 and libpcap >= 1.0.0)" 
@@ -3545,7 +3894,13 @@ string PcapQueue_readFromInterface_base::pcapStatString_interface(int /*statPeri
 
 string PcapQueue_readFromInterface_base::pcapDropCountStat_interface() {
 	ostringstream outStr;
-	if(this->pcapHandle) {
+	if(this->afpacketRing) {
+		cAfPacketRing::sStat stat = this->afpacketRing->getStat();
+		outStr << this->getInterfaceName(true) << "#" << (this->afpacketFanoutIndex + 1) << " : " 
+		       << "pdropsCount [" << this->countPacketDrop << "]"
+		       << " ringdrop [" << stat.drops << "]"
+		       << " freeze [" << stat.freeze_q << "]";
+	} else if(this->pcapHandle) {
 		outStr << this->getInterfaceName(true) << " : " << "pdropsCount [" << this->countPacketDrop << "]";
 		pcap_stat ps;
 		int pcapstatres = pcap_stats(this->pcapHandle, &ps);
@@ -3571,7 +3926,10 @@ string PcapQueue_readFromInterface_base::getStatPacketDrop() {
 }
 
 void PcapQueue_readFromInterface_base::initStat_interface() {
-	if(this->pcapHandle) {
+	if(this->afpacketRing) {
+		this->afpacket_last_stat = this->afpacketRing->getStat();
+		this->countPacketDrop = 0;
+	} else if(this->pcapHandle) {
 		pcap_stat ps;
 		int pcapstatres = pcap_stats(this->pcapHandle, &ps);
 		if(pcapstatres == 0) {
@@ -3659,12 +4017,20 @@ void PcapQueue_readFromInterface_base::terminatingAtEndOfReadPcap() {
 
 PcapQueue_readFromInterfaceThread::PcapQueue_readFromInterfaceThread(const char *interfaceName, eTypeInterfaceThread typeThread,
 								     PcapQueue_readFromInterfaceThread *readThread,
-								     PcapQueue_readFromInterfaceThread *prevThread)
+								     PcapQueue_readFromInterfaceThread *prevThread,
+								     int afpacketFanoutIndex)
  : PcapQueue_readFromInterface_base(interfaceName) {
+	if(afpacketFanoutIndex >= 0) {
+		this->afpacketFanoutIndex = afpacketFanoutIndex;
+		this->afpacketFanoutThreads = 1;
+		afpacket_interface_is(interfaceName, &this->afpacketFanoutThreads);
+	}
 	this->threadHandle = 0;
 	this->threadId = 0;
 	this->threadInitOk = 0;
 	this->threadInitFailed = false;
+	// qring is used by the next thread of the interface
+	threadPlacement.setMemoryNode(interfaceName);
 	if(!opt_pcap_queue_use_blocks) {
 		this->qringmax = opt_pcap_queue_iface_qring_size / 100;
 		this->qring = new FILE_LINE(15025) hpi_batch*[this->qringmax];
@@ -3683,6 +4049,7 @@ PcapQueue_readFromInterfaceThread::PcapQueue_readFromInterfaceThread(const char
 		}
 		this->qring = NULL;
 	}
+	threadPlacement.resetMemoryNode();
 	this->readit = 0;
 	this->writeit = 0;
 	this->readIndex = 0;
@@ -3728,6 +4095,11 @@ PcapQueue_readFromInterfaceThread::PcapQueue_readFromInterfaceThread(const char
 	this->md2Thread = NULL;
 	this->dedupThread = NULL;
 	this->serviceThread = NULL;
+	this->dedupWorkers = NULL;
+	if(typeThread == dedup &&
+	   opt_pcap_queue_use_blocks && opt_dup_check && opt_dup_check_threads > 1) {
+		this->dedupWorkers = new FILE_LINE(0) cDedupWorkers(opt_dup_check_threads, interfaceName);
+	}
 	this->typeThread = typeThread;
 	this->prevThread = prevThread;
 	this->threadDoTerminate = false;
@@ -3823,6 +4195,9 @@ PcapQueue_readFromInterfaceThread::~PcapQueue_readFromInterfaceThread() {
 			delete [] this->detachBuffer[i];
 		}
 	}
+	if(this->dedupWorkers) {
+		delete this->dedupWorkers;
+	}
 	/*
 	if(this->headerPacketStack) {
 		delete this->headerPacketStack;
@@ -4652,6 +5027,10 @@ void PcapQueue_readFromInterfaceThread::threadFunction_blocks() {
 	while(!(is_terminating() || this->threadDoTerminate)) {
 		switch(this->typeThread) {
 		case read: {
+			if(this->afpacketRing) {
+				this->threadFunction_blocks_afpacket(&block);
+				break;
+			}
 			while(!block ||
 			      !block->get_add_hp_pointers(&pcap_header_plus2, &pcap_packet, pcap_snaplen) ||
 			      (block->count && force_push)) {
@@ -4758,6 +5137,131 @@ void PcapQueue_readFromInterfaceThread::threadFunction_blocks() {
 	this->threadTerminated = true;
 }
 
+inline int PcapQueue_readFromInterfaceThread::threadFunction_blocks_afpacket(pcap_block_store **block) {
+	cAfPacketRing::sBlock ringBlock;
+	if(!this->afpacketRing->getBlock(&ringBlock, 100)) {
+		if(*block && (*block)->count && force_push) {
+			this->push_block(*block);
+			*block = NULL;
+			force_push = false;
+		}
+		return(0);
+	}
+	void *ppd_iterator = NULL;
+	unsigned ppd_counter = 0;
+	cAfPacketRing::sPacket packet;
+	pcap_pkthdr header;
+	pcap_pkthdr_plus2 *pcap_header_plus2 = NULL;
+	u_char *pcap_packet = NULL;
+	sCheckProtocolData checkProtocolData;
+	int counter = 0;
+	if(this->afpacketRing->getReserve() &&
+	   this->afpacketRing->getHeldBlocks() < this->afpacketRing->getBlocksCount() / 2) {
+		// zero copy - packets stay in the ring block, headers are written into the reserved headroom
+		if(*block && (*block)->count) {
+			this->push_block(*block);
+			*block = NULL;
+		}
+		u_char *ringBlockBase = this->afpacketRing->getBlockBase(&ringBlock);
+		pcap_block_store *ringBlockStore = new FILE_LINE(0) pcap_block_store(pcap_block_store::plus2);
+		while(this->afpacketRing->nextPacket(&ringBlock, &ppd_iterator, &ppd_counter, &packet)) {
+			header.ts.tv_sec = packet.ts_sec;
+			header.ts.tv_usec = packet.ts_usec;
+			if(packet.vlan_valid && packet.caplen >= 12) {
+				pcap_packet = packet.data - 4;
+				memmove(pcap_packet, packet.data, 12);
+				*(u_int16_t*)(pcap_packet + 12) = htons(packet.vlan_tpid);
+				*(u_int16_t*)(pcap_packet + 14) = htons(packet.vlan_tci);
+				header.caplen = min((size_t)packet.caplen + 4, pcap_snaplen);
+				header.len = packet.len + 4;
+			} else {
+				pcap_packet = packet.data;
+				header.caplen = min((size_t)packet.caplen, pcap_snaplen);
+				header.len = packet.len;
+			}
+			if(!this->check_protocol(&header, pcap_packet, opt_pcap_queue_use_blocks_read_check, &checkProtocolData)) {
+				continue;
+			}
+			sumPacketsSize[0] += header.caplen;
+			pcap_header_plus2 = (pcap_pkthdr_plus2*)(pcap_packet - sizeof(pcap_pkthdr_plus2));
+			pcap_header_plus2->clear();
+			if(opt_pcap_queue_use_blocks_read_check) {
+				pcap_header_plus2->detect_headers = 0x01;
+				pcap_header_plus2->header_ip_encaps_offset = checkProtocolData.header_ip_offset;
+				pcap_header_plus2->header_ip_offset = checkProtocolData.header_ip_offset;
+				pcap_header_plus2->eth_protocol = checkProtocolData.protocol;
+				pcap_header_plus2->pid.vlan = checkProtocolData.vlan;
+				pcap_header_plus2->pid.flags = 0;
+			} else {
+				pcap_header_plus2->header_ip_encaps_offset = 0;
+				pcap_header_plus2->header_ip_offset = 0;
+			}
+			pcap_header_plus2->convertFromStdHeader(&header);
+			pcap_header_plus2->dlink = pcapLinklayerHeaderType;
+			ringBlockStore->add_h_external((u_char*)pcap_header_plus2 - ringBlockBase, pcap_header_plus2);
+			++counter;
+		}
+		if(ringBlockStore->count) {
+			ringBlockStore->setExternalBlock(ringBlockBase, cAfPacketRing::releaseHeldBlock, this->afpacketRing, ringBlockBase);
+			ringBlockStore->full = true;
+			this->afpacketRing->holdBlock(&ringBlock);
+			this->push_block(ringBlockStore);
+		} else {
+			delete ringBlockStore;
+			this->afpacketRing->releaseBlock(&ringBlock);
+		}
+		return(counter);
+	}
+	while(this->afpacketRing->nextPacket(&ringBlock, &ppd_iterator, &ppd_counter, &packet)) {
+		while(!*block ||
+		      !(*block)->get_add_hp_pointers(&pcap_header_plus2, &pcap_packet, pcap_snaplen) ||
+		      ((*block)->count && force_push)) {
+			if(*block) {
+				this->push_block(*block);
+			}
+			*block = new FILE_LINE(0) pcap_block_store(pcap_block_store::plus2);
+			force_push = false;
+		}
+		header.ts.tv_sec = packet.ts_sec;
+		header.ts.tv_usec = packet.ts_usec;
+		if(packet.vlan_valid && packet.caplen >= 12) {
+			// TPACKET_V3 strips 802.1Q tag to tp_vlan_tci - put it back as libpcap does
+			header.caplen = min((size_t)packet.caplen + 4, pcap_snaplen);
+			header.len = packet.len + 4;
+			memcpy(pcap_packet, packet.data, 12);
+			*(u_int16_t*)(pcap_packet + 12) = htons(packet.vlan_tpid);
+			*(u_int16_t*)(pcap_packet + 14) = htons(packet.vlan_tci);
+			memcpy(pcap_packet + 16, packet.data + 12, header.caplen - 16);
+		} else {
+			header.caplen = min((size_t)packet.caplen, pcap_snaplen);
+			header.len = packet.len;
+			memcpy(pcap_packet, packet.data, header.caplen);
+		}
+		if(!this->check_protocol(&header, pcap_packet, opt_pcap_queue_use_blocks_read_check, &checkProtocolData)) {
+			continue;
+		}
+		sumPacketsSize[0] += header.caplen;
+		pcap_header_plus2->clear();
+		if(opt_pcap_queue_use_blocks_read_check) {
+			pcap_header_plus2->detect_headers = 0x01;
+			pcap_header_plus2->header_ip_encaps_offset = checkProtocolData.header_ip_offset;
+			pcap_header_plus2->header_ip_offset = checkProtocolData.header_ip_offset;
+			pcap_header_plus2->eth_protocol = checkProtocolData.protocol;
+			pcap_header_plus2->pid.vlan = checkProtocolData.vlan;
+			pcap_header_plus2->pid.flags = 0;
+		} else {
+			pcap_header_plus2->header_ip_encaps_offset = 0;
+			pcap_header_plus2->header_ip_offset = 0;
+		}
+		pcap_header_plus2->convertFromStdHeader(&header);
+		pcap_header_plus2->dlink = pcapLinklayerHeaderType;
+		(*block)->inc_h(pcap_header_plus2);
+		++counter;
+	}
+	this->afpacketRing->releaseBlock(&ringBlock);
+	return(counter);
+}
+
 void PcapQueue_readFromInterfaceThread::processBlock(pcap_block_store *block) {
 	unsigned counter = 0;
 	int ppf = 0;
@@ -4789,6 +5293,19 @@ void PcapQueue_readFromInterfaceThread::processBlock(pcap_block_store *block) {
 	default:
 		break;
 	}
+	if(this->typeThread == dedup && this->dedupWorkers) {
+		// packets are partitioned among workers by hash, dump is done here in order of block
+		this->dedupWorkers->processBlock(block, ppf & ~ppf_dump, this->pcapLinklayerHeaderType);
+		if(_pcapDumpHandle) {
+			for(unsigned i = 0; i < block->count; i++) {
+				if(!block->is_ignore(i)) {
+					pcap_pkthdr header = ((pcap_pkthdr_plus2*)block->get_header(i))->getStdHeader();
+					pcap_dump((u_char*)_pcapDumpHandle, &header, block->get_packet(i));
+				}
+			}
+		}
+		return;
+	}
 	for(unsigned i = 0; i < block->count; i++) {
 		if(block->is_ignore(i)) {
 			continue;
@@ -4930,6 +5447,7 @@ PcapQueue_readFromInterface::PcapQueue_readFromInterface(const char *nameQueue)
 			100,
 			100, 100,
 			&terminating, true);
+		this->block_qring->setSyncWait("pb block qring");
 	}
 }
 
@@ -4970,7 +5488,17 @@ bool PcapQueue_readFromInterface::init() {
 	}
 	vector<string> interfaces = split(this->interfaceName.c_str(), split(",|;| |\t|\r|\n", "|"), true);
 	for(size_t i = 0; i < interfaces.size(); i++) {
-		if(this->readThreadsCount < READ_THREADS_MAX - 1) {
+		unsigned afpacketThreads;
+		if(opt_pcap_queue_use_blocks && !opt_pb_read_from_file[0] &&
+		   afpacket_interface_is(interfaces[i].c_str(), &afpacketThreads)) {
+			for(unsigned j = 0; j < afpacketThreads; j++) {
+				if(this->readThreadsCount < READ_THREADS_MAX - 1) {
+					this->readThreads[this->readThreadsCount] = new FILE_LINE(0) PcapQueue_readFromInterfaceThread(interfaces[i].c_str(), PcapQueue_readFromInterfaceThread::read, 
+																       NULL, NULL, j);
+					++this->readThreadsCount;
+				}
+			}
+		} else if(this->readThreadsCount < READ_THREADS_MAX - 1) {
 			this->readThreads[this->readThreadsCount] = new FILE_LINE(15047) PcapQueue_readFromInterfaceThread(interfaces[i].c_str());
 			++this->readThreadsCount;
 		}
@@ -5616,7 +6144,11 @@ string PcapQueue_readFromInterface::pcapStatString_cpuUsageReadThreads(double *s
 		double ti_cpu = this->readThreads[i]->getCpuUsagePerc(true);
 		if(ti_cpu >= 0) {
 			sum += ti_cpu;
-			outStrStat << "t0i_" << this->readThreads[i]->interfaceName << "_CPU[";
+			outStrStat << "t0i_" << this->readThreads[i]->interfaceName;
+			if(this->readThreads[i]->afpacketFanoutThreads > 1) {
+				outStrStat << "#" << (this->readThreads[i]->afpacketFanoutIndex + 1);
+			}
+			outStrStat << "_CPU[";
 			outStrStat << setprecision(1) << this->readThreads[i]->getTraffic(divide) << "Mb/s";
 			outStrStat << ';' << setprecision(1) << ti_cpu;
 			if(sverb.qring_stat) {
@@ -6911,6 +7443,10 @@ double PcapQueue_readFromFifo::pcapStat_get_disk_buffer_perc() {
 	}
 }
 
+string PcapQueue_readFromFifo::pcapStat_get_disk_io() {
+	return(this->pcapStoreQueue.getFileStoreIOStatString());
+}
+
 double PcapQueue_readFromFifo::pcapStat_get_disk_buffer_mb() {
 	if(opt_pcap_queue_store_queue_max_disk_size &&
 	   this->pcapStoreQueue.fileStoreFolder.length()) {
@@ -7783,11 +8319,15 @@ PcapQueue_outputThread::PcapQueue_outputThread(eTypeOutputThread typeOutputThrea
 	this->outThreadId = 0;
 	this->defrag_counter = 0;
 	this->ipfrag_lastprune = 0;
+	this->dedup_buffer = NULL;
+	this->dedup_seen_set = NULL;
 	if(typeOutputThread == dedup) {
-		this->dedup_buffer = new FILE_LINE(16003) u_char[65536 * MD5_DIGEST_LENGTH]; // 1M
-		memset(this->dedup_buffer, 0, 65536 * MD5_DIGEST_LENGTH * sizeof(u_char));
-	} else {
-		this->dedup_buffer = NULL;
+		if(opt_dup_check_threads) {
+			this->dedup_seen_set = new FILE_LINE(16010) cDedupSeenSet;
+		} else {
+			this->dedup_buffer = new FILE_LINE(16003) u_char[65536 * MD5_DIGEST_LENGTH]; // 1M
+			memset(this->dedup_buffer, 0, 65536 * MD5_DIGEST_LENGTH * sizeof(u_char));
+		}
 	}
 	this->initThreadOk = false;
 	this->terminatingThread = false;
@@ -7802,9 +8342,12 @@ PcapQueue_outputThread::~PcapQueue_outputThread() {
 	if(typeOutputThread == defrag) {
 		ipfrag_prune(0, true, &ipfrag_data, -1, 0);
 	}
-	if(typeOutputThread == dedup) {
+	if(dedup_buffer) {
 		delete [] dedup_buffer;
 	}
+	if(dedup_seen_set) {
+		delete dedup_seen_set;
+	}
 }
 
 void PcapQueue_outputThread::start() {
@@ -8046,39 +8589,53 @@ void PcapQueue_outputThread::processDedup(sHeaderPacketPQout *hp) {
 				datalen = get_sctp_data_len(header_ip, &data, hp->packet, hp->header->get_caplen());
 			}
 			if(data && datalen) {
-				MD5_CTX md5_ctx;
-				MD5_Init(&md5_ctx);
+				void *dedup_data = data;
+				unsigned long dedup_datalen = datalen;
+				u_int8_t header_ip_ttl_orig = 0;
+				u_int8_t header_ip_check_orig = 0;
 				if(opt_dup_check_ipheader) {
-					u_int8_t header_ip_ttl_orig = 0;
-					u_int8_t header_ip_check_orig = 0;
 					if(opt_dup_check_ipheader_ignore_ttl) {
 						header_ip_ttl_orig = header_ip->get_ttl();
 						header_ip_check_orig = header_ip->get_check();
 						header_ip->set_ttl(0);
 						header_ip->set_check(0);
 					}
-					MD5_Update(&md5_ctx, header_ip, MIN(datalen + (data - (char*)header_ip), header_ip->get_tot_len()));
-					if(opt_dup_check_ipheader_ignore_ttl) {
-						header_ip->set_ttl(header_ip_ttl_orig);
-						header_ip->set_check(header_ip_check_orig);
-					}
+					dedup_data = header_ip;
+					dedup_datalen = MIN(datalen + (data - (char*)header_ip), header_ip->get_tot_len());
+				}
+				if(opt_dup_check_threads) {
+					dedup_hash64_to_md5(dedup_data, dedup_datalen, __md5);
 				} else {
-					MD5_Update(&md5_ctx, data, datalen);
+					MD5_CTX md5_ctx;
+					MD5_Init(&md5_ctx);
+					MD5_Update(&md5_ctx, dedup_data, dedup_datalen);
+					MD5_Final((unsigned char*)__md5, &md5_ctx);
+				}
+				if(opt_dup_check_ipheader && opt_dup_check_ipheader_ignore_ttl) {
+					header_ip->set_ttl(header_ip_ttl_orig);
+					header_ip->set_check(header_ip_check_orig);
 				}
-				MD5_Final((unsigned char*)__md5, &md5_ctx);
 				_md5 = __md5;
 			}
 		}
 	}
 	if(_md5) {
-		if(memcmp(_md5, this->dedup_buffer + (_md5[0] * MD5_DIGEST_LENGTH), MD5_DIGEST_LENGTH) == 0) {
+		bool duplicate;
+		if(this->dedup_seen_set) {
+			duplicate = this->dedup_seen_set->check(dedup_md5_to_hash64(_md5), hp->header->get_time_ms());
+		} else {
+			duplicate = memcmp(_md5, this->dedup_buffer + (_md5[0] * MD5_DIGEST_LENGTH), MD5_DIGEST_LENGTH) == 0;
+		}
+		if(duplicate) {
 			if(sverb.dedup) {
 				cout << "*** DEDUP 2" << endl;
 			}
 			hp->destroy_or_unlock_blockstore();
 			return;
 		}
-		memcpy(this->dedup_buffer + (_md5[0] * MD5_DIGEST_LENGTH), _md5, MD5_DIGEST_LENGTH);
+		if(!this->dedup_seen_set) {
+			memcpy(this->dedup_buffer + (_md5[0] * MD5_DIGEST_LENGTH), _md5, MD5_DIGEST_LENGTH);
+		}
 	}
 	if(this->pcapQueue->processPacket(hp, _hppq_out_state_dedup) == 0) {
 		hp->destroy_or_unlock_blockstore();
@@ -8154,3 +8711,7 @@ void setThreadingMode(int threadingMode) {
 		break;
 	}
 }
+
+u_int64_t getPacketbufferSumPacketsCounterIn() {
+	return(sumPacketsCounterIn[0]);
+}
@@ -15,11 +15,14 @@
 #include <sys/syscall.h>
 
 #include "pcap_queue_block.h"
+#include "pcap_queue_afpacket.h"
 #include "md5.h"
 #include "sniff.h"
 #include "pstat.h"
 #include "ip_frag.h"
 #include "header_packet.h"
+#include "pcap_file_store_io.h"
+#include "pcap_dedup.h"
 
 #define READ_THREADS_MAX 20
 #define DLT_TYPES_MAX 10
@@ -81,7 +84,7 @@ public:
 		typeHandleAll 	= 4
 	};
 public:
-	pcap_file_store(u_int id = 0, const char *folder = NULL);
+	pcap_file_store(u_int id = 0, const char *folder = NULL, class cPcapFileStoreIO *io = NULL, int segment = -1);
 	~pcap_file_store();
 	bool push(pcap_block_store *blockStore);
 	bool pop(pcap_block_store *blockStore);
@@ -109,6 +112,10 @@ private:
 	bool open(eTypeHandle typeHandle);
 	bool close(eTypeHandle typeHandle);
 	bool destroy();
+	bool push_direct(pcap_block_store *blockStore);
+	bool pop_direct(pcap_block_store *blockStore);
+	bool open_direct();
+	void wait_pending_writes();
 	void lock_sync_flush_file() {
 		while(__sync_lock_test_and_set(&this->_sync_flush_file, 1));
 	}
@@ -129,6 +136,11 @@ private:
 	bool full;
 	u_int64_t timestampMS;
 	volatile int _sync_flush_file;
+	cPcapFileStoreIO *io;
+	int segment;
+	int fileHandleDirect;
+	volatile int pendingWrites;
+	volatile bool writeError;
 friend class pcap_store_queue;
 };
 
@@ -142,8 +154,12 @@ public:
 		return(this->queueStore.size());
 	}
 	void init();
+	std::string getFileStoreIOStatString() {
+		return(this->fileStoreIO ? this->fileStoreIO->getStatString() : "");
+	}
 private:
 	pcap_file_store *findFileStoreById(u_int id);
+	int getFreeSegment();
 	void cleanupFileStore();
 	uint64_t getFileStoreUseSize(bool lock = true);
 	void lock_queue() {
@@ -176,6 +192,9 @@ private:
 	int cleanupFileStoreCounter;
 	u_int64_t lastTimeLogErrDiskIsFull;
 	u_int64_t lastTimeLogErrMemoryIsFull;
+	cPcapFileStoreIO *fileStoreIO;
+	std::deque<int> freeSegments;
+	int countSegments;
 friend class PcapQueue_readFromFifo;
 };
 
@@ -298,6 +317,7 @@ protected:
 	virtual string pcapStatString_disk_buffer(int /*statPeriod*/) { return(""); }
 	virtual double pcapStat_get_disk_buffer_perc() { return(-1); }
 	virtual double pcapStat_get_disk_buffer_mb() { return(-1); }
+	virtual string pcapStat_get_disk_io() { return(""); }
 	virtual string pcapStatString_interface(int /*statPeriod*/) { return(""); }
 	virtual string pcapDropCountStat_interface() { return(""); }
 	virtual ulong getCountPacketDrop() { return(0); }
@@ -381,15 +401,23 @@ struct pcapProcessData {
 		#pragma GCC diagnostic pop
 		#endif
 		extern int opt_dup_check;
+		extern int opt_dup_check_threads;
 		if(opt_dup_check) {
-			this->prevmd5s = new FILE_LINE(16003) unsigned char[65536 * MD5_DIGEST_LENGTH]; // 1M
-			memset(this->prevmd5s, 0, 65536 * MD5_DIGEST_LENGTH * sizeof(unsigned char));
+			if(opt_dup_check_threads) {
+				this->dedup_seen_set = new FILE_LINE(16009) cDedupSeenSet;
+			} else {
+				this->prevmd5s = new FILE_LINE(16003) unsigned char[65536 * MD5_DIGEST_LENGTH]; // 1M
+				memset(this->prevmd5s, 0, 65536 * MD5_DIGEST_LENGTH * sizeof(unsigned char));
+			}
 		}
 	}
 	~pcapProcessData() {
 		if(this->prevmd5s) {
 			delete [] this->prevmd5s;
 		}
+		if(this->dedup_seen_set) {
+			delete this->dedup_seen_set;
+		}
 		ipfrag_prune(0, true, &ipfrag_data, -1, 0);
 	}
 	sll_header *header_sll;
@@ -408,6 +436,7 @@ struct pcapProcessData {
 	int isother;
 	sPacketInfoData pid;
 	unsigned char *prevmd5s;
+	cDedupSeenSet *dedup_seen_set;
 	MD5_CTX ctx;
 	u_int ipfrag_lastprune;
 	ipfrag_data_s ipfrag_data;
@@ -428,8 +457,11 @@ public:
 	void setInterfaceName(const char *interfaceName);
 protected:
 	virtual bool startCapture(string *error);
+	bool startCapture_afpacket(string *error);
 	inline int pcap_next_ex_iface(pcap_t *pcapHandle, pcap_pkthdr** header, u_char** packet,
 				      bool checkProtocol = false, sCheckProtocolData *checkProtocolData = NULL);
+	inline bool check_protocol(pcap_pkthdr *header, u_char *packet,
+				   bool checkProtocol, sCheckProtocolData *checkProtocolData);
 	void restoreOneshotBuffer();
 	inline int pcap_dispatch(pcap_t *pcapHandle);
 	inline int pcapProcess(sHeaderPacket **header_packet, int pushToStack_queue_index,
@@ -463,11 +495,15 @@ protected:
 	int pcapLinklayerHeaderType;
 	size_t pcap_snaplen;
 	pcapProcessData ppd;
+	int afpacketFanoutIndex;
+	unsigned afpacketFanoutThreads;
+	cAfPacketRing *afpacketRing;
 private:
 	int pcap_promisc;
 	int pcap_timeout;
 	int pcap_buffer_size;
 	pcap_stat last_ps;
+	cAfPacketRing::sStat afpacket_last_stat;
 	u_long countPacketDrop;
 	u_int64_t lastPacketTimeUS;
 	u_int64_t lastTimeLogErrPcapNextExNullPacket;
@@ -621,7 +657,8 @@ public:
 	};
 	PcapQueue_readFromInterfaceThread(const char *interfaceName, eTypeInterfaceThread typeThread = read,
 					  PcapQueue_readFromInterfaceThread *readThread = NULL,
-					  PcapQueue_readFromInterfaceThread *prevThread = NULL);
+					  PcapQueue_readFromInterfaceThread *prevThread = NULL,
+					  int afpacketFanoutIndex = -1);
 	~PcapQueue_readFromInterfaceThread();
 protected:
 	inline void push(sHeaderPacket **header_packet);
@@ -682,6 +719,7 @@ protected:
 private:
 	void *threadFunction(void *arg, unsigned int arg2);
 	void threadFunction_blocks();
+	inline int threadFunction_blocks_afpacket(pcap_block_store **block);
 	void processBlock(pcap_block_store *block);
 	void preparePstatData();
 	double getCpuUsagePerc(bool preparePstatData = false);
@@ -737,6 +775,7 @@ private:
 	PcapQueue_readFromInterfaceThread *dedupThread;
 	PcapQueue_readFromInterfaceThread *serviceThread;
 	PcapQueue_readFromInterfaceThread *prevThread;
+	cDedupWorkers *dedupWorkers;
 	bool threadDoTerminate;
 	cHeaderPacketStack *headerPacketStackSnaplen;
 	cHeaderPacketStack *headerPacketStackShort;
@@ -918,6 +957,7 @@ protected:
 	string pcapStatString_disk_buffer(int statPeriod);
 	double pcapStat_get_disk_buffer_perc();
 	double pcapStat_get_disk_buffer_mb();
+	string pcapStat_get_disk_io();
 	string getCpuUsage(bool writeThread = false, bool preparePstatData = false);
 	bool socketWritePcapBlock(pcap_block_store *blockStore);
 	bool socketWritePcapBlockBySnifferClient(pcap_block_store *blockStore);
@@ -1051,6 +1091,7 @@ private:
 	unsigned ipfrag_lastprune;
 	unsigned defrag_counter;
 	u_char *dedup_buffer;
+	cDedupSeenSet *dedup_seen_set;
 	volatile bool initThreadOk;
 	volatile bool terminatingThread;
 friend inline void *_PcapQueue_outputThread_outThreadFunction(void *arg);
@@ -1061,6 +1102,7 @@ void PcapQueue_init();
 void PcapQueue_term();
 int getThreadingMode();
 void setThreadingMode(int threadingMode);
+u_int64_t getPacketbufferSumPacketsCounterIn();
 
 u_int16_t register_pcap_handle(pcap_t *handle);
 inline pcap_t *get_pcap_handle(u_int16_t index) {
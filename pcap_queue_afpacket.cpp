@@ -0,0 +1,477 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#ifndef FREEBSD
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#endif
+
+#include "pcap_queue_afpacket.h"
+#include "tools_global.h"
+#include "sync.h"
+
+
+extern string opt_pcap_queue_afpacket_interfaces;
+
+#ifndef DLT_EN10MB
+#define DLT_EN10MB 1
+#endif
+
+
+#if AFPACKET_TPACKET_V3
+
+cAfPacketRing::cAfPacketRing(const char *interfaceName, int fanoutGroupId) {
+	this->interfaceName = interfaceName;
+	this->fanoutGroupId = fanoutGroupId;
+	fd = -1;
+	ring = NULL;
+	ringSize = 0;
+	blockSize = 0;
+	blocksCount = 0;
+	blockIndex = 0;
+	reserve = 0;
+	dlt = DLT_EN10MB;
+	_sync_stat = 0;
+	heldBlocks = 0;
+	heldFlags = NULL;
+	_sync_held = 0;
+	destroyed = false;
+}
+
+cAfPacketRing::~cAfPacketRing() {
+	close();
+	if(heldFlags) {
+		delete [] heldFlags;
+	}
+}
+
+bool cAfPacketRing::open(unsigned snaplen, bool promisc, u_int64_t ringSize, unsigned blockSize, unsigned reserve, string *error) {
+	char errorstr[1024];
+	unsigned ifindex = if_nametoindex(interfaceName.c_str());
+	if(!ifindex) {
+		snprintf(errorstr, sizeof(errorstr), "afpacket - %s: unknown interface", interfaceName.c_str());
+		goto failed;
+	}
+	if((fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "afpacket - %s: socket failed: %s", interfaceName.c_str(), strerror(errno));
+		goto failed;
+	}
+	{
+	ifreq ifr;
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, interfaceName.c_str(), sizeof(ifr.ifr_name) - 1);
+	if(ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "afpacket - %s: SIOCGIFHWADDR failed: %s", interfaceName.c_str(), strerror(errno));
+		goto failed;
+	}
+	switch(ifr.ifr_hwaddr.sa_family) {
+	case ARPHRD_ETHER:
+	case ARPHRD_LOOPBACK:
+		dlt = DLT_EN10MB;
+		break;
+	default:
+		snprintf(errorstr, sizeof(errorstr), "afpacket - %s: unsupported link type %i (use libpcap for this interface)", interfaceName.c_str(), ifr.ifr_hwaddr.sa_family);
+		goto failed;
+	}
+	}
+	{
+	int version = TPACKET_V3;
+	if(setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "afpacket - %s: TPACKET_V3 is not supported: %s", interfaceName.c_str(), strerror(errno));
+		goto failed;
+	}
+	}
+	if(reserve) {
+		if(setsockopt(fd, SOL_PACKET, PACKET_RESERVE, &reserve, sizeof(reserve)) < 0) {
+			snprintf(errorstr, sizeof(errorstr), "afpacket - %s: PACKET_RESERVE failed: %s", interfaceName.c_str(), strerror(errno));
+			goto failed;
+		}
+	}
+	this->reserve = reserve;
+	{
+	unsigned pageSize = getpagesize();
+	unsigned minBlockSize = pageSize;
+	while(minBlockSize < TPACKET_ALIGN(TPACKET3_HDRLEN) + reserve + snaplen + 64) {
+		minBlockSize <<= 1;
+	}
+	unsigned _blockSize = pageSize;
+	while(_blockSize < blockSize || _blockSize < minBlockSize) {
+		_blockSize <<= 1;
+	}
+	this->blockSize = _blockSize;
+	this->blocksCount = ringSize / _blockSize;
+	if(this->blocksCount < 4) {
+		this->blocksCount = 4;
+	}
+	tpacket_req3 req;
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = this->blockSize;
+	req.tp_block_nr = this->blocksCount;
+	req.tp_frame_size = TPACKET_ALIGNMENT << 7;
+	req.tp_frame_nr = (req.tp_block_size / req.tp_frame_size) * req.tp_block_nr;
+	req.tp_retire_blk_tov = 10;
+	req.tp_feature_req_word = 0;
+	if(setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "afpacket - %s: PACKET_RX_RING (%u x %u B) failed: %s", interfaceName.c_str(), req.tp_block_nr, req.tp_block_size, strerror(errno));
+		goto failed;
+	}
+	this->ringSize = (size_t)this->blockSize * this->blocksCount;
+	if(heldFlags) {
+		delete [] heldFlags;
+	}
+	heldFlags = new FILE_LINE(0) int[this->blocksCount];
+	memset((void*)heldFlags, 0, sizeof(int) * this->blocksCount);
+	heldWait.setName("afpacket held block " + interfaceName);
+	ring = (u_char*)mmap(NULL, this->ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	if(ring == MAP_FAILED) {
+		ring = NULL;
+		snprintf(errorstr, sizeof(errorstr), "afpacket - %s: mmap ring (%lu B) failed: %s", interfaceName.c_str(), this->ringSize, strerror(errno));
+		goto failed;
+	}
+	}
+	{
+	sockaddr_ll sll;
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETH_P_ALL);
+	sll.sll_ifindex = ifindex;
+	if(bind(fd, (sockaddr*)&sll, sizeof(sll)) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "afpacket - %s: bind failed: %s", interfaceName.c_str(), strerror(errno));
+		goto failed;
+	}
+	}
+	if(promisc) {
+		packet_mreq mreq;
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.mr_ifindex = ifindex;
+		mreq.mr_type = PACKET_MR_PROMISC;
+		if(setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+			snprintf(errorstr, sizeof(errorstr), "afpacket - %s: set promisc failed: %s", interfaceName.c_str(), strerror(errno));
+			goto failed;
+		}
+	}
+	if(fanoutGroupId >= 0) {
+		int fanout = (fanoutGroupId & 0xFFFF) | (PACKET_FANOUT_HASH << 16);
+		if(setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) < 0) {
+			snprintf(errorstr, sizeof(errorstr), "afpacket - %s: PACKET_FANOUT (group %i) failed: %s", interfaceName.c_str(), fanoutGroupId, strerror(errno));
+			goto failed;
+		}
+	}
+	if(snaplen) {
+		// without user filter the kernel still must not copy more than snaplen
+		sock_filter filter_snaplen[] = { { 0x06, 0, 0, snaplen } };
+		if(!setFilter(filter_snaplen, 1, error)) {
+			close();
+			return(false);
+		}
+	}
+	blockIndex = 0;
+	updateStat();
+	stat = sStat();
+	syslog(LOG_NOTICE, "afpacket - %s: ring %u x %u kB%s",
+	       interfaceName.c_str(), blocksCount, this->blockSize / 1024,
+	       fanoutGroupId >= 0 ? (", fanout group " + intToString(fanoutGroupId)).c_str() : "");
+	return(true);
+failed:
+	syslog(LOG_ERR, "%s", errorstr);
+	if(error) {
+		*error = errorstr;
+	}
+	close();
+	return(false);
+}
+
+void cAfPacketRing::close() {
+	if(ring) {
+		munmap(ring, ringSize);
+		ring = NULL;
+	}
+	if(fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+}
+
+/*
+ * Socket is closed immediately, the ring stays mapped (and the object alive) until 
+ * the last held block is released from packetbuffer - see releaseHeldBlock.
+ */
+void cAfPacketRing::destroy(cAfPacketRing *ring) {
+	if(ring->fd >= 0) {
+		::close(ring->fd);
+		ring->fd = -1;
+	}
+	__SYNC_LOCK(ring->_sync_held);
+	ring->destroyed = true;
+	bool _delete = !ring->heldBlocks;
+	__SYNC_UNLOCK(ring->_sync_held);
+	if(_delete) {
+		delete ring;
+	} else {
+		syslog(LOG_NOTICE, "afpacket - %s: unmap of ring deferred - %u blocks still held", 
+		       ring->interfaceName.c_str(), ring->heldBlocks);
+	}
+}
+
+bool cAfPacketRing::setFilter(void *bpf_insns, unsigned bpf_len, string *error) {
+	// struct bpf_insn (libpcap) and struct sock_filter (kernel) have identical layout
+	sock_fprog prog;
+	prog.len = bpf_len;
+	prog.filter = (sock_filter*)bpf_insns;
+	if(setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+		char errorstr[1024];
+		snprintf(errorstr, sizeof(errorstr), "afpacket - %s: SO_ATTACH_FILTER failed: %s", interfaceName.c_str(), strerror(errno));
+		syslog(LOG_ERR, "%s", errorstr);
+		if(error) {
+			*error = errorstr;
+		}
+		return(false);
+	}
+	return(true);
+}
+
+bool cAfPacketRing::getBlock(sBlock *block, int timeout_ms) {
+	if(heldFlags[blockIndex]) {
+		// block still referenced from packetbuffer (zero copy) keeps TP_STATUS_USER - wait for its release,
+		// kernel cannot fill it either so the order of blocks is preserved
+		u_int64_t startTime = getTimeUS();
+		unsigned int waitCounter = 0;
+		while(heldFlags[blockIndex]) {
+			if(getTimeUS() - startTime > (u_int64_t)timeout_ms * 1000) {
+				return(false);
+			}
+			SYNC_WAIT(heldWait, heldFlags[blockIndex], 1, 100, waitCounter);
+		}
+	}
+	tpacket_block_desc *desc = (tpacket_block_desc*)(ring + (size_t)blockIndex * blockSize);
+	if(!(desc->hdr.bh1.block_status & TP_STATUS_USER)) {
+		pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN | POLLERR;
+		pfd.revents = 0;
+		if(poll(&pfd, 1, timeout_ms) <= 0 ||
+		   !(desc->hdr.bh1.block_status & TP_STATUS_USER)) {
+			return(false);
+		}
+	}
+	__sync_synchronize();
+	block->desc = desc;
+	block->index = blockIndex;
+	blockIndex = (blockIndex + 1) % blocksCount;
+	return(true);
+}
+
+void cAfPacketRing::releaseBlock(sBlock *block) {
+	if(block->desc) {
+		__sync_synchronize();
+		((tpacket_block_desc*)block->desc)->hdr.bh1.block_status = TP_STATUS_KERNEL;
+		block->desc = NULL;
+	}
+}
+
+/*
+ * Block passed to pcap_block_store without copy - it is returned to the kernel 
+ * (releaseHeldBlock) by the block store once nothing references its packets.
+ */
+void cAfPacketRing::holdBlock(sBlock *block) {
+	heldFlags[block->index] = 1;
+	__SYNC_INC(heldBlocks);
+	block->desc = NULL;
+}
+
+void cAfPacketRing::releaseHeldBlock(void *ring, void *desc) {
+	cAfPacketRing *_ring = (cAfPacketRing*)ring;
+	unsigned index = ((u_char*)desc - _ring->ring) / _ring->blockSize;
+	__sync_synchronize();
+	((tpacket_block_desc*)desc)->hdr.bh1.block_status = TP_STATUS_KERNEL;
+	// status must be returned to kernel before the flag is cleared - reader must not see the old TP_STATUS_USER
+	__sync_synchronize();
+	_ring->heldFlags[index] = 0;
+	_ring->heldWait.wake();
+	__SYNC_LOCK(_ring->_sync_held);
+	__SYNC_DEC(_ring->heldBlocks);
+	bool _delete = _ring->destroyed && !_ring->heldBlocks;
+	__SYNC_UNLOCK(_ring->_sync_held);
+	if(_delete) {
+		delete _ring;
+	}
+}
+
+unsigned cAfPacketRing::getBlockPacketsCount(sBlock *block) {
+	return(block->desc ? ((tpacket_block_desc*)block->desc)->hdr.bh1.num_pkts : 0);
+}
+
+bool cAfPacketRing::nextPacket(sBlock *block, void **ppd_iterator, unsigned *ppd_counter, sPacket *packet) {
+	tpacket_block_desc *desc = (tpacket_block_desc*)block->desc;
+	if(!desc || *ppd_counter >= desc->hdr.bh1.num_pkts) {
+		return(false);
+	}
+	tpacket3_hdr *ppd = (tpacket3_hdr*)*ppd_iterator;
+	if(!ppd) {
+		ppd = (tpacket3_hdr*)((u_char*)desc + desc->hdr.bh1.offset_to_first_pkt);
+	} else {
+		ppd = (tpacket3_hdr*)((u_char*)ppd + ppd->tp_next_offset);
+	}
+	*ppd_iterator = ppd;
+	++*ppd_counter;
+	packet->data = (u_char*)ppd + ppd->tp_mac;
+	packet->caplen = ppd->tp_snaplen;
+	packet->len = ppd->tp_len;
+	packet->ts_sec = ppd->tp_sec;
+	packet->ts_usec = ppd->tp_nsec / 1000;
+	packet->vlan_valid = (ppd->tp_status & TP_STATUS_VLAN_VALID) && ppd->hv1.tp_vlan_tci;
+	packet->vlan_tci = ppd->hv1.tp_vlan_tci;
+	#ifdef TP_STATUS_VLAN_TPID_VALID
+	packet->vlan_tpid = (ppd->tp_status & TP_STATUS_VLAN_TPID_VALID) && ppd->hv1.tp_vlan_tpid ?
+			     ppd->hv1.tp_vlan_tpid : 0x8100;
+	#else
+	packet->vlan_tpid = 0x8100;
+	#endif
+	return(true);
+}
+
+void cAfPacketRing::updateStat() {
+	if(fd < 0) {
+		return;
+	}
+	// PACKET_STATISTICS resets kernel counters - accumulate
+	tpacket_stats_v3 kstat;
+	socklen_t len = sizeof(kstat);
+	__SYNC_LOCK(_sync_stat);
+	if(getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &kstat, &len) == 0) {
+		stat.packets += kstat.tp_packets;
+		stat.drops += kstat.tp_drops;
+		stat.freeze_q += kstat.tp_freeze_q_cnt;
+	}
+	__SYNC_UNLOCK(_sync_stat);
+}
+
+#else //AFPACKET_TPACKET_V3
+
+cAfPacketRing::cAfPacketRing(const char *interfaceName, int fanoutGroupId) {
+	this->interfaceName = interfaceName;
+	this->fanoutGroupId = fanoutGroupId;
+	fd = -1;
+	ring = NULL;
+	ringSize = 0;
+	blockSize = 0;
+	blocksCount = 0;
+	blockIndex = 0;
+	reserve = 0;
+	dlt = DLT_EN10MB;
+	_sync_stat = 0;
+	heldBlocks = 0;
+	heldFlags = NULL;
+	_sync_held = 0;
+	destroyed = false;
+}
+
+cAfPacketRing::~cAfPacketRing() {
+}
+
+bool cAfPacketRing::open(unsigned /*snaplen*/, bool /*promisc*/, u_int64_t /*ringSize*/, unsigned /*blockSize*/, unsigned /*reserve*/, string *error) {
+	if(error) {
+		*error = "afpacket - TPACKET_V3 is not supported on this platform";
+	}
+	return(false);
+}
+
+void cAfPacketRing::close() {
+}
+
+void cAfPacketRing::destroy(cAfPacketRing *ring) {
+	delete ring;
+}
+
+bool cAfPacketRing::setFilter(void */*bpf_insns*/, unsigned /*bpf_len*/, string */*error*/) {
+	return(false);
+}
+
+bool cAfPacketRing::getBlock(sBlock */*block*/, int /*timeout_ms*/) {
+	return(false);
+}
+
+void cAfPacketRing::releaseBlock(sBlock */*block*/) {
+}
+
+void cAfPacketRing::holdBlock(sBlock */*block*/) {
+}
+
+void cAfPacketRing::releaseHeldBlock(void */*ring*/, void */*desc*/) {
+}
+
+unsigned cAfPacketRing::getBlockPacketsCount(sBlock */*block*/) {
+	return(0);
+}
+
+bool cAfPacketRing::nextPacket(sBlock */*block*/, void **/*ppd_iterator*/, unsigned */*ppd_counter*/, sPacket */*packet*/) {
+	return(false);
+}
+
+void cAfPacketRing::updateStat() {
+}
+
+#endif //AFPACKET_TPACKET_V3
+
+int cAfPacketRing::getFanoutGroupId(const char *interfaceName) {
+	unsigned ifindex = if_nametoindex(interfaceName);
+	return((getpid() + ifindex * 0x100) & 0xFFFF);
+}
+
+
+bool afpacket_interface_parse(const char *config, vector<sAfPacketInterface> *interfaces) {
+	interfaces->clear();
+	if(!config || !*config) {
+		return(false);
+	}
+	vector<string> items = split(config, split(",|;| |\t", "|"), true);
+	for(unsigned i = 0; i < items.size(); i++) {
+		if(items[i].empty()) {
+			continue;
+		}
+		sAfPacketInterface iface;
+		size_t pos = items[i].find(':');
+		if(pos != string::npos) {
+			iface.interface = items[i].substr(0, pos);
+			int threads = atoi(items[i].c_str() + pos + 1);
+			iface.threads = threads > 0 ? min(threads, 16) : 1;
+		} else {
+			iface.interface = items[i];
+		}
+		interfaces->push_back(iface);
+	}
+	return(interfaces->size() > 0);
+}
+
+bool afpacket_interface_is(const char *interface, unsigned *threads) {
+	static vector<sAfPacketInterface> interfaces;
+	static volatile int interfaces_parsed = 0;
+	static volatile int _sync = 0;
+	if(!interfaces_parsed) {
+		__SYNC_LOCK(_sync);
+		if(!interfaces_parsed) {
+			afpacket_interface_parse(opt_pcap_queue_afpacket_interfaces.c_str(), &interfaces);
+			interfaces_parsed = 1;
+		}
+		__SYNC_UNLOCK(_sync);
+	}
+	for(unsigned i = 0; i < interfaces.size(); i++) {
+		if(interfaces[i].interface == interface) {
+			if(threads) {
+				*threads = interfaces[i].threads;
+			}
+			return(true);
+		}
+	}
+	return(false);
+}
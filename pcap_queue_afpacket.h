@@ -0,0 +1,132 @@
+#ifndef PCAP_QUEUE_AFPACKET_H
+#define PCAP_QUEUE_AFPACKET_H
+
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#ifndef FREEBSD
+#include <linux/if_packet.h>
+#ifdef TPACKET3_HDRLEN
+#define AFPACKET_TPACKET_V3 1
+#endif
+#endif
+
+#include "tools_define.h"
+#include "sync_wait.h"
+
+
+using namespace std;
+
+
+/*
+ * Native AF_PACKET capture (TPACKET_V3 rx ring with PACKET_FANOUT).
+ * One cAfPacketRing == one socket with own mmaped ring; several rings with the same
+ * fanout group id share one interface (PACKET_FANOUT_HASH - packets of one flow
+ * are always delivered to the same ring).
+ */
+class cAfPacketRing {
+public:
+	struct sBlock {
+		sBlock() {
+			desc = NULL;
+			index = 0;
+		}
+		void *desc;
+		unsigned index;
+	};
+	struct sPacket {
+		u_char *data;
+		u_int32_t caplen;
+		u_int32_t len;
+		u_int32_t ts_sec;
+		u_int32_t ts_usec;
+		u_int16_t vlan_tci;
+		u_int16_t vlan_tpid;
+		bool vlan_valid;
+	};
+	struct sStat {
+		sStat() {
+			packets = 0;
+			drops = 0;
+			freeze_q = 0;
+		}
+		u_int64_t packets;
+		u_int64_t drops;
+		u_int64_t freeze_q;
+	};
+public:
+	cAfPacketRing(const char *interfaceName, int fanoutGroupId = -1);
+	~cAfPacketRing();
+	bool open(unsigned snaplen, bool promisc, u_int64_t ringSize, unsigned blockSize, unsigned reserve, string *error);
+	void close();
+	static void destroy(cAfPacketRing *ring);
+	bool setFilter(void *bpf_insns, unsigned bpf_len, string *error);
+	bool getBlock(sBlock *block, int timeout_ms);
+	void releaseBlock(sBlock *block);
+	void holdBlock(sBlock *block);
+	static void releaseHeldBlock(void *ring, void *desc);
+	unsigned getHeldBlocks() {
+		return(heldBlocks);
+	}
+	u_char *getBlockBase(sBlock *block) {
+		return((u_char*)block->desc);
+	}
+	bool nextPacket(sBlock *block, void **ppd_iterator, unsigned *ppd_counter, sPacket *packet);
+	unsigned getBlockPacketsCount(sBlock *block);
+	void updateStat();
+	sStat getStat() {
+		updateStat();
+		return(stat);
+	}
+	int getDlt() {
+		return(dlt);
+	}
+	unsigned getBlockSize() {
+		return(blockSize);
+	}
+	unsigned getBlocksCount() {
+		return(blocksCount);
+	}
+	unsigned getReserve() {
+		return(reserve);
+	}
+	string getInterfaceName() {
+		return(interfaceName);
+	}
+	static int getFanoutGroupId(const char *interfaceName);
+private:
+	string interfaceName;
+	int fanoutGroupId;
+	int fd;
+	u_char *ring;
+	size_t ringSize;
+	unsigned blockSize;
+	unsigned blocksCount;
+	unsigned blockIndex;
+	unsigned reserve;
+	int dlt;
+	sStat stat;
+	volatile int _sync_stat;
+	volatile unsigned heldBlocks;
+	volatile int *heldFlags;
+	volatile int _sync_held;
+	bool destroyed;
+	cSyncWait heldWait;
+};
+
+
+struct sAfPacketInterface {
+	sAfPacketInterface() {
+		threads = 1;
+	}
+	string interface;
+	unsigned threads;
+};
+
+bool afpacket_interface_parse(const char *config, vector<sAfPacketInterface> *interfaces);
+bool afpacket_interface_is(const char *interface, unsigned *threads = NULL);
+
+
+#endif //PCAP_QUEUE_AFPACKET_H
@@ -148,7 +148,8 @@ struct pcap_block_store {
 	enum compress_method {
 		compress_method_default,
 		snappy,
-		lz4
+		lz4,
+		zstd
 	};
 	struct pcap_pkthdr_pcap {
 		pcap_pkthdr_pcap() {
@@ -200,6 +201,9 @@ struct pcap_block_store {
 		this->hm = hm;
 		this->offsets = NULL;
 		this->block = NULL;
+		this->block_release = NULL;
+		this->block_release_owner = NULL;
+		this->block_release_data = NULL;
 		this->is_voip = NULL;
 		#if DEBUG_SYNC_PCAP_BLOCK_STORE
 		this->_sync_packets_lock = NULL;
@@ -221,6 +225,25 @@ struct pcap_block_store {
 	}
 	inline bool add_hp(pcap_pkthdr_plus *header, u_char *packet, int memcpy_packet_size = 0);
 	inline void inc_h(pcap_pkthdr_plus2 *header);
+	inline void add_h_external(uint32_t offset, pcap_pkthdr_plus2 *header);
+	void setExternalBlock(u_char *block, void (*release)(void *owner, void *data), void *release_owner, void *release_data) {
+		this->block = block;
+		this->block_release = release;
+		this->block_release_owner = release_owner;
+		this->block_release_data = release_data;
+	}
+	bool isExternalBlock() {
+		return(this->block_release != NULL);
+	}
+	void deleteBlock() {
+		if(this->block_release) {
+			this->block_release(this->block_release_owner, this->block_release_data);
+			this->block_release = NULL;
+		} else if(this->block) {
+			delete [] this->block;
+		}
+		this->block = NULL;
+	}
 	inline bool get_add_hp_pointers(pcap_pkthdr_plus2 **header, u_char **packet, unsigned min_size_for_packet);
 	inline bool isFull_checkTimeout();
 	inline bool isTimeout();
@@ -264,16 +287,18 @@ struct pcap_block_store {
 		       sizeof(uint32_t) * offsets_size + 
 		       sizeof(*this));
 	}
-	u_char *getSaveBuffer(uint32_t block_counter = 0);
+	u_char *getSaveBuffer(uint32_t block_counter = 0, u_char *saveBuffer = NULL);
 	void restoreFromSaveBuffer(u_char *saveBuffer);
 	int addRestoreChunk(u_char *buffer, size_t size, size_t *offset = NULL, bool restoreFromStore = false, string *error = NULL);
 	string addRestoreChunk_getErrorString(int errorCode);
 	inline bool compress();
 	bool compress_snappy();
 	bool compress_lz4();
+	bool compress_zstd();
 	inline bool uncompress(compress_method method = compress_method_default);
 	bool uncompress_snappy();
 	bool uncompress_lz4();
+	bool uncompress_zstd();
 	bool check_offsets() {
 		for(size_t i = 0; i < this->offsets_size - 1; i++) {
 			if(this->offsets[i] >= this->offsets[i + 1]) {
@@ -377,6 +402,9 @@ struct pcap_block_store {
 	header_mode hm;
 	uint32_t *offsets;
 	u_char *block;
+	void (*block_release)(void *owner, void *data); // block is not owned (e.g. afpacket ring) - release instead of delete
+	void *block_release_owner;
+	void *block_release_data;
 	size_t size;
 	size_t size_compress;
 	size_t size_packets;
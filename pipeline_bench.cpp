@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <syslog.h>
+#include <sys/resource.h>
+
+#include "pipeline_bench.h"
+#include "tools.h"
+#include "sniff.h"
+#include "sniff_proc_class.h"
+#include "pcap_queue.h"
+
+
+extern PreProcessPacket *preProcessPacket[PreProcessPacket::ppt_end_base];
+extern PreProcessPacket *preProcessPacketCallX[];
+extern ProcessRtpPacket *processRtpPacketHash;
+extern ProcessRtpPacket *processRtpPacketDistribute[MAX_PROCESS_RTP_PACKET_THREADS];
+extern rtp_read_thread *rtp_threads;
+extern volatile int num_threads_active;
+
+cPipelineBench *pipelineBench;
+
+
+cPipelineBench::cPipelineBench(const char *outputFileName, unsigned samplePeriodMs) {
+	this->outputFileName = outputFileName;
+	this->samplePeriodMs = samplePeriodMs;
+	sampleThread = 0;
+	terminating = false;
+	start_ms = 0;
+	stop_ms = 0;
+	cdr_counter = 0;
+	sql_queries_counter = 0;
+	_sync = 0;
+}
+
+cPipelineBench::~cPipelineBench() {
+	if(sampleThread) {
+		terminating = true;
+		pthread_join(sampleThread, NULL);
+	}
+	for(vector<sStage*>::iterator iter = stages.begin(); iter != stages.end(); iter++) {
+		delete *iter;
+	}
+}
+
+void cPipelineBench::start() {
+	start_ms = getTimeMS();
+	vm_pthread_create("pipeline bench",
+			  &sampleThread, NULL, sampleThreadFunction, this, __FILE__, __LINE__);
+}
+
+void cPipelineBench::stop() {
+	if(sampleThread) {
+		terminating = true;
+		pthread_join(sampleThread, NULL);
+		sampleThread = 0;
+	}
+	stop_ms = getTimeMS();
+	sample();
+	string json = getJson();
+	if(outputFileName.empty() || outputFileName == "-") {
+		printf("%s\n", json.c_str());
+		return;
+	}
+	FILE *file = fopen(outputFileName.c_str(), "w");
+	if(file) {
+		fprintf(file, "%s\n", json.c_str());
+		fclose(file);
+		syslog(LOG_NOTICE, "pipeline bench result saved to %s", outputFileName.c_str());
+	} else {
+		syslog(LOG_ERR, "pipeline bench: failed to open output file %s", outputFileName.c_str());
+	}
+}
+
+void cPipelineBench::sample() {
+	u_int64_t time_ms = getTimeMS();
+	__SYNC_LOCK(_sync);
+	sampleStage("packetbuffer", getPacketbufferSumPacketsCounterIn(), -1, time_ms);
+	for(int i = 0; i < PreProcessPacket::ppt_end_base; i++) {
+		if(preProcessPacket[i]) {
+			sampleStage(("pp_" + preProcessPacket[i]->getNameTypeThread()).c_str(),
+				    preProcessPacket[i]->getProcessedPacketsCounter(),
+				    preProcessPacket[i]->getQringFillingPerc(),
+				    time_ms);
+		}
+	}
+	for(int i = 0; i < preProcessPacketCallX_count; i++) {
+		if(preProcessPacketCallX[i]) {
+			sampleStage(("pp_" + preProcessPacketCallX[i]->getNameTypeThread() + "_" + intToString(i)).c_str(),
+				    preProcessPacketCallX[i]->getProcessedPacketsCounter(),
+				    preProcessPacketCallX[i]->getQringFillingPerc(),
+				    time_ms);
+		}
+	}
+	if(processRtpPacketHash) {
+		sampleStage("rtp_hash",
+			    processRtpPacketHash->getProcessedPacketsCounter(),
+			    processRtpPacketHash->getQringFillingPerc(),
+			    time_ms);
+	}
+	for(int i = 0; i < MAX_PROCESS_RTP_PACKET_THREADS; i++) {
+		if(processRtpPacketDistribute[i]) {
+			sampleStage(("rtp_distribute_" + intToString(i)).c_str(),
+				    processRtpPacketDistribute[i]->getProcessedPacketsCounter(),
+				    processRtpPacketDistribute[i]->getQringFillingPerc(),
+				    time_ms);
+		}
+	}
+	if(rtp_threads) {
+		for(int i = 0; i < num_threads_active; i++) {
+			if(rtp_threads[i].threadId) {
+				sampleStage(("rtp_read_" + intToString(i)).c_str(),
+					    rtp_threads[i].processed_packets_counter,
+					    rtp_threads[i].getQringFillingPerc(),
+					    time_ms);
+			}
+		}
+	}
+	sampleStage("cdr_store", cdr_counter, -1, time_ms);
+	sampleStage("sql_null_sink", sql_queries_counter, -1, time_ms);
+	__SYNC_UNLOCK(_sync);
+}
+
+void cPipelineBench::sampleStage(const char *name, u_int64_t packets, double qringFillingPerc, u_int64_t time_ms) {
+	sStage *stage;
+	map<string, sStage*>::iterator iter = stages_map.find(name);
+	if(iter != stages_map.end()) {
+		stage = iter->second;
+	} else {
+		stage = new FILE_LINE(0) sStage;
+		stage->name = name;
+		stages.push_back(stage);
+		stages_map[name] = stage;
+	}
+	// the active interval of stage - from the first to the last sample with changed counter
+	if(packets != stage->packets) {
+		if(!stage->time_first_ms) {
+			stage->time_first_ms = time_ms - samplePeriodMs;
+		}
+		stage->time_last_ms = time_ms;
+		stage->packets = packets;
+	}
+	if(qringFillingPerc >= 0) {
+		stage->qring_filling_sum += qringFillingPerc;
+		if(qringFillingPerc > stage->qring_filling_max) {
+			stage->qring_filling_max = qringFillingPerc;
+		}
+		++stage->qring_filling_samples;
+	}
+}
+
+string cPipelineBench::getJson() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	JsonExport json;
+	json.add("duration_ms", (int64_t)((stop_ms ? stop_ms : getTimeMS()) - start_ms));
+	json.add("sample_period_ms", (int64_t)samplePeriodMs);
+	json.add("peak_rss_kb", (int64_t)usage.ru_maxrss);
+	JsonExport *json_stages = json.addArray("stages");
+	__SYNC_LOCK(_sync);
+	for(vector<sStage*>::iterator iter = stages.begin(); iter != stages.end(); iter++) {
+		sStage *stage = *iter;
+		JsonExport *json_stage = json_stages->addObject("");
+		json_stage->add("name", stage->name);
+		json_stage->add("packets", (int64_t)stage->packets);
+		u_int64_t packets = stage->packets;
+		u_int64_t time_ms = stage->time_last_ms > stage->time_first_ms ? stage->time_last_ms - stage->time_first_ms : 0;
+		json_stage->add("active_ms", (int64_t)time_ms);
+		if(packets && time_ms) {
+			json_stage->add("packets_per_s", floatToString((double)packets / time_ms * 1000, 1, false), JsonExport::_number);
+			json_stage->add("ns_per_packet", floatToString((double)time_ms * 1000000 / packets, 1, false), JsonExport::_number);
+		} else {
+			json_stage->add("packets_per_s");
+			json_stage->add("ns_per_packet");
+		}
+		if(stage->qring_filling_samples) {
+			json_stage->add("qring_filling_avg_perc", floatToString(stage->qring_filling_sum / stage->qring_filling_samples, 1, false), JsonExport::_number);
+			json_stage->add("qring_filling_max_perc", floatToString(stage->qring_filling_max, 1, false), JsonExport::_number);
+		}
+	}
+	__SYNC_UNLOCK(_sync);
+	return(json.getJson());
+}
+
+void *cPipelineBench::sampleThreadFunction(void *arg) {
+	cPipelineBench *bench = (cPipelineBench*)arg;
+	while(!bench->terminating) {
+		bench->sample();
+		USLEEP(bench->samplePeriodMs * 1000);
+	}
+	return(NULL);
+}
@@ -0,0 +1,75 @@
+#ifndef PIPELINE_BENCH_H
+#define PIPELINE_BENCH_H
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include <pthread.h>
+#include <sys/types.h>
+
+
+using namespace std;
+
+
+/*
+ * Benchmark of whole packet pipeline (--pipeline-bench=<output json file>, usually with -r pb:<file>).
+ * Sampling thread reads packet counters and qring filling of every stage - packetbuffer input,
+ * PreProcessPacket (ppt_*), ProcessRtpPacket (hash / distribute), rtp_read_thread - and counters of stored cdr
+ * and sql queries. Sql queries are dropped in MySqlStore::query_lock (null sink) while bench is active.
+ * At the end json with packets/s, ns/packet, qring filling per stage and peak rss is written.
+ */
+class cPipelineBench {
+public:
+	struct sStage {
+		sStage() {
+			packets = 0;
+			time_first_ms = 0;
+			time_last_ms = 0;
+			qring_filling_sum = 0;
+			qring_filling_max = 0;
+			qring_filling_samples = 0;
+		}
+		string name;
+		u_int64_t packets;
+		u_int64_t time_first_ms;
+		u_int64_t time_last_ms;
+		double qring_filling_sum;
+		double qring_filling_max;
+		unsigned qring_filling_samples;
+	};
+public:
+	cPipelineBench(const char *outputFileName, unsigned samplePeriodMs = 100);
+	~cPipelineBench();
+	void start();
+	void stop();
+	inline void addCdr() {
+		__sync_add_and_fetch(&cdr_counter, 1);
+	}
+	inline void addSqlQueries(unsigned count) {
+		__sync_add_and_fetch(&sql_queries_counter, count);
+	}
+	string getJson();
+private:
+	void sample();
+	void sampleStage(const char *name, u_int64_t packets, double qringFillingPerc, u_int64_t time_ms);
+	static void *sampleThreadFunction(void *arg);
+private:
+	string outputFileName;
+	unsigned samplePeriodMs;
+	pthread_t sampleThread;
+	volatile bool terminating;
+	u_int64_t start_ms;
+	u_int64_t stop_ms;
+	vector<sStage*> stages;
+	map<string, sStage*> stages_map;
+	volatile u_int64_t cdr_counter;
+	volatile u_int64_t sql_queries_counter;
+	volatile int _sync;
+};
+
+
+extern cPipelineBench *pipelineBench;
+
+
+#endif //PIPELINE_BENCH_H
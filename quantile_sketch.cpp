@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <math.h>
+
+#include "quantile_sketch.h"
+
+
+cQuantileSketch::cQuantileSketch(unsigned compression) {
+	this->compression = compression;
+	count = 0;
+	min = 0;
+	max = 0;
+}
+
+void cQuantileSketch::add(double value, u_int32_t count) {
+	if(!count) {
+		return;
+	}
+	if(!this->count || value < min) {
+		min = value;
+	}
+	if(!this->count || value > max) {
+		max = value;
+	}
+	this->count += count;
+	if(!compression) {
+		exact[value] += count;
+		return;
+	}
+	buffer.push_back(sCentroid(value, count));
+	if(buffer.size() >= ::max((size_t)QUANTILE_SKETCH_BUFFER_MIN, (size_t)compression * 4)) {
+		compress();
+	}
+}
+
+void cQuantileSketch::merge(cQuantileSketch *other) {
+	other->compress();
+	if(!other->count) {
+		return;
+	}
+	if(!count || other->min < min) {
+		min = other->min;
+	}
+	if(!count || other->max > max) {
+		max = other->max;
+	}
+	count += other->count;
+	if(!compression) {
+		for(map<double, u_int64_t>::iterator iter = other->exact.begin(); iter != other->exact.end(); iter++) {
+			exact[iter->first] += iter->second;
+		}
+		for(unsigned i = 0; i < other->centroids.size(); i++) {
+			exact[other->centroids[i].mean] += other->centroids[i].count;
+		}
+		return;
+	}
+	for(map<double, u_int64_t>::iterator iter = other->exact.begin(); iter != other->exact.end(); iter++) {
+		buffer.push_back(sCentroid(iter->first, iter->second));
+	}
+	buffer.insert(buffer.end(), other->centroids.begin(), other->centroids.end());
+	compress();
+}
+
+double cQuantileSketch::valueAtRank(u_int64_t rank) {
+	if(!compression) {
+		u_int64_t cumulCount = 0;
+		for(map<double, u_int64_t>::iterator iter = exact.begin(); iter != exact.end(); iter++) {
+			cumulCount += iter->second;
+			if(rank < cumulCount) {
+				return(iter->first);
+			}
+		}
+		return(exact.size() ? exact.rbegin()->first : 0);
+	}
+	compress();
+	if(!centroids.size()) {
+		return(0);
+	}
+	u_int64_t cumulCount = 0;
+	for(unsigned i = 0; i < centroids.size(); i++) {
+		if(rank < cumulCount + centroids[i].count) {
+			if(!centroids[i].mixed) {
+				return(centroids[i].mean);
+			}
+			// values of mixed centroid are expected uniformly between midpoints to the neighbours
+			double left = i > 0 ? (centroids[i - 1].mean + centroids[i].mean) / 2 : min;
+			double right = i < centroids.size() - 1 ? (centroids[i].mean + centroids[i + 1].mean) / 2 : max;
+			return(left + (right - left) * (rank - cumulCount + 0.5) / centroids[i].count);
+		}
+		cumulCount += centroids[i].count;
+	}
+	return(centroids.back().mean);
+}
+
+double cQuantileSketch::quantile(double q) {
+	if(!count) {
+		return(0);
+	}
+	return(valueAtRank(::min((u_int64_t)(count * q), count - 1)));
+}
+
+void cQuantileSketch::getCentroids(map<double, unsigned> *centroids) {
+	for(map<double, u_int64_t>::iterator iter = exact.begin(); iter != exact.end(); iter++) {
+		(*centroids)[iter->first] += iter->second;
+	}
+	compress();
+	for(unsigned i = 0; i < this->centroids.size(); i++) {
+		(*centroids)[this->centroids[i].mean] += this->centroids[i].count;
+	}
+}
+
+void cQuantileSketch::clear() {
+	centroids.clear();
+	buffer.clear();
+	exact.clear();
+	count = 0;
+	min = 0;
+	max = 0;
+}
+
+double cQuantileSketch::qLimitFrom(double q) {
+	double k = compression / (2 * M_PI) * asin(::min(1., ::max(-1., 2 * q - 1))) + 1;
+	if(k >= compression / 4.) {
+		return(1);
+	}
+	return((sin(k * 2 * M_PI / compression) + 1) / 2);
+}
+
+void cQuantileSketch::compress() {
+	if(!buffer.size()) {
+		return;
+	}
+	buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+	std::sort(buffer.begin(), buffer.end());
+	centroids.clear();
+	// different values are merged only if there are more of them than compression
+	bool mergeDifferent = false;
+	unsigned distinct = 0;
+	for(unsigned i = 0; i < buffer.size(); i++) {
+		if(!i || buffer[i].mean != buffer[i - 1].mean) {
+			if(++distinct > compression) {
+				mergeDifferent = true;
+				break;
+			}
+		}
+	}
+	// scale function k1: k(q) = compression / (2 * pi) * asin(2 * q - 1) - one centroid spans max 1 of k
+	double qFrom = 0;
+	double qLimit = mergeDifferent ? qLimitFrom(qFrom) : 0;
+	sCentroid act = buffer[0];
+	for(unsigned i = 1; i < buffer.size(); i++) {
+		sCentroid *next = &buffer[i];
+		bool doMerge = false;
+		if(next->mean == act.mean) {
+			doMerge = true;
+		} else if(mergeDifferent) {
+			doMerge = qFrom + (double)(act.count + next->count) / count <= qLimit;
+		}
+		if(doMerge) {
+			if(next->mean != act.mean) {
+				act.mean += (next->mean - act.mean) * next->count / (act.count + next->count);
+				act.mixed = true;
+			} else if(next->mixed) {
+				act.mixed = true;
+			}
+			act.count += next->count;
+		} else {
+			qFrom += (double)act.count / count;
+			if(mergeDifferent) {
+				qLimit = qLimitFrom(qFrom);
+			}
+			centroids.push_back(act);
+			act = *next;
+		}
+	}
+	centroids.push_back(act);
+	buffer.clear();
+	if(buffer.capacity() > ::max((size_t)QUANTILE_SKETCH_BUFFER_MIN, (size_t)compression * 4)) {
+		vector<sCentroid>().swap(buffer);
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+
+#include <map>
+#include <vector>
+#include <sys/types.h>
+
+
+using namespace std;
+
+
+#define QUANTILE_SKETCH_BUFFER_MIN 256
+
+
+/*
+ * Mergeable quantile sketch (merging t-digest) used by charts cache instead of the vector of all values.
+ * Values are kept in centroids (mean, count), adjacent centroids with the same value are always merged.
+ * While the count of distinct values is at most compression, centroids of different values are not merged
+ * and the sketch is exact (counts, integer metrics, small intervals). Above it, centroids are merged within
+ * the size limit given by the t-digest scale function k1 (small centroids near the tails, large ones near
+ * the median), so the memory is bounded by ~ compression centroids.
+ * Compression 0 keeps exact counts of distinct values in a map (memory bounded only by distinct values).
+ */
+class cQuantileSketch {
+public:
+	struct sCentroid {
+		sCentroid(double mean = 0, u_int32_t count = 0, bool mixed = false) {
+			this->mean = mean;
+			this->count = count;
+			this->mixed = mixed;
+		}
+		bool operator < (const sCentroid &other) const {
+			return(mean < other.mean);
+		}
+		double mean;
+		u_int32_t count;
+		bool mixed;
+	};
+public:
+	cQuantileSketch(unsigned compression = 0);
+	void add(double value, u_int32_t count = 1);
+	void merge(cQuantileSketch *other);
+	u_int64_t size() {
+		return(count);
+	}
+	double valueAtRank(u_int64_t rank);
+	double quantile(double q);
+	void getCentroids(map<double, unsigned> *centroids);
+	unsigned centroidsCount() {
+		if(!compression) {
+			return(exact.size());
+		}
+		compress();
+		return(centroids.size());
+	}
+	void clear();
+private:
+	void compress();
+	double qLimitFrom(double q);
+private:
+	unsigned compression;
+	vector<sCentroid> centroids;
+	vector<sCentroid> buffer;
+	map<double, u_int64_t> exact;
+	u_int64_t count;
+	double min;
+	double max;
+};
+
+
+#endif //QUANTILE_SKETCH_H
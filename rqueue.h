@@ -11,6 +11,7 @@
 #include "heap_safe.h"
 #include "sync.h"
 #include "tools_global.h"
+#include "sync_wait.h"
 
 
 typedef volatile int v_int;
@@ -36,12 +37,14 @@ public:
 		readit = 0;
 		writeit = 0;
 		_sync_lock = 0;
+		syncWait = false;
 	}
 	~rqueue_quick() {
 		delete [] buffer;
 		delete [] free;
 	}
 	bool push(typeItem *item, bool waitForFree, bool useLock = false) {
+		unsigned int usleepCounter = 0;
 		if(useLock) lock();
 		while(free[writeit] != 1) {
 			if(waitForFree) {
@@ -50,7 +53,11 @@ public:
 					return(false);
 				}
 				if(useLock) unlock();
-				USLEEP(pushUsleep);
+				if(syncWait) {
+					SYNC_WAIT(syncWaitPush, free[writeit], 0, pushUsleep, usleepCounter);
+				} else {
+					USLEEP(pushUsleep);
+				}
 				if(useLock) lock();
 			} else {
 				if(useLock) unlock();
@@ -73,10 +80,14 @@ public:
 				writeit++;
 			}
 		#endif
+		if(syncWait) {
+			syncWaitPop.wake();
+		}
 		if(useLock) unlock();
 		return(true);
 	}
 	bool pop(typeItem *item, bool waitForFree, bool useLock = false) {
+		unsigned int usleepCounter = 0;
 		if(useLock) lock();
 		while(free[readit] != 0) {
 			if(waitForFree) {
@@ -84,7 +95,11 @@ public:
 					if(useLock) unlock();
 					return(false);
 				}
-				USLEEP(popUsleep);
+				if(syncWait) {
+					SYNC_WAIT(syncWaitPop, free[readit], 1, popUsleep, usleepCounter);
+				} else {
+					USLEEP(popUsleep);
+				}
 			} else {
 				if(useLock) unlock();
 				return(false);
@@ -106,6 +121,9 @@ public:
 				readit++;
 			}
 		#endif
+		if(syncWait) {
+			syncWaitPush.wake();
+		}
 		if(useLock) unlock();
 		return(true);
 	}
@@ -125,6 +143,9 @@ public:
 				readit++;
 			}
 		#endif
+		if(syncWait) {
+			syncWaitPush.wake();
+		}
 		return(true);
 	}
 	bool get(typeItem *item) {
@@ -150,6 +171,9 @@ public:
 				readit++;
 			}
 		#endif
+		if(syncWait) {
+			syncWaitPush.wake();
+		}
 	}
 	void lock() {
 		__SYNC_LOCK(this->_sync_lock);
@@ -157,6 +181,11 @@ public:
 	void unlock() {
 		__SYNC_UNLOCK(this->_sync_lock);
 	}
+	void setSyncWait(const char *name) {
+		syncWaitPush.setName(string(name) + " push");
+		syncWaitPop.setName(string(name) + " pop");
+		syncWait = true;
+	}
 	size_t size() {
 		u_int32_t _writeit = writeit;
 		u_int32_t _readit = readit;
@@ -173,6 +202,9 @@ private:
 	v_u_int32_t readit;
 	v_u_int32_t writeit;
 	volatile int _sync_lock;
+	bool syncWait;
+	cSyncWait syncWaitPush;
+	cSyncWait syncWaitPop;
 };
 
 
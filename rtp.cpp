@@ -669,8 +669,304 @@ RTP::jt_tail(struct pcap_pkthdr *header) {
 /* simulate jitterbuffer */
 void
 RTP::jitterbuffer(struct ast_channel *channel, bool save_audio, bool energylevels, bool mos_lqo) {
+	long double transit;
+	if(jitterbuffer_prepare_frame(save_audio, energylevels, mos_lqo, &transit)) {
+		jitterbuffer_channel(channel, save_audio, energylevels, mos_lqo, transit);
+	}
+}
+
+/* simulate fixed 1, fixed 2 and adaptive jitterbuffers (mos f1/f2/adapt) in one pass - the frame is prepared once
+ * and the timeline (last_ts, msdiff, big jump, manual marker, count of frames fetched every packetization) is kept
+ * once in the first channel; channels are fed from start by this function only, so separate jitterbuffer() per channel
+ * would compute the same timeline in each of them. Loss and burst statistics (loss[], last_loss_burst) stay
+ * in the jitterbuffer implementations (fixed / adaptive) of every channel.
+ * equivalence with separate jitterbuffer() per channel is checked by jitterbuffer_mos_test (--jitterbuffer-mos-test) */
+void
+RTP::jitterbuffer_mos() {
+	struct ast_channel *channels[3];
+	unsigned channels_count = 0;
+	if(opt_jitterbuffer_f1) {
+		channels[channels_count++] = channel_fix1;
+	}
+	if(opt_jitterbuffer_f2) {
+		channels[channels_count++] = channel_fix2;
+	}
+	if(opt_jitterbuffer_adapt) {
+		channels[channels_count++] = channel_adapt;
+	}
+	long double transit;
+	if(!channels_count ||
+	   !jitterbuffer_prepare_frame(false, false, false, &transit)) {
+		return;
+	}
+	Call *owner = (Call*)call_owner;
+	char marker = frame->marker;
+	if(codec == PAYLOAD_G723 && ((unsigned char)payload_data[0] & 2) &&
+	   ast_test_flag(&channels[0]->jb, (1 << 2))) {
+		// SID packets are skipped after jitterbuffer is created (see jitterbuffer_channel)
+		return;
+	}
+	frame->datalen = 0;
+	frame->data = NULL;
+	struct ast_channel *timeline_channels[3];
+	unsigned timeline_channels_count = 0;
+	for(unsigned i = 0; i < channels_count; i++) {
+		struct ast_channel *channel = channels[i];
+		channel->codec = codec;
+		channel->rawstream = NULL;
+		ast_jb_do_usecheck(channel, &header_ts);
+		if(channel->jb.timebase.tv_sec == header_ts.tv_sec &&
+		   channel->jb.timebase.tv_usec == header_ts.tv_usec) {
+			channel->last_ts = header_ts;
+		}
+		if(!channel->jb_reseted) {
+			// initializing jitterbuffer 
+			ast_jb_empty_and_reset(channel);
+			channel->jb_reseted = 1;
+			channel->last_ts = header_ts;
+			ast_jb_put(channel, frame, &header_ts);
+			this->clearAudioBuff(owner, channel);
+			continue;
+		}
+		if(timeline_channels_count && 
+		   (channel->last_ts.tv_sec != timeline_channels[0]->last_ts.tv_sec ||
+		    channel->last_ts.tv_usec != timeline_channels[0]->last_ts.tv_usec)) {
+			// channel enabled later (reload) has its own timeline
+			frame->marker = marker;
+			jitterbuffer_channel(channel, false, false, false, transit);
+			continue;
+		}
+		timeline_channels[timeline_channels_count++] = channel;
+	}
+	if(!timeline_channels_count) {
+		return;
+	}
+	frame->marker = marker;
+	/* calculate time difference between last packet and current packet + packetization time*/ 
+	struct timeval last_ts = timeline_channels[0]->last_ts;
+	int msdiff = ast_tvdiff_ms( header_ts, ast_tvadd(last_ts, ast_samp2tv(packetization, 1000)) );
+	if(msdiff > packetization * 10000) {
+		// difference is too big, reseting last_ts to current packet
+		for(unsigned i = 0; i < timeline_channels_count; i++) {
+			timeline_channels[i]->last_ts = header_ts;
+			ast_jb_put(timeline_channels[i], frame, &header_ts);
+			this->clearAudioBuff(owner, timeline_channels[i]);
+		}
+		if(verbosity > 4) syslog(LOG_ERR, "big timestamp jump (msdiff:%d packetization: %d) in this file: %s\n", msdiff, packetization, gfilename);
+		return;
+	}
+	// silence - manually mark the frame (see jitterbuffer_channel)
+	u_int32_t sequencems = (frame->seqno - last_seq) * packetization;
+	if( msdiff > 1000 and (transit <= (sequencems + 200)) ) {
+		if(lastcng or (lastframetype == AST_FRAME_DTMF)) {
+			if(verbosity > 4) printf("jitterbuffer: manually marking packet, msdiff(%d) > 1000 and transit (%Lf) <= ((sequencems(%u) + 200)\n", msdiff, transit, sequencems);
+			frame->marker = 1;
+		}
+	}
+	// count of frames fetched every packetization regardless on packet loss or delay
+	unsigned fetch_count = msdiff >= packetization ? (msdiff - packetization) / packetization + 1 : 0;
+	bool reset_loss_burst = frame->marker or lastframetype == AST_FRAME_DTMF;
+	for(unsigned i = 0; i < timeline_channels_count; i++) {
+		struct ast_channel *channel = timeline_channels[i];
+		for(unsigned j = 0; j < fetch_count; j++) {
+			if(reset_loss_burst) {
+				/* if last frame was marked or DTMF, ignore interpolated frames */
+				channel->last_loss_burst = 0;
+			}
+			ast_jb_get_and_deliver(channel, &channel->last_ts);
+			channel->last_ts = ast_tvadd(channel->last_ts, ast_samp2tv(frame->len, 1000));
+		}
+		ast_jb_put(channel, frame, &header_ts);
+		this->clearAudioBuff(owner, channel);
+	}
+}
+
+/* feeds the same synthetic streams (jitter with bursts, loss, reordering, silence gaps, g729 cng) to two RTP
+ * objects - one by separate jitterbuffer() per mos channel, the other by jitterbuffer_mos - and compares
+ * mos f1/f2/adapt of every 10s interval and of whole stream; time of both variants is printed */
+bool
+RTP::jitterbuffer_mos_test(unsigned packets) {
+	struct sStream {
+		const char *name;
+		int codec;
+		int payload_len;
+		int cng_payload_len;
+	} streams[] = {
+		{ "pcma", PAYLOAD_PCMA, 160, 0 },
+		{ "g729 with cng", PAYLOAD_G729, 20, 2 }
+	};
+	struct sPacket {
+		u_int16_t seq;
+		u_int32_t timestamp;
+		u_int64_t send_us;
+		bool marker;
+		bool cng;
+	};
+	int _opt_jitterbuffer_f1 = opt_jitterbuffer_f1;
+	int _opt_jitterbuffer_f2 = opt_jitterbuffer_f2;
+	int _opt_jitterbuffer_adapt = opt_jitterbuffer_adapt;
+	opt_jitterbuffer_f1 = opt_jitterbuffer_f2 = opt_jitterbuffer_adapt = 1;
+	bool rslt = true;
+	for(unsigned stream_i = 0; stream_i < sizeof(streams) / sizeof(streams[0]); stream_i++) {
+		sStream *stream = &streams[stream_i];
+		u_int32_t rnd = 1;
+		#define JB_TEST_RAND() (rnd = rnd * 1103515245 + 12345, (rnd >> 16) & 0x7FFF)
+		vector<sPacket> stream_packets;
+		u_int16_t seq = 1000;
+		u_int32_t timestamp = 0;
+		u_int64_t send_us = 1600000000ull * 1000000;
+		for(unsigned i = 0; i < packets; i++) {
+			sPacket packet;
+			packet.marker = false;
+			packet.cng = stream->cng_payload_len && (i % 1500) >= 1400;
+			if(i && !(i % 1500)) {
+				// silence gap 2s
+				timestamp += 16000;
+				send_us += 2000000;
+				packet.marker = true;
+			}
+			packet.seq = seq++;
+			packet.timestamp = timestamp;
+			packet.send_us = send_us;
+			timestamp += 160;
+			send_us += 20000;
+			if(JB_TEST_RAND() % 100 < 2) {
+				// loss
+				continue;
+			}
+			stream_packets.push_back(packet);
+		}
+		u_int64_t arrival_us = 0;
+		for(unsigned i = 0; i < stream_packets.size(); i++) {
+			if(i + 1 < stream_packets.size() && JB_TEST_RAND() % 100 < 1) {
+				// reordering
+				sPacket packet = stream_packets[i];
+				stream_packets[i] = stream_packets[i + 1];
+				stream_packets[i + 1] = packet;
+			}
+			u_int64_t jitter_us = JB_TEST_RAND() % ((i % 500) < 50 ? 300 : 60) * 1000;
+			arrival_us = max(arrival_us + 100, stream_packets[i].send_us + jitter_us);
+			stream_packets[i].send_us = arrival_us;
+		}
+		#undef JB_TEST_RAND
+		RTP *rtp[2];
+		for(unsigned rtp_i = 0; rtp_i < 2; rtp_i++) {
+			rtp[rtp_i] = new FILE_LINE(0) RTP(0, vmIP());
+			rtp[rtp_i]->codec = rtp[rtp_i]->first_codec = stream->codec;
+			rtp[rtp_i]->iscaller = 1;
+			rtp[rtp_i]->ignore = 0;
+			rtp[rtp_i]->channel_fix1->packetization = rtp[rtp_i]->channel_fix2->packetization = 
+				rtp[rtp_i]->channel_adapt->packetization = rtp[rtp_i]->channel_record->packetization = 
+				rtp[rtp_i]->packetization = 20;
+		}
+		u_char packet_buffer[sizeof(iphdr2) + sizeof(udphdr2) + sizeof(RTPFixedHeader) + 200];
+		memset(packet_buffer, 0, sizeof(packet_buffer));
+		iphdr2 *header_ip = (iphdr2*)packet_buffer;
+		header_ip->version = 4;
+		header_ip->_ihl = 5;
+		u_char *data = packet_buffer + sizeof(iphdr2) + sizeof(udphdr2);
+		RTPFixedHeader *header_rtp = (RTPFixedHeader*)data;
+		header_rtp->version = 2;
+		header_rtp->payload = stream->codec;
+		u_int64_t time_ns[2] = { 0, 0 };
+		unsigned intervals = 0;
+		unsigned differ = 0;
+		for(unsigned i = 0; i <= stream_packets.size(); i++) {
+			if(i < stream_packets.size()) {
+				sPacket *packet = &stream_packets[i];
+				int payload_len = packet->cng ? stream->cng_payload_len : stream->payload_len;
+				header_rtp->sequence = htons(packet->seq);
+				header_rtp->timestamp = htonl(packet->timestamp);
+				header_rtp->marker = packet->marker;
+				header_ip->set_tot_len(sizeof(iphdr2) + sizeof(udphdr2) + sizeof(RTPFixedHeader) + payload_len);
+				for(unsigned rtp_i = 0; rtp_i < 2; rtp_i++) {
+					RTP *_rtp = rtp[rtp_i];
+					_rtp->data = data;
+					_rtp->len = sizeof(RTPFixedHeader) + payload_len;
+					_rtp->header_ip = header_ip;
+					_rtp->header_ts.tv_sec = packet->send_us / 1000000;
+					_rtp->header_ts.tv_usec = packet->send_us % 1000000;
+					_rtp->frame->frametype = AST_FRAME_VOICE;
+					_rtp->frame->lastframetype = (enum ast_frame_type)(_rtp->lastframetype);
+					++_rtp->stats.received;
+					u_int64_t start_ns = getTimeNS();
+					if(rtp_i == 0) {
+						_rtp->jitterbuffer(_rtp->channel_fix1, false, false, false);
+						_rtp->jitterbuffer(_rtp->channel_fix2, false, false, false);
+						_rtp->jitterbuffer(_rtp->channel_adapt, false, false, false);
+					} else {
+						_rtp->jitterbuffer_mos();
+					}
+					time_ns[rtp_i] += getTimeNS() - start_ns;
+					_rtp->lastframetype = _rtp->frame->frametype;
+					_rtp->lastcng = packet->cng;
+					_rtp->last_seq = packet->seq;
+					_rtp->s->lastTimeRecJ = _rtp->header_ts;
+					_rtp->s->lastTimeStampJ = packet->timestamp;
+				}
+			}
+			if((i && !(i % 500)) || i == stream_packets.size()) {
+				// 10s interval as in save_mos_graph, whole stream at the end
+				bool last = i == stream_packets.size();
+				int mos[2][3];
+				unsigned short int loss[2][3][128];
+				for(unsigned rtp_i = 0; rtp_i < 2; rtp_i++) {
+					for(int jittertype = 1; jittertype <= 3; jittertype++) {
+						mos[rtp_i][jittertype - 1] = calculate_mos_fromrtp(rtp[rtp_i], jittertype, last ? 0 : 1);
+					}
+					ast_channel *channels[3] = { rtp[rtp_i]->channel_fix1, rtp[rtp_i]->channel_fix2, rtp[rtp_i]->channel_adapt };
+					for(unsigned channel_i = 0; channel_i < 3; channel_i++) {
+						memcpy(loss[rtp_i][channel_i], channels[channel_i]->loss, sizeof(unsigned short int) * 128);
+						memcpy(channels[channel_i]->last_interval_loss, channels[channel_i]->loss, sizeof(unsigned short int) * 128);
+					}
+				}
+				++intervals;
+				if(memcmp(mos[0], mos[1], sizeof(mos[0])) ||
+				   memcmp(loss[0], loss[1], sizeof(loss[0]))) {
+					if(differ < 10) {
+						cout << "  differ in " << (last ? "whole stream" : ("interval " + intToString(intervals)))
+						     << ": f1/f2/adapt " << mos[0][0] << "/" << mos[0][1] << "/" << mos[0][2]
+						     << " vs " << mos[1][0] << "/" << mos[1][1] << "/" << mos[1][2] << endl;
+					}
+					++differ;
+				}
+				if(last) {
+					cout << stream->name << " (" << stream_packets.size() << " packets, " << intervals - 1 << " intervals)" << endl
+					     << "  mos f1/f2/adapt: " << mos[1][0] << "/" << mos[1][1] << "/" << mos[1][2] << endl
+					     << "  lost frames f1/f2/adapt: ";
+					for(unsigned channel_i = 0; channel_i < 3; channel_i++) {
+						unsigned lost = 0;
+						for(unsigned burst = 1; burst < 128; burst++) {
+							lost += burst * loss[1][channel_i][burst];
+						}
+						cout << (channel_i ? "/" : "") << lost;
+					}
+					cout << endl
+					     << "  jitterbuffer per channel: " << (double)time_ns[0] / stream_packets.size() << " ns/packet" << endl
+					     << "  jitterbuffer_mos: " << (double)time_ns[1] / stream_packets.size() << " ns/packet"
+					     << ", speedup " << (time_ns[1] ? (double)time_ns[0] / time_ns[1] : 0) << "x" << endl
+					     << "  differ " << differ << endl;
+				}
+			}
+		}
+		if(differ) {
+			rslt = false;
+		}
+		for(unsigned rtp_i = 0; rtp_i < 2; rtp_i++) {
+			delete rtp[rtp_i];
+		}
+	}
+	opt_jitterbuffer_f1 = _opt_jitterbuffer_f1;
+	opt_jitterbuffer_f2 = _opt_jitterbuffer_f2;
+	opt_jitterbuffer_adapt = _opt_jitterbuffer_adapt;
+	return(rslt);
+}
 
-	if(codec == PAYLOAD_TELEVENT) return;
+/* fill frame by current packet - common part for all simulated jitterbuffers */
+bool
+RTP::jitterbuffer_prepare_frame(bool save_audio, bool energylevels, bool mos_lqo, long double *transit) {
+
+	if(codec == PAYLOAD_TELEVENT) return(false);
 
 	Call *owner = (Call*)call_owner;
 	if((save_audio || energylevels) && owner && owner->silencerecording) {
@@ -679,7 +975,6 @@ RTP::jitterbuffer(struct ast_channel *channel, bool save_audio, bool energylevel
 	} else {
 		frame->skip = 0;
 	}
-	struct timeval tsdiff;
 	frame->len = packetization;
 	switch(codec) {
 		case PAYLOAD_VXOPUS12:
@@ -724,7 +1019,6 @@ RTP::jitterbuffer(struct ast_channel *channel, bool save_audio, bool energylevel
 	}
 	frame->marker = getMarker();
 	frame->seqno = getSeqNum();
-	channel->codec = codec;
 	frame->ignore = ignore;
 	memcpy(&frame->delivery, &header_ts, sizeof(struct timeval));
 
@@ -739,7 +1033,7 @@ RTP::jitterbuffer(struct ast_channel *channel, bool save_audio, bool energylevel
 			}
 		}
 		pinformed = 1;
-		return;
+		return(false);
 	} else {
 		pinformed = 0;
 	}
@@ -789,20 +1083,6 @@ RTP::jitterbuffer(struct ast_channel *channel, bool save_audio, bool energylevel
 		frame->data = payload_data;
 		frame->datalen = payload_len > 0 ? payload_len : 0; /* ensure that datalen is never negative */
 
-		if(codec == PAYLOAD_G723) {
-			// voipmonitor does not handle SID packets well (silence packets) it causes out of sync
-			if((unsigned char)payload_data[0] & 2)  {
-
-				/* check if jitterbuffer is already created. If not we have to create it because 
-				   if call starts with SID packets first it will than cause out of sync calls 
-				*/
-				if(ast_test_flag(&channel->jb, (1 << 2))) {
-					// jitterbuffer is created so we can skip SID packets now
-					return;
-				}
-			}
-		}
-
 		if(codec == PAYLOAD_G729 and (payload_len <= (packetization == 10 ? 9 : 12))) {
 			frame->frametype = AST_FRAME_DTMF;
 			frame->marker = 1;
@@ -817,6 +1097,37 @@ RTP::jitterbuffer(struct ast_channel *channel, bool save_audio, bool energylevel
 		frame->marker = 1;
 	}
 
+	/* difference (in ms) between timestamps in packet header and rtp timestamps. this should 
+	 * be ideally equal to zero. Negative values mean that packet arrives earlier and positive 
+	 * values indicates that packet was late 
+	 */
+	struct timeval tsdiff;
+	*transit = (timeval_subtract(&tsdiff, header_ts, s->lastTimeRecJ) ? -timeval2micro(tsdiff)/1000.0 : timeval2micro(tsdiff)/1000.0) - ((double)getTimestamp() - s->lastTimeStampJ)/(double)samplerate/1000;
+
+	return(true);
+}
+
+/* put prepared frame to jitterbuffer associated to channel */
+void
+RTP::jitterbuffer_channel(struct ast_channel *channel, bool save_audio, bool energylevels, bool mos_lqo, long double transit) {
+
+	Call *owner = (Call*)call_owner;
+	channel->codec = codec;
+
+	if(codec == PAYLOAD_G723) {
+		// voipmonitor does not handle SID packets well (silence packets) it causes out of sync
+		if((unsigned char)payload_data[0] & 2)  {
+
+			/* check if jitterbuffer is already created. If not we have to create it because 
+			   if call starts with SID packets first it will than cause out of sync calls 
+			*/
+			if(ast_test_flag(&channel->jb, (1 << 2))) {
+				// jitterbuffer is created so we can skip SID packets now
+				return;
+			}
+		}
+	}
+
 	if(save_audio || energylevels || mos_lqo) {
 		channel->rawstream = gfileRAW;
 		if(iscaller) {
@@ -877,12 +1188,6 @@ RTP::jitterbuffer(struct ast_channel *channel, bool save_audio, bool energylevel
 	// relative time difference calculated from packet sequence 
 	u_int32_t sequencems = (frame->seqno - last_seq) * packetization;
 
-	/* difference (in ms) between timestamps in packet header and rtp timestamps. this should 
-	 * be ideally equal to zero. Negative values mean that packet arrives earlier and positive 
-	 * values indicates that packet was late 
-	 */
-	long double transit = (timeval_subtract(&tsdiff, header_ts, s->lastTimeRecJ) ? -timeval2micro(tsdiff)/1000.0 : timeval2micro(tsdiff)/1000.0) - ((double)getTimestamp() - s->lastTimeStampJ)/(double)samplerate/1000;
-	
 	/* and now if there is bigger (lets say one second) timestamp difference (calculated from packet headers) 
 	 * between two last packets and transit time is equel or smaller than sequencems (with 200ms toleration), 
 	 * it was silence and manually mark the frame which indicates to not count interpolated frame and resynchronize jitterbuffer
@@ -1723,12 +2028,7 @@ RTP::read(unsigned char* data, iphdr2 *header_ip, unsigned *len, struct pcap_pkt
 
 				packetization_iterator = 10; // this will cause that packetization is estimated as final
 
-				if(opt_jitterbuffer_f1)
-					jitterbuffer(channel_fix1, false, false, false);
-				if(opt_jitterbuffer_f2)
-					jitterbuffer(channel_fix2, false, false, false);
-				if(opt_jitterbuffer_adapt)
-					jitterbuffer(channel_adapt, false, false, false);
+				jitterbuffer_mos();
 			} 
 
 		} 
@@ -1825,12 +2125,7 @@ RTP::read(unsigned char* data, iphdr2 *header_ip, unsigned *len, struct pcap_pkt
 				channel_fix1->packetization = channel_fix2->packetization = channel_adapt->packetization = channel_record->packetization = packetization;
 				if(verbosity > 3) printf("[%x] packetization:[%d]\n", getSSRC(), packetization);
 
-				if(opt_jitterbuffer_f1)
-					jitterbuffer(channel_fix1, false, false, false);
-				if(opt_jitterbuffer_f2)
-					jitterbuffer(channel_fix2, false, false, false);
-				if(opt_jitterbuffer_adapt)
-					jitterbuffer(channel_adapt, false, false, false);
+				jitterbuffer_mos();
 				if(use_channel_record) {
 					if(checkDuplChannelRecordSeq(seq)) {
 						jitterbuffer(channel_record, save_audio, energylevels, mos_lqo);
@@ -1975,12 +2270,7 @@ RTP::read(unsigned char* data, iphdr2 *header_ip, unsigned *len, struct pcap_pkt
 			channel_fix1->packetization = channel_fix2->packetization = channel_adapt->packetization = channel_record->packetization = packetization;
 		}
 		//printf("packetization [%d]\n", packetization);
-		if(opt_jitterbuffer_f1)
-			jitterbuffer(channel_fix1, false, false, false);
-		if(opt_jitterbuffer_f2)
-			jitterbuffer(channel_fix2, false, false, false);
-		if(opt_jitterbuffer_adapt)
-			jitterbuffer(channel_adapt, false, false, false);
+		jitterbuffer_mos();
 		if(use_channel_record) {
 			if(checkDuplChannelRecordSeq(seq)) {
 				jitterbuffer(channel_record, save_audio, energylevels, mos_lqo);
@@ -2913,6 +3203,9 @@ RTP::dump() {
 }
 
 void RTP::clearAudioBuff(Call *call, ast_channel *channel) {
+	if(!call) {
+		return;
+	}
 	if(iscaller) {
 		if(call->audioBufferData[0].audiobuffer) {
 			channel->audiobuf = NULL;
@@ -435,6 +435,10 @@ public:
 	 *
 	*/
 	void jitterbuffer(struct ast_channel *channel, bool save_audio, bool energylevels, bool mos_lqo);
+	void jitterbuffer_mos();
+	bool jitterbuffer_prepare_frame(bool save_audio, bool energylevels, bool mos_lqo, long double *transit);
+	void jitterbuffer_channel(struct ast_channel *channel, bool save_audio, bool energylevels, bool mos_lqo, long double transit);
+	static bool jitterbuffer_mos_test(unsigned packets);
 
 	void process_dtmf_rfc2833();
 
@@ -0,0 +1,111 @@
+#include <sstream>
+#include <iomanip>
+#include <sched.h>
+
+#include "rtp_hash_cache.h"
+#include "heap_safe.h"
+
+
+volatile u_int32_t cRtpHashCache::gen[RTP_HASH_CACHE_GEN_STRIPES];
+volatile u_int32_t cRtpHashCache::gen_all = 0;
+cRtpHashCache *cRtpHashCache::instances[RTP_HASH_CACHE_MAX_INSTANCES];
+volatile u_int32_t cRtpHashCache::epochs[RTP_HASH_CACHE_MAX_INSTANCES];
+volatile int cRtpHashCache::instances_sync = 0;
+
+
+cRtpHashCache::cRtpHashCache(unsigned size, volatile u_int32_t *epoch) {
+	this->size = 1;
+	while(this->size < size) {
+		this->size <<= 1;
+	}
+	items = new FILE_LINE(0) sRtpHashCacheItem[this->size];
+	for(unsigned i = 0; i < this->size; i++) {
+		items[i].used = false;
+	}
+	this->epoch = epoch;
+}
+
+cRtpHashCache::~cRtpHashCache() {
+	__SYNC_LOCK(instances_sync);
+	for(unsigned i = 0; i < RTP_HASH_CACHE_MAX_INSTANCES; i++) {
+		if(instances[i] == this) {
+			instances[i] = NULL;
+			break;
+		}
+	}
+	__SYNC_UNLOCK(instances_sync);
+	delete [] items;
+}
+
+cRtpHashCache *cRtpHashCache::create(unsigned size) {
+	cRtpHashCache *cache = NULL;
+	__SYNC_LOCK(instances_sync);
+	for(unsigned i = 0; i < RTP_HASH_CACHE_MAX_INSTANCES; i++) {
+		if(!instances[i]) {
+			// only registered instance is safe - sync() must see it
+			cache = new FILE_LINE(0) cRtpHashCache(size, &epochs[i]);
+			instances[i] = cache;
+			break;
+		}
+	}
+	__SYNC_UNLOCK(instances_sync);
+	return(cache);
+}
+
+void cRtpHashCache::sync() {
+	__sync_synchronize();
+	u_int32_t epochs_snapshot[RTP_HASH_CACHE_MAX_INSTANCES];
+	for(unsigned i = 0; i < RTP_HASH_CACHE_MAX_INSTANCES; i++) {
+		epochs_snapshot[i] = epochs[i];
+	}
+	for(unsigned i = 0; i < RTP_HASH_CACHE_MAX_INSTANCES; i++) {
+		if(epochs_snapshot[i] & 1) {
+			// lookup in progress at the time of sync - wait for its end only
+			unsigned spins = 0;
+			while(epochs[i] == epochs_snapshot[i]) {
+				if(++spins < 1000) {
+					#if defined(__x86_64__) || defined(__i386__)
+					__builtin_ia32_pause();
+					#endif
+				} else {
+					sched_yield();
+				}
+			}
+		}
+	}
+}
+
+cRtpHashCache::sStat cRtpHashCache::getStat() {
+	sStat stat;
+	__SYNC_LOCK(instances_sync);
+	for(unsigned i = 0; i < RTP_HASH_CACHE_MAX_INSTANCES; i++) {
+		if(instances[i]) {
+			stat.hits += instances[i]->stat.hits;
+			stat.misses += instances[i]->stat.misses;
+			stat.overflows += instances[i]->stat.overflows;
+		}
+	}
+	__SYNC_UNLOCK(instances_sync);
+	return(stat);
+}
+
+void cRtpHashCache::clearStat() {
+	__SYNC_LOCK(instances_sync);
+	for(unsigned i = 0; i < RTP_HASH_CACHE_MAX_INSTANCES; i++) {
+		if(instances[i]) {
+			instances[i]->stat.clear();
+		}
+	}
+	__SYNC_UNLOCK(instances_sync);
+}
+
+string cRtpHashCache::getStatString() {
+	sStat stat = getStat();
+	ostringstream outStr;
+	outStr << fixed
+	       << "hits: " << stat.hits
+	       << ", misses: " << stat.misses
+	       << ", overflows: " << stat.overflows
+	       << ", hit rate: " << setprecision(1) << (stat.hits + stat.misses ? (double)stat.hits / (stat.hits + stat.misses) * 100 : 0) << "%";
+	return(outStr.str());
+}
@@ -0,0 +1,145 @@
+#ifndef RTP_HASH_CACHE_H
+#define RTP_HASH_CACHE_H
+
+
+#include <string>
+
+#include "calltable.h"
+
+
+#define RTP_HASH_CACHE_GEN_STRIPES 4096
+#define RTP_HASH_CACHE_MAX_CALLS 4
+#define RTP_HASH_CACHE_MAX_INSTANCES 64
+
+
+using namespace std;
+
+
+struct sRtpHashCacheCall {
+	Call *call;
+	int8_t iscaller;
+	bool is_rtcp;
+	bool other_side_in_hash;
+	bool other_side_rtcp_mux;
+	s_sdp_flags sdp_flags;
+};
+
+struct sRtpHashCacheItem {
+	vmIP saddr;
+	vmIP daddr;
+	vmPort sport;
+	vmPort dport;
+	u_int32_t gen_s;
+	u_int32_t gen_d;
+	u_int32_t gen_all;
+	bool used;
+	bool find_by_dest;
+	u_int8_t calls_count;
+	sRtpHashCacheCall calls[RTP_HASH_CACHE_MAX_CALLS];
+};
+
+
+/*
+ * Per thread cache of result of Calltable::hashfind_by_ip_port for rtp packet (saddr:sport -> daddr:dport).
+ * Item is valid while generation of both ip:port stripes is unchanged. Generations are bumped
+ * (under lock_calls_hash) by every modification of calls hash - _hashAdd, _hashRemove, sdp_flags update.
+ * Lookup between begin() and end() takes no lock. Call referenced from item must not be destroyed
+ * while some thread is inside begin() / end() - Call::removeFindTables calls sync() after removing call from hash.
+ * begin() / end() increment epoch of instance (odd - inside), sync() waits only until the epochs which were odd
+ * at the time of sync change - it is not blocked by thread that enters begin() again.
+ */
+class cRtpHashCache {
+public:
+	struct sStat {
+		sStat() {
+			clear();
+		}
+		void clear() {
+			hits = 0;
+			misses = 0;
+			overflows = 0;
+		}
+		u_int64_t hits;
+		u_int64_t misses;
+		u_int64_t overflows;
+	};
+public:
+	static cRtpHashCache *create(unsigned size);
+	~cRtpHashCache();
+	inline void begin() {
+		__sync_add_and_fetch(epoch, 1);
+	}
+	inline void end() {
+		__sync_add_and_fetch(epoch, 1);
+	}
+	inline sRtpHashCacheItem *find(vmIP saddr, vmPort sport, vmIP daddr, vmPort dport) {
+		sRtpHashCacheItem *item = &items[itemIndex(saddr, sport, daddr, dport)];
+		if(item->used &&
+		   item->dport == dport && item->sport == sport &&
+		   item->daddr == daddr && item->saddr == saddr &&
+		   item->gen_d == gen[stripe(daddr, dport)] &&
+		   item->gen_s == gen[stripe(saddr, sport)] &&
+		   item->gen_all == gen_all) {
+			return(item);
+		}
+		return(NULL);
+	}
+	// call with lock_calls_hash
+	inline sRtpHashCacheItem *prepare(vmIP saddr, vmPort sport, vmIP daddr, vmPort dport) {
+		sRtpHashCacheItem *item = &items[itemIndex(saddr, sport, daddr, dport)];
+		item->used = false;
+		item->saddr = saddr;
+		item->daddr = daddr;
+		item->sport = sport;
+		item->dport = dport;
+		item->gen_s = gen[stripe(saddr, sport)];
+		item->gen_d = gen[stripe(daddr, dport)];
+		item->gen_all = gen_all;
+		item->find_by_dest = false;
+		item->calls_count = 0;
+		return(item);
+	}
+	sStat stat;
+public:
+	// call with lock_calls_hash
+	static inline void bump(vmIP addr, vmPort port) {
+		__sync_add_and_fetch(&gen[stripe(addr, port)], 1);
+	}
+	static inline void bumpAll() {
+		__sync_add_and_fetch(&gen_all, 1);
+	}
+	static void sync();
+	static sStat getStat();
+	static void clearStat();
+	static string getStatString();
+private:
+	cRtpHashCache(unsigned size, volatile u_int32_t *epoch);
+	inline unsigned itemIndex(vmIP saddr, vmPort sport, vmIP daddr, vmPort dport) {
+		return(mix(saddr.getHashNumber() ^ (daddr.getHashNumber() * 31) ^
+			   (((u_int32_t)sport.port << 16) | dport.port)) & (size - 1));
+	}
+	static inline unsigned stripe(vmIP addr, vmPort port) {
+		return(mix(addr.getHashNumber() ^ ((u_int32_t)port.port << 16)) & (RTP_HASH_CACHE_GEN_STRIPES - 1));
+	}
+	static inline u_int32_t mix(u_int32_t key) {
+		key ^= key >> 16;
+		key *= 0x7feb352d;
+		key ^= key >> 15;
+		key *= 0x846ca68b;
+		key ^= key >> 16;
+		return(key);
+	}
+private:
+	sRtpHashCacheItem *items;
+	unsigned size;
+	volatile u_int32_t *epoch;
+	static volatile u_int32_t gen[RTP_HASH_CACHE_GEN_STRIPES];
+	static volatile u_int32_t gen_all;
+	static cRtpHashCache *instances[RTP_HASH_CACHE_MAX_INSTANCES];
+	// epochs are kept by slot - sync() can wait for them without lock, also if instance is destroyed meanwhile
+	static volatile u_int32_t epochs[RTP_HASH_CACHE_MAX_INSTANCES];
+	static volatile int instances_sync;
+};
+
+
+#endif //RTP_HASH_CACHE_H
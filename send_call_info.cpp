@@ -99,6 +99,10 @@ bool SendCallInfoItem::load(SqlDb *sqlDb) {
 	ipCalledFilter.addWhite(dbRow["whitelist_ip_called_group"].c_str());
 	ipCalledFilter.addBlack(dbRow["blacklist_ip_called"].c_str());
 	ipCalledFilter.addBlack(dbRow["blacklist_ip_called_group"].c_str());
+	phoneNumberCallerFilter.prepareLpm();
+	phoneNumberCalledFilter.prepareLpm();
+	ipCallerFilter.prepareLpm();
+	ipCalledFilter.prepareLpm();
 	if(_createSqlObject) {
 		delete sqlDb;
 	}
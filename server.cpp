@@ -227,15 +227,26 @@ string *sSnifferServerServices::get_rchs_query() {
 cSnifferServer::cSnifferServer() {
 	sqlStore = NULL;
 	terminate = false;
+	reactor = NULL;
 	connection_threads_sync = 0;
 	for(int i = 0; i < 2; i++) {
 		sql_queue_size_size[i] = 0;
 		sql_queue_size_time_ms[i] = 0;
 	}
+	if(snifferServerOptions.reactor_threads) {
+		reactor = new FILE_LINE(0) cServerReactor("sniffer_server", snifferServerOptions.reactor_threads);
+		if(!reactor->start()) {
+			delete reactor;
+			reactor = NULL;
+		}
+	}
 }
 
 cSnifferServer::~cSnifferServer() {
 	terminate = true;
+	if(reactor) {
+		reactor->stop();
+	}
 	terminateSocketInConnectionThreads();
 	unsigned counter = 0;
 	while(existConnectionThread() && counter < 100 && is_terminating() < 2) {
@@ -243,6 +254,9 @@ cSnifferServer::~cSnifferServer() {
 		++counter;
 	}
 	cancelConnectionThreads();
+	if(reactor) {
+		delete reactor;
+	}
 }
 
 void cSnifferServer::setSqlStore(MySqlStore *sqlStore) {
@@ -315,7 +329,9 @@ bool cSnifferServer::existConnectionThread() {
 void cSnifferServer::cancelConnectionThreads() {
 	lock_connection_threads();
 	for(map<cSnifferServerConnection*, bool>::iterator iter = connection_threads.begin(); iter != connection_threads.end(); iter++) {
-		pthread_cancel(iter->first->getThread());
+		if(iter->first->getThread()) {
+			pthread_cancel(iter->first->getThread());
+		}
 	}
 	unlock_connection_threads();
 }
@@ -335,6 +351,7 @@ cSnifferServerConnection::cSnifferServerConnection(cSocket *socket, cSnifferServ
 	terminate = false;
 	orphan = false;
 	typeConnection = _tc_na;
+	packetbuffer_block_counter = 0;
 	this->server = server;
 }
 
@@ -394,7 +411,39 @@ void cSnifferServerConnection::connection_process() {
 	}
 }
 
-void cSnifferServerConnection::evData(u_char */*data*/, size_t /*dataLen*/) {
+void cSnifferServerConnection::evData(u_char *data, size_t dataLen) {
+	// blocks of connections handed over to reactor
+	bool rslt = true;
+	switch(typeConnection) {
+	case _tc_store:
+		rslt = cp_store_block(data, dataLen);
+		break;
+	case _tc_packetbuffer_block:
+		rslt = cp_packetbuffer_block_add(data, dataLen);
+		break;
+	default:
+		break;
+	}
+	if(!rslt || server->isTerminate()) {
+		socket->setTerminate();
+	}
+}
+
+bool cSnifferServerConnection::reactor_can_read() {
+	switch(typeConnection) {
+	case _tc_store:
+		return(server->isSetSqlStore());
+	case _tc_packetbuffer_block: {
+		extern uint64_t opt_pcap_queue_store_queue_max_disk_size;
+		extern string opt_pcap_queue_disk_folder;
+		extern cBuffersControl buffersControl;
+		return(buffersControl.check__pcap_store_queue__push() ||
+		       (opt_pcap_queue_store_queue_max_disk_size && !opt_pcap_queue_disk_folder.empty()));
+		}
+	default:
+		break;
+	}
+	return(true);
 }
 
 void cSnifferServerConnection::addTask(sSnifferServerGuiTask task) {
@@ -859,73 +908,82 @@ void cSnifferServerConnection::cp_store() {
 		delete this;
 		return;
 	}
+	if(reactor_add()) {
+		return;
+	}
 	u_char *query;
 	size_t queryLength;
 	unsigned counter = 0;
 	while(!server->isTerminate() &&
 	      (query = socket->readBlock(&queryLength, cSocket::_te_aes, "", counter > 0, 0, 1024 * 1024)) != NULL) {
-		if(queryLength == 5 && !strncmp((char*)query, "check", 5)) {
-			if(cp_store_check()) {
-				socket->writeBlock("OK", cSocket::_te_aes);
-			}
-			continue;
+		if(!cp_store_block(query, queryLength)) {
+			break;
 		}
+		++counter;
+	}
+	delete this;
+}
+
+bool cSnifferServerConnection::cp_store_block(u_char *query, size_t queryLength) {
+	if(queryLength == 5 && !strncmp((char*)query, "check", 5)) {
 		if(cp_store_check()) {
-			string queryStr;
-			cGzip gzipDecompressQuery;
-			cLzo lzoDecompressQuery;
-			if(gzipDecompressQuery.isCompress(query, queryLength)) {
-				queryStr = gzipDecompressQuery.decompressString(query, queryLength);
-			} else if(lzoDecompressQuery.isCompress(query, queryLength)) {
-				queryStr = lzoDecompressQuery.decompressString(query, queryLength);
-			} else {
-				queryStr = string((char*)query, queryLength);
-			}
-			if(!queryStr.empty()) {
-				size_t posStoreIdSeparator = queryStr.find('|');
-				if(posStoreIdSeparator != string::npos) {
-					int storeIdMain = atoi(queryStr.c_str());
-					while(!server->isSetSqlStore()) {
-						if(is_terminating()) {
-							delete this;
-							return;
-						}
-						USLEEP(1000);
+			socket->writeBlock("OK", cSocket::_te_aes);
+		}
+		return(true);
+	}
+	if(cp_store_check()) {
+		string queryStr;
+		cGzip gzipDecompressQuery;
+		cLzo lzoDecompressQuery;
+		if(gzipDecompressQuery.isCompress(query, queryLength)) {
+			queryStr = gzipDecompressQuery.decompressString(query, queryLength);
+		} else if(lzoDecompressQuery.isCompress(query, queryLength)) {
+			queryStr = lzoDecompressQuery.decompressString(query, queryLength);
+		} else {
+			queryStr = string((char*)query, queryLength);
+		}
+		if(!queryStr.empty()) {
+			size_t posStoreIdSeparator = queryStr.find('|');
+			if(posStoreIdSeparator != string::npos) {
+				int storeIdMain = atoi(queryStr.c_str());
+				while(!server->isSetSqlStore()) {
+					if(is_terminating()) {
+						return(false);
 					}
-					int storeId2 = server->findMinStoreId2(storeIdMain);
-					if(queryStr[posStoreIdSeparator + 1] == 'L' && isdigit(queryStr[posStoreIdSeparator + 2])) {
-						list<string> queriesStr;
-						size_t pos = posStoreIdSeparator + 1;
-						do {
-							if(queryStr[pos] != 'L') {
-								syslog(LOG_ERR, "cSnifferServerConnection::cp_store: missing 'L' separator");
-								break;
-							}
-							unsigned length = atoi(queryStr.c_str() + pos + 1);
-							size_t pos_sep = queryStr.find(':', pos);
-							if(pos_sep == string::npos) {
-								syslog(LOG_ERR, "cSnifferServerConnection::cp_store: missing ':' separator");
-								break;
-							}
-							pos = pos_sep + 1;
-							queriesStr.push_back(queryStr.substr(pos, length));
-							pos += length + 1;
-						} while(pos < queryStr.length());
-						if(!sverb.suppress_server_store) {
-							server->sql_query_lock(&queriesStr, storeIdMain, storeId2);
+					USLEEP(1000);
+				}
+				int storeId2 = server->findMinStoreId2(storeIdMain);
+				if(queryStr[posStoreIdSeparator + 1] == 'L' && isdigit(queryStr[posStoreIdSeparator + 2])) {
+					list<string> queriesStr;
+					size_t pos = posStoreIdSeparator + 1;
+					do {
+						if(queryStr[pos] != 'L') {
+							syslog(LOG_ERR, "cSnifferServerConnection::cp_store: missing 'L' separator");
+							break;
 						}
-					} else {
-						if(!sverb.suppress_server_store) {
-							server->sql_query_lock(queryStr.substr(posStoreIdSeparator + 1).c_str(), storeIdMain, storeId2);
+						unsigned length = atoi(queryStr.c_str() + pos + 1);
+						size_t pos_sep = queryStr.find(':', pos);
+						if(pos_sep == string::npos) {
+							syslog(LOG_ERR, "cSnifferServerConnection::cp_store: missing ':' separator");
+							break;
 						}
+						pos = pos_sep + 1;
+						queriesStr.push_back(queryStr.substr(pos, length));
+						pos += length + 1;
+					} while(pos < queryStr.length());
+					if(!sverb.suppress_server_store) {
+						server->sql_query_lock(&queriesStr, storeIdMain, storeId2);
+					}
+				} else {
+					if(!sverb.suppress_server_store) {
+						server->sql_query_lock(queryStr.substr(posStoreIdSeparator + 1).c_str(), storeIdMain, storeId2);
 					}
-					socket->writeBlock("OK", cSocket::_te_aes);
 				}
+				socket->writeBlock("OK", cSocket::_te_aes);
 			}
 		}
-		++counter;
 	}
-	delete this;
+	return(true);
 }
 
 bool cSnifferServerConnection::cp_store_check() {
@@ -957,45 +1015,72 @@ void cSnifferServerConnection::cp_packetbuffer_block() {
 		delete this;
 		return;
 	}
+	if(reactor_add()) {
+		return;
+	}
 	u_char *block;
 	size_t blockLength;
 	unsigned counter = 0;
-	u_int32_t block_counter = 0;
 	while(!server->isTerminate() &&
 	      (block = socket->readBlock(&blockLength, cSocket::_te_aes, "", counter > 0, 0, 1024 * 1024)) != NULL) {
-		if(is_readend() || !pcapQueueQ) {
+		if(!cp_packetbuffer_block_add(block, blockLength)) {
 			break;
 		}
-		string errorAddBlock;
-		string warningAddBlock;
-		bool require_confirmation = true;
-		bool rsltAddBlock = pcapQueueQ->addBlockStoreToPcapStoreQueue(block, blockLength, &errorAddBlock, &warningAddBlock, &block_counter, &require_confirmation);
-		if(require_confirmation) {
-			if(rsltAddBlock) {
-				socket->writeBlock("OK", cSocket::_te_aes);
-			} else {
-				socket->writeBlock(errorAddBlock, cSocket::_te_aes);
-			}
-		}
 		++counter;
-		if(!errorAddBlock.empty()) {
-			cLogSensor::log(cLogSensor::error, 
-					"error in receiving packets from client",
-					"connection from %s, error: %s", 
-					socket->getIP().c_str(),
-					errorAddBlock.c_str());
-		}
-		if(!warningAddBlock.empty()) {
-			cLogSensor::log(cLogSensor::warning, 
-					"warning in receiving packets from client",
-					"connection from %s, warning: %s", 
-					socket->getIP().c_str(),
-					warningAddBlock.c_str());
-		}
 	}
 	delete this;
 }
 
+bool cSnifferServerConnection::cp_packetbuffer_block_add(u_char *block, size_t blockLength) {
+	extern PcapQueue_readFromFifo *pcapQueueQ;
+	if(is_readend() || !pcapQueueQ) {
+		return(false);
+	}
+	string errorAddBlock;
+	string warningAddBlock;
+	bool require_confirmation = true;
+	bool rsltAddBlock = pcapQueueQ->addBlockStoreToPcapStoreQueue(block, blockLength, &errorAddBlock, &warningAddBlock, &packetbuffer_block_counter, &require_confirmation);
+	if(require_confirmation) {
+		if(rsltAddBlock) {
+			socket->writeBlock("OK", cSocket::_te_aes);
+		} else {
+			socket->writeBlock(errorAddBlock, cSocket::_te_aes);
+		}
+	}
+	if(!errorAddBlock.empty()) {
+		cLogSensor::log(cLogSensor::error, 
+				"error in receiving packets from client",
+				"connection from %s, error: %s", 
+				socket->getIP().c_str(),
+				errorAddBlock.c_str());
+	}
+	if(!warningAddBlock.empty()) {
+		cLogSensor::log(cLogSensor::warning, 
+				"warning in receiving packets from client",
+				"connection from %s, warning: %s", 
+				socket->getIP().c_str(),
+				warningAddBlock.c_str());
+	}
+	return(true);
+}
+
+bool cSnifferServerConnection::reactor_add() {
+	// after handshake the connection continues in reactor (server_reactor_threads) - this thread ends
+	cServerReactor *reactor = server->getReactor();
+	if(!reactor) {
+		return(false);
+	}
+	reactor_type_encode = cSocket::_te_aes;
+	reactor_buffer_inc_length = 1024 * 1024;
+	pthread_t _thread = thread;
+	thread = 0;
+	if(!reactor->add(this)) {
+		thread = _thread;
+		return(false);
+	}
+	return(true);
+}
+
 void cSnifferServerConnection::cp_manager_command(string command) {
 	if(SS_VERBOSE().connect_info) {
 		ostringstream verbstr;
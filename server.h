@@ -42,6 +42,7 @@ struct sSnifferServerOptions {
 		mysql_redirect_queue_limit = 0;
 		mysql_concat_limit = 1000;
 		type_compress = _cs_compress_gzip;
+		reactor_threads = 0;
 	}
 	bool isEnable() {
 		return(!host.empty() && port);
@@ -52,6 +53,7 @@ struct sSnifferServerOptions {
 	unsigned mysql_redirect_queue_limit;
 	unsigned mysql_concat_limit;
 	eServerClientTypeCompress type_compress;
+	unsigned reactor_threads;
 };
 
 
@@ -252,6 +254,9 @@ public:
 	bool isTerminate() {
 		return(terminate);
 	}
+	cServerReactor *getReactor() {
+		return(reactor);
+	}
 	void lock_connection_threads() {
 		while(__sync_lock_test_and_set(&connection_threads_sync, 1));
 	}
@@ -261,6 +266,7 @@ public:
 private:
 	MySqlStore *sqlStore;
 	volatile bool terminate;
+	cServerReactor *reactor;
 	map<class cSnifferServerConnection*, bool> connection_threads;
 	volatile int connection_threads_sync;
 	volatile size_t sql_queue_size_size[2];
@@ -286,6 +292,7 @@ public:
 	~cSnifferServerConnection();
 	virtual void connection_process();
 	virtual void evData(u_char *data, size_t dataLen);
+	virtual bool reactor_can_read();
 	void addTask(sSnifferServerGuiTask task);
 	sSnifferServerGuiTask getTask();
 	void doTerminate() {
@@ -302,8 +309,11 @@ protected:
 	void cp_responses();
 	void cp_query();
 	void cp_store();
+	bool cp_store_block(u_char *query, size_t queryLength);
 	bool cp_store_check();
 	void cp_packetbuffer_block();
+	bool cp_packetbuffer_block_add(u_char *block, size_t blockLength);
+	bool reactor_add();
 	void cp_manager_command(string command);
 private:
 	bool rsaAesInit(bool writeRsltOK = true);
@@ -328,6 +338,7 @@ protected:
 	cSnifferServer *server;
 private:
 	eTypeConnection typeConnection;
+	u_int32_t packetbuffer_block_counter;
 };
 
 
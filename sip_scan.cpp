@@ -0,0 +1,232 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+
+#include "sip_scan.h"
+#include "tools.h"
+
+
+using namespace std;
+
+
+static const char *sip_scan_test_corpus[] = {
+	"INVITE sip:800123456@sip.odorik.cz SIP/2.0\r\n"
+	"Via: SIP/2.0/UDP 192.168.1.12:5061;rport;branch=z9hG4bK354557323\r\n"
+	"From: <sip:706912@sip.odorik.cz>;tag=1645803335\r\n"
+	"To: <sip:800123456@sip.odorik.cz>\r\n"
+	"Call-ID: 1781060762\r\n"
+	"CSeq: 20 INVITE\r\n"
+	"Contact: <sip:jumbox@93.91.52.46>\r\n"
+	"Content-Type: application/sdp\r\n"
+	"Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, NOTIFY, MESSAGE, SUBSCRIBE, INFO\r\n"
+	"Max-Forwards: 70\r\n"
+	"User-Agent: Linphone/3.6.1 (eXosip2/3.6.0)\r\n"
+	"Subject: Phone call\r\n"
+	"Content-Length: 453\r\n"
+	"\r\n"
+	"v=0\r\n"
+	"o=706912 1477 2440 IN IP4 93.91.52.46\r\n"
+	"s=Talk\r\n"
+	"c=IN IP4 93.91.52.46\r\n"
+	"t=0 0\r\n"
+	"m=audio 7078 RTP/AVP 125 112 111 110 96 3 0 8 101\r\n"
+	"a=rtpmap:125 opus/48000\r\n"
+	"a=fmtp:125 useinbandfec=1; usedtx=1\r\n"
+	"a=rtpmap:112 speex/32000\r\n"
+	"a=fmtp:112 vbr=on\r\n"
+	"a=rtpmap:111 speex/16000\r\n"
+	"a=fmtp:111 vbr=on\r\n"
+	"a=rtpmap:110 speex/8000\r\n"
+	"a=fmtp:110 vbr=on\r\n"
+	"a=rtpmap:96 GSM/11025\r\n"
+	"a=rtpmap:101 telephone-event/8000\r\n"
+	"a=fmtp:101 0-11\r\n"
+	"m=video 9078 RTP/AVP 103\r\n"
+	"a=rtpmap:103 VP8/90000\r\n",
+	"SIP/2.0 200 OK\r\n"
+	"Via: SIP/2.0/UDP 10.0.0.5:5060;branch=z9hG4bK-524287-1---a5b7c1d9e3f5a7b9;rport=5060;received=10.0.0.5\r\n"
+	"Record-Route: <sip:10.0.0.1;lr;ftag=as4b5c6d7e>\r\n"
+	"From: \"Alice\" <sip:alice@example.com>;tag=as4b5c6d7e\r\n"
+	"To: <sip:+420123456789@example.com>;tag=8f7e6d5c4b3a\r\n"
+	"Call-ID: 3c26700857d4-hv8nqzkd0x1b@example.com\r\n"
+	"CSeq: 102 INVITE\r\n"
+	"Contact: <sip:+420123456789@10.0.0.9:5060;transport=udp>\r\n"
+	"Allow: INVITE, ACK, CANCEL, BYE, OPTIONS, INFO, UPDATE, PRACK, REFER, NOTIFY\r\n"
+	"Supported: timer, 100rel, replaces\r\n"
+	"Session-Expires: 1800;refresher=uac\r\n"
+	"P-Asserted-Identity: <sip:+420123456789@example.com>\r\n"
+	"Server: Gateway/4.2\r\n"
+	"Content-Type: application/sdp\r\n"
+	"Content-Length: 236\r\n"
+	"\r\n"
+	"v=0\r\n"
+	"o=- 1546423 1546424 IN IP4 10.0.0.9\r\n"
+	"s=-\r\n"
+	"c=IN IP4 10.0.0.9\r\n"
+	"t=0 0\r\n"
+	"m=audio 31846 RTP/AVP 8 101\r\n"
+	"a=rtpmap:8 PCMA/8000\r\n"
+	"a=rtpmap:101 telephone-event/8000\r\n"
+	"a=fmtp:101 0-15\r\n"
+	"a=ptime:20\r\n"
+	"a=sendrecv\r\n",
+	"BYE sip:+420123456789@10.0.0.9:5060;transport=udp SIP/2.0\r\n"
+	"Via: SIP/2.0/UDP 10.0.0.5:5060;branch=z9hG4bK-524287-1---f0e1d2c3b4a59687;rport\r\n"
+	"Max-Forwards: 70\r\n"
+	"Route: <sip:10.0.0.1;lr;ftag=as4b5c6d7e>\r\n"
+	"From: \"Alice\" <sip:alice@example.com>;tag=as4b5c6d7e\r\n"
+	"To: <sip:+420123456789@example.com>;tag=8f7e6d5c4b3a\r\n"
+	"Call-ID: 3c26700857d4-hv8nqzkd0x1b@example.com\r\n"
+	"CSeq: 103 BYE\r\n"
+	"Reason: Q.850;cause=16;text=\"Normal call clearing\"\r\n"
+	"User-Agent: Softphone 3.21\r\n"
+	"Content-Length: 0\r\n"
+	"\r\n",
+	"INVITE sip:bob@biloxi.example.com SIP/2.0\r\n"
+	"v: SIP/2.0/TCP client.atlanta.example.com:5060;branch=z9hG4bK74bf9\r\n"
+	"f: Alice <sip:alice@atlanta.example.com>;tag=9fxced76sl\r\n"
+	"t: Bob <sip:bob@biloxi.example.com>\r\n"
+	"i: 3848276298220188511@atlanta.example.com\r\n"
+	"CSeq: 1 INVITE\r\n"
+	"m: <sip:alice@client.atlanta.example.com;transport=tcp>\r\n"
+	"c: application/sdp\r\n"
+	"l: 0\r\n"
+	"\r\n"
+};
+
+static const char *sip_scan_test_tags[] = {
+	"\nCall-ID:", "\ni:", "\nFrom:", "\nf:", "\nTo:", "\nt:", "\nCSeq:", "\nContact:", "\nm:",
+	"\nContent-Type:", "\nc:", "\nUser-Agent:", "\nVia:", "\nv:", "\nReason:", "\nX-VoipMonitor-norecord:",
+	"\nP-Asserted-Identity:", "\nExpires:", "branch=", "a=rtpmap:", "m=audio ", "o=", "tag="
+};
+
+static u_int32_t sip_scan_test_parse_legacy(ParsePacket *parsePacket, char *data, unsigned long datalen, ParsePacket::ppContentsX *contents) {
+	unsigned long rsltDataLen = datalen;
+	unsigned int namelength;
+	for(unsigned long i = 0; i < datalen; i++) {
+		if(!contents->doubleEndLine &&
+		   datalen > 3 &&
+		   data[i] == '\r' && i < datalen - 3 &&
+		   data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n') {
+			contents->doubleEndLine = data + i;
+			if(contents->contentLength > -1) {
+				unsigned long modify_datalen = contents->doubleEndLine + 4 - data + contents->contentLength;
+				if(modify_datalen < datalen) {
+					datalen = modify_datalen;
+					rsltDataLen = datalen;
+				}
+			} else {
+				rsltDataLen = contents->doubleEndLine + 4 - data;
+				break;
+			}
+			i += 2;
+		} else if(i == 0 || data[i - 1] == '\n') {
+			ParsePacket::ppNode *node = parsePacket->getNode(data + i, datalen - i - 1, &namelength);
+			if(node && !node->isSetNode(contents)) {
+				ParsePacket::ppContentItemX *contentItem = node->getPointerToItem(contents);
+				contentItem->offset = i + namelength;
+				i += namelength;
+				bool endLine = false;
+				for(; i < datalen; i++) {
+					if(data[i] == '\r' || data[i] == '\n') {
+						endLine = true;
+						break;
+					}
+				}
+				if(endLine || i == datalen) {
+					contentItem->length = i - contentItem->offset;
+					contentItem->trim(data);
+					if(node->isContentLength && contentItem->length) {
+						contents->contentLength = atoi(data + contentItem->offset);
+					}
+					if(endLine) {
+						--i;
+					}
+				}
+			}
+		}
+	}
+	contents->parseDataPtr = data;
+	return(rsltDataLen);
+}
+
+/* correctness against the legacy scalar code and speed on a corpus of INVITE / 200 / BYE messages
+ * -X61/iterations
+*/
+void sip_scan_test(const char *params) {
+	unsigned iterations = params && atoi(params) > 0 ? atoi(params) : 100000;
+	unsigned corpus_size = sizeof(sip_scan_test_corpus) / sizeof(sip_scan_test_corpus[0]);
+	unsigned tags_size = sizeof(sip_scan_test_tags) / sizeof(sip_scan_test_tags[0]);
+	vector<string> corpus;
+	for(unsigned i = 0; i < corpus_size; i++) {
+		corpus.push_back(sip_scan_test_corpus[i]);
+	}
+	cout << "simd width: " << SIP_SCAN_SIMD_WIDTH << " bytes" << endl;
+	ParsePacket parsePacket;
+	parsePacket.setStdParse();
+	unsigned errors = 0;
+	u_int64_t sum_rslt[2] = { 0, 0 };
+	for(unsigned pass = 0; pass < 2; pass++) {
+		// 0 - strcasestr on '\0' terminated packet, 1 - sip_scan_strcasestr
+		u_int64_t start = getTimeUS();
+		for(unsigned it = 0; it < iterations; it++) {
+			for(unsigned i = 0; i < corpus.size(); i++) {
+				char *data = (char*)corpus[i].c_str();
+				unsigned len = corpus[i].length();
+				for(unsigned j = 0; j < tags_size; j++) {
+					const char *rslt;
+					if(pass == 0) {
+						char endChar = data[len - 1];
+						data[len - 1] = 0;
+						rslt = strcasestr(data, sip_scan_test_tags[j]);
+						data[len - 1] = endChar;
+					} else {
+						rslt = sip_scan_strcasestr(data, len - 1, sip_scan_test_tags[j]);
+					}
+					sum_rslt[pass] += rslt ? rslt - data + 1 : 0;
+				}
+			}
+		}
+		u_int64_t time = getTimeUS() - start;
+		cout << (pass == 0 ? "strcasestr           " : "sip_scan_strcasestr  ")
+		     << fixed << setprecision(1) << (double)time * 1000 / iterations / corpus.size() / tags_size << " ns / lookup" << endl;
+	}
+	if(sum_rslt[0] != sum_rslt[1]) {
+		cout << "ERROR: strcasestr results differ" << endl;
+		++errors;
+	}
+	u_int64_t sum_len[2] = { 0, 0 };
+	for(unsigned pass = 0; pass < 2; pass++) {
+		// 0 - legacy byte loop, 1 - ParsePacket::parseData
+		u_int64_t start = getTimeUS();
+		for(unsigned it = 0; it < iterations; it++) {
+			for(unsigned i = 0; i < corpus.size(); i++) {
+				ParsePacket::ppContentsX contents;
+				sum_len[pass] += pass == 0 ?
+						  sip_scan_test_parse_legacy(&parsePacket, (char*)corpus[i].c_str(), corpus[i].length(), &contents) :
+						  parsePacket.parseData((char*)corpus[i].c_str(), corpus[i].length(), &contents);
+			}
+		}
+		u_int64_t time = getTimeUS() - start;
+		cout << (pass == 0 ? "parse legacy         " : "parse ParsePacket    ")
+		     << fixed << setprecision(1) << (double)time * 1000 / iterations / corpus.size() << " ns / message" << endl;
+	}
+	if(sum_len[0] != sum_len[1]) {
+		cout << "ERROR: parse length differs" << endl;
+		++errors;
+	}
+	for(unsigned i = 0; i < corpus.size(); i++) {
+		ParsePacket::ppContentsX contents[2];
+		sip_scan_test_parse_legacy(&parsePacket, (char*)corpus[i].c_str(), corpus[i].length(), &contents[0]);
+		parsePacket.parseData((char*)corpus[i].c_str(), corpus[i].length(), &contents[1]);
+		if(memcmp(contents[0].std, contents[1].std, sizeof(contents[0].std)) ||
+		   memcmp(contents[0].custom, contents[1].custom, sizeof(contents[0].custom)) ||
+		   contents[0].doubleEndLine != contents[1].doubleEndLine ||
+		   contents[0].contentLength != contents[1].contentLength) {
+			cout << "ERROR: parse contents differ in message " << i << endl;
+			++errors;
+		}
+	}
+	cout << (errors ? "FAILED" : "OK") << endl;
+}
@@ -0,0 +1,132 @@
+#ifndef SIP_SCAN_H
+#define SIP_SCAN_H
+
+
+#include <string.h>
+#include <strings.h>
+#include <sys/types.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIP_SCAN_SIMD_WIDTH 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIP_SCAN_SIMD_WIDTH 16
+#else
+#define SIP_SCAN_SIMD_WIDTH 0
+#endif
+
+
+/*
+ * Vectorized scanning of SIP text (AVX2 / SSE2 / scalar, selected at compile time by -march).
+ * Block compare produces bitmask of matching bytes, so line ends and candidate tag positions
+ * are found without per byte branches. Data need not be NUL-terminated.
+ */
+
+#if SIP_SCAN_SIMD_WIDTH
+static inline u_int32_t sip_scan_mask(const char *data, char c1, char c2, u_int32_t *zeroMask = NULL) {
+	#if SIP_SCAN_SIMD_WIDTH == 32
+	__m256i block = _mm256_loadu_si256((const __m256i*)data);
+	u_int32_t mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(c1)),
+							      _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c2))));
+	if(zeroMask) {
+		*zeroMask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_setzero_si256()));
+	}
+	#else
+	__m128i block = _mm_loadu_si128((const __m128i*)data);
+	u_int32_t mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(c1)),
+							_mm_cmpeq_epi8(block, _mm_set1_epi8(c2))));
+	if(zeroMask) {
+		*zeroMask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_setzero_si128()));
+	}
+	#endif
+	return(mask);
+}
+#endif
+
+// first occurrence of c1 or c2
+static inline const char *sip_scan_find(const char *data, u_int32_t length, char c1, char c2) {
+	u_int32_t i = 0;
+	#if SIP_SCAN_SIMD_WIDTH
+	for(; i + SIP_SCAN_SIMD_WIDTH <= length; i += SIP_SCAN_SIMD_WIDTH) {
+		u_int32_t mask = sip_scan_mask(data + i, c1, c2);
+		if(mask) {
+			return(data + i + __builtin_ctz(mask));
+		}
+	}
+	#endif
+	for(; i < length; i++) {
+		if(data[i] == c1 || data[i] == c2) {
+			return(data + i);
+		}
+	}
+	return(NULL);
+}
+
+static inline const char *sip_scan_find(const char *data, u_int32_t length, char c) {
+	return(sip_scan_find(data, length, c, c));
+}
+
+static inline const char *sip_scan_find_scalar(const char *data, u_int32_t length, char c1, char c2) {
+	for(u_int32_t i = 0; i < length; i++) {
+		if(data[i] == c1 || data[i] == c2) {
+			return(data + i);
+		}
+	}
+	return(NULL);
+}
+
+/* case insensitive search of tag in data of length
+ * - same result as strcasestr on data terminated at length (or at the first NUL byte inside data)
+*/
+static inline const char *sip_scan_strcasestr(const char *data, u_int32_t length, const char *tag, u_int32_t tagLength) {
+	if(!tagLength) {
+		return(data);
+	}
+	if(tagLength > length) {
+		return(NULL);
+	}
+	char c1 = tag[0];
+	char c2 = c1 >= 'a' && c1 <= 'z' ? c1 - ('a' - 'A') :
+		  c1 >= 'A' && c1 <= 'Z' ? c1 + ('a' - 'A') : c1;
+	u_int32_t i = 0;
+	#if SIP_SCAN_SIMD_WIDTH
+	for(; i + SIP_SCAN_SIMD_WIDTH <= length; i += SIP_SCAN_SIMD_WIDTH) {
+		u_int32_t zeroMask;
+		u_int32_t mask = sip_scan_mask(data + i, c1, c2, &zeroMask);
+		if(zeroMask) {
+			mask &= (1u << __builtin_ctz(zeroMask)) - 1;
+		}
+		while(mask) {
+			u_int32_t pos = i + __builtin_ctz(mask);
+			if(pos + tagLength > length) {
+				return(NULL);
+			}
+			if(!strncasecmp(data + pos, tag, tagLength)) {
+				return(data + pos);
+			}
+			mask &= mask - 1;
+		}
+		if(zeroMask) {
+			return(NULL);
+		}
+	}
+	#endif
+	for(; i + tagLength <= length && data[i]; i++) {
+		if((data[i] == c1 || data[i] == c2) &&
+		   !strncasecmp(data + i, tag, tagLength)) {
+			return(data + i);
+		}
+	}
+	return(NULL);
+}
+
+static inline const char *sip_scan_strcasestr(const char *data, u_int32_t length, const char *tag) {
+	return(sip_scan_strcasestr(data, length, tag, strlen(tag)));
+}
+
+
+void sip_scan_test(const char *params);
+
+
+#endif //SIP_SCAN_H
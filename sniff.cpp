@@ -76,6 +76,9 @@ and insert them into Call class.
 #include "websocket.h"
 #include "options.h"
 #include "sniff_inline.h"
+#include "sip_scan.h"
+#include "rtp_hash_cache.h"
+#include "thread_placement.h"
 
 #if HAVE_LIBTCMALLOC    
 #include <gperftools/malloc_extension.h>
@@ -172,6 +175,7 @@ extern int opt_enable_preprocess_packet;
 extern int opt_enable_process_rtp_packet;
 extern int process_rtp_packets_distribute_threads_use;
 extern int opt_process_rtp_packets_hash_next_thread;
+extern int opt_rtp_hash_cache;
 extern int opt_process_rtp_packets_hash_next_thread_sem_sync;
 extern unsigned int opt_preprocess_packets_qring_length;
 extern unsigned int opt_preprocess_packets_qring_item_length;
@@ -972,10 +976,7 @@ int check_sip20(char *data, unsigned long len, ParsePacket::ppContentsX *parseCo
 
 inline char * _gettag(const void *ptr, unsigned long len,
 		      const char *tag, unsigned long *gettaglen) {
-	char endChar = ((char*)ptr)[len - 1];
-	((char*)ptr)[len - 1] = 0;
-	char *tagPtr = strcasestr((char*)ptr, tag);
-	((char*)ptr)[len - 1] = endChar;
+	char *tagPtr = len ? (char*)sip_scan_strcasestr((char*)ptr, len - 1, tag) : NULL;
 	if(tagPtr) {
 		unsigned contentIndex = (tagPtr - (char*)ptr) + strlen(tag);
 		while(contentIndex < len - 1 && ((char*)ptr)[contentIndex] == ' ') {
@@ -984,8 +985,8 @@ inline char * _gettag(const void *ptr, unsigned long len,
 		if(contentIndex < len) {
 			unsigned contentIndexEnd = len - 1;
 			char *ptrEndLine;
-			if((ptrEndLine = (char*)memmem((char*)ptr + contentIndex, len - contentIndex, "\r", 1)) == NULL) {
-				ptrEndLine = (char*)memmem((char*)ptr + contentIndex, len - contentIndex, "\n", 1);
+			if((ptrEndLine = (char*)sip_scan_find((char*)ptr + contentIndex, len - contentIndex, '\r')) == NULL) {
+				ptrEndLine = (char*)sip_scan_find((char*)ptr + contentIndex, len - contentIndex, '\n');
 			}
 			if(ptrEndLine) {
 				contentIndexEnd = ptrEndLine - (char*)ptr - 1;
@@ -1035,7 +1036,6 @@ inline char * gettag(const void *ptr, unsigned long len, ParsePacket::ppContents
 	unsigned long register r, l, tl;
 	char *rc = NULL;
 	char *tmp;
-	char tmp2;
 	tmp = (char*)ptr;
 	bool positionOK = true;
 	unsigned long _limitLen = 0;
@@ -1045,13 +1045,10 @@ inline char * gettag(const void *ptr, unsigned long len, ParsePacket::ppContents
 		return NULL;
 	}
 
-	// put '\0' at the end of the packet so it can be used with string functions. then restore the character
-	tmp2 = tmp[len - 1];
-	tmp[len - 1] = '\0';
-
+	// search without the last byte of the packet (as strcasestr with '\0' at the end of the packet)
 	tl = strlen(tag);
 	//r = (unsigned long)memmem(ptr, len, tag, tl); memmem cannot be used because SIP headers are case insensitive
-	r = (unsigned long)strcasestr(tmp, tag);
+	r = (unsigned long)sip_scan_strcasestr(tmp, len - 1, tag, tl);
 	if(r == 0){
 		// tag did not match
 		l = 0;
@@ -1061,9 +1058,17 @@ inline char * gettag(const void *ptr, unsigned long len, ParsePacket::ppContents
 			_limitLen = *limitLen;
 		} else {
 			const char *contentLengthString = "Content-Length: ";
-			char *contentLengthPos = strcasestr(tmp, contentLengthString);
+			const char *contentLengthPos = sip_scan_strcasestr(tmp, len - 1, contentLengthString);
 			if(contentLengthPos) {
-				int contentLength = atoi(contentLengthPos + strlen(contentLengthString));
+				int contentLength = 0;
+				const char *contentLengthPtr = contentLengthPos + strlen(contentLengthString);
+				while(contentLengthPtr < tmp + len - 1 && *contentLengthPtr == ' ') {
+					++contentLengthPtr;
+				}
+				while(contentLengthPtr < tmp + len - 1 && isdigit(*contentLengthPtr)) {
+					contentLength = contentLength * 10 + (*contentLengthPtr - '0');
+					++contentLengthPtr;
+				}
 				if(contentLength >= 0 && (unsigned)contentLength < len) {
 					const char *endHeaderSepString = "\r\n\r\n";
 					char *endHeaderSepPos = (char*)memmem(tmp, len, endHeaderSepString, strlen(endHeaderSepString));
@@ -1083,14 +1088,13 @@ inline char * gettag(const void *ptr, unsigned long len, ParsePacket::ppContents
 		if(positionOK || verbosity > 0) {
 			//tag matches move r pointer behind the tag name
 			r += tl;
-			tmp[len - 1] = tmp2;
-			l = (unsigned long)memmem((void *)r, len - (r - (unsigned long)ptr), "\r", 1);
+			l = (unsigned long)sip_scan_find((char*)r, len - (r - (unsigned long)ptr), '\r');
 			if (l > 0){
 				// remove trailing \r\n and set l to length of the tag
 				l -= r;
 			} else {
 				// trailing \r not found try to find \n
-				l = (unsigned long)memmem((void *)r, len - (r - (unsigned long)ptr), "\n", 1);
+				l = (unsigned long)sip_scan_find((char*)r, len - (r - (unsigned long)ptr), '\n');
 				if (l > 0){
 					// remove trailing \r\n and set l to length of the tag
 					l -= r;
@@ -1103,7 +1107,6 @@ inline char * gettag(const void *ptr, unsigned long len, ParsePacket::ppContents
 			l = 0;
 		}
 	}
-	tmp[len - 1] = tmp2;
 	// left trim spacees
 	if(l > 0) {
 		rc = (char*)r;
@@ -2240,6 +2243,7 @@ void *rtp_read_thread_func(void *arg) {
 			__SYNC_LOCK(read_thread->count_lock_sync);
 			unsigned count = batch->count;
 			__SYNC_UNLOCK(read_thread->count_lock_sync);
+			read_thread->processed_packets_counter += count;
 			for(unsigned batch_index = 0; batch_index < count && !is_readend(); batch_index++) {
 				read_thread->last_use_time_s = getTimeMS_rdtsc() / 1000;
 				bool rslt_read_rtp = false;
@@ -2274,6 +2278,7 @@ void *rtp_read_thread_func(void *arg) {
 					read_thread->readit++;
 				}
 			#endif
+			read_thread->qringWaitPush.wake();
 			usleepCounter = 0;
 			usleepSumTime = 0;
 			usleepSumTime_lastPush = 0;
@@ -2293,7 +2298,7 @@ void *rtp_read_thread_func(void *arg) {
 				}
 			}
 			// no packet to read, wait and try again
-			usleepSumTime += USLEEP_C(rtp_qring_usleep, usleepCounter++);
+			usleepSumTime += SYNC_WAIT(read_thread->qringWaitPop, read_thread->qring[read_thread->readit]->used, 0, rtp_qring_usleep, usleepCounter);
 		}
 	}
 	
@@ -2837,7 +2842,7 @@ inline Call *new_invite_register(packet_s_process *packetS, int sip_method, char
 		}
 		if(sip_method == REGISTER) {	
 			// destroy all REGISTER from memory within 30 seconds 
-			call->destroy_call_at = packetS->getTime_s() + opt_register_timeout;
+			call->set_destroy_call_at(packetS->getTime_s() + opt_register_timeout);
 
 			// is it first register? set time and src mac if available
 			if (call->regrrddiff == -1) {
@@ -2912,6 +2917,7 @@ inline Call *new_invite_register(packet_s_process *packetS, int sip_method, char
 						if(registerMAPIT != ((Calltable*)calltable)->registers_listMAP.end()) {
 							((Calltable*)calltable)->registers_listMAP.erase(registerMAPIT);
 						}
+						((Calltable*)calltable)->cleanup_timer_remove(&((Calltable*)calltable)->registers_cleanup_timer, call);
 						((Calltable*)calltable)->unlock_registers_listMAP();
 						delete call;
 						return(NULL);
@@ -3654,7 +3660,7 @@ void process_packet_sip_call(packet_s_process *packetS) {
 			call->onInvite = true;
 		}
 	} else if(packetS->sip_method == MESSAGE) {
-		call->destroy_call_at = packetS->getTime_s() + 60;
+		call->set_destroy_call_at(packetS->getTime_s() + 60);
 		call->seenmessageok = false;
 
 		//check and save CSeq for later to compare with OK 
@@ -3720,8 +3726,8 @@ void process_packet_sip_call(packet_s_process *packetS) {
 		++count_sip_bye;
 		if(call->is_enable_set_destroy_call_at_for_call(NULL, merged)) {
 			//do not set destroy for BYE which belongs to first leg in case of merged legs through sip header 
-			call->destroy_call_at = packetS->getTime_s() + 60;
-			call->destroy_call_at_bye = packetS->getTime_s() + opt_bye_timeout;
+			call->set_destroy_call_at(packetS->getTime_s() + 60);
+			call->set_destroy_call_at_bye(packetS->getTime_s() + opt_bye_timeout);
 		}
 		//check and save CSeq for later to compare with OK 
 		if(packetS->cseq.is_set()) {
@@ -3751,8 +3757,8 @@ void process_packet_sip_call(packet_s_process *packetS) {
 		// CANCEL continues with Status: 200 canceling; 200 OK; 487 Req. terminated; ACK. Lets wait max 10 seconds and destroy call
 		if(call->is_enable_set_destroy_call_at_for_call(NULL, merged)) {
 			//do not set destroy for CANCEL which belongs to first leg in case of merged legs through sip header 
-			call->destroy_call_at = packetS->getTime_s() + (opt_quick_save_cdr == 2 ? 0 :
-									    (opt_quick_save_cdr ? 1 : 10));
+			call->set_destroy_call_at(packetS->getTime_s() + (opt_quick_save_cdr == 2 ? 0 :
+									    (opt_quick_save_cdr ? 1 : 10)));
 		}
 		
 		if(call->is_multiple_to_branch()) {
@@ -3822,9 +3828,9 @@ void process_packet_sip_call(packet_s_process *packetS) {
 
 						// destroy call after 5 seonds from now 
 						if(call->is_enable_set_destroy_call_at_for_call(&packetS->cseq, merged)) {
-							call->destroy_call_at = packetS->getTime_s() + (opt_quick_save_cdr == 2 ? 0 :
-													    (opt_quick_save_cdr ? 1 : 5));
-							call->destroy_call_at_bye_confirmed = packetS->getTime_s() + opt_bye_confirmed_timeout;
+							call->set_destroy_call_at(packetS->getTime_s() + (opt_quick_save_cdr == 2 ? 0 :
+													    (opt_quick_save_cdr ? 1 : 5)));
+							call->set_destroy_call_at_bye_confirmed(packetS->getTime_s() + opt_bye_confirmed_timeout);
 						}
 					}
 					process_packet__parse_custom_headers(call, packetS);
@@ -3949,7 +3955,7 @@ void process_packet_sip_call(packet_s_process *packetS) {
 			if(lastSIPresponseNum == 481) {
 				// 481 CallLeg/Transaction doesnt exist - set timeout to 180 seconds
 				if(call->is_enable_set_destroy_call_at_for_call(&packetS->cseq, merged)) {
-					call->destroy_call_at = packetS->getTime_s() + 180;
+					call->set_destroy_call_at(packetS->getTime_s() + 180);
 				}
 			} else if(lastSIPresponseNum == 491) {
 				// do not set timeout for 491
@@ -3961,7 +3967,7 @@ void process_packet_sip_call(packet_s_process *packetS) {
 						detect_branch(packetS, branch, sizeof(branch), &branch_detected);
 						call->cancel_ip_port_hash(packetS->daddr_(), to, branch, packetS->getTimeval_pt());
 					}
-					call->destroy_call_at = packetS->getTime_s() + (packetS->sip_method == RES300 ? 300 : 5);
+					call->set_destroy_call_at(packetS->getTime_s() + (packetS->sip_method == RES300 ? 300 : 5));
 				}
 				if(lastSIPresponseNum == 488 || lastSIPresponseNum == 606) {
 					call->not_acceptable = true;
@@ -3977,7 +3983,7 @@ void process_packet_sip_call(packet_s_process *packetS) {
 				goto endsip_save_packet;
 			} else if(!call->destroy_call_at) {
 				if(call->is_enable_set_destroy_call_at_for_call(&packetS->cseq, merged)) {
-					call->destroy_call_at = packetS->getTime_s() + 60;
+					call->set_destroy_call_at(packetS->getTime_s() + 60);
 				}
 			}
 		} else if(packetS->cseq.method == BYE &&
@@ -4441,7 +4447,7 @@ void process_packet_sip_alone_bye(packet_s_process *packetS) {
 	if(!call) {
 		return;
 	}
-	call->destroy_call_at = packetS->getTime_s() + 60;
+	call->set_destroy_call_at(packetS->getTime_s() + 60);
 	if(IS_SIP_RESXXX(packetS->sip_method) && packetS->cseq.is_set() &&
 	   packetS->cseq.method == BYE && 
 	   call->existsByeCseq(&packetS->cseq)) {
@@ -4619,7 +4625,7 @@ void process_packet_sip_register(packet_s_process *packetS) {
 		save_packet(call, packetS, TYPE_SIP);
 		if(call->regstate == 1 &&
 		   call->reg200count + call->reg401count_all < call->regcount) {
-			call->destroy_call_at = packetS->getTime_s() + opt_register_timeout;
+			call->set_destroy_call_at(packetS->getTime_s() + opt_register_timeout);
 		} else {
 			call->saveregister(packetS->getTimeval_pt());
 		}
@@ -4686,7 +4692,7 @@ void process_packet_sip_register(packet_s_process *packetS) {
 			   (packetS->sip_method == RES404 && call->reg404count >= call->regcount_after_4xx)) {
 				call->saveregister(packetS->getTimeval_pt());
 			} else {
-				call->destroy_call_at = packetS->getTime_s() + 1;
+				call->set_destroy_call_at(packetS->getTime_s() + 1);
 			}
 			if(logPacketSipMethodCall_enable) {
 				logPacketSipMethodCallDescr =
@@ -6377,7 +6383,145 @@ void readdump_libnids(pcap_t *handle) {
 #endif
 */
 
-inline void ipfrag_delete_node(ip_frag_s *node, int pushToStack_queue_index) {
+sIpFragStat ipfrag_stat;
+
+ipfrag_data_s::ipfrag_data_s() {
+	nodes = NULL;
+	nodes_free = NULL;
+	nodes_count = 0;
+	queues = NULL;
+	queues_free = NULL;
+	table = NULL;
+	table_mask = 0;
+	expire_first = NULL;
+	expire_last = NULL;
+	size = 0;
+	max_size = 0;
+}
+
+ipfrag_data_s::~ipfrag_data_s() {
+	term();
+}
+
+void ipfrag_data_s::init() {
+	extern int opt_udpfrag_max_fragments;
+	extern int opt_udpfrag_max_mem;
+	nodes_count = opt_udpfrag_max_fragments > 0 ? opt_udpfrag_max_fragments : IPFRAG_MAX_FRAGMENTS_DEFAULT;
+	max_size = (u_int64_t)(opt_udpfrag_max_mem > 0 ? opt_udpfrag_max_mem : IPFRAG_MAX_MEM_MB_DEFAULT) * 1024 * 1024;
+	nodes = new FILE_LINE(0) ip_frag_s[nodes_count];
+	queues = new FILE_LINE(0) ip_frag_queue[nodes_count];
+	for(unsigned i = 0; i < nodes_count; i++) {
+		nodes[i].next = i < nodes_count - 1 ? &nodes[i + 1] : NULL;
+		queues[i].expire_next = i < nodes_count - 1 ? &queues[i + 1] : NULL;
+	}
+	nodes_free = nodes;
+	queues_free = queues;
+	// load factor of table <= 0.5
+	u_int32_t table_size = 1;
+	while(table_size < nodes_count * 2) {
+		table_size <<= 1;
+	}
+	table = new FILE_LINE(0) ip_frag_queue*[table_size];
+	memset(table, 0, table_size * sizeof(ip_frag_queue*));
+	table_mask = table_size - 1;
+}
+
+void ipfrag_data_s::term() {
+	if(!nodes) {
+		return;
+	}
+	ipfrag_prune(0, true, this, -1, 0);
+	delete [] nodes;
+	delete [] queues;
+	delete [] table;
+	nodes = NULL;
+	nodes_free = NULL;
+	queues = NULL;
+	queues_free = NULL;
+	table = NULL;
+}
+
+ip_frag_queue *ipfrag_data_s::add_queue(vmIP &saddr, vmIP &daddr, u_int32_t id, u_int8_t protocol, u_int32_t hash, time_t ts) {
+	ip_frag_queue *queue = queues_free;
+	if(!queue) {
+		return(NULL);
+	}
+	queues_free = queue->expire_next;
+	queue->saddr = saddr;
+	queue->daddr = daddr;
+	queue->id = id;
+	queue->protocol = protocol;
+	queue->has_last = false;
+	queue->hash = hash;
+	queue->count = 0;
+	queue->size = 0;
+	queue->ts = ts;
+	queue->first = NULL;
+	u_int32_t i = hash & table_mask;
+	while(table[i]) {
+		i = (i + 1) & table_mask;
+	}
+	table[i] = queue;
+	queue->table_index = i;
+	queue->expire_prev = expire_last;
+	queue->expire_next = NULL;
+	if(expire_last) {
+		expire_last->expire_next = queue;
+	} else {
+		expire_first = queue;
+	}
+	expire_last = queue;
+	return(queue);
+}
+
+void ipfrag_data_s::remove_queue(ip_frag_queue *queue) {
+	// backward shift deletion - keeps probe sequences without tombstones
+	u_int32_t i = queue->table_index;
+	table[i] = NULL;
+	for(u_int32_t j = (i + 1) & table_mask; table[j]; j = (j + 1) & table_mask) {
+		u_int32_t k = table[j]->hash & table_mask;
+		if((j > i && (k <= i || k > j)) ||
+		   (j < i && (k <= i && k > j))) {
+			table[i] = table[j];
+			table[i]->table_index = i;
+			table[j] = NULL;
+			i = j;
+		}
+	}
+	if(queue->expire_prev) {
+		queue->expire_prev->expire_next = queue->expire_next;
+	} else {
+		expire_first = queue->expire_next;
+	}
+	if(queue->expire_next) {
+		queue->expire_next->expire_prev = queue->expire_prev;
+	} else {
+		expire_last = queue->expire_prev;
+	}
+	size -= queue->size;
+	queue->expire_next = queues_free;
+	queues_free = queue;
+}
+
+string sIpFragStat::getStatString() {
+	u_int64_t _reassembled = reassembled;
+	u_int64_t _timeout = timeout;
+	u_int64_t _evicted = evicted;
+	string rslt;
+	if(_reassembled > last_reassembled || _timeout > last_timeout || _evicted > last_evicted) {
+		ostringstream outStr;
+		outStr << "defrag[R:" << (_reassembled - last_reassembled)
+		       << " T:" << (_timeout - last_timeout)
+		       << " E:" << (_evicted - last_evicted) << "] ";
+		rslt = outStr.str();
+	}
+	last_reassembled = _reassembled;
+	last_timeout = _timeout;
+	last_evicted = _evicted;
+	return(rslt);
+}
+
+inline void ipfrag_delete_node(ip_frag_s *node, ipfrag_data_s *ipfrag_data, int pushToStack_queue_index) {
 	if(node->header_packet) {
 		PUSH_HP(&node->header_packet, pushToStack_queue_index);
 	}
@@ -6385,7 +6529,30 @@ inline void ipfrag_delete_node(ip_frag_s *node, int pushToStack_queue_index) {
 		((sHeaderPacketPQout*)node->header_packet_pqout)->destroy_or_unlock_blockstore();
 		delete ((sHeaderPacketPQout*)node->header_packet_pqout);
 	}
-	delete node;
+	ipfrag_data->free_node(node);
+}
+
+inline void ipfrag_delete_queue(ip_frag_queue *queue, ipfrag_data_s *ipfrag_data, int pushToStack_queue_index) {
+	for(ip_frag_s *node = queue->first; node; ) {
+		ip_frag_s *next = node->next;
+		ipfrag_delete_node(node, ipfrag_data, pushToStack_queue_index);
+		node = next;
+	}
+	queue->first = NULL;
+	ipfrag_data->remove_queue(queue);
+}
+
+inline bool ipfrag_evict_oldest(ipfrag_data_s *ipfrag_data, ip_frag_queue *except_queue, int pushToStack_queue_index) {
+	ip_frag_queue *queue = ipfrag_data->expire_first;
+	if(queue == except_queue) {
+		queue = queue->expire_next;
+	}
+	if(!queue) {
+		return(false);
+	}
+	ipfrag_delete_queue(queue, ipfrag_data, pushToStack_queue_index);
+	__sync_fetch_and_add(&ipfrag_stat.evicted, 1);
+	return(true);
 }
 
 /*
@@ -6394,46 +6561,40 @@ defragment packets from queue and allocates memory for new header and packet whi
 in **header an **packet 
 
 */
-inline int _ipfrag_dequeue(ip_frag_queue *queue, 
+inline int _ipfrag_dequeue(ip_frag_queue *queue, ipfrag_data_s *ipfrag_data,
 			   sHeaderPacket **header_packet, sHeaderPacketPQout *header_packet_pqout,
 			   int pushToStack_queue_index) {
 	//walk queue
 
 	if(!queue) return 1;
-	if(!queue->size()) return 1;
+	if(!queue->count) return 1;
 
 	// prepare newpacket structure and header structure
-	u_int32_t totallen = queue->begin()->second->header_ip_offset;
-	unsigned i = 0;
-	for (ip_frag_queue_it_t it = queue->begin(); it != queue->end(); ++it) {
-		totallen += it->second->len;
-		if(i) {
-			totallen -= it->second->iphdr_len;
+	u_int32_t totallen = queue->first->header_ip_offset;
+	for (ip_frag_s *node = queue->first; node; node = node->next) {
+		totallen += node->len;
+		if(node != queue->first) {
+			totallen -= node->iphdr_len;
 		}
-		i++;
 	}
-	if(totallen > 0xFFFF + queue->begin()->second->header_ip_offset) {
+	if(totallen > 0xFFFF + queue->first->header_ip_offset) {
 		if(sverb.defrag_overflow) {
-			ip_frag_queue_it_t it = queue->begin();
-			if(it != queue->end()) {
-				ip_frag_s *node = it->second;
-				iphdr2 *iph = (iphdr2*)((u_char*)HPP(node->header_packet) + node->header_ip_offset);
-				syslog(LOG_NOTICE, "ipfrag overflow: %i src ip: %s dst ip: %s", totallen, iph->get_saddr().getString().c_str(), iph->get_daddr().getString().c_str());
-			}
+			ip_frag_s *node = queue->first;
+			iphdr2 *iph = (iphdr2*)((u_char*)HPP(node->header_packet) + node->header_ip_offset);
+			syslog(LOG_NOTICE, "ipfrag overflow: %i src ip: %s dst ip: %s", totallen, iph->get_saddr().getString().c_str(), iph->get_daddr().getString().c_str());
 		}
-		totallen = 0xFFFF + queue->begin()->second->header_ip_offset;
+		totallen = 0xFFFF + queue->first->header_ip_offset;
 	}
 	
 	unsigned int additionallen = 0;
 	iphdr2 *iphdr = NULL;
-	i = 0;
 	unsigned int len = 0;
 	
 	if(header_packet) {
 		*header_packet = CREATE_HP(totallen);
-		for (ip_frag_queue_it_t it = queue->begin(); it != queue->end(); ++it) {
-			ip_frag_s *node = it->second;
-			if(i == 0) {
+		for (ip_frag_s *node = queue->first; node; ) {
+			ip_frag_s *next = node->next;
+			if(node == queue->first) {
 				// for first packet copy ethernet header and ip header
 				if(node->header_ip_offset) {
 					memcpy_heapsafe(HPP(*header_packet), *header_packet,
@@ -6456,15 +6617,15 @@ inline int _ipfrag_dequeue(ip_frag_queue *queue,
 					additionallen += cpy_len;
 				}
 			}
-			if(i == queue->size() - 1) {
+			if(!next) {
 				memcpy_heapsafe(HPH(*header_packet), *header_packet, 
 						HPH(node->header_packet), node->header_packet,
 						sizeof(struct pcap_pkthdr));
 				HPH(*header_packet)->len = totallen;
 				HPH(*header_packet)->caplen = totallen;
 			}
-			ipfrag_delete_node(node, pushToStack_queue_index);
-			i++;
+			ipfrag_delete_node(node, ipfrag_data, pushToStack_queue_index);
+			node = next;
 		}
 	} else {
 		header_packet_pqout->header = new FILE_LINE(26012) pcap_pkthdr_plus;
@@ -6472,9 +6633,9 @@ inline int _ipfrag_dequeue(ip_frag_queue *queue,
 		header_packet_pqout->block_store = NULL;
 		header_packet_pqout->block_store_index = 0;
 		header_packet_pqout->block_store_locked = false;
-		for (ip_frag_queue_it_t it = queue->begin(); it != queue->end(); ++it) {
-			ip_frag_s *node = it->second;
-			if(i == 0) {
+		for (ip_frag_s *node = queue->first; node; ) {
+			ip_frag_s *next = node->next;
+			if(node == queue->first) {
 				// for first packet copy ethernet header and ip header
 				if(node->header_ip_offset) {
 					memcpy_heapsafe(header_packet_pqout->packet, header_packet_pqout->packet,
@@ -6507,7 +6668,7 @@ inline int _ipfrag_dequeue(ip_frag_queue *queue,
 					additionallen += cpy_len;
 				}
 			}
-			if(i == queue->size() - 1) {
+			if(!next) {
 				memcpy_heapsafe(header_packet_pqout->header, header_packet_pqout->header,
 						((sHeaderPacketPQout*)node->header_packet_pqout)->header,
 						((sHeaderPacketPQout*)node->header_packet_pqout)->block_store ?
@@ -6517,10 +6678,12 @@ inline int _ipfrag_dequeue(ip_frag_queue *queue,
 				header_packet_pqout->header->set_len(totallen);
 				header_packet_pqout->header->set_caplen(totallen);
 			}
-			ipfrag_delete_node(node, 0);
-			i++;
+			ipfrag_delete_node(node, ipfrag_data, 0);
+			node = next;
 		}
 	}
+	queue->first = NULL;
+	queue->count = 0;
 	if(iphdr) {
 		//increase IP header length 
 		iphdr->set_tot_len(iphdr->get_tot_len() + additionallen);
@@ -6533,22 +6696,7 @@ inline int _ipfrag_dequeue(ip_frag_queue *queue,
 	return 1;
 }
 
-inline int ipfrag_dequeue(ip_frag_queue *queue,
-			  sHeaderPacket **header_packet,
-			  int pushToStack_queue_index) {
-	return(_ipfrag_dequeue(queue,
-			       header_packet, NULL,
-			       pushToStack_queue_index));
-}
-
-inline int ipfrag_dequeue(ip_frag_queue *queue,
-			  sHeaderPacketPQout *header_packet_pqout) {
-	return(_ipfrag_dequeue(queue,
-			       NULL, header_packet_pqout,
-			       -1));
-}
-
-inline int _ipfrag_add(ip_frag_queue *queue, 
+inline int _ipfrag_add(ip_frag_queue *queue, ipfrag_data_s *ipfrag_data,
 		       sHeaderPacket **header_packet, sHeaderPacketPQout *header_packet_pqout,
 		       unsigned int header_ip_offset, unsigned int len,
 		       int pushToStack_queue_index) {
@@ -6560,49 +6708,66 @@ inline int _ipfrag_add(ip_frag_queue *queue,
 	u_int16_t frag_data = header_ip->get_frag_data();
 	unsigned int offset_d = header_ip->get_frag_offset(frag_data);
 
+	// find position in queue sorted by offset
+	ip_frag_s **node_pos = &queue->first;
+	while(*node_pos && (*node_pos)->offset < offset_d) {
+		node_pos = &(*node_pos)->next;
+	}
+	if(*node_pos && (*node_pos)->offset == offset_d) {
+		// node with that offset already exists - discard
+		return -1;
+	}
+
+	// hard limit of held fragments - the oldest queues are evicted
+	while(ipfrag_data->size + len > ipfrag_data->max_size) {
+		if(!ipfrag_evict_oldest(ipfrag_data, queue, pushToStack_queue_index)) {
+			return -1;
+		}
+	}
+	ip_frag_s *node = ipfrag_data->alloc_node();
+	while(!node) {
+		if(!ipfrag_evict_oldest(ipfrag_data, queue, pushToStack_queue_index)) {
+			return -1;
+		}
+		node = ipfrag_data->alloc_node();
+	}
+
 	if(!header_ip->is_more_frag(frag_data) && offset_d) {
 		// this packet do not set more fragment indicator but contains offset which means that it is the last packet
 		queue->has_last = true;
 	}
 
-	if(!queue->count(offset_d)) {
-		// this offset number is not yet in the queue - add packet to queue which automatically sort it into right position
-
-		// create node
-		ip_frag_s *node = new FILE_LINE(26014) ip_frag_s;
-
-		if(header_packet) {
-			node->ts = HPH(*header_packet)->ts.tv_sec;
-			node->header_packet = *header_packet;
-			node->header_packet_pqout = NULL;
-			*header_packet = NULL;
-		} else {
-			node->ts = header_packet_pqout->header->get_tv_sec();
-			node->header_packet_pqout = new FILE_LINE(26015) sHeaderPacketPQout;
-			node->header_packet = NULL;
-			*(sHeaderPacketPQout*)node->header_packet_pqout = *header_packet_pqout;
-			((sHeaderPacketPQout*)node->header_packet_pqout)->alloc_and_copy_blockstore();
-		}
-		
-		node->header_ip_offset = header_ip_offset;
-		node->len = len;
-		node->offset = offset_d;
-		node->iphdr_len = header_ip->get_hdr_size();
-
-		// add to queue (which will sort it automatically
-		(*queue)[offset_d] = node;
+	if(header_packet) {
+		node->ts = HPH(*header_packet)->ts.tv_sec;
+		node->header_packet = *header_packet;
+		node->header_packet_pqout = NULL;
+		*header_packet = NULL;
 	} else {
-		// node with that offset already exists - discard
-		return -1;
+		node->ts = header_packet_pqout->header->get_tv_sec();
+		node->header_packet_pqout = new FILE_LINE(26015) sHeaderPacketPQout;
+		node->header_packet = NULL;
+		*(sHeaderPacketPQout*)node->header_packet_pqout = *header_packet_pqout;
+		((sHeaderPacketPQout*)node->header_packet_pqout)->alloc_and_copy_blockstore();
 	}
+	
+	node->header_ip_offset = header_ip_offset;
+	node->len = len;
+	node->offset = offset_d;
+	node->iphdr_len = header_ip->get_hdr_size();
+
+	// insert to queue on sorted position
+	node->next = *node_pos;
+	*node_pos = node;
+	++queue->count;
+	queue->size += len;
+	ipfrag_data->size += len;
 
 	// now check if packets in queue are complete - if yes - defragment - if not, do nithing
 	int ok = true;
 	unsigned int lastoffset = 0;
-	if(queue->has_last and queue->begin()->second->offset == 0) {
+	if(queue->has_last and queue->first->offset == 0) {
 		// queue has first and last packet - check if there are all middle fragments
-		for (ip_frag_queue_it_t it = queue->begin(); it != queue->end(); ++it) {
-			ip_frag_s *node = it->second;
+		for (ip_frag_s *node = queue->first; node; node = node->next) {
 			if((node->offset != lastoffset)) {
 				ok = false;
 				break;
@@ -6616,32 +6781,13 @@ inline int _ipfrag_add(ip_frag_queue *queue,
 
 	if(ok) {
 		// all packets -> defragment 
-		_ipfrag_dequeue(queue, header_packet, header_packet_pqout, pushToStack_queue_index);
+		_ipfrag_dequeue(queue, ipfrag_data, header_packet, header_packet_pqout, pushToStack_queue_index);
 		return 1;
 	} else {
 		return 0;
 	}
 }
 
-inline int ipfrag_add(ip_frag_queue *queue, 
-		      sHeaderPacket **header_packet, 
-		      unsigned int header_ip_offset, unsigned int len,
-		      int pushToStack_queue_index) {
-	return(_ipfrag_add(queue, 
-			   header_packet, NULL,
-			   header_ip_offset, len,
-			   pushToStack_queue_index));
-}
-
-inline int ipfrag_add(ip_frag_queue *queue, 
-		      sHeaderPacketPQout *header_packet_pqout, 
-		      unsigned int header_ip_offset, unsigned int len) {
-	return(_ipfrag_add(queue, 
-			   NULL, header_packet_pqout,
-			   header_ip_offset, len,
-			   -1));
-}
-
 /* 
 
 function inserts packet into fragmentation queue and if all packets within fragmented IP are 
@@ -6657,33 +6803,48 @@ inline int _handle_defrag(iphdr2 *header_ip,
 			  ipfrag_data_s *ipfrag_data,
 			  int pushToStack_queue_index) {
  
-	//copy header ip to tmp beacuse it can happen that during exectuion of this function the header_ip can be 
+	//copy key of queue beacuse it can happen that during exectuion of this function the header_ip can be 
 	//overwriten in kernel ringbuffer if the ringbuffer is small and thus header_ip->saddr can have different value 
-	iphdr2 *header_ip_orig = (iphdr2*)new FILE_LINE(0) u_char[header_ip->get_hdr_size()];
-	memcpy(header_ip_orig, header_ip, header_ip->get_hdr_size());
+	vmIP saddr = header_ip->get_saddr();
+	vmIP daddr = header_ip->get_daddr();
+	u_int32_t id = header_ip->get_frag_id();
+	u_int8_t protocol = header_ip->get_protocol();
+	unsigned int tot_len = header_ip->get_tot_len();
+	
+	if(!ipfrag_data->nodes) {
+		ipfrag_data->init();
+	}
 
-	// get queue from ip_frag_stream based on source ip address and ip->id identificator (2-dimensional map array)
-	ip_frag_queue *queue = ipfrag_data->ip_frag_stream[header_ip_orig->get_saddr()][header_ip_orig->get_frag_id()];
+	// get queue from open-addressed table based on (src, dst, id, protocol)
+	u_int32_t hash = ipfrag_data_s::hash(saddr, daddr, id, protocol);
+	ip_frag_queue *queue = ipfrag_data->find(saddr, daddr, id, protocol, hash);
 	if(!queue) {
-		// queue does not exists yet - create it and assign to map 
-		queue = new FILE_LINE(26016) ip_frag_queue;
-		ipfrag_data->ip_frag_stream[header_ip_orig->get_saddr()][header_ip_orig->get_frag_id()] = queue;
+		// queue does not exists yet - create it, the oldest queue is evicted if slab is exhausted
+		time_t ts = header_packet ?
+			     HPH(*header_packet)->ts.tv_sec :
+			     header_packet_pqout->header->get_tv_sec();
+		while(!(queue = ipfrag_data->add_queue(saddr, daddr, id, protocol, hash, ts))) {
+			if(!ipfrag_evict_oldest(ipfrag_data, NULL, pushToStack_queue_index)) {
+				return -1;
+			}
+		}
 	}
 	int res = header_packet ?
-		   ipfrag_add(queue,
-			      header_packet, 
-			      (u_char*)header_ip - HPP(*header_packet), header_ip_orig->get_tot_len(),
-			      pushToStack_queue_index) :
-		   ipfrag_add(queue,
-			      header_packet_pqout, 
-			      (u_char*)header_ip - header_packet_pqout->packet, header_ip_orig->get_tot_len());
+		   _ipfrag_add(queue, ipfrag_data,
+			       header_packet, NULL,
+			       (u_char*)header_ip - HPP(*header_packet), tot_len,
+			       pushToStack_queue_index) :
+		   _ipfrag_add(queue, ipfrag_data,
+			       NULL, header_packet_pqout, 
+			       (u_char*)header_ip - header_packet_pqout->packet, tot_len,
+			       -1);
 	if(res > 0) {
-		// packet was created from all pieces - delete queue and remove it from map
-		ipfrag_data->ip_frag_stream[header_ip_orig->get_saddr()].erase(header_ip_orig->get_frag_id());
-		delete queue;
-	};
-	
-	delete header_ip_orig;
+		// packet was created from all pieces - remove queue
+		ipfrag_data->remove_queue(queue);
+		__sync_fetch_and_add(&ipfrag_stat.reassembled, 1);
+	} else if(!queue->count) {
+		ipfrag_data->remove_queue(queue);
+	}
 	
 	return res;
 }
@@ -6705,25 +6866,15 @@ void ipfrag_prune(unsigned int tv_sec, bool all, ipfrag_data_s *ipfrag_data,
 	if(prune_limit < 0) {
 		prune_limit = 30;
 	}
-	ip_frag_queue *queue;
-	for (ipfrag_data->ip_frag_streamIT = ipfrag_data->ip_frag_stream.begin(); ipfrag_data->ip_frag_streamIT != ipfrag_data->ip_frag_stream.end(); ipfrag_data->ip_frag_streamIT++) {
-		for (ipfrag_data->ip_frag_streamITinner = (*ipfrag_data->ip_frag_streamIT).second.begin(); ipfrag_data->ip_frag_streamITinner != (*ipfrag_data->ip_frag_streamIT).second.end();) {
-			queue = ipfrag_data->ip_frag_streamITinner->second;
-			if(!queue->size()) {
-				ipfrag_data->ip_frag_streamIT->second.erase(ipfrag_data->ip_frag_streamITinner++);
-				delete queue;
-				continue;
-			}
-			if(all or ((tv_sec - queue->begin()->second->ts) > prune_limit)) {
-				for (ip_frag_queue_it_t it = queue->begin(); it != queue->end(); ++it) {
-					ip_frag_s *node = it->second;
-					ipfrag_delete_node(node, pushToStack_queue_index);
-				}
-				ipfrag_data->ip_frag_streamIT->second.erase(ipfrag_data->ip_frag_streamITinner++);
-				delete queue;
-				continue;
-			}
-			ipfrag_data->ip_frag_streamITinner++;
+	// queues are in expire list ordered by creation - only expired queues from the head are visited
+	while(ipfrag_data->expire_first) {
+		ip_frag_queue *queue = ipfrag_data->expire_first;
+		if(!all && (int)(tv_sec - queue->ts) <= prune_limit) {
+			break;
+		}
+		ipfrag_delete_queue(queue, ipfrag_data, pushToStack_queue_index);
+		if(!all) {
+			__sync_fetch_and_add(&ipfrag_stat.timeout, 1);
 		}
 	}
 }
@@ -7639,6 +7790,7 @@ PreProcessPacket::PreProcessPacket(eTypePreProcessThread typePreProcessThread, u
 			      opt_preprocess_packets_qring_length / this->qring_batch_item_length;
 	this->readit = 0;
 	this->writeit = 0;
+	threadPlacement.setMemoryNode();
 	if(typePreProcessThread == ppt_detach) {
 		this->qring_detach = new FILE_LINE(26022) batch_packet_s*[this->qring_length];
 		for(unsigned int i = 0; i < this->qring_length; i++) {
@@ -7654,6 +7806,7 @@ PreProcessPacket::PreProcessPacket(eTypePreProcessThread typePreProcessThread, u
 		}
 		this->qring_detach = NULL;
 	}
+	threadPlacement.resetMemoryNode();
 	this->qring_push_index = 0;
 	this->qring_push_index_count = 0;
 	memset(this->threadPstatData, 0, sizeof(this->threadPstatData));
@@ -7663,6 +7816,9 @@ PreProcessPacket::PreProcessPacket(eTypePreProcessThread typePreProcessThread, u
 	this->_sync_push = 0;
 	this->_sync_count = 0;
 	this->term_preProcess = false;
+	string syncWaitName = "t2 " + this->getNameTypeThread() + (typePreProcessThread == ppt_pp_callx ? " " + intToString(idPreProcessThread) : "");
+	this->qringWaitPush.setName(syncWaitName + " push");
+	this->qringWaitPop.setName(syncWaitName + " pop");
 	if(typePreProcessThread == ppt_detach) {
 		this->stackSip = new FILE_LINE(26026) cHeapItemsPointerStack(opt_preprocess_packets_qring_item_length ?
 									      opt_preprocess_packets_qring_item_length * opt_preprocess_packets_qring_length :
@@ -7684,6 +7840,7 @@ PreProcessPacket::PreProcessPacket(eTypePreProcessThread typePreProcessThread, u
 	this->outThreadState = 0;
 	allocCounter[0] = allocCounter[1] = 0;
 	allocStackCounter[0] = allocStackCounter[1] = 0;
+	processedPacketsCounter = 0;
 	getCpuUsagePerc_counter = 0;
 	getCpuUsagePerc_counter_at_start_out_thread = 0;
 }
@@ -7763,6 +7920,7 @@ void *PreProcessPacket::outThreadFunction() {
 					this->process_DETACH_plus(batch_detach->batch[batch_index]);
 					batch_detach->batch[batch_index]->_packet_alloc = false;
 				}
+				processedPacketsCounter += batch_detach->count;
 				#if RQUEUE_SAFE
 					__SYNC_NULL(batch_detach->count);
 					__SYNC_NULL(batch_detach->used);
@@ -7775,6 +7933,7 @@ void *PreProcessPacket::outThreadFunction() {
 				__SYNC_LOCK(this->_sync_count);
 				unsigned count = batch->count;
 				__SYNC_UNLOCK(this->_sync_count);
+				processedPacketsCounter += count;
 				for(unsigned batch_index = 0; batch_index < count; batch_index++) {
 					packetS = batch->batch[batch_index];
 					batch->batch[batch_index] = NULL;
@@ -7855,6 +8014,7 @@ void *PreProcessPacket::outThreadFunction() {
 					this->readit++;
 				}
 			#endif
+			qringWaitPush.wake();
 			usleepCounter = 0;
 			usleepSumTimeForPushBatch = 0;
 		} else {
@@ -7932,7 +8092,11 @@ void *PreProcessPacket::outThreadFunction() {
 				}
 				usleepSumTimeForPushBatch = 0;
 			}
-			usleepSumTimeForPushBatch += USLEEP_C(opt_preprocess_packets_qring_usleep, usleepCounter++);
+			usleepSumTimeForPushBatch += SYNC_WAIT(qringWaitPop,
+							       this->typePreProcessThread == ppt_detach ?
+								this->qring_detach[this->readit]->used :
+								this->qring[this->readit]->used,
+							       0, opt_preprocess_packets_qring_usleep, usleepCounter);
 		}
 	}
 	this->outThreadState = 0;
@@ -8700,11 +8864,13 @@ ProcessRtpPacket::ProcessRtpPacket(eType type, int indexThread) {
 			      opt_process_rtp_packets_qring_length / this->qring_batch_item_length;
 	this->readit = 0;
 	this->writeit = 0;
+	threadPlacement.setMemoryNode();
 	this->qring = new FILE_LINE(26028) batch_packet_s_process*[this->qring_length];
 	for(unsigned int i = 0; i < this->qring_length; i++) {
 		this->qring[i] = new FILE_LINE(26029) batch_packet_s_process(this->qring_batch_item_length);
 		this->qring[i]->used = 0;
 	}
+	threadPlacement.resetMemoryNode();
 	this->hash_find_flag = new FILE_LINE(26030) volatile int[this->qring_batch_item_length];
 	this->qring_push_index = 0;
 	this->qring_push_index_count = 0;
@@ -8712,6 +8878,7 @@ ProcessRtpPacket::ProcessRtpPacket(eType type, int indexThread) {
 	memset(this->threadPstatData, 0, sizeof(this->threadPstatData));
 	this->qringPushCounter = 0;
 	this->qringPushCounter_full = 0;
+	this->processedPacketsCounter = 0;
 	this->outThreadId = 0;
 	this->term_processRtp = false;
 	for(int i = 0; i < MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS; i++) {
@@ -8720,7 +8887,14 @@ ProcessRtpPacket::ProcessRtpPacket(eType type, int indexThread) {
 		this->hash_thread_data[i].null();
 	}
 	this->_sync_count = 0;
-	vm_pthread_create((string("t2 rtp preprocess ") + (type == hash ? "hash" : "distribute")).c_str(),
+	this->use_hash_cache = opt_rtp_hash_cache > 0;
+	for(int i = 0; i < 1 + MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS; i++) {
+		this->hash_cache[i] = NULL;
+	}
+	string syncWaitName = string("t2 rtp ") + (type == hash ? "hash" : "distribute " + intToString(indexThread));
+	this->qringWaitPush.setName(syncWaitName + " push");
+	this->qringWaitPop.setName(syncWaitName + " pop");
+	vm_pthread_create((string("t2 rtp preprocess ") + (type == hash ? "hash" : "distribute " + intToString(indexThread))).c_str(),
 			  &this->out_thread_handle, NULL, _ProcessRtpPacket_outThreadFunction, this, __FILE__, __LINE__);
 	this->process_rtp_packets_hash_next_threads = opt_process_rtp_packets_hash_next_thread;
 	if(type == hash && this->process_rtp_packets_hash_next_threads) {
@@ -8744,6 +8918,11 @@ ProcessRtpPacket::~ProcessRtpPacket() {
 	}
 	delete [] this->qring;
 	delete [] this->hash_find_flag;
+	for(int i = 0; i < 1 + MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS; i++) {
+		if(this->hash_cache[i]) {
+			delete this->hash_cache[i];
+		}
+	}
 }
 
 void *ProcessRtpPacket::outThreadFunction() {
@@ -8781,6 +8960,7 @@ void *ProcessRtpPacket::outThreadFunction() {
 			} else {
 				this->rtp_batch(batch, count);
 			}
+			processedPacketsCounter += count;
 			#if RQUEUE_SAFE
 				__SYNC_NULL(batch->count);
 				__SYNC_NULL(batch->used);
@@ -8794,6 +8974,7 @@ void *ProcessRtpPacket::outThreadFunction() {
 					this->readit++;
 				}
 			#endif
+			qringWaitPush.wake();
 			usleepCounter = 0;
 			usleepSumTimeForPushBatch = 0;
 		} else {
@@ -8825,7 +9006,7 @@ void *ProcessRtpPacket::outThreadFunction() {
 				}
 				usleepSumTimeForPushBatch = 0;
 			}
-			usleepSumTimeForPushBatch += USLEEP_C(opt_process_rtp_packets_qring_usleep, usleepCounter++);
+			usleepSumTimeForPushBatch += SYNC_WAIT(qringWaitPop, this->qring[this->readit]->used, 0, opt_process_rtp_packets_qring_usleep, usleepCounter);
 		}
 	}
 	return(NULL);
@@ -8853,7 +9034,7 @@ void *ProcessRtpPacket::nextThreadFunction(int next_thread_index_plus) {
 			    batch_index += batch_index_skip) {
 				packet_s_process_0 *packetS = hash_thread_data->batch->batch[batch_index];
 				packetS->init2_rtp();
-				this->find_hash(packetS, false);
+				this->find_hash(packetS, false, next_thread_index_plus);
 				if(packetS->call_info_length > 0) {
 					this->hash_find_flag[batch_index] = 1;
 				} else {
@@ -8882,7 +9063,11 @@ void ProcessRtpPacket::rtp_batch(batch_packet_s_process *batch, unsigned count)
 		for(unsigned batch_index = 0; batch_index < count; batch_index++) {
 			this->hash_find_flag[batch_index] = 0;
 		}
-		calltable->lock_calls_hash();
+		// with hash cache find_hash locks calls hash only on cache miss
+		bool lock_calls_hash = !this->use_hash_cache;
+		if(lock_calls_hash) {
+			calltable->lock_calls_hash();
+		}
 		if(this->next_thread_handle[0]) {
 			for(int i = 0; i < MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS; i++) {
 				this->hash_thread_data[i].null();
@@ -8957,7 +9142,9 @@ void ProcessRtpPacket::rtp_batch(batch_packet_s_process *batch, unsigned count)
 				}
 			}
 		}
-		calltable->unlock_calls_hash();
+		if(lock_calls_hash) {
+			calltable->unlock_calls_hash();
+		}
 		for(;batch_index_distribute < count; batch_index_distribute++) {
 			packet_s_process_0 *packetS = batch->batch[batch_index_distribute];
 			batch->batch[batch_index_distribute] = NULL;
@@ -9035,10 +9222,112 @@ inline void ProcessRtpPacket::rtp_packet_distr(packet_s_process_0 *packetS, int
 	}
 }
 
-void ProcessRtpPacket::find_hash(packet_s_process_0 *packetS, bool lock) {
+static inline bool rtp_call_info_accept(packet_s_process_0 *packetS, Call *call, int other_side_in_hash) {
+	// other_side_in_hash: -1 - check in calls hash (requires lock_calls_hash), 0 / 1 - known result
+	return((!(call->typeIs(SKINNY_NEW) ? opt_rtpfromsdp_onlysip_skinny : opt_rtpfromsdp_onlysip) ||
+		(packetS->call_info_find_by_dest ?
+		  call->checkKnownIP_inSipCallerdIP(packetS->saddr_()) :
+		  call->checkKnownIP_inSipCallerdIP(packetS->daddr_())) ||
+		((other_side_in_hash >= 0 ?
+		   other_side_in_hash > 0 :
+		   (packetS->call_info_find_by_dest ?
+		     calltable->check_call_in_hashfind_by_ip_port(call, packetS->saddr_(), packetS->source_(), false) :
+		     calltable->check_call_in_hashfind_by_ip_port(call, packetS->daddr_(), packetS->dest_(), false))) &&
+		 (packetS->call_info_find_by_dest ?
+		   call->checkKnownIP_inSipCallerdIP(packetS->daddr_()) :
+		   call->checkKnownIP_inSipCallerdIP(packetS->saddr_())))) &&
+	       !(opt_ignore_rtp_after_bye_confirmed &&
+		 call->seenbyeandok && call->seenbyeandok_time_usec &&
+		 packetS->getTimeUS() > call->seenbyeandok_time_usec) &&
+	       !(opt_ignore_rtp_after_cancel_confirmed &&
+		 call->seencancelandok && call->seencancelandok_time_usec &&
+		 packetS->getTimeUS() > call->seencancelandok_time_usec) &&
+	       !(opt_ignore_rtp_after_auth_failed &&
+		 call->seenauthfailed && call->seenauthfailed_time_usec &&
+		 packetS->getTimeUS() > call->seenauthfailed_time_usec) &&
+	       !(opt_hash_modify_queue_length_ms && call->end_call_rtp) &&
+	       !(call->flags & FLAG_SKIPCDR));
+}
+
+static inline void rtp_call_info_from_cache(packet_s_process_0 *packetS, sRtpHashCacheItem *item) {
+	packetS->call_info_find_by_dest = item->find_by_dest;
+	packetS->blockstore_addflag(item->find_by_dest ? 32 : 33 /*pb lock flag*/);
+	if(!item->calls_count) {
+		return;
+	}
+	++counter_rtp_packets[0];
+	for(unsigned i = 0; i < item->calls_count; i++) {
+		sRtpHashCacheCall *cache_call = &item->calls[i];
+		Call *call = cache_call->call;
+		if(rtp_call_info_accept(packetS, call, cache_call->other_side_in_hash)) {
+			++counter_rtp_packets[1];
+			packetS->blockstore_addflag(34 /*pb lock flag*/);
+			packet_s_process_rtp_call_info *call_info = &packetS->call_info[packetS->call_info_length];
+			call_info->call = call;
+			call_info->iscaller = cache_call->iscaller;
+			call_info->is_rtcp = cache_call->is_rtcp;
+			call_info->sdp_flags = cache_call->sdp_flags;
+			if(call->use_rtcp_mux && !call_info->sdp_flags.rtcp_mux && cache_call->other_side_rtcp_mux) {
+				call_info->sdp_flags.rtcp_mux = true;
+			}
+			call_info->use_sync = false;
+			call_info->multiple_calls = false;
+			__sync_add_and_fetch(&call->rtppacketsinqueue, 1);
+			++packetS->call_info_length;
+		}
+	}
+	if(packetS->call_info_length > 1 && !packetS->audiocodes) {
+		for(int i = 0; i < packetS->call_info_length; i++) {
+			packetS->call_info[i].multiple_calls = true;
+		}
+	}
+}
+
+inline bool ProcessRtpPacket::find_hash_cache(packet_s_process_0 *packetS, int threadIndexPlus) {
+	cRtpHashCache *cache = this->hash_cache[threadIndexPlus];
+	if(!cache) {
+		cache = cRtpHashCache::create(opt_rtp_hash_cache);
+		if(!cache) {
+			return(false);
+		}
+		this->hash_cache[threadIndexPlus] = cache;
+	}
+	vmIP saddr = packetS->saddr_();
+	vmIP daddr = packetS->daddr_();
+	vmPort sport = packetS->source_();
+	vmPort dport = packetS->dest_();
+	cache->begin();
+	sRtpHashCacheItem *item = cache->find(saddr, sport, daddr, dport);
+	if(item) {
+		rtp_call_info_from_cache(packetS, item);
+		cache->end();
+		++cache->stat.hits;
+		return(true);
+	}
+	cache->end();
+	++cache->stat.misses;
+	calltable->lock_calls_hash();
+	item = cache->prepare(saddr, sport, daddr, dport);
+	if(!calltable->hashfind_by_ip_port_to_cache(item)) {
+		++cache->stat.overflows;
+		calltable->unlock_calls_hash();
+		return(false);
+	}
+	rtp_call_info_from_cache(packetS, item);
+	calltable->unlock_calls_hash();
+	return(true);
+}
+
+void ProcessRtpPacket::find_hash(packet_s_process_0 *packetS, bool lock, int threadIndexPlus) {
 	packetS->blockstore_addflag(31 /*pb lock flag*/);
 	packetS->call_info_length = 0;
 	packetS->call_info_find_by_dest = false;
+	if(this->use_hash_cache) {
+		if(this->find_hash_cache(packetS, threadIndexPlus)) {
+			return;
+		}
+		lock = true;
+	}
 	if(lock) {
 		calltable->lock_calls_hash();
 	}
@@ -9065,26 +9354,7 @@ void ProcessRtpPacket::find_hash(packet_s_process_0 *packetS, bool lock) {
 			call_rtp *call_rtp = n_call;
 		#endif
 			Call *call = call_rtp->call;
-			if((!(call->typeIs(SKINNY_NEW) ? opt_rtpfromsdp_onlysip_skinny : opt_rtpfromsdp_onlysip) ||
-			    (packetS->call_info_find_by_dest ?
-			      call->checkKnownIP_inSipCallerdIP(packetS->saddr_()) :
-			      call->checkKnownIP_inSipCallerdIP(packetS->daddr_())) ||
-			    (packetS->call_info_find_by_dest ?
-			      calltable->check_call_in_hashfind_by_ip_port(call, packetS->saddr_(), packetS->source_(), false) &&
-			      call->checkKnownIP_inSipCallerdIP(packetS->daddr_()) :
-			      calltable->check_call_in_hashfind_by_ip_port(call, packetS->daddr_(), packetS->dest_(), false) &&
-			      call->checkKnownIP_inSipCallerdIP(packetS->saddr_()))) &&
-			   !(opt_ignore_rtp_after_bye_confirmed &&
-			     call->seenbyeandok && call->seenbyeandok_time_usec &&
-			     packetS->getTimeUS() > call->seenbyeandok_time_usec) &&
-			   !(opt_ignore_rtp_after_cancel_confirmed &&
-			     call->seencancelandok && call->seencancelandok_time_usec &&
-			     packetS->getTimeUS() > call->seencancelandok_time_usec) &&
-			   !(opt_ignore_rtp_after_auth_failed &&
-			     call->seenauthfailed && call->seenauthfailed_time_usec &&
-			     packetS->getTimeUS() > call->seenauthfailed_time_usec) &&
-			   !(opt_hash_modify_queue_length_ms && call->end_call_rtp) &&
-			   !(call->flags & FLAG_SKIPCDR)) {
+			if(rtp_call_info_accept(packetS, call, -1)) {
 				++counter_rtp_packets[1];
 				packetS->blockstore_addflag(34 /*pb lock flag*/);
 				packetS->call_info[packetS->call_info_length].call = call;
@@ -9217,8 +9487,11 @@ void rtp_read_thread::init(int threadNum, size_t qring_length) {
 	this->remove_flag = 0;
 	this->last_use_time_s = 0;
 	this->calls = 0;
+	this->processed_packets_counter = 0;
 	this->push_lock_sync = 0;
 	this->count_lock_sync = 0;
+	this->qringWaitPush.setName("rtp " + intToString(threadNum) + " push");
+	this->qringWaitPop.setName("rtp " + intToString(threadNum) + " pop");
 	this->init_qring(qring_length);
 	this->init_thread_buffer();
 }
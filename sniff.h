@@ -646,6 +646,13 @@ public:
 	void term_qring();
 	void term_thread_buffer();
 	size_t qring_size();
+	double getQringFillingPerc() {
+		unsigned int _readit = readit;
+		unsigned int _writeit = writeit;
+		return(_writeit >= _readit ?
+			(double)(_writeit - _readit) / qring_length * 100 :
+			(double)(qring_length - _readit + _writeit) / qring_length * 100);
+	}
 	inline void push(Call *call, packet_s_process_0 *packet, int iscaller, bool find_by_dest, int is_rtcp, bool stream_in_multiple_calls, char is_fax, int enable_save_packet, int threadIndex = 0) {
 		
 		/* destroy and quit - debug
@@ -687,7 +694,7 @@ public:
 				batch_packet_rtp *current_batch = this->qring[this->writeit];
 				unsigned int usleepCounter = 0;
 				while(current_batch->used != 0) {
-					USLEEP_C(20, usleepCounter++);
+					SYNC_WAIT(qringWaitPush, current_batch->used, 1, 20, usleepCounter);
 				}
 				memcpy(current_batch->batch, thread_buffer->batch, sizeof(rtp_packet_pcap_queue) * thread_buffer->count);
 				#if RQUEUE_SAFE
@@ -705,6 +712,7 @@ public:
 						this->writeit++;
 					}
 				#endif
+				qringWaitPop.wake();
 				
 				/* destroy threadbuffer array - debug
 				end_thread_buffer_copy:
@@ -743,7 +751,7 @@ public:
 				packet->blockstore_addflag(62 /*pb lock flag*/);
 				unsigned int usleepCounter = 0;
 				while(this->qring[this->writeit]->used != 0) {
-					USLEEP_C(20, usleepCounter++);
+					SYNC_WAIT(qringWaitPush, this->qring[this->writeit]->used, 1, 20, usleepCounter);
 				}
 				qring_push_index = this->writeit + 1;
 				qring_push_index_count = 0;
@@ -777,6 +785,7 @@ public:
 						this->writeit++;
 					}
 				#endif
+				qringWaitPop.wake();
 				qring_push_index = 0;
 				qring_push_index_count = 0;
 			}
@@ -811,6 +820,7 @@ public:
 					this->writeit++;
 				}
 			#endif
+			qringWaitPop.wake();
 			qring_push_index = 0;
 			qring_push_index_count = 0;
 		}
@@ -838,7 +848,7 @@ public:
 			batch_packet_rtp *current_batch = this->qring[this->writeit];
 			unsigned int usleepCounter = 0;
 			while(current_batch->used != 0) {
-				USLEEP_C(20, usleepCounter++);
+				SYNC_WAIT(qringWaitPush, current_batch->used, 1, 20, usleepCounter);
 			}
 			memcpy(current_batch->batch, thread_buffer->batch, sizeof(rtp_packet_pcap_queue) * thread_buffer->count);
 			#if RQUEUE_SAFE
@@ -856,6 +866,7 @@ public:
 					this->writeit++;
 				}
 			#endif
+			qringWaitPop.wake();
 			thread_buffer->count = 0;
 			__sync_lock_release(&this->push_lock_sync);
 		}
@@ -881,8 +892,11 @@ public:
 	volatile bool remove_flag;
 	u_int32_t last_use_time_s;
 	volatile u_int32_t calls;
+	volatile u_int64_t processed_packets_counter;
 	volatile int push_lock_sync;
 	volatile int count_lock_sync;
+	cSyncWait qringWaitPush;
+	cSyncWait qringWaitPop;
 };
 
 #define MAXLIVEFILTERS 10
@@ -15,6 +15,7 @@
 #include "sniff.h"
 #include "sniff_inline.h"
 #include "audiocodes.h"
+#include "pcap_dedup.h"
 
 
 #ifndef DEBUG_ALL_PACKETS
@@ -44,6 +45,7 @@ extern unsigned opt_udp_port_mgcp_callagent;
 extern int opt_dup_check;
 extern int opt_dup_check_ipheader;
 extern int opt_dup_check_ipheader_ignore_ttl;
+extern int opt_dup_check_threads;
 extern char *sipportmatrix;
 extern char *httpportmatrix;
 extern char *webrtcportmatrix;
@@ -757,7 +759,7 @@ int pcapProcess(sHeaderPacket **header_packet, int pushToStack_queue_index,
 	if(((ppf & ppf_calcMD5) || (ppf & ppf_dedup)) && ppd->header_ip) {
 		// check for duplicate packets (md5 is expensive operation - enable only if you really need it
 		if(opt_dup_check && 
-		   ppd->prevmd5s != NULL && 
+		   (ppd->prevmd5s != NULL || ppd->dedup_seen_set != NULL) && 
 		   (((ppf & ppf_defragInPQout) && is_ip_frag == 1) ||
 		    (ppd->datalen > 0 && (opt_dup_check_ipheader || ppd->traillen < ppd->datalen))) &&
 		   !(ppd->istcp && opt_enable_http && (httpportmatrix[ppd->header_tcp->get_source()] || httpportmatrix[ppd->header_tcp->get_dest()])) &&
@@ -777,18 +779,28 @@ int pcapProcess(sHeaderPacket **header_packet, int pushToStack_queue_index,
 					ppd->header_ip->set_check(0);
 					header_ip_set_orig = true;
 				}
-				MD5_Init(&ppd->ctx);
+				void *dedup_data;
+				unsigned long dedup_datalen;
 				if((ppf & ppf_defragInPQout) && is_ip_frag == 1) {
 					u_int32_t caplen = header_packet ? HPH(*header_packet)->caplen : pcap_header_plus2->get_caplen();
-					MD5_Update(&ppd->ctx, ppd->header_ip, MIN(caplen - ppd->header_ip_offset, ppd->header_ip->get_tot_len()));
+					dedup_data = ppd->header_ip;
+					dedup_datalen = MIN(caplen - ppd->header_ip_offset, ppd->header_ip->get_tot_len());
 				} else if(opt_dup_check_ipheader) {
-					MD5_Update(&ppd->ctx, ppd->header_ip, MIN(ppd->datalen + (ppd->data - (char*)ppd->header_ip), ppd->header_ip->get_tot_len()));
+					dedup_data = ppd->header_ip;
+					dedup_datalen = MIN(ppd->datalen + (ppd->data - (char*)ppd->header_ip), ppd->header_ip->get_tot_len());
 				} else {
 					// check duplicates based only on data (without ip header and without UDP/TCP header). Duplicate packets 
 					// will be matched regardless on IP 
-					MD5_Update(&ppd->ctx, ppd->data, MAX(0, (unsigned long)ppd->datalen - ppd->traillen));
+					dedup_data = ppd->data;
+					dedup_datalen = MAX(0, (unsigned long)ppd->datalen - ppd->traillen);
+				}
+				if(opt_dup_check_threads) {
+					dedup_hash64_to_md5(dedup_data, dedup_datalen, _md5);
+				} else {
+					MD5_Init(&ppd->ctx);
+					MD5_Update(&ppd->ctx, dedup_data, dedup_datalen);
+					MD5_Final((unsigned char*)_md5, &ppd->ctx);
 				}
-				MD5_Final((unsigned char*)_md5, &ppd->ctx);
 				if(header_ip_set_orig) {
 					ppd->header_ip->set_ttl(header_ip_ttl_orig);
 					ppd->header_ip->set_check(header_ip_check_orig);
@@ -798,9 +810,16 @@ int pcapProcess(sHeaderPacket **header_packet, int pushToStack_queue_index,
 				#endif
 			}
 			if((ppf & ppf_dedup) && _md5[0]) {
-				if(memcmp(_md5, ppd->prevmd5s + (_md5[0] * MD5_DIGEST_LENGTH), MD5_DIGEST_LENGTH) == 0) {
+				bool duplicate;
+				if(ppd->dedup_seen_set) {
+					duplicate = ppd->dedup_seen_set->check(dedup_md5_to_hash64(_md5),
+									       header_packet ? getTimeMS(HPH(*header_packet)) : pcap_header_plus2->get_time_ms());
+				} else {
+					duplicate = memcmp(_md5, ppd->prevmd5s + (_md5[0] * MD5_DIGEST_LENGTH), MD5_DIGEST_LENGTH) == 0;
+				}
+				if(duplicate) {
 					//printf("dropping duplicate md5[%s]\n", md5);
-					duplicate_counter++;
+					__sync_add_and_fetch(&duplicate_counter, 1);
 					if(sverb.dedup) {
 						cout << "*** DEDUP " << duplicate_counter << endl;
 					}
@@ -812,7 +831,9 @@ int pcapProcess(sHeaderPacket **header_packet, int pushToStack_queue_index,
 					#endif
 					return(0);
 				}
-				memcpy(ppd->prevmd5s + (_md5[0] * MD5_DIGEST_LENGTH), _md5, MD5_DIGEST_LENGTH);
+				if(!ppd->dedup_seen_set) {
+					memcpy(ppd->prevmd5s + (_md5[0] * MD5_DIGEST_LENGTH), _md5, MD5_DIGEST_LENGTH);
+				}
 			}
 		}
 	}
@@ -415,7 +415,7 @@ public:
 			if(!qring_push_index) {
 				unsigned int usleepCounter = 0;
 				while(this->qring_detach[this->writeit]->used != 0) {
-					USLEEP_C(20, usleepCounter++);
+					SYNC_WAIT(qringWaitPush, this->qring_detach[this->writeit]->used, 1, 20, usleepCounter);
 				}
 				qring_push_index = this->writeit + 1;
 				qring_push_index_count = 0;
@@ -449,6 +449,7 @@ public:
 						this->writeit++;
 					}
 				#endif
+				qringWaitPop.wake();
 				qring_push_index = 0;
 				qring_push_index_count = 0;
 			}
@@ -473,7 +474,7 @@ public:
 					if(usleepCounter == 0) {
 						++qringPushCounter_full;
 					}
-					USLEEP_C(20, usleepCounter++);
+					SYNC_WAIT(qringWaitPush, this->qring[this->writeit]->used, 1, 20, usleepCounter);
 				}
 				qring_push_index = this->writeit + 1;
 				qring_push_index_count = 0;
@@ -495,6 +496,7 @@ public:
 						this->writeit++;
 					}
 				#endif
+				qringWaitPop.wake();
 				qring_push_index = 0;
 				qring_push_index_count = 0;
 			}
@@ -607,6 +609,7 @@ public:
 						this->writeit++;
 					}
 				#endif
+				qringWaitPop.wake();
 				qring_push_index = 0;
 				qring_push_index_count = 0;
 			}
@@ -821,6 +824,9 @@ public:
 	inline void setAllocStackCounter(unsigned long c, int index) {
 		allocStackCounter[index] = c;
 	}
+	inline u_int64_t getProcessedPacketsCounter() {
+		return(processedPacketsCounter);
+	}
 	string getNameTypeThread() {
 		switch(typePreProcessThread) {
 		case ppt_detach:
@@ -935,12 +941,15 @@ private:
 	volatile int _sync_push;
 	volatile int _sync_count;
 	bool term_preProcess;
+	cSyncWait qringWaitPush;
+	cSyncWait qringWaitPop;
 	cHeapItemsPointerStack *stackSip;
 	cHeapItemsPointerStack *stackRtp;
 	cHeapItemsPointerStack *stackOther;
 	volatile int outThreadState;
 	unsigned long allocCounter[2];
 	unsigned long allocStackCounter[2];
+	volatile u_int64_t processedPacketsCounter;
 	u_int64_t getCpuUsagePerc_counter;
 	u_int64_t getCpuUsagePerc_counter_at_start_out_thread;
 	static u_long autoStartNextLevelPreProcessPacket_last_time_s;
@@ -1046,6 +1055,8 @@ inline void PACKET_S_PROCESS_PUSH_TO_STACK(packet_s_stack **packet, u_int16_t qu
 }
 
 
+class cRtpHashCache;
+
 class ProcessRtpPacket {
 public:
 	enum eType {
@@ -1109,7 +1120,7 @@ public:
 				if(usleepCounter == 0) {
 					++qringPushCounter_full;
 				}
-				USLEEP_C(20, usleepCounter++);
+				SYNC_WAIT(qringWaitPush, this->qring[this->writeit]->used, 1, 20, usleepCounter);
 			}
 			qring_push_index = this->writeit + 1;
 			qring_push_index_count = 0;
@@ -1131,6 +1142,7 @@ public:
 					this->writeit++;
 				}
 			#endif
+			qringWaitPop.wake();
 			qring_push_index = 0;
 			qring_push_index_count = 0;
 		}
@@ -1150,6 +1162,7 @@ public:
 					this->writeit++;
 				}
 			#endif
+			qringWaitPop.wake();
 			qring_push_index = 0;
 			qring_push_index_count = 0;
 		}
@@ -1179,12 +1192,16 @@ public:
 		return(next_thread_index < MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS &&
 		       this->nextThreadId[next_thread_index]);
 	}
+	inline u_int64_t getProcessedPacketsCounter() {
+		return(processedPacketsCounter);
+	}
 private:
 	void *outThreadFunction();
 	void *nextThreadFunction(int next_thread_index_plus);
 	void rtp_batch(batch_packet_s_process *batch, unsigned count);
 	inline void rtp_packet_distr(packet_s_process_0 *packetS, int _process_rtp_packets_distribute_threads_use);
-	void find_hash(packet_s_process_0 *packetS, bool lock = true);
+	void find_hash(packet_s_process_0 *packetS, bool lock = true, int threadIndexPlus = 0);
+	inline bool find_hash_cache(packet_s_process_0 *packetS, int threadIndexPlus);
 public:
 	eType type;
 	int indexThread;
@@ -1205,11 +1222,16 @@ private:
 	pstat_data threadPstatData[1 + MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS][2];
 	u_int64_t qringPushCounter;
 	u_int64_t qringPushCounter_full;
+	volatile u_int64_t processedPacketsCounter;
 	bool term_processRtp;
 	s_hash_thread_data hash_thread_data[MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS];
 	volatile int *hash_find_flag;
 	sem_t sem_sync_next_thread[MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS][2];
 	volatile int _sync_count;
+	cSyncWait qringWaitPush;
+	cSyncWait qringWaitPop;
+	bool use_hash_cache;
+	cRtpHashCache *hash_cache[1 + MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS];
 friend inline void *_ProcessRtpPacket_outThreadFunction(void *arg);
 friend inline void *_ProcessRtpPacket_nextThreadFunction(void *arg);
 };
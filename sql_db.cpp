@@ -28,6 +28,7 @@
 #include "calltable.h"
 #include "cleanspool.h"
 #include "server.h"
+#include "pipeline_bench.h"
 
 #define QFILE_PREFIX "qoq"
 
@@ -112,6 +113,7 @@ extern int opt_load_query_from_files;
 
 extern bool opt_disable_cdr_indexes_rtp;
 extern bool opt_mysql_mysql_redirect_cdr_queue;
+extern bool opt_mysql_prepared_insert;
 
 
 int sql_noerror = 0;
@@ -1579,6 +1581,8 @@ SqlDb_mysql::SqlDb_mysql() {
 	this->hMysqlConn = NULL;
 	this->hMysqlRes = NULL;
 	this->mysqlThreadId = 0;
+	this->stmt_cache_threadId = 0;
+	this->stmt_disable = false;
 }
 
 SqlDb_mysql::~SqlDb_mysql() {
@@ -1947,6 +1951,7 @@ void SqlDb_mysql::disconnect() {
 		mysql_free_result(this->hMysqlRes);
 		this->hMysqlRes = NULL;
 	}
+	this->closeStmtCache();
 	if(this->hMysqlConn) {
 		mysql_close(this->hMysqlConn);
 		this->hMysqlConn = NULL;
@@ -2560,6 +2565,715 @@ void SqlDb_mysql::clean() {
 	this->cleanFields();
 }
 
+bool SqlDb_mysql::insertBatch(cSqlInsertBatch *batch, u_int64_t maxAllowedPacket, unsigned long transactionThreadId) {
+	if(opt_nocdr) {
+		return(true);
+	}
+	bool usePrepared = !this->stmt_disable &&
+			   !isCloud() && !snifferClientOptions.isEnableRemoteQuery();
+	if(usePrepared) {
+		// the same connection checks as in query - statements are bound to connection
+		if(this->hMysqlRes) {
+			while(mysql_fetch_row(this->hMysqlRes));
+			mysql_free_result(this->hMysqlRes);
+			this->hMysqlRes = NULL;
+		}
+		if(transactionThreadId) {
+			// reconnect would lose the transaction
+			if(!this->checkTransactionConnection(transactionThreadId)) {
+				return(false);
+			}
+		} else {
+			if(this->connected() &&
+			   (mysql_ping(this->hMysql) ||
+			    (this->mysqlThreadId && this->mysqlThreadId != mysql_thread_id(this->hMysql)))) {
+				this->reconnect();
+			}
+			if(!this->connected()) {
+				this->connect();
+			}
+		}
+		if(this->connected()) {
+			if(this->stmt_cache_threadId != mysql_thread_id(this->hMysql)) {
+				this->closeStmtCache();
+				this->stmt_cache_threadId = mysql_thread_id(this->hMysql);
+			}
+		} else {
+			usePrepared = false;
+		}
+	}
+	bool rslt = true;
+	for(vector<cSqlInsertBatch::sItem>::iterator iter = batch->items.begin(); iter != batch->items.end(); iter++) {
+		if(transactionThreadId && !this->checkTransactionConnection(transactionThreadId)) {
+			return(false);
+		}
+		cSqlInsertBatch::sTable *table = iter->table;
+		if(!table) {
+			if(!this->query(iter->query)) {
+				rslt = false;
+			}
+			continue;
+		}
+		this->insertBatchSetColumnsIPv6(table);
+		unsigned maxRows = 65535 / table->columns.size();
+		if(maxAllowedPacket) {
+			u_int64_t rowSize = table->size / table->rows + table->columns.size() * 16;
+			unsigned maxRowsPacket = maxAllowedPacket / 1.1 / rowSize;
+			maxRows = max(1u, min(maxRows, maxRowsPacket));
+		}
+		unsigned rowFrom = 0;
+		while(rowFrom < table->rows) {
+			if(!usePrepared || this->stmt_disable) {
+				if(!this->insertBatchText(table, rowFrom, table->rows - rowFrom, maxAllowedPacket)) {
+					rslt = false;
+				}
+				break;
+			}
+			// row counts are powers of two - the number of distinct cached statements per table stays small
+			unsigned rows = 1;
+			while(rows * 2 <= maxRows && rows * 2 <= table->rows - rowFrom) {
+				rows *= 2;
+			}
+			if(!this->insertBatchPrepared(table, rowFrom, rows) &&
+			   !this->insertBatchText(table, rowFrom, rows, maxAllowedPacket)) {
+				rslt = false;
+			}
+			rowFrom += rows;
+		}
+	}
+	return(rslt);
+}
+
+bool SqlDb_mysql::storeBatch(string &queries_str, cSqlInsertBatch *batch, bool useTransaction, u_int64_t maxAllowedPacket) {
+	if(!useTransaction) {
+		// the same as text path without transaction - queries of store_001 and then rows of batch (csv inserts are at the end of queries_str)
+		bool rslt = true;
+		if(!queries_str.empty() &&
+		   !this->query(string("call store_001(\"") + queries_str + "\",\"" + _MYSQL_QUERY_END_new + "\",false)")) {
+			rslt = false;
+		}
+		if(!this->insertBatch(batch, maxAllowedPacket)) {
+			rslt = false;
+		}
+		return(rslt);
+	}
+	// batch is part of the transaction of store_001 - transaction is controlled here, store_001 runs inside it
+	// next attempts of query after reconnect would continue out of the transaction - single pass, the same connection
+	unsigned int maxQueryPass = this->getMaxQueryPass();
+	this->setMaxQueryPass(1);
+	bool rslt = this->query("start transaction");
+	unsigned long transactionThreadId = rslt && this->connected() ? mysql_thread_id(this->hMysql) : 0;
+	if(!transactionThreadId) {
+		rslt = false;
+	}
+	if(rslt && !queries_str.empty()) {
+		rslt = this->checkTransactionConnection(transactionThreadId) &&
+		       this->query(string("call store_001(\"") + queries_str + "\",\"" + _MYSQL_QUERY_END_new + "\",false)");
+	}
+	if(rslt) {
+		rslt = this->insertBatch(batch, maxAllowedPacket, transactionThreadId);
+	}
+	if(rslt) {
+		rslt = this->checkTransactionConnection(transactionThreadId) &&
+		       this->query("commit");
+	} else if(transactionThreadId && this->checkTransactionConnection(transactionThreadId)) {
+		this->query("rollback");
+	}
+	this->setMaxQueryPass(maxQueryPass);
+	if(!rslt) {
+		// the same as failed transaction of text path - whole unit is repeated by store_001 (with next attempts)
+		syslog(LOG_NOTICE, "transaction with batch insert failed - store by text queries");
+		rslt = this->query(string("call store_001(\"") + 
+				   queries_str + this->insertBatchQueriesStr(batch, maxAllowedPacket) + "\",\"" + 
+				   _MYSQL_QUERY_END_new + "\",true)");
+	}
+	return(rslt);
+}
+
+string SqlDb_mysql::insertBatchQueriesStr(cSqlInsertBatch *batch, u_int64_t maxAllowedPacket) {
+	string queries_str;
+	for(vector<cSqlInsertBatch::sItem>::iterator iter = batch->items.begin(); iter != batch->items.end(); iter++) {
+		if(!iter->table) {
+			queries_str += sqlEscapeString(iter->query) + _MYSQL_QUERY_END_new;
+			continue;
+		}
+		this->insertBatchSetColumnsIPv6(iter->table);
+		list<string> queries;
+		this->insertBatchTextQueries(iter->table, 0, iter->table->rows, maxAllowedPacket, &queries);
+		for(list<string>::iterator iter_query = queries.begin(); iter_query != queries.end(); iter_query++) {
+			queries_str += sqlEscapeString(*iter_query) + _MYSQL_QUERY_END_new;
+		}
+	}
+	return(queries_str);
+}
+
+void SqlDb_mysql::insertBatchSetColumnsIPv6(cSqlInsertBatch::sTable *table) {
+	for(unsigned i = 0; i < table->columns.size(); i++) {
+		table->columns[i].ipv6 = VM_IPV6_B && this->isIPv6Column(table->name, table->columns[i].name);
+	}
+}
+
+bool SqlDb_mysql::checkTransactionConnection(unsigned long transactionThreadId) {
+	return(this->connected() &&
+	       !mysql_ping(this->hMysql) &&
+	       mysql_thread_id(this->hMysql) == transactionThreadId);
+}
+
+static string sqlUnescapeString(const string &str) {
+	string rslt;
+	rslt.reserve(str.length());
+	for(size_t i = 0; i < str.length(); i++) {
+		if(str[i] == '\\' && i < str.length() - 1) {
+			char c = str[++i];
+			switch(c) {
+			case '0': rslt += '\0'; break;
+			case 'b': rslt += '\b'; break;
+			case 'n': rslt += '\n'; break;
+			case 'r': rslt += '\r'; break;
+			case 't': rslt += '\t'; break;
+			case 'Z': rslt += (char)26; break;
+			case '%':
+			case '_':
+				rslt += '\\';
+				rslt += c;
+				break;
+			default:
+				rslt += c;
+			}
+		} else {
+			rslt += str[i];
+		}
+	}
+	return(rslt);
+}
+
+bool SqlDb_mysql::insertBatchPrepared(cSqlInsertBatch::sTable *table, unsigned rowFrom, unsigned rows) {
+	unsigned columns = table->columns.size();
+	string row_str = "(";
+	for(unsigned i = 0; i < columns; i++) {
+		if(i) {
+			row_str += ",";
+		}
+		row_str += table->columns[i].ipv6 ? "inet6_aton(?)" : "?";
+	}
+	row_str += ")";
+	string query_str = "INSERT INTO " + table->name + " ( " + table->columns_str + " ) VALUES ";
+	for(unsigned i = 0; i < rows; i++) {
+		if(i) {
+			query_str += ",";
+		}
+		query_str += row_str;
+	}
+	MYSQL_STMT *stmt;
+	map<string, MYSQL_STMT*>::iterator iter = this->stmt_cache.find(query_str);
+	if(iter != this->stmt_cache.end()) {
+		stmt = iter->second;
+	} else {
+		if(this->stmt_cache.size() >= 64) {
+			this->closeStmtCache();
+		}
+		stmt = mysql_stmt_init(this->hMysqlConn);
+		if(!stmt) {
+			return(false);
+		}
+		if(mysql_stmt_prepare(stmt, query_str.c_str(), query_str.length())) {
+			unsigned int stmt_errno = mysql_stmt_errno(stmt);
+			syslog(LOG_NOTICE, "prepare of batch insert into %s failed - %u: %s",
+			       table->name.c_str(), stmt_errno, mysql_stmt_error(stmt));
+			mysql_stmt_close(stmt);
+			if(stmt_errno != CR_SERVER_GONE_ERROR && stmt_errno != CR_SERVER_LOST) {
+				syslog(LOG_NOTICE, "prepared batch insert disabled - text insert is used");
+				this->stmt_disable = true;
+			}
+			return(false);
+		}
+		this->stmt_cache[query_str] = stmt;
+	}
+	unsigned params = rows * columns;
+	MYSQL_BIND *binds = new FILE_LINE(0) MYSQL_BIND[params];
+	memset(binds, 0, sizeof(MYSQL_BIND) * params);
+	long long *ints = new FILE_LINE(0) long long[params];
+	double *doubles = new FILE_LINE(0) double[params];
+	unsigned long *lengths = new FILE_LINE(0) unsigned long[params];
+	vector<string> strings;
+	strings.reserve(params);
+	unsigned param = 0;
+	for(unsigned row = rowFrom; row < rowFrom + rows; row++) {
+		for(unsigned col = 0; col < columns; col++) {
+			cSqlInsertBatch::sColumn *column = &table->columns[col];
+			MYSQL_BIND *bind = &binds[param];
+			string *value = &column->values[row];
+			const char *str = NULL;
+			switch(column->types[row]) {
+			case cSqlInsertBatch::_ct_null:
+				bind->buffer_type = MYSQL_TYPE_NULL;
+				break;
+			case cSqlInsertBatch::_ct_string:
+				strings.push_back(sqlUnescapeString(*value));
+				str = strings.back().c_str();
+				lengths[param] = strings.back().length();
+				bind->buffer_type = MYSQL_TYPE_STRING;
+				break;
+			case cSqlInsertBatch::_ct_int:
+				ints[param] = atoll(value->c_str());
+				bind->buffer_type = MYSQL_TYPE_LONGLONG;
+				bind->buffer = &ints[param];
+				break;
+			case cSqlInsertBatch::_ct_int_u:
+			case cSqlInsertBatch::_ct_id:
+				ints[param] = strtoull(value->c_str(), NULL, 10);
+				bind->buffer_type = MYSQL_TYPE_LONGLONG;
+				bind->buffer = &ints[param];
+				bind->is_unsigned = true;
+				break;
+			case cSqlInsertBatch::_ct_double:
+				// text literal without exponent is exact value - decimal parameter keeps it
+				if(strpbrk(value->c_str(), "eE")) {
+					doubles[param] = atof(value->c_str());
+					bind->buffer_type = MYSQL_TYPE_DOUBLE;
+					bind->buffer = &doubles[param];
+				} else {
+					str = value->c_str();
+					lengths[param] = value->length();
+					bind->buffer_type = MYSQL_TYPE_NEWDECIMAL;
+				}
+				break;
+			case cSqlInsertBatch::_ct_ip:
+				if(column->ipv6) {
+					str = value->c_str();
+					lengths[param] = value->length();
+					bind->buffer_type = MYSQL_TYPE_STRING;
+				} else {
+					ints[param] = str_2_vmIP(value->c_str()).getIPv4();
+					bind->buffer_type = MYSQL_TYPE_LONGLONG;
+					bind->buffer = &ints[param];
+					bind->is_unsigned = true;
+				}
+				break;
+			case cSqlInsertBatch::_ct_datetime:
+				str = value->c_str();
+				lengths[param] = value->length();
+				bind->buffer_type = MYSQL_TYPE_STRING;
+				break;
+			}
+			if(str) {
+				bind->buffer = (void*)str;
+				bind->buffer_length = lengths[param];
+				bind->length = &lengths[param];
+			}
+			++param;
+		}
+	}
+	bool rslt = true;
+	if(mysql_stmt_bind_param(stmt, binds) ||
+	   mysql_stmt_execute(stmt)) {
+		if(verbosity > 1) {
+			syslog(LOG_NOTICE, "batch insert into %s failed - %u: %s",
+			       table->name.c_str(), mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
+		}
+		// text insert reports error and does reconnect / next attempts
+		this->closeStmtCache();
+		rslt = false;
+	}
+	delete [] binds;
+	delete [] ints;
+	delete [] doubles;
+	delete [] lengths;
+	return(rslt);
+}
+
+static string sqlInsertBatchValue(cSqlInsertBatch::sColumn *column, unsigned row) {
+	// the same as cDbStrings::implodeInsertValues
+	string *value = &column->values[row];
+	switch(column->types[row]) {
+	case cSqlInsertBatch::_ct_null:
+		return("NULL");
+	case cSqlInsertBatch::_ct_string:
+		return("'" + *value + "'");
+	case cSqlInsertBatch::_ct_ip:
+		if(column->ipv6) {
+			return("inet6_aton('" + *value + "')");
+		}
+		return(intToString(str_2_vmIP(value->c_str()).getIPv4()));
+	case cSqlInsertBatch::_ct_datetime:
+		return("'" + sqlEscapeString(*value) + "'");
+	}
+	return(*value);
+}
+
+bool SqlDb_mysql::insertBatchText(cSqlInsertBatch::sTable *table, unsigned rowFrom, unsigned rows, u_int64_t maxAllowedPacket) {
+	bool rslt = true;
+	list<string> queries;
+	this->insertBatchTextQueries(table, rowFrom, rows, maxAllowedPacket, &queries);
+	for(list<string>::iterator iter = queries.begin(); iter != queries.end(); iter++) {
+		if(!this->query(*iter)) {
+			rslt = false;
+		}
+	}
+	return(rslt);
+}
+
+void SqlDb_mysql::insertBatchTextQueries(cSqlInsertBatch::sTable *table, unsigned rowFrom, unsigned rows, u_int64_t maxAllowedPacket,
+					 list<string> *queries) {
+	string insert_str = "INSERT INTO " + table->name + " ( " + table->columns_str + " ) VALUES ( ";
+	string values_str;
+	for(unsigned row = rowFrom; row < rowFrom + rows; row++) {
+		if(maxAllowedPacket && values_str.length() * 1.1 > maxAllowedPacket) {
+			queries->push_back(insert_str + values_str + " )");
+			values_str = "";
+		}
+		if(!values_str.empty()) {
+			values_str += " ),( ";
+		}
+		for(unsigned col = 0; col < table->columns.size(); col++) {
+			if(col) {
+				values_str += ",";
+			}
+			values_str += sqlInsertBatchValue(&table->columns[col], row);
+		}
+	}
+	if(!values_str.empty()) {
+		queries->push_back(insert_str + values_str + " )");
+	}
+}
+
+void SqlDb_mysql::closeStmtCache() {
+	for(map<string, MYSQL_STMT*>::iterator iter = this->stmt_cache.begin(); iter != this->stmt_cache.end(); iter++) {
+		mysql_stmt_close(iter->second);
+	}
+	this->stmt_cache.clear();
+}
+
+bool SqlDb_mysql::insertBatchTest(unsigned records) {
+	// the same csv records stored by text path (store_001) and by batch path (storeBatch) into two tables - stored rows must be equal
+	SqlDb *sqlDb = createSqlObject();
+	if(!sqlDb->connect() || !isSqlDriver("mysql")) {
+		cerr << "sql-insert-batch-test: mysql database is not available" << endl;
+		delete sqlDb;
+		return(false);
+	}
+	const char *tables[2] = { "insert_batch_test_text", "insert_batch_test_batch" };
+	for(unsigned i = 0; i < 2; i++) {
+		sqlDb->query(string("drop table if exists ") + tables[i]);
+		sqlDb->query(string("create table ") + tables[i] + " ("
+			     "id int unsigned not null primary key, "
+			     "s varchar(255), "
+			     "i bigint, "
+			     "u bigint unsigned, "
+			     "d decimal(20,6), "
+			     "f double, "
+			     "ip int unsigned, "
+			     "dt datetime(3), "
+			     "n int) ENGINE=InnoDB");
+	}
+	const char *strings[] = {
+		"text", "", "it's", "quote \" inside", "back\\slash", "percent % and _ underscore",
+		"line\nbreak\ttab", "utf8 \xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd", "(a),(b)", ":IF"
+	};
+	const char *doubles[] = { "0", "-1.5", "1234567.890123", "1.5e-7", "-2.25E+10", "0.000001" };
+	bool rslt = true;
+	for(unsigned path = 0; path < 2; path++) {
+		list<string> queries;
+		for(unsigned i = 0; i < records; i++) {
+			if(i % 10 == 9) {
+				// plain query - part of queries_str before csv inserts
+				queries.push_back(MYSQL_ADD_QUERY_END(string("insert into ") + tables[path] + " (id, s, n) values (" +
+								      intToString(1000000 + i) + ", 'plain " + intToString(i) + "', " + intToString(i) + ")"));
+				continue;
+			}
+			SqlDb_row row;
+			row.add((unsigned long long)(i + 1), "id");
+			if(i % 13 == 5) {
+				row.add((const char*)NULL, "s");
+			} else {
+				row.add(sqlEscapeString(strings[i % (sizeof(strings) / sizeof(strings[0]))]), "s");
+			}
+			if(i % 7 == 3) {
+				// more digits than checkTable accepts - text insert of record inside batch
+				row.add(string("-") + intToString(1000000000000000000ll + i), "i", false, SqlDb_row::_ift_int);
+			} else {
+				row.add((long long)i * (i % 2 ? -1 : 1) * 1000003ll, "i");
+			}
+			row.add((unsigned long long)(i % 5 == 0 ? 18446744073709551615ull - i : i), "u");
+			row.add(string(doubles[i % (sizeof(doubles) / sizeof(doubles[0]))]), "d", false, SqlDb_row::_ift_double);
+			row.add(string(doubles[(i + 3) % (sizeof(doubles) / sizeof(doubles[0]))]), "f", false, SqlDb_row::_ift_double);
+			row.add(vmIP((u_int32_t)(0xC0A80000 + i)), "ip", i % 11 == 4, sqlDb, tables[path]);
+			row.add_calldate(1600000000000000ull + i * 1234567ull, "dt", true);
+			row.add((long long)0, "n", true);
+			queries.push_back(MYSQL_MAIN_INSERT_CSV_HEADER(tables[path]) + row.implodeFields(",", "\"") + MYSQL_CSV_END +
+					  MYSQL_MAIN_INSERT_CSV_ROW(tables[path]) + row.implodeContentTypeToCsv(true) + MYSQL_CSV_END);
+		}
+		string queries_str;
+		cSqlInsertBatch *insert_batch = path ? new FILE_LINE(0) cSqlInsertBatch : NULL;
+		__store_prepare_queries(&queries, NULL, NULL,
+					&queries_str, NULL, NULL,
+					1, false, false,
+					((SqlDb_mysql*)sqlDb)->maxAllowedPacket, insert_batch);
+		bool rslt_store;
+		if(path) {
+			cout << "batch: " << insert_batch->getCountRows() << " rows, " 
+			     << insert_batch->items.size() << " items" << endl;
+			rslt_store = ((SqlDb_mysql*)sqlDb)->storeBatch(queries_str, insert_batch, true, ((SqlDb_mysql*)sqlDb)->maxAllowedPacket);
+			delete insert_batch;
+		} else {
+			rslt_store = sqlDb->query(string("call store_001(\"") + queries_str + "\",\"" + _MYSQL_QUERY_END_new + "\",true)");
+		}
+		if(!rslt_store) {
+			cout << tables[path] << ": store failed" << endl;
+			rslt = false;
+		}
+	}
+	vector<string> rows[2];
+	for(unsigned i = 0; i < 2; i++) {
+		sqlDb->query(string("select * from ") + tables[i] + " order by id");
+		SqlDb_row row;
+		while((row = sqlDb->fetchRow())) {
+			rows[i].push_back(row.implodeContent(",", "'"));
+		}
+	}
+	unsigned differ = 0;
+	for(unsigned i = 0; i < max(rows[0].size(), rows[1].size()); i++) {
+		if(i >= rows[0].size() || i >= rows[1].size() || rows[0][i] != rows[1][i]) {
+			if(differ < 10) {
+				cout << "differ row " << i << endl
+				     << " text:  " << (i < rows[0].size() ? rows[0][i] : "-") << endl
+				     << " batch: " << (i < rows[1].size() ? rows[1][i] : "-") << endl;
+			}
+			++differ;
+		}
+	}
+	cout << "rows text: " << rows[0].size() << ", rows batch: " << rows[1].size() << ", differ: " << differ << endl;
+	if(differ || rows[0].size() != records) {
+		rslt = false;
+	}
+	for(unsigned i = 0; i < 2; i++) {
+		sqlDb->query(string("drop table if exists ") + tables[i]);
+	}
+	delete sqlDb;
+	return(rslt);
+}
+
+
+cSqlInsertBatch::cSqlInsertBatch() {
+}
+
+cSqlInsertBatch::~cSqlInsertBatch() {
+	clear();
+}
+
+void cSqlInsertBatch::add(cDbTablesContent *tablesContent, SqlDb *sqlDb) {
+	bool batchable = true;
+	for(vector<cDbTableContent*>::iterator iter = tablesContent->tables.begin(); iter != tablesContent->tables.end(); iter++) {
+		if(!checkTable(*iter)) {
+			batchable = false;
+			break;
+		}
+	}
+	for(vector<cDbTableContent*>::iterator iter = tablesContent->tables.begin(); iter != tablesContent->tables.end(); iter++) {
+		if(!(*iter)->rows.size()) {
+			continue;
+		}
+		if(batchable) {
+			addTable(*iter);
+		} else {
+			// keep all tables of record together - child tables reference main record
+			sItem item;
+			item.table = NULL;
+			item.query = (*iter)->insertQuery(sqlDb);
+			items.push_back(item);
+			// next rows must not be grouped to tables before this query
+			tables_map.clear();
+		}
+	}
+}
+
+unsigned cSqlInsertBatch::getCountRows() {
+	unsigned rows = 0;
+	for(vector<sTable*>::iterator iter = tables.begin(); iter != tables.end(); iter++) {
+		rows += (*iter)->rows;
+	}
+	return(rows);
+}
+
+void cSqlInsertBatch::clear() {
+	for(vector<sTable*>::iterator iter = tables.begin(); iter != tables.end(); iter++) {
+		delete *iter;
+	}
+	tables.clear();
+	tables_map.clear();
+	items.clear();
+}
+
+static bool checkNumber(const char *str, bool enableSign, bool enableDecimal, unsigned maxDigits) {
+	if(enableSign && *str == '-') {
+		++str;
+	}
+	unsigned digits = 0;
+	while(isdigit(*str)) {
+		++digits;
+		++str;
+	}
+	if(enableDecimal && *str == '.') {
+		++str;
+		while(isdigit(*str)) {
+			++digits;
+			++str;
+		}
+	}
+	if(!digits || digits > maxDigits) {
+		return(false);
+	}
+	if(enableDecimal && (*str == 'e' || *str == 'E')) {
+		++str;
+		if(*str == '-' || *str == '+') {
+			++str;
+		}
+		if(!isdigit(*str)) {
+			return(false);
+		}
+		while(isdigit(*str)) {
+			++str;
+		}
+	}
+	return(!*str);
+}
+
+bool cSqlInsertBatch::checkTable(cDbTableContent *tableContent) {
+	cDbStrings *header = tableContent->header.items;
+	if(!header) {
+		return(false);
+	}
+	for(vector<cDbTableContent::sRow>::iterator iter = tableContent->rows.begin(); iter != tableContent->rows.end(); iter++) {
+		cDbStrings *row = iter->items;
+		if(!row) {
+			return(false);
+		}
+		for(unsigned i = 0; i < max(header->size, row->size); i++) {
+			bool header_column = i < header->size && header->strings[i].begin;
+			bool row_column = i < row->size && row->strings[i].begin;
+			if(header_column != row_column) {
+				return(false);
+			}
+			if(!row_column || (row->strings[i].flags & SqlDb_row::_ift_null)) {
+				continue;
+			}
+			sDbString *cell = &row->strings[i];
+			switch(cell->flags & SqlDb_row::_ift_base) {
+			case SqlDb_row::_ift_string:
+			case SqlDb_row::_ift_ip:
+			case SqlDb_row::_ift_calldate:
+				if(!cell->str) {
+					return(false);
+				}
+				break;
+			case SqlDb_row::_ift_int:
+				if(!cell->str || !checkNumber(cell->str, true, false, 18)) {
+					return(false);
+				}
+				break;
+			case SqlDb_row::_ift_int_u:
+				if(!cell->str || !checkNumber(cell->str, false, false, 19)) {
+					return(false);
+				}
+				break;
+			case SqlDb_row::_ift_double:
+				if(!cell->str || !checkNumber(cell->str, true, true, 60)) {
+					return(false);
+				}
+				break;
+			case SqlDb_row::_ift_sql:
+				if(!cell->ai_id) {
+					return(false);
+				}
+				break;
+			}
+		}
+	}
+	return(true);
+}
+
+void cSqlInsertBatch::addTable(cDbTableContent *tableContent) {
+	cDbStrings *header = tableContent->header.items;
+	string columns_str = header->implodeInsertColumns();
+	string key = tableContent->table_name + ":" + columns_str;
+	sTable *table;
+	map<string, sTable*>::iterator iter = tables_map.find(key);
+	if(iter != tables_map.end()) {
+		table = iter->second;
+	} else {
+		table = new FILE_LINE(0) sTable;
+		table->name = tableContent->table_name;
+		table->columns_str = columns_str;
+		for(unsigned i = 0; i < header->size; i++) {
+			if(header->strings[i].begin) {
+				sColumn column;
+				column.name = header->strings[i].getStr();
+				column.ipv6 = false;
+				table->columns.push_back(column);
+			}
+		}
+		tables.push_back(table);
+		tables_map[key] = table;
+		sItem item;
+		item.table = table;
+		items.push_back(item);
+	}
+	for(vector<cDbTableContent::sRow>::iterator iter_row = tableContent->rows.begin(); iter_row != tableContent->rows.end(); iter_row++) {
+		cDbStrings *row = iter_row->items;
+		unsigned col = 0;
+		for(unsigned i = 0; i < row->size; i++) {
+			sDbString *cell = &row->strings[i];
+			if(!cell->begin) {
+				continue;
+			}
+			sColumn *column = &table->columns[col++];
+			u_int8_t type = _ct_null;
+			string value;
+			if(!(cell->flags & SqlDb_row::_ift_null)) {
+				switch(cell->flags & SqlDb_row::_ift_base) {
+				case SqlDb_row::_ift_string:
+					type = _ct_string;
+					value = cell->str;
+					break;
+				case SqlDb_row::_ift_int:
+					type = _ct_int;
+					value = cell->str;
+					break;
+				case SqlDb_row::_ift_int_u:
+					type = _ct_int_u;
+					value = cell->str;
+					break;
+				case SqlDb_row::_ift_double:
+					type = _ct_double;
+					value = cell->str;
+					break;
+				case SqlDb_row::_ift_ip:
+					type = _ct_ip;
+					value = cell->str;
+					break;
+				case SqlDb_row::_ift_calldate:
+					type = _ct_datetime;
+					value = sqlDateTimeString_us2ms(atoll(cell->str));
+					break;
+				case SqlDb_row::_ift_sql:
+					type = _ct_id;
+					value = intToString(cell->ai_id);
+					break;
+				default:
+					if((cell->flags & SqlDb_row::_ift_base) >= SqlDb_row::_ift_cb_string && cell->cb_id) {
+						type = _ct_id;
+						value = intToString(cell->cb_id);
+					}
+				}
+			}
+			column->types.push_back(type);
+			column->values.push_back(value);
+			table->size += value.length();
+		}
+		++table->rows;
+	}
+}
+
 
 SqlDb_odbc_bindBufferItem::SqlDb_odbc_bindBufferItem(SQLUSMALLINT colNumber, string fieldName, SQLSMALLINT dataType, SQLULEN columnSize, SQLHSTMT hStatement) {
 	this->colNumber = colNumber;
@@ -3434,10 +4148,15 @@ void MySqlStore_process::__store(list<string> *queries) {
 	string queries_str;
 	list<string> queries_list;
 	list<string> ig;
+	cSqlInsertBatch *insert_batch = NULL;
+	if(opt_mysql_prepared_insert && isSqlDriver("mysql") &&
+	   !(id_main == STORE_PROC_ID_CDR && opt_mysql_mysql_redirect_cdr_queue)) {
+		insert_batch = new FILE_LINE(0) cSqlInsertBatch;
+	}
 	__store_prepare_queries(queries, dbData, NULL,
 				&queries_str, &queries_list, NULL,
 				useNewStore(), useSetId(), opt_mysql_enable_multiple_rows_insert,
-				this->sqlDb->maxAllowedPacket);
+				this->sqlDb->maxAllowedPacket, insert_batch);
 	if(useNewStore() == 2) {
 		if(sverb.store_process_query_compl) {
 			cout << "store_process_query_compl_" << this->id_main << "_" << this->id_2 << endl;
@@ -3455,7 +4174,33 @@ void MySqlStore_process::__store(list<string> *queries) {
 				#endif
 			}
 		}
-	} else {
+		if(insert_batch && !insert_batch->isEmpty()) {
+			#if TEST_SERVER_STORE_SPEED
+			SqlDb::addDelayQuery(10);
+			#else
+			if(!((SqlDb_mysql*)this->sqlDb)->insertBatch(insert_batch, this->sqlDb->maxAllowedPacket)) {
+				syslog(LOG_ERR, "store %i_%i: batch insert of %u rows failed",
+				       this->id_main, this->id_2, insert_batch->getCountRows());
+			}
+			#endif
+		}
+	} else if(insert_batch && !insert_batch->isEmpty()) {
+		if(sverb.store_process_query_compl) {
+			cout << "store_process_query_compl_" << this->id_main << "_" << this->id_2 << endl
+			     << queries_str << endl
+			     << " * batch insert rows: " << insert_batch->getCountRows() << endl;
+		}
+		#if TEST_SERVER_STORE_SPEED
+		SqlDb::addDelayQuery(10);
+		#else
+		if(!((SqlDb_mysql*)this->sqlDb)->storeBatch(queries_str, insert_batch,
+							    opt_mysql_enable_transactions || this->enableTransaction,
+							    this->sqlDb->maxAllowedPacket)) {
+			syslog(LOG_ERR, "store %i_%i: store with batch insert of %u rows failed",
+			       this->id_main, this->id_2, insert_batch->getCountRows());
+		}
+		#endif
+	} else if(!queries_str.empty() || !insert_batch) {
 		if(sverb.store_process_query_compl) {
 			cout << "store_process_query_compl_" << this->id_main << "_" << this->id_2 << endl
 			     << queries_str << endl;
@@ -3466,6 +4211,9 @@ void MySqlStore_process::__store(list<string> *queries) {
 				   (opt_mysql_enable_transactions || this->enableTransaction ? "true" : "false") +
 				   ")");
 	}
+	if(insert_batch) {
+		delete insert_batch;
+	}
 }
 
 void MySqlStore_process::__store(string beginProcedure, string endProcedure, string &queries) {
@@ -3801,6 +4549,10 @@ void MySqlStore::query_lock(const char *query_str, int id_main, int id_2) {
 	if(!query_str || !*query_str) {
 		return;
 	}
+	if(pipelineBench) {
+		pipelineBench->addSqlQueries(1);
+		return;
+	}
 	if(qfileConfigEnable(id_main)) {
 		query_to_file(query_str, id_main);
 	} else {
@@ -3820,6 +4572,10 @@ void MySqlStore::query_lock(list<string> *query_str, int id_main, int id_2, int
 	if(!query_str->size()) {
 		return;
 	}
+	if(pipelineBench) {
+		pipelineBench->addSqlQueries(query_str->size());
+		return;
+	}
 	if(qfileConfigEnable(id_main)) {
 		for(list<string>::iterator iter = query_str->begin(); iter != query_str->end(); iter++) {
 			query_to_file(iter->c_str(), id_main);
@@ -582,6 +582,63 @@ private:
 friend class MySqlStore_process;
 };
 
+/*
+ * Typed rows of csv store format (cDbTablesContent after substCB / substAI) collected per table and column list
+ * in columnar form. SqlDb_mysql::insertBatch writes them by prepared multi-row inserts (binary protocol),
+ * text insert built the same way as cDbTableContent::insertQuery is used as fallback.
+ * Items keep order of records - rows are grouped to one table only within run of batchable records.
+ */
+class cSqlInsertBatch {
+public:
+	enum eCellType {
+		_ct_null,
+		_ct_string,
+		_ct_int,
+		_ct_int_u,
+		_ct_double,
+		_ct_ip,
+		_ct_datetime,
+		_ct_id
+	};
+	struct sColumn {
+		string name;
+		bool ipv6;
+		vector<u_int8_t> types;
+		vector<string> values;
+	};
+	struct sTable {
+		sTable() {
+			rows = 0;
+			size = 0;
+		}
+		string name;
+		string columns_str;
+		vector<sColumn> columns;
+		unsigned rows;
+		u_int64_t size;
+	};
+	struct sItem {
+		sTable *table;
+		string query;
+	};
+public:
+	cSqlInsertBatch();
+	~cSqlInsertBatch();
+	void add(cDbTablesContent *tablesContent, SqlDb *sqlDb);
+	bool isEmpty() {
+		return(items.empty());
+	}
+	unsigned getCountRows();
+	void clear();
+private:
+	bool checkTable(cDbTableContent *tableContent);
+	void addTable(cDbTableContent *tableContent);
+public:
+	vector<sItem> items;
+	vector<sTable*> tables;
+	map<string, sTable*> tables_map;
+};
+
 class SqlDb_mysql : public SqlDb {
 public:
 	enum eRoutineType {
@@ -723,12 +780,27 @@ public:
 	MYSQL *getH_Mysql() {
 		return(this->hMysql);
 	}
+	bool insertBatch(cSqlInsertBatch *batch, u_int64_t maxAllowedPacket, unsigned long transactionThreadId = 0);
+	bool storeBatch(string &queries_str, cSqlInsertBatch *batch, bool useTransaction, u_int64_t maxAllowedPacket);
+	string insertBatchQueriesStr(cSqlInsertBatch *batch, u_int64_t maxAllowedPacket);
+	static bool insertBatchTest(unsigned records);
+private:
+	bool insertBatchPrepared(cSqlInsertBatch::sTable *table, unsigned rowFrom, unsigned rows);
+	bool insertBatchText(cSqlInsertBatch::sTable *table, unsigned rowFrom, unsigned rows, u_int64_t maxAllowedPacket);
+	void insertBatchTextQueries(cSqlInsertBatch::sTable *table, unsigned rowFrom, unsigned rows, u_int64_t maxAllowedPacket,
+				    list<string> *queries);
+	void insertBatchSetColumnsIPv6(cSqlInsertBatch::sTable *table);
+	bool checkTransactionConnection(unsigned long transactionThreadId);
+	void closeStmtCache();
 private:
 	MYSQL *hMysql;
 	MYSQL *hMysqlConn;
 	MYSQL_RES *hMysqlRes;
 	string dbVersion;
 	unsigned long mysqlThreadId;
+	map<string, MYSQL_STMT*> stmt_cache;
+	unsigned long stmt_cache_threadId;
+	bool stmt_disable;
 };
 
 class SqlDb_odbc_bindBufferItem {
@@ -741,7 +741,7 @@ string sqlEscapeStringBorder(const char *inputStr, char borderChar, const char *
 void __store_prepare_queries(list<string> *queries, cSqlDbData *dbData, SqlDb *sqlDb,
 			     string *queries_str, list<string> *queries_list, list<string> *cb_inserts,
 			     int enable_new_store, bool enable_set_id, bool enable_multiple_rows_insert,
-			     long unsigned maxAllowedPacket) {
+			     long unsigned maxAllowedPacket, cSqlInsertBatch *insert_batch) {
 	vector<string> q_delim;
 	q_delim.push_back(_MYSQL_QUERY_END_new);
 	q_delim.push_back(_MYSQL_QUERY_END_SUBST_new);
@@ -769,7 +769,11 @@ void __store_prepare_queries(list<string> *queries, cSqlDbData *dbData, SqlDb *s
 					tablesContent->substCB(dbData, cb_inserts);
 					u_int64_t main_id = 0;
 					tablesContent->substAI(dbData, &main_id);
-					tablesContent->insertQuery(&ig, sqlDb);
+					if(insert_batch) {
+						insert_batch->add(tablesContent, sqlDb);
+					} else {
+						tablesContent->insertQuery(&ig, sqlDb);
+					}
 				}
 				if(store_flags & Call::_sf_charts_cache) {
 					if(existsRemoteChartServer()) {
@@ -260,7 +260,7 @@ string MYSQL_ADD_QUERY_END(string query, bool enableSubstQueryEnd = true);
 void __store_prepare_queries(list<string> *queries, cSqlDbData *dbData, SqlDb *sqlDb,
 			     string *queries_str, list<string> *queries_list, list<string> *cb_inserts,
 			     int enable_new_store, bool enable_set_id, bool enable_multiple_rows_insert,
-			     long unsigned maxAllowedPacket);
+			     long unsigned maxAllowedPacket, class cSqlInsertBatch *insert_batch = NULL);
 
 
 #endif
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <list>
+#include <errno.h>
+
+#include "sync_wait.h"
+
+
+int opt_qring_wait_mode = _swm_spin_futex;
+int opt_qring_wait_spin = 200;
+int opt_qring_wait_park_us = 10000;
+
+static list<cSyncWait*> syncWaitList;
+static volatile int syncWaitListSync;
+
+
+cSyncWait::cSyncWait(const char *name) {
+	registered = false;
+	seq = 0;
+	waiters = 0;
+	if(name) {
+		setName(name);
+	}
+}
+
+cSyncWait::~cSyncWait() {
+	if(registered) {
+		__SYNC_LOCK(syncWaitListSync);
+		syncWaitList.remove(this);
+		__SYNC_UNLOCK(syncWaitListSync);
+	}
+}
+
+void cSyncWait::setName(const char *name) {
+	this->name = name;
+	if(!registered) {
+		__SYNC_LOCK(syncWaitListSync);
+		syncWaitList.push_back(this);
+		__SYNC_UNLOCK(syncWaitListSync);
+		registered = true;
+	}
+}
+
+unsigned int cSyncWait::park(volatile int *flag, int waitWhileValue) {
+	#if SYNC_WAIT_FUTEX
+	u_int32_t _seq = seq;
+	__SYNC_INC(waiters);
+	if(*flag != waitWhileValue) {
+		__SYNC_DEC(waiters);
+		return(0);
+	}
+	__SYNC_INC(stat.parks);
+	unsigned int park_us = opt_qring_wait_park_us > 0 ? opt_qring_wait_park_us : 10000;
+	timespec timeout;
+	timeout.tv_sec = park_us / 1000000;
+	timeout.tv_nsec = (park_us % 1000000) * 1000;
+	u_int64_t startTime = getTimeUS();
+	if(syscall(SYS_futex, &seq, FUTEX_WAIT_PRIVATE, _seq, &timeout, NULL, 0) != 0 &&
+	   errno == ETIMEDOUT) {
+		__SYNC_INC(stat.park_timeouts);
+	}
+	__SYNC_DEC(waiters);
+	return(getTimeUS() - startTime);
+	#else
+	return(0);
+	#endif
+}
+
+void cSyncWait::_wake() {
+	#if SYNC_WAIT_FUTEX
+	__SYNC_INC(seq);
+	syscall(SYS_futex, &seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+	__SYNC_INC(stat.wakeups);
+	#endif
+}
+
+
+string sync_wait_stats() {
+	ostringstream outStr;
+	__SYNC_LOCK(syncWaitListSync);
+	for(list<cSyncWait*>::iterator iter = syncWaitList.begin(); iter != syncWaitList.end(); iter++) {
+		cSyncWait::sStat stat = (*iter)->getStat();
+		if(!stat.waits && !stat.wakeups) {
+			continue;
+		}
+		outStr << fixed
+		       << left << setw(30) << (*iter)->getName() << " : "
+		       << "waits " << right << setw(12) << stat.waits
+		       << "  spins " << right << setw(14) << stat.spins
+		       << "  parks " << right << setw(12) << stat.parks
+		       << "  timeouts " << right << setw(12) << stat.park_timeouts
+		       << "  wakeups " << right << setw(12) << stat.wakeups
+		       << endl;
+	}
+	__SYNC_UNLOCK(syncWaitListSync);
+	string rslt = outStr.str();
+	return(rslt.empty() ? "queue wait stat is empty\n" : rslt);
+}
+
+void sync_wait_stats_clear() {
+	__SYNC_LOCK(syncWaitListSync);
+	for(list<cSyncWait*>::iterator iter = syncWaitList.begin(); iter != syncWaitList.end(); iter++) {
+		(*iter)->clearStat();
+	}
+	__SYNC_UNLOCK(syncWaitListSync);
+}
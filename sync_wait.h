@@ -0,0 +1,131 @@
+#ifndef SYNC_WAIT_H
+#define SYNC_WAIT_H
+
+
+#include <string>
+#include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#ifndef FREEBSD
+#include <linux/futex.h>
+#define SYNC_WAIT_FUTEX 1
+#endif
+
+#include "sync.h"
+#include "tools_global.h"
+
+
+using namespace std;
+
+
+enum eSyncWaitMode {
+	_swm_usleep = 0,
+	_swm_spin_futex = 1
+};
+
+extern int opt_qring_wait_mode;
+extern int opt_qring_wait_spin;
+extern int opt_qring_wait_park_us;
+
+
+/*
+ * Wait strategy for single slot flags of ring queues (qring used / rqueue_quick free).
+ * _swm_usleep      - legacy polling via USLEEP_C
+ * _swm_spin_futex  - adaptive spin (opt_qring_wait_spin iterations) followed by futex park;
+ *                    the other side calls wake() after it changed the flag
+ * Lost wakeup is excluded by ordering: waiter takes seq, increments waiters and rechecks flag;
+ * waker changes flag (full barrier), reads waiters and if nonzero increments seq and wakes.
+ */
+class cSyncWait {
+public:
+	struct sStat {
+		sStat() {
+			clear();
+		}
+		void clear() {
+			waits = 0;
+			spins = 0;
+			parks = 0;
+			park_timeouts = 0;
+			wakeups = 0;
+		}
+		u_int64_t waits;
+		u_int64_t spins;
+		u_int64_t parks;
+		u_int64_t park_timeouts;
+		u_int64_t wakeups;
+	};
+public:
+	cSyncWait(const char *name = NULL);
+	~cSyncWait();
+	void setName(const char *name);
+	void setName(string name) {
+		setName(name.c_str());
+	}
+	inline unsigned int wait(volatile int *flag, int waitWhileValue, unsigned int useconds, unsigned int *counter,
+				 const char *file, int line) {
+		if(!*counter) {
+			__SYNC_INC(stat.waits);
+		}
+		#if SYNC_WAIT_FUTEX
+		if(opt_qring_wait_mode == _swm_spin_futex) {
+			if(*counter < (unsigned)opt_qring_wait_spin) {
+				++*counter;
+				__SYNC_INC(stat.spins);
+				#if defined(__x86_64__) || defined(__i386__)
+				__builtin_ia32_pause();
+				#endif
+				return(0);
+			}
+			++*counter;
+			return(park(flag, waitWhileValue));
+		}
+		#endif
+		#ifdef CLOUD_ROUTER_CLIENT
+		return(usleep(useconds, (*counter)++, file, line));
+		#else
+		++*counter;
+		usleep(useconds);
+		return(useconds);
+		#endif
+	}
+	inline void wake() {
+		#if SYNC_WAIT_FUTEX
+		#if !RQUEUE_SAFE
+		__sync_synchronize();
+		#endif
+		if(waiters) {
+			_wake();
+		}
+		#endif
+	}
+	string getName() {
+		return(name);
+	}
+	sStat getStat() {
+		return(stat);
+	}
+	void clearStat() {
+		stat.clear();
+	}
+private:
+	unsigned int park(volatile int *flag, int waitWhileValue);
+	void _wake();
+private:
+	string name;
+	bool registered;
+	volatile u_int32_t seq;
+	volatile int waiters;
+	sStat stat;
+};
+
+#define SYNC_WAIT(sync_wait, flag, waitWhileValue, us, counter) (sync_wait).wait(&(flag), waitWhileValue, us, &(counter), __FILE__, __LINE__)
+
+string sync_wait_stats();
+void sync_wait_stats_clear();
+
+
+#endif //SYNC_WAIT_H
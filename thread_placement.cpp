@@ -0,0 +1,704 @@
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+#include "thread_placement.h"
+#include "tools.h"
+
+
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT 0
+#endif
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+
+cThreadPlacement threadPlacement;
+
+// memory policy of caller saved by setMemoryNode - restored by resetMemoryNode
+static __thread bool memoryPolicySaved;
+static __thread int memoryPolicySavedMode;
+static __thread unsigned long memoryPolicySavedNodemask;
+
+
+static struct {
+	const char *description_prefix;
+	cThreadPlacement::eStage stage;
+} threadPlacementStages[] = {
+	{ "pb - read thread", cThreadPlacement::_stage_read },
+	{ "pb - dedup worker", cThreadPlacement::_stage_dedup },
+	{ "pb - main", cThreadPlacement::_stage_pb },
+	{ "pb - write", cThreadPlacement::_stage_pb },
+	{ "t2 sip preprocess", cThreadPlacement::_stage_preprocess },
+	{ "t2 rtp preprocess", cThreadPlacement::_stage_rtp_distribute },
+	{ "rtp read", cThreadPlacement::_stage_rtp_read },
+	{ "tar", cThreadPlacement::_stage_storage },
+	{ "sql store", cThreadPlacement::_stage_storage },
+	{ "storing cdr", cThreadPlacement::_stage_storage },
+	{ "storing register", cThreadPlacement::_stage_storage },
+	{ "async store", cThreadPlacement::_stage_storage },
+	{ "charts cache", cThreadPlacement::_stage_storage },
+	{ "ipacc save", cThreadPlacement::_stage_storage },
+	{ "cleanspool", cThreadPlacement::_stage_storage }
+};
+
+
+cThreadPlacement::cThreadPlacement() {
+	enabled = false;
+	dryRun = false;
+	_sync = 0;
+}
+
+void cThreadPlacement::init(const char *interfaces) {
+	lock();
+	enabled = false;
+	cpus.clear();
+	nodes.clear();
+	this->interfaces.clear();
+	plans.clear();
+	loadTopology();
+	if(cpus.size() > 1) {
+		loadInterfaces(interfaces);
+		enabled = true;
+	}
+	unlock();
+	if(enabled) {
+		syslog(LOG_NOTICE, "thread placement: %lu cpus, %lu numa nodes, pipeline node %i",
+		       cpus.size(), nodes.size(), getPipelineNode());
+	} else {
+		syslog(LOG_NOTICE, "thread placement: disabled - cpu topology is not available");
+	}
+}
+
+void cThreadPlacement::placeThread(const char *description) {
+	if(!enabled) {
+		return;
+	}
+	if(getStage(description) == _stage_na) {
+		return;
+	}
+	lock();
+	sPlan *plan = assignPlan(description, get_unix_tid());
+	plan->applied = plan->cpus.size() && setAffinity(&plan->cpus);
+	bool applied = plan->applied;
+	int node = plan->node;
+	unlock();
+	if(applied && node >= 0) {
+		setMemoryPolicy(node);
+	}
+}
+
+void cThreadPlacement::unplaceThread() {
+	if(!enabled) {
+		return;
+	}
+	int tid = get_unix_tid();
+	lock();
+	for(map<string, sPlan>::iterator iter = plans.begin(); iter != plans.end(); iter++) {
+		vector<int>::iterator iter_tid = find(iter->second.tids.begin(), iter->second.tids.end(), tid);
+		if(iter_tid != iter->second.tids.end()) {
+			iter->second.tids.erase(iter_tid);
+			break;
+		}
+	}
+	unlock();
+}
+
+int cThreadPlacement::getPipelineNode(const char *interface) {
+	if(interface) {
+		for(unsigned i = 0; i < interfaces.size(); i++) {
+			if(interfaces[i].node >= 0 && isInterfaceToken(interface, interfaces[i].name.c_str())) {
+				return(interfaces[i].node);
+			}
+		}
+	}
+	for(unsigned i = 0; i < interfaces.size(); i++) {
+		if(interfaces[i].node >= 0) {
+			return(interfaces[i].node);
+		}
+	}
+	return(nodes.size() ? nodes[0] : -1);
+}
+
+/*
+ * Caller can be already placed thread (its policy prefers its node) - policy of caller is restored 
+ * by resetMemoryNode, MPOL_DEFAULT is set only if the policy could not be read.
+ */
+void cThreadPlacement::setMemoryNode(const char *interface) {
+	if(enabled && nodes.size() > 1) {
+		memoryPolicySaved = getMemoryPolicy(&memoryPolicySavedMode, &memoryPolicySavedNodemask);
+		setMemoryPolicy(getPipelineNode(interface));
+	}
+}
+
+void cThreadPlacement::resetMemoryNode() {
+	if(enabled && nodes.size() > 1) {
+		if(memoryPolicySaved) {
+			restoreMemoryPolicy(memoryPolicySavedMode, memoryPolicySavedNodemask);
+			memoryPolicySaved = false;
+		} else {
+			setMemoryPolicy(-1);
+		}
+	}
+}
+
+string cThreadPlacement::output() {
+	if(!enabled) {
+		return("");
+	}
+	ostringstream outStr;
+	lock();
+	outStr << "thread placement - pipeline node " << getPipelineNode() << endl;
+	for(unsigned i = 0; i < interfaces.size(); i++) {
+		outStr << setw(50) << ("interface " + interfaces[i].name)
+		       << " : node " << interfaces[i].node
+		       << ", irq cpus " << (interfaces[i].irq_cpus.size() ? cpuListString(&interfaces[i].irq_cpus) : "-") << endl;
+	}
+	for(map<string, sPlan>::iterator iter = plans.begin(); iter != plans.end(); iter++) {
+		string tids;
+		for(unsigned i = 0; i < iter->second.tids.size(); i++) {
+			tids += (i ? "," : "") + intToString(iter->second.tids[i]);
+		}
+		outStr << setw(50) << iter->first
+		       << " (" << setw(5) << (tids.empty() ? "-" : tids) << ") : "
+		       << getStageName(iter->second.stage)
+		       << ", node " << iter->second.node
+		       << ", cpus " << (iter->second.cpus.size() ? cpuListString(&iter->second.cpus) : "-")
+		       << (iter->second.applied ? "" : " (not applied)") << endl;
+	}
+	unlock();
+	return(outStr.str());
+}
+
+cThreadPlacement::eStage cThreadPlacement::getStage(const char *description) {
+	for(unsigned i = 0; i < sizeof(threadPlacementStages) / sizeof(threadPlacementStages[0]); i++) {
+		if(!strncmp(description, threadPlacementStages[i].description_prefix, strlen(threadPlacementStages[i].description_prefix))) {
+			return(threadPlacementStages[i].stage);
+		}
+	}
+	return(_stage_na);
+}
+
+const char *cThreadPlacement::getStageName(eStage stage) {
+	switch(stage) {
+	case _stage_read:
+		return("read");
+	case _stage_dedup:
+		return("dedup");
+	case _stage_pb:
+		return("packetbuffer");
+	case _stage_preprocess:
+		return("preprocess");
+	case _stage_rtp_distribute:
+		return("rtp distribute");
+	case _stage_rtp_read:
+		return("rtp read");
+	case _stage_storage:
+		return("storage");
+	case _stage_na:
+		break;
+	}
+	return("na");
+}
+
+void cThreadPlacement::loadTopology() {
+	vector<int> online = parseCpuList(readFileLine("/sys/devices/system/cpu/online").c_str());
+	if(!online.size()) {
+		int count = sysconf(_SC_NPROCESSORS_ONLN);
+		for(int i = 0; i < count; i++) {
+			online.push_back(i);
+		}
+	}
+	map<int, int> cpu_node;
+	DIR *dp = opendir("/sys/devices/system/node");
+	if(dp) {
+		dirent *de;
+		while((de = readdir(dp)) != NULL) {
+			if(strncmp(de->d_name, "node", 4) || !isdigit(de->d_name[4])) {
+				continue;
+			}
+			int node = atoi(de->d_name + 4);
+			vector<int> node_cpus = parseCpuList(readFileLine(("/sys/devices/system/node/" + string(de->d_name) + "/cpulist").c_str()).c_str());
+			for(unsigned i = 0; i < node_cpus.size(); i++) {
+				cpu_node[node_cpus[i]] = node;
+			}
+		}
+		closedir(dp);
+	}
+	for(unsigned i = 0; i < online.size(); i++) {
+		sCpu cpu;
+		cpu.cpu = online[i];
+		cpu.node = cpu_node.find(online[i]) != cpu_node.end() ? cpu_node[online[i]] : 0;
+		string topologyPath = "/sys/devices/system/cpu/cpu" + intToString(online[i]) + "/topology/";
+		cpu.package = readFileInt((topologyPath + "physical_package_id").c_str(), cpu.node);
+		cpu.core = readFileInt((topologyPath + "core_id").c_str(), online[i]);
+		cpu.irq = false;
+		cpu.dedicated = false;
+		cpus.push_back(cpu);
+		if(find(nodes.begin(), nodes.end(), cpu.node) == nodes.end()) {
+			nodes.push_back(cpu.node);
+		}
+	}
+	std::sort(nodes.begin(), nodes.end());
+}
+
+void cThreadPlacement::loadInterfaces(const char *interfaces) {
+	if(!interfaces || !*interfaces) {
+		return;
+	}
+	vector<string> interfaces_names = split(interfaces, split(",|;| |\t", '|'), true);
+	for(unsigned i = 0; i < interfaces_names.size(); i++) {
+		if(interfaces_names[i].empty() || interfaces_names[i] == "any") {
+			continue;
+		}
+		sInterface interface;
+		interface.name = interfaces_names[i];
+		interface.node = readFileInt(("/sys/class/net/" + interface.name + "/device/numa_node").c_str(), -1);
+		// irqs of interface - the last column of /proc/interrupts contains name of the queue (eth0-TxRx-0, ...)
+		FILE *file = fopen("/proc/interrupts", "r");
+		if(file) {
+			char line[10000];
+			while(fgets(line, sizeof(line), file)) {
+				char *name = strrchr(line, ' ');
+				if(!name || strncmp(name + 1, interface.name.c_str(), interface.name.length()) ||
+				   (name[1 + interface.name.length()] != '-' && name[1 + interface.name.length()] != '\n')) {
+					continue;
+				}
+				int irq = atoi(line);
+				if(irq <= 0) {
+					continue;
+				}
+				string affinityPath = "/proc/irq/" + intToString(irq) + "/";
+				string affinity = readFileLine((affinityPath + "effective_affinity_list").c_str());
+				if(affinity.empty()) {
+					affinity = readFileLine((affinityPath + "smp_affinity_list").c_str());
+				}
+				vector<int> irq_cpus = parseCpuList(affinity.c_str());
+				if(irq_cpus.size() >= cpus.size()) {
+					// not bound irq
+					continue;
+				}
+				for(unsigned j = 0; j < irq_cpus.size(); j++) {
+					if(find(interface.irq_cpus.begin(), interface.irq_cpus.end(), irq_cpus[j]) == interface.irq_cpus.end()) {
+						interface.irq_cpus.push_back(irq_cpus[j]);
+					}
+				}
+			}
+			fclose(file);
+		}
+		std::sort(interface.irq_cpus.begin(), interface.irq_cpus.end());
+		map<int, unsigned> irq_nodes;
+		for(unsigned j = 0; j < interface.irq_cpus.size(); j++) {
+			for(unsigned k = 0; k < cpus.size(); k++) {
+				if(cpus[k].cpu == interface.irq_cpus[j]) {
+					cpus[k].irq = true;
+					++irq_nodes[cpus[k].node];
+				}
+			}
+		}
+		if(interface.node < 0 && irq_nodes.size()) {
+			// nic without numa_node (virtual / single node) - node of the most of its irqs
+			unsigned max = 0;
+			for(map<int, unsigned>::iterator iter = irq_nodes.begin(); iter != irq_nodes.end(); iter++) {
+				if(iter->second > max) {
+					max = iter->second;
+					interface.node = iter->first;
+				}
+			}
+		}
+		if(interface.node >= 0 && find(nodes.begin(), nodes.end(), interface.node) == nodes.end()) {
+			interface.node = -1;
+		}
+		this->interfaces.push_back(interface);
+	}
+}
+
+cThreadPlacement::sPlan *cThreadPlacement::assignPlan(const char *description, int tid) {
+	string planName = description;
+	map<string, sPlan>::iterator iter = plans.find(planName);
+	eStage stage = getStage(description);
+	if(stage == _stage_read || stage == _stage_dedup || stage == _stage_pb ||
+	   stage == _stage_preprocess || stage == _stage_rtp_distribute) {
+		// running thread keeps its dedicated core - other instance with the same description needs its own
+		for(unsigned instance = 2; iter != plans.end() && iter->second.tids.size(); instance++) {
+			planName = string(description) + " #" + intToString(instance);
+			iter = plans.find(planName);
+		}
+	}
+	if(iter == plans.end()) {
+		sPlan *plan = &plans[planName];
+		createPlan(description, plan);
+		if(plan->dedicated) {
+			updateSharedPlans();
+		}
+		iter = plans.find(planName);
+	}
+	iter->second.tids.push_back(tid);
+	return(&iter->second);
+}
+
+void cThreadPlacement::updateSharedPlans() {
+	for(map<string, sPlan>::iterator iter = plans.begin(); iter != plans.end(); iter++) {
+		sPlan *plan = &iter->second;
+		if(plan->dedicated) {
+			continue;
+		}
+		vector<int> cpus;
+		getSharedCpus(plan->shared_node, plan->shared_other_nodes, &cpus);
+		if(cpus == plan->cpus) {
+			continue;
+		}
+		plan->cpus = cpus;
+		if(!dryRun) {
+			for(unsigned i = 0; i < plan->tids.size(); i++) {
+				if(!setAffinity(&plan->cpus, plan->tids[i])) {
+					plan->applied = false;
+				}
+			}
+		}
+	}
+}
+
+void cThreadPlacement::createPlan(const char *description, sPlan *plan) {
+	plan->stage = getStage(description);
+	plan->node = getPipelineNode(plan->stage == _stage_read || plan->stage == _stage_dedup || plan->stage == _stage_pb ?
+				      description : NULL);
+	plan->dedicated = false;
+	plan->shared_node = plan->node;
+	plan->shared_other_nodes = false;
+	plan->applied = false;
+	switch(plan->stage) {
+	case _stage_read:
+	case _stage_dedup:
+	case _stage_pb:
+	case _stage_preprocess:
+	case _stage_rtp_distribute:
+		plan->dedicated = takeDedicatedCore(plan->node, &plan->cpus);
+		break;
+	case _stage_storage:
+		if(nodes.size() > 1) {
+			plan->shared_other_nodes = true;
+			plan->node = -1;
+		}
+		break;
+	case _stage_rtp_read:
+	case _stage_na:
+		break;
+	}
+	if(!plan->dedicated) {
+		getSharedCpus(plan->shared_node, plan->shared_other_nodes, &plan->cpus);
+	}
+}
+
+bool cThreadPlacement::takeDedicatedCore(int node, vector<int> *cpus) {
+	// the first pass skips cores handling irqs of interfaces
+	for(unsigned pass = 0; pass < 2; pass++) {
+		for(unsigned i = 0; i < this->cpus.size(); i++) {
+			sCpu *cpu = &this->cpus[i];
+			if(cpu->node != node || cpu->dedicated || (pass == 0 && cpu->irq)) {
+				continue;
+			}
+			// whole physical core (with hyperthreading siblings)
+			vector<unsigned> core_cpus;
+			bool core_irq = false;
+			bool core_dedicated = false;
+			for(unsigned j = 0; j < this->cpus.size(); j++) {
+				if(this->cpus[j].package == cpu->package && this->cpus[j].core == cpu->core && this->cpus[j].node == node) {
+					core_cpus.push_back(j);
+					core_irq |= this->cpus[j].irq;
+					core_dedicated |= this->cpus[j].dedicated;
+				}
+			}
+			if(core_dedicated || (pass == 0 && core_irq)) {
+				continue;
+			}
+			// at least one cpu of the node has to stay for shared threads
+			unsigned node_free = 0;
+			for(unsigned j = 0; j < this->cpus.size(); j++) {
+				if(this->cpus[j].node == node && !this->cpus[j].dedicated) {
+					++node_free;
+				}
+			}
+			if(node_free <= core_cpus.size()) {
+				return(false);
+			}
+			cpus->clear();
+			for(unsigned j = 0; j < core_cpus.size(); j++) {
+				this->cpus[core_cpus[j]].dedicated = true;
+				cpus->push_back(this->cpus[core_cpus[j]].cpu);
+			}
+			return(true);
+		}
+	}
+	return(false);
+}
+
+void cThreadPlacement::getSharedCpus(int node, bool otherNodes, vector<int> *cpus) {
+	cpus->clear();
+	for(unsigned i = 0; i < this->cpus.size(); i++) {
+		if((otherNodes ? this->cpus[i].node != node : this->cpus[i].node == node) &&
+		   !this->cpus[i].dedicated) {
+			cpus->push_back(this->cpus[i].cpu);
+		}
+	}
+	if(!cpus->size()) {
+		for(unsigned i = 0; i < this->cpus.size(); i++) {
+			if(otherNodes || this->cpus[i].node == node) {
+				cpus->push_back(this->cpus[i].cpu);
+			}
+		}
+	}
+}
+
+bool cThreadPlacement::setAffinity(vector<int> *cpus, int tid) {
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+	for(unsigned i = 0; i < cpus->size(); i++) {
+		if((*cpus)[i] < CPU_SETSIZE) {
+			CPU_SET((*cpus)[i], &cpuset);
+		}
+	}
+	if(sched_setaffinity(tid, sizeof(cpuset), &cpuset)) {
+		syslog(LOG_ERR, "thread placement: sched_setaffinity failed - %s", strerror(errno));
+		return(false);
+	}
+	return(true);
+}
+
+bool cThreadPlacement::setMemoryPolicy(int node) {
+	#ifdef SYS_set_mempolicy
+	if(node >= (int)(sizeof(unsigned long) * 8)) {
+		return(false);
+	}
+	unsigned long nodemask = node >= 0 ? 1ul << node : 0;
+	return(syscall(SYS_set_mempolicy, node >= 0 ? MPOL_PREFERRED : MPOL_DEFAULT,
+		       node >= 0 ? &nodemask : NULL, node >= 0 ? sizeof(nodemask) * 8 + 1 : 0) == 0);
+	#else
+	return(false);
+	#endif
+}
+
+bool cThreadPlacement::getMemoryPolicy(int *mode, unsigned long *nodemask) {
+	#ifdef SYS_get_mempolicy
+	*nodemask = 0;
+	return(syscall(SYS_get_mempolicy, mode, nodemask, sizeof(*nodemask) * 8, NULL, 0) == 0);
+	#else
+	return(false);
+	#endif
+}
+
+bool cThreadPlacement::restoreMemoryPolicy(int mode, unsigned long nodemask) {
+	#ifdef SYS_set_mempolicy
+	return(syscall(SYS_set_mempolicy, mode,
+		       nodemask ? &nodemask : NULL, nodemask ? sizeof(nodemask) * 8 + 1 : 0) == 0);
+	#else
+	return(false);
+	#endif
+}
+
+bool cThreadPlacement::isInterfaceToken(const char *str, const char *interface) {
+	// interface must be whole word - eth1 must not match eth10 or eth1.100
+	size_t interfaceLength = strlen(interface);
+	if(!interfaceLength) {
+		return(false);
+	}
+	for(const char *pos = str; (pos = strstr(pos, interface)) != NULL; pos++) {
+		char prev = pos > str ? *(pos - 1) : 0;
+		char next = pos[interfaceLength];
+		if(!isInterfaceNameChar(prev) && !isInterfaceNameChar(next)) {
+			return(true);
+		}
+	}
+	return(false);
+}
+
+vector<int> cThreadPlacement::parseCpuList(const char *cpuList) {
+	vector<int> rslt;
+	vector<string> items = split(cpuList, ",", true);
+	for(unsigned i = 0; i < items.size(); i++) {
+		if(items[i].empty() || !isdigit(items[i][0])) {
+			continue;
+		}
+		int from = atoi(items[i].c_str());
+		size_t pos = items[i].find('-');
+		int to = pos != string::npos ? atoi(items[i].c_str() + pos + 1) : from;
+		for(int cpu = from; cpu <= to; cpu++) {
+			rslt.push_back(cpu);
+		}
+	}
+	return(rslt);
+}
+
+string cThreadPlacement::cpuListString(vector<int> *cpus) {
+	string rslt;
+	for(unsigned i = 0; i < cpus->size(); ) {
+		unsigned j = i;
+		while(j + 1 < cpus->size() && (*cpus)[j + 1] == (*cpus)[j] + 1) {
+			++j;
+		}
+		if(!rslt.empty()) {
+			rslt += ",";
+		}
+		rslt += intToString((*cpus)[i]);
+		if(j > i) {
+			rslt += "-" + intToString((*cpus)[j]);
+		}
+		i = j + 1;
+	}
+	return(rslt);
+}
+
+int cThreadPlacement::readFileInt(const char *fileName, int defaultValue) {
+	string line = readFileLine(fileName);
+	return(line.empty() ? defaultValue : atoi(line.c_str()));
+}
+
+string cThreadPlacement::readFileLine(const char *fileName) {
+	string rslt;
+	FILE *file = fopen(fileName, "r");
+	if(file) {
+		char line[1024];
+		if(fgets(line, sizeof(line), file)) {
+			rslt = line;
+			while(rslt.length() && (rslt[rslt.length() - 1] == '\n' || rslt[rslt.length() - 1] == '\r')) {
+				rslt.resize(rslt.length() - 1);
+			}
+		}
+		fclose(file);
+	}
+	return(rslt);
+}
+
+/*
+ * Planner check against fake topology (no affinity is set):
+ * 2 nodes x 6 cores x 2 hyperthreads, cpus 0-5,12-17 on node 0, 6-11,18-23 on node 1,
+ * irq of eth0 on core 0 of node 0. Threads are placed in the order of sniffer start (rtp read and storage first).
+ */
+bool cThreadPlacement::test() {
+	bool ok = true;
+	struct {
+		const char *cpuList;
+		const char *expected;
+	} cpuLists[] = {
+		{ "0-3,8,10-11", "0-3,8,10-11" },
+		{ "5", "5" },
+		{ "0,2,4", "0,2,4" },
+		{ "", "" },
+		{ "0-1,x,3\n", "0-1,3" }
+	};
+	for(unsigned i = 0; i < sizeof(cpuLists) / sizeof(cpuLists[0]); i++) {
+		vector<int> cpus = parseCpuList(cpuLists[i].cpuList);
+		string cpusStr = cpuListString(&cpus);
+		if(cpusStr != cpuLists[i].expected) {
+			cout << "parseCpuList '" << cpuLists[i].cpuList << "' : " << cpusStr << " (expected " << cpuLists[i].expected << ")" << endl;
+			ok = false;
+		}
+	}
+	cThreadPlacement tp;
+	tp.enabled = true;
+	tp.dryRun = true;
+	for(int i = 0; i < 24; i++) {
+		sCpu cpu;
+		cpu.cpu = i;
+		cpu.node = (i % 12) / 6;
+		cpu.package = cpu.node;
+		cpu.core = i % 6;
+		cpu.irq = cpu.node == 0 && cpu.core == 0;
+		cpu.dedicated = false;
+		tp.cpus.push_back(cpu);
+	}
+	tp.nodes.push_back(0);
+	tp.nodes.push_back(1);
+	sInterface interface;
+	interface.name = "eth0";
+	interface.node = 0;
+	interface.irq_cpus.push_back(0);
+	interface.irq_cpus.push_back(12);
+	tp.interfaces.push_back(interface);
+	const char *threads[] = {
+		"rtp read",
+		"rtp read",
+		"tar",
+		"pb - read thread eth0 read",
+		"pb - main eth0",
+		"t2 rtp preprocess distribute 0",
+		"t2 rtp preprocess distribute 1",
+		"t2 sip preprocess callx",
+		"t2 sip preprocess callx",
+		"t2 rtp preprocess distribute 2"
+	};
+	int tid = 1000;
+	for(unsigned i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+		tp.assignPlan(threads[i], ++tid);
+	}
+	// restarted thread gets the same plan
+	vector<int> distributeCpus = tp.plans["t2 rtp preprocess distribute 0"].cpus;
+	tp.plans["t2 rtp preprocess distribute 0"].tids.clear();
+	if(tp.assignPlan("t2 rtp preprocess distribute 0", ++tid)->cpus != distributeCpus) {
+		cout << "restarted thread did not get the same cpus" << endl;
+		ok = false;
+	}
+	vector<int> dedicatedCpus;
+	unsigned countDedicated = 0;
+	for(map<string, sPlan>::iterator iter = tp.plans.begin(); iter != tp.plans.end(); iter++) {
+		cout << setw(40) << iter->first << " : "
+		     << getStageName(iter->second.stage)
+		     << ", node " << iter->second.node
+		     << (iter->second.dedicated ? ", dedicated" : ", shared")
+		     << ", cpus " << cpuListString(&iter->second.cpus) << endl;
+		if(!iter->second.cpus.size()) {
+			cout << iter->first << " : no cpus" << endl;
+			ok = false;
+		}
+		if(iter->second.dedicated) {
+			++countDedicated;
+			for(unsigned i = 0; i < iter->second.cpus.size(); i++) {
+				if(find(dedicatedCpus.begin(), dedicatedCpus.end(), iter->second.cpus[i]) != dedicatedCpus.end()) {
+					cout << iter->first << " : cpu " << iter->second.cpus[i] << " is dedicated twice" << endl;
+					ok = false;
+				}
+				if(tp.cpus[iter->second.cpus[i]].irq) {
+					cout << iter->first << " : dedicated irq cpu " << iter->second.cpus[i] << endl;
+					ok = false;
+				}
+				dedicatedCpus.push_back(iter->second.cpus[i]);
+			}
+		}
+	}
+	for(map<string, sPlan>::iterator iter = tp.plans.begin(); iter != tp.plans.end(); iter++) {
+		if(iter->second.dedicated) {
+			continue;
+		}
+		for(unsigned i = 0; i < iter->second.cpus.size(); i++) {
+			if(find(dedicatedCpus.begin(), dedicatedCpus.end(), iter->second.cpus[i]) != dedicatedCpus.end()) {
+				cout << iter->first << " : shared cpus contain dedicated cpu " << iter->second.cpus[i] << endl;
+				ok = false;
+			}
+			if(iter->second.stage == _stage_storage ?
+			    tp.cpus[iter->second.cpus[i]].node == 0 :
+			    tp.cpus[iter->second.cpus[i]].node != 0) {
+				cout << iter->first << " : cpu " << iter->second.cpus[i] << " is on wrong node" << endl;
+				ok = false;
+			}
+		}
+	}
+	// node 0 has 5 cores without irq, core with irq stays for shared threads
+	if(countDedicated != 5) {
+		cout << "dedicated plans: " << countDedicated << " (expected 5)" << endl;
+		ok = false;
+	}
+	if(tp.plans.find("t2 sip preprocess callx #2") == tp.plans.end()) {
+		cout << "second running thread with the same description did not get its own plan" << endl;
+		ok = false;
+	}
+	return(ok);
+}
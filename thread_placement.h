@@ -0,0 +1,122 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <ctype.h>
+#include <sys/types.h>
+
+
+using namespace std;
+
+
+/*
+ * Placement of threads of the packet pipeline to cpus (option thread_placement).
+ * Topology (cpus, physical cores, numa nodes) is read from /sys/devices/system, locality of sniffing interfaces
+ * from /sys/class/net/<interface>/device/numa_node and cpus handling their irqs (/proc/interrupts, /proc/irq).
+ * Thread is placed when it starts (vm_pthread_create) according to its description:
+ *  - read, dedup, packetbuffer and preprocess threads get dedicated physical core on the node of the interface
+ *    (cores handling irqs of the interface are used as the last ones),
+ *  - rtp read threads share the rest of cpus of the node,
+ *  - storage threads (tar, sql, charts, ...) use cpus of the other nodes.
+ * Plan is kept by thread description - restarted thread gets the same cpus, another running thread with the same
+ * description of a dedicated stage gets its own plan (description #2, #3, ...).
+ * When a core becomes dedicated, cpus of shared plans are recomputed and reapplied to their running threads,
+ * so threads started earlier (rtp read, storage) do not keep the dedicated core.
+ * Memory policy of placed thread prefers its node (blocks are allocated by producer which is on the node
+ * of consumer), queue buffers allocated in main thread are allocated in setMemoryNode / resetMemoryNode scope.
+ */
+class cThreadPlacement {
+public:
+	enum eStage {
+		_stage_na,
+		_stage_read,
+		_stage_dedup,
+		_stage_pb,
+		_stage_preprocess,
+		_stage_rtp_distribute,
+		_stage_rtp_read,
+		_stage_storage
+	};
+	struct sCpu {
+		int cpu;
+		int node;
+		int package;
+		int core;
+		bool irq;
+		bool dedicated;
+	};
+	struct sInterface {
+		string name;
+		int node;
+		vector<int> irq_cpus;
+	};
+	struct sPlan {
+		eStage stage;
+		int node;
+		vector<int> cpus;
+		bool dedicated;
+		int shared_node;
+		bool shared_other_nodes;
+		vector<int> tids;
+		bool applied;
+	};
+public:
+	cThreadPlacement();
+	void init(const char *interfaces);
+	bool isEnabled() {
+		return(enabled);
+	}
+	void placeThread(const char *description);
+	void unplaceThread();
+	int getPipelineNode(const char *interface = NULL);
+	void setMemoryNode(const char *interface = NULL);
+	void resetMemoryNode();
+	string output();
+	static eStage getStage(const char *description);
+	static const char *getStageName(eStage stage);
+	static bool test();
+private:
+	sPlan *assignPlan(const char *description, int tid);
+	void updateSharedPlans();
+	void loadTopology();
+	void loadInterfaces(const char *interfaces);
+	void createPlan(const char *description, sPlan *plan);
+	bool takeDedicatedCore(int node, vector<int> *cpus);
+	void getSharedCpus(int node, bool otherNodes, vector<int> *cpus);
+	static bool setAffinity(vector<int> *cpus, int tid = 0);
+	static bool setMemoryPolicy(int node);
+	static bool getMemoryPolicy(int *mode, unsigned long *nodemask);
+	static bool restoreMemoryPolicy(int mode, unsigned long nodemask);
+	static bool isInterfaceToken(const char *str, const char *interface);
+	static bool isInterfaceNameChar(char c) {
+		return(isalnum(c) || c == '.' || c == '_' || c == '-' || c == ':' || c == '@');
+	}
+	static vector<int> parseCpuList(const char *cpuList);
+	static string cpuListString(vector<int> *cpus);
+	static int readFileInt(const char *fileName, int defaultValue);
+	static string readFileLine(const char *fileName);
+	void lock() {
+		while(__sync_lock_test_and_set(&_sync, 1));
+	}
+	void unlock() {
+		__sync_lock_release(&_sync);
+	}
+private:
+	bool enabled;
+	vector<sCpu> cpus;
+	vector<int> nodes;
+	vector<sInterface> interfaces;
+	map<string, sPlan> plans;
+	bool dryRun;
+	volatile int _sync;
+};
+
+
+extern cThreadPlacement threadPlacement;
+
+
+#endif //THREAD_PLACEMENT_H
@@ -0,0 +1,191 @@
+#include <string.h>
+#include <sstream>
+
+#include "timer_wheel.h"
+
+
+cTimerWheel::cTimerWheel() {
+	memset(slots, 0, sizeof(slots));
+	due = NULL;
+	now = 0;
+	started = false;
+	count = 0;
+	_sync = 0;
+}
+
+void cTimerWheel::add(sTimerWheelNode *node, u_int32_t expire) {
+	if(node->state == sTimerWheelNode::_tws_linked) {
+		unlink(node);
+	}
+	node->expire = expire;
+	node->pending_expire = 0;
+	link(node);
+	++stat.adds;
+}
+
+void cTimerWheel::remove(sTimerWheelNode *node) {
+	if(node->state == sTimerWheelNode::_tws_linked) {
+		unlink(node);
+	}
+	node->state = sTimerWheelNode::_tws_none;
+}
+
+void cTimerWheel::shift(sTimerWheelNode *node, u_int32_t expire) {
+	if(node->state == sTimerWheelNode::_tws_linked) {
+		if(expire < node->expire) {
+			unlink(node);
+			node->expire = expire;
+			link(node);
+			++stat.shifts;
+		}
+	} else if(node->state == sTimerWheelNode::_tws_processing) {
+		if(!node->pending_expire || expire < node->pending_expire) {
+			node->pending_expire = expire;
+		}
+	}
+}
+
+void cTimerWheel::relink(sTimerWheelNode *node, u_int32_t expire) {
+	if(node->state != sTimerWheelNode::_tws_processing) {
+		return;
+	}
+	if(node->pending_expire && node->pending_expire < expire) {
+		expire = node->pending_expire;
+	}
+	node->expire = expire;
+	node->pending_expire = 0;
+	link(node);
+}
+
+void cTimerWheel::advance(u_int32_t to, vector<sTimerWheelNode*> *expired) {
+	if(!started) {
+		now = to;
+		started = true;
+	}
+	if(to > now) {
+		if(to - now > (1u << (TIMER_WHEEL_BITS * 2))) {
+			rebuild(to);
+		} else {
+			while(now < to) {
+				++now;
+				++stat.ticks;
+				for(unsigned level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+					if(now & ((1u << (TIMER_WHEEL_BITS * level)) - 1)) {
+						break;
+					}
+					cascade(level);
+				}
+				sTimerWheelNode **slot = &slots[0][now & TIMER_WHEEL_SLOTS_MASK];
+				while(*slot) {
+					sTimerWheelNode *node = *slot;
+					unlink(node);
+					if(node->expire > now) {
+						link(node);
+						continue;
+					}
+					pushExpired(node, expired);
+				}
+			}
+		}
+	}
+	// added / shifted to the past or cascaded exactly to now
+	while(due) {
+		sTimerWheelNode *node = due;
+		unlink(node);
+		pushExpired(node, expired);
+	}
+}
+
+string cTimerWheel::getStatString() {
+	ostringstream outStr;
+	outStr << "size: " << count
+	       << ", now: " << now
+	       << ", adds: " << stat.adds
+	       << ", shifts: " << stat.shifts
+	       << ", expired: " << stat.expired
+	       << ", cascaded: " << stat.cascaded
+	       << ", ticks: " << stat.ticks;
+	return(outStr.str());
+}
+
+void cTimerWheel::link(sTimerWheelNode *node) {
+	sTimerWheelNode **head;
+	if(!started || node->expire <= now) {
+		// before the first advance the time base is unknown - node is evaluated by the first advance
+		head = &due;
+		node->level = TIMER_WHEEL_LEVELS;
+		node->slot = 0;
+	} else {
+		u_int32_t delta = node->expire - now;
+		u_int32_t expire = node->expire;
+		if(delta > TIMER_WHEEL_MAX_DELTA) {
+			expire = now + TIMER_WHEEL_MAX_DELTA;
+			delta = TIMER_WHEEL_MAX_DELTA;
+		}
+		unsigned level = 0;
+		while(level < TIMER_WHEEL_LEVELS - 1 &&
+		      delta >= (1u << (TIMER_WHEEL_BITS * (level + 1)))) {
+			++level;
+		}
+		node->level = level;
+		node->slot = (expire >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_SLOTS_MASK;
+		head = &slots[level][node->slot];
+	}
+	node->prev = NULL;
+	node->next = *head;
+	if(*head) {
+		(*head)->prev = node;
+	}
+	*head = node;
+	node->state = sTimerWheelNode::_tws_linked;
+	++count;
+}
+
+void cTimerWheel::unlink(sTimerWheelNode *node) {
+	if(node->prev) {
+		node->prev->next = node->next;
+	} else if(node->level == TIMER_WHEEL_LEVELS) {
+		due = node->next;
+	} else {
+		slots[node->level][node->slot] = node->next;
+	}
+	if(node->next) {
+		node->next->prev = node->prev;
+	}
+	node->prev = NULL;
+	node->next = NULL;
+	node->state = sTimerWheelNode::_tws_none;
+	--count;
+}
+
+void cTimerWheel::cascade(unsigned level) {
+	sTimerWheelNode **slot = &slots[level][(now >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_SLOTS_MASK];
+	sTimerWheelNode *list = *slot;
+	*slot = NULL;
+	while(list) {
+		sTimerWheelNode *node = list;
+		list = node->next;
+		node->prev = NULL;
+		node->next = NULL;
+		--count;
+		link(node);
+		++stat.cascaded;
+	}
+}
+
+void cTimerWheel::rebuild(u_int32_t to) {
+	vector<sTimerWheelNode*> nodes;
+	for(unsigned level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		for(unsigned i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+			while(slots[level][i]) {
+				sTimerWheelNode *node = slots[level][i];
+				unlink(node);
+				nodes.push_back(node);
+			}
+		}
+	}
+	now = to;
+	for(unsigned i = 0; i < nodes.size(); i++) {
+		link(nodes[i]);
+	}
+}
@@ -0,0 +1,123 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+
+#include <vector>
+#include <string>
+#include <sys/types.h>
+
+#include "sync.h"
+
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_SLOTS_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_MAX_DELTA ((1u << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+
+using namespace std;
+
+
+struct sTimerWheelNode {
+	enum eState {
+		_tws_none,
+		_tws_linked,
+		_tws_processing
+	};
+	sTimerWheelNode() {
+		prev = NULL;
+		next = NULL;
+		expire = 0;
+		pending_expire = 0;
+		state = _tws_none;
+		level = 0;
+		slot = 0;
+		owner = NULL;
+	}
+	sTimerWheelNode *prev;
+	sTimerWheelNode *next;
+	volatile u_int32_t expire;
+	u_int32_t pending_expire;
+	volatile u_int8_t state;
+	u_int8_t level;
+	u_int16_t slot;
+	void *owner;
+};
+
+
+/*
+ * Hierarchical timing wheel with 1s resolution (4 levels x 64 slots, ~194 days range).
+ * Nodes are intrusive - owner embeds sTimerWheelNode and sets node->owner.
+ * Wheel itself is not thread safe - use lock() / unlock().
+ * Node taken by advance() is in state _tws_processing; shift() during processing
+ * is remembered in pending_expire and applied by relink().
+ */
+class cTimerWheel {
+public:
+	struct sStat {
+		sStat() {
+			clear();
+		}
+		void clear() {
+			adds = 0;
+			shifts = 0;
+			expired = 0;
+			cascaded = 0;
+			ticks = 0;
+		}
+		u_int64_t adds;
+		u_int64_t shifts;
+		u_int64_t expired;
+		u_int64_t cascaded;
+		u_int64_t ticks;
+	};
+public:
+	cTimerWheel();
+	void add(sTimerWheelNode *node, u_int32_t expire);
+	void remove(sTimerWheelNode *node);
+	void shift(sTimerWheelNode *node, u_int32_t expire);
+	void relink(sTimerWheelNode *node, u_int32_t expire);
+	void advance(u_int32_t to, vector<sTimerWheelNode*> *expired);
+	void lock() {
+		__SYNC_LOCK(_sync);
+	}
+	void unlock() {
+		__SYNC_UNLOCK(_sync);
+	}
+	size_t size() {
+		return(count);
+	}
+	u_int32_t getNow() {
+		return(now);
+	}
+	sStat getStat() {
+		return(stat);
+	}
+	void clearStat() {
+		stat.clear();
+	}
+	string getStatString();
+private:
+	void link(sTimerWheelNode *node);
+	void unlink(sTimerWheelNode *node);
+	void cascade(unsigned level);
+	void rebuild(u_int32_t to);
+	inline void pushExpired(sTimerWheelNode *node, vector<sTimerWheelNode*> *expired) {
+		node->state = sTimerWheelNode::_tws_processing;
+		node->pending_expire = 0;
+		expired->push_back(node);
+		++stat.expired;
+	}
+private:
+	sTimerWheelNode *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+	sTimerWheelNode *due;
+	u_int32_t now;
+	bool started;
+	size_t count;
+	sStat stat;
+	volatile int _sync;
+};
+
+
+#endif //TIMER_WHEEL_H
@@ -83,6 +83,7 @@
 #include "tar.h"
 #include "filter_mysql.h"
 #include "sniff_inline.h"
+#include "sip_scan.h"
 #include "sql_db.h"
 
 #ifndef SIZE_MAX
@@ -2682,6 +2683,104 @@ void ListIP::add(vector<vmIPmask> *net) {
 	}
 }
 
+void ListIP::prepareLpm() {
+	if(autoLock) lock();
+	if(!lpm) {
+		cLpmIP *_lpm = new FILE_LINE(0) cLpmIP;
+		for(unsigned pass = 0; pass < 2; pass++) {
+			vector<IP> *list = pass == 0 ? &listIP : &listNet;
+			for(unsigned i = 0; i < list->size(); i++) {
+				_lpm->add((*list)[i].ip, (*list)[i].mask_length, 1);
+			}
+		}
+		_lpm->build();
+		__sync_synchronize();
+		lpm = _lpm;
+	}
+	if(autoLock) unlock();
+}
+
+bool ListIP::lpmTest() {
+	srand(1);
+	unsigned errors = 0;
+	for(unsigned round = 0; round < 20; round++) {
+		ListIP list;
+		vector<vmIP> ips;
+		unsigned count = 1 + rand() % 200;
+		for(unsigned i = 0; i < count; i++) {
+			vmIP ip;
+			bool v6 = rand() % 3 == 0;
+			if(v6) {
+				#if VM_IPV6
+				in6_addr ip6;
+				memset(&ip6, 0, sizeof(ip6));
+				ip6.s6_addr[0] = 0x20;
+				ip6.s6_addr[1] = 0x01;
+				for(unsigned j = 2; j < 16; j++) {
+					ip6.s6_addr[j] = j < 6 || rand() % 4 == 0 ? rand() % 4 : 0;
+				}
+				ip.setIPv6(ip6);
+				#else
+				v6 = false;
+				#endif
+			}
+			if(!v6) {
+				// small address space so that the nets overlap and nest
+				ip.setIPv4((u_int32_t)((10 << 24) | ((rand() % 4) << 16) | ((rand() % 8) << 8) | (rand() % 16)));
+			}
+			unsigned bits = ip.bits();
+			unsigned mask = rand() % 2 ? bits : bits - rand() % (bits / 2 + 1);
+			if(rand() % 50 == 0) {
+				mask = 0;
+			}
+			list.add(ip, mask);
+			ips.push_back(ip);
+		}
+		vector<vmIP> check_ips = ips;
+		for(unsigned i = 0; i < ips.size(); i++) {
+			for(unsigned j = 0; j < 4; j++) {
+				vmIP check_ip = ips[i];
+				if(check_ip.is_v6()) {
+					#if VM_IPV6
+					in6_addr ip6 = check_ip.getIPv6();
+					ip6.s6_addr[15 - rand() % 12] ^= 1 << (rand() % 8);
+					check_ip.setIPv6(ip6);
+					#endif
+				} else {
+					check_ip.setIPv4(check_ip.getIPv4() ^ (1 << (rand() % 24)));
+				}
+				check_ips.push_back(check_ip);
+			}
+		}
+		vector<bool> rslt_sorted;
+		for(unsigned i = 0; i < check_ips.size(); i++) {
+			rslt_sorted.push_back(list.checkIP(check_ips[i]));
+		}
+		list.prepareLpm();
+		if(!list.lpm) {
+			return(false);
+		}
+		for(unsigned i = 0; i < check_ips.size(); i++) {
+			bool rslt_naive = false;
+			for(unsigned pass = 0; pass < 2 && !rslt_naive; pass++) {
+				vector<IP> *_list = pass == 0 ? &list.listIP : &list.listNet;
+				for(unsigned j = 0; j < _list->size() && !rslt_naive; j++) {
+					rslt_naive = (*_list)[j].checkIP(check_ips[i]);
+				}
+			}
+			bool rslt_lpm = list.checkIP(check_ips[i]);
+			if(rslt_lpm != rslt_sorted[i] || rslt_lpm != rslt_naive) {
+				if(errors < 10) {
+					cout << "ListIP lpm test: " << check_ips[i].getString()
+					     << " lpm " << rslt_lpm << " sorted " << rslt_sorted[i] << " naive " << rslt_naive << endl;
+				}
+				++errors;
+			}
+		}
+	}
+	return(errors == 0);
+}
+
 GroupIP::GroupIP() {
 	this->id = 0;
 }
@@ -2783,6 +2882,92 @@ void ListPhoneNumber::addComb(const char *number, ListPhoneNumber *negList) {
 	}
 }
 
+void ListPhoneNumber::prepareLpm() {
+	if(autoLock) lock();
+	if(!lpm && !lpm_disabled) {
+		cLpmNumber *_lpm = new FILE_LINE(0) cLpmNumber;
+		bool ok = true;
+		for(unsigned pass = 0; pass < 2 && ok; pass++) {
+			vector<PhoneNumber> *list = pass == 0 ? &listPhoneNumber : &listPrefixes;
+			for(unsigned i = 0; i < list->size() && ok; i++) {
+				ok = _lpm->add((*list)[i].number.c_str(), (*list)[i].prefix, 1);
+			}
+		}
+		if(ok) {
+			_lpm->build();
+			__sync_synchronize();
+			lpm = _lpm;
+		} else {
+			// numbers with characters not supported by cLpmNumber - lookup via sorted lists
+			delete _lpm;
+			lpm_disabled = true;
+		}
+	}
+	if(autoLock) unlock();
+}
+
+bool ListPhoneNumber::lpmTest() {
+	srand(1);
+	unsigned errors = 0;
+	const char *symbols = "0123456789+*#";
+	for(unsigned round = 0; round < 20; round++) {
+		ListPhoneNumber list;
+		vector<string> numbers;
+		unsigned count = 1 + rand() % 200;
+		for(unsigned i = 0; i < count; i++) {
+			string number;
+			unsigned length = 1 + rand() % 8;
+			for(unsigned j = 0; j < length; j++) {
+				// few distinct symbols so that the prefixes nest
+				number += symbols[rand() % 10 < 8 ? rand() % 3 : rand() % 13];
+			}
+			list.add(number.c_str(), rand() % 3 != 0);
+			numbers.push_back(number);
+		}
+		vector<string> check_numbers = numbers;
+		for(unsigned i = 0; i < numbers.size(); i++) {
+			check_numbers.push_back(numbers[i] + symbols[rand() % 3]);
+			check_numbers.push_back(numbers[i] + symbols[rand() % 3] + symbols[rand() % 10]);
+			check_numbers.push_back(numbers[i].substr(0, numbers[i].length() - 1));
+		}
+		vector<bool> rslt_sorted;
+		for(unsigned i = 0; i < check_numbers.size(); i++) {
+			rslt_sorted.push_back(list.checkNumber(check_numbers[i].c_str()));
+		}
+		list.prepareLpm();
+		if(!list.lpm) {
+			return(false);
+		}
+		for(unsigned i = 0; i < check_numbers.size(); i++) {
+			bool rslt_naive = false;
+			for(unsigned pass = 0; pass < 2 && !rslt_naive; pass++) {
+				vector<PhoneNumber> *_list = pass == 0 ? &list.listPhoneNumber : &list.listPrefixes;
+				for(unsigned j = 0; j < _list->size() && !rslt_naive; j++) {
+					rslt_naive = (*_list)[j].checkNumber(check_numbers[i].c_str());
+				}
+			}
+			bool rslt_lpm = list.checkNumber(check_numbers[i].c_str());
+			// sorted lookup checks only the nearest lower prefix - it may miss a shorter matching prefix
+			if(rslt_lpm != rslt_naive || (rslt_sorted[i] && !rslt_lpm)) {
+				if(errors < 10) {
+					cout << "ListPhoneNumber lpm test: " << check_numbers[i]
+					     << " lpm " << rslt_lpm << " sorted " << rslt_sorted[i] << " naive " << rslt_naive << endl;
+				}
+				++errors;
+			}
+		}
+	}
+	ListPhoneNumber list_other;
+	list_other.add("123");
+	list_other.add("12a");
+	list_other.prepareLpm();
+	if(list_other.lpm || !list_other.checkNumber("1234") || !list_other.checkNumber("12ab") || list_other.checkNumber("13")) {
+		cout << "ListPhoneNumber lpm test: fallback to sorted lists failed" << endl;
+		++errors;
+	}
+	return(errors == 0);
+}
+
 void ListUA::addComb(string &ua, ListUA *negList) {
 	addComb(ua.c_str(), negList);
 }
@@ -3234,12 +3419,14 @@ u_int32_t ParsePacket::parseData(char *data, unsigned long datalen, ppContentsX
 	unsigned long rsltDataLen = datalen;
 	contents->sip = datalen ? isSipContent(data, datalen - 1) : false;
 	unsigned int namelength;
-	for(unsigned long i = 0; i < datalen; i++) {
-		if(!contents->doubleEndLine && 
+	// walk line starts only - line ends are found by vectorized scan (sip_scan.h)
+	unsigned long i = 0;
+	while(i < datalen) {
+		if(!contents->doubleEndLine &&
 		   datalen > 3 &&
-		   data[i] == '\r' && i < datalen - 3 && 
-		   data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n') {
-			contents->doubleEndLine = data + i;
+		   i >= 2 && i < datalen - 1 &&
+		   data[i] == '\r' && data[i + 1] == '\n' && data[i - 2] == '\r' && data[i - 1] == '\n') {
+			contents->doubleEndLine = data + i - 2;
 			if(contents->contentLength > -1) {
 				unsigned long modify_datalen = contents->doubleEndLine + 4 - data + contents->contentLength;
 				if(modify_datalen < datalen) {
@@ -3251,39 +3438,37 @@ u_int32_t ParsePacket::parseData(char *data, unsigned long datalen, ppContentsX
 				break;
 			}
 			i += 2;
-		} else if(i == 0 || data[i - 1] == '\n') {
-			ppNode *node = getNode(data + i, datalen - i - 1, &namelength);
-			if(node && !node->isSetNode(contents)) {
-				ppContentItemX *contentItem = node->getPointerToItem(contents);
-				contentItem->offset = i + namelength;
-				i += namelength;
-				bool endLine = false;
-				for(; i < datalen; i++) {
-					if(data[i] == '\r' || data[i] == '\n') {
-						endLine = true;
-						break;
-					}
-				}
-				if(endLine || i == datalen) {
-					contentItem->length = i - contentItem->offset;
-					contentItem->trim(data);
-					if(node->isContentLength && contentItem->length) {
-						if(contentItem->offset + contentItem->length == datalen) {
-							char tempLength[10];
-							int maxLengthLength = MIN(sizeof(tempLength) - 1, contentItem->length);
-							strncpy(tempLength, data + contentItem->offset, maxLengthLength);
-							tempLength[maxLengthLength] = 0;
-							contents->contentLength = atoi(tempLength);
-						} else {
-							contents->contentLength = atoi(data + contentItem->offset);
-						}
-					}
-					if(endLine) {
-						--i;
-					}
+			continue;
+		}
+		ppNode *node = getNode(data + i, datalen - i - 1, &namelength);
+		if(node && !node->isSetNode(contents)) {
+			ppContentItemX *contentItem = node->getPointerToItem(contents);
+			contentItem->offset = i + namelength;
+			i += namelength;
+			const char *endLine = sip_scan_find(data + i, datalen - i, '\r', '\n');
+			i = endLine ? endLine - data : datalen;
+			contentItem->length = i - contentItem->offset;
+			contentItem->trim(data);
+			if(node->isContentLength && contentItem->length) {
+				if(contentItem->offset + contentItem->length == datalen) {
+					char tempLength[10];
+					int maxLengthLength = MIN(sizeof(tempLength) - 1, contentItem->length);
+					strncpy(tempLength, data + contentItem->offset, maxLengthLength);
+					tempLength[maxLengthLength] = 0;
+					contents->contentLength = atoi(tempLength);
+				} else {
+					contents->contentLength = atoi(data + contentItem->offset);
 				}
 			}
+			if(!endLine) {
+				break;
+			}
 		}
+		const char *nextLine = sip_scan_find(data + i, datalen - i, '\n');
+		if(!nextLine) {
+			break;
+		}
+		i = nextLine - data + 1;
 	}
 	contents->parseDataPtr = data;
 	return(rsltDataLen);
@@ -3609,6 +3794,7 @@ bool FileZipHandler::_writeToFile(char *data, int length, bool flush) {
 	case gzip:
 	case snappy:
 	case lzo:
+	case zstd:
 		if(!this->compressStream) {
 			this->initCompress();
 		}
@@ -3639,7 +3825,8 @@ bool FileZipHandler::__writeToFile(char *data, int length) {
 void FileZipHandler::initCompress() {
 	this->compressStream =  new FILE_LINE(38017) CompressStream(this->typeCompress == gzip ? CompressStream::gzip :
 							     this->typeCompress == snappy ? CompressStream::snappy :
-							     this->typeCompress == lzo ? CompressStream::lzo : CompressStream::compress_na,
+							     this->typeCompress == lzo ? CompressStream::lzo :
+							     this->typeCompress == zstd ? CompressStream::zstd : CompressStream::compress_na,
 							     this->typeCompress == snappy || this->typeCompress == lzo ?
 							      this->bufferLength :
 							      8 * 1024, 
@@ -3654,7 +3841,8 @@ void FileZipHandler::initCompress() {
 void FileZipHandler::initDecompress() {
 	this->compressStream =  new FILE_LINE(38018) CompressStream(this->typeCompress == gzip ? CompressStream::gzip :
 							     this->typeCompress == snappy ? CompressStream::snappy :
-							     this->typeCompress == lzo ? CompressStream::lzo : CompressStream::compress_na,
+							     this->typeCompress == lzo ? CompressStream::lzo :
+							     this->typeCompress == zstd ? CompressStream::zstd : CompressStream::compress_na,
 							     8 * 1024,
 							     0);
 }
@@ -3770,6 +3958,11 @@ FileZipHandler::eTypeCompress FileZipHandler::convTypeCompress(const char *typeC
 	} else if(!strcmp(_compress_method, "lzo")) {
 		return(FileZipHandler::lzo);
 	}
+	#ifdef HAVE_LIBZSTD
+	else if(!strcmp(_compress_method, "zstd")) {
+		return(FileZipHandler::zstd);
+	}
+	#endif //HAVE_LIBZSTD
 	return(FileZipHandler::compress_na);
 }
 
@@ -3781,6 +3974,8 @@ const char *FileZipHandler::convTypeCompress(eTypeCompress typeCompress) {
 		return("snappy");
 	case lzo:
 		return("lzo");
+	case zstd:
+		return("zstd");
 	case compress_default:
 		return("yes");
 	default:
@@ -3795,6 +3990,7 @@ string FileZipHandler::getConfigMenuString() {
 	       << convTypeCompress(gzip) << ':' << gzip << '|'
 	       << convTypeCompress(snappy) << ':' << snappy << '|'
 	       << convTypeCompress(lzo) << ':' << lzo << '|'
+	       << convTypeCompress(zstd) << ':' << zstd << '|'
 	       << "no:0";
 	return(outStr.str());
 }
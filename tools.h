@@ -38,6 +38,7 @@
 #include "rqueue.h"
 #include "voipmonitor.h"
 #include "tar_data.h"
+#include "lpm.h"
 
 using namespace std;
 
@@ -519,7 +520,8 @@ public:
 		compress_default,
 		gzip,
 		snappy,
-		lzo
+		lzo,
+		zstd
 	};
 	struct sReadBufferItem {
 		u_char *buff;
@@ -1427,15 +1429,51 @@ public:
 		_sync = 0;
 		_listIP_sorted = 0;
 		_listNet_sorted = 0;
+		lpm = NULL;
+	}
+	ListIP(const ListIP &other) {
+		autoLock = other.autoLock;
+		_sync = 0;
+		_listIP_sorted = 0;
+		_listNet_sorted = 0;
+		lpm = NULL;
+		listIP = other.listIP;
+		listNet = other.listNet;
+		if(other.lpm) {
+			prepareLpm();
+		}
+	}
+	~ListIP() {
+		if(lpm) {
+			delete lpm;
+		}
+	}
+	ListIP& operator = (const ListIP &other) {
+		if(this != &other) {
+			if(autoLock) lock();
+			listIP = other.listIP;
+			listNet = other.listNet;
+			_listIP_sorted = false;
+			_listNet_sorted = false;
+			retireLpm();
+			if(autoLock) unlock();
+			if(other.lpm) {
+				prepareLpm();
+			}
+		}
+		return(*this);
 	}
 	void add(vmIP ip, uint mask_length = 32) {
 		if(autoLock) lock();
 		IP _ip(ip, mask_length);
 		if(!_ip.isNet()) {
 			listIP.push_back(_ip);
+			_listIP_sorted = false;
 		} else {
 			listNet.push_back(_ip);
+			_listNet_sorted = false;
 		}
+		retireLpm();
 		if(autoLock) unlock();
 	}
 	void add(const char *ip) {
@@ -1443,16 +1481,58 @@ public:
 		IP _ip(ip);
 		if(!_ip.isNet()) {
 			listIP.push_back(_ip);
+			_listIP_sorted = false;
 		} else {
 			listNet.push_back(_ip);
+			_listNet_sorted = false;
 		}
+		retireLpm();
 		if(autoLock) unlock();
 	}
 	void addComb(string &ip, ListIP *negList = NULL);
 	void addComb(const char *ip, ListIP *negList = NULL);
 	void add(vector<vmIP> *ip);
 	void add(vector<vmIPmask> *net);
+	/* builds lpm trie - call after load (in reload thread), lookups fall back to sorted lists until then */
+	void prepareLpm();
 	bool checkIP(vmIP check_ip) {
+		cLpmIP *lpm = this->lpm;
+		if(lpm) {
+			return(lpm->lookup(check_ip) != 0);
+		}
+		return(checkIP_sorted(check_ip));
+	}
+	bool checkIP(const char *check_ip) {
+		return(checkIP(str_2_vmIP(check_ip)));
+	}
+	void clear() {
+		if(autoLock) lock();
+		listIP.clear();
+		listNet.clear();
+		retireLpm();
+		if(autoLock) unlock();
+	}
+	bool is_empty() {
+		return(!listIP.size() && !listNet.size());
+	}
+	void lock() {
+		while(__sync_lock_test_and_set(&this->_sync, 1));
+	}
+	void unlock() {
+		__sync_lock_release(&this->_sync);
+	}
+	std::vector<IP> *get_list_ip() {
+		return(&listIP);
+	}
+	static bool lpmTest();
+private:
+	void retireLpm() {
+		if(lpm) {
+			lpm_retire(lpm);
+			lpm = NULL;
+		}
+	}
+	bool checkIP_sorted(vmIP check_ip) {
 		bool rslt =  false;
 		if(autoLock) lock();
 		if(listIP.size()) {
@@ -1490,27 +1570,6 @@ public:
 		if(autoLock) unlock();
 		return(rslt);
 	}
-	bool checkIP(const char *check_ip) {
-		return(checkIP(str_2_vmIP(check_ip)));
-	}
-	void clear() {
-		if(autoLock) lock();
-		listIP.clear();
-		listNet.clear();
-		if(autoLock) unlock();
-	}
-	bool is_empty() {
-		return(!listIP.size() && !listNet.size());
-	}
-	void lock() {
-		while(__sync_lock_test_and_set(&this->_sync, 1));
-	}
-	void unlock() {
-		__sync_lock_release(&this->_sync);
-	}
-	std::vector<IP> *get_list_ip() {
-		return(&listIP);
-	}
 private:
 	std::vector<IP> listIP;
 	std::vector<IP> listNet;
@@ -1518,6 +1577,7 @@ private:
 	volatile int _sync;
 	volatile int _listIP_sorted;
 	volatile int _listNet_sorted;
+	cLpmIP * volatile lpm;
 friend class GroupsIP;
 };
 
@@ -1575,11 +1635,42 @@ public:
 		_sync = 0;
 		_listPhoneNumber_sorted = 0;
 		_listPrefixes_sorted = 0;
+		lpm = NULL;
+		lpm_disabled = false;
+	}
+	ListPhoneNumber(const ListPhoneNumber &other) {
+		autoLock = other.autoLock;
+		_sync = 0;
+		lpm = NULL;
+		lpm_disabled = false;
+		copyLists(other);
+		if(other.lpm) {
+			prepareLpm();
+		}
 	}
 	~ListPhoneNumber() {
 		for(std::list<cRegExp*>::iterator iter = listRegExp.begin(); iter != listRegExp.end(); iter++) {
 			delete *iter;
 		}
+		if(lpm) {
+			delete lpm;
+		}
+	}
+	ListPhoneNumber& operator = (const ListPhoneNumber &other) {
+		if(this != &other) {
+			if(autoLock) lock();
+			for(std::list<cRegExp*>::iterator iter = listRegExp.begin(); iter != listRegExp.end(); iter++) {
+				delete *iter;
+			}
+			copyLists(other);
+			retireLpm();
+			lpm_disabled = false;
+			if(autoLock) unlock();
+			if(other.lpm) {
+				prepareLpm();
+			}
+		}
+		return(*this);
 	}
 	void add(const char *number, bool prefix = true) {
 		if(autoLock) lock();
@@ -1590,50 +1681,37 @@ public:
 			}
 		} else if(!prefix) {
 			listPhoneNumber.push_back(PhoneNumber(number, false));
+			_listPhoneNumber_sorted = false;
 		} else {
 			listPrefixes.push_back(PhoneNumber(number, true));
+			_listPrefixes_sorted = false;
 		}
+		retireLpm();
 		if(autoLock) unlock();
 	}
 	void addComb(string &number, ListPhoneNumber *negList = NULL);
 	void addComb(const char *number, ListPhoneNumber *negList = NULL);
+	/* builds lpm trie - call after load (in reload thread), lookups fall back to sorted lists until then */
+	void prepareLpm();
 	bool checkNumber(const char *check_number) {
 		bool rslt =  false;
-		if(autoLock) lock();
-		if(listPhoneNumber.size()) {
-			if(!_listPhoneNumber_sorted) {
-				std::sort(listPhoneNumber.begin(), listPhoneNumber.end());
-				_listPhoneNumber_sorted = true;
-			}
-			std::vector<PhoneNumber>::iterator it_number = std::lower_bound(listPhoneNumber.begin(), listPhoneNumber.end(), PhoneNumber(check_number, false));
-			if(it_number != listPhoneNumber.end() && it_number->checkNumber(check_number)) {
-				rslt = true;
-			}
-		}
-		if(!rslt && listPrefixes.size()) {
-			if(!_listPrefixes_sorted) {
-				std::sort (listPrefixes.begin(), listPrefixes.end());
-				_listPrefixes_sorted = true;
-			}
-			std::vector<PhoneNumber>::iterator it_prefix = std::lower_bound(listPrefixes.begin(), listPrefixes.end(), PhoneNumber(check_number, false));
-			if(it_prefix != listPrefixes.end() && it_prefix->checkNumber(check_number)) {
-				rslt = true;
-			} else if(it_prefix != listPrefixes.begin()) {
-				--it_prefix;
-				if(it_prefix->checkNumber(check_number)) {
-					rslt = true;
-				}
-			}
+		cLpmNumber *lpm = this->lpm;
+		if(lpm) {
+			u_int32_t exact;
+			rslt = lpm->lookup(check_number, &exact) || exact;
+		} else {
+			rslt = checkNumber_sorted(check_number);
 		}
 		if(!rslt && listRegExp.size()) {
+			if(autoLock) lock();
 			for(std::list<cRegExp*>::iterator iter = listRegExp.begin(); iter != listRegExp.end(); iter++) {
 				if((*iter)->match(check_number)) {
 					rslt = true;
 					break;
 				}
 			}
+			if(autoLock) unlock();
 		}
-		if(autoLock) unlock();
 		return(rslt);
 	}
 	void clear() {
@@ -1644,6 +1722,8 @@ public:
 			delete *iter;
 		}
 		listRegExp.clear();
+		retireLpm();
+		lpm_disabled = false;
 		if(autoLock) unlock();
 	}
 	bool is_empty() {
@@ -1655,6 +1735,55 @@ public:
 	void unlock() {
 		__sync_lock_release(&this->_sync);
 	}
+	static bool lpmTest();
+private:
+	void copyLists(const ListPhoneNumber &other) {
+		listPhoneNumber = other.listPhoneNumber;
+		listPrefixes = other.listPrefixes;
+		_listPhoneNumber_sorted = false;
+		_listPrefixes_sorted = false;
+		listRegExp.clear();
+		for(std::list<cRegExp*>::const_iterator iter = other.listRegExp.begin(); iter != other.listRegExp.end(); iter++) {
+			listRegExp.push_back(new FILE_LINE(0) cRegExp((*iter)->getPattern()));
+		}
+	}
+	void retireLpm() {
+		if(lpm) {
+			lpm_retire(lpm);
+			lpm = NULL;
+		}
+	}
+	bool checkNumber_sorted(const char *check_number) {
+		bool rslt =  false;
+		if(autoLock) lock();
+		if(listPhoneNumber.size()) {
+			if(!_listPhoneNumber_sorted) {
+				std::sort(listPhoneNumber.begin(), listPhoneNumber.end());
+				_listPhoneNumber_sorted = true;
+			}
+			std::vector<PhoneNumber>::iterator it_number = std::lower_bound(listPhoneNumber.begin(), listPhoneNumber.end(), PhoneNumber(check_number, false));
+			if(it_number != listPhoneNumber.end() && it_number->checkNumber(check_number)) {
+				rslt = true;
+			}
+		}
+		if(!rslt && listPrefixes.size()) {
+			if(!_listPrefixes_sorted) {
+				std::sort (listPrefixes.begin(), listPrefixes.end());
+				_listPrefixes_sorted = true;
+			}
+			std::vector<PhoneNumber>::iterator it_prefix = std::lower_bound(listPrefixes.begin(), listPrefixes.end(), PhoneNumber(check_number, false));
+			if(it_prefix != listPrefixes.end() && it_prefix->checkNumber(check_number)) {
+				rslt = true;
+			} else if(it_prefix != listPrefixes.begin()) {
+				--it_prefix;
+				if(it_prefix->checkNumber(check_number)) {
+					rslt = true;
+				}
+			}
+		}
+		if(autoLock) unlock();
+		return(rslt);
+	}
 private:
 	std::vector<PhoneNumber> listPhoneNumber;
 	std::vector<PhoneNumber> listPrefixes;
@@ -1663,6 +1792,8 @@ private:
 	volatile int _sync;
 	volatile int _listPhoneNumber_sorted;
 	volatile int _listPrefixes_sorted;
+	cLpmNumber * volatile lpm;
+	volatile bool lpm_disabled;
 };
 
 class ListUA {
@@ -1768,6 +1899,10 @@ public:
 	void addWhite(const char *ip);
 	void addBlack(string &ip);
 	void addBlack(const char *ip);
+	void prepareLpm() {
+		white.prepareLpm();
+		black.prepareLpm();
+	}
 	bool checkIP(vmIP check_ip, bool *findInBlackList = NULL) {
 		if(findInBlackList) {
 			*findInBlackList = false;
@@ -1801,6 +1936,10 @@ public:
 	void addWhite(const char *number);
 	void addBlack(string &number);
 	void addBlack(const char *number);
+	void prepareLpm() {
+		white.prepareLpm();
+		black.prepareLpm();
+	}
 	bool checkNumber(const char *check_number, bool *findInBlackList = NULL) {
 		if(findInBlackList) {
 			*findInBlackList = false;
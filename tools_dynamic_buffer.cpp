@@ -5,6 +5,7 @@
 #include "calltable.h"
 
 #include "tools_dynamic_buffer.h"
+#include "zstd_dict.h"
 
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 
@@ -35,6 +36,10 @@ CompressStream::CompressStream(eTypeCompress typeCompress, u_int32_t compressBuf
 	this->lz4Stream = NULL;
 	this->lz4StreamDecode = NULL;
 	#endif //HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	this->zstdStream = NULL;
+	this->zstdStreamDecompress = NULL;
+	#endif //HAVE_LIBZSTD
 	#ifdef HAVE_LIBLZO
 	this->lzoWrkmem = NULL;
 	this->lzoWrkmemDecompress = NULL;
@@ -141,6 +146,22 @@ void CompressStream::initCompress() {
 		}
 		#endif //HAVE_LIBLZ4
 		break;
+	case zstd:
+		#ifdef HAVE_LIBZSTD
+		if(!this->zstdStream) {
+			this->zstdStream = ZSTD_createCCtx();
+			if(this->zstdStream) {
+				ZSTD_CCtx_setParameter(this->zstdStream, ZSTD_c_compressionLevel, zstdDict.getLevel());
+				if(zstdDict.getCDict()) {
+					ZSTD_CCtx_refCDict(this->zstdStream, zstdDict.getCDict());
+				}
+				createCompressBuffer();
+			} else {
+				this->setError("zstd initialize failed");
+			}
+		}
+		#endif //HAVE_LIBZSTD
+		break;
 	case compress_auto:
 		break;
 	}
@@ -213,6 +234,21 @@ void CompressStream::initDecompress(u_int32_t dataLen) {
 		createDecompressBuffer(dataLen);
 		#endif //HAVE_LIBLZ4
 		break;
+	case zstd:
+		#ifdef HAVE_LIBZSTD
+		if(!this->zstdStreamDecompress) {
+			this->zstdStreamDecompress = ZSTD_createDCtx();
+			if(this->zstdStreamDecompress) {
+				if(zstdDict.getDDict()) {
+					ZSTD_DCtx_refDDict(this->zstdStreamDecompress, zstdDict.getDDict());
+				}
+				createDecompressBuffer(this->decompressBufferLength);
+			} else {
+				this->setError("unzstd initialize failed");
+			}
+		}
+		#endif //HAVE_LIBZSTD
+		break;
 	case compress_auto:
 		break;
 	}
@@ -243,6 +279,12 @@ void CompressStream::termCompress() {
 		this->lz4Stream = NULL;
 	}
 	#endif //ifdef HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	if(this->zstdStream) {
+		ZSTD_freeCCtx(this->zstdStream);
+		this->zstdStream = NULL;
+	}
+	#endif //HAVE_LIBZSTD
 	if(this->compressBuffer) {
 		delete [] this->compressBuffer;
 		this->compressBuffer = NULL;
@@ -282,6 +324,12 @@ void CompressStream::termDecompress() {
 		this->lz4StreamDecode = NULL;
 	}
 	#endif //HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	if(this->zstdStreamDecompress) {
+		ZSTD_freeDCtx(this->zstdStreamDecompress);
+		this->zstdStreamDecompress = NULL;
+	}
+	#endif //HAVE_LIBZSTD
 	if(this->decompressBuffer) {
 		delete [] this->decompressBuffer;
 		this->decompressBuffer = NULL;
@@ -497,6 +545,33 @@ bool CompressStream::compress(char *data, u_int32_t len, bool flush, CompressStr
 		#endif //HAVE_LIBLZ4
 		}
 		break;
+	case zstd: {
+		#ifdef HAVE_LIBZSTD
+		if(!this->zstdStream) {
+			this->initCompress();
+			if(this->isError()) {
+				return(false);
+			}
+		}
+		ZSTD_inBuffer input = { data, len, 0 };
+		bool finished;
+		do {
+			ZSTD_outBuffer output = { this->compressBuffer, this->compressBufferLength, 0 };
+			size_t rslt = ZSTD_compressStream2(this->zstdStream, &output, &input, flush ? ZSTD_e_end : ZSTD_e_continue);
+			if(ZSTD_isError(rslt)) {
+				this->setError(string("zstd compress failed - ") + ZSTD_getErrorName(rslt));
+				return(false);
+			}
+			if(output.pos && !baseEv->compress_ev(this->compressBuffer, output.pos, 0)) {
+				this->setError("zstd compress_ev failed");
+				return(false);
+			}
+			finished = flush ? rslt == 0 : input.pos == input.size;
+		} while(!finished);
+		this->processed_len += len;
+		#endif //HAVE_LIBZSTD
+		}
+		break;
 	case compress_auto:
 		break;
 	}
@@ -526,6 +601,9 @@ bool CompressStream::decompress(char *data, u_int32_t len, u_int32_t decompress_
 			this->typeCompress = lzo;
 			data += 3;
 			len -= 3;
+		} else if(len >= 4 && !memcmp(data, "\x28\xB5\x2F\xFD", 4)) {
+			// zstd frame magic number - without prefix
+			this->typeCompress = zstd;
 		} else {
 			this->typeCompress = compress_na;
 		}
@@ -753,6 +831,41 @@ bool CompressStream::decompress(char *data, u_int32_t len, u_int32_t decompress_
 		}
 		#endif //HAVE_LIBLZ4
 		break;
+	case zstd: {
+		#ifdef HAVE_LIBZSTD
+		if(!this->zstdStreamDecompress) {
+			this->initDecompress(0);
+			if(this->isError()) {
+				return(false);
+			}
+			string error;
+			if(!zstdDict.checkFrameDictId(data, len, &error)) {
+				this->setError(error);
+				return(false);
+			}
+		}
+		ZSTD_inBuffer input = { data, len, 0 };
+		ZSTD_outBuffer output;
+		do {
+			output.dst = this->decompressBuffer;
+			output.size = this->decompressBufferLength;
+			output.pos = 0;
+			size_t rslt = ZSTD_decompressStream(this->zstdStreamDecompress, &output, &input);
+			if(ZSTD_isError(rslt)) {
+				this->setError(string("zstd decompress failed - ") + ZSTD_getErrorName(rslt));
+				return(false);
+			}
+			if(output.pos && !baseEv->decompress_ev(this->decompressBuffer, output.pos)) {
+				this->setError("zstd decompress_ev failed");
+				return(false);
+			}
+		} while(input.pos < input.size || output.pos == output.size);
+		if(use_len) {
+			*use_len = len;
+		}
+		#endif //HAVE_LIBZSTD
+		}
+		break;
 	case compress_auto:
 		break;
 	}
@@ -769,6 +882,7 @@ void CompressStream::createCompressBuffer() {
 	case zip:
 	case gzip:
 	case lzma:
+	case zstd:
 		if(!this->compressBufferLength) {
 			this->compressBufferLength = 8 * 1024;
 		}
@@ -822,6 +936,7 @@ void CompressStream::createDecompressBuffer(u_int32_t bufferLen) {
 	case zip:
 	case gzip:
 	case lzma:
+	case zstd:
 		if(!this->decompressBufferLength) {
 			this->decompressBufferLength = 8 * 1024;
 		}
@@ -880,6 +995,11 @@ CompressStream::eTypeCompress CompressStream::convTypeCompress(const char *typeC
 		return(CompressStream::lz4_stream);
 	}
 	#endif //HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	else if(!strcmp(_compress_method, "zstd")) {
+		return(CompressStream::zstd);
+	}
+	#endif //HAVE_LIBZSTD
 	return(CompressStream::compress_na);
 }
 
@@ -901,6 +1021,10 @@ const char *CompressStream::convTypeCompress(eTypeCompress typeCompress) {
 	case lz4_stream:
 		return("lz4_stream");
 	#endif //HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	case zstd:
+		return("zstd");
+	#endif //HAVE_LIBZSTD
 	default:
 		return("no");
 	}
@@ -913,6 +1037,7 @@ string CompressStream::getConfigMenuString() {
 	       << convTypeCompress(lzma) << ':' << lzma << '|'
 	       << convTypeCompress(snappy) << ':' << snappy << '|'
 	       << convTypeCompress(lzo) << ':' << lzo << '|'
+	       << convTypeCompress(zstd) << ':' << zstd << '|'
 	       << "no:0";
 	return(outStr.str());
 }
@@ -17,6 +17,9 @@
 #ifdef HAVE_LIBLZO
 #include <lzo/lzo1x.h>
 #endif //HAVE_LIBLZO
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif //HAVE_LIBZSTD
 #include <snappy-c.h>
 
 #include "tar_data.h"
@@ -48,7 +51,8 @@ public:
 		lzo,
 		lz4,
 		lz4_stream,
-		compress_auto
+		compress_auto,
+		zstd
 	};
 	struct sChunkSizeInfo {
 		u_int32_t size;
@@ -72,7 +76,8 @@ public:
 		return(typeCompress == compress_na ||
 		       typeCompress == zip ||
 		       typeCompress == gzip ||
-		       typeCompress == lzma);
+		       typeCompress == lzma ||
+		       typeCompress == zstd);
 	}
 	void setError(const char *errorString) {
 		if(errorString && *errorString) {
@@ -125,6 +130,10 @@ private:
 	LZ4_stream_t *lz4Stream;
 	LZ4_streamDecode_t *lz4StreamDecode;
 	#endif //HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	ZSTD_CCtx *zstdStream;
+	ZSTD_DCtx *zstdStreamDecompress;
+	#endif //HAVE_LIBZSTD
 	#ifdef HAVE_LIBLZO
 	u_char *lzoWrkmem;
 	u_char *lzoWrkmemDecompress;
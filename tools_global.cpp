@@ -10,6 +10,7 @@
 #ifdef CLOUD_ROUTER_CLIENT
 #include "tools.h"
 #include "common.h"
+#include "thread_placement.h"
 cThreadMonitor threadMonitor;
 #endif
 
@@ -24,9 +25,11 @@ void *vm_pthread_create_start_routine(void *arg) {
 	delete (vm_pthread_struct*)arg;
 	#ifdef CLOUD_ROUTER_CLIENT
 	threadMonitor.registerThread(thread_data.description.c_str());
+	threadPlacement.placeThread(thread_data.description.c_str());
 	#endif
 	void *rslt = thread_data.start_routine(thread_data.arg);
 	#ifdef CLOUD_ROUTER_CLIENT
+	threadPlacement.unplaceThread();
 	termTimeCacheForThread();
 	if(sverb.thread_create) {
 		syslog(LOG_NOTICE, "end thread '%s'", 
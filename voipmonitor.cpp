@@ -96,6 +96,12 @@
 #include "log_buffer.h"
 #include "heap_chunk.h"
 #include "charts.h"
+#include "sip_scan.h"
+#include "pipeline_bench.h"
+#include "zstd_dict.h"
+#include "codec_decoders.h"
+#include "codecs.h"
+#include "thread_placement.h"
 
 #if HAVE_LIBTCMALLOC_HEAPPROF
 #include <gperftools/heap-profiler.h>
@@ -290,6 +296,7 @@ bool opt_use_id_sensor_for_receiver_in_files = false;
 char opt_name_sensor[256] = "";
 volatile int readend = 0;
 int opt_dup_check = 0;
+int opt_dup_check_threads = 0;
 int opt_dup_check_ipheader = 1;
 int opt_dup_check_ipheader_ignore_ttl = 1;
 int opt_fax_dup_seq_check = 0;
@@ -303,6 +310,9 @@ bool opt_get_reason_from_bye_cancel = true;
 bool opt_cleanspool = true;
 bool opt_cleanspool_use_files = true;
 bool opt_cleanspool_use_files_set = false;
+bool opt_cleanspool_index = false;
+char opt_zstd_dictionary[1024];
+int opt_zstd_level = 1;
 int opt_cleanspool_interval = 0; // number of seconds between cleaning spool directory. 0 = disabled
 int opt_cleanspool_sizeMB = 0; // number of MB to keep in spooldir
 int opt_domainport = 0;
@@ -321,6 +331,8 @@ bool opt_ipacc_sniffer_agregate = false;
 bool opt_ipacc_agregate_only_customers_on_main_side = true;
 bool opt_ipacc_agregate_only_customers_on_any_side = true;
 int opt_udpfrag = 1;
+int opt_udpfrag_max_fragments = IPFRAG_MAX_FRAGMENTS_DEFAULT;
+int opt_udpfrag_max_mem = IPFRAG_MAX_MEM_MB_DEFAULT;
 MirrorIP *mirrorip = NULL;
 int opt_cdronlyanswered = 0;
 int opt_cdronlyrtp = 0;
@@ -347,6 +359,7 @@ bool opt_charts_cache_ip_boost = false;
 int opt_charts_cache_queue_limit = 100000;
 int opt_charts_cache_remote_queue_limit = 1000;
 int opt_charts_cache_remote_concat_limit = 1000;
+int opt_charts_cache_perc_compression = 200;
 char opt_convert_char[64] = "";
 int opt_skinny = 0;
 int opt_mgcp = 0;
@@ -386,6 +399,7 @@ int process_rtp_packets_distribute_threads_use = 0;
 int opt_process_rtp_packets_hash_next_thread = 1;
 int opt_process_rtp_packets_hash_next_thread_max = -1;
 int opt_process_rtp_packets_hash_next_thread_sem_sync = 2;
+int opt_rtp_hash_cache = 4096;
 unsigned int opt_preprocess_packets_qring_length = 2000;
 unsigned int opt_preprocess_packets_qring_item_length = 0;
 unsigned int opt_preprocess_packets_qring_usleep = 10;
@@ -395,6 +409,7 @@ unsigned int opt_process_rtp_packets_qring_item_length = 0;
 unsigned int opt_process_rtp_packets_qring_usleep = 10;
 bool opt_process_rtp_packets_qring_force_push = true;
 int opt_cleanup_calls_period = 10;
+bool opt_cleanup_timer_wheel = true;
 int opt_destroy_calls_period = 2;
 bool opt_destroy_calls_in_storing_cdr = false;
 int opt_enable_ss7 = 0;
@@ -431,6 +446,9 @@ int opt_mysql_max_multiple_rows_insert = 20;
 int opt_mysql_enable_new_store = 0;
 bool opt_mysql_enable_set_id = false;
 bool opt_csv_store_format = false;
+bool opt_mysql_prepared_insert = false;
+bool opt_pipeline_bench = false;
+char opt_pipeline_bench_output[1024];
 bool opt_mysql_mysql_redirect_cdr_queue = false;
 int opt_cdr_sip_response_number_max_length = 0;
 vector<string> opt_cdr_sip_response_reg_remove;
@@ -477,6 +495,9 @@ bool opt_saveaudio_from_rtp = false;
 int opt_saveaudio_stereo = 1;
 bool opt_saveaudio_big_jitter_resync_threshold = false;
 int opt_saveaudio_dedup_seq = 0;
+bool opt_audio_decoders_inprocess = true;
+int opt_saveaudio_inmemory_max_duration = 300;
+char opt_audio_decoder_plugins[1024];
 int opt_liveaudio = 1;
 int opt_register_timeout = 5;
 int opt_register_timeout_disable_save_failed = 0;
@@ -606,6 +627,7 @@ extern int opt_pcap_queue_compress;
 extern pcap_block_store::compress_method opt_pcap_queue_compress_method;
 extern int opt_pcap_queue_compress_ratio;
 extern string opt_pcap_queue_disk_folder;
+extern bool opt_pcap_queue_file_store_direct_io;
 extern ip_port opt_pcap_queue_send_to_ip_port;
 extern ip_port opt_pcap_queue_receive_from_ip_port;
 extern int opt_pcap_queue_receive_dlt;
@@ -615,6 +637,9 @@ extern int opt_pcap_queue_dequeu_need_blocks;
 extern int opt_pcap_queue_dequeu_method;
 extern int opt_pcap_queue_use_blocks;
 extern int opt_pcap_queue_use_blocks_auto_enable;
+extern string opt_pcap_queue_afpacket_interfaces;
+extern int opt_pcap_queue_afpacket_block_size;
+extern int opt_pcap_queue_afpacket_zerocopy;
 extern int opt_pcap_queue_suppress_t1_thread;
 extern int opt_pcap_queue_block_timeout;
 extern bool opt_pcap_queue_pcap_stat_per_one_interface;
@@ -1110,6 +1135,7 @@ int opt_hugepages_overcommit_max = 0;
 int opt_hugepages_second_heap = 0;
 
 int opt_numa_balancing_set = numa_balancing_set_autodisable;
+bool opt_thread_placement = false;
 
 int opt_mirror_connect_maximum_time_diff_s = 2;
 int opt_client_server_connect_maximum_time_diff_s = 2;
@@ -1911,6 +1937,9 @@ void *storing_cdr( void */*dummy*/ ) {
 							call->saveAloneByeToDb();
 						}
 					}
+					if(pipelineBench) {
+						pipelineBench->addCdr();
+					}
 					if(counter < indikConvertToWavSize) {
 						indikConvertToWav[counter] = needConvertToWavInThread;
 					}
@@ -2060,6 +2089,9 @@ void *storing_cdr_next_thread( void *_indexNextThread ) {
 					call->saveAloneByeToDb();
 				}
 			}
+			if(pipelineBench) {
+				pipelineBench->addCdr();
+			}
 			if(counter < indikConvertToWavSize) {
 				indikConvertToWav[counter] = needConvertToWavInThread;
 			}
@@ -3908,6 +3940,10 @@ int main_init_read() {
 
 	calltable = new FILE_LINE(42013) Calltable(sqlDbInit);
 	
+	if(opt_thread_placement && !is_read_from_file_simple()) {
+		threadPlacement.init(ifname);
+	}
+	
 	// if the system has more than one CPU enable threading
 	if(opt_rtpsave_threaded) {
 		if(num_threads_set > 0) {
@@ -4361,6 +4397,10 @@ int main_init_read() {
 			pcapQueueI->start();
 			pcapQueueInterface = pcapQueueI;
 		}
+		if(opt_pipeline_bench) {
+			pipelineBench = new FILE_LINE(0) cPipelineBench(opt_pipeline_bench_output);
+			pipelineBench->start();
+		}
 		pcapQueueStatInterface = pcapQueueQ;
 		
 		if(opt_scanpcapdir[0] != '\0') {
@@ -4385,6 +4425,7 @@ int main_init_read() {
 				pthread_mutex_lock(&terminate_packetbuffer_lock);
 				pcapQueueQ->pcapStat(verbosityE > 0 ? 1 : sverb.pcap_stat_period);
 				pthread_mutex_unlock(&terminate_packetbuffer_lock);
+				lpm_retired_cleanup();
 				if(sverb.memory_stat_log) {
 					printMemoryStat();
 				}
@@ -4661,6 +4702,10 @@ void main_term_read() {
 		}
 		__sync_lock_release(&storing_cdr_next_threads_count_sync);
 	}
+	if(pipelineBench) {
+		// object is kept - it is still sql null sink for the rest of termination
+		pipelineBench->stop();
+	}
 	if(storing_registers_thread) {
 		terminating_storing_registers = 1;
 		pthread_join(storing_registers_thread, NULL);
@@ -4782,6 +4827,8 @@ void main_term_read() {
 		termBilling();
 	}
 	
+	lpm_retired_cleanup(true);
+	
 	for(int i = 0; i < 2; i++) {
 		if(cleanSpool[i]) {
 			delete cleanSpool[i];
@@ -5786,6 +5833,12 @@ void test() {
 		}
 		} 
 		break;
+	case 61:
+		{
+		char *pointToSepOptTest = strchr(opt_test_str, '/');
+		sip_scan_test(pointToSepOptTest ? pointToSepOptTest + 1 : NULL);
+		}
+		break;
 	case 88:
 		setAllocNumb();
 		return;
@@ -5987,6 +6040,299 @@ void test() {
 		cout << billing.test(opt_test_arg, opt_test == 340) << endl;
 		}
 		break;
+	case 348:
+		{
+		char pcapFileName[1024];
+		char dictFileName[1024];
+		unsigned dictSizeKB = 0;
+		if(sscanf(opt_test_arg, "%s %s %u", pcapFileName, dictFileName, &dictSizeKB) < 2) {
+			cerr << "zstd-train-dict: bad arguments - use \"<pcap file> <dictionary file> [<size in kB>]\"" << endl;
+			break;
+		}
+		string error;
+		if(cZstdDict::train(pcapFileName, dictFileName, dictSizeKB * 1024, &error)) {
+			cout << "zstd dictionary saved to " << dictFileName << endl;
+		} else {
+			cerr << "zstd-train-dict: " << error << endl;
+		}
+		}
+		break;
+	case 349:
+		{
+		// scalar vs SIMD goertzel banks on recorded audio (signed 16 bit 8 kHz pcm or wav)
+		char pcmFileName[1024];
+		char mode[10] = "";
+		if(sscanf(opt_test_arg, "%s %9s", pcmFileName, mode) < 1) {
+			cerr << "dtmf-bench: bad arguments - use \"<pcm/wav file> [mf]\"" << endl;
+			break;
+		}
+		FILE *pcmFile = fopen(pcmFileName, "r");
+		if(!pcmFile) {
+			cerr << "dtmf-bench: failed open file " << pcmFileName << endl;
+			break;
+		}
+		vector<short> pcm;
+		short buff[4096];
+		size_t readSamples;
+		while((readSamples = fread(buff, sizeof(short), sizeof(buff) / sizeof(short), pcmFile)) > 0) {
+			pcm.insert(pcm.end(), buff, buff + readSamples);
+		}
+		fclose(pcmFile);
+		if(pcm.size() > 22 && !memcmp(&pcm[0], "RIFF", 4)) {
+			pcm.erase(pcm.begin(), pcm.begin() + 22);
+		}
+		const int frameSamples = 160;
+		const int passes = 20;
+		string digits[2];
+		u_int64_t timeUS[2];
+		for(int simd = 0; simd < 2; simd++) {
+			if(dsp_set_goertzel_simd(simd) != simd) {
+				cout << "dtmf-bench: SIMD goertzel is not available in this build" << endl;
+				timeUS[simd] = 0;
+				break;
+			}
+			u_int64_t startUS = getTimeUS();
+			for(int pass = 0; pass < passes; pass++) {
+				struct dsp *dsp = dsp_new();
+				dsp_set_features(dsp, DSP_FEATURE_DIGIT_DETECT);
+				if(!strcasecmp(mode, "mf")) {
+					dsp_set_digitmode(dsp, DSP_DIGITMODE_MF);
+				}
+				for(size_t pos = 0; pos + frameSamples <= pcm.size(); pos += frameSamples) {
+					char event_digit = 0;
+					int event_len = 0;
+					int silence = 0, totalsilence = 0, totalnoise = 0, res_call_progress = 0;
+					u_int16_t energylevel = 0;
+					int res = dsp_process(dsp, &pcm[pos], frameSamples, &event_digit, &event_len, &silence, &totalsilence, &totalnoise, &res_call_progress, &energylevel);
+					if(!pass && (res & DSP_PROCESS_RES_DTMF) && event_digit && event_len) {
+						digits[simd] += string(1, event_digit) + "(" + intToString(event_len) + "ms) ";
+					}
+				}
+				dsp_free(dsp);
+			}
+			timeUS[simd] = getTimeUS() - startUS;
+			cout << (simd ? "simd  " : "scalar") << " : " << (timeUS[simd] / passes) << " us / pass"
+			     << " (" << (pcm.size() / 8000.) << " s of audio), digits: " << digits[simd] << endl;
+		}
+		dsp_set_goertzel_simd(1);
+		if(timeUS[1]) {
+			cout << "results " << (digits[0] == digits[1] ? "match" : "DIFFER")
+			     << ", speedup " << ((double)timeUS[0] / timeUS[1]) << "x" << endl;
+		}
+		}
+		break;
+	case 350:
+		{
+		// charts cache percentiles - quantile sketch vs exact sort
+		// sketch with compression 0 and sketches of at most compression distinct values (discrete) have to be exact
+		unsigned compression = 0;
+		unsigned valuesCount = 0;
+		sscanf(opt_test_arg, "%u %u", &compression, &valuesCount);
+		if(!compression) {
+			compression = opt_charts_cache_perc_compression;
+		}
+		if(!valuesCount) {
+			valuesCount = 1000000;
+		}
+		const char *distributions[] = { "uniform", "normal", "exponential", "discrete" };
+		const unsigned discreteValues = 50;
+		const unsigned parts = 4;
+		bool ok = true;
+		for(unsigned pass = 0; pass < 2; pass++) {
+			unsigned passCompression = pass == 0 ? compression : 0;
+			srand(1);
+			for(unsigned distribution = 0; distribution < sizeof(distributions) / sizeof(distributions[0]); distribution++) {
+				vector<float> values;
+				cQuantileSketch sketch(passCompression);
+				cQuantileSketch sketchParts[parts];
+				for(unsigned i = 0; i < parts; i++) {
+					sketchParts[i] = cQuantileSketch(passCompression);
+				}
+				u_int64_t timeUS = 0;
+				for(unsigned i = 0; i < valuesCount; i++) {
+					double r = (rand() + 1.) / (RAND_MAX + 2.);
+					float value;
+					switch(distribution) {
+					case 0: value = r * 100; break;
+					case 1: value = 50 + 10 * sqrt(-2 * log(r)) * cos(2 * M_PI * rand() / RAND_MAX); break;
+					case 2: value = -log(r) * 10; break;
+					default: value = (int)(r * discreteValues); break;
+					}
+					values.push_back(value);
+					u_int64_t startTimeUS = getTimeUS();
+					sketch.add(value);
+					timeUS += getTimeUS() - startTimeUS;
+					sketchParts[i % parts].add(value);
+				}
+				for(unsigned i = 1; i < parts; i++) {
+					sketchParts[0].merge(&sketchParts[i]);
+				}
+				std::sort(values.begin(), values.end());
+				bool mustBeExact = passCompression == 0 || (distribution == 3 && discreteValues <= passCompression);
+				cout << distributions[distribution] << " (" << valuesCount << " values, compression " << passCompression
+				     << ", centroids " << sketch.centroidsCount() << ", add " << timeUS / 1000 << "ms)" << endl;
+				double percs[] = { 50, 95, 99, 99.9 };
+				for(unsigned i = 0; i < sizeof(percs) / sizeof(percs[0]); i++) {
+					u_int64_t percIndex = min((u_int64_t)round((double)values.size() * percs[i] / 100), (u_int64_t)values.size() - 1);
+					double exact = values[percIndex];
+					double approx = sketch.valueAtRank(percIndex);
+					double merged = sketchParts[0].valueAtRank(percIndex);
+					u_int64_t rankApproxFrom = lower_bound(values.begin(), values.end(), (float)approx) - values.begin();
+					u_int64_t rankApproxTo = upper_bound(values.begin(), values.end(), (float)approx) - values.begin();
+					double rankError = percIndex < rankApproxFrom ? rankApproxFrom - percIndex :
+							   percIndex >= rankApproxTo ? percIndex - rankApproxTo + 1 : 0;
+					cout << "  p" << percs[i] << " exact " << exact
+					     << " sketch " << approx << " (rank error " << rankError / values.size() * 100 << "%)"
+					     << " merged " << merged << endl;
+					if(mustBeExact && ((float)approx != exact || (float)merged != exact)) {
+						cout << "  p" << percs[i] << " is not exact" << endl;
+						ok = false;
+					}
+				}
+			}
+		}
+		cout << (ok ? "quantile-sketch-test: OK" : "quantile-sketch-test: FAILED") << endl;
+		}
+		break;
+	case 351:
+		{
+		// geoip and country prefixes - lpm tries vs lower_bound over sorted vectors (tables from database)
+		unsigned lookups = atoi(opt_test_arg);
+		if(!lookups) {
+			lookups = 1000000;
+		}
+		GeoIP_country geoIP;
+		CountryPrefixes countryPrefixes;
+		if(!geoIP.load() || !countryPrefixes.load()) {
+			cerr << "lpm-bench: geoip or country prefix tables are not available" << endl;
+			break;
+		}
+		srand(1);
+		vector<vmIP> ips;
+		vector<string> numbers;
+		for(unsigned i = 0; i < lookups; i++) {
+			ips.push_back(vmIP(((u_int32_t)rand() << 16) ^ (u_int32_t)rand()));
+			char number[20];
+			snprintf(number, sizeof(number), "%u%07u", 1 + rand() % 999, rand() % 10000000);
+			numbers.push_back(number);
+		}
+		for(unsigned type = 0; type < 2; type++) {
+			u_int64_t timeUS[2];
+			unsigned found[2] = { 0, 0 };
+			unsigned differ = 0;
+			vector<string> rslt[2];
+			for(unsigned lpm = 0; lpm < 2; lpm++) {
+				rslt[lpm].resize(lookups);
+				u_int64_t startUS = getTimeUS();
+				for(unsigned i = 0; i < lookups; i++) {
+					rslt[lpm][i] = type == 0 ?
+							(lpm ? geoIP.getCountry(ips[i]) : geoIP.getCountry_lower_bound(ips[i])) :
+							(lpm ? countryPrefixes._getCountry(numbers[i].c_str(), NULL, NULL) : 
+							       countryPrefixes._getCountry_lower_bound(numbers[i].c_str(), NULL, NULL));
+					if(!rslt[lpm][i].empty()) {
+						++found[lpm];
+					}
+				}
+				timeUS[lpm] = getTimeUS() - startUS;
+			}
+			for(unsigned i = 0; i < lookups; i++) {
+				if(rslt[0][i] != rslt[1][i]) {
+					if(differ < 10) {
+						cout << "  differ: " << (type == 0 ? ips[i].getString() : numbers[i])
+						     << " lower_bound '" << rslt[0][i] << "' lpm '" << rslt[1][i] << "'" << endl;
+					}
+					++differ;
+				}
+			}
+			cout << (type == 0 ? "geoip" : "country prefixes") << " (" << lookups << " lookups)" << endl
+			     << "  lower_bound: " << timeUS[0] / 1000 << " ms, found " << found[0] << endl
+			     << "  lpm: " << timeUS[1] / 1000 << " ms, found " << found[1]
+			     << ", speedup " << (timeUS[1] ? (double)timeUS[0] / timeUS[1] : 0) << "x"
+			     << ", differ " << differ << endl;
+		}
+		}
+		break;
+	case 352:
+		{
+		// mos f1/f2/adapt - frame prepared once for all jitterbuffers (jitterbuffer_mos) vs jitterbuffer per channel
+		unsigned packets = atoi(opt_test_arg);
+		if(!packets) {
+			packets = 100000;
+		}
+		cout << (RTP::jitterbuffer_mos_test(packets) ? "jitterbuffer-mos-test: OK" : "jitterbuffer-mos-test: FAILED") << endl;
+		}
+		break;
+	case 353:
+		{
+		// csv records stored by text path (store_001) and by batch path (prepared insert in the same transaction)
+		unsigned records = atoi(opt_test_arg);
+		if(!records) {
+			records = 1000;
+		}
+		cout << (SqlDb_mysql::insertBatchTest(records) ? "sql-insert-batch-test: OK" : "sql-insert-batch-test: FAILED") << endl;
+		}
+		break;
+	case 354:
+		{
+		// in-process g722 decoder vs reference pcm - given file (e.g. output of ITU-T G.722 reference decoder) or output of vmcodecs for the same raw file
+		vector<string> args = split(opt_test_arg, ';');
+		if(!args.size() || args[0].empty()) {
+			cerr << "usage: --g722-test=<raw file>[;<reference pcm/wav file>]" << endl;
+			break;
+		}
+		if(!codecDecoders.isEnabled()) {
+			codecDecoders.init(opt_audio_decoder_plugins);
+		}
+		string referenceFileName;
+		bool referenceByVmcodecs = args.size() < 2 || args[1].empty();
+		if(referenceByVmcodecs) {
+			referenceFileName = "/tmp/voipmonitor_g722_test_" + intToString(getpid()) + ".wav";
+			unlink(referenceFileName.c_str());
+			char cmd[4092];
+			if(opt_keycheck[0] != '\0') {
+				snprintf(cmd, sizeof(cmd), "vmcodecs %s g722 \"%s\" \"%s\" 64000", opt_keycheck, args[0].c_str(), referenceFileName.c_str());
+			} else {
+				snprintf(cmd, sizeof(cmd), "voipmonitor-g722 \"%s\" \"%s\" 64000", args[0].c_str(), referenceFileName.c_str());
+			}
+			cout << cmd << endl;
+			system(cmd);
+		} else {
+			referenceFileName = args[1];
+		}
+		cout << (codecDecoders.compareWithReference(PAYLOAD_G722, args[0].c_str(), referenceFileName.c_str()) ? 
+			  "g722-test: OK" : "g722-test: FAILED") << endl;
+		if(referenceByVmcodecs) {
+			unlink(referenceFileName.c_str());
+		}
+		}
+		break;
+	case 355:
+		{
+		// billing rule numbers - candidates from trie vs full scan select the same number
+		unsigned lookups = atoi(opt_test_arg);
+		if(!lookups) {
+			lookups = 100000;
+		}
+		cout << (cBillingRule::numbersCandidatesTest(lookups) ? "billing-numbers-test: OK" : "billing-numbers-test: FAILED") << endl;
+		}
+		break;
+	case 356:
+		// thread placement planner on fake topology
+		cout << (cThreadPlacement::test() ? "thread-placement-test: OK" : "thread-placement-test: FAILED") << endl;
+		break;
+	case 357:
+		// cleanspool index - append while scanning, rebuild, update after restart, compact, erase
+		cout << (CleanSpool::cSpoolIndex::test() ? "spool-index-test: OK" : "spool-index-test: FAILED") << endl;
+		break;
+	case 358:
+		// saveaudio_inmemory_max_duration - legs mixed in memory vs per-leg wav files, wav and ogg output
+		cout << (Call::convertRawToWavMixInMemoryTest() ? "mix-in-memory-test: OK" : "mix-in-memory-test: FAILED") << endl;
+		break;
+	case 359:
+		// ListIP / ListPhoneNumber - lpm tries vs sorted lists (and linear scan) on random nets and prefixes
+		cout << (ListIP::lpmTest() ? "lpm-list-test ip: OK" : "lpm-list-test ip: FAILED") << endl;
+		cout << (ListPhoneNumber::lpmTest() ? "lpm-list-test number: OK" : "lpm-list-test number: FAILED") << endl;
+		break;
 	}
  
 	/*
@@ -6473,6 +6819,7 @@ void cConfig::addConfigItems() {
 					expert();
 					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("mysql_enable_set_id", &opt_mysql_enable_set_id));
 					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("csv_store_format", &opt_csv_store_format));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("mysql_prepared_insert", &opt_mysql_prepared_insert));
 					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("mysql_redirect_cdr_queue", &opt_mysql_mysql_redirect_cdr_queue));
 		subgroup("cleaning");
 			addConfigItem(new FILE_LINE(42116) cConfigItem_integer("cleandatabase"));
@@ -6524,6 +6871,10 @@ void cConfig::addConfigItems() {
 				addConfigItem(new FILE_LINE(42133) cConfigItem_yesno("use_oneshot_buffer", &opt_use_oneshot_buffer));
 				addConfigItem(new FILE_LINE(42134) cConfigItem_integer("snaplen", &opt_snaplen));
 				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("interfaces_optimize", &opt_ifaces_optimize));
+				addConfigItem(new FILE_LINE(0) cConfigItem_string("afpacket_interfaces", &opt_pcap_queue_afpacket_interfaces));
+					expert();
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("afpacket_block_size", &opt_pcap_queue_afpacket_block_size));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("afpacket_zerocopy", &opt_pcap_queue_afpacket_zerocopy));
 			normal();
 			addConfigItem(new FILE_LINE(42135) cConfigItem_yesno("promisc", &opt_promisc));
 			addConfigItem(new FILE_LINE(42136) cConfigItem_string("filter", user_filter, sizeof(user_filter)));
@@ -6586,11 +6937,18 @@ void cConfig::addConfigItems() {
 						->setMaximum(MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS));
 					addConfigItem((new FILE_LINE(42157) cConfigItem_yesno("process_rtp_packets_hash_next_thread_sem_sync", &opt_process_rtp_packets_hash_next_thread_sem_sync))
 						->addValues("2:2"));
+					addConfigItem((new FILE_LINE(0) cConfigItem_integer("rtp_hash_cache", &opt_rtp_hash_cache))
+						->addValues("yes:4096|y:4096|no:0|n:0"));
 					addConfigItem(new FILE_LINE(42158) cConfigItem_integer("process_rtp_packets_qring_length", &opt_process_rtp_packets_qring_length));
 					addConfigItem(new FILE_LINE(42159) cConfigItem_integer("process_rtp_packets_qring_item_length", &opt_process_rtp_packets_qring_item_length));
 					addConfigItem(new FILE_LINE(42160) cConfigItem_integer("process_rtp_packets_qring_usleep", &opt_process_rtp_packets_qring_usleep));
 					addConfigItem(new FILE_LINE(42161) cConfigItem_yesno("process_rtp_packets_qring_force_push", &opt_process_rtp_packets_qring_force_push));
+					addConfigItem((new FILE_LINE(0) cConfigItem_integer("qring_wait_mode", &opt_qring_wait_mode))
+						->addValues("usleep:0|spin_futex:1|futex:1"));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("qring_wait_spin", &opt_qring_wait_spin));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("qring_wait_park_us", &opt_qring_wait_park_us));
 					addConfigItem(new FILE_LINE(0) cConfigItem_integer("cleanup_calls_period", &opt_cleanup_calls_period));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("cleanup_timer_wheel", &opt_cleanup_timer_wheel));
 					addConfigItem(new FILE_LINE(0) cConfigItem_integer("destroy_calls_period", &opt_destroy_calls_period));
 					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("destroy_calls_in_storing_cdr", &opt_destroy_calls_in_storing_cdr));
 			setDisableIfEnd();
@@ -6632,6 +6990,7 @@ void cConfig::addConfigItems() {
 					addConfigItem((new FILE_LINE(42178) cConfigItem_integer("packetbuffer_file_totalmaxsize", &opt_pcap_queue_store_queue_max_disk_size))
 						->setMultiple(1024 * 1024));
 					addConfigItem(new FILE_LINE(42179) cConfigItem_string("packetbuffer_file_path", &opt_pcap_queue_disk_folder));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("packetbuffer_file_direct_io", &opt_pcap_queue_file_store_direct_io));
 	group("data storing");
 		setDisableIfBegin("sniffer_mode=" + snifferMode_sender_str);
 		subgroup("main");
@@ -6727,6 +7086,7 @@ void cConfig::addConfigItems() {
 				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("saveaudio_filteripbysipip", &opt_saveaudio_filteripbysipip));
 				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("saveaudio_filter_ext", &opt_saveaudio_filter_ext));
 				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("saveaudio_wav_mix", &opt_saveaudio_wav_mix));
+				addConfigItem(new FILE_LINE(0) cConfigItem_integer("saveaudio_inmemory_max_duration", &opt_saveaudio_inmemory_max_duration));
 				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("saveaudio_from_first_invite", &opt_saveaudio_from_first_invite));
 				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("saveaudio_afterconnect", &opt_saveaudio_afterconnect));
 				addConfigItem(new FILE_LINE(42226) cConfigItem_yesno("saveaudio_stereo", &opt_saveaudio_stereo));
@@ -6736,12 +7096,15 @@ void cConfig::addConfigItems() {
 					expert();
 					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("saveaudio_dedup_seq", &opt_saveaudio_dedup_seq));
 					addConfigItem(new FILE_LINE(42230) cConfigItem_yesno("plcdisable", &opt_disableplc));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("audio_decoders_inprocess", &opt_audio_decoders_inprocess));
+					addConfigItem(new FILE_LINE(0) cConfigItem_string("audio_decoder_plugins", opt_audio_decoder_plugins, sizeof(opt_audio_decoder_plugins)));
 		setDisableIfEnd();
 	group("data spool directory cleaning");
 		setDisableIfBegin("sniffer_mode=" + snifferMode_sender_str);
 		addConfigItem(new FILE_LINE(0) cConfigItem_yesno("cleanspool", &opt_cleanspool));
 			advanced();
 			addConfigItem(new FILE_LINE(0) cConfigItem_yesno("cleanspool_use_files", &opt_cleanspool_use_files));
+			addConfigItem(new FILE_LINE(0) cConfigItem_yesno("cleanspool_index", &opt_cleanspool_index));
 			addConfigItem(new FILE_LINE(42231) cConfigItem_integer("cleanspool_interval", &opt_cleanspool_interval));
 		normal();
 		addConfigItem(new FILE_LINE(42232) cConfigItem_hour_interval("cleanspool_enable_fromto", &opt_cleanspool_enable_run_hour_from, &opt_cleanspool_enable_run_hour_to));
@@ -6770,6 +7133,9 @@ void cConfig::addConfigItems() {
 		addConfigItem(new FILE_LINE(42249) cConfigItem_yesno("dscp", &opt_dscp));
 				expert();
 				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("deduplicate_ipheader_ignore_ttl", &opt_dup_check_ipheader_ignore_ttl));
+				addConfigItem(new FILE_LINE(0) cConfigItem_integer("deduplicate_threads", &opt_dup_check_threads));
+				addConfigItem(new FILE_LINE(0) cConfigItem_integer("udpfrag_max_fragments", &opt_udpfrag_max_fragments));
+				addConfigItem(new FILE_LINE(0) cConfigItem_integer("udpfrag_max_mem", &opt_udpfrag_max_mem));
 				addConfigItem(new FILE_LINE(42250) cConfigItem_string("tcpreassembly_http_log", opt_tcpreassembly_http_log, sizeof(opt_tcpreassembly_http_log)));
 				addConfigItem(new FILE_LINE(42251) cConfigItem_string("tcpreassembly_webrtc_log", opt_tcpreassembly_webrtc_log, sizeof(opt_tcpreassembly_webrtc_log)));
 				addConfigItem(new FILE_LINE(42252) cConfigItem_string("tcpreassembly_ssl_log", opt_tcpreassembly_ssl_log, sizeof(opt_tcpreassembly_ssl_log)));
@@ -7183,9 +7549,11 @@ void cConfig::addConfigItems() {
 					addConfigItem((new FILE_LINE(42443) cConfigItem_integer("packetbuffer_total_maxheap", &opt_pcap_queue_store_queue_max_memory_size))
 						->setMultiple(1024 * 1024));
 					addConfigItem((new FILE_LINE(42444) cConfigItem_yesno("packetbuffer_compress_method"))
-						->addValues("snappy:1|s:1|lz4:2|l:2")
+						->addValues("snappy:1|s:1|lz4:2|l:2|zstd:3|z:3")
 						->setDefaultValueStr("no"));
 					addConfigItem(new FILE_LINE(42445) cConfigItem_integer("packetbuffer_compress_ratio", &opt_pcap_queue_compress_ratio));
+					addConfigItem(new FILE_LINE(0) cConfigItem_string("zstd_dictionary", opt_zstd_dictionary, sizeof(opt_zstd_dictionary)));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("zstd_level", &opt_zstd_level));
 						obsolete();
 						addConfigItem(new FILE_LINE(42446) cConfigItem_yesno("pcap_dispatch", &opt_pcap_dispatch));
 		subgroup("storing packets into pcap files, graph, audio");
@@ -7221,6 +7589,7 @@ void cConfig::addConfigItems() {
 				addConfigItem(new FILE_LINE(0) cConfigItem_integer("server_sql_queue_limit", &snifferServerOptions.mysql_queue_limit));
 				addConfigItem(new FILE_LINE(0) cConfigItem_integer("server_sql_redirect_queue_limit", &snifferServerOptions.mysql_redirect_queue_limit));
 				addConfigItem(new FILE_LINE(0) cConfigItem_integer("server_sql_concat_limit", &snifferServerOptions.mysql_concat_limit));
+				addConfigItem(new FILE_LINE(0) cConfigItem_integer("server_reactor_threads", &snifferServerOptions.reactor_threads));
 				addConfigItem((new FILE_LINE(0) cConfigItem_yesno("server_type_compress", (int*)&snifferServerOptions.type_compress))
 					->addValues("gzip:1|zip:1|lzo:2")
 					->setDefaultValueStr("yes"));
@@ -7235,6 +7604,7 @@ void cConfig::addConfigItems() {
 			addConfigItem(new FILE_LINE(0) cConfigItem_integer("charts_cache_queue_limit", &opt_charts_cache_queue_limit));
 			addConfigItem(new FILE_LINE(0) cConfigItem_integer("charts_cache_remote_queue_limit", &opt_charts_cache_remote_queue_limit));
 			addConfigItem(new FILE_LINE(0) cConfigItem_integer("charts_cache_remote_concat_limit", &opt_charts_cache_remote_concat_limit));
+			addConfigItem(new FILE_LINE(0) cConfigItem_integer("charts_cache_perc_compression", &opt_charts_cache_perc_compression));
 				advanced();
 				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("watchdog", &enable_wdt));
 				addConfigItem(new FILE_LINE(42460) cConfigItem_yesno("printinsertid", &opt_printinsertid));
@@ -7269,6 +7639,7 @@ void cConfig::addConfigItems() {
 						->addValues(("autodisable:" + intToString(numa_balancing_set_autodisable) + "|" + 
 							     "enable:" + intToString(numa_balancing_set_enable) + "|" +
 							     "disable:" + intToString(numa_balancing_set_disable)).c_str()));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("thread_placement", &opt_thread_placement));
 					addConfigItem(new FILE_LINE(0) cConfigItem_integer("abort_if_rss_gt_gb", &opt_abort_if_rss_gt_gb));
 					addConfigItem(new FILE_LINE(0) cConfigItem_integer("next_server_connections", &opt_next_server_connections));
 						obsolete();
@@ -7391,6 +7762,9 @@ void cConfig::evSetConfigItem(cConfigItem *configItem) {
 		case 2:
 			opt_pcap_queue_compress_method = pcap_block_store::lz4;
 			break;
+		case 3:
+			opt_pcap_queue_compress_method = pcap_block_store::zstd;
+			break;
 		}
 	}
 	if((configItem->config_name == "mirror_destination" && ((cConfigItem_ip_port*)configItem)->getValue()) || 
@@ -7616,6 +7990,19 @@ void parse_command_line_arguments(int argc, char *argv[]) {
 	    {"heap-profiler", 1, 0, 342},
 	    {"revaluation", 1, 0, 344},
 	    {"eval-formula", 1, 0, 345},
+	    {"pipeline-bench", 1, 0, 347},
+	    {"zstd-train-dict", 1, 0, 348},
+	    {"dtmf-bench", 1, 0, 349},
+	    {"quantile-sketch-test", 1, 0, 350},
+	    {"lpm-bench", 1, 0, 351},
+	    {"jitterbuffer-mos-test", 2, 0, 352},
+	    {"sql-insert-batch-test", 2, 0, 353},
+	    {"g722-test", 1, 0, 354},
+	    {"billing-numbers-test", 2, 0, 355},
+	    {"thread-placement-test", 0, 0, 356},
+	    {"spool-index-test", 0, 0, 357},
+	    {"mix-in-memory-test", 0, 0, 358},
+	    {"lpm-list-test", 0, 0, 359},
 /*
 	    {"maxpoolsize", 1, 0, NULL},
 	    {"maxpooldays", 1, 0, NULL},
@@ -8112,6 +8499,18 @@ void get_command_line_arguments() {
 			case 320:
 			case 322:
 			case 340:
+			case 348:
+			case 349:
+			case 350:
+			case 351:
+			case 352:
+			case 353:
+			case 354:
+			case 355:
+			case 356:
+			case 357:
+			case 358:
+			case 359:
 				opt_test = c;
 				if(optarg) {
 					strcpy_null_term(opt_test_arg, optarg);
@@ -8266,6 +8665,10 @@ void get_command_line_arguments() {
 					strcpy(opt_revaluation_params, optarg);
 				}
 				break;
+			case 347:
+				strcpy_null_term(opt_pipeline_bench_output, optarg);
+				opt_pipeline_bench = true;
+				break;
 			case 345:
 				{
 				cEvalFormula f(cEvalFormula::_est_na, true);
@@ -8367,6 +8770,15 @@ void set_context_config() {
 		opt_pcap_queue_compress = 0;
 	}
 	
+	if(!zstdDict.isLoaded()) {
+		// dictionary is shared by running compress streams - it is loaded only once
+		zstdDict.load(opt_zstd_dictionary, opt_zstd_level);
+	}
+	
+	if(opt_audio_decoders_inprocess && !codecDecoders.isEnabled()) {
+		codecDecoders.init(opt_audio_decoder_plugins);
+	}
+	
 	if(!is_read_from_file_simple() && !is_set_gui_params() && command_line_data.size()) {
 		// restore orig values
 		buffersControl.restoreMaxBufferMemFromOrig();
@@ -8531,10 +8943,25 @@ void set_context_config() {
 	
 	ifnamev = split(ifname, split(",|;| |\t|\r|\n", "|"), true);
 	
+	bool afpacket_interfaces = false;
+	bool afpacket_fanout = false;
+	if(!opt_scanpcapdir[0] && !opt_pb_read_from_file[0] &&
+	   !is_sender() && !is_client_packetbuffer_sender()) {
+		for(unsigned i = 0; i < ifnamev.size(); i++) {
+			unsigned afpacket_threads;
+			if(afpacket_interface_is(ifnamev[i].c_str(), &afpacket_threads)) {
+				afpacket_interfaces = true;
+				if(afpacket_threads > 1) {
+					afpacket_fanout = true;
+				}
+			}
+		}
+	}
+	
 	if(opt_pcap_queue_dequeu_window_length < 0) {
 		if(is_receiver() || is_server()) {
 			 opt_pcap_queue_dequeu_window_length = 2000;
-		} else if(ifnamev.size() > 1) {
+		} else if(ifnamev.size() > 1 || afpacket_fanout) {
 			 opt_pcap_queue_dequeu_window_length = 1000;
 		}
 	}
@@ -8589,6 +9016,11 @@ void set_context_config() {
 		}
 	}
 	
+	if(afpacket_interfaces && !opt_pcap_queue_use_blocks) {
+		opt_pcap_queue_use_blocks = 1;
+		syslog(LOG_NOTICE, "enabling pcap_queue_use_blocks because set afpacket_interfaces");
+	}
+	
 	if(opt_dup_check && opt_pcap_queue_use_blocks && (is_receiver() || is_server())) {
 		opt_receiver_check_id_sensor = false;
 		syslog(LOG_NOTICE, "disabling receiver_check_id_sensor because set deduplicate in server/receiver mode");
@@ -9205,6 +9637,15 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "interfaces_optimize", NULL))) {
 		opt_ifaces_optimize = yesno( value);
 	}
+	if((value = ini.GetValue("general", "afpacket_interfaces", NULL))) {
+		opt_pcap_queue_afpacket_interfaces = value;
+	}
+	if((value = ini.GetValue("general", "afpacket_block_size", NULL))) {
+		opt_pcap_queue_afpacket_block_size = atoi(value);
+	}
+	if((value = ini.GetValue("general", "afpacket_zerocopy", NULL))) {
+		opt_pcap_queue_afpacket_zerocopy = yesno(value);
+	}
 	if (ini.GetAllValues("general", "interface_ip_filter", values)) {
 		CSimpleIni::TNamesDepend::const_iterator i = values.begin();
 		for (; i != values.end(); ++i) {
@@ -9289,6 +9730,9 @@ int eval_config(string inistr) {
 		opt_cleanspool_use_files = yesno(value);
 		opt_cleanspool_use_files_set = true;
 	}
+	if((value = ini.GetValue("general", "cleanspool_index", NULL))) {
+		opt_cleanspool_index = yesno(value);
+	}
 	if((value = ini.GetValue("general", "cleanspool_interval", NULL))) {
 		opt_cleanspool_interval = atoi(value);
 	}
@@ -9511,6 +9955,9 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "deduplicate_ipheader_ignore_ttl", NULL))) {
 		opt_dup_check_ipheader_ignore_ttl = yesno(value);
 	}
+	if((value = ini.GetValue("general", "deduplicate_threads", NULL))) {
+		opt_dup_check_threads = atoi(value);
+	}
 	if((value = ini.GetValue("general", "dscp", NULL))) {
 		opt_dscp = yesno(value);
 	}
@@ -10059,6 +10506,9 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "csv_store_format"))) {
 		opt_csv_store_format = yesno(value);
 	}
+	if((value = ini.GetValue("general", "mysql_prepared_insert"))) {
+		opt_mysql_prepared_insert = yesno(value);
+	}
 	if((value = ini.GetValue("general", "mysqlhost", NULL))) {
 		strcpy_null_term(mysql_host, value);
 	}
@@ -10483,6 +10933,9 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "charts_cache_remote_concat_limit", NULL))) {
 		opt_charts_cache_remote_concat_limit = atoi(value);
 	}
+	if((value = ini.GetValue("general", "charts_cache_perc_compression", NULL))) {
+		opt_charts_cache_perc_compression = atoi(value);
+	}
 	if((value = ini.GetValue("general", "convertchar", NULL))) {
 		strcpy_null_term(opt_convert_char, value);
 	}
@@ -10523,6 +10976,9 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "packetbuffer_file_path", NULL))) {
 		opt_pcap_queue_disk_folder = value;
 	}
+	if((value = ini.GetValue("general", "packetbuffer_file_direct_io", NULL))) {
+		opt_pcap_queue_file_store_direct_io = yesno(value);
+	}
 	/*
 	DEFAULT VALUES
 	if((value = ini.GetValue("general", "packetbuffer_file_maxfilesize", NULL))) {
@@ -10543,11 +10999,19 @@ int eval_config(string inistr) {
 			opt_pcap_queue_compress_method = pcap_block_store::snappy;
 		} else if(!strcmp(_opt_pcap_queue_compress_method, "lz4")) {
 			opt_pcap_queue_compress_method = pcap_block_store::lz4;
+		} else if(!strcmp(_opt_pcap_queue_compress_method, "zstd")) {
+			opt_pcap_queue_compress_method = pcap_block_store::zstd;
 		}
 	}
 	if((value = ini.GetValue("general", "packetbuffer_compress_ratio", NULL))) {
 		opt_pcap_queue_compress_ratio = atoi(value);
 	}
+	if((value = ini.GetValue("general", "zstd_dictionary", NULL))) {
+		strcpy_null_term(opt_zstd_dictionary, value);
+	}
+	if((value = ini.GetValue("general", "zstd_level", NULL))) {
+		opt_zstd_level = atoi(value);
+	}
 	if((value = ini.GetValue("general", "mirror_destination_ip", NULL)) &&
 	   (value2 = ini.GetValue("general", "mirror_destination_port", NULL))) {
 		opt_pcap_queue_send_to_ip_port.set_ip(value);
@@ -10769,12 +11233,21 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "saveaudio_wav_mix", NULL))) {
 		opt_saveaudio_wav_mix = yesno(value);
 	}
+	if((value = ini.GetValue("general", "saveaudio_inmemory_max_duration", NULL))) {
+		opt_saveaudio_inmemory_max_duration = atoi(value);
+	}
 	if((value = ini.GetValue("general", "saveaudio_from_first_invite", NULL))) {
 		opt_saveaudio_from_first_invite = yesno(value);
 	}
 	if((value = ini.GetValue("general", "saveaudio_afterconnect", NULL))) {
 		opt_saveaudio_afterconnect = yesno(value);
 	}
+	if((value = ini.GetValue("general", "audio_decoders_inprocess", NULL))) {
+		opt_audio_decoders_inprocess = yesno(value);
+	}
+	if((value = ini.GetValue("general", "audio_decoder_plugins", NULL))) {
+		strcpy_null_term(opt_audio_decoder_plugins, value);
+	}
 	if((value = ini.GetValue("general", "saveaudio_stereo", NULL))) {
 		opt_saveaudio_stereo = yesno(value);
 	}
@@ -11161,9 +11634,26 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "process_rtp_packets_qring_force_push", NULL))) {
 		opt_process_rtp_packets_qring_force_push = yesno(value);
 	}
+	if((value = ini.GetValue("general", "qring_wait_mode", NULL))) {
+		opt_qring_wait_mode = !strcasecmp(value, "usleep") ? _swm_usleep :
+				      !strcasecmp(value, "spin_futex") || !strcasecmp(value, "futex") ? _swm_spin_futex :
+				      atoi(value);
+	}
+	if((value = ini.GetValue("general", "qring_wait_spin", NULL))) {
+		opt_qring_wait_spin = atoi(value);
+	}
+	if((value = ini.GetValue("general", "qring_wait_park_us", NULL))) {
+		opt_qring_wait_park_us = atoi(value);
+	}
+	if((value = ini.GetValue("general", "rtp_hash_cache", NULL))) {
+		opt_rtp_hash_cache = atoi(value) > 1 ? atoi(value) : (yesno(value) ? 4096 : 0);
+	}
 	if((value = ini.GetValue("general", "cleanup_calls_period", NULL))) {
 		opt_cleanup_calls_period = atoi(value);
 	}
+	if((value = ini.GetValue("general", "cleanup_timer_wheel", NULL))) {
+		opt_cleanup_timer_wheel = yesno(value);
+	}
 	if((value = ini.GetValue("general", "destroy_calls_period", NULL))) {
 		opt_destroy_calls_period = atoi(value);
 	}
@@ -11183,6 +11673,12 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "udpfrag", NULL))) {
 		opt_udpfrag = yesno(value);
 	}
+	if((value = ini.GetValue("general", "udpfrag_max_fragments", NULL))) {
+		opt_udpfrag_max_fragments = atoi(value);
+	}
+	if((value = ini.GetValue("general", "udpfrag_max_mem", NULL))) {
+		opt_udpfrag_max_mem = atoi(value);
+	}
 	if((value = ini.GetValue("general", "faxdetect", NULL))) {
 		opt_faxt30detect = yesno(value);
 	}
@@ -11338,6 +11834,9 @@ int eval_config(string inistr) {
 			opt_numa_balancing_set = yesno(value);
 		}
 	}
+	if((value = ini.GetValue("general", "thread_placement", NULL))) {
+		opt_thread_placement = yesno(value);
+	}
 	if((value = ini.GetValue("general", "abort_if_rss_gt_gb", NULL))) {
 		opt_abort_if_rss_gt_gb = atoi(value);
 	}
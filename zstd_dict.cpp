@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <syslog.h>
+#include <pcap.h>
+#include <vector>
+
+#ifdef HAVE_LIBZSTD
+#include <zdict.h>
+#endif //HAVE_LIBZSTD
+
+#include "zstd_dict.h"
+#include "tools.h"
+
+
+cZstdDict zstdDict;
+
+
+cZstdDict::cZstdDict() {
+	level = 1;
+	dictId = 0;
+	#ifdef HAVE_LIBZSTD
+	cdict = NULL;
+	ddict = NULL;
+	#endif //HAVE_LIBZSTD
+}
+
+cZstdDict::~cZstdDict() {
+	free();
+}
+
+bool cZstdDict::load(const char *fileName, int level) {
+	free();
+	this->level = level > 0 ? level : 1;
+	if(!fileName || !*fileName) {
+		return(true);
+	}
+	#ifdef HAVE_LIBZSTD
+	FILE *file = fopen(fileName, "r");
+	if(!file) {
+		syslog(LOG_ERR, "zstd dictionary: failed to open file %s", fileName);
+		return(false);
+	}
+	SimpleBuffer dictBuffer;
+	char readBuffer[64 * 1024];
+	size_t readLength;
+	while((readLength = fread(readBuffer, 1, sizeof(readBuffer), file)) > 0) {
+		dictBuffer.add(readBuffer, readLength);
+	}
+	fclose(file);
+	u_int32_t _dictId = ZSTD_getDictID_fromDict(dictBuffer.data(), dictBuffer.size());
+	if(!_dictId) {
+		syslog(LOG_ERR, "zstd dictionary: file %s is not zstd dictionary", fileName);
+		return(false);
+	}
+	cdict = ZSTD_createCDict(dictBuffer.data(), dictBuffer.size(), this->level);
+	ddict = ZSTD_createDDict(dictBuffer.data(), dictBuffer.size());
+	if(!cdict || !ddict) {
+		syslog(LOG_ERR, "zstd dictionary: failed to create dictionary from file %s", fileName);
+		free();
+		return(false);
+	}
+	this->fileName = fileName;
+	dictId = _dictId;
+	syslog(LOG_NOTICE, "zstd dictionary %s loaded - id %u, size %u", fileName, dictId, dictBuffer.size());
+	return(true);
+	#else
+	syslog(LOG_ERR, "zstd dictionary: zstd is not supported - build with libzstd");
+	return(false);
+	#endif //HAVE_LIBZSTD
+}
+
+void cZstdDict::free() {
+	#ifdef HAVE_LIBZSTD
+	if(cdict) {
+		ZSTD_freeCDict(cdict);
+		cdict = NULL;
+	}
+	if(ddict) {
+		ZSTD_freeDDict(ddict);
+		ddict = NULL;
+	}
+	#endif //HAVE_LIBZSTD
+	fileName = "";
+	dictId = 0;
+}
+
+#ifdef HAVE_LIBZSTD
+bool cZstdDict::checkFrameDictId(const void *data, size_t size, string *error) {
+	u_int32_t frameDictId = ZSTD_getDictID_fromFrame(data, size);
+	if(frameDictId && frameDictId != dictId) {
+		if(error) {
+			*error = dictId ?
+				  "zstd frame compressed with dictionary " + intToString(frameDictId) + " but loaded dictionary is " + intToString(dictId) :
+				  "zstd frame compressed with dictionary " + intToString(frameDictId) + " but dictionary is not loaded";
+		}
+		return(false);
+	}
+	return(true);
+}
+#endif //HAVE_LIBZSTD
+
+bool cZstdDict::train(const char *pcapFileName, const char *dictFileName, unsigned dictSize, string *error) {
+	#ifdef HAVE_LIBZSTD
+	char errbuf[PCAP_ERRBUF_SIZE];
+	pcap_t *pcapHandle = pcap_open_offline_zip(pcapFileName, errbuf);
+	if(!pcapHandle) {
+		*error = string("failed to open pcap file ") + pcapFileName + " - " + errbuf;
+		return(false);
+	}
+	// every packet (up to ZSTD_DICT_TRAIN_MAX_SAMPLE_SIZE) is one sample - blocks and spool files consist of packets
+	SimpleBuffer samples;
+	vector<size_t> samplesSizes;
+	pcap_pkthdr *header;
+	const u_char *packet;
+	while(pcap_next_ex(pcapHandle, &header, &packet) > 0) {
+		size_t sampleSize = min(header->caplen, (u_int32_t)ZSTD_DICT_TRAIN_MAX_SAMPLE_SIZE);
+		if(samples.size() + sampleSize > ZSTD_DICT_TRAIN_MAX_SAMPLES_SIZE) {
+			break;
+		}
+		samples.add((void*)packet, sampleSize);
+		samplesSizes.push_back(sampleSize);
+	}
+	pcap_close(pcapHandle);
+	if(samplesSizes.size() < 10) {
+		*error = "too few packets in pcap file";
+		return(false);
+	}
+	if(!dictSize) {
+		dictSize = ZSTD_DICT_SIZE_DEFAULT;
+	}
+	u_char *dictBuffer = new FILE_LINE(0) u_char[dictSize];
+	size_t rsltSize = ZDICT_trainFromBuffer(dictBuffer, dictSize,
+						samples.data(), &samplesSizes[0], samplesSizes.size());
+	if(ZDICT_isError(rsltSize)) {
+		*error = string("training failed - ") + ZDICT_getErrorName(rsltSize);
+		delete [] dictBuffer;
+		return(false);
+	}
+	FILE *file = fopen(dictFileName, "w");
+	if(!file) {
+		*error = string("failed to create file ") + dictFileName;
+		delete [] dictBuffer;
+		return(false);
+	}
+	bool rslt = fwrite(dictBuffer, 1, rsltSize, file) == rsltSize;
+	fclose(file);
+	if(!rslt) {
+		*error = string("failed to write file ") + dictFileName;
+	} else {
+		syslog(LOG_NOTICE, "zstd dictionary %s trained from %lu packets - id %u, size %lu",
+		       dictFileName, samplesSizes.size(), ZDICT_getDictID(dictBuffer, rsltSize), rsltSize);
+	}
+	delete [] dictBuffer;
+	return(rslt);
+	#else
+	*error = "zstd is not supported - build with libzstd";
+	return(false);
+	#endif //HAVE_LIBZSTD
+}
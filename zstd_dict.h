@@ -0,0 +1,68 @@
+#ifndef ZSTD_DICT_H
+#define ZSTD_DICT_H
+
+
+#include "config.h"
+
+#include <string>
+#include <sys/types.h>
+
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif //HAVE_LIBZSTD
+
+
+using namespace std;
+
+
+#define ZSTD_DICT_SIZE_DEFAULT (112 * 1024)
+#define ZSTD_DICT_TRAIN_MAX_SAMPLES_SIZE (128 * 1024 * 1024)
+#define ZSTD_DICT_TRAIN_MAX_SAMPLE_SIZE 2048
+
+
+/*
+ * Zstd dictionary (zstd_dictionary = file, zstd_level) shared by pcap_block_store (packetbuffer_compress_method = zstd),
+ * CompressStream (pcap_dump_zip_*, tar_internalcompress_*) and ChunkBuffer.
+ * Dictionary ID is written to the header of every zstd frame, so data compressed with other dictionary are detected.
+ * Dictionary is trained from sample pcap file by --zstd-train-dict="<pcap> <dictionary file> [<size in kB>]".
+ */
+class cZstdDict {
+public:
+	cZstdDict();
+	~cZstdDict();
+	bool load(const char *fileName, int level);
+	void free();
+	bool isLoaded() {
+		return(dictId != 0);
+	}
+	u_int32_t getDictId() {
+		return(dictId);
+	}
+	int getLevel() {
+		return(level);
+	}
+	#ifdef HAVE_LIBZSTD
+	ZSTD_CDict *getCDict() {
+		return(cdict);
+	}
+	ZSTD_DDict *getDDict() {
+		return(ddict);
+	}
+	bool checkFrameDictId(const void *data, size_t size, string *error = NULL);
+	#endif //HAVE_LIBZSTD
+	static bool train(const char *pcapFileName, const char *dictFileName, unsigned dictSize, string *error);
+private:
+	string fileName;
+	int level;
+	u_int32_t dictId;
+	#ifdef HAVE_LIBZSTD
+	ZSTD_CDict *cdict;
+	ZSTD_DDict *ddict;
+	#endif //HAVE_LIBZSTD
+};
+
+
+extern cZstdDict zstdDict;
+
+
+#endif //ZSTD_DICT_H